@@ -60,6 +60,7 @@ static uint32_t g_crc32c_chained_count = 1;
 static int g_fail_percent_goal = 0;
 static uint8_t g_fill_pattern = 255;
 static bool g_verify = false;
+static bool g_sw_inline_completion = false;
 static const char *g_workload_type = NULL;
 static enum accel_capability g_workload_selection;
 static struct worker_thread *g_workers = NULL;
@@ -83,6 +84,7 @@ struct ap_task {
 	uint32_t		crc_dst;
 	struct worker_thread	*worker;
 	int			expected_status; /* used for the compare operation */
+	uint64_t		submit_tsc;
 	TAILQ_ENTRY(ap_task)	link;
 };
 
@@ -92,6 +94,9 @@ struct worker_thread {
 	uint64_t			xfer_failed;
 	uint64_t			injected_miscompares;
 	uint64_t			current_queue_depth;
+	uint64_t			lat_total_tsc;
+	uint64_t			lat_min_tsc;
+	uint64_t			lat_max_tsc;
 	TAILQ_HEAD(, ap_task)		tasks_pool;
 	struct worker_thread		*next;
 	unsigned			core;
@@ -128,7 +133,8 @@ dump_user_config(struct spdk_app_opts *opts)
 	printf("Allocate depth: %u\n", g_allocate_depth);
 	printf("# threads/core: %u\n", g_threads_per_core);
 	printf("Run time:       %u seconds\n", g_time_in_sec);
-	printf("Verify:         %s\n\n", g_verify ? "Yes" : "No");
+	printf("Verify:         %s\n", g_verify ? "Yes" : "No");
+	printf("SW completion:  %s\n\n", g_sw_inline_completion ? "Inline" : "Deferred");
 }
 
 static void
@@ -147,6 +153,7 @@ usage(void)
 	printf("\t[-P for compare workload, percentage of operations that should miscompare (percent, default 0)\n");
 	printf("\t[-f for fill workload, use this BYTE value (default 255)\n");
 	printf("\t[-y verify result if this switch is on]\n");
+	printf("\t[-I drain software engine completions inline within the same poll]\n");
 	printf("\t[-a tasks to allocate per core (default: same value as -q)]\n");
 	printf("\t\tCan be used to spread operations across a wider range of memory.\n");
 }
@@ -208,6 +215,9 @@ parse_args(int argc, char *argv)
 	case 'y':
 		g_verify = true;
 		break;
+	case 'I':
+		g_sw_inline_completion = true;
+		break;
 	case 'w':
 		g_workload_type = optarg;
 		if (!strcmp(g_workload_type, "copy")) {
@@ -353,6 +363,7 @@ _submit_single(struct worker_thread *worker, struct ap_task *task)
 
 	assert(worker);
 
+	task->submit_tsc = spdk_get_ticks();
 	switch (g_workload_selection) {
 	case ACCEL_COPY:
 		rc = spdk_accel_submit_copy(worker->ch, task->dst, task->src,
@@ -451,10 +462,16 @@ accel_done(void *arg1, int status)
 	struct ap_task *task = arg1;
 	struct worker_thread *worker = task->worker;
 	uint32_t sw_crc32c;
+	uint64_t lat_tsc;
 
 	assert(worker);
 	assert(worker->current_queue_depth > 0);
 
+	lat_tsc = spdk_get_ticks() - task->submit_tsc;
+	worker->lat_total_tsc += lat_tsc;
+	worker->lat_min_tsc = spdk_min(worker->lat_min_tsc, lat_tsc);
+	worker->lat_max_tsc = spdk_max(worker->lat_max_tsc, lat_tsc);
+
 	if (g_verify && status == 0) {
 		switch (g_workload_selection) {
 		case ACCEL_COPY_CRC32C:
@@ -533,6 +550,7 @@ dump_result(void)
 	uint64_t total_failed = 0;
 	uint64_t total_miscompared = 0;
 	uint64_t total_xfer_per_sec, total_bw_in_MiBps;
+	uint64_t total_lat_tsc = 0, min_lat_tsc = UINT64_MAX, max_lat_tsc = 0;
 	struct worker_thread *worker = g_workers;
 
 	printf("\nCore,Thread   Transfers     Bandwidth     Failed     Miscompares\n");
@@ -564,6 +582,30 @@ dump_result(void)
 	printf("Total:%15" PRIu64 "/s%9" PRIu64 " MiB/s%6" PRIu64 " %11" PRIu64"\n\n",
 	       total_xfer_per_sec, total_bw_in_MiBps, total_failed, total_miscompared);
 
+	printf("Core,Thread   Average latency (us)   min (us)     max (us)\n");
+	printf("------------------------------------------------------------------------\n");
+	for (worker = g_workers; worker != NULL; worker = worker->next) {
+		if (worker->xfer_completed == 0) {
+			continue;
+		}
+
+		printf("%u,%u%22.2f %12.2f %12.2f\n", worker->display.core, worker->display.thread,
+		       (double)worker->lat_total_tsc * 1000000 / worker->xfer_completed / g_tsc_rate,
+		       (double)worker->lat_min_tsc * 1000000 / g_tsc_rate,
+		       (double)worker->lat_max_tsc * 1000000 / g_tsc_rate);
+		total_lat_tsc += worker->lat_total_tsc;
+		min_lat_tsc = spdk_min(min_lat_tsc, worker->lat_min_tsc);
+		max_lat_tsc = spdk_max(max_lat_tsc, worker->lat_max_tsc);
+	}
+
+	if (total_completed) {
+		printf("=========================================================================\n");
+		printf("Total:%21.2f %12.2f %12.2f\n\n",
+		       (double)total_lat_tsc * 1000000 / total_completed / g_tsc_rate,
+		       (double)min_lat_tsc * 1000000 / g_tsc_rate,
+		       (double)max_lat_tsc * 1000000 / g_tsc_rate);
+	}
+
 	return total_failed ? 1 : 0;
 }
 
@@ -637,6 +679,7 @@ _init_thread(void *arg1)
 	g_workers = worker;
 	pthread_mutex_unlock(&g_workers_lock);
 	worker->ch = spdk_accel_engine_get_io_channel();
+	worker->lat_min_tsc = UINT64_MAX;
 
 	TAILQ_INIT(&worker->tasks_pool);
 
@@ -707,9 +750,18 @@ accel_perf_start(void *arg1)
 	int j;
 	struct spdk_thread *thread;
 	struct display_info *display;
+	struct spdk_accel_opts accel_opts;
 
 	identify_accel_engine_usage();
 
+	spdk_accel_get_opts(&accel_opts, sizeof(accel_opts));
+	accel_opts.sw_inline_completion = g_sw_inline_completion;
+	if (spdk_accel_set_opts(&accel_opts)) {
+		fprintf(stderr, "Unable to set accel options\n");
+		spdk_app_stop(-1);
+		return;
+	}
+
 	g_tsc_rate = spdk_get_ticks_hz();
 	g_tsc_end = spdk_get_ticks() + g_time_in_sec * g_tsc_rate;
 
@@ -745,7 +797,7 @@ main(int argc, char **argv)
 	pthread_mutex_init(&g_workers_lock, NULL);
 	spdk_app_opts_init(&opts, sizeof(opts));
 	opts.reactor_mask = "0x1";
-	if (spdk_app_parse_args(argc, argv, &opts, "a:C:o:q:t:yw:P:f:T:", NULL, parse_args,
+	if (spdk_app_parse_args(argc, argv, &opts, "a:C:o:q:t:yw:P:f:T:I", NULL, parse_args,
 				usage) != SPDK_APP_PARSE_ARGS_SUCCESS) {
 		g_rc = -1;
 		goto cleanup;
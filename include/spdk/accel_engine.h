@@ -52,6 +52,38 @@ enum accel_capability {
 	ACCEL_CRC32C		= 1 << 4,
 	ACCEL_DIF		= 1 << 5,
 	ACCEL_COPY_CRC32C	= 1 << 6,
+	ACCEL_XOR		= 1 << 7,
+	ACCEL_PQ_GEN		= 1 << 8,
+	ACCEL_COMPRESS		= 1 << 9,
+	ACCEL_DECOMPRESS	= 1 << 10,
+};
+
+/**
+ * Accel framework options.
+ */
+struct spdk_accel_opts {
+	/**
+	 * The size of spdk_accel_opts according to the caller of this library is used for ABI
+	 * compatibility.  The library uses this field to know how many fields in this
+	 * structure are valid. And the library will populate any remaining fields with default values.
+	 * New added fields should be put at the end of the struct.
+	 */
+	size_t opts_size;
+
+	/**
+	 * Software engine completions are never called on the submitter's stack; they are
+	 * queued and called from a per-channel poller. When this is set, the poller keeps
+	 * draining completions queued by the callbacks it has just called, so an operation
+	 * resubmitted from a completion callback completes in the same poll instead of the
+	 * next one. Disabled by default.
+	 */
+	bool sw_inline_completion;
+
+	/**
+	 * Maximum number of software completions called by one poll when
+	 * sw_inline_completion is set, so a busy channel cannot starve other pollers.
+	 */
+	uint32_t sw_inline_completion_budget;
 };
 
 /**
@@ -84,6 +116,40 @@ int spdk_accel_engine_initialize(void);
  */
 void spdk_accel_engine_finish(spdk_accel_fini_cb cb_fn, void *cb_arg);
 
+/**
+ * Get the accel framework options.
+ *
+ * \param opts Pointer to the options to be filled in.
+ * \param opts_size sizeof(struct spdk_accel_opts) according to the caller.
+ */
+void spdk_accel_get_opts(struct spdk_accel_opts *opts, size_t opts_size);
+
+/**
+ * Set the accel framework options. The new options take effect on the next
+ * poll of every channel.
+ *
+ * \param opts Options to apply.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_set_opts(const struct spdk_accel_opts *opts);
+
+/**
+ * Set the smallest operation of a given type submitted to the hardware engine.
+ * Smaller operations are done in software, where submitting them to the
+ * hardware would cost more than doing them on the core. Operations submitted
+ * as part of a batch that the hardware engine executes as a whole are not
+ * affected.
+ *
+ * \param capability Type of the operation, a single ACCEL_* capability.
+ * \param min_bytes Smallest size, in bytes, of the operations submitted to the
+ * hardware engine. 0, the default, submits all of them.
+ *
+ * \return 0 on success, -EINVAL if the capability doesn't designate a single
+ * operation type.
+ */
+int spdk_accel_set_hw_threshold(enum accel_capability capability, uint64_t min_bytes);
+
 /**
  * Close the acceleration engine module and perform any necessary cleanup.
  */
@@ -246,6 +312,278 @@ int spdk_accel_submit_copy_crc32c(struct spdk_io_channel *ch, void *dst, void *s
 int spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iovec *src_iovs,
 				   uint32_t iovcnt, uint32_t *crc_dst, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/**
+ * Submit an XOR request.
+ *
+ * This operation will XOR all of the source buffers together and write the
+ * result to the destination. If the engine doesn't report ACCEL_XOR, the
+ * operation is done in software.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst Destination to write the result to. Must not overlap any source,
+ * except that it may be the same as the first one.
+ * \param sources Array of source buffers. The array must remain valid until
+ * the operation completes.
+ * \param nsrcs Number of source buffers, at least 2.
+ * \param nbytes Length in bytes of each buffer.
+ * \param cb_fn Called when this XOR operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
+			  uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a RAID6 P+Q parity generation request.
+ *
+ * This operation will generate the P (XOR) and Q (GF(2^8) Reed-Solomon
+ * syndrome, polynomial 0x11d) parity of the source buffers, as used by RAID6.
+ * If the engine doesn't report ACCEL_PQ_GEN, the operation is done in software.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param p Destination to write the P parity to. Must not overlap the sources.
+ * \param q Destination to write the Q parity to. Must not overlap the sources.
+ * \param sources Array of source buffers. The array must remain valid until
+ * the operation completes.
+ * \param nsrcs Number of source buffers, at least 2.
+ * \param nbytes Length in bytes of each buffer.
+ * \param cb_fn Called when this P+Q operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_pq_gen(struct spdk_io_channel *ch, void *p, void *q, void **sources,
+			     uint32_t nsrcs, uint64_t nbytes,
+			     spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a compression request.
+ *
+ * This operation will compress the source buffers into the destination buffers
+ * as a raw DEFLATE (RFC 1951) stream. If the engine doesn't report ACCEL_COMPRESS,
+ * the operation is done in software with ISA-L igzip, which requires SPDK to be
+ * built with ISA-L.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs Destination buffers. The array must remain valid until the
+ * operation completes.
+ * \param dst_iovcnt Number of destination buffers.
+ * \param src_iovs Source buffers. The array must remain valid until the
+ * operation completes.
+ * \param src_iovcnt Number of source buffers.
+ * \param output_size Filled with the size in bytes of the compressed data when
+ * the operation completes successfully. May be NULL.
+ * \param cb_fn Called when this compress operation completes, with -ENOSPC if
+ * the compressed data doesn't fit in the destination buffers.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, -ENOTSUP if compression is not available, negative errno
+ * on other failures.
+ */
+int spdk_accel_submit_compress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+			       uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+			       uint32_t *output_size, spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Submit a decompression request.
+ *
+ * This operation will decompress a raw DEFLATE (RFC 1951) stream from the source
+ * buffers into the destination buffers. If the engine doesn't report
+ * ACCEL_DECOMPRESS, the operation is done in software with ISA-L igzip, which
+ * requires SPDK to be built with ISA-L.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param dst_iovs Destination buffers. The array must remain valid until the
+ * operation completes.
+ * \param dst_iovcnt Number of destination buffers.
+ * \param src_iovs Source buffers. The array must remain valid until the
+ * operation completes.
+ * \param src_iovcnt Number of source buffers.
+ * \param output_size Filled with the size in bytes of the decompressed data when
+ * the operation completes successfully. May be NULL.
+ * \param cb_fn Called when this decompress operation completes, with -ENOSPC if
+ * the decompressed data doesn't fit in the destination buffers or -EIO if the
+ * source is not a valid, complete stream.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, -ENOTSUP if decompression is not available, negative
+ * errno on other failures.
+ */
+int spdk_accel_submit_decompress(struct spdk_io_channel *ch, struct iovec *dst_iovs,
+				 uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+				 uint32_t *output_size, spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Opaque handle for a batch of accel operations.
+ *
+ * The operations of a batch are executed in the order they were prepared, each
+ * one after the previous one completed, so that an operation can consume the
+ * result of the one before it (e.g. copy, then CRC-32C of the copy). If an
+ * operation fails, the following ones are not executed and complete with
+ * -ECANCELED. A miscompare is not considered a failure.
+ */
+struct spdk_accel_batch;
+
+/**
+ * Get the maximum number of operations in a batch.
+ *
+ * \param ch I/O channel associated with this call.
+ *
+ * \return max number of operations that can be prepared into a batch.
+ */
+uint32_t spdk_accel_batch_get_max(struct spdk_io_channel *ch);
+
+/**
+ * Create a batch of accel operations.
+ *
+ * \param ch I/O channel associated with this call.
+ *
+ * \return handle to use for subsequent batch requests, NULL if no batch is
+ * available on this channel.
+ */
+struct spdk_accel_batch *spdk_accel_batch_create(struct spdk_io_channel *ch);
+
+/**
+ * Submit a batch of accel operations.
+ *
+ * The callback of each operation is called when it completes, followed by the
+ * callback of the batch once all of them completed.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param cb_fn Called when all operations of the batch completed, with the status
+ * of the first failed operation, or 0.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_submit(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			    spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Cancel a batch that was not submitted. None of its operations are executed
+ * and their callbacks are not called.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_cancel(struct spdk_io_channel *ch, struct spdk_accel_batch *batch);
+
+/**
+ * Prepare a copy request into a batch. See spdk_accel_submit_copy() for the
+ * parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param dst Destination to copy to.
+ * \param src Source to copy from.
+ * \param nbytes Length in bytes to copy.
+ * \param cb_fn Called when this copy operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_copy(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			       void *dst, void *src, uint64_t nbytes,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Prepare a dual cast copy request into a batch. See spdk_accel_submit_dualcast()
+ * for the parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param dst1 First destination to copy to (must be 4K aligned).
+ * \param dst2 Second destination to copy to (must be 4K aligned).
+ * \param src Source to copy from.
+ * \param nbytes Length in bytes to copy.
+ * \param cb_fn Called when this copy operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_dualcast(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+				   void *dst1, void *dst2, void *src, uint64_t nbytes,
+				   spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Prepare a compare request into a batch. See spdk_accel_submit_compare() for
+ * the parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param src1 First location to perform compare on.
+ * \param src2 Second location to perform compare on.
+ * \param nbytes Length in bytes to compare.
+ * \param cb_fn Called when this compare operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_compare(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+				  void *src1, void *src2, uint64_t nbytes,
+				  spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Prepare a fill request into a batch. See spdk_accel_submit_fill() for the
+ * parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param dst Destination to fill.
+ * \param fill Constant byte to fill to the destination.
+ * \param nbytes Length in bytes to fill.
+ * \param cb_fn Called when this fill operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_fill(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			       void *dst, uint8_t fill, uint64_t nbytes,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Prepare a CRC-32C calculation request into a batch. See spdk_accel_submit_crc32c()
+ * for the parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param crc_dst Destination to write the CRC-32C to.
+ * \param src The source address for the data.
+ * \param seed Four byte seed value.
+ * \param nbytes Length in bytes.
+ * \param cb_fn Called when this CRC-32C operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_crc32c(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+				 uint32_t *crc_dst, void *src, uint32_t seed, uint64_t nbytes,
+				 spdk_accel_completion_cb cb_fn, void *cb_arg);
+
+/**
+ * Prepare a copy with CRC-32C calculation request into a batch. See
+ * spdk_accel_submit_copy_crc32c() for the parameters.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param batch Handle provided when the batch was created with spdk_accel_batch_create().
+ * \param dst Destination to write the data to.
+ * \param src The source address for the data.
+ * \param crc_dst Destination to write the CRC-32C to.
+ * \param seed Four byte seed value.
+ * \param nbytes Length in bytes.
+ * \param cb_fn Called when this operation completes, may be NULL.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_batch_prep_copy_crc32c(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+				      void *dst, void *src, uint32_t *crc_dst, uint32_t seed,
+				      uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg);
+
 
 struct spdk_json_write_ctx;
 
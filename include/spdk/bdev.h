@@ -141,6 +141,7 @@ enum spdk_bdev_io_type {
 	SPDK_BDEV_IO_TYPE_COMPARE,
 	SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE,
 	SPDK_BDEV_IO_TYPE_ABORT,
+	SPDK_BDEV_IO_TYPE_COPY,
 	SPDK_BDEV_NUM_IO_TYPES /* Keep last */
 };
 
@@ -182,6 +183,9 @@ struct spdk_bdev_io_stat {
 	uint64_t write_latency_ticks;
 	uint64_t unmap_latency_ticks;
 	uint64_t ticks_rate;
+	uint64_t bytes_copied;
+	uint64_t num_copy_ops;
+	uint64_t copy_latency_ticks;
 };
 
 struct spdk_bdev_opts {
@@ -198,6 +202,43 @@ struct spdk_bdev_opts {
 
 	uint32_t small_buf_pool_size;
 	uint32_t large_buf_pool_size;
+
+	/**
+	 * The bdev_io and data buffer pools are split into one pool per NUMA node with SPDK
+	 * cores, and threads take from the pools of the node their core belongs to.  These set
+	 * the size of the pools of each node.  When 0, the sizes above are divided evenly among
+	 * the nodes instead.
+	 */
+	uint32_t bdev_io_pool_size_per_socket;
+	uint32_t small_buf_pool_size_per_socket;
+	uint32_t large_buf_pool_size_per_socket;
+
+	/**
+	 * If set to false, a single set of pools sized by the totals above is shared by all NUMA
+	 * nodes and the per node sizes are ignored.  True by default.
+	 */
+	bool numa_pools;
+};
+
+/**
+ * Usage of the bdev_io and data buffer pools of one NUMA node.
+ */
+struct spdk_bdev_pool_stats {
+	/** Socket ID of the NUMA node, SPDK_ENV_SOCKET_ID_ANY if the pools aren't split. */
+	uint32_t socket_id;
+
+	uint32_t bdev_io_pool_size;
+	uint32_t bdev_io_pool_free;
+	uint32_t small_buf_pool_size;
+	uint32_t small_buf_pool_free;
+	uint32_t large_buf_pool_size;
+	uint32_t large_buf_pool_free;
+
+	/** bdev_ios taken from these pools by threads running on another node. */
+	uint64_t remote_bdev_io_allocs;
+
+	/** Data buffers taken from these pools by threads running on another node. */
+	uint64_t remote_buf_allocs;
 };
 
 /**
@@ -228,6 +269,15 @@ void spdk_bdev_get_opts(struct spdk_bdev_opts *opts, size_t opts_size);
 
 int spdk_bdev_set_opts(struct spdk_bdev_opts *opts);
 
+/**
+ * Get the usage of the bdev_io and data buffer pools, one entry per NUMA node.
+ *
+ * \param stats Array filled with the usage of the pools of each node.
+ * \param max_stats Number of entries in stats.
+ * \return Number of NUMA nodes with pools, which can be larger than max_stats.
+ */
+uint32_t spdk_bdev_get_pool_stats(struct spdk_bdev_pool_stats *stats, uint32_t max_stats);
+
 typedef void (*spdk_bdev_wait_for_examine_cb)(void *arg);
 
 /**
@@ -468,6 +518,17 @@ uint32_t spdk_bdev_get_block_size(const struct spdk_bdev *bdev);
  */
 uint32_t spdk_bdev_get_write_unit_size(const struct spdk_bdev *bdev);
 
+/**
+ * Get the maximum number of blocks which a single copy request can copy.
+ *
+ * Larger copy requests are split by the bdev layer.
+ *
+ * \param bdev Block device to query.
+ *
+ * \return The maximum copy size in logical blocks, or 0 if it is unlimited.
+ */
+uint32_t spdk_bdev_get_max_copy(const struct spdk_bdev *bdev);
+
 /**
  * Get size of block device in logical blocks.
  *
@@ -509,6 +570,165 @@ void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 void spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				   void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
 
+/**
+ * Create or update a QoS class on a bdev.
+ *
+ * Each descriptor of the bdev belongs to the class named by
+ * spdk_bdev_desc_set_qos_class(), or to the "default" class, which is created
+ * along with the first class. While the 99th percentile latency of any class with
+ * a latency target is over that target, the classes without a latency target are
+ * throttled to their weighted share of the bdev. Classes with a latency target
+ * are never throttled.
+ *
+ * \param bdev Block device.
+ * \param class_name Name of the class.
+ * \param weight Share of the bdev relative to the other classes. Must not be 0.
+ * \param latency_target_us Target for the 99th percentile latency in microseconds,
+ * or 0 for none.
+ * \param cb_fn Callback function to be called when the class has been set.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_set_qos_class(struct spdk_bdev *bdev, const char *class_name, uint32_t weight,
+			     uint64_t latency_target_us,
+			     void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Delete a QoS class of a bdev.
+ *
+ * The descriptors of the class are no longer accounted to or throttled with any
+ * class. The "default" class can only be deleted after all the other classes.
+ *
+ * \param bdev Block device.
+ * \param class_name Name of the class.
+ * \return 0 on success, -ENOENT if there is no such class, -EBUSY if the "default"
+ * class is deleted while other classes exist.
+ */
+int spdk_bdev_delete_qos_class(struct spdk_bdev *bdev, const char *class_name);
+
+/**
+ * Set the QoS class of a bdev descriptor.
+ *
+ * I/O submitted through the descriptor are accounted to, and throttled with, the
+ * class of that name once it is created by spdk_bdev_set_qos_class().
+ *
+ * \param desc Block device descriptor.
+ * \param class_name Name of the class, or NULL for the "default" class.
+ * \return 0 on success, -ENOMEM if the name could not be copied.
+ */
+int spdk_bdev_desc_set_qos_class(struct spdk_bdev_desc *desc, const char *class_name);
+
+/**
+ * Statistics of a QoS class of a bdev.
+ */
+struct spdk_bdev_qos_class_stat {
+	/** Name of the class. */
+	const char *name;
+
+	/** Share of the bdev relative to the other classes. */
+	uint32_t weight;
+
+	/** Target for the 99th percentile latency in microseconds, 0 if none. */
+	uint64_t latency_target_us;
+
+	/** Whether the 99th percentile latency was over the target in the last window. */
+	bool latency_target_missed;
+
+	/** Current throttling limit in I/O per second, 0 if not throttled. */
+	uint64_t ios_per_sec_limit;
+
+	/** Number of completed I/O. */
+	uint64_t num_ios;
+
+	/** Number of bytes transferred by the completed I/O. */
+	uint64_t bytes;
+
+	/** Sum of the latencies of the completed I/O in tsc ticks. */
+	uint64_t latency_ticks;
+
+	/** Number of completed I/O whose latency was over the target. */
+	uint64_t num_over_latency_target;
+};
+
+typedef void (*spdk_bdev_qos_class_stat_cb)(void *cb_arg,
+		const struct spdk_bdev_qos_class_stat *stat);
+
+/**
+ * Get the statistics of the QoS classes of a bdev.
+ *
+ * \param bdev Block device to query.
+ * \param cb_fn Called synchronously once for each class.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_get_qos_class_stats(struct spdk_bdev *bdev, spdk_bdev_qos_class_stat_cb cb_fn,
+				   void *cb_arg);
+
+/**
+ * Set a label identifying the user of a bdev descriptor, e.g. the host or controller
+ * the descriptor serves, in the per descriptor statistics.
+ *
+ * \param desc Block device descriptor.
+ * \param label Label to set, or NULL to clear it.
+ * \return 0 on success, -ENOMEM if the label could not be copied.
+ */
+int spdk_bdev_desc_set_label(struct spdk_bdev_desc *desc, const char *label);
+
+/**
+ * I/O statistics of a bdev descriptor.
+ */
+struct spdk_bdev_desc_stat {
+	/** Identifier of the descriptor, unique for the lifetime of the application. */
+	uint64_t id;
+
+	/** Label set by spdk_bdev_desc_set_label(), NULL if none. */
+	const char *label;
+
+	/** Statistics of the I/O completed since the statistics were enabled. */
+	struct spdk_bdev_io_stat stat;
+
+	/** Number of I/O submitted through the descriptor and not completed yet. */
+	uint64_t io_outstanding;
+
+	/** Read, write and unmap operations completed since the previous query. */
+	uint64_t interval_ops;
+
+	/** Bytes read and written since the previous query. */
+	uint64_t interval_bytes;
+
+	/** Length of the interval since the previous query in tsc ticks. */
+	uint64_t interval_ticks;
+};
+
+typedef void (*spdk_bdev_desc_stats_cb)(void *cb_arg, int status,
+					const struct spdk_bdev_desc_stat *stats, uint32_t num_stats);
+
+/**
+ * Enable or disable collecting I/O statistics per descriptor on a bdev.
+ *
+ * The statistics are kept per channel, so collecting them adds no atomic operations
+ * to the I/O path. Enabling the statistics resets them.
+ *
+ * \param bdev Block device.
+ * \param enable Enable/disable flag.
+ * \param cb_fn Callback function to be called when the statistics are enabled or disabled.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_desc_stats_enable(struct spdk_bdev *bdev, bool enable,
+				 void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Get the I/O statistics of the open descriptors of a bdev.
+ *
+ * The statistics of all channels are summed up. Each query starts a new interval for
+ * the interval_* fields of the descriptors it reports.
+ *
+ * \param bdev Block device.
+ * \param cb_fn Callback function to be called with the statistics, one entry per
+ * descriptor. The status is -EINVAL if the statistics are not enabled on the bdev.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_get_desc_stats(struct spdk_bdev *bdev, spdk_bdev_desc_stats_cb cb_fn,
+			      void *cb_arg);
+
 /**
  * Get minimum I/O buffer address alignment for a bdev.
  *
@@ -1396,6 +1616,35 @@ int spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_ch
 				  uint64_t offset_blocks, uint64_t num_blocks,
 				  spdk_bdev_io_completion_cb cb, void *cb_arg);
 
+/**
+ * Submit a copy request to the bdev on the given channel. This copies num_blocks
+ * blocks from src_offset_blocks to dst_offset_blocks within the bdev.
+ *
+ * If the bdev does not support copy natively, the bdev layer emulates it by
+ * reading the data into a buffer and writing it back.
+ *
+ * \ingroup bdev_io_submit_functions
+ *
+ * \param desc Block device descriptor.
+ * \param ch I/O channel. Obtained by calling spdk_bdev_get_io_channel().
+ * \param dst_offset_blocks The destination offset, in blocks, from the start of the block device.
+ * \param src_offset_blocks The source offset, in blocks, from the start of the block device.
+ * \param num_blocks The number of blocks to copy.
+ * \param cb Called when the request is complete.
+ * \param cb_arg Argument passed to cb.
+ *
+ * \return 0 on success. On success, the callback will always
+ * be called (even if the request ultimately failed). Return
+ * negated errno on failure, in which case the callback will not be called.
+ *   * -EINVAL - offsets and/or num_blocks are out of range, or the ranges overlap
+ *   * -ENOMEM - spdk_bdev_io buffer cannot be allocated
+ *   * -EBADF - desc not open for writing
+ *   * -ENOTSUP - the bdev supports neither copy nor both read and write
+ */
+int spdk_bdev_copy_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			  uint64_t dst_offset_blocks, uint64_t src_offset_blocks,
+			  uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg);
+
 /**
  * Submit an unmap request to the block device. Unmap is sometimes also called trim or
  * deallocate. This notifies the device that the data in the blocks described is no
@@ -1820,6 +2069,49 @@ void spdk_bdev_histogram_get(struct spdk_bdev *bdev, struct spdk_histogram_data
 			     spdk_bdev_histogram_data_cb cb_fn,
 			     void *cb_arg);
 
+/** Number of I/O size classes of the per I/O type latency histograms. */
+#define SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES	4
+
+/** Bucket shift of the per I/O type latency histograms. */
+#define SPDK_BDEV_HISTOGRAM_IO_TYPE_BUCKET_SHIFT	5
+
+/**
+ * Latency histograms of a bdev by I/O type and size class.
+ *
+ * Histograms are kept for reads, writes, unmaps and write zeroes. The entries of the other
+ * I/O types are NULL.
+ */
+struct spdk_bdev_io_type_histograms {
+	struct spdk_histogram_data *histogram[SPDK_BDEV_NUM_IO_TYPES][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES];
+};
+
+typedef void (*spdk_bdev_io_type_histograms_cb)(void *cb_arg, int status,
+		const struct spdk_bdev_io_type_histograms *histograms);
+
+/**
+ * Get the largest I/O size of a histogram size class.
+ *
+ * An I/O belongs to the first size class whose limit is not smaller than its size.
+ *
+ * \param size_class Size class, below SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES.
+ *
+ * \return the size limit in bytes, UINT64_MAX for the last size class, or 0 if
+ * size_class is out of range.
+ */
+uint64_t spdk_bdev_histogram_get_size_class_limit(uint32_t size_class);
+
+/**
+ * Get the latency histograms of a bdev by I/O type and size class, aggregated from
+ * all its channels. Histograms must be enabled with spdk_bdev_histogram_enable().
+ *
+ * \param bdev Block device.
+ * \param cb_fn Callback function to be called with the histograms. The histograms are
+ * only valid for the duration of the callback.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_histogram_get_by_io_type(struct spdk_bdev *bdev,
+					spdk_bdev_io_type_histograms_cb cb_fn, void *cb_arg);
+
 /**
  * Retrieves media events.  Can only be called from the context of
  * SPDK_BDEV_EVENT_MEDIA_MANAGEMENT event callback.  These events are sent by
@@ -382,6 +382,9 @@ struct spdk_bdev {
 	/* Maximum write zeroes in unit of logical block */
 	uint32_t max_write_zeroes;
 
+	/* Maximum copy size in unit of logical block, 0 means unlimited */
+	uint32_t max_copy;
+
 	/**
 	 * UUID for this bdev.
 	 *
@@ -476,6 +479,9 @@ struct spdk_bdev {
 		/** True if the state of the QoS is being modified */
 		bool qos_mod_in_progress;
 
+		/** Number of descriptors with an I/O timeout set. Accessed atomically. */
+		uint32_t timeout_desc_count;
+
 		/** Mutex protecting claimed */
 		pthread_mutex_t mutex;
 
@@ -527,6 +533,10 @@ struct spdk_bdev {
 		bool	histogram_enabled;
 		bool	histogram_in_progress;
 
+		/** per descriptor statistics enabled on this bdev */
+		bool	desc_stats_enabled;
+		bool	desc_stats_in_progress;
+
 		/** Currently locked ranges for this bdev.  Used to populate new channels. */
 		lba_range_tailq_t locked_ranges;
 
@@ -565,6 +575,9 @@ typedef void (*spdk_bdev_io_get_aux_buf_cb)(struct spdk_io_channel *ch,
 
 #define BDEV_IO_NUM_CHILD_IOV 32
 
+/** Maximum number of times an I/O can be forwarded by spdk_bdev_io_forward(). */
+#define BDEV_IO_MAX_FORWARD_DEPTH 4
+
 struct spdk_bdev_io {
 	/** The block device that this I/O belongs to. */
 	struct spdk_bdev *bdev;
@@ -629,6 +642,13 @@ struct spdk_bdev_io {
 				uint8_t start : 1;
 			} zcopy;
 
+			struct {
+				/** Starting source offset (in blocks) of the bdev for copy I/O.
+				 *  offset_blocks is the destination offset.
+				 */
+				uint64_t src_offset_blocks;
+			} copy;
+
 			struct {
 				/** The callback argument for the outstanding request which this abort
 				 *  attempts to cancel.
@@ -686,9 +706,6 @@ struct spdk_bdev_io {
 		/** The bdev I/O channel that this was handled on. */
 		struct spdk_bdev_channel *ch;
 
-		/** The bdev I/O channel that this was submitted on. */
-		struct spdk_bdev_channel *io_submit_ch;
-
 		/** The bdev descriptor that was used when submitting this I/O. */
 		struct spdk_bdev_desc *desc;
 
@@ -734,9 +751,17 @@ struct spdk_bdev_io {
 		 */
 		bool in_submit_request;
 
+		/** Set when the I/O is accounted to the per descriptor statistics of its channel. */
+		bool desc_stat_tracked;
+
 		/** Status for the IO */
 		int8_t status;
 
+		/** NUMA node whose pools this bdev_io, its buffer and its aux buffer were taken from */
+		uint8_t pool_idx;
+		uint8_t buf_pool_idx;
+		uint8_t aux_buf_pool_idx;
+
 		/** bdev allocated memory associated with this request */
 		void *buf;
 
@@ -769,6 +794,15 @@ struct spdk_bdev_io {
 
 		/** Pointer to a structure passed by the user in ext API */
 		struct spdk_bdev_ext_io_opts *ext_opts;
+
+		/** The bdev I/O channels this was forwarded to, in order. */
+		struct spdk_bdev_channel *fwd_ch[BDEV_IO_MAX_FORWARD_DEPTH];
+
+		/** Number of valid entries in fwd_ch, 0 if the I/O wasn't forwarded. */
+		uint8_t fwd_depth;
+
+		/** Offset of the I/O before it was forwarded. */
+		uint64_t fwd_offset_blocks;
 	} internal;
 
 	/**
@@ -1010,6 +1044,35 @@ struct spdk_thread *spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io);
  */
 struct spdk_io_channel *spdk_bdev_io_get_io_channel(struct spdk_bdev_io *bdev_io);
 
+/**
+ * Forward an I/O to another bdev, at a different offset.
+ *
+ * Rather than submitting a new child I/O, the bdev_io itself is rewritten and passed
+ * directly to the module of the bdev opened by desc, bypassing the generic bdev layer
+ * of that bdev. This is meant for virtual bdevs that only remap the offset of the I/O.
+ * The bdev and offset of the I/O are restored when it is completed, before the
+ * completion callback of the original submitter is called.
+ *
+ * Only reads, writes, unmaps, write zeroes and flushes can be forwarded, and only when
+ * the generic bdev layer of the target bdev has nothing to do with the I/O: no QoS,
+ * histograms, per descriptor statistics, I/O timeouts, locked LBA ranges, reset in progress,
+ * queued I/O or splitting. An I/O can be forwarded at most BDEV_IO_MAX_FORWARD_DEPTH times.
+ * Forwarded I/O is accounted in the outstanding I/O and I/O statistics of the channel of
+ * every bdev it was forwarded to.
+ *
+ * \param bdev_io I/O to forward.
+ * \param desc Descriptor of the bdev to forward the I/O to.
+ * \param ch I/O channel of desc, on the thread of bdev_io.
+ * \param offset_blocks Offset of the I/O on the target bdev.
+ *
+ * \return 0 if the I/O was forwarded. It will be completed like any other I/O.
+ * \return -ENOTSUP if the I/O can't be forwarded and must be submitted as a new I/O.
+ * \return -EINVAL if the I/O is beyond the end of the target bdev.
+ * \return -EBADF if desc was not opened for writing and the I/O writes.
+ */
+int spdk_bdev_io_forward(struct spdk_bdev_io *bdev_io, struct spdk_bdev_desc *desc,
+			 struct spdk_io_channel *ch, uint64_t offset_blocks);
+
 /**
  * Resize for a bdev.
  *
@@ -1283,6 +1346,53 @@ int spdk_bdev_push_media_events(struct spdk_bdev *bdev, const struct spdk_bdev_m
  */
 void spdk_bdev_notify_media_management(struct spdk_bdev *bdev);
 
+/**
+ * Block device LBA range lock completion callback.
+ *
+ * \param cb_arg Callback argument specified when the range was locked or unlocked.
+ * \param status 0 on success, negative errno on failure.
+ */
+typedef void (*spdk_bdev_lba_range_lock_cb)(void *cb_arg, int status);
+
+/**
+ * Lock a range of blocks of a bdev. New writes to the range submitted by anyone
+ * else are queued until the range is unlocked and the callback is called once
+ * all the writes to the range in progress have completed. Writes submitted on
+ * the locking channel with cb_arg as their own callback argument can still be
+ * executed, reads are not affected.
+ *
+ * Must be called on the thread of the channel.
+ *
+ * \param desc Block device descriptor.
+ * \param ch I/O channel of the locking thread.
+ * \param offset_blocks The offset, in blocks, from the start of the block device.
+ * \param num_blocks The number of blocks to lock.
+ * \param cb_fn Called when the range is locked.
+ * \param cb_arg Argument passed to cb_fn, identifies the lock owner. Must not be NULL.
+ *
+ * \return 0 if the lock was requested, negative errno on failure.
+ */
+int spdk_bdev_lock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			     uint64_t offset_blocks, uint64_t num_blocks,
+			     spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg);
+
+/**
+ * Unlock a range of blocks locked with spdk_bdev_lock_lba_range(). The range,
+ * channel and cb_arg must match the ones used to lock it.
+ *
+ * \param desc Block device descriptor.
+ * \param ch I/O channel the range was locked with.
+ * \param offset_blocks The offset, in blocks, from the start of the block device.
+ * \param num_blocks The number of blocks to unlock.
+ * \param cb_fn Called when the range is unlocked.
+ * \param cb_arg Argument the range was locked with, passed to cb_fn.
+ *
+ * \return 0 if the unlock was requested, negative errno on failure.
+ */
+int spdk_bdev_unlock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			       uint64_t offset_blocks, uint64_t num_blocks,
+			       spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg);
+
 /*
  *  Macro used to register module for later initialization.
  */
@@ -76,6 +76,18 @@ uint32_t spdk_crc32c_update(const void *buf, size_t len, uint32_t crc);
  */
 uint32_t spdk_crc32c_iov_update(struct iovec *iov, int iovcnt, uint32_t crc32c);
 
+/**
+ * Calculate partial CRC-32C checksums of several independent buffers at once.
+ *
+ * Where the CPU allows it, the buffers are processed in an interleaved fashion,
+ * which is faster than calling spdk_crc32c_update() on each of them in turn.
+ *
+ * \param iovs Data buffers to checksum, one checksum per element.
+ * \param crcs Array of count previous CRC-32C values, updated in place.
+ * \param count Number of elements in iovs and crcs.
+ */
+void spdk_crc32c_update_multi(const struct iovec *iovs, uint32_t *crcs, int count);
+
 #ifdef __cplusplus
 }
 #endif
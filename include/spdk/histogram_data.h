@@ -207,6 +207,55 @@ spdk_histogram_data_iterate(const struct spdk_histogram_data *histogram,
 	}
 }
 
+/**
+ * Get the datapoint value under which the given percentage of the datapoints fall.
+ *
+ * The value returned is the upper bound of the bucket holding that datapoint, so it
+ * overestimates the exact value by less than the width of the bucket.
+ *
+ * \param histogram Histogram to look at.
+ * \param percentile Percentage of the datapoints, between 0 and 100.
+ *
+ * \return the value at the percentile, or 0 if the histogram is empty.
+ */
+static inline uint64_t
+spdk_histogram_data_get_percentile(const struct spdk_histogram_data *histogram,
+				   double percentile)
+{
+	uint64_t i, j, so_far, total, target;
+
+	total = 0;
+
+	for (i = 0; i < SPDK_HISTOGRAM_NUM_BUCKET_RANGES(histogram); i++) {
+		for (j = 0; j < SPDK_HISTOGRAM_NUM_BUCKETS_PER_RANGE(histogram); j++) {
+			total += __spdk_histogram_get_count(histogram, i, j);
+		}
+	}
+
+	if (total == 0) {
+		return 0;
+	}
+
+	target = (uint64_t)(total * percentile / 100);
+	if ((double)target < total * percentile / 100 || target == 0) {
+		target++;
+	}
+
+	so_far = 0;
+
+	for (i = 0; i < SPDK_HISTOGRAM_NUM_BUCKET_RANGES(histogram); i++) {
+		for (j = 0; j < SPDK_HISTOGRAM_NUM_BUCKETS_PER_RANGE(histogram); j++) {
+			so_far += __spdk_histogram_get_count(histogram, i, j);
+			if (so_far >= target) {
+				/* The start of the next bucket wraps to 0 for the last one. */
+				return __spdk_histogram_data_get_bucket_start(histogram, i, j) - 1;
+			}
+		}
+	}
+
+	return UINT64_MAX;
+}
+
 static inline void
 spdk_histogram_data_merge(const struct spdk_histogram_data *dst,
 			  const struct spdk_histogram_data *src)
@@ -148,6 +148,10 @@ struct idxd_batch *spdk_idxd_batch_create(struct spdk_idxd_io_channel *chan);
 /**
  * Submit a batch sequence.
  *
+ * The requests of the batch are executed in the order they were prepared. If
+ * one of them fails, the following ones are not executed and their callbacks
+ * are called with -ECANCELED.
+ *
  * \param chan IDXD channel to submit request.
  * \param batch Handle provided when the batch was started with spdk_idxd_batch_create().
  * \param cb_fn Callback function which will be called when the request is complete.
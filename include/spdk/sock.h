@@ -328,6 +328,23 @@ void spdk_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *re
  */
 ssize_t spdk_sock_readv(struct spdk_sock *sock, struct iovec *iov, int iovcnt);
 
+/**
+ * Read message from the given socket to the I/O vector array without reading ahead.
+ *
+ * Data already buffered by the socket is returned first. Otherwise the data is read
+ * directly into the I/O vector array, and no more than its length is taken from the
+ * kernel. This lets the caller read a header without pulling the payload following it
+ * into the receive buffer of the socket, so that the payload can be read directly into
+ * its destination buffers too.
+ *
+ * \param sock Socket to receive message.
+ * \param iov I/O vector.
+ * \param iovcnt Number of I/O vectors in the array.
+ *
+ * \return the length of the received message on success, -1 on failure.
+ */
+ssize_t spdk_sock_readv_direct(struct spdk_sock *sock, struct iovec *iov, int iovcnt);
+
 /**
  * Set the value used to specify the low water mark (in bytes) for this socket.
  *
@@ -0,0 +1,88 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * XOR and RAID6 P+Q parity utility functions
+ */
+
+#ifndef SPDK_XOR_H
+#define SPDK_XOR_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Generate XOR from multiple source buffers.
+ *
+ * \param dest Destination buffer. May be the same as one of the sources.
+ * \param sources Array of source buffers.
+ * \param n Number of source buffers in the \p sources array.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_xor_gen(void *dest, void **sources, uint32_t n, size_t len);
+
+/**
+ * Generate RAID6 P and Q parity from multiple source buffers.
+ *
+ * P is the XOR of the sources and Q is their sum in GF(2^8), with polynomial
+ * 0x11d, where source i is multiplied by 2^i.
+ *
+ * \param p Destination buffer for the P parity. Must not overlap the sources.
+ * \param q Destination buffer for the Q parity. Must not overlap the sources.
+ * \param sources Array of source buffers.
+ * \param n Number of source buffers in the \p sources array.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_pq_gen(void *p, void *q, void **sources, uint32_t n, size_t len);
+
+/**
+ * Get the optimal buffer alignment for XOR functions.
+ *
+ * Buffers that are aligned to this value and whose length is a multiple of it
+ * are processed with the fastest available implementation.
+ *
+ * \return The optimal buffer alignment in bytes.
+ */
+size_t spdk_xor_get_optimal_alignment(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPDK_XOR_H */
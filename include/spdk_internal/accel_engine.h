@@ -42,6 +42,34 @@
 struct spdk_accel_task;
 
 void spdk_accel_task_complete(struct spdk_accel_task *task, int status);
+void spdk_accel_batch_complete(struct spdk_accel_batch *batch, int status);
+
+enum accel_opcode {
+	ACCEL_OPCODE_MEMMOVE		= 0,
+	ACCEL_OPCODE_MEMFILL		= 1,
+	ACCEL_OPCODE_COMPARE		= 2,
+	ACCEL_OPCODE_BATCH		= 3,
+	ACCEL_OPCODE_CRC32C		= 4,
+	ACCEL_OPCODE_DUALCAST		= 5,
+	ACCEL_OPCODE_COPY_CRC32C	= 6,
+	ACCEL_OPCODE_XOR		= 7,
+	ACCEL_OPCODE_PQ_GEN		= 8,
+	ACCEL_OPCODE_COMPRESS		= 9,
+	ACCEL_OPCODE_DECOMPRESS		= 10,
+	ACCEL_OPCODE_LAST,
+};
+
+/* Where an operation was executed: in software, or by the channel's engine. */
+enum accel_engine_path {
+	ACCEL_PATH_SW,
+	ACCEL_PATH_HW,
+	ACCEL_PATH_LAST,
+};
+
+struct accel_op_stats {
+	uint64_t	num_ops;
+	uint64_t	num_bytes;
+};
 
 struct accel_io_channel {
 	struct spdk_accel_engine	*engine;
@@ -49,21 +77,21 @@ struct accel_io_channel {
 	struct spdk_io_channel		*sw_engine_ch;
 	void				*task_pool_base;
 	TAILQ_HEAD(, spdk_accel_task)	task_pool;
+	void				*batch_pool_base;
+	TAILQ_HEAD(, spdk_accel_batch)	batch_pool;
+	struct accel_op_stats		stats[ACCEL_PATH_LAST][ACCEL_OPCODE_LAST];
 };
 
+struct isal_zstream;
+struct inflate_state;
+
 struct sw_accel_io_channel {
 	struct spdk_poller		*completion_poller;
 	TAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
-};
-
-enum accel_opcode {
-	ACCEL_OPCODE_MEMMOVE		= 0,
-	ACCEL_OPCODE_MEMFILL		= 1,
-	ACCEL_OPCODE_COMPARE		= 2,
-	ACCEL_OPCODE_BATCH		= 3,
-	ACCEL_OPCODE_CRC32C		= 4,
-	ACCEL_OPCODE_DUALCAST		= 5,
-	ACCEL_OPCODE_COPY_CRC32C	= 6,
+	TAILQ_HEAD(, spdk_accel_batch)	batches_to_process;
+	/* ISA-L igzip state, only allocated when built with ISA-L. */
+	struct isal_zstream		*deflate_stream;
+	struct inflate_state		*inflate_state;
 };
 
 struct spdk_accel_task {
@@ -79,29 +107,68 @@ struct spdk_accel_task {
 			struct iovec		*iovs; /* iovs passed by the caller */
 			uint32_t		iovcnt; /* iovcnt passed by the caller */
 		} v;
+		struct {
+			void			**srcs; /* source buffers passed by the caller */
+			uint32_t		cnt; /* number of source buffers */
+		} nsrcs;
 		void				*src;
 	};
 	union {
 		void			*dst;
 		void			*src2;
+		struct {
+			struct iovec	*iovs; /* destination iovs passed by the caller */
+			uint32_t	iovcnt; /* destination iovcnt passed by the caller */
+		} d;
 	};
 	union {
 		void				*dst2;
 		uint32_t			seed;
 		uint64_t			fill_pattern;
 	};
-	uint32_t			*crc_dst;
+	union {
+		uint32_t		*crc_dst;
+		uint32_t		*output_size;
+	};
 	enum accel_opcode		op_code;
 	uint64_t			nbytes;
 	int				status;
+	struct spdk_accel_batch		*batch;
 	TAILQ_ENTRY(spdk_accel_task)	link;
 };
 
+struct spdk_accel_batch {
+	struct accel_io_channel		*accel_ch;
+	/* Tasks prepared into the batch, in execution order. */
+	TAILQ_HEAD(, spdk_accel_task)	tasks;
+	uint32_t			count;
+	/* Capabilities needed to execute all the tasks in hardware. */
+	uint64_t			capabilities;
+	int				status;
+	bool				submitted;
+	/* Set while one of the tasks is executed by the engine outside of an engine batch. */
+	bool				task_pending;
+	spdk_accel_completion_cb	cb_fn;
+	void				*cb_arg;
+	TAILQ_ENTRY(spdk_accel_batch)	link;
+};
+
 struct spdk_accel_engine {
+	const char *name;
 	uint64_t capabilities;
 	uint64_t (*get_capabilities)(void);
 	struct spdk_io_channel *(*get_io_channel)(void);
 	int (*submit_tasks)(struct spdk_io_channel *ch, struct spdk_accel_task *accel_task);
+
+	/*
+	 * Optional. Executes all the tasks of a batch, in order, as a single
+	 * submission. Each task is completed with spdk_accel_task_complete() and
+	 * the batch with spdk_accel_batch_complete(), none of them from within
+	 * submit_batch. If submit_batch fails, the framework submits the tasks
+	 * one by one instead.
+	 */
+	uint32_t (*batch_get_max)(void);
+	int (*submit_batch)(struct spdk_io_channel *ch, struct spdk_accel_batch *batch);
 };
 
 struct spdk_accel_module_if {
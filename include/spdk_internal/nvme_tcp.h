@@ -51,6 +51,9 @@
  */
 #define NVME_TCP_MAX_SGL_DESCRIPTORS	(16)
 
+/* Maximum number of PDU headers whose digests are computed in a single batch */
+#define NVME_TCP_HDGST_BATCH_SIZE	(32)
+
 #define MAKE_DIGEST_WORD(BUF, CRC32C) \
         (   ((*((uint8_t *)(BUF)+0)) = (uint8_t)((uint32_t)(CRC32C) >> 0)), \
             ((*((uint8_t *)(BUF)+1)) = (uint8_t)((uint32_t)(CRC32C) >> 8)), \
@@ -202,6 +205,31 @@ nvme_tcp_pdu_calc_header_digest(struct nvme_tcp_pdu *pdu)
 	return crc32c;
 }
 
+/* Compute and store the header digests of several PDUs in one pass */
+static void
+nvme_tcp_pdus_set_header_digest(struct nvme_tcp_pdu **pdus, int count)
+{
+	struct iovec iovs[NVME_TCP_HDGST_BATCH_SIZE];
+	uint32_t crcs[NVME_TCP_HDGST_BATCH_SIZE];
+	uint32_t hlen;
+	int i;
+
+	assert(count <= NVME_TCP_HDGST_BATCH_SIZE);
+
+	for (i = 0; i < count; i++) {
+		iovs[i].iov_base = &pdus[i]->hdr.raw;
+		iovs[i].iov_len = pdus[i]->hdr.common.hlen;
+		crcs[i] = ~0;
+	}
+
+	spdk_crc32c_update_multi(iovs, crcs, count);
+
+	for (i = 0; i < count; i++) {
+		hlen = pdus[i]->hdr.common.hlen;
+		MAKE_DIGEST_WORD((uint8_t *)pdus[i]->hdr.raw + hlen, crcs[i] ^ SPDK_CRC32C_XOR);
+	}
+}
+
 static uint32_t
 nvme_tcp_pdu_calc_data_digest(struct nvme_tcp_pdu *pdu)
 {
@@ -431,6 +459,40 @@ nvme_tcp_read_data(struct spdk_sock *sock, int bytes,
 	return NVME_TCP_CONNECTION_FATAL;
 }
 
+/* Read exactly up to the given bytes without letting the socket read ahead, so that
+ * the payload following them stays in the kernel and can be read in place later.
+ */
+static inline int
+nvme_tcp_read_data_direct(struct spdk_sock *sock, int bytes, void *buf)
+{
+	struct iovec iov;
+	ssize_t ret;
+
+	iov.iov_base = buf;
+	iov.iov_len = bytes;
+
+	ret = spdk_sock_readv_direct(sock, &iov, 1);
+
+	if (ret > 0) {
+		return ret;
+	}
+
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		/* For connect reset issue, do not output error log */
+		if (errno != ECONNRESET) {
+			SPDK_ERRLOG("spdk_sock_readv_direct() failed, errno %d: %s\n",
+				    errno, spdk_strerror(errno));
+		}
+	}
+
+	/* connection closed */
+	return NVME_TCP_CONNECTION_FATAL;
+}
+
 static int
 nvme_tcp_readv_data(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
 {
@@ -35,6 +35,8 @@
 
 #include "spdk_internal/accel_engine.h"
 
+#include "accel_internal.h"
+
 #include "spdk/env.h"
 #include "spdk/likely.h"
 #include "spdk/log.h"
@@ -42,6 +44,13 @@
 #include "spdk/json.h"
 #include "spdk/crc32.h"
 #include "spdk/util.h"
+#include "spdk/xor.h"
+#include "spdk/assert.h"
+#include "spdk/config.h"
+
+#ifdef SPDK_CONFIG_ISAL
+#include <isa-l/include/igzip_lib.h>
+#endif
 
 /* Accelerator Engine Framework: The following provides a top level
  * generic API for the accelerator functions defined here. Modules,
@@ -52,6 +61,9 @@
 
 #define ALIGN_4K			0x1000
 #define MAX_TASKS_PER_CHANNEL		0x800
+#define MAX_BATCHES_PER_CHANNEL		0x100
+#define MAX_OPS_PER_BATCH		32
+#define SW_INLINE_COMPLETION_BUDGET	256
 
 /* Largest context size for all accel modules */
 static size_t g_max_accel_module_size = 0;
@@ -62,6 +74,12 @@ static struct spdk_accel_module_if *g_accel_engine_module = NULL;
 static spdk_accel_fini_cb g_fini_cb_fn = NULL;
 static void *g_fini_cb_arg = NULL;
 
+static struct spdk_accel_opts g_accel_opts = {
+	.opts_size = sizeof(struct spdk_accel_opts),
+	.sw_inline_completion = false,
+	.sw_inline_completion_budget = SW_INLINE_COMPLETION_BUDGET,
+};
+
 /* Global list of registered accelerator modules */
 static TAILQ_HEAD(, spdk_accel_module_if) spdk_accel_module_list =
 	TAILQ_HEAD_INITIALIZER(spdk_accel_module_list);
@@ -73,6 +91,15 @@ static int _sw_accel_compare(void *src1, void *src2, uint64_t nbytes);
 static void _sw_accel_fill(void *dst, uint8_t fill, uint64_t nbytes);
 static void _sw_accel_crc32c(uint32_t *dst, void *src, uint32_t seed, uint64_t nbytes);
 static void _sw_accel_crc32cv(uint32_t *dst, struct iovec *iov, uint32_t iovcnt, uint32_t seed);
+static int _sw_accel_xor(void *dst, void **sources, uint32_t nsrcs, uint64_t nbytes);
+static int _sw_accel_pq_gen(void *p, void *q, void **sources, uint32_t nsrcs, uint64_t nbytes);
+static int _sw_accel_compress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs,
+			      uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+			      uint32_t *output_size);
+static int _sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs,
+				uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt,
+				uint32_t *output_size);
+static int sw_accel_execute_task(struct spdk_accel_task *accel_task);
 
 /* Registration of hw modules (currently supports only 1 at a time) */
 void
@@ -108,6 +135,98 @@ _is_supported(struct spdk_accel_engine *engine, enum accel_capability operation)
 	return ((engine->capabilities & operation) == operation);
 }
 
+static uint64_t
+_get_task_capability(enum accel_opcode op_code)
+{
+	switch (op_code) {
+	case ACCEL_OPCODE_MEMMOVE:
+		return ACCEL_COPY;
+	case ACCEL_OPCODE_MEMFILL:
+		return ACCEL_FILL;
+	case ACCEL_OPCODE_COMPARE:
+		return ACCEL_COMPARE;
+	case ACCEL_OPCODE_CRC32C:
+		return ACCEL_CRC32C;
+	case ACCEL_OPCODE_DUALCAST:
+		return ACCEL_DUALCAST;
+	case ACCEL_OPCODE_COPY_CRC32C:
+		return ACCEL_COPY_CRC32C;
+	case ACCEL_OPCODE_XOR:
+		return ACCEL_XOR;
+	case ACCEL_OPCODE_PQ_GEN:
+		return ACCEL_PQ_GEN;
+	case ACCEL_OPCODE_COMPRESS:
+		return ACCEL_COMPRESS;
+	case ACCEL_OPCODE_DECOMPRESS:
+		return ACCEL_DECOMPRESS;
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+/* Operations smaller than this are done in software even when the engine
+ * supports them, as submitting them to the hardware costs more than doing
+ * them on the core. Set per operation with spdk_accel_set_hw_threshold().
+ */
+static uint64_t g_hw_min_bytes[ACCEL_OPCODE_LAST];
+
+/* Statistics of the channels that have been destroyed. */
+static struct accel_op_stats g_accel_stats[ACCEL_PATH_LAST][ACCEL_OPCODE_LAST];
+static pthread_mutex_t g_accel_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *g_opcode_names[ACCEL_OPCODE_LAST] = {
+	[ACCEL_OPCODE_MEMMOVE]		= "copy",
+	[ACCEL_OPCODE_MEMFILL]		= "fill",
+	[ACCEL_OPCODE_COMPARE]		= "compare",
+	[ACCEL_OPCODE_CRC32C]		= "crc32c",
+	[ACCEL_OPCODE_DUALCAST]		= "dualcast",
+	[ACCEL_OPCODE_COPY_CRC32C]	= "copy_crc32c",
+	[ACCEL_OPCODE_XOR]		= "xor",
+	[ACCEL_OPCODE_PQ_GEN]		= "pq_gen",
+	[ACCEL_OPCODE_COMPRESS]		= "compress",
+	[ACCEL_OPCODE_DECOMPRESS]	= "decompress",
+};
+
+/* Used to determine whether an operation of nbytes goes to the channel's
+ * engine or is done here via SW implementation.
+ */
+inline static bool
+_use_hw(struct accel_io_channel *accel_ch, enum accel_opcode op_code, uint64_t nbytes)
+{
+	return _is_supported(accel_ch->engine, _get_task_capability(op_code)) &&
+	       nbytes >= g_hw_min_bytes[op_code];
+}
+
+static uint64_t
+_get_iovs_len(struct iovec *iovs, uint32_t iovcnt)
+{
+	uint64_t len = 0;
+	uint32_t i;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iovs[i].iov_len;
+	}
+
+	return len;
+}
+
+inline static void
+_update_stats(struct accel_io_channel *accel_ch, enum accel_engine_path path,
+	      enum accel_opcode op_code, uint64_t nbytes)
+{
+	accel_ch->stats[path][op_code].num_ops++;
+	accel_ch->stats[path][op_code].num_bytes += nbytes;
+}
+
+inline static int
+_submit_hw(struct accel_io_channel *accel_ch, struct spdk_accel_task *accel_task)
+{
+	_update_stats(accel_ch, ACCEL_PATH_HW, accel_task->op_code, accel_task->nbytes);
+
+	return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+}
+
 void
 spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 {
@@ -124,6 +243,68 @@ spdk_accel_task_complete(struct spdk_accel_task *accel_task, int status)
 	cb_fn(cb_arg, status);
 }
 
+void
+spdk_accel_get_opts(struct spdk_accel_opts *opts, size_t opts_size)
+{
+	if (!opts) {
+		SPDK_ERRLOG("opts should not be NULL\n");
+		return;
+	}
+
+	if (!opts_size) {
+		SPDK_ERRLOG("opts_size should not be zero value\n");
+		return;
+	}
+
+	opts->opts_size = opts_size;
+
+#define SET_FIELD(field) \
+	if (offsetof(struct spdk_accel_opts, field) + sizeof(opts->field) <= opts_size) { \
+		opts->field = g_accel_opts.field; \
+	} \
+
+	SET_FIELD(sw_inline_completion);
+	SET_FIELD(sw_inline_completion_budget);
+
+	/* Do not remove this statement, you should always update this statement when you adding a new field,
+	 * and do not forget to add the SET_FIELD statement for your added field. */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_accel_opts) == 16, "Incorrect size");
+
+#undef SET_FIELD
+}
+
+int
+spdk_accel_set_opts(const struct spdk_accel_opts *opts)
+{
+	if (!opts) {
+		SPDK_ERRLOG("opts cannot be NULL\n");
+		return -EINVAL;
+	}
+
+	if (!opts->opts_size) {
+		SPDK_ERRLOG("opts_size inside opts cannot be zero value\n");
+		return -EINVAL;
+	}
+
+#define SET_FIELD(field, default_value) \
+	if (offsetof(struct spdk_accel_opts, field) + sizeof(opts->field) <= opts->opts_size) { \
+		g_accel_opts.field = opts->field; \
+	} else { \
+		g_accel_opts.field = default_value; \
+	} \
+
+	SET_FIELD(sw_inline_completion, false);
+	SET_FIELD(sw_inline_completion_budget, SW_INLINE_COMPLETION_BUDGET);
+
+#undef SET_FIELD
+
+	if (g_accel_opts.sw_inline_completion_budget == 0) {
+		g_accel_opts.sw_inline_completion_budget = SW_INLINE_COMPLETION_BUDGET;
+	}
+
+	return 0;
+}
+
 /* Accel framework public API for discovering current engine capabilities. */
 uint64_t
 spdk_accel_get_capabilities(struct spdk_io_channel *ch)
@@ -161,6 +342,7 @@ _add_to_comp_list(struct accel_io_channel *accel_ch, struct spdk_accel_task *acc
 {
 	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(accel_ch->sw_engine_ch);
 
+	_update_stats(accel_ch, ACCEL_PATH_SW, accel_task->op_code, accel_task->nbytes);
 	accel_task->status = status;
 	TAILQ_INSERT_TAIL(&sw_ch->tasks_to_complete, accel_task, link);
 }
@@ -183,8 +365,8 @@ spdk_accel_submit_copy(struct spdk_io_channel *ch, void *dst, void *src, uint64_
 	accel_task->op_code = ACCEL_OPCODE_MEMMOVE;
 	accel_task->nbytes = nbytes;
 
-	if (_is_supported(accel_ch->engine, ACCEL_COPY)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_MEMMOVE, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		_sw_accel_copy(dst, src, nbytes);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -216,8 +398,8 @@ spdk_accel_submit_dualcast(struct spdk_io_channel *ch, void *dst1, void *dst2, v
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPCODE_DUALCAST;
 
-	if (_is_supported(accel_ch->engine, ACCEL_DUALCAST)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_DUALCAST, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		_sw_accel_dualcast(dst1, dst2, src, nbytes);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -244,8 +426,8 @@ spdk_accel_submit_compare(struct spdk_io_channel *ch, void *src1, void *src2, ui
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPCODE_COMPARE;
 
-	if (_is_supported(accel_ch->engine, ACCEL_COMPARE)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_COMPARE, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		rc = _sw_accel_compare(src1, src2, nbytes);
 		_add_to_comp_list(accel_ch, accel_task, rc);
@@ -271,8 +453,8 @@ spdk_accel_submit_fill(struct spdk_io_channel *ch, void *dst, uint8_t fill, uint
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPCODE_MEMFILL;
 
-	if (_is_supported(accel_ch->engine, ACCEL_FILL)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_MEMFILL, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		_sw_accel_fill(dst, fill, nbytes);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -300,8 +482,8 @@ spdk_accel_submit_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst, void *sr
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPCODE_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_CRC32C, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		_sw_accel_crc32c(crc_dst, src, seed, nbytes);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -375,7 +557,7 @@ spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct
 	accel_task->seed = seed;
 	accel_task->op_code = ACCEL_OPCODE_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_CRC32C)) {
+	if (_use_hw(accel_ch, ACCEL_OPCODE_CRC32C, iov[0].iov_len)) {
 		accel_task->cb_fn = crc32cv_done;
 		accel_task->cb_arg = accel_task;
 		accel_task->chained.cb_fn = cb_fn;
@@ -383,8 +565,9 @@ spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct
 
 		accel_task->nbytes = iov[0].iov_len;
 
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+		return _submit_hw(accel_ch, accel_task);
 	} else {
+		accel_task->nbytes = _get_iovs_len(iov, iov_cnt);
 		_sw_accel_crc32cv(crc_dst, iov, iov_cnt, seed);
 		_add_to_comp_list(accel_ch, accel_task, 0);
 		return 0;
@@ -413,8 +596,8 @@ spdk_accel_submit_copy_crc32c(struct spdk_io_channel *ch, void *dst, void *src,
 	accel_task->nbytes = nbytes;
 	accel_task->op_code = ACCEL_OPCODE_COPY_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_COPY_CRC32C)) {
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+	if (_use_hw(accel_ch, ACCEL_OPCODE_COPY_CRC32C, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
 		_sw_accel_copy(dst, src, nbytes);
 		_sw_accel_crc32c(crc_dst, src, seed, nbytes);
@@ -462,7 +645,7 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 	accel_task->seed = seed;
 	accel_task->op_code = ACCEL_OPCODE_COPY_CRC32C;
 
-	if (_is_supported(accel_ch->engine, ACCEL_COPY_CRC32C)) {
+	if (_use_hw(accel_ch, ACCEL_OPCODE_COPY_CRC32C, src_iovs[0].iov_len)) {
 		accel_task->cb_fn = crc32cv_done;
 		accel_task->cb_arg = accel_task;
 		accel_task->chained.cb_fn = cb_fn;
@@ -470,8 +653,9 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 
 		accel_task->nbytes = src_iovs[0].iov_len;
 
-		return accel_ch->engine->submit_tasks(accel_ch->engine_ch, accel_task);
+		return _submit_hw(accel_ch, accel_task);
 	} else {
+		accel_task->nbytes = _get_iovs_len(src_iovs, iov_cnt);
 		_sw_accel_copyv(dst, src_iovs, iov_cnt);
 		_sw_accel_crc32cv(crc_dst, src_iovs, iov_cnt, seed);
 		_add_to_comp_list(accel_ch, accel_task, 0);
@@ -479,180 +663,833 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst, struct iov
 	}
 }
 
-/* Helper function when when accel modules register with the framework. */
-void spdk_accel_module_list_add(struct spdk_accel_module_if *accel_module)
+/* Accel framework public API for XOR function */
+int
+spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
+		      uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	TAILQ_INSERT_TAIL(&spdk_accel_module_list, accel_module, tailq);
-	if (accel_module->get_ctx_size && accel_module->get_ctx_size() > g_max_accel_module_size) {
-		g_max_accel_module_size = accel_module->get_ctx_size();
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	if (sources == NULL || nsrcs < 2) {
+		SPDK_ERRLOG("XOR requires at least 2 source buffers\n");
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->nsrcs.srcs = sources;
+	accel_task->nsrcs.cnt = nsrcs;
+	accel_task->dst = dst;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = ACCEL_OPCODE_XOR;
+
+	if (_use_hw(accel_ch, ACCEL_OPCODE_XOR, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
+	} else {
+		rc = _sw_accel_xor(dst, sources, nsrcs, nbytes);
+		_add_to_comp_list(accel_ch, accel_task, rc);
+		return 0;
 	}
 }
 
-/* Framework level channel create callback. */
-static int
-accel_engine_create_cb(void *io_device, void *ctx_buf)
+/* Accel framework public API for RAID6 P+Q generation function */
+int
+spdk_accel_submit_pq_gen(struct spdk_io_channel *ch, void *p, void *q, void **sources,
+			 uint32_t nsrcs, uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	struct accel_io_channel	*accel_ch = ctx_buf;
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 	struct spdk_accel_task *accel_task;
-	uint8_t *task_mem;
-	int i;
+	int rc;
 
-	accel_ch->task_pool_base = calloc(MAX_TASKS_PER_CHANNEL, g_max_accel_module_size);
-	if (accel_ch->task_pool_base == NULL) {
-		return -ENOMEM;
+	if (sources == NULL || nsrcs < 2) {
+		SPDK_ERRLOG("P+Q generation requires at least 2 source buffers\n");
+		return -EINVAL;
 	}
 
-	TAILQ_INIT(&accel_ch->task_pool);
-	task_mem = accel_ch->task_pool_base;
-	for (i = 0 ; i < MAX_TASKS_PER_CHANNEL; i++) {
-		accel_task = (struct spdk_accel_task *)task_mem;
-		TAILQ_INSERT_TAIL(&accel_ch->task_pool, accel_task, link);
-		task_mem += g_max_accel_module_size;
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
 	}
 
-	/* Set sw engine channel for operations where hw engine does not support. */
-	accel_ch->sw_engine_ch = g_sw_accel_engine->get_io_channel();
-	assert(accel_ch->sw_engine_ch != NULL);
+	accel_task->nsrcs.srcs = sources;
+	accel_task->nsrcs.cnt = nsrcs;
+	accel_task->dst = p;
+	accel_task->dst2 = q;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = ACCEL_OPCODE_PQ_GEN;
 
-	if (g_hw_accel_engine != NULL) {
-		accel_ch->engine_ch = g_hw_accel_engine->get_io_channel();
-		accel_ch->engine = g_hw_accel_engine;
+	if (_use_hw(accel_ch, ACCEL_OPCODE_PQ_GEN, nbytes)) {
+		return _submit_hw(accel_ch, accel_task);
 	} else {
-		/* No hw engine enabled, use sw. */
-		accel_ch->engine_ch = accel_ch->sw_engine_ch;
-		accel_ch->engine = g_sw_accel_engine;
+		rc = _sw_accel_pq_gen(p, q, sources, nsrcs, nbytes);
+		_add_to_comp_list(accel_ch, accel_task, rc);
+		return 0;
 	}
-	assert(accel_ch->engine_ch != NULL);
-	accel_ch->engine->capabilities = accel_ch->engine->get_capabilities();
-
-	return 0;
 }
 
-/* Framework level channel destroy callback. */
-static void
-accel_engine_destroy_cb(void *io_device, void *ctx_buf)
+static int
+_submit_compress_op(struct spdk_io_channel *ch, enum accel_opcode op_code,
+		    struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		    struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+		    spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	struct accel_io_channel	*accel_ch = ctx_buf;
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct sw_accel_io_channel *sw_ch = spdk_io_channel_get_ctx(accel_ch->sw_engine_ch);
+	struct spdk_accel_task *accel_task;
+	uint64_t nbytes;
+	bool use_hw;
+	int rc;
 
-	if (accel_ch->sw_engine_ch != accel_ch->engine_ch) {
-		spdk_put_io_channel(accel_ch->sw_engine_ch);
+	if (dst_iovs == NULL || dst_iovcnt == 0 || src_iovs == NULL || src_iovcnt == 0) {
+		SPDK_ERRLOG("Bad iovs for (de)compression\n");
+		return -EINVAL;
 	}
-	spdk_put_io_channel(accel_ch->engine_ch);
-	free(accel_ch->task_pool_base);
-}
-
-struct spdk_io_channel *
-spdk_accel_engine_get_io_channel(void)
-{
-	return spdk_get_io_channel(&spdk_accel_module_list);
-}
 
-static void
-accel_engine_module_initialize(void)
-{
-	struct spdk_accel_module_if *accel_engine_module;
+	nbytes = _get_iovs_len(src_iovs, src_iovcnt);
+	use_hw = _use_hw(accel_ch, op_code, nbytes);
+	if (!use_hw && sw_ch->deflate_stream == NULL) {
+		/* Without ISA-L, the engine is the only option whatever the size. */
+		if (!_is_supported(accel_ch->engine, _get_task_capability(op_code))) {
+			return -ENOTSUP;
+		}
+		use_hw = true;
+	}
 
-	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
-		accel_engine_module->module_init();
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (accel_task == NULL) {
+		return -ENOMEM;
 	}
-}
 
-int
-spdk_accel_engine_initialize(void)
-{
-	SPDK_NOTICELOG("Accel engine initialized to use software engine.\n");
-	accel_engine_module_initialize();
+	accel_task->v.iovs = src_iovs;
+	accel_task->v.iovcnt = src_iovcnt;
+	accel_task->d.iovs = dst_iovs;
+	accel_task->d.iovcnt = dst_iovcnt;
+	accel_task->output_size = output_size;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = op_code;
 
-	/*
-	 * We need a unique identifier for the accel engine framework, so use the
-	 *  spdk_accel_module_list address for this purpose.
-	 */
-	spdk_io_device_register(&spdk_accel_module_list, accel_engine_create_cb, accel_engine_destroy_cb,
-				sizeof(struct accel_io_channel), "accel_module");
+	if (use_hw) {
+		return _submit_hw(accel_ch, accel_task);
+	}
+
+	if (op_code == ACCEL_OPCODE_COMPRESS) {
+		rc = _sw_accel_compress(sw_ch, dst_iovs, dst_iovcnt, src_iovs, src_iovcnt, output_size);
+	} else {
+		rc = _sw_accel_decompress(sw_ch, dst_iovs, dst_iovcnt, src_iovs, src_iovcnt, output_size);
+	}
+	_add_to_comp_list(accel_ch, accel_task, rc);
 
 	return 0;
 }
 
-static void
-accel_engine_module_finish_cb(void)
+/* Accel framework public API for compress function */
+int
+spdk_accel_submit_compress(struct spdk_io_channel *ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			   struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
 {
-	spdk_accel_fini_cb cb_fn = g_fini_cb_fn;
+	return _submit_compress_op(ch, ACCEL_OPCODE_COMPRESS, dst_iovs, dst_iovcnt, src_iovs,
+				   src_iovcnt, output_size, cb_fn, cb_arg);
+}
 
-	cb_fn(g_fini_cb_arg);
-	g_fini_cb_fn = NULL;
-	g_fini_cb_arg = NULL;
+/* Accel framework public API for decompress function */
+int
+spdk_accel_submit_decompress(struct spdk_io_channel *ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+			     struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size,
+			     spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	return _submit_compress_op(ch, ACCEL_OPCODE_DECOMPRESS, dst_iovs, dst_iovcnt, src_iovs,
+				   src_iovcnt, output_size, cb_fn, cb_arg);
 }
 
-void
-spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
+/* Accel framework public API for getting the max number of operations per batch */
+uint32_t
+spdk_accel_batch_get_max(struct spdk_io_channel *ch)
 {
-	struct spdk_accel_module_if *accel_engine_module;
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
 
-	/*
-	 * The accel fw has no config, there may be some in
-	 * the engines/modules though.
-	 */
-	spdk_json_write_array_begin(w);
-	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
-		if (accel_engine_module->write_config_json) {
-			accel_engine_module->write_config_json(w);
-		}
+	if (accel_ch->engine->batch_get_max != NULL) {
+		return spdk_min(accel_ch->engine->batch_get_max(), MAX_OPS_PER_BATCH);
 	}
-	spdk_json_write_array_end(w);
+
+	return MAX_OPS_PER_BATCH;
 }
 
-void
-spdk_accel_engine_module_finish(void)
+/* Accel framework public API for creating a batch */
+struct spdk_accel_batch *
+spdk_accel_batch_create(struct spdk_io_channel *ch)
 {
-	if (!g_accel_engine_module) {
-		g_accel_engine_module = TAILQ_FIRST(&spdk_accel_module_list);
-	} else {
-		g_accel_engine_module = TAILQ_NEXT(g_accel_engine_module, tailq);
-	}
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_batch *batch;
 
-	if (!g_accel_engine_module) {
-		accel_engine_module_finish_cb();
-		return;
+	batch = TAILQ_FIRST(&accel_ch->batch_pool);
+	if (batch == NULL) {
+		return NULL;
 	}
 
-	if (g_accel_engine_module->module_fini) {
-		spdk_thread_send_msg(spdk_get_thread(), g_accel_engine_module->module_fini, NULL);
-	} else {
-		spdk_accel_engine_module_finish();
-	}
+	TAILQ_REMOVE(&accel_ch->batch_pool, batch, link);
+	TAILQ_INIT(&batch->tasks);
+	batch->accel_ch = accel_ch;
+	batch->count = 0;
+	batch->capabilities = 0;
+	batch->status = 0;
+	batch->submitted = false;
+	batch->task_pending = false;
+
+	return batch;
 }
 
 void
-spdk_accel_engine_finish(spdk_accel_fini_cb cb_fn, void *cb_arg)
+spdk_accel_batch_complete(struct spdk_accel_batch *batch, int status)
 {
-	assert(cb_fn != NULL);
+	struct accel_io_channel *accel_ch = batch->accel_ch;
+	spdk_accel_completion_cb cb_fn = batch->cb_fn;
+	void *cb_arg = batch->cb_arg;
 
-	g_fini_cb_fn = cb_fn;
-	g_fini_cb_arg = cb_arg;
+	if (batch->status != 0) {
+		status = batch->status;
+	}
 
-	spdk_io_device_unregister(&spdk_accel_module_list, NULL);
-	spdk_accel_engine_module_finish();
+	TAILQ_INSERT_HEAD(&accel_ch->batch_pool, batch, link);
+
+	cb_fn(cb_arg, status);
 }
 
-/*
- * The SW Accelerator module is "built in" here (rest of file)
+/* Runs a batch that the engine did not take as a whole: the tasks the engine
+ * supports are submitted to it one at a time, the others are done in software
+ * back-to-back.
  */
-static uint64_t
-sw_accel_get_capabilities(void)
+static void
+accel_batch_process(struct spdk_accel_batch *batch)
 {
-	/* No HW acceleration capabilities. */
-	return 0;
+	struct accel_io_channel *accel_ch = batch->accel_ch;
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	while ((accel_task = TAILQ_FIRST(&batch->tasks)) != NULL) {
+		TAILQ_REMOVE(&batch->tasks, accel_task, link);
+		/* Engines treat linked tasks as a group, see _get_task(). */
+		accel_task->link.tqe_next = NULL;
+		accel_task->link.tqe_prev = NULL;
+
+		if (batch->status != 0) {
+			spdk_accel_task_complete(accel_task, -ECANCELED);
+			continue;
+		}
+
+		if (_use_hw(accel_ch, accel_task->op_code, accel_task->nbytes)) {
+			batch->task_pending = true;
+			rc = _submit_hw(accel_ch, accel_task);
+			if (spdk_likely(rc == 0)) {
+				/* Continued from accel_batch_task_done() */
+				return;
+			}
+
+			batch->task_pending = false;
+			spdk_accel_task_complete(accel_task, rc);
+			continue;
+		}
+
+		_update_stats(accel_ch, ACCEL_PATH_SW, accel_task->op_code, accel_task->nbytes);
+		spdk_accel_task_complete(accel_task, sw_accel_execute_task(accel_task));
+	}
+
+	spdk_accel_batch_complete(batch, 0);
 }
 
 static void
-_sw_accel_dualcast(void *dst1, void *dst2, void *src, uint64_t nbytes)
+accel_batch_task_done(void *cb_arg, int status)
 {
-	memcpy(dst1, src, (size_t)nbytes);
-	memcpy(dst2, src, (size_t)nbytes);
+	struct spdk_accel_task *accel_task = cb_arg;
+	struct spdk_accel_batch *batch = accel_task->batch;
+	spdk_accel_completion_cb cb_fn = accel_task->chained.cb_fn;
+	void *task_cb_arg = accel_task->chained.cb_arg;
+	bool task_pending = batch->task_pending;
+
+	/* A miscompare doesn't stop the batch. */
+	if (status != 0 && accel_task->op_code != ACCEL_OPCODE_COMPARE && batch->status == 0) {
+		batch->status = status;
+	}
+
+	batch->task_pending = false;
+	if (cb_fn != NULL) {
+		cb_fn(task_cb_arg, status);
+	}
+
+	if (task_pending) {
+		accel_batch_process(batch);
+	}
 }
 
-static void
-_sw_accel_copy(void *dst, void *src, uint64_t nbytes)
+/* Accel framework public API for submitting a batch */
+int
+spdk_accel_batch_submit(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct sw_accel_io_channel *sw_ch;
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	if (batch->accel_ch != accel_ch || batch->submitted) {
+		SPDK_ERRLOG("Attempt to submit an invalid batch.\n");
+		return -EINVAL;
+	}
+
+	if (TAILQ_EMPTY(&batch->tasks)) {
+		SPDK_ERRLOG("Attempt to submit an empty batch.\n");
+		return -EINVAL;
+	}
+
+	batch->cb_fn = cb_fn;
+	batch->cb_arg = cb_arg;
+	batch->submitted = true;
+
+	if (accel_ch->engine->submit_batch != NULL &&
+	    _is_supported(accel_ch->engine, batch->capabilities)) {
+		rc = accel_ch->engine->submit_batch(accel_ch->engine_ch, batch);
+		if (rc == 0) {
+			/* Nothing completes from within submit_batch, so the tasks are
+			 * still linked. */
+			TAILQ_FOREACH(accel_task, &batch->tasks, link) {
+				_update_stats(accel_ch, ACCEL_PATH_HW, accel_task->op_code, accel_task->nbytes);
+			}
+			/* The engine owns the tasks now, they go back to the task pool
+			 * as they complete. */
+			TAILQ_INIT(&batch->tasks);
+			return 0;
+		}
+	}
+
+	/* Run it from the completion poller, so that no callback is called on the
+	 * caller's stack. */
+	sw_ch = spdk_io_channel_get_ctx(accel_ch->sw_engine_ch);
+	TAILQ_INSERT_TAIL(&sw_ch->batches_to_process, batch, link);
+
+	return 0;
+}
+
+/* Accel framework public API for cancelling a batch */
+int
+spdk_accel_batch_cancel(struct spdk_io_channel *ch, struct spdk_accel_batch *batch)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	if (batch->accel_ch != accel_ch || batch->submitted) {
+		SPDK_ERRLOG("Attempt to cancel an invalid batch.\n");
+		return -EINVAL;
+	}
+
+	while ((accel_task = TAILQ_FIRST(&batch->tasks)) != NULL) {
+		TAILQ_REMOVE(&batch->tasks, accel_task, link);
+		TAILQ_INSERT_HEAD(&accel_ch->task_pool, accel_task, link);
+	}
+
+	TAILQ_INSERT_HEAD(&accel_ch->batch_pool, batch, link);
+
+	return 0;
+}
+
+static int
+_batch_prep_task(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+		 enum accel_opcode op_code, spdk_accel_completion_cb cb_fn, void *cb_arg,
+		 struct spdk_accel_task **_accel_task)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	if (batch->accel_ch != accel_ch || batch->submitted) {
+		SPDK_ERRLOG("Attempt to add to an invalid batch.\n");
+		return -EINVAL;
+	}
+
+	if (batch->count == spdk_accel_batch_get_max(ch)) {
+		SPDK_ERRLOG("Attempt to add to a batch that is already full.\n");
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, accel_batch_task_done, NULL);
+	if (accel_task == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_task->cb_arg = accel_task;
+	accel_task->chained.cb_fn = cb_fn;
+	accel_task->chained.cb_arg = cb_arg;
+	accel_task->batch = batch;
+	accel_task->op_code = op_code;
+
+	batch->capabilities |= _get_task_capability(op_code);
+	batch->count++;
+	TAILQ_INSERT_TAIL(&batch->tasks, accel_task, link);
+
+	*_accel_task = accel_task;
+	return 0;
+}
+
+/* Accel framework public API for batching a copy function */
+int
+spdk_accel_batch_prep_copy(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			   void *dst, void *src, uint64_t nbytes,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_MEMMOVE, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->dst = dst;
+	accel_task->src = src;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Accel framework public API for batching a dual cast copy function */
+int
+spdk_accel_batch_prep_dualcast(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			       void *dst1, void *dst2, void *src, uint64_t nbytes,
+			       spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	if ((uintptr_t)dst1 & (ALIGN_4K - 1) || (uintptr_t)dst2 & (ALIGN_4K - 1)) {
+		SPDK_ERRLOG("Dualcast requires 4K alignment on dst addresses\n");
+		return -EINVAL;
+	}
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_DUALCAST, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->src = src;
+	accel_task->dst = dst1;
+	accel_task->dst2 = dst2;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Accel framework public API for batching a compare function */
+int
+spdk_accel_batch_prep_compare(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			      void *src1, void *src2, uint64_t nbytes,
+			      spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_COMPARE, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->src = src1;
+	accel_task->src2 = src2;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Accel framework public API for batching a fill function */
+int
+spdk_accel_batch_prep_fill(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			   void *dst, uint8_t fill, uint64_t nbytes,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_MEMFILL, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->dst = dst;
+	accel_task->fill_pattern = fill;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Accel framework public API for batching a CRC-32C function */
+int
+spdk_accel_batch_prep_crc32c(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+			     uint32_t *crc_dst, void *src, uint32_t seed, uint64_t nbytes,
+			     spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_CRC32C, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->crc_dst = crc_dst;
+	accel_task->src = src;
+	accel_task->v.iovcnt = 0;
+	accel_task->seed = seed;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Accel framework public API for batching a copy with CRC-32C function */
+int
+spdk_accel_batch_prep_copy_crc32c(struct spdk_io_channel *ch, struct spdk_accel_batch *batch,
+				  void *dst, void *src, uint32_t *crc_dst, uint32_t seed,
+				  uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct spdk_accel_task *accel_task;
+	int rc;
+
+	rc = _batch_prep_task(ch, batch, ACCEL_OPCODE_COPY_CRC32C, cb_fn, cb_arg, &accel_task);
+	if (rc) {
+		return rc;
+	}
+
+	accel_task->dst = dst;
+	accel_task->src = src;
+	accel_task->crc_dst = crc_dst;
+	accel_task->v.iovcnt = 0;
+	accel_task->seed = seed;
+	accel_task->nbytes = nbytes;
+
+	return 0;
+}
+
+/* Helper function when when accel modules register with the framework. */
+void spdk_accel_module_list_add(struct spdk_accel_module_if *accel_module)
+{
+	TAILQ_INSERT_TAIL(&spdk_accel_module_list, accel_module, tailq);
+	if (accel_module->get_ctx_size && accel_module->get_ctx_size() > g_max_accel_module_size) {
+		g_max_accel_module_size = accel_module->get_ctx_size();
+	}
+}
+
+/* Framework level channel create callback. */
+static int
+accel_engine_create_cb(void *io_device, void *ctx_buf)
+{
+	struct accel_io_channel	*accel_ch = ctx_buf;
+	struct spdk_accel_task *accel_task;
+	struct spdk_accel_batch *batch;
+	uint8_t *task_mem;
+	int i;
+
+	accel_ch->task_pool_base = calloc(MAX_TASKS_PER_CHANNEL, g_max_accel_module_size);
+	if (accel_ch->task_pool_base == NULL) {
+		return -ENOMEM;
+	}
+
+	accel_ch->batch_pool_base = calloc(MAX_BATCHES_PER_CHANNEL, sizeof(struct spdk_accel_batch));
+	if (accel_ch->batch_pool_base == NULL) {
+		free(accel_ch->task_pool_base);
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&accel_ch->task_pool);
+	task_mem = accel_ch->task_pool_base;
+	for (i = 0 ; i < MAX_TASKS_PER_CHANNEL; i++) {
+		accel_task = (struct spdk_accel_task *)task_mem;
+		TAILQ_INSERT_TAIL(&accel_ch->task_pool, accel_task, link);
+		task_mem += g_max_accel_module_size;
+	}
+
+	TAILQ_INIT(&accel_ch->batch_pool);
+	batch = accel_ch->batch_pool_base;
+	for (i = 0 ; i < MAX_BATCHES_PER_CHANNEL; i++) {
+		TAILQ_INSERT_TAIL(&accel_ch->batch_pool, batch, link);
+		batch++;
+	}
+
+	/* Set sw engine channel for operations where hw engine does not support. */
+	accel_ch->sw_engine_ch = g_sw_accel_engine->get_io_channel();
+	assert(accel_ch->sw_engine_ch != NULL);
+
+	if (g_hw_accel_engine != NULL) {
+		accel_ch->engine_ch = g_hw_accel_engine->get_io_channel();
+		accel_ch->engine = g_hw_accel_engine;
+	} else {
+		/* No hw engine enabled, use sw. */
+		accel_ch->engine_ch = accel_ch->sw_engine_ch;
+		accel_ch->engine = g_sw_accel_engine;
+	}
+	assert(accel_ch->engine_ch != NULL);
+	accel_ch->engine->capabilities = accel_ch->engine->get_capabilities();
+
+	return 0;
+}
+
+/* Framework level channel destroy callback. */
+static void
+accel_engine_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct accel_io_channel	*accel_ch = ctx_buf;
+	int i, j;
+
+	pthread_mutex_lock(&g_accel_stats_lock);
+	for (i = 0; i < ACCEL_PATH_LAST; i++) {
+		for (j = 0; j < ACCEL_OPCODE_LAST; j++) {
+			g_accel_stats[i][j].num_ops += accel_ch->stats[i][j].num_ops;
+			g_accel_stats[i][j].num_bytes += accel_ch->stats[i][j].num_bytes;
+		}
+	}
+	pthread_mutex_unlock(&g_accel_stats_lock);
+
+	if (accel_ch->sw_engine_ch != accel_ch->engine_ch) {
+		spdk_put_io_channel(accel_ch->sw_engine_ch);
+	}
+	spdk_put_io_channel(accel_ch->engine_ch);
+	free(accel_ch->task_pool_base);
+	free(accel_ch->batch_pool_base);
+}
+
+struct spdk_io_channel *
+spdk_accel_engine_get_io_channel(void)
+{
+	return spdk_get_io_channel(&spdk_accel_module_list);
+}
+
+const char *
+accel_get_opcode_name(enum accel_opcode op_code)
+{
+	if (op_code >= ACCEL_OPCODE_LAST) {
+		return NULL;
+	}
+
+	return g_opcode_names[op_code];
+}
+
+int
+accel_get_opcode_by_name(const char *name, enum accel_opcode *op_code)
+{
+	int i;
+
+	for (i = 0; i < ACCEL_OPCODE_LAST; i++) {
+		if (g_opcode_names[i] != NULL && strcmp(g_opcode_names[i], name) == 0) {
+			*op_code = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+void
+accel_set_hw_min_bytes(enum accel_opcode op_code, uint64_t min_bytes)
+{
+	assert(op_code < ACCEL_OPCODE_LAST && g_opcode_names[op_code] != NULL);
+	g_hw_min_bytes[op_code] = min_bytes;
+}
+
+int
+spdk_accel_set_hw_threshold(enum accel_capability capability, uint64_t min_bytes)
+{
+	int i;
+
+	for (i = 0; i < ACCEL_OPCODE_LAST; i++) {
+		if (g_opcode_names[i] != NULL && _get_task_capability(i) == capability) {
+			accel_set_hw_min_bytes(i, min_bytes);
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+const char *
+accel_get_hw_engine_name(void)
+{
+	return g_hw_accel_engine != NULL ? g_hw_accel_engine->name : NULL;
+}
+
+struct accel_get_stats_ctx {
+	struct accel_op_stats	stats[ACCEL_PATH_LAST][ACCEL_OPCODE_LAST];
+	accel_get_stats_cb	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+accel_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct accel_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	int j, k;
+
+	for (j = 0; j < ACCEL_PATH_LAST; j++) {
+		for (k = 0; k < ACCEL_OPCODE_LAST; k++) {
+			ctx->stats[j][k].num_ops += accel_ch->stats[j][k].num_ops;
+			ctx->stats[j][k].num_bytes += accel_ch->stats[j][k].num_bytes;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+accel_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct accel_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->stats, ctx->cb_arg);
+	free(ctx);
+}
+
+int
+accel_get_stats(accel_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct accel_get_stats_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	pthread_mutex_lock(&g_accel_stats_lock);
+	memcpy(ctx->stats, g_accel_stats, sizeof(ctx->stats));
+	pthread_mutex_unlock(&g_accel_stats_lock);
+
+	spdk_for_each_channel(&spdk_accel_module_list, accel_get_stats_channel, ctx,
+			      accel_get_stats_done);
+
+	return 0;
+}
+
+static void
+accel_engine_module_initialize(void)
+{
+	struct spdk_accel_module_if *accel_engine_module;
+
+	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
+		accel_engine_module->module_init();
+	}
+}
+
+int
+spdk_accel_engine_initialize(void)
+{
+	SPDK_NOTICELOG("Accel engine initialized to use software engine.\n");
+	accel_engine_module_initialize();
+
+	/*
+	 * We need a unique identifier for the accel engine framework, so use the
+	 *  spdk_accel_module_list address for this purpose.
+	 */
+	spdk_io_device_register(&spdk_accel_module_list, accel_engine_create_cb, accel_engine_destroy_cb,
+				sizeof(struct accel_io_channel), "accel_module");
+
+	return 0;
+}
+
+static void
+accel_engine_module_finish_cb(void)
+{
+	spdk_accel_fini_cb cb_fn = g_fini_cb_fn;
+
+	cb_fn(g_fini_cb_arg);
+	g_fini_cb_fn = NULL;
+	g_fini_cb_arg = NULL;
+}
+
+void
+spdk_accel_write_config_json(struct spdk_json_write_ctx *w)
+{
+	struct spdk_accel_module_if *accel_engine_module;
+	int i;
+
+	spdk_json_write_array_begin(w);
+	for (i = 0; i < ACCEL_OPCODE_LAST; i++) {
+		if (g_hw_min_bytes[i] == 0) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "accel_set_hw_threshold");
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "opcode", g_opcode_names[i]);
+		spdk_json_write_named_uint64(w, "min_bytes", g_hw_min_bytes[i]);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
+	/* There may be some config in the engines/modules as well. */
+	TAILQ_FOREACH(accel_engine_module, &spdk_accel_module_list, tailq) {
+		if (accel_engine_module->write_config_json) {
+			accel_engine_module->write_config_json(w);
+		}
+	}
+	spdk_json_write_array_end(w);
+}
+
+void
+spdk_accel_engine_module_finish(void)
+{
+	if (!g_accel_engine_module) {
+		g_accel_engine_module = TAILQ_FIRST(&spdk_accel_module_list);
+	} else {
+		g_accel_engine_module = TAILQ_NEXT(g_accel_engine_module, tailq);
+	}
+
+	if (!g_accel_engine_module) {
+		accel_engine_module_finish_cb();
+		return;
+	}
+
+	if (g_accel_engine_module->module_fini) {
+		spdk_thread_send_msg(spdk_get_thread(), g_accel_engine_module->module_fini, NULL);
+	} else {
+		spdk_accel_engine_module_finish();
+	}
+}
+
+void
+spdk_accel_engine_finish(spdk_accel_fini_cb cb_fn, void *cb_arg)
+{
+	assert(cb_fn != NULL);
+
+	g_fini_cb_fn = cb_fn;
+	g_fini_cb_arg = cb_arg;
+
+	spdk_io_device_unregister(&spdk_accel_module_list, NULL);
+	spdk_accel_engine_module_finish();
+}
+
+/*
+ * The SW Accelerator module is "built in" here (rest of file)
+ */
+static uint64_t
+sw_accel_get_capabilities(void)
+{
+	/* No HW acceleration capabilities. */
+	return 0;
+}
+
+static void
+_sw_accel_dualcast(void *dst1, void *dst2, void *src, uint64_t nbytes)
+{
+	memcpy(dst1, src, (size_t)nbytes);
+	memcpy(dst2, src, (size_t)nbytes);
+}
+
+static void
+_sw_accel_copy(void *dst, void *src, uint64_t nbytes)
 {
 	memcpy(dst, src, (size_t)nbytes);
 }
@@ -693,10 +1530,216 @@ _sw_accel_crc32cv(uint32_t *crc_dst, struct iovec *iov, uint32_t iovcnt, uint32_
 	*crc_dst = spdk_crc32c_iov_update(iov, iovcnt, ~seed);
 }
 
+static int
+_sw_accel_xor(void *dst, void **sources, uint32_t nsrcs, uint64_t nbytes)
+{
+	return spdk_xor_gen(dst, sources, nsrcs, (size_t)nbytes);
+}
+
+static int
+_sw_accel_pq_gen(void *p, void *q, void **sources, uint32_t nsrcs, uint64_t nbytes)
+{
+	return spdk_pq_gen(p, q, sources, nsrcs, (size_t)nbytes);
+}
+
+#ifdef SPDK_CONFIG_ISAL
+static int
+_sw_accel_compress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		   struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size)
+{
+	struct isal_zstream *stream = sw_ch->deflate_stream;
+	uint32_t s = 0, d = 0;
+	int rc;
+
+	isal_deflate_reset(stream);
+	stream->next_in = src_iovs[0].iov_base;
+	stream->avail_in = src_iovs[0].iov_len;
+	stream->end_of_stream = src_iovcnt == 1;
+	stream->next_out = dst_iovs[0].iov_base;
+	stream->avail_out = dst_iovs[0].iov_len;
+
+	while (stream->internal_state.state != ZSTATE_END) {
+		if (stream->avail_in == 0 && s + 1 < src_iovcnt) {
+			s++;
+			stream->next_in = src_iovs[s].iov_base;
+			stream->avail_in = src_iovs[s].iov_len;
+			stream->end_of_stream = s + 1 == src_iovcnt;
+		}
+
+		if (stream->avail_out == 0) {
+			if (d + 1 == dst_iovcnt) {
+				return -ENOSPC;
+			}
+			d++;
+			stream->next_out = dst_iovs[d].iov_base;
+			stream->avail_out = dst_iovs[d].iov_len;
+		}
+
+		rc = isal_deflate(stream);
+		if (rc != COMP_OK) {
+			SPDK_ERRLOG("isal_deflate failed: %d\n", rc);
+			return -EIO;
+		}
+	}
+
+	if (output_size != NULL) {
+		*output_size = stream->total_out;
+	}
+
+	return 0;
+}
+
+static int
+_sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		     struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size)
+{
+	struct inflate_state *state = sw_ch->inflate_state;
+	uint32_t s = 0, d = 0;
+	int rc;
+
+	isal_inflate_reset(state);
+	state->next_in = src_iovs[0].iov_base;
+	state->avail_in = src_iovs[0].iov_len;
+	state->next_out = dst_iovs[0].iov_base;
+	state->avail_out = dst_iovs[0].iov_len;
+
+	while (state->block_state != ISAL_BLOCK_FINISH) {
+		if (state->avail_in == 0) {
+			if (s + 1 == src_iovcnt) {
+				/* The whole source was consumed without reaching the end of the stream. */
+				return -EIO;
+			}
+			s++;
+			state->next_in = src_iovs[s].iov_base;
+			state->avail_in = src_iovs[s].iov_len;
+		}
+
+		if (state->avail_out == 0) {
+			if (d + 1 == dst_iovcnt) {
+				return -ENOSPC;
+			}
+			d++;
+			state->next_out = dst_iovs[d].iov_base;
+			state->avail_out = dst_iovs[d].iov_len;
+		}
+
+		rc = isal_inflate(state);
+		if (rc < ISAL_DECOMP_OK) {
+			SPDK_ERRLOG("isal_inflate failed: %d\n", rc);
+			return -EIO;
+		}
+	}
+
+	if (output_size != NULL) {
+		*output_size = state->total_out;
+	}
+
+	return 0;
+}
+
+static int
+_sw_accel_compress_init(struct sw_accel_io_channel *sw_ch)
+{
+	sw_ch->deflate_stream = calloc(1, sizeof(*sw_ch->deflate_stream));
+	sw_ch->inflate_state = calloc(1, sizeof(*sw_ch->inflate_state));
+	if (sw_ch->deflate_stream == NULL || sw_ch->inflate_state == NULL) {
+		goto err;
+	}
+
+	isal_deflate_init(sw_ch->deflate_stream);
+	sw_ch->deflate_stream->flush = NO_FLUSH;
+	sw_ch->deflate_stream->level = 1;
+	sw_ch->deflate_stream->level_buf_size = ISAL_DEF_LVL1_DEFAULT;
+	sw_ch->deflate_stream->level_buf = calloc(1, ISAL_DEF_LVL1_DEFAULT);
+	if (sw_ch->deflate_stream->level_buf == NULL) {
+		goto err;
+	}
+
+	isal_inflate_init(sw_ch->inflate_state);
+
+	return 0;
+err:
+	if (sw_ch->deflate_stream != NULL) {
+		free(sw_ch->deflate_stream->level_buf);
+	}
+	free(sw_ch->deflate_stream);
+	free(sw_ch->inflate_state);
+	sw_ch->deflate_stream = NULL;
+	sw_ch->inflate_state = NULL;
+
+	return -ENOMEM;
+}
+
+static void
+_sw_accel_compress_fini(struct sw_accel_io_channel *sw_ch)
+{
+	if (sw_ch->deflate_stream != NULL) {
+		free(sw_ch->deflate_stream->level_buf);
+		free(sw_ch->deflate_stream);
+	}
+	free(sw_ch->inflate_state);
+}
+#else
+static int
+_sw_accel_compress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		   struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size)
+{
+	return -ENOTSUP;
+}
+
+static int
+_sw_accel_decompress(struct sw_accel_io_channel *sw_ch, struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		     struct iovec *src_iovs, uint32_t src_iovcnt, uint32_t *output_size)
+{
+	return -ENOTSUP;
+}
+
+static int
+_sw_accel_compress_init(struct sw_accel_io_channel *sw_ch)
+{
+	/* Software (de)compression requires ISA-L, leave it unavailable. */
+	return 0;
+}
+
+static void
+_sw_accel_compress_fini(struct sw_accel_io_channel *sw_ch)
+{
+}
+#endif
+
+static int
+sw_accel_execute_task(struct spdk_accel_task *accel_task)
+{
+	switch (accel_task->op_code) {
+	case ACCEL_OPCODE_MEMMOVE:
+		_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes);
+		return 0;
+	case ACCEL_OPCODE_MEMFILL:
+		_sw_accel_fill(accel_task->dst, (uint8_t)accel_task->fill_pattern, accel_task->nbytes);
+		return 0;
+	case ACCEL_OPCODE_COMPARE:
+		return _sw_accel_compare(accel_task->src, accel_task->src2, accel_task->nbytes);
+	case ACCEL_OPCODE_CRC32C:
+		_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed, accel_task->nbytes);
+		return 0;
+	case ACCEL_OPCODE_DUALCAST:
+		_sw_accel_dualcast(accel_task->dst, accel_task->dst2, accel_task->src, accel_task->nbytes);
+		return 0;
+	case ACCEL_OPCODE_COPY_CRC32C:
+		_sw_accel_copy(accel_task->dst, accel_task->src, accel_task->nbytes);
+		_sw_accel_crc32c(accel_task->crc_dst, accel_task->src, accel_task->seed, accel_task->nbytes);
+		return 0;
+	default:
+		assert(false);
+		return -EINVAL;
+	}
+}
+
 static struct spdk_io_channel *sw_accel_get_io_channel(void);
 
 
 static struct spdk_accel_engine sw_accel_engine = {
+	.name			= "software",
 	.get_capabilities	= sw_accel_get_capabilities,
 	.get_io_channel		= sw_accel_get_io_channel,
 };
@@ -706,18 +1749,43 @@ accel_comp_poll(void *arg)
 {
 	struct sw_accel_io_channel	*sw_ch = arg;
 	TAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
+	TAILQ_HEAD(, spdk_accel_batch)	batches_to_process;
 	struct spdk_accel_task		*accel_task;
+	struct spdk_accel_batch		*batch;
+	uint32_t			count = 0;
 
-	if (TAILQ_EMPTY(&sw_ch->tasks_to_complete)) {
+	if (TAILQ_EMPTY(&sw_ch->tasks_to_complete) && TAILQ_EMPTY(&sw_ch->batches_to_process)) {
 		return SPDK_POLLER_IDLE;
 	}
 
 	TAILQ_INIT(&tasks_to_complete);
 	TAILQ_SWAP(&tasks_to_complete, &sw_ch->tasks_to_complete, spdk_accel_task, link);
+	TAILQ_INIT(&batches_to_process);
+	TAILQ_SWAP(&batches_to_process, &sw_ch->batches_to_process, spdk_accel_batch, link);
 
 	while ((accel_task = TAILQ_FIRST(&tasks_to_complete))) {
 		TAILQ_REMOVE(&tasks_to_complete, accel_task, link);
 		spdk_accel_task_complete(accel_task, accel_task->status);
+		count++;
+	}
+
+	/* In inline mode, keep completing whatever the callbacks above submitted
+	 * rather than leaving it for the next poll. Each pass still runs from
+	 * this poller, never from the submitter's stack, and the budget bounds
+	 * how long a channel whose callbacks always resubmit can hold the thread.
+	 */
+	if (g_accel_opts.sw_inline_completion) {
+		while (count < g_accel_opts.sw_inline_completion_budget &&
+		       (accel_task = TAILQ_FIRST(&sw_ch->tasks_to_complete))) {
+			TAILQ_REMOVE(&sw_ch->tasks_to_complete, accel_task, link);
+			spdk_accel_task_complete(accel_task, accel_task->status);
+			count++;
+		}
+	}
+
+	while ((batch = TAILQ_FIRST(&batches_to_process))) {
+		TAILQ_REMOVE(&batches_to_process, batch, link);
+		accel_batch_process(batch);
 	}
 
 	return SPDK_POLLER_BUSY;
@@ -729,6 +1797,11 @@ sw_accel_create_cb(void *io_device, void *ctx_buf)
 	struct sw_accel_io_channel *sw_ch = ctx_buf;
 
 	TAILQ_INIT(&sw_ch->tasks_to_complete);
+	TAILQ_INIT(&sw_ch->batches_to_process);
+	if (_sw_accel_compress_init(sw_ch)) {
+		SPDK_ERRLOG("Failed to allocate software (de)compression state\n");
+		return -ENOMEM;
+	}
 	sw_ch->completion_poller = SPDK_POLLER_REGISTER(accel_comp_poll, sw_ch, 0);
 
 	return 0;
@@ -740,6 +1813,7 @@ sw_accel_destroy_cb(void *io_device, void *ctx_buf)
 	struct sw_accel_io_channel *sw_ch = ctx_buf;
 
 	spdk_poller_unregister(&sw_ch->completion_poller);
+	_sw_accel_compress_fini(sw_ch);
 }
 
 static struct spdk_io_channel *sw_accel_get_io_channel(void)
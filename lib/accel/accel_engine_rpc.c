@@ -0,0 +1,146 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "accel_internal.h"
+
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_accel_set_hw_threshold {
+	char *opcode;
+	uint64_t min_bytes;
+};
+
+static void
+free_rpc_accel_set_hw_threshold(struct rpc_accel_set_hw_threshold *req)
+{
+	free(req->opcode);
+}
+
+static const struct spdk_json_object_decoder rpc_accel_set_hw_threshold_decoders[] = {
+	{"opcode", offsetof(struct rpc_accel_set_hw_threshold, opcode), spdk_json_decode_string},
+	{"min_bytes", offsetof(struct rpc_accel_set_hw_threshold, min_bytes), spdk_json_decode_uint64},
+};
+
+static void
+rpc_accel_set_hw_threshold(struct spdk_jsonrpc_request *request,
+			   const struct spdk_json_val *params)
+{
+	struct rpc_accel_set_hw_threshold req = {};
+	enum accel_opcode op_code;
+
+	if (spdk_json_decode_object(params, rpc_accel_set_hw_threshold_decoders,
+				    SPDK_COUNTOF(rpc_accel_set_hw_threshold_decoders), &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object() failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	if (accel_get_opcode_by_name(req.opcode, &op_code)) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Unknown opcode: %s", req.opcode);
+		goto cleanup;
+	}
+
+	accel_set_hw_min_bytes(op_code, req.min_bytes);
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_accel_set_hw_threshold(&req);
+}
+SPDK_RPC_REGISTER("accel_set_hw_threshold", rpc_accel_set_hw_threshold,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
+static void
+rpc_accel_write_engine_stats(struct spdk_json_write_ctx *w, const char *name,
+			     struct accel_op_stats stats[ACCEL_OPCODE_LAST])
+{
+	int i;
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "engine", name);
+	spdk_json_write_named_array_begin(w, "operations");
+	for (i = 0; i < ACCEL_OPCODE_LAST; i++) {
+		if (stats[i].num_ops == 0) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "opcode", accel_get_opcode_name(i));
+		spdk_json_write_named_uint64(w, "num_ops", stats[i].num_ops);
+		spdk_json_write_named_uint64(w, "num_bytes", stats[i].num_bytes);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+}
+
+static void
+rpc_accel_get_stats_done(struct accel_op_stats stats[ACCEL_PATH_LAST][ACCEL_OPCODE_LAST],
+			 void *cb_arg)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	const char *hw_engine_name = accel_get_hw_engine_name();
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+	rpc_accel_write_engine_stats(w, "software", stats[ACCEL_PATH_SW]);
+	if (hw_engine_name != NULL) {
+		rpc_accel_write_engine_stats(w, hw_engine_name, stats[ACCEL_PATH_HW]);
+	}
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_accel_get_stats(struct spdk_jsonrpc_request *request,
+		    const struct spdk_json_val *params)
+{
+	int rc;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "accel_get_stats requires no parameters");
+		return;
+	}
+
+	rc = accel_get_stats(rpc_accel_get_stats_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+SPDK_RPC_REGISTER("accel_get_stats", rpc_accel_get_stats, SPDK_RPC_RUNTIME)
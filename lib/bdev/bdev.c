@@ -74,6 +74,9 @@ int __itt_init_ittlib(const char *, __itt_group_id);
 #define SPDK_BDEV_QOS_MIN_IOS_PER_SEC		1000
 #define SPDK_BDEV_QOS_MIN_BYTES_PER_SEC		(1024 * 1024)
 #define SPDK_BDEV_QOS_LIMIT_NOT_DEFINED		UINT64_MAX
+#define SPDK_BDEV_QOS_CLASS_DEFAULT_NAME	"default"
+#define SPDK_BDEV_QOS_CLASS_WINDOW_TIMESLICES	100
+#define SPDK_BDEV_QOS_MAX_CLASSES		16
 #define SPDK_BDEV_IO_POLL_INTERVAL_IN_MSEC	1000
 
 #define SPDK_BDEV_POOL_ALIGNMENT 512
@@ -83,6 +86,11 @@ int __itt_init_ittlib(const char *, __itt_group_id);
  */
 #define SPDK_BDEV_MAX_CHILDREN_UNMAP_WRITE_ZEROES_REQS (8)
 
+/* The maximum number of children requests for a COPY command
+ * when splitting into children requests at a time.
+ */
+#define SPDK_BDEV_MAX_CHILDREN_COPY_REQS (8)
+
 static const char *qos_rpc_type[] = {"rw_ios_per_sec",
 				     "rw_mbytes_per_sec", "r_mbytes_per_sec", "w_mbytes_per_sec"
 				    };
@@ -99,11 +107,33 @@ bdev_name_cmp(struct spdk_bdev_name *name1, struct spdk_bdev_name *name2)
 
 RB_GENERATE_STATIC(bdev_name_tree, spdk_bdev_name, node, bdev_name_cmp);
 
+enum bdev_pool_type {
+	BDEV_POOL_BDEV_IO,
+	BDEV_POOL_BUF_SMALL,
+	BDEV_POOL_BUF_LARGE,
+	BDEV_NUM_POOL_TYPES,
+};
+
+/* The index of the pools an object came from is kept in a uint8_t */
+#define BDEV_MAX_NUMA_POOLS	(UINT8_MAX + 1)
+
+/* The bdev_io and data buffer pools of one NUMA node */
+struct bdev_numa_pools {
+	uint32_t		socket_id;
+	struct spdk_mempool	*pool[BDEV_NUM_POOL_TYPES];
+	uint32_t		size[BDEV_NUM_POOL_TYPES];
+	/* Objects taken by threads of other nodes, only updated atomically */
+	uint64_t		remote_allocs[BDEV_NUM_POOL_TYPES];
+};
+
 struct spdk_bdev_mgr {
-	struct spdk_mempool *bdev_io_pool;
+	/* One set of pools per NUMA node with SPDK cores */
+	struct bdev_numa_pools *pools;
+	uint32_t num_pools;
 
-	struct spdk_mempool *buf_small_pool;
-	struct spdk_mempool *buf_large_pool;
+	/* Index of the pools of the node of each core */
+	uint8_t *core_pool_idx;
+	uint32_t num_cores;
 
 	void *zero_buffer;
 
@@ -115,6 +145,9 @@ struct spdk_bdev_mgr {
 	bool init_complete;
 	bool module_init_complete;
 
+	/* Last identifier given to a descriptor for its statistics */
+	uint64_t desc_stat_id;
+
 	pthread_mutex_t mutex;
 
 #ifdef SPDK_CONFIG_VTUNE
@@ -147,6 +180,7 @@ static struct spdk_bdev_opts	g_bdev_opts = {
 	.bdev_auto_examine = SPDK_BDEV_AUTO_EXAMINE,
 	.small_buf_pool_size = BUF_SMALL_POOL_SIZE,
 	.large_buf_pool_size = BUF_LARGE_POOL_SIZE,
+	.numa_pools = true,
 };
 
 static spdk_bdev_init_cb	g_init_cb_fn = NULL;
@@ -164,13 +198,18 @@ struct spdk_bdev_qos_limit {
 	 *  For remaining bytes, allowed to run negative if an I/O is submitted when
 	 *  some bytes are remaining, but the I/O is bigger than that amount. The
 	 *  excess will be deducted from the next timeslice.
+	 *  This budget is shared by all channels of the bdev and is only accessed
+	 *  atomically.
 	 */
 	int64_t remaining_this_timeslice;
 
 	/** Minimum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
 	uint32_t min_per_timeslice;
 
-	/** Maximum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
+	/** Maximum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms).
+	 *  Read by all channels while the QoS thread may update it, so it is only
+	 *  accessed atomically, as are the two function pointers below.
+	 */
 	uint32_t max_per_timeslice;
 
 	/** Function to check whether to queue the IO. */
@@ -180,27 +219,82 @@ struct spdk_bdev_qos_limit {
 	void (*update_quota)(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
 };
 
+struct spdk_bdev_qos_class {
+	/** Name of the class, NULL if this slot is free. Protected by the bdev mutex. */
+	char *name;
+
+	/** Share of the bdev relative to the other classes while throttling, 0 if this
+	 *  slot is free. Set under the bdev mutex, read atomically by the timeslice path.
+	 */
+	uint32_t weight;
+
+	/** Target for the 99th percentile latency in tsc ticks, 0 if none.
+	 *  Classes with a latency target are never throttled. Accessed atomically.
+	 */
+	uint64_t latency_target_ticks;
+
+	/** Maximum allowed IOs in one timeslice while throttled, 0 if not throttled.
+	 *  Accessed atomically.
+	 */
+	uint64_t max_per_timeslice;
+
+	/** Remaining IOs allowed in current timeslice while throttled. Accessed atomically. */
+	int64_t remaining_this_timeslice;
+
+	/** Whether the 99th percentile latency was over the target in the last window.
+	 *  Accessed atomically.
+	 */
+	bool latency_target_missed;
+
+	/** Completed IOs and IOs over the latency target in the current window. Each channel
+	 *  adds what it counted once per timeslice. Accessed atomically.
+	 */
+	uint64_t window_ios;
+	uint64_t window_over_target;
+
+	/** Completed IOs in the last window. Only used by the timeslice path. */
+	uint64_t last_window_ios;
+
+	/** Cumulative statistics, added to like the window counters. Accessed atomically. */
+	uint64_t num_ios;
+	uint64_t bytes;
+	uint64_t latency_ticks;
+	uint64_t num_over_target;
+};
+
 struct spdk_bdev_qos {
 	/** Types of structure of rate limits. */
 	struct spdk_bdev_qos_limit rate_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
 
-	/** The channel that all I/O are funneled through. */
+	/** Classes of the descriptors of the bdev, indexed by the class id of each descriptor. */
+	struct spdk_bdev_qos_class classes[SPDK_BDEV_QOS_MAX_CLASSES];
+
+	/** Number of classes in use. Updated under the bdev mutex, read atomically. */
+	uint32_t num_classes;
+
+	/** Timeslices elapsed in the current class evaluation window. Only used by the
+	 *  channel that advances last_timeslice.
+	 */
+	uint64_t class_window_timeslices;
+
+	/** The channel that set up QoS. It keeps the QoS object alive. */
 	struct spdk_bdev_channel *ch;
 
-	/** The thread on which the poller is running. */
+	/** The thread of the QoS channel. Rate limit updates are applied here. */
 	struct spdk_thread *thread;
 
-	/** Queue of I/O waiting to be issued. */
-	bdev_io_tailq_t queued;
-
 	/** Size of a timeslice in tsc ticks. */
 	uint64_t timeslice_size;
 
-	/** Timestamp of start of last timeslice. */
+	/** Timestamp of start of last timeslice. Advanced atomically by whichever
+	 *  channel first notices that the timeslice has expired.
+	 */
 	uint64_t last_timeslice;
 
-	/** Poller that processes queued I/O commands each time slice. */
-	struct spdk_poller *poller;
+	/** References held by the bdev and by each channel enforcing this QoS object.
+	 *  Updated atomically, the object is freed when the last one is dropped.
+	 */
+	uint32_t ref;
 };
 
 struct spdk_bdev_mgmt_channel {
@@ -260,6 +354,25 @@ struct spdk_bdev_shared_resource {
 #define BDEV_CH_RESET_IN_PROGRESS	(1 << 0)
 #define BDEV_CH_QOS_ENABLED		(1 << 1)
 
+/* Statistics of a descriptor on a channel, indexed by the stat_slot of the descriptor. */
+struct bdev_desc_ch_stat {
+	/* stat_id of the descriptor the entry counts for, 0 if unused */
+	uint64_t			desc_id;
+	struct spdk_bdev_io_stat	stat;
+	uint64_t			io_outstanding;
+};
+
+/*
+ * I/O of a QoS class completed on a channel since the last timeslice. They are added to
+ *  the class counters, which are shared by all channels, once per timeslice.
+ */
+struct bdev_qos_class_ch_stat {
+	uint64_t	num_ios;
+	uint64_t	bytes;
+	uint64_t	latency_ticks;
+	uint64_t	num_over_target;
+};
+
 struct spdk_bdev_channel {
 	struct spdk_bdev	*bdev;
 
@@ -292,6 +405,17 @@ struct spdk_bdev_channel {
 
 	struct spdk_histogram_data *histogram;
 
+	/* Latency histograms per I/O type and size class, allocated along with histogram. */
+	struct spdk_bdev_io_type_histograms *io_type_histograms;
+
+	/*
+	 * Per descriptor statistics. The array is only touched from the channel's thread,
+	 * and grows on demand when desc_stats_enabled is set.
+	 */
+	bool			desc_stats_enabled;
+	uint32_t		num_desc_stats;
+	struct bdev_desc_ch_stat *desc_stats;
+
 #ifdef SPDK_CONFIG_VTUNE
 	uint64_t		start_tsc;
 	uint64_t		interval_tsc;
@@ -302,6 +426,23 @@ struct spdk_bdev_channel {
 	bdev_io_tailq_t		queued_resets;
 
 	lba_range_tailq_t	locked_ranges;
+
+	/*
+	 * Queue of I/O submitted on this channel and waiting for QoS budget.
+	 */
+	bdev_io_tailq_t		qos_queued;
+
+	/* Poller that resubmits I/O in qos_queued each timeslice. */
+	struct spdk_poller	*qos_poller;
+
+	/*
+	 * QoS object enforced by this channel. The channel holds a reference on it, so
+	 *  it stays valid even if bdev->internal.qos is swapped or cleared meanwhile.
+	 */
+	struct spdk_bdev_qos	*qos;
+
+	/* Per class counts, indexed by class id, allocated along with the reference on qos. */
+	struct bdev_qos_class_ch_stat *qos_class_stats;
 };
 
 struct media_event_entry {
@@ -331,6 +472,21 @@ struct spdk_bdev_desc {
 	spdk_bdev_io_timeout_cb	cb_fn;
 	void			*cb_arg;
 	struct spdk_poller	*io_timeout_poller;
+
+	char				*qos_class_name;
+	/* Index of the class in bdev->internal.qos, -1 if none. Accessed atomically. */
+	int				qos_class_id;
+
+	/* Per descriptor statistics, see struct bdev_desc_ch_stat. */
+	uint64_t			stat_id;
+	uint32_t			stat_slot;
+	char				*stat_label;
+	/* Statistics moved over from destroyed channels */
+	struct spdk_bdev_io_stat	stat;
+	/* Totals at the previous spdk_bdev_get_desc_stats() */
+	uint64_t			stat_prev_ops;
+	uint64_t			stat_prev_bytes;
+	uint64_t			stat_prev_tsc;
 };
 
 struct spdk_bdev_iostat_ctx {
@@ -377,6 +533,7 @@ bdev_unlock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *_ch,
 		      lock_range_cb cb_fn, void *cb_arg);
 
 static inline void bdev_io_complete(void *ctx);
+static void bdev_io_complete_desc_stat_direct(struct spdk_bdev_io *bdev_io);
 
 static bool bdev_abort_queued_io(bdev_io_tailq_t *queue, struct spdk_bdev_io *bio_to_abort);
 static bool bdev_abort_buf_io(bdev_io_stailq_t *queue, struct spdk_bdev_io *bio_to_abort);
@@ -406,10 +563,14 @@ spdk_bdev_get_opts(struct spdk_bdev_opts *opts, size_t opts_size)
 	SET_FIELD(bdev_auto_examine);
 	SET_FIELD(small_buf_pool_size);
 	SET_FIELD(large_buf_pool_size);
+	SET_FIELD(bdev_io_pool_size_per_socket);
+	SET_FIELD(small_buf_pool_size_per_socket);
+	SET_FIELD(large_buf_pool_size_per_socket);
+	SET_FIELD(numa_pools);
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_opts) == 32, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_opts) == 48, "Incorrect size");
 
 #undef SET_FIELD
 }
@@ -453,6 +614,30 @@ spdk_bdev_set_opts(struct spdk_bdev_opts *opts)
 		return -1;
 	}
 
+	/* Each node may end up serving every thread, so its pools need the same minimum sizes */
+	if (opts->opts_size >= offsetof(struct spdk_bdev_opts, large_buf_pool_size_per_socket) +
+	    sizeof(opts->large_buf_pool_size_per_socket)) {
+		if (opts->bdev_io_pool_size_per_socket != 0 &&
+		    opts->bdev_io_pool_size_per_socket < min_pool_size) {
+			SPDK_ERRLOG("bdev_io_pool_size_per_socket must be at least %" PRIu32 "\n", min_pool_size);
+			return -1;
+		}
+
+		if (opts->small_buf_pool_size_per_socket != 0 &&
+		    opts->small_buf_pool_size_per_socket < BUF_SMALL_POOL_SIZE) {
+			SPDK_ERRLOG("small_buf_pool_size_per_socket must be at least %" PRIu32 "\n",
+				    BUF_SMALL_POOL_SIZE);
+			return -1;
+		}
+
+		if (opts->large_buf_pool_size_per_socket != 0 &&
+		    opts->large_buf_pool_size_per_socket < BUF_LARGE_POOL_SIZE) {
+			SPDK_ERRLOG("large_buf_pool_size_per_socket must be at least %" PRIu32 "\n",
+				    BUF_LARGE_POOL_SIZE);
+			return -1;
+		}
+	}
+
 #define SET_FIELD(field) \
         if (offsetof(struct spdk_bdev_opts, field) + sizeof(opts->field) <= opts->opts_size) { \
                 g_bdev_opts.field = opts->field; \
@@ -463,6 +648,10 @@ spdk_bdev_set_opts(struct spdk_bdev_opts *opts)
 	SET_FIELD(bdev_auto_examine);
 	SET_FIELD(small_buf_pool_size);
 	SET_FIELD(large_buf_pool_size);
+	SET_FIELD(bdev_io_pool_size_per_socket);
+	SET_FIELD(small_buf_pool_size_per_socket);
+	SET_FIELD(large_buf_pool_size_per_socket);
+	SET_FIELD(numa_pools);
 
 	g_bdev_opts.opts_size = opts->opts_size;
 
@@ -880,7 +1069,7 @@ bdev_io_get_buf_complete(struct spdk_bdev_io *bdev_io, void *buf, bool status)
 }
 
 static void
-_bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, uint64_t len)
+_bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, uint8_t pool_idx, uint64_t len)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
 	bool buf_allocated;
@@ -888,10 +1077,13 @@ _bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, uint64_t len)
 	void *aligned_buf;
 
 	if (spdk_unlikely(bdev_io->internal.get_aux_buf_cb != NULL)) {
+		bdev_io->internal.aux_buf_pool_idx = pool_idx;
 		bdev_io_get_buf_complete(bdev_io, buf, true);
 		return;
 	}
 
+	bdev_io->internal.buf_pool_idx = pool_idx;
+
 	alignment = spdk_bdev_get_buf_align(bdev);
 	buf_allocated = _is_buf_allocated(bdev_io->u.bdev.iovs);
 	aligned_buf = (void *)(((uintptr_t)buf + (alignment - 1)) & ~(alignment - 1));
@@ -917,11 +1109,71 @@ _bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, uint64_t len)
 	bdev_io_get_buf_complete(bdev_io, buf, true);
 }
 
+static inline uint32_t
+bdev_local_pool_idx(void)
+{
+	uint32_t core = spdk_env_get_current_core();
+
+	/* Threads not running on an SPDK core use the pools of the first node */
+	if (spdk_unlikely(core >= g_bdev_mgr.num_cores)) {
+		return 0;
+	}
+
+	return g_bdev_mgr.core_pool_idx[core];
+}
+
+static void *
+bdev_pool_get(enum bdev_pool_type type, uint8_t *pool_idx)
+{
+	uint32_t local_idx, idx, i;
+	void *obj;
+
+	local_idx = bdev_local_pool_idx();
+	obj = spdk_mempool_get(g_bdev_mgr.pools[local_idx].pool[type]);
+	if (spdk_likely(obj != NULL)) {
+		*pool_idx = local_idx;
+		return obj;
+	}
+
+	/* Take from the other nodes rather than making the caller wait */
+	for (i = 1; i < g_bdev_mgr.num_pools; i++) {
+		idx = (local_idx + i) % g_bdev_mgr.num_pools;
+		obj = spdk_mempool_get(g_bdev_mgr.pools[idx].pool[type]);
+		if (obj != NULL) {
+			__atomic_fetch_add(&g_bdev_mgr.pools[idx].remote_allocs[type], 1, __ATOMIC_RELAXED);
+			*pool_idx = idx;
+			return obj;
+		}
+	}
+
+	return NULL;
+}
+
+static inline void
+bdev_pool_put(enum bdev_pool_type type, uint8_t pool_idx, void *obj)
+{
+	spdk_mempool_put(g_bdev_mgr.pools[pool_idx].pool[type], obj);
+}
+
+static struct spdk_bdev_io *
+bdev_io_pool_get(void)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint8_t pool_idx;
+
+	bdev_io = bdev_pool_get(BDEV_POOL_BDEV_IO, &pool_idx);
+	if (bdev_io != NULL) {
+		bdev_io->internal.pool_idx = pool_idx;
+	}
+
+	return bdev_io;
+}
+
 static void
-_bdev_io_put_buf(struct spdk_bdev_io *bdev_io, void *buf, uint64_t buf_len)
+_bdev_io_put_buf(struct spdk_bdev_io *bdev_io, void *buf, uint8_t pool_idx, uint64_t buf_len)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
-	struct spdk_mempool *pool;
+	enum bdev_pool_type type;
 	struct spdk_bdev_io *tmp;
 	bdev_io_stailq_t *stailq;
 	struct spdk_bdev_mgmt_channel *ch;
@@ -933,19 +1185,19 @@ _bdev_io_put_buf(struct spdk_bdev_io *bdev_io, void *buf, uint64_t buf_len)
 
 	if (buf_len + alignment + md_len <= SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
 	    SPDK_BDEV_POOL_ALIGNMENT) {
-		pool = g_bdev_mgr.buf_small_pool;
+		type = BDEV_POOL_BUF_SMALL;
 		stailq = &ch->need_buf_small;
 	} else {
-		pool = g_bdev_mgr.buf_large_pool;
+		type = BDEV_POOL_BUF_LARGE;
 		stailq = &ch->need_buf_large;
 	}
 
 	if (STAILQ_EMPTY(stailq)) {
-		spdk_mempool_put(pool, buf);
+		bdev_pool_put(type, pool_idx, buf);
 	} else {
 		tmp = STAILQ_FIRST(stailq);
 		STAILQ_REMOVE_HEAD(stailq, internal.buf_link);
-		_bdev_io_set_buf(tmp, buf, tmp->internal.buf_len);
+		_bdev_io_set_buf(tmp, buf, pool_idx, tmp->internal.buf_len);
 	}
 }
 
@@ -953,7 +1205,8 @@ static void
 bdev_io_put_buf(struct spdk_bdev_io *bdev_io)
 {
 	assert(bdev_io->internal.buf != NULL);
-	_bdev_io_put_buf(bdev_io, bdev_io->internal.buf, bdev_io->internal.buf_len);
+	_bdev_io_put_buf(bdev_io, bdev_io->internal.buf, bdev_io->internal.buf_pool_idx,
+			 bdev_io->internal.buf_len);
 	bdev_io->internal.buf = NULL;
 }
 
@@ -963,7 +1216,7 @@ spdk_bdev_io_put_aux_buf(struct spdk_bdev_io *bdev_io, void *buf)
 	uint64_t len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
 
 	assert(buf != NULL);
-	_bdev_io_put_buf(bdev_io, buf, len);
+	_bdev_io_put_buf(bdev_io, buf, bdev_io->internal.aux_buf_pool_idx, len);
 }
 
 static void
@@ -1013,10 +1266,11 @@ static void
 bdev_io_get_buf(struct spdk_bdev_io *bdev_io, uint64_t len)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
-	struct spdk_mempool *pool;
+	enum bdev_pool_type type;
 	bdev_io_stailq_t *stailq;
 	struct spdk_bdev_mgmt_channel *mgmt_ch;
 	uint64_t alignment, md_len;
+	uint8_t pool_idx;
 	void *buf;
 
 	alignment = spdk_bdev_get_buf_align(bdev);
@@ -1036,18 +1290,18 @@ bdev_io_get_buf(struct spdk_bdev_io *bdev_io, uint64_t len)
 
 	if (len + alignment + md_len <= SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
 	    SPDK_BDEV_POOL_ALIGNMENT) {
-		pool = g_bdev_mgr.buf_small_pool;
+		type = BDEV_POOL_BUF_SMALL;
 		stailq = &mgmt_ch->need_buf_small;
 	} else {
-		pool = g_bdev_mgr.buf_large_pool;
+		type = BDEV_POOL_BUF_LARGE;
 		stailq = &mgmt_ch->need_buf_large;
 	}
 
-	buf = spdk_mempool_get(pool);
+	buf = bdev_pool_get(type, &pool_idx);
 	if (!buf) {
 		STAILQ_INSERT_TAIL(stailq, bdev_io, internal.buf_link);
 	} else {
-		_bdev_io_set_buf(bdev_io, buf, len);
+		_bdev_io_set_buf(bdev_io, buf, pool_idx, len);
 	}
 }
 
@@ -1103,13 +1357,46 @@ bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
 	int i;
 	struct spdk_bdev_qos *qos = bdev->internal.qos;
+	struct spdk_bdev_qos_class *qos_class;
 	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	bool limited = false;
 
 	if (!qos) {
 		return;
 	}
 
+	pthread_mutex_lock(&bdev->internal.mutex);
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		qos_class = &qos->classes[i];
+		if (qos_class->name == NULL) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_set_qos_class");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		spdk_json_write_named_string(w, "class", qos_class->name);
+		spdk_json_write_named_uint32(w, "weight", qos_class->weight);
+		spdk_json_write_named_uint64(w, "latency_target_us",
+					     qos_class->latency_target_ticks * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
 	spdk_bdev_get_qos_rate_limits(bdev, limits);
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (limits[i] > 0) {
+			limited = true;
+		}
+	}
+
+	if (!limited) {
+		return;
+	}
 
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
@@ -1142,6 +1429,19 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "bdev_io_pool_size", g_bdev_opts.bdev_io_pool_size);
 	spdk_json_write_named_uint32(w, "bdev_io_cache_size", g_bdev_opts.bdev_io_cache_size);
 	spdk_json_write_named_bool(w, "bdev_auto_examine", g_bdev_opts.bdev_auto_examine);
+	if (g_bdev_opts.bdev_io_pool_size_per_socket != 0) {
+		spdk_json_write_named_uint32(w, "bdev_io_pool_size_per_socket",
+					     g_bdev_opts.bdev_io_pool_size_per_socket);
+	}
+	if (g_bdev_opts.small_buf_pool_size_per_socket != 0) {
+		spdk_json_write_named_uint32(w, "small_buf_pool_size_per_socket",
+					     g_bdev_opts.small_buf_pool_size_per_socket);
+	}
+	if (g_bdev_opts.large_buf_pool_size_per_socket != 0) {
+		spdk_json_write_named_uint32(w, "large_buf_pool_size_per_socket",
+					     g_bdev_opts.large_buf_pool_size_per_socket);
+	}
+	spdk_json_write_named_bool(w, "numa_pools", g_bdev_opts.numa_pools);
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 
@@ -1189,7 +1489,7 @@ bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 	/* Pre-populate bdev_io cache to ensure this thread cannot be starved. */
 	ch->per_thread_cache_count = 0;
 	for (i = 0; i < ch->bdev_io_cache_size; i++) {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		bdev_io = bdev_io_pool_get();
 		assert(bdev_io != NULL);
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
@@ -1219,7 +1519,7 @@ bdev_mgmt_channel_destroy(void *io_device, void *ctx_buf)
 		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
 		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
 		ch->per_thread_cache_count--;
-		spdk_mempool_put(g_bdev_mgr.bdev_io_pool, (void *)bdev_io);
+		bdev_pool_put(BDEV_POOL_BDEV_IO, bdev_io->internal.pool_idx, bdev_io);
 	}
 
 	assert(ch->per_thread_cache_count == 0);
@@ -1350,67 +1650,222 @@ bdev_modules_init(void)
 	return 0;
 }
 
-void
-spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
+static struct spdk_mempool *
+bdev_numa_pool_create(const char *prefix, uint32_t socket_id, size_t count, size_t ele_size,
+		      size_t cache_size)
 {
-	int cache_size;
-	int rc = 0;
+	struct spdk_mempool *pool;
 	char mempool_name[32];
 
-	assert(cb_fn != NULL);
+	if (g_bdev_mgr.num_pools == 1) {
+		snprintf(mempool_name, sizeof(mempool_name), "%s_%d", prefix, getpid());
+	} else {
+		snprintf(mempool_name, sizeof(mempool_name), "%s_%d_%" PRIu32, prefix, getpid(), socket_id);
+	}
 
-	g_init_cb_fn = cb_fn;
-	g_init_cb_arg = cb_arg;
+	pool = spdk_mempool_create(mempool_name, count, ele_size, cache_size, socket_id);
+	if (pool == NULL && socket_id != (uint32_t)SPDK_ENV_SOCKET_ID_ANY) {
+		/* The node may be short on hugepages, the pool still serves its threads first */
+		SPDK_WARNLOG("could not allocate %s on socket %" PRIu32 ", trying any socket\n",
+			     mempool_name, socket_id);
+		pool = spdk_mempool_create(mempool_name, count, ele_size, cache_size,
+					   SPDK_ENV_SOCKET_ID_ANY);
+	}
 
-	spdk_notify_type_register("bdev_register");
-	spdk_notify_type_register("bdev_unregister");
+	return pool;
+}
+
+/*
+ * Size of the pools of one node, either set explicitly or an even share of the total.  A single
+ *  set of pools shared by all nodes gets the total.
+ */
+static uint32_t
+bdev_numa_pool_size(uint32_t total, uint32_t per_socket, uint32_t idx)
+{
+	if (per_socket != 0 && g_bdev_opts.numa_pools) {
+		return per_socket;
+	}
 
-	snprintf(mempool_name, sizeof(mempool_name), "bdev_io_%d", getpid());
+	return total / g_bdev_mgr.num_pools + (idx < total % g_bdev_mgr.num_pools ? 1 : 0);
+}
 
-	g_bdev_mgr.bdev_io_pool = spdk_mempool_create(mempool_name,
-				  g_bdev_opts.bdev_io_pool_size,
-				  sizeof(struct spdk_bdev_io) +
-				  bdev_module_get_max_ctx_size(),
-				  0,
-				  SPDK_ENV_SOCKET_ID_ANY);
+static int
+bdev_numa_pools_init(void)
+{
+	struct bdev_numa_pools *pools;
+	uint32_t core, socket_id, cache_size, i;
 
-	if (g_bdev_mgr.bdev_io_pool == NULL) {
-		SPDK_ERRLOG("could not allocate spdk_bdev_io pool\n");
-		bdev_init_complete(-1);
-		return;
+	g_bdev_mgr.num_cores = spdk_env_get_last_core() + 1;
+	g_bdev_mgr.core_pool_idx = calloc(spdk_max(g_bdev_mgr.num_cores, 1), sizeof(uint8_t));
+	g_bdev_mgr.pools = calloc(BDEV_MAX_NUMA_POOLS, sizeof(struct bdev_numa_pools));
+	if (g_bdev_mgr.core_pool_idx == NULL || g_bdev_mgr.pools == NULL) {
+		SPDK_ERRLOG("could not allocate bdev pools\n");
+		return -ENOMEM;
 	}
 
-	/**
-	 * Ensure no more than half of the total buffers end up local caches, by
-	 *   using spdk_env_get_core_count() to determine how many local caches we need
-	 *   to account for.
-	 */
-	cache_size = BUF_SMALL_POOL_SIZE / (2 * spdk_env_get_core_count());
-	snprintf(mempool_name, sizeof(mempool_name), "buf_small_pool_%d", getpid());
-
-	g_bdev_mgr.buf_small_pool = spdk_mempool_create(mempool_name,
-				    g_bdev_opts.small_buf_pool_size,
-				    SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
-				    SPDK_BDEV_POOL_ALIGNMENT,
-				    cache_size,
-				    SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_bdev_mgr.buf_small_pool) {
-		SPDK_ERRLOG("create rbuf small pool failed\n");
-		bdev_init_complete(-1);
-		return;
+	/* Without NUMA pools, every core uses the single set of pools created below */
+	if (g_bdev_opts.numa_pools) {
+		SPDK_ENV_FOREACH_CORE(core) {
+			socket_id = spdk_env_get_socket_id(core);
+			for (i = 0; i < g_bdev_mgr.num_pools; i++) {
+				if (g_bdev_mgr.pools[i].socket_id == socket_id) {
+					break;
+				}
+			}
+
+			if (i == g_bdev_mgr.num_pools) {
+				if (i == BDEV_MAX_NUMA_POOLS) {
+					i = 0;
+				} else {
+					pools = &g_bdev_mgr.pools[g_bdev_mgr.num_pools++];
+					pools->socket_id = socket_id;
+				}
+			}
+
+			g_bdev_mgr.core_pool_idx[core] = i;
+		}
+	}
+
+	if (g_bdev_mgr.num_pools == 0) {
+		g_bdev_mgr.pools[0].socket_id = SPDK_ENV_SOCKET_ID_ANY;
+		g_bdev_mgr.num_pools = 1;
+	}
+
+	for (i = 0; i < g_bdev_mgr.num_pools; i++) {
+		pools = &g_bdev_mgr.pools[i];
+
+		pools->size[BDEV_POOL_BDEV_IO] = bdev_numa_pool_size(g_bdev_opts.bdev_io_pool_size,
+						 g_bdev_opts.bdev_io_pool_size_per_socket, i);
+		pools->size[BDEV_POOL_BUF_SMALL] = bdev_numa_pool_size(g_bdev_opts.small_buf_pool_size,
+						   g_bdev_opts.small_buf_pool_size_per_socket, i);
+		pools->size[BDEV_POOL_BUF_LARGE] = bdev_numa_pool_size(g_bdev_opts.large_buf_pool_size,
+						   g_bdev_opts.large_buf_pool_size_per_socket, i);
+
+		pools->pool[BDEV_POOL_BDEV_IO] = bdev_numa_pool_create("bdev_io", pools->socket_id,
+						 pools->size[BDEV_POOL_BDEV_IO],
+						 sizeof(struct spdk_bdev_io) +
+						 bdev_module_get_max_ctx_size(),
+						 0);
+		if (pools->pool[BDEV_POOL_BDEV_IO] == NULL) {
+			SPDK_ERRLOG("could not allocate spdk_bdev_io pool\n");
+			return -ENOMEM;
+		}
+
+		/**
+		 * Ensure no more than half of the total buffers end up local caches, by
+		 *   using spdk_env_get_core_count() to determine how many local caches we need
+		 *   to account for.
+		 */
+		cache_size = BUF_SMALL_POOL_SIZE / (2 * spdk_env_get_core_count() * g_bdev_mgr.num_pools);
+		pools->pool[BDEV_POOL_BUF_SMALL] = bdev_numa_pool_create("buf_small_pool", pools->socket_id,
+						   pools->size[BDEV_POOL_BUF_SMALL],
+						   SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
+						   SPDK_BDEV_POOL_ALIGNMENT,
+						   cache_size);
+		if (pools->pool[BDEV_POOL_BUF_SMALL] == NULL) {
+			SPDK_ERRLOG("create rbuf small pool failed\n");
+			return -ENOMEM;
+		}
+
+		cache_size = BUF_LARGE_POOL_SIZE / (2 * spdk_env_get_core_count() * g_bdev_mgr.num_pools);
+		pools->pool[BDEV_POOL_BUF_LARGE] = bdev_numa_pool_create("buf_large_pool", pools->socket_id,
+						   pools->size[BDEV_POOL_BUF_LARGE],
+						   SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_LARGE_BUF_MAX_SIZE) +
+						   SPDK_BDEV_POOL_ALIGNMENT,
+						   cache_size);
+		if (pools->pool[BDEV_POOL_BUF_LARGE] == NULL) {
+			SPDK_ERRLOG("create rbuf large pool failed\n");
+			return -ENOMEM;
+		}
+	}
+
+	if (g_bdev_mgr.num_pools > 1) {
+		SPDK_NOTICELOG("bdev_io and buffer pools split across %" PRIu32 " NUMA nodes\n",
+			       g_bdev_mgr.num_pools);
+	}
+
+	return 0;
+}
+
+static void
+bdev_numa_pools_free(void)
+{
+	static const char *pool_names[BDEV_NUM_POOL_TYPES] = {
+		[BDEV_POOL_BDEV_IO] = "bdev IO",
+		[BDEV_POOL_BUF_SMALL] = "Small buffer",
+		[BDEV_POOL_BUF_LARGE] = "Large buffer",
+	};
+	struct bdev_numa_pools *pools;
+	uint32_t i, type;
+
+	for (i = 0; g_bdev_mgr.pools != NULL && i < g_bdev_mgr.num_pools; i++) {
+		pools = &g_bdev_mgr.pools[i];
+		for (type = 0; type < BDEV_NUM_POOL_TYPES; type++) {
+			if (pools->pool[type] == NULL) {
+				continue;
+			}
+
+			if (spdk_mempool_count(pools->pool[type]) != pools->size[type]) {
+				SPDK_ERRLOG("%s pool count is %zu but should be %u\n", pool_names[type],
+					    spdk_mempool_count(pools->pool[type]), pools->size[type]);
+				/* bdev_ios may still be held by modules when the app is torn down */
+				assert(type == BDEV_POOL_BDEV_IO);
+			}
+
+			spdk_mempool_free(pools->pool[type]);
+		}
+	}
+
+	free(g_bdev_mgr.pools);
+	g_bdev_mgr.pools = NULL;
+	g_bdev_mgr.num_pools = 0;
+	free(g_bdev_mgr.core_pool_idx);
+	g_bdev_mgr.core_pool_idx = NULL;
+	g_bdev_mgr.num_cores = 0;
+}
+
+uint32_t
+spdk_bdev_get_pool_stats(struct spdk_bdev_pool_stats *stats, uint32_t max_stats)
+{
+	struct bdev_numa_pools *pools;
+	uint32_t i;
+
+	for (i = 0; i < spdk_min(max_stats, g_bdev_mgr.num_pools); i++) {
+		pools = &g_bdev_mgr.pools[i];
+
+		stats[i].socket_id = pools->socket_id;
+		stats[i].bdev_io_pool_size = pools->size[BDEV_POOL_BDEV_IO];
+		stats[i].bdev_io_pool_free = spdk_mempool_count(pools->pool[BDEV_POOL_BDEV_IO]);
+		stats[i].small_buf_pool_size = pools->size[BDEV_POOL_BUF_SMALL];
+		stats[i].small_buf_pool_free = spdk_mempool_count(pools->pool[BDEV_POOL_BUF_SMALL]);
+		stats[i].large_buf_pool_size = pools->size[BDEV_POOL_BUF_LARGE];
+		stats[i].large_buf_pool_free = spdk_mempool_count(pools->pool[BDEV_POOL_BUF_LARGE]);
+		stats[i].remote_bdev_io_allocs = __atomic_load_n(&pools->remote_allocs[BDEV_POOL_BDEV_IO],
+						 __ATOMIC_RELAXED);
+		stats[i].remote_buf_allocs = __atomic_load_n(&pools->remote_allocs[BDEV_POOL_BUF_SMALL],
+					     __ATOMIC_RELAXED) +
+					     __atomic_load_n(&pools->remote_allocs[BDEV_POOL_BUF_LARGE],
+							     __ATOMIC_RELAXED);
 	}
 
-	cache_size = BUF_LARGE_POOL_SIZE / (2 * spdk_env_get_core_count());
-	snprintf(mempool_name, sizeof(mempool_name), "buf_large_pool_%d", getpid());
+	return g_bdev_mgr.num_pools;
+}
+
+void
+spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
+{
+	int rc = 0;
+
+	assert(cb_fn != NULL);
+
+	g_init_cb_fn = cb_fn;
+	g_init_cb_arg = cb_arg;
 
-	g_bdev_mgr.buf_large_pool = spdk_mempool_create(mempool_name,
-				    g_bdev_opts.large_buf_pool_size,
-				    SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_LARGE_BUF_MAX_SIZE) +
-				    SPDK_BDEV_POOL_ALIGNMENT,
-				    cache_size,
-				    SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_bdev_mgr.buf_large_pool) {
-		SPDK_ERRLOG("create rbuf large pool failed\n");
+	spdk_notify_type_register("bdev_register");
+	spdk_notify_type_register("bdev_unregister");
+
+	rc = bdev_numa_pools_init();
+	if (rc != 0) {
 		bdev_init_complete(-1);
 		return;
 	}
@@ -1447,37 +1902,7 @@ bdev_mgr_unregister_cb(void *io_device)
 {
 	spdk_bdev_fini_cb cb_fn = g_fini_cb_fn;
 
-	if (g_bdev_mgr.bdev_io_pool) {
-		if (spdk_mempool_count(g_bdev_mgr.bdev_io_pool) != g_bdev_opts.bdev_io_pool_size) {
-			SPDK_ERRLOG("bdev IO pool count is %zu but should be %u\n",
-				    spdk_mempool_count(g_bdev_mgr.bdev_io_pool),
-				    g_bdev_opts.bdev_io_pool_size);
-		}
-
-		spdk_mempool_free(g_bdev_mgr.bdev_io_pool);
-	}
-
-	if (g_bdev_mgr.buf_small_pool) {
-		if (spdk_mempool_count(g_bdev_mgr.buf_small_pool) != g_bdev_opts.small_buf_pool_size) {
-			SPDK_ERRLOG("Small buffer pool count is %zu but should be %u\n",
-				    spdk_mempool_count(g_bdev_mgr.buf_small_pool),
-				    g_bdev_opts.small_buf_pool_size);
-			assert(false);
-		}
-
-		spdk_mempool_free(g_bdev_mgr.buf_small_pool);
-	}
-
-	if (g_bdev_mgr.buf_large_pool) {
-		if (spdk_mempool_count(g_bdev_mgr.buf_large_pool) != g_bdev_opts.large_buf_pool_size) {
-			SPDK_ERRLOG("Large buffer pool count is %zu but should be %u\n",
-				    spdk_mempool_count(g_bdev_mgr.buf_large_pool),
-				    g_bdev_opts.large_buf_pool_size);
-			assert(false);
-		}
-
-		spdk_mempool_free(g_bdev_mgr.buf_large_pool);
-	}
+	bdev_numa_pools_free();
 
 	spdk_free(g_bdev_mgr.zero_buffer);
 
@@ -1697,7 +2122,7 @@ bdev_channel_get_io(struct spdk_bdev_channel *channel)
 		 */
 		bdev_io = NULL;
 	} else {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		bdev_io = bdev_io_pool_get();
 	}
 
 	return bdev_io;
@@ -1717,7 +2142,10 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 		bdev_io_put_buf(bdev_io);
 	}
 
-	if (ch->per_thread_cache_count < ch->bdev_io_cache_size) {
+	/* bdev_ios of other nodes go back to their pools, unless someone is waiting for one */
+	if (ch->per_thread_cache_count < ch->bdev_io_cache_size &&
+	    (bdev_io->internal.pool_idx == bdev_local_pool_idx() ||
+	     !TAILQ_EMPTY(&ch->io_wait_queue))) {
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
 		while (ch->per_thread_cache_count > 0 && !TAILQ_EMPTY(&ch->io_wait_queue)) {
@@ -1730,7 +2158,7 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 	} else {
 		/* We should never have a full cache with entries on the io wait queue. */
 		assert(TAILQ_EMPTY(&ch->io_wait_queue));
-		spdk_mempool_put(g_bdev_mgr.bdev_io_pool, (void *)bdev_io);
+		bdev_pool_put(BDEV_POOL_BDEV_IO, bdev_io->internal.pool_idx, bdev_io);
 	}
 }
 
@@ -1825,7 +2253,8 @@ bdev_get_io_size_in_byte(struct spdk_bdev_io *bdev_io)
 static bool
 bdev_qos_rw_queue_io(const struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
 {
-	if (limit->max_per_timeslice > 0 && limit->remaining_this_timeslice <= 0) {
+	if (__atomic_load_n(&limit->max_per_timeslice, __ATOMIC_RELAXED) > 0 &&
+	    __atomic_load_n(&limit->remaining_this_timeslice, __ATOMIC_RELAXED) <= 0) {
 		return true;
 	} else {
 		return false;
@@ -1855,13 +2284,14 @@ bdev_qos_w_queue_io(const struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io
 static void
 bdev_qos_rw_iops_update_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
 {
-	limit->remaining_this_timeslice--;
+	__atomic_sub_fetch(&limit->remaining_this_timeslice, 1, __ATOMIC_RELAXED);
 }
 
 static void
 bdev_qos_rw_bps_update_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
 {
-	limit->remaining_this_timeslice -= bdev_get_io_size_in_byte(io);
+	__atomic_sub_fetch(&limit->remaining_this_timeslice, bdev_get_io_size_in_byte(io),
+			   __ATOMIC_RELAXED);
 }
 
 static void
@@ -1884,6 +2314,15 @@ bdev_qos_w_bps_update_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_
 	return bdev_qos_rw_bps_update_quota(limit, io);
 }
 
+static void
+bdev_qos_limit_set_ops(struct spdk_bdev_qos_limit *limit,
+		       bool (*queue_io)(const struct spdk_bdev_qos_limit *, struct spdk_bdev_io *),
+		       void (*update_quota)(struct spdk_bdev_qos_limit *, struct spdk_bdev_io *))
+{
+	__atomic_store_n(&limit->queue_io, queue_io, __ATOMIC_RELAXED);
+	__atomic_store_n(&limit->update_quota, update_quota, __ATOMIC_RELAXED);
+}
+
 static void
 bdev_qos_set_ops(struct spdk_bdev_qos *qos)
 {
@@ -1891,27 +2330,26 @@ bdev_qos_set_ops(struct spdk_bdev_qos *qos)
 
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 		if (qos->rate_limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
-			qos->rate_limits[i].queue_io = NULL;
-			qos->rate_limits[i].update_quota = NULL;
+			bdev_qos_limit_set_ops(&qos->rate_limits[i], NULL, NULL);
 			continue;
 		}
 
 		switch (i) {
 		case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_rw_queue_io;
-			qos->rate_limits[i].update_quota = bdev_qos_rw_iops_update_quota;
+			bdev_qos_limit_set_ops(&qos->rate_limits[i], bdev_qos_rw_queue_io,
+					       bdev_qos_rw_iops_update_quota);
 			break;
 		case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_rw_queue_io;
-			qos->rate_limits[i].update_quota = bdev_qos_rw_bps_update_quota;
+			bdev_qos_limit_set_ops(&qos->rate_limits[i], bdev_qos_rw_queue_io,
+					       bdev_qos_rw_bps_update_quota);
 			break;
 		case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_r_queue_io;
-			qos->rate_limits[i].update_quota = bdev_qos_r_bps_update_quota;
+			bdev_qos_limit_set_ops(&qos->rate_limits[i], bdev_qos_r_queue_io,
+					       bdev_qos_r_bps_update_quota);
 			break;
 		case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
-			qos->rate_limits[i].queue_io = bdev_qos_w_queue_io;
-			qos->rate_limits[i].update_quota = bdev_qos_w_bps_update_quota;
+			bdev_qos_limit_set_ops(&qos->rate_limits[i], bdev_qos_w_queue_io,
+					       bdev_qos_w_bps_update_quota);
 			break;
 		default:
 			break;
@@ -1964,54 +2402,295 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 	}
 }
 
-static int
-bdev_qos_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
+static void
+bdev_qos_refill(int64_t *remaining_this_timeslice, uint64_t max_per_timeslice,
+		uint64_t num_timeslices)
 {
-	struct spdk_bdev_io		*bdev_io = NULL, *tmp = NULL;
-	int				i, submitted_ios = 0;
-
-	TAILQ_FOREACH_SAFE(bdev_io, &qos->queued, internal.link, tmp) {
-		if (bdev_qos_io_to_limit(bdev_io) == true) {
-			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-				if (!qos->rate_limits[i].queue_io) {
-					continue;
-				}
-
-				if (qos->rate_limits[i].queue_io(&qos->rate_limits[i],
-								 bdev_io) == true) {
-					return submitted_ios;
-				}
-			}
-			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-				if (!qos->rate_limits[i].update_quota) {
-					continue;
-				}
+	int64_t remaining, refilled;
 
-				qos->rate_limits[i].update_quota(&qos->rate_limits[i], bdev_io);
-			}
-		}
-
-		TAILQ_REMOVE(&qos->queued, bdev_io, internal.link);
-		bdev_io_do_submit(ch, bdev_io);
-		submitted_ios++;
-	}
+	/* Bound the multiplication below; a single refill never exceeds one timeslice anyway. */
+	num_timeslices = spdk_min(num_timeslices, UINT32_MAX);
 
-	return submitted_ios;
+	remaining = __atomic_load_n(remaining_this_timeslice, __ATOMIC_RELAXED);
+	do {
+		/* We may have allowed the IOs or bytes to slightly overrun in the last
+		 * timeslice. remaining_this_timeslice is signed, so if it's negative
+		 * here, we'll account for the overrun so that the next timeslice will
+		 * be appropriately reduced. Unused budget is not carried over.
+		 */
+		refilled = spdk_min(remaining, 0) + (int64_t)(num_timeslices * max_per_timeslice);
+		refilled = spdk_min(refilled, (int64_t)max_per_timeslice);
+	} while (!__atomic_compare_exchange_n(remaining_this_timeslice, &remaining, refilled, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 }
 
 static void
-bdev_queue_io_wait_with_cb(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn)
+bdev_qos_classes_evaluate(struct spdk_bdev_qos *qos, uint64_t window_timeslices)
 {
-	int rc;
+	struct spdk_bdev_qos_class *qos_class;
+	uint32_t weights[SPDK_BDEV_QOS_MAX_CLASSES];
+	uint64_t window_over_target, total_ios = 0, total_weight = 0, share, max_per_timeslice;
+	bool latency_target_missed = false, missed;
+	int i;
 
-	bdev_io->internal.waitq_entry.bdev = bdev_io->bdev;
-	bdev_io->internal.waitq_entry.cb_fn = cb_fn;
+	/*
+	 * Classes may be created or deleted under the bdev mutex meanwhile. Each one is
+	 *  evaluated with the weight read here, and skipped if its slot was free.
+	 */
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		qos_class = &qos->classes[i];
+		weights[i] = __atomic_load_n(&qos_class->weight, __ATOMIC_ACQUIRE);
+		if (weights[i] == 0) {
+			continue;
+		}
+
+		qos_class->last_window_ios = __atomic_exchange_n(&qos_class->window_ios, 0,
+					     __ATOMIC_RELAXED);
+		window_over_target = __atomic_exchange_n(&qos_class->window_over_target, 0,
+				     __ATOMIC_RELAXED);
+
+		/* The 99th percentile is over the target if more than 1% of the I/O missed it. */
+		missed = window_over_target * 100 > qos_class->last_window_ios;
+		__atomic_store_n(&qos_class->latency_target_missed, missed, __ATOMIC_RELAXED);
+		latency_target_missed |= missed;
+
+		total_ios += qos_class->last_window_ios;
+		total_weight += weights[i];
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		qos_class = &qos->classes[i];
+		if (weights[i] == 0) {
+			continue;
+		}
+
+		max_per_timeslice = __atomic_load_n(&qos_class->max_per_timeslice, __ATOMIC_RELAXED);
+		if (__atomic_load_n(&qos_class->latency_target_ticks, __ATOMIC_RELAXED) != 0) {
+			/* Protected classes are never throttled. */
+			max_per_timeslice = 0;
+		} else if (latency_target_missed) {
+			/*
+			 * Shrink what the bdev completed in the last window and give each
+			 *  class its weighted share of it. This repeats every window until
+			 *  all latency targets are met again.
+			 */
+			share = total_ios * 3 / 4 / window_timeslices * weights[i] / total_weight;
+			share = spdk_max(share, SPDK_BDEV_QOS_MIN_IO_PER_TIMESLICE);
+			if (max_per_timeslice == 0 || share < max_per_timeslice) {
+				max_per_timeslice = share;
+			}
+		} else if (max_per_timeslice != 0) {
+			/* Back off gradually, and stop throttling once the class uses less than half its budget. */
+			if (qos_class->last_window_ios * 2 < max_per_timeslice * window_timeslices) {
+				max_per_timeslice = 0;
+			} else {
+				max_per_timeslice += max_per_timeslice / 8 + 1;
+			}
+		}
+
+		__atomic_store_n(&qos_class->max_per_timeslice, max_per_timeslice, __ATOMIC_RELAXED);
+		__atomic_store_n(&qos_class->remaining_this_timeslice, max_per_timeslice,
+				 __ATOMIC_RELAXED);
+	}
+}
+
+/* Only called by the channel that advanced last_timeslice, so no lock is needed. */
+static void
+bdev_qos_classes_update(struct spdk_bdev_qos *qos, uint64_t num_timeslices)
+{
+	struct spdk_bdev_qos_class *qos_class;
+	uint64_t max_per_timeslice;
+	int i;
+
+	qos->class_window_timeslices += num_timeslices;
+	if (qos->class_window_timeslices >= SPDK_BDEV_QOS_CLASS_WINDOW_TIMESLICES) {
+		bdev_qos_classes_evaluate(qos, qos->class_window_timeslices);
+		qos->class_window_timeslices = 0;
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		qos_class = &qos->classes[i];
+		max_per_timeslice = __atomic_load_n(&qos_class->max_per_timeslice, __ATOMIC_RELAXED);
+		if (max_per_timeslice != 0) {
+			bdev_qos_refill(&qos_class->remaining_this_timeslice, max_per_timeslice,
+					num_timeslices);
+		}
+	}
+}
+
+static void
+bdev_qos_update_timeslice(struct spdk_bdev_qos *qos, uint64_t now)
+{
+	uint64_t last_timeslice, num_timeslices;
+	uint32_t max_per_timeslice;
+	int i;
+
+	last_timeslice = __atomic_load_n(&qos->last_timeslice, __ATOMIC_RELAXED);
+	if (spdk_likely(now < last_timeslice + qos->timeslice_size)) {
+		return;
+	}
+
+	/*
+	 * Any channel may notice that the timeslice has expired. Only the one that
+	 *  manages to advance last_timeslice refills the shared budgets.
+	 */
+	num_timeslices = (now - last_timeslice) / qos->timeslice_size;
+	if (!__atomic_compare_exchange_n(&qos->last_timeslice, &last_timeslice,
+					 last_timeslice + num_timeslices * qos->timeslice_size,
+					 false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		max_per_timeslice = __atomic_load_n(&qos->rate_limits[i].max_per_timeslice,
+						    __ATOMIC_RELAXED);
+		bdev_qos_refill(&qos->rate_limits[i].remaining_this_timeslice, max_per_timeslice,
+				num_timeslices);
+	}
+
+	if (__atomic_load_n(&qos->num_classes, __ATOMIC_RELAXED) != 0) {
+		bdev_qos_classes_update(qos, num_timeslices);
+	}
+}
+
+static bool
+bdev_qos_class_queue_io(const struct spdk_bdev_qos_class *qos_class)
+{
+	return __atomic_load_n(&qos_class->max_per_timeslice, __ATOMIC_RELAXED) > 0 &&
+	       __atomic_load_n(&qos_class->remaining_this_timeslice, __ATOMIC_RELAXED) <= 0;
+}
+
+static inline int
+bdev_desc_get_qos_class_id(struct spdk_bdev_desc *desc)
+{
+	return __atomic_load_n(&desc->qos_class_id, __ATOMIC_RELAXED);
+}
+
+/* Counted on the channel, and added to the class by bdev_channel_flush_qos_class_stats(). */
+static void
+bdev_qos_class_io_complete(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bdev_io,
+			   uint64_t tsc_diff)
+{
+	struct bdev_qos_class_ch_stat *stat;
+	uint64_t latency_target_ticks;
+	int id;
+
+	id = bdev_desc_get_qos_class_id(bdev_io->internal.desc);
+	if (id < 0 || ch->qos_class_stats == NULL) {
+		return;
+	}
+
+	stat = &ch->qos_class_stats[id];
+	stat->num_ios++;
+	stat->bytes += bdev_get_io_size_in_byte(bdev_io);
+	stat->latency_ticks += tsc_diff;
+
+	latency_target_ticks = __atomic_load_n(&ch->qos->classes[id].latency_target_ticks,
+					       __ATOMIC_RELAXED);
+	if (latency_target_ticks != 0 && tsc_diff > latency_target_ticks) {
+		stat->num_over_target++;
+	}
+}
+
+static void
+bdev_channel_flush_qos_class_stats(struct spdk_bdev_channel *ch)
+{
+	struct bdev_qos_class_ch_stat *stat;
+	struct spdk_bdev_qos_class *qos_class;
+	int i;
+
+	if (ch->qos_class_stats == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		stat = &ch->qos_class_stats[i];
+		if (stat->num_ios == 0) {
+			continue;
+		}
+
+		qos_class = &ch->qos->classes[i];
+		__atomic_add_fetch(&qos_class->window_ios, stat->num_ios, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&qos_class->window_over_target, stat->num_over_target,
+				   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&qos_class->num_ios, stat->num_ios, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&qos_class->bytes, stat->bytes, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&qos_class->latency_ticks, stat->latency_ticks, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&qos_class->num_over_target, stat->num_over_target,
+				   __ATOMIC_RELAXED);
+		memset(stat, 0, sizeof(*stat));
+	}
+}
+
+static int
+bdev_qos_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
+{
+	struct spdk_bdev_io		*bdev_io = NULL, *tmp = NULL;
+	struct spdk_bdev_qos_class	*qos_class;
+	struct spdk_bdev_qos_limit	*limit;
+	int				qos_class_id;
+	bool (*queue_io)(const struct spdk_bdev_qos_limit *, struct spdk_bdev_io *);
+	void (*update_quota)(struct spdk_bdev_qos_limit *, struct spdk_bdev_io *);
+	int				i, submitted_ios = 0;
+
+	TAILQ_FOREACH_SAFE(bdev_io, &ch->qos_queued, internal.link, tmp) {
+		if (bdev_qos_io_to_limit(bdev_io) == true) {
+			qos_class_id = bdev_desc_get_qos_class_id(bdev_io->internal.desc);
+			qos_class = qos_class_id >= 0 ? &qos->classes[qos_class_id] : NULL;
+			if (qos_class != NULL && bdev_qos_class_queue_io(qos_class)) {
+				/* Only I/O of the throttled class has to wait. */
+				continue;
+			}
+			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+				limit = &qos->rate_limits[i];
+				queue_io = __atomic_load_n(&limit->queue_io, __ATOMIC_RELAXED);
+				if (!queue_io) {
+					continue;
+				}
+
+				if (queue_io(limit, bdev_io) == true) {
+					return submitted_ios;
+				}
+			}
+			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+				limit = &qos->rate_limits[i];
+				update_quota = __atomic_load_n(&limit->update_quota,
+							       __ATOMIC_RELAXED);
+				if (!update_quota) {
+					continue;
+				}
+
+				update_quota(limit, bdev_io);
+			}
+			if (qos_class != NULL &&
+			    __atomic_load_n(&qos_class->max_per_timeslice, __ATOMIC_RELAXED) != 0) {
+				__atomic_sub_fetch(&qos_class->remaining_this_timeslice, 1, __ATOMIC_RELAXED);
+			}
+		}
+
+		TAILQ_REMOVE(&ch->qos_queued, bdev_io, internal.link);
+		bdev_io_do_submit(ch, bdev_io);
+		submitted_ios++;
+	}
+
+	return submitted_ios;
+}
+
+static void
+bdev_queue_io_wait_with_cb(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn)
+{
+	int rc;
+
+	bdev_io->internal.waitq_entry.bdev = bdev_io->bdev;
+	bdev_io->internal.waitq_entry.cb_fn = cb_fn;
 	bdev_io->internal.waitq_entry.cb_arg = bdev_io;
 	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, spdk_io_channel_from_ctx(bdev_io->internal.ch),
 				     &bdev_io->internal.waitq_entry);
 	if (rc != 0) {
 		SPDK_ERRLOG("Queue IO failed, rc=%d\n", rc);
 		bdev_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		bdev_io_complete_desc_stat_direct(bdev_io);
 		bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
 	}
 }
@@ -2095,6 +2774,20 @@ bdev_write_zeroes_should_split(struct spdk_bdev_io *bdev_io)
 	return false;
 }
 
+static bool
+bdev_copy_should_split(struct spdk_bdev_io *bdev_io)
+{
+	if (!bdev_io->bdev->max_copy) {
+		return false;
+	}
+
+	if (bdev_io->u.bdev.num_blocks > bdev_io->bdev->max_copy) {
+		return true;
+	}
+
+	return false;
+}
+
 static bool
 bdev_io_should_split(struct spdk_bdev_io *bdev_io)
 {
@@ -2106,6 +2799,8 @@ bdev_io_should_split(struct spdk_bdev_io *bdev_io)
 		return bdev_unmap_should_split(bdev_io);
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 		return bdev_write_zeroes_should_split(bdev_io);
+	case SPDK_BDEV_IO_TYPE_COPY:
+		return bdev_copy_should_split(bdev_io);
 	default:
 		return false;
 	}
@@ -2141,6 +2836,15 @@ _bdev_write_zeroes_split(void *_bdev_io)
 	return bdev_write_zeroes_split((struct spdk_bdev_io *)_bdev_io);
 }
 
+static void
+bdev_copy_split(struct spdk_bdev_io *bdev_io);
+
+static void
+_bdev_copy_split(void *_bdev_io)
+{
+	return bdev_copy_split((struct spdk_bdev_io *)_bdev_io);
+}
+
 static int
 bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt, void *md_buf,
 		     uint64_t num_blocks, uint64_t *offset, uint64_t *remaining)
@@ -2186,6 +2890,15 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 						   current_offset, num_blocks,
 						   bdev_io_split_done, bdev_io);
 		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		io_wait_fn = _bdev_copy_split;
+		rc = spdk_bdev_copy_blocks(bdev_io->internal.desc,
+					   spdk_io_channel_from_ctx(bdev_io->internal.ch),
+					   current_offset,
+					   bdev_io->u.bdev.copy.src_offset_blocks +
+					   (current_offset - bdev_io->u.bdev.offset_blocks),
+					   num_blocks, bdev_io_split_done, bdev_io);
+		break;
 	default:
 		assert(false);
 		rc = -EINVAL;
@@ -2211,6 +2924,7 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 			if (bdev_io->u.bdev.split_outstanding == 0) {
 				spdk_trace_record(TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)bdev_io, bdev_io->internal.caller_ctx);
 				TAILQ_REMOVE(&bdev_io->internal.ch->io_submitted, bdev_io, internal.ch_link);
+				bdev_io_complete_desc_stat_direct(bdev_io);
 				bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
 			}
 		}
@@ -2326,6 +3040,7 @@ _bdev_rw_split(void *_bdev_io)
 								bdev_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
 								spdk_trace_record(TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)bdev_io, bdev_io->internal.caller_ctx);
 								TAILQ_REMOVE(&bdev_io->internal.ch->io_submitted, bdev_io, internal.ch_link);
+								bdev_io_complete_desc_stat_direct(bdev_io);
 								bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
 							}
 
@@ -2402,6 +3117,29 @@ bdev_write_zeroes_split(struct spdk_bdev_io *bdev_io)
 	}
 }
 
+static void
+bdev_copy_split(struct spdk_bdev_io *bdev_io)
+{
+	uint64_t offset, copy_blocks, remaining;
+	uint32_t num_children_reqs = 0;
+	int rc;
+
+	offset = bdev_io->u.bdev.split_current_offset_blocks;
+	remaining = bdev_io->u.bdev.split_remaining_num_blocks;
+
+	while (remaining && (num_children_reqs < SPDK_BDEV_MAX_CHILDREN_COPY_REQS)) {
+		copy_blocks = spdk_min(remaining, bdev_io->bdev->max_copy);
+
+		rc = bdev_io_split_submit(bdev_io, NULL, 0, NULL, copy_blocks,
+					  &offset, &remaining);
+		if (spdk_likely(rc == 0)) {
+			num_children_reqs++;
+		} else {
+			return;
+		}
+	}
+}
+
 static void
 bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -2427,6 +3165,7 @@ bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		assert(parent_io->internal.cb != bdev_io_split_done);
 		spdk_trace_record(TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)parent_io, bdev_io->internal.caller_ctx);
 		TAILQ_REMOVE(&parent_io->internal.ch->io_submitted, parent_io, internal.ch_link);
+		bdev_io_complete_desc_stat_direct(parent_io);
 		parent_io->internal.cb(parent_io, parent_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS,
 				       parent_io->internal.caller_ctx);
 		return;
@@ -2447,6 +3186,9 @@ bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 		bdev_write_zeroes_split(parent_io);
 		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		bdev_copy_split(parent_io);
+		break;
 	default:
 		assert(false);
 		break;
@@ -2481,6 +3223,9 @@ bdev_io_split(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 		bdev_write_zeroes_split(bdev_io);
 		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		bdev_copy_split(bdev_io);
+		break;
 	default:
 		assert(false);
 		break;
@@ -2505,7 +3250,6 @@ static inline void
 _bdev_io_submit(void *ctx)
 {
 	struct spdk_bdev_io *bdev_io = ctx;
-	struct spdk_bdev *bdev = bdev_io->bdev;
 	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
 	uint64_t tsc;
 
@@ -2523,11 +3267,12 @@ _bdev_io_submit(void *ctx)
 		_bdev_io_complete_in_submit(bdev_ch, bdev_io, SPDK_BDEV_IO_STATUS_ABORTED);
 	} else if (bdev_ch->flags & BDEV_CH_QOS_ENABLED) {
 		if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_ABORT) &&
-		    bdev_abort_queued_io(&bdev->internal.qos->queued, bdev_io->u.abort.bio_to_abort)) {
+		    bdev_abort_queued_io(&bdev_ch->qos_queued, bdev_io->u.abort.bio_to_abort)) {
 			_bdev_io_complete_in_submit(bdev_ch, bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
 		} else {
-			TAILQ_INSERT_TAIL(&bdev->internal.qos->queued, bdev_io, internal.link);
-			bdev_qos_io_submit(bdev_ch, bdev->internal.qos);
+			TAILQ_INSERT_TAIL(&bdev_ch->qos_queued, bdev_io, internal.link);
+			bdev_qos_update_timeslice(bdev_ch->qos, tsc);
+			bdev_qos_io_submit(bdev_ch, bdev_ch->qos);
 		}
 	} else {
 		SPDK_ERRLOG("unknown bdev_ch flag %x found\n", bdev_ch->flags);
@@ -2573,6 +3318,7 @@ bdev_io_range_is_locked(struct spdk_bdev_io *bdev_io, struct lba_range *range)
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 	case SPDK_BDEV_IO_TYPE_ZCOPY:
+	case SPDK_BDEV_IO_TYPE_COPY:
 		r.offset = bdev_io->u.bdev.offset_blocks;
 		r.length = bdev_io->u.bdev.num_blocks;
 		if (!bdev_lba_range_overlapped(range, &r)) {
@@ -2592,16 +3338,66 @@ bdev_io_range_is_locked(struct spdk_bdev_io *bdev_io, struct lba_range *range)
 	}
 }
 
+static struct bdev_desc_ch_stat *
+bdev_channel_get_desc_stat(struct spdk_bdev_channel *ch, struct spdk_bdev_desc *desc)
+{
+	struct bdev_desc_ch_stat *desc_stats, *desc_stat;
+	uint32_t num_desc_stats;
+
+	if (spdk_unlikely(desc->stat_slot >= ch->num_desc_stats)) {
+		num_desc_stats = spdk_max(desc->stat_slot + 1, ch->num_desc_stats * 2);
+		desc_stats = realloc(ch->desc_stats, num_desc_stats * sizeof(*desc_stats));
+		if (desc_stats == NULL) {
+			return NULL;
+		}
+
+		memset(&desc_stats[ch->num_desc_stats], 0,
+		       (num_desc_stats - ch->num_desc_stats) * sizeof(*desc_stats));
+		ch->desc_stats = desc_stats;
+		ch->num_desc_stats = num_desc_stats;
+	}
+
+	desc_stat = &ch->desc_stats[desc->stat_slot];
+	if (desc_stat->desc_id != desc->stat_id) {
+		/* The slot belonged to a descriptor that has been closed since. */
+		memset(desc_stat, 0, sizeof(*desc_stat));
+		desc_stat->desc_id = desc->stat_id;
+	}
+
+	return desc_stat;
+}
+
+static void
+bdev_io_track_desc_stat(struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_desc_ch_stat *desc_stat;
+
+	/* I/O resubmitted after waiting for a locked range are already tracked, and
+	 * the children of split I/O are accounted to their parent.
+	 */
+	if (bdev_io->internal.desc_stat_tracked || bdev_io->internal.cb == bdev_io_split_done) {
+		return;
+	}
+
+	desc_stat = bdev_channel_get_desc_stat(bdev_io->internal.ch, bdev_io->internal.desc);
+	if (desc_stat != NULL) {
+		desc_stat->io_outstanding++;
+		bdev_io->internal.desc_stat_tracked = true;
+	}
+}
+
 void
 bdev_io_submit(struct spdk_bdev_io *bdev_io)
 {
-	struct spdk_bdev *bdev = bdev_io->bdev;
-	struct spdk_thread *thread = spdk_bdev_io_get_thread(bdev_io);
 	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
 
-	assert(thread != NULL);
+	assert(spdk_bdev_io_get_thread(bdev_io) != NULL);
 	assert(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
 
+	if (spdk_unlikely(ch->desc_stats_enabled)) {
+		bdev_io_track_desc_stat(bdev_io);
+	}
+
 	if (!TAILQ_EMPTY(&ch->locked_ranges)) {
 		struct lba_range *range;
 
@@ -2623,17 +3419,7 @@ bdev_io_submit(struct spdk_bdev_io *bdev_io)
 		return;
 	}
 
-	if (ch->flags & BDEV_CH_QOS_ENABLED) {
-		if ((thread == bdev->internal.qos->thread) || !bdev->internal.qos->thread) {
-			_bdev_io_submit(bdev_io);
-		} else {
-			bdev_io->internal.io_submit_ch = ch;
-			bdev_io->internal.ch = bdev->internal.qos->ch;
-			spdk_thread_send_msg(bdev->internal.qos->thread, _bdev_io_submit, bdev_io);
-		}
-	} else {
-		_bdev_io_submit(bdev_io);
-	}
+	_bdev_io_submit(bdev_io);
 }
 
 static void
@@ -2660,8 +3446,8 @@ bdev_io_init(struct spdk_bdev_io *bdev_io,
 	bdev_io->internal.cb = cb;
 	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
 	bdev_io->internal.in_submit_request = false;
+	bdev_io->internal.desc_stat_tracked = false;
 	bdev_io->internal.buf = NULL;
-	bdev_io->internal.io_submit_ch = NULL;
 	bdev_io->internal.orig_iovs = NULL;
 	bdev_io->internal.orig_iovcnt = 0;
 	bdev_io->internal.orig_md_buf = NULL;
@@ -2670,6 +3456,7 @@ bdev_io_init(struct spdk_bdev_io *bdev_io,
 	bdev_io->internal.get_buf_cb = NULL;
 	bdev_io->internal.get_aux_buf_cb = NULL;
 	bdev_io->internal.ext_opts = NULL;
+	bdev_io->internal.fwd_depth = 0;
 }
 
 static bool
@@ -2709,25 +3496,64 @@ spdk_bdev_dump_info_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 	return 0;
 }
 
+static struct spdk_bdev_qos *
+bdev_qos_alloc(void)
+{
+	struct spdk_bdev_qos *qos;
+
+	qos = calloc(1, sizeof(*qos));
+	if (qos != NULL) {
+		qos->ref = 1;
+	}
+
+	return qos;
+}
+
+static void
+bdev_qos_free(struct spdk_bdev_qos *qos)
+{
+	int i;
+
+	if (qos == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		free(qos->classes[i].name);
+	}
+
+	free(qos);
+}
+
+static void
+bdev_qos_put(struct spdk_bdev_qos *qos)
+{
+	if (qos != NULL && __atomic_sub_fetch(&qos->ref, 1, __ATOMIC_ACQ_REL) == 0) {
+		bdev_qos_free(qos);
+	}
+}
+
 static void
 bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 {
+	struct spdk_bdev_qos_limit *limit;
 	uint32_t max_per_timeslice = 0;
 	int i;
 
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		if (qos->rate_limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
-			qos->rate_limits[i].max_per_timeslice = 0;
+		limit = &qos->rate_limits[i];
+		if (limit->limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			__atomic_store_n(&limit->max_per_timeslice, 0, __ATOMIC_RELAXED);
 			continue;
 		}
 
-		max_per_timeslice = qos->rate_limits[i].limit *
+		max_per_timeslice = limit->limit *
 				    SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC;
+		max_per_timeslice = spdk_max(max_per_timeslice, limit->min_per_timeslice);
 
-		qos->rate_limits[i].max_per_timeslice = spdk_max(max_per_timeslice,
-							qos->rate_limits[i].min_per_timeslice);
-
-		qos->rate_limits[i].remaining_this_timeslice = qos->rate_limits[i].max_per_timeslice;
+		__atomic_store_n(&limit->max_per_timeslice, max_per_timeslice, __ATOMIC_RELAXED);
+		__atomic_store_n(&limit->remaining_this_timeslice, max_per_timeslice,
+				 __ATOMIC_RELAXED);
 	}
 
 	bdev_qos_set_ops(qos);
@@ -2736,40 +3562,27 @@ bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 static int
 bdev_channel_poll_qos(void *arg)
 {
-	struct spdk_bdev_qos *qos = arg;
-	uint64_t now = spdk_get_ticks();
-	int i;
+	struct spdk_bdev_channel *ch = arg;
+	struct spdk_bdev_qos *qos = ch->qos;
 
-	if (now < (qos->last_timeslice + qos->timeslice_size)) {
-		/* We received our callback earlier than expected - return
-		 *  immediately and wait to do accounting until at least one
-		 *  timeslice has actually expired.  This should never happen
-		 *  with a well-behaved timer implementation.
-		 */
-		return SPDK_POLLER_IDLE;
-	}
+	bdev_channel_flush_qos_class_stats(ch);
+	bdev_qos_update_timeslice(qos, spdk_get_ticks());
 
-	/* Reset for next round of rate limiting */
-	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		/* We may have allowed the IOs or bytes to slightly overrun in the last
-		 * timeslice. remaining_this_timeslice is signed, so if it's negative
-		 * here, we'll account for the overrun so that the next timeslice will
-		 * be appropriately reduced.
-		 */
-		if (qos->rate_limits[i].remaining_this_timeslice > 0) {
-			qos->rate_limits[i].remaining_this_timeslice = 0;
-		}
-	}
+	return bdev_qos_io_submit(ch, qos);
+}
 
-	while (now >= (qos->last_timeslice + qos->timeslice_size)) {
-		qos->last_timeslice += qos->timeslice_size;
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			qos->rate_limits[i].remaining_this_timeslice +=
-				qos->rate_limits[i].max_per_timeslice;
-		}
+static void
+bdev_channel_put_qos(struct spdk_bdev_channel *ch)
+{
+	if (ch->qos == NULL) {
+		return;
 	}
 
-	return bdev_qos_io_submit(qos->ch, qos);
+	bdev_channel_flush_qos_class_stats(ch);
+	free(ch->qos_class_stats);
+	ch->qos_class_stats = NULL;
+	bdev_qos_put(ch->qos);
+	ch->qos = NULL;
 }
 
 static void
@@ -2784,6 +3597,9 @@ bdev_channel_destroy_resource(struct spdk_bdev_channel *ch)
 		free(range);
 	}
 
+	spdk_poller_unregister(&ch->qos_poller);
+	bdev_channel_put_qos(ch);
+
 	spdk_put_io_channel(ch->channel);
 
 	shared_resource = ch->shared_resource;
@@ -2825,8 +3641,6 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 
 			qos->thread = spdk_io_channel_get_thread(io_ch);
 
-			TAILQ_INIT(&qos->queued);
-
 			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 				if (bdev_qos_is_iops_rate_limit(i) == true) {
 					qos->rate_limits[i].min_per_timeslice =
@@ -2844,9 +3658,26 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 			qos->timeslice_size =
 				SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 			qos->last_timeslice = spdk_get_ticks();
-			qos->poller = SPDK_POLLER_REGISTER(bdev_channel_poll_qos,
-							   qos,
-							   SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+		}
+
+		/*
+		 * Each channel enforces the limits against the shared budget on its own
+		 *  thread, so I/O never has to be forwarded to the QoS channel.
+		 */
+		if (ch->qos != qos) {
+			bdev_channel_put_qos(ch);
+			__atomic_add_fetch(&qos->ref, 1, __ATOMIC_RELAXED);
+			ch->qos = qos;
+			ch->qos_class_stats = calloc(SPDK_BDEV_QOS_MAX_CLASSES,
+						     sizeof(*ch->qos_class_stats));
+			if (ch->qos_class_stats == NULL) {
+				SPDK_ERRLOG("Unable to allocate QoS class statistics, the I/O "
+					    "of channel %p will not be accounted to classes.\n", ch);
+			}
+		}
+		if (ch->qos_poller == NULL) {
+			ch->qos_poller = SPDK_POLLER_REGISTER(bdev_channel_poll_qos, ch,
+							      SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
 		}
 
 		ch->flags |= BDEV_CH_QOS_ENABLED;
@@ -2865,6 +3696,8 @@ bdev_desc_free(struct spdk_bdev_desc *desc)
 {
 	pthread_mutex_destroy(&desc->mutex);
 	free(desc->media_events_buffer);
+	free(desc->qos_class_name);
+	free(desc->stat_label);
 	free(desc);
 }
 
@@ -2960,13 +3793,22 @@ bdev_poll_timeout_io(void *arg)
 	return SPDK_POLLER_BUSY;
 }
 
+static void
+bdev_desc_unregister_timeout_poller(struct spdk_bdev_desc *desc)
+{
+	if (desc->io_timeout_poller != NULL) {
+		spdk_poller_unregister(&desc->io_timeout_poller);
+		__atomic_sub_fetch(&desc->bdev->internal.timeout_desc_count, 1, __ATOMIC_RELAXED);
+	}
+}
+
 int
 spdk_bdev_set_timeout(struct spdk_bdev_desc *desc, uint64_t timeout_in_sec,
 		      spdk_bdev_io_timeout_cb cb_fn, void *cb_arg)
 {
 	assert(desc->thread == spdk_get_thread());
 
-	spdk_poller_unregister(&desc->io_timeout_poller);
+	bdev_desc_unregister_timeout_poller(desc);
 
 	if (timeout_in_sec) {
 		assert(cb_fn != NULL);
@@ -2978,6 +3820,8 @@ spdk_bdev_set_timeout(struct spdk_bdev_desc *desc, uint64_t timeout_in_sec,
 			SPDK_ERRLOG("can not register the desc timeout IO poller\n");
 			return -1;
 		}
+		/* Forwarded I/O would escape the timeout, so stop forwarding to this bdev. */
+		__atomic_add_fetch(&desc->bdev->internal.timeout_desc_count, 1, __ATOMIC_RELAXED);
 	}
 
 	desc->cb_fn = cb_fn;
@@ -2987,30 +3831,121 @@ spdk_bdev_set_timeout(struct spdk_bdev_desc *desc, uint64_t timeout_in_sec,
 	return 0;
 }
 
-static int
-bdev_channel_create(void *io_device, void *ctx_buf)
-{
-	struct spdk_bdev		*bdev = __bdev_from_io_dev(io_device);
-	struct spdk_bdev_channel	*ch = ctx_buf;
-	struct spdk_io_channel		*mgmt_io_ch;
-	struct spdk_bdev_mgmt_channel	*mgmt_ch;
-	struct spdk_bdev_shared_resource *shared_resource;
-	struct lba_range		*range;
+/* I/O types that get latency histograms per size class. */
+static const enum spdk_bdev_io_type g_bdev_histogram_io_types[] = {
+	SPDK_BDEV_IO_TYPE_READ,
+	SPDK_BDEV_IO_TYPE_WRITE,
+	SPDK_BDEV_IO_TYPE_UNMAP,
+	SPDK_BDEV_IO_TYPE_WRITE_ZEROES,
+};
 
-	ch->bdev = bdev;
-	ch->channel = bdev->fn_table->get_io_channel(bdev->ctxt);
-	if (!ch->channel) {
+static const uint64_t g_bdev_histogram_size_class_limits[SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES] = {
+	4 * 1024, 16 * 1024, 128 * 1024, UINT64_MAX
+};
+
+uint64_t
+spdk_bdev_histogram_get_size_class_limit(uint32_t size_class)
+{
+	if (size_class >= SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES) {
+		return 0;
+	}
+
+	return g_bdev_histogram_size_class_limits[size_class];
+}
+
+static void
+bdev_io_type_histograms_free(struct spdk_bdev_io_type_histograms *histograms)
+{
+	uint32_t i, j;
+
+	if (histograms == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_NUM_IO_TYPES; i++) {
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			spdk_histogram_data_free(histograms->histogram[i][j]);
+		}
+	}
+
+	free(histograms);
+}
+
+static struct spdk_bdev_io_type_histograms *
+bdev_io_type_histograms_alloc(void)
+{
+	struct spdk_bdev_io_type_histograms *histograms;
+	struct spdk_histogram_data *histogram;
+	uint32_t i, j;
+
+	histograms = calloc(1, sizeof(*histograms));
+	if (histograms == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(g_bdev_histogram_io_types); i++) {
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			histogram = spdk_histogram_data_alloc_sized(SPDK_BDEV_HISTOGRAM_IO_TYPE_BUCKET_SHIFT);
+			if (histogram == NULL) {
+				bdev_io_type_histograms_free(histograms);
+				return NULL;
+			}
+			histograms->histogram[g_bdev_histogram_io_types[i]][j] = histogram;
+		}
+	}
+
+	return histograms;
+}
+
+static void bdev_channel_histograms_free(struct spdk_bdev_channel *ch);
+
+static int
+bdev_channel_histograms_alloc(struct spdk_bdev_channel *ch)
+{
+	ch->histogram = spdk_histogram_data_alloc();
+	ch->io_type_histograms = bdev_io_type_histograms_alloc();
+	if (ch->histogram == NULL || ch->io_type_histograms == NULL) {
+		bdev_channel_histograms_free(ch);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+bdev_channel_histograms_free(struct spdk_bdev_channel *ch)
+{
+	spdk_histogram_data_free(ch->histogram);
+	ch->histogram = NULL;
+	bdev_io_type_histograms_free(ch->io_type_histograms);
+	ch->io_type_histograms = NULL;
+}
+
+static int
+bdev_channel_create(void *io_device, void *ctx_buf)
+{
+	struct spdk_bdev		*bdev = __bdev_from_io_dev(io_device);
+	struct spdk_bdev_channel	*ch = ctx_buf;
+	struct spdk_io_channel		*mgmt_io_ch;
+	struct spdk_bdev_mgmt_channel	*mgmt_ch;
+	struct spdk_bdev_shared_resource *shared_resource;
+	struct lba_range		*range;
+
+	ch->bdev = bdev;
+	ch->channel = bdev->fn_table->get_io_channel(bdev->ctxt);
+	if (!ch->channel) {
 		return -1;
 	}
 
 	assert(ch->histogram == NULL);
 	if (bdev->internal.histogram_enabled) {
-		ch->histogram = spdk_histogram_data_alloc();
-		if (ch->histogram == NULL) {
+		if (bdev_channel_histograms_alloc(ch) != 0) {
 			SPDK_ERRLOG("Could not allocate histogram\n");
 		}
 	}
 
+	ch->desc_stats_enabled = bdev->internal.desc_stats_enabled;
+
 	mgmt_io_ch = spdk_get_io_channel(&g_bdev_mgr);
 	if (!mgmt_io_ch) {
 		spdk_put_io_channel(ch->channel);
@@ -3048,6 +3983,10 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	ch->io_outstanding = 0;
 	TAILQ_INIT(&ch->queued_resets);
 	TAILQ_INIT(&ch->locked_ranges);
+	TAILQ_INIT(&ch->qos_queued);
+	ch->qos_poller = NULL;
+	ch->qos = NULL;
+	ch->qos_class_stats = NULL;
 	ch->flags = 0;
 	ch->shared_resource = shared_resource;
 
@@ -3178,17 +4117,89 @@ bdev_abort_buf_io(bdev_io_stailq_t *queue, struct spdk_bdev_io *bio_to_abort)
 	return false;
 }
 
+/* Caller must hold bdev->internal.mutex. Returns the class id, or -1 if there is no such class. */
+static int
+bdev_qos_class_find(struct spdk_bdev_qos *qos, const char *name)
+{
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		if (qos->classes[i].name != NULL && strcmp(qos->classes[i].name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Caller must hold bdev->internal.mutex. */
+static int
+bdev_qos_class_create(struct spdk_bdev_qos *qos, const char *name)
+{
+	struct spdk_bdev_qos_class *qos_class = NULL;
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		if (qos->classes[i].name == NULL) {
+			qos_class = &qos->classes[i];
+			break;
+		}
+	}
+
+	if (qos_class == NULL) {
+		return -ENOSPC;
+	}
+
+	qos_class->name = strdup(name);
+	if (qos_class->name == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The slot may have been used by a deleted class. */
+	__atomic_store_n(&qos_class->latency_target_ticks, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->max_per_timeslice, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->remaining_this_timeslice, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->latency_target_missed, false, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->window_ios, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->window_over_target, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->num_ios, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->bytes, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->latency_ticks, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->num_over_target, 0, __ATOMIC_RELAXED);
+	qos_class->last_window_ios = 0;
+
+	/* A non-zero weight makes the class visible to the timeslice path. */
+	__atomic_store_n(&qos_class->weight, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&qos->num_classes, qos->num_classes + 1, __ATOMIC_RELAXED);
+
+	return i;
+}
+
+/* Caller must hold bdev->internal.mutex. */
+static void
+bdev_desc_bind_qos_class(struct spdk_bdev_desc *desc)
+{
+	struct spdk_bdev_qos *qos = desc->bdev->internal.qos;
+	int id = -1;
+
+	if (qos != NULL) {
+		id = bdev_qos_class_find(qos, desc->qos_class_name ? desc->qos_class_name :
+					 SPDK_BDEV_QOS_CLASS_DEFAULT_NAME);
+	}
+
+	__atomic_store_n(&desc->qos_class_id, id, __ATOMIC_RELAXED);
+}
+
 static void
 bdev_qos_channel_destroy(void *cb_arg)
 {
 	struct spdk_bdev_qos *qos = cb_arg;
 
 	spdk_put_io_channel(spdk_io_channel_from_ctx(qos->ch));
-	spdk_poller_unregister(&qos->poller);
 
-	SPDK_DEBUGLOG(bdev, "Free QoS %p.\n", qos);
+	SPDK_DEBUGLOG(bdev, "Release QoS %p.\n", qos);
 
-	free(qos);
+	bdev_qos_put(qos);
 }
 
 static int
@@ -3204,7 +4215,9 @@ bdev_qos_destroy(struct spdk_bdev *bdev)
 	 *
 	 * The strategy is to create a new QoS structure here and swap it
 	 * in. The shutdown path then continues to refer to the old one
-	 * until it completes and then releases it.
+	 * until it completes and then releases it. Channels still enforcing
+	 * the old one hold their own reference, so it is only freed once they
+	 * have all dropped it.
 	 */
 	struct spdk_bdev_qos *new_qos, *old_qos;
 
@@ -3222,8 +4235,11 @@ bdev_qos_destroy(struct spdk_bdev *bdev)
 	/* Zero out the key parts of the QoS structure */
 	new_qos->ch = NULL;
 	new_qos->thread = NULL;
-	new_qos->poller = NULL;
-	TAILQ_INIT(&new_qos->queued);
+	new_qos->ref = 1;
+	/* The classes keep their ids, the descriptors refer to them. Only move the names. */
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		old_qos->classes[i].name = NULL;
+	}
 	/*
 	 * The limit member of spdk_bdev_qos_limit structure is not zeroed.
 	 * It will be used later for the new QoS structure.
@@ -3237,7 +4253,7 @@ bdev_qos_destroy(struct spdk_bdev *bdev)
 	bdev->internal.qos = new_qos;
 
 	if (old_qos->thread == NULL) {
-		free(old_qos);
+		bdev_qos_put(old_qos);
 	} else {
 		spdk_thread_send_msg(old_qos->thread, bdev_qos_channel_destroy, old_qos);
 	}
@@ -3261,6 +4277,27 @@ bdev_io_stat_add(struct spdk_bdev_io_stat *total, struct spdk_bdev_io_stat *add)
 	total->read_latency_ticks += add->read_latency_ticks;
 	total->write_latency_ticks += add->write_latency_ticks;
 	total->unmap_latency_ticks += add->unmap_latency_ticks;
+	total->bytes_copied += add->bytes_copied;
+	total->num_copy_ops += add->num_copy_ops;
+	total->copy_latency_ticks += add->copy_latency_ticks;
+}
+
+/* Move the per descriptor statistics of a channel into the open descriptors. */
+static void
+bdev_channel_put_desc_stats(struct spdk_bdev_channel *ch)
+{
+	struct spdk_bdev_desc *desc;
+
+	TAILQ_FOREACH(desc, &ch->bdev->internal.open_descs, link) {
+		if (desc->stat_slot < ch->num_desc_stats &&
+		    ch->desc_stats[desc->stat_slot].desc_id == desc->stat_id) {
+			bdev_io_stat_add(&desc->stat, &ch->desc_stats[desc->stat_slot].stat);
+		}
+	}
+
+	free(ch->desc_stats);
+	ch->desc_stats = NULL;
+	ch->num_desc_stats = 0;
 }
 
 static void
@@ -3276,18 +4313,18 @@ bdev_channel_destroy(void *io_device, void *ctx_buf)
 	/* This channel is going away, so add its statistics into the bdev so that they don't get lost. */
 	pthread_mutex_lock(&ch->bdev->internal.mutex);
 	bdev_io_stat_add(&ch->bdev->internal.stat, &ch->stat);
+	bdev_channel_put_desc_stats(ch);
 	pthread_mutex_unlock(&ch->bdev->internal.mutex);
 
 	mgmt_ch = shared_resource->mgmt_ch;
 
 	bdev_abort_all_queued_io(&ch->queued_resets, ch);
+	bdev_abort_all_queued_io(&ch->qos_queued, ch);
 	bdev_abort_all_queued_io(&shared_resource->nomem_io, ch);
 	bdev_abort_all_buf_io(&mgmt_ch->need_buf_small, ch);
 	bdev_abort_all_buf_io(&mgmt_ch->need_buf_large, ch);
 
-	if (ch->histogram) {
-		spdk_histogram_data_free(ch->histogram);
-	}
+	bdev_channel_histograms_free(ch);
 
 	bdev_channel_destroy_resource(ch);
 }
@@ -3447,6 +4484,12 @@ spdk_bdev_get_write_unit_size(const struct spdk_bdev *bdev)
 	return bdev->write_unit_size;
 }
 
+uint32_t
+spdk_bdev_get_max_copy(const struct spdk_bdev *bdev)
+{
+	return bdev->max_copy;
+}
+
 uint64_t
 spdk_bdev_get_num_blocks(const struct spdk_bdev *bdev)
 {
@@ -4628,6 +5671,165 @@ spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channe
 	return 0;
 }
 
+static void bdev_copy_do_read(void *_bdev_io);
+
+static void
+bdev_copy_do_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *read_io = cb_arg;
+	struct spdk_bdev_io *parent_io = read_io->internal.caller_ctx;
+
+	spdk_bdev_free_io(bdev_io);
+	spdk_bdev_free_io(read_io);
+
+	if (!success) {
+		parent_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		parent_io->internal.cb(parent_io, false, parent_io->internal.caller_ctx);
+		return;
+	}
+
+	if (parent_io->u.bdev.split_remaining_num_blocks == 0) {
+		parent_io->internal.status = SPDK_BDEV_IO_STATUS_SUCCESS;
+		parent_io->internal.cb(parent_io, true, parent_io->internal.caller_ctx);
+		return;
+	}
+
+	bdev_copy_do_read(parent_io);
+}
+
+/* Write the data of the completed read I/O to the destination. The read I/O
+ * is held until the write completes because it owns the data buffer.
+ */
+static void
+bdev_copy_do_write(void *_bdev_io)
+{
+	struct spdk_bdev_io *read_io = _bdev_io;
+	struct spdk_bdev_io *parent_io = read_io->internal.caller_ctx;
+	uint64_t num_blocks = read_io->u.bdev.num_blocks;
+	int rc;
+
+	rc = bdev_writev_blocks_with_md(parent_io->internal.desc,
+					spdk_io_channel_from_ctx(parent_io->internal.ch),
+					read_io->u.bdev.iovs, read_io->u.bdev.iovcnt,
+					read_io->u.bdev.md_buf,
+					parent_io->u.bdev.split_current_offset_blocks, num_blocks,
+					bdev_copy_do_write_done, read_io, NULL);
+	if (rc == 0) {
+		parent_io->u.bdev.split_remaining_num_blocks -= num_blocks;
+		parent_io->u.bdev.split_current_offset_blocks += num_blocks;
+	} else if (rc == -ENOMEM) {
+		bdev_queue_io_wait_with_cb(read_io, bdev_copy_do_write);
+	} else {
+		spdk_bdev_free_io(read_io);
+		parent_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		parent_io->internal.cb(parent_io, false, parent_io->internal.caller_ctx);
+	}
+}
+
+static void
+bdev_copy_do_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *parent_io = cb_arg;
+
+	if (!success) {
+		spdk_bdev_free_io(bdev_io);
+		parent_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		parent_io->internal.cb(parent_io, false, parent_io->internal.caller_ctx);
+		return;
+	}
+
+	bdev_copy_do_write(bdev_io);
+}
+
+/* Emulate copy by reading a chunk which fits into a data buffer of the pool
+ * and then writing it to the destination, one chunk at a time.
+ */
+static void
+bdev_copy_do_read(void *_bdev_io)
+{
+	struct spdk_bdev_io *bdev_io = _bdev_io;
+	uint64_t src_offset_blocks, num_blocks;
+	int rc;
+
+	src_offset_blocks = bdev_io->u.bdev.copy.src_offset_blocks +
+			    bdev_io->u.bdev.split_current_offset_blocks -
+			    bdev_io->u.bdev.offset_blocks;
+	num_blocks = spdk_min(bdev_io->u.bdev.split_remaining_num_blocks,
+			      spdk_max(SPDK_BDEV_LARGE_BUF_MAX_SIZE / bdev_io->bdev->blocklen, 1));
+
+	rc = spdk_bdev_read_blocks(bdev_io->internal.desc,
+				   spdk_io_channel_from_ctx(bdev_io->internal.ch), NULL,
+				   src_offset_blocks, num_blocks,
+				   bdev_copy_do_read_done, bdev_io);
+	if (rc == -ENOMEM) {
+		bdev_queue_io_wait_with_cb(bdev_io, bdev_copy_do_read);
+	} else if (rc != 0) {
+		bdev_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
+	}
+}
+
+int
+spdk_bdev_copy_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      uint64_t dst_offset_blocks, uint64_t src_offset_blocks,
+		      uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+	struct spdk_bdev_io *bdev_io;
+	struct spdk_bdev_channel *channel = spdk_io_channel_get_ctx(ch);
+
+	if (!desc->write) {
+		return -EBADF;
+	}
+
+	if (num_blocks == 0 ||
+	    !bdev_io_valid_blocks(bdev, dst_offset_blocks, num_blocks) ||
+	    !bdev_io_valid_blocks(bdev, src_offset_blocks, num_blocks)) {
+		return -EINVAL;
+	}
+
+	/* Overlapping ranges would give different results depending on whether and how
+	 * the copy is split or emulated.
+	 */
+	if (dst_offset_blocks < src_offset_blocks + num_blocks &&
+	    src_offset_blocks < dst_offset_blocks + num_blocks) {
+		return -EINVAL;
+	}
+
+	if (!bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_COPY) &&
+	    !(bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_READ) &&
+	      bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_WRITE))) {
+		return -ENOTSUP;
+	}
+
+	bdev_io = bdev_channel_get_io(channel);
+	if (!bdev_io) {
+		return -ENOMEM;
+	}
+
+	bdev_io->type = SPDK_BDEV_IO_TYPE_COPY;
+	bdev_io->internal.ch = channel;
+	bdev_io->internal.desc = desc;
+	bdev_io->u.bdev.iovs = NULL;
+	bdev_io->u.bdev.iovcnt = 0;
+	bdev_io->u.bdev.md_buf = NULL;
+	bdev_io->u.bdev.offset_blocks = dst_offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.copy.src_offset_blocks = src_offset_blocks;
+	bdev_io_init(bdev_io, bdev, cb_arg, cb);
+
+	if (bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_COPY)) {
+		bdev_io_submit(bdev_io);
+		return 0;
+	}
+
+	bdev_io->u.bdev.split_remaining_num_blocks = num_blocks;
+	bdev_io->u.bdev.split_current_offset_blocks = dst_offset_blocks;
+	bdev_copy_do_read(bdev_io);
+
+	return 0;
+}
+
 int
 spdk_bdev_unmap(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 		uint64_t offset, uint64_t nbytes,
@@ -4755,9 +5957,6 @@ bdev_reset_freeze_channel(struct spdk_io_channel_iter *i)
 	struct spdk_bdev_channel	*channel;
 	struct spdk_bdev_mgmt_channel	*mgmt_channel;
 	struct spdk_bdev_shared_resource *shared_resource;
-	bdev_io_tailq_t			tmp_queued;
-
-	TAILQ_INIT(&tmp_queued);
 
 	ch = spdk_io_channel_iter_get_channel(i);
 	channel = spdk_io_channel_get_ctx(ch);
@@ -4766,22 +5965,10 @@ bdev_reset_freeze_channel(struct spdk_io_channel_iter *i)
 
 	channel->flags |= BDEV_CH_RESET_IN_PROGRESS;
 
-	if ((channel->flags & BDEV_CH_QOS_ENABLED) != 0) {
-		/* The QoS object is always valid and readable while
-		 * the channel flag is set, so the lock here should not
-		 * be necessary. We're not in the fast path though, so
-		 * just take it anyway. */
-		pthread_mutex_lock(&channel->bdev->internal.mutex);
-		if (channel->bdev->internal.qos->ch == channel) {
-			TAILQ_SWAP(&channel->bdev->internal.qos->queued, &tmp_queued, spdk_bdev_io, internal.link);
-		}
-		pthread_mutex_unlock(&channel->bdev->internal.mutex);
-	}
-
 	bdev_abort_all_queued_io(&shared_resource->nomem_io, channel);
 	bdev_abort_all_buf_io(&mgmt_channel->need_buf_small, channel);
 	bdev_abort_all_buf_io(&mgmt_channel->need_buf_large, channel);
-	bdev_abort_all_queued_io(&tmp_queued, channel);
+	bdev_abort_all_queued_io(&channel->qos_queued, channel);
 
 	spdk_for_each_channel_continue(i, 0);
 }
@@ -5310,80 +6497,145 @@ bdev_ch_retry_io(struct spdk_bdev_channel *bdev_ch)
 	}
 }
 
+
 static inline void
-bdev_io_complete(void *ctx)
+bdev_io_type_histogram_tally(struct spdk_bdev_io_type_histograms *histograms,
+			     struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
 {
-	struct spdk_bdev_io *bdev_io = ctx;
-	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
-	uint64_t tsc, tsc_diff;
-
-	if (spdk_unlikely(bdev_io->internal.in_submit_request || bdev_io->internal.io_submit_ch)) {
-		/*
-		 * Send the completion to the thread that originally submitted the I/O,
-		 * which may not be the current thread in the case of QoS.
-		 */
-		if (bdev_io->internal.io_submit_ch) {
-			bdev_io->internal.ch = bdev_io->internal.io_submit_ch;
-			bdev_io->internal.io_submit_ch = NULL;
-		}
+	struct spdk_histogram_data **histogram = histograms->histogram[bdev_io->type];
+	uint64_t len;
+	uint32_t i;
 
-		/*
-		 * Defer completion to avoid potential infinite recursion if the
-		 * user's completion callback issues a new I/O.
-		 */
-		spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io),
-				     bdev_io_complete, bdev_io);
+	if (histogram[0] == NULL) {
 		return;
 	}
 
-	tsc = spdk_get_ticks();
-	tsc_diff = tsc - bdev_io->internal.submit_tsc;
-	spdk_trace_record_tsc(tsc, TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)bdev_io,
-			      bdev_io->internal.caller_ctx);
-
-	TAILQ_REMOVE(&bdev_ch->io_submitted, bdev_io, internal.ch_link);
-
-	if (bdev_io->internal.ch->histogram) {
-		spdk_histogram_data_tally(bdev_io->internal.ch->histogram, tsc_diff);
+	len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+	i = 0;
+	while (len > g_bdev_histogram_size_class_limits[i]) {
+		i++;
 	}
 
-	if (bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS) {
-		switch (bdev_io->type) {
-		case SPDK_BDEV_IO_TYPE_READ:
-			bdev_io->internal.ch->stat.bytes_read += bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-			bdev_io->internal.ch->stat.num_read_ops++;
-			bdev_io->internal.ch->stat.read_latency_ticks += tsc_diff;
-			break;
-		case SPDK_BDEV_IO_TYPE_WRITE:
-			bdev_io->internal.ch->stat.bytes_written += bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-			bdev_io->internal.ch->stat.num_write_ops++;
-			bdev_io->internal.ch->stat.write_latency_ticks += tsc_diff;
-			break;
-		case SPDK_BDEV_IO_TYPE_UNMAP:
-			bdev_io->internal.ch->stat.bytes_unmapped += bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-			bdev_io->internal.ch->stat.num_unmap_ops++;
-			bdev_io->internal.ch->stat.unmap_latency_ticks += tsc_diff;
-			break;
-		case SPDK_BDEV_IO_TYPE_ZCOPY:
-			/* Track the data in the start phase only */
-			if (bdev_io->u.bdev.zcopy.start) {
-				if (bdev_io->u.bdev.zcopy.populate) {
-					bdev_io->internal.ch->stat.bytes_read +=
-						bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-					bdev_io->internal.ch->stat.num_read_ops++;
-					bdev_io->internal.ch->stat.read_latency_ticks += tsc_diff;
-				} else {
-					bdev_io->internal.ch->stat.bytes_written +=
-						bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-					bdev_io->internal.ch->stat.num_write_ops++;
-					bdev_io->internal.ch->stat.write_latency_ticks += tsc_diff;
-				}
-			}
-			break;
-		default:
-			break;
-		}
-	}
+	spdk_histogram_data_tally(histogram[i], tsc_diff);
+}
+
+static void
+bdev_io_stat_update(struct spdk_bdev_io_stat *stat, struct spdk_bdev_io *bdev_io,
+		    uint64_t tsc_diff)
+{
+	uint64_t num_bytes = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		stat->bytes_read += num_bytes;
+		stat->num_read_ops++;
+		stat->read_latency_ticks += tsc_diff;
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		stat->bytes_written += num_bytes;
+		stat->num_write_ops++;
+		stat->write_latency_ticks += tsc_diff;
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		stat->bytes_unmapped += num_bytes;
+		stat->num_unmap_ops++;
+		stat->unmap_latency_ticks += tsc_diff;
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		stat->bytes_copied += num_bytes;
+		stat->num_copy_ops++;
+		stat->copy_latency_ticks += tsc_diff;
+		break;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		/* Track the data in the start phase only */
+		if (bdev_io->u.bdev.zcopy.start) {
+			if (bdev_io->u.bdev.zcopy.populate) {
+				stat->bytes_read += num_bytes;
+				stat->num_read_ops++;
+				stat->read_latency_ticks += tsc_diff;
+			} else {
+				stat->bytes_written += num_bytes;
+				stat->num_write_ops++;
+				stat->write_latency_ticks += tsc_diff;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+bdev_io_complete_desc_stat(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
+{
+	struct spdk_bdev_desc *desc = bdev_io->internal.desc;
+	struct bdev_desc_ch_stat *desc_stat = &bdev_io->internal.ch->desc_stats[desc->stat_slot];
+
+	bdev_io->internal.desc_stat_tracked = false;
+
+	/* The slot may have been taken over after the descriptor was closed. */
+	if (spdk_unlikely(desc_stat->desc_id != desc->stat_id)) {
+		return;
+	}
+
+	assert(desc_stat->io_outstanding > 0);
+	desc_stat->io_outstanding--;
+	if (bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+		bdev_io_stat_update(&desc_stat->stat, bdev_io, tsc_diff);
+	}
+}
+
+/* Account I/O completed by the generic bdev layer itself, like the parents of split I/O. */
+static void
+bdev_io_complete_desc_stat_direct(struct spdk_bdev_io *bdev_io)
+{
+	if (spdk_unlikely(bdev_io->internal.desc_stat_tracked)) {
+		bdev_io_complete_desc_stat(bdev_io,
+					   spdk_get_ticks() - bdev_io->internal.submit_tsc);
+	}
+}
+
+static inline void
+bdev_io_complete(void *ctx)
+{
+	struct spdk_bdev_io *bdev_io = ctx;
+	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
+	uint64_t tsc, tsc_diff;
+
+	if (spdk_unlikely(bdev_io->internal.in_submit_request)) {
+		/*
+		 * Defer completion to avoid potential infinite recursion if the
+		 * user's completion callback issues a new I/O.
+		 */
+		spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io),
+				     bdev_io_complete, bdev_io);
+		return;
+	}
+
+	tsc = spdk_get_ticks();
+	tsc_diff = tsc - bdev_io->internal.submit_tsc;
+	spdk_trace_record_tsc(tsc, TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)bdev_io,
+			      bdev_io->internal.caller_ctx);
+
+	TAILQ_REMOVE(&bdev_ch->io_submitted, bdev_io, internal.ch_link);
+
+	if (bdev_io->internal.ch->histogram) {
+		spdk_histogram_data_tally(bdev_io->internal.ch->histogram, tsc_diff);
+		bdev_io_type_histogram_tally(bdev_io->internal.ch->io_type_histograms, bdev_io, tsc_diff);
+	}
+
+	if (spdk_unlikely(bdev_ch->flags & BDEV_CH_QOS_ENABLED) && bdev_qos_io_to_limit(bdev_io) &&
+	    !bdev_io_should_split(bdev_io)) {
+		bdev_qos_class_io_complete(bdev_ch, bdev_io, tsc_diff);
+	}
+
+	if (spdk_unlikely(bdev_io->internal.desc_stat_tracked)) {
+		bdev_io_complete_desc_stat(bdev_io, tsc_diff);
+	}
+
+	if (bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+		bdev_io_stat_update(&bdev_ch->stat, bdev_io, tsc_diff);
+	}
 
 #ifdef SPDK_CONFIG_VTUNE
 	uint64_t now_tsc = spdk_get_ticks();
@@ -5443,13 +6695,47 @@ bdev_unfreeze_channel(struct spdk_io_channel_iter *i)
 	spdk_for_each_channel_continue(i, 0);
 }
 
+/* Complete the I/O on the channels it was forwarded to, as the generic layer would have. */
+static void
+bdev_io_forward_unwind(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_channel *fwd_ch;
+	uint64_t tsc_diff = spdk_get_ticks() - bdev_io->internal.submit_tsc;
+
+	while (bdev_io->internal.fwd_depth > 0) {
+		fwd_ch = bdev_io->internal.fwd_ch[--bdev_io->internal.fwd_depth];
+
+		assert(fwd_ch->io_outstanding > 0);
+		assert(fwd_ch->shared_resource->io_outstanding > 0);
+		fwd_ch->io_outstanding--;
+		fwd_ch->shared_resource->io_outstanding--;
+
+		if (status == SPDK_BDEV_IO_STATUS_SUCCESS) {
+			bdev_io_stat_update(&fwd_ch->stat, bdev_io, tsc_diff);
+		}
+
+		/* Other I/O of the target bdev may be waiting for this one to complete. */
+		if (spdk_unlikely(!TAILQ_EMPTY(&fwd_ch->shared_resource->nomem_io))) {
+			bdev_ch_retry_io(fwd_ch);
+		}
+	}
+
+	bdev_io->bdev = bdev_io->internal.ch->bdev;
+	bdev_io->u.bdev.offset_blocks = bdev_io->internal.fwd_offset_blocks;
+}
+
 void
 spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
 {
-	struct spdk_bdev *bdev = bdev_io->bdev;
+	struct spdk_bdev *bdev;
 	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
 	struct spdk_bdev_shared_resource *shared_resource = bdev_ch->shared_resource;
 
+	if (spdk_unlikely(bdev_io->internal.fwd_depth != 0)) {
+		bdev_io_forward_unwind(bdev_io, status);
+	}
+
+	bdev = bdev_io->bdev;
 	bdev_io->internal.status = status;
 
 	if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_RESET)) {
@@ -5688,9 +6974,73 @@ spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io)
 struct spdk_io_channel *
 spdk_bdev_io_get_io_channel(struct spdk_bdev_io *bdev_io)
 {
+	if (spdk_unlikely(bdev_io->internal.fwd_depth != 0)) {
+		return bdev_io->internal.fwd_ch[bdev_io->internal.fwd_depth - 1]->channel;
+	}
+
 	return bdev_io->internal.ch->channel;
 }
 
+int
+spdk_bdev_io_forward(struct spdk_bdev_io *bdev_io, struct spdk_bdev_desc *desc,
+		     struct spdk_io_channel *ch, uint64_t offset_blocks)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+	struct spdk_bdev_channel *channel = spdk_io_channel_get_ctx(ch);
+	struct spdk_bdev *orig_bdev = bdev_io->bdev;
+	uint64_t orig_offset_blocks = bdev_io->u.bdev.offset_blocks;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		if (!desc->write) {
+			return -EBADF;
+		}
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	if (!bdev_io_valid_blocks(bdev, offset_blocks, bdev_io->u.bdev.num_blocks)) {
+		return -EINVAL;
+	}
+
+	/* Anything the generic layer of the target bdev would have to do with the I/O
+	 * requires a regular child I/O.
+	 */
+	if (channel->flags != 0 || channel->histogram != NULL || channel->desc_stats_enabled ||
+	    !TAILQ_EMPTY(&channel->locked_ranges) ||
+	    !TAILQ_EMPTY(&channel->shared_resource->nomem_io) ||
+	    __atomic_load_n(&bdev->internal.timeout_desc_count, __ATOMIC_RELAXED) != 0 ||
+	    bdev_io->internal.fwd_depth == BDEV_IO_MAX_FORWARD_DEPTH) {
+		return -ENOTSUP;
+	}
+
+	bdev_io->bdev = bdev;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	if (bdev_io_should_split(bdev_io)) {
+		bdev_io->bdev = orig_bdev;
+		bdev_io->u.bdev.offset_blocks = orig_offset_blocks;
+		return -ENOTSUP;
+	}
+
+	/* Only the offset seen by the original submitter needs to be restored on completion. */
+	if (bdev_io->internal.fwd_depth == 0) {
+		bdev_io->internal.fwd_offset_blocks = orig_offset_blocks;
+	}
+	bdev_io->internal.fwd_ch[bdev_io->internal.fwd_depth++] = channel;
+	channel->io_outstanding++;
+	channel->shared_resource->io_outstanding++;
+
+	bdev->fn_table->submit_request(channel->channel, bdev_io);
+
+	return 0;
+}
+
 static int
 bdev_register(struct spdk_bdev *bdev)
 {
@@ -5794,7 +7144,7 @@ bdev_destroy_cb(void *io_device)
 	cb_arg = bdev->internal.unregister_ctx;
 
 	pthread_mutex_destroy(&bdev->internal.mutex);
-	free(bdev->internal.qos);
+	bdev_qos_put(bdev->internal.qos);
 
 	rc = bdev->fn_table->destruct(bdev->ctxt);
 	if (rc < 0) {
@@ -5957,6 +7307,28 @@ bdev_start_qos(struct spdk_bdev *bdev)
 	return 0;
 }
 
+/* Lowest slot in the channels' per descriptor statistics not used by an open descriptor. */
+static uint32_t
+bdev_desc_get_free_stat_slot(struct spdk_bdev *bdev)
+{
+	struct spdk_bdev_desc *desc;
+	uint32_t slot = 0;
+	bool used;
+
+	do {
+		used = false;
+		TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+			if (desc->stat_slot == slot) {
+				used = true;
+				slot++;
+				break;
+			}
+		}
+	} while (used);
+
+	return slot;
+}
+
 static int
 bdev_open(struct spdk_bdev *bdev, bool write, struct spdk_bdev_desc *desc)
 {
@@ -5996,7 +7368,12 @@ bdev_open(struct spdk_bdev *bdev, bool write, struct spdk_bdev_desc *desc)
 		return rc;
 	}
 
+	desc->stat_id = ++g_bdev_mgr.desc_stat_id;
+	desc->stat_slot = bdev_desc_get_free_stat_slot(bdev);
+	desc->stat_prev_tsc = spdk_get_ticks();
+
 	TAILQ_INSERT_TAIL(&bdev->internal.open_descs, desc, link);
+	bdev_desc_bind_qos_class(desc);
 
 	pthread_mutex_unlock(&bdev->internal.mutex);
 
@@ -6039,6 +7416,7 @@ spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event
 
 	desc->callback.event_fn = event_cb;
 	desc->callback.ctx = event_ctx;
+	desc->qos_class_id = -1;
 	pthread_mutex_init(&desc->mutex, NULL);
 
 	if (bdev->media_events) {
@@ -6081,7 +7459,7 @@ spdk_bdev_close(struct spdk_bdev_desc *desc)
 
 	assert(desc->thread == spdk_get_thread());
 
-	spdk_poller_unregister(&desc->io_timeout_poller);
+	bdev_desc_unregister_timeout_poller(desc);
 
 	pthread_mutex_lock(&g_bdev_mgr.mutex);
 	pthread_mutex_lock(&bdev->internal.mutex);
@@ -6329,7 +7707,6 @@ bdev_disable_qos_done(void *cb_arg)
 {
 	struct set_qos_limit_ctx *ctx = cb_arg;
 	struct spdk_bdev *bdev = ctx->bdev;
-	struct spdk_bdev_io *bdev_io;
 	struct spdk_bdev_qos *qos;
 
 	pthread_mutex_lock(&bdev->internal.mutex);
@@ -6337,30 +7714,11 @@ bdev_disable_qos_done(void *cb_arg)
 	bdev->internal.qos = NULL;
 	pthread_mutex_unlock(&bdev->internal.mutex);
 
-	while (!TAILQ_EMPTY(&qos->queued)) {
-		/* Send queued I/O back to their original thread for resubmission. */
-		bdev_io = TAILQ_FIRST(&qos->queued);
-		TAILQ_REMOVE(&qos->queued, bdev_io, internal.link);
-
-		if (bdev_io->internal.io_submit_ch) {
-			/*
-			 * Channel was changed when sending it to the QoS thread - change it back
-			 *  before sending it back to the original thread.
-			 */
-			bdev_io->internal.ch = bdev_io->internal.io_submit_ch;
-			bdev_io->internal.io_submit_ch = NULL;
-		}
-
-		spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io),
-				     _bdev_io_submit, bdev_io);
-	}
-
 	if (qos->thread != NULL) {
 		spdk_put_io_channel(spdk_io_channel_from_ctx(qos->ch));
-		spdk_poller_unregister(&qos->poller);
 	}
 
-	free(qos);
+	bdev_qos_put(qos);
 
 	bdev_set_qos_limit_done(ctx, 0);
 }
@@ -6389,8 +7747,18 @@ bdev_disable_qos_msg(struct spdk_io_channel_iter *i)
 {
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct spdk_bdev_channel *bdev_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_bdev_io *bdev_io;
 
 	bdev_ch->flags &= ~BDEV_CH_QOS_ENABLED;
+	spdk_poller_unregister(&bdev_ch->qos_poller);
+	bdev_channel_put_qos(bdev_ch);
+
+	/* Resubmit I/O that was waiting for QoS budget on this channel. */
+	while (!TAILQ_EMPTY(&bdev_ch->qos_queued)) {
+		bdev_io = TAILQ_FIRST(&bdev_ch->qos_queued);
+		TAILQ_REMOVE(&bdev_ch->qos_queued, bdev_io, internal.link);
+		_bdev_io_submit(bdev_io);
+	}
 
 	spdk_for_each_channel_continue(i, 0);
 }
@@ -6505,6 +7873,11 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 	bdev->internal.qos_mod_in_progress = true;
 
 	if (disable_rate_limit == true && bdev->internal.qos) {
+		/* QoS stays enabled for the classes even without rate limits. */
+		if (bdev->internal.qos->num_classes != 0) {
+			disable_rate_limit = false;
+		}
+
 		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 			if (limits[i] == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED &&
 			    (bdev->internal.qos->rate_limits[i].limit > 0 &&
@@ -6518,7 +7891,7 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 
 	if (disable_rate_limit == false) {
 		if (bdev->internal.qos == NULL) {
-			bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+			bdev->internal.qos = bdev_qos_alloc();
 			if (!bdev->internal.qos) {
 				pthread_mutex_unlock(&bdev->internal.mutex);
 				SPDK_ERRLOG("Unable to allocate memory for QoS tracking\n");
@@ -6559,6 +7932,460 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 	pthread_mutex_unlock(&bdev->internal.mutex);
 }
 
+void
+spdk_bdev_set_qos_class(struct spdk_bdev *bdev, const char *class_name, uint32_t weight,
+			uint64_t latency_target_us, void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx	*ctx;
+	struct spdk_bdev_qos		*qos;
+	struct spdk_bdev_qos_class	*qos_class;
+	struct spdk_bdev_desc		*desc;
+	const char			*names[] = {SPDK_BDEV_QOS_CLASS_DEFAULT_NAME, class_name};
+	uint64_t			latency_target_ticks;
+	size_t				i;
+	int				id;
+
+	if (class_name == NULL || class_name[0] == '\0' || weight == 0) {
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	if (bdev->internal.qos_mod_in_progress) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	if (bdev->internal.qos == NULL) {
+		bdev->internal.qos = bdev_qos_alloc();
+		if (bdev->internal.qos == NULL) {
+			pthread_mutex_unlock(&bdev->internal.mutex);
+			free(ctx);
+			cb_fn(cb_arg, -ENOMEM);
+			return;
+		}
+	}
+	qos = bdev->internal.qos;
+
+	/* Descriptors without a class belong to the default class, so create it along the first one. */
+	for (i = 0; i < SPDK_COUNTOF(names); i++) {
+		id = bdev_qos_class_find(qos, names[i]);
+		if (id < 0) {
+			id = bdev_qos_class_create(qos, names[i]);
+			if (id < 0) {
+				SPDK_ERRLOG("Unable to create QoS class %s: %s\n", names[i],
+					    spdk_strerror(-id));
+				pthread_mutex_unlock(&bdev->internal.mutex);
+				free(ctx);
+				cb_fn(cb_arg, id);
+				return;
+			}
+		}
+	}
+
+	qos_class = &qos->classes[id];
+	latency_target_ticks = latency_target_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	__atomic_store_n(&qos_class->latency_target_ticks, latency_target_ticks, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos_class->weight, weight, __ATOMIC_RELAXED);
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		bdev_desc_bind_qos_class(desc);
+	}
+
+	if (qos->thread == NULL) {
+		/* Enable QoS on the existing channels, as for the rate limits. */
+		bdev->internal.qos_mod_in_progress = true;
+		spdk_for_each_channel(__bdev_to_io_dev(bdev),
+				      bdev_enable_qos_msg, ctx,
+				      bdev_enable_qos_done);
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		return;
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	free(ctx);
+	cb_fn(cb_arg, 0);
+}
+
+int
+spdk_bdev_delete_qos_class(struct spdk_bdev *bdev, const char *class_name)
+{
+	struct spdk_bdev_qos		*qos;
+	struct spdk_bdev_qos_class	*qos_class;
+	struct spdk_bdev_desc		*desc;
+	int				id;
+
+	if (class_name == NULL) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	qos = bdev->internal.qos;
+	id = qos != NULL ? bdev_qos_class_find(qos, class_name) : -1;
+	if (id < 0) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		return -ENOENT;
+	}
+
+	/* Descriptors without a class belong to the default class. */
+	if (strcmp(class_name, SPDK_BDEV_QOS_CLASS_DEFAULT_NAME) == 0 && qos->num_classes > 1) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		return -EBUSY;
+	}
+
+	/*
+	 * Hide the class from the timeslice path and lift its throttle. The slot itself
+	 *  stays valid for I/O that still refer to it.
+	 */
+	qos_class = &qos->classes[id];
+	__atomic_store_n(&qos_class->weight, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&qos_class->max_per_timeslice, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&qos->num_classes, qos->num_classes - 1, __ATOMIC_RELAXED);
+	free(qos_class->name);
+	qos_class->name = NULL;
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		bdev_desc_bind_qos_class(desc);
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	return 0;
+}
+
+int
+spdk_bdev_desc_set_qos_class(struct spdk_bdev_desc *desc, const char *class_name)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	char *name = NULL;
+
+	if (class_name != NULL) {
+		name = strdup(class_name);
+		if (name == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	free(desc->qos_class_name);
+	desc->qos_class_name = name;
+	bdev_desc_bind_qos_class(desc);
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	return 0;
+}
+
+void
+spdk_bdev_get_qos_class_stats(struct spdk_bdev *bdev, spdk_bdev_qos_class_stat_cb cb_fn,
+			      void *cb_arg)
+{
+	struct spdk_bdev_qos_class_stat stat;
+	struct spdk_bdev_qos_class *qos_class;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t max_per_timeslice;
+	int i;
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	if (bdev->internal.qos == NULL) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_MAX_CLASSES; i++) {
+		qos_class = &bdev->internal.qos->classes[i];
+		if (qos_class->name == NULL) {
+			continue;
+		}
+
+		memset(&stat, 0, sizeof(stat));
+		stat.name = qos_class->name;
+		stat.weight = qos_class->weight;
+		stat.latency_target_us = qos_class->latency_target_ticks * SPDK_SEC_TO_USEC / ticks_hz;
+		stat.latency_target_missed = __atomic_load_n(&qos_class->latency_target_missed,
+					     __ATOMIC_RELAXED);
+		max_per_timeslice = __atomic_load_n(&qos_class->max_per_timeslice, __ATOMIC_RELAXED);
+		stat.ios_per_sec_limit = max_per_timeslice * SPDK_SEC_TO_USEC /
+					 SPDK_BDEV_QOS_TIMESLICE_IN_USEC;
+		stat.num_ios = __atomic_load_n(&qos_class->num_ios, __ATOMIC_RELAXED);
+		stat.bytes = __atomic_load_n(&qos_class->bytes, __ATOMIC_RELAXED);
+		stat.latency_ticks = __atomic_load_n(&qos_class->latency_ticks, __ATOMIC_RELAXED);
+		stat.num_over_latency_target = __atomic_load_n(&qos_class->num_over_target,
+					       __ATOMIC_RELAXED);
+		cb_fn(cb_arg, &stat);
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+}
+
+int
+spdk_bdev_desc_set_label(struct spdk_bdev_desc *desc, const char *label)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	char *copy = NULL;
+
+	if (label != NULL) {
+		copy = strdup(label);
+		if (copy == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	free(desc->stat_label);
+	desc->stat_label = copy;
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	return 0;
+}
+
+struct spdk_bdev_desc_stats_enable_ctx {
+	struct spdk_bdev *bdev;
+	bool enable;
+	void (*cb_fn)(void *cb_arg, int status);
+	void *cb_arg;
+};
+
+static void
+bdev_desc_stats_enable_channel_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bdev_desc_stats_enable_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	pthread_mutex_lock(&ctx->bdev->internal.mutex);
+	ctx->bdev->internal.desc_stats_in_progress = false;
+	pthread_mutex_unlock(&ctx->bdev->internal.mutex);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+	free(ctx);
+}
+
+static void
+bdev_desc_stats_enable_channel(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bdev_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_bdev_desc_stats_enable_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	uint32_t slot;
+
+	if (ctx->enable) {
+		/* Start over, but keep counting the I/O that are still outstanding. */
+		for (slot = 0; slot < ch->num_desc_stats; slot++) {
+			memset(&ch->desc_stats[slot].stat, 0, sizeof(ch->desc_stats[slot].stat));
+		}
+	}
+
+	/* The array itself is kept, as completions of tracked I/O may still refer to it. */
+	ch->desc_stats_enabled = ctx->enable;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+void
+spdk_bdev_desc_stats_enable(struct spdk_bdev *bdev, bool enable,
+			    void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct spdk_bdev_desc_stats_enable_ctx *ctx;
+	struct spdk_bdev_desc *desc;
+	uint64_t now;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->bdev = bdev;
+	ctx->enable = enable;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	if (bdev->internal.desc_stats_in_progress) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	if (bdev->internal.desc_stats_enabled == enable) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		free(ctx);
+		cb_fn(cb_arg, 0);
+		return;
+	}
+
+	bdev->internal.desc_stats_in_progress = true;
+	bdev->internal.desc_stats_enabled = enable;
+
+	if (enable) {
+		now = spdk_get_ticks();
+		TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+			memset(&desc->stat, 0, sizeof(desc->stat));
+			desc->stat_prev_ops = 0;
+			desc->stat_prev_bytes = 0;
+			desc->stat_prev_tsc = now;
+		}
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	spdk_for_each_channel(__bdev_to_io_dev(bdev), bdev_desc_stats_enable_channel, ctx,
+			      bdev_desc_stats_enable_channel_done);
+}
+
+struct spdk_bdev_desc_stats_ctx {
+	struct spdk_bdev *bdev;
+	spdk_bdev_desc_stats_cb cb_fn;
+	void *cb_arg;
+	uint32_t num_stats;
+	struct spdk_bdev_desc_stat *stats;
+	/* stat_slot of the descriptor of each entry of stats */
+	uint32_t *slots;
+};
+
+static void
+bdev_desc_stats_ctx_free(struct spdk_bdev_desc_stats_ctx *ctx)
+{
+	uint32_t i;
+
+	if (ctx->stats != NULL) {
+		for (i = 0; i < ctx->num_stats; i++) {
+			free((char *)ctx->stats[i].label);
+		}
+	}
+
+	free(ctx->stats);
+	free(ctx->slots);
+	free(ctx);
+}
+
+static void
+bdev_desc_stats_get_channel_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bdev_desc_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_bdev_desc_stat *stat;
+	struct spdk_bdev_desc *desc;
+	uint64_t now = spdk_get_ticks();
+	uint64_t ops, bytes;
+	uint32_t j;
+
+	pthread_mutex_lock(&ctx->bdev->internal.mutex);
+	for (j = 0; j < ctx->num_stats; j++) {
+		stat = &ctx->stats[j];
+		TAILQ_FOREACH(desc, &ctx->bdev->internal.open_descs, link) {
+			if (desc->stat_id == stat->id) {
+				break;
+			}
+		}
+
+		if (desc == NULL) {
+			/* Closed in the meantime, there is no interval to report. */
+			continue;
+		}
+
+		ops = stat->stat.num_read_ops + stat->stat.num_write_ops +
+		      stat->stat.num_unmap_ops + stat->stat.num_copy_ops;
+		bytes = stat->stat.bytes_read + stat->stat.bytes_written + stat->stat.bytes_copied;
+		stat->interval_ops = ops - desc->stat_prev_ops;
+		stat->interval_bytes = bytes - desc->stat_prev_bytes;
+		stat->interval_ticks = now - desc->stat_prev_tsc;
+		desc->stat_prev_ops = ops;
+		desc->stat_prev_bytes = bytes;
+		desc->stat_prev_tsc = now;
+	}
+	pthread_mutex_unlock(&ctx->bdev->internal.mutex);
+
+	ctx->cb_fn(ctx->cb_arg, status, ctx->stats, ctx->num_stats);
+	bdev_desc_stats_ctx_free(ctx);
+}
+
+static void
+bdev_desc_stats_get_channel(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bdev_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_bdev_desc_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct bdev_desc_ch_stat *desc_stat;
+	uint32_t j;
+
+	for (j = 0; j < ctx->num_stats; j++) {
+		if (ctx->slots[j] >= ch->num_desc_stats) {
+			continue;
+		}
+
+		desc_stat = &ch->desc_stats[ctx->slots[j]];
+		if (desc_stat->desc_id == ctx->stats[j].id) {
+			bdev_io_stat_add(&ctx->stats[j].stat, &desc_stat->stat);
+			ctx->stats[j].io_outstanding += desc_stat->io_outstanding;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+void
+spdk_bdev_get_desc_stats(struct spdk_bdev *bdev, spdk_bdev_desc_stats_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev_desc_stats_ctx *ctx;
+	struct spdk_bdev_desc *desc;
+	uint32_t j = 0;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM, NULL, 0);
+		return;
+	}
+
+	ctx->bdev = bdev;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	pthread_mutex_lock(&bdev->internal.mutex);
+	if (!bdev->internal.desc_stats_enabled) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		free(ctx);
+		cb_fn(cb_arg, -EINVAL, NULL, 0);
+		return;
+	}
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		ctx->num_stats++;
+	}
+
+	ctx->stats = calloc(ctx->num_stats, sizeof(*ctx->stats));
+	ctx->slots = calloc(ctx->num_stats, sizeof(*ctx->slots));
+	if (ctx->num_stats > 0 && (ctx->stats == NULL || ctx->slots == NULL)) {
+		pthread_mutex_unlock(&bdev->internal.mutex);
+		ctx->num_stats = 0;
+		bdev_desc_stats_ctx_free(ctx);
+		cb_fn(cb_arg, -ENOMEM, NULL, 0);
+		return;
+	}
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		ctx->stats[j].id = desc->stat_id;
+		if (desc->stat_label != NULL) {
+			/* Without a copy the label is just not reported. */
+			ctx->stats[j].label = strdup(desc->stat_label);
+		}
+		ctx->stats[j].stat = desc->stat;
+		ctx->slots[j] = desc->stat_slot;
+		j++;
+	}
+	pthread_mutex_unlock(&bdev->internal.mutex);
+
+	spdk_for_each_channel(__bdev_to_io_dev(bdev), bdev_desc_stats_get_channel, ctx,
+			      bdev_desc_stats_get_channel_done);
+}
+
 struct spdk_bdev_histogram_ctx {
 	spdk_bdev_histogram_status_cb cb_fn;
 	void *cb_arg;
@@ -6584,10 +8411,7 @@ bdev_histogram_disable_channel(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
 	struct spdk_bdev_channel *ch = spdk_io_channel_get_ctx(_ch);
 
-	if (ch->histogram != NULL) {
-		spdk_histogram_data_free(ch->histogram);
-		ch->histogram = NULL;
-	}
+	bdev_channel_histograms_free(ch);
 	spdk_for_each_channel_continue(i, 0);
 }
 
@@ -6618,10 +8442,7 @@ bdev_histogram_enable_channel(struct spdk_io_channel_iter *i)
 	int status = 0;
 
 	if (ch->histogram == NULL) {
-		ch->histogram = spdk_histogram_data_alloc();
-		if (ch->histogram == NULL) {
-			status = -ENOMEM;
-		}
+		status = bdev_channel_histograms_alloc(ch);
 	}
 
 	spdk_for_each_channel_continue(i, status);
@@ -6724,6 +8545,73 @@ spdk_bdev_histogram_get(struct spdk_bdev *bdev, struct spdk_histogram_data *hist
 			      bdev_histogram_get_channel_cb);
 }
 
+struct spdk_bdev_io_type_histograms_ctx {
+	spdk_bdev_io_type_histograms_cb cb_fn;
+	void *cb_arg;
+	/** merged histograms from all channels */
+	struct spdk_bdev_io_type_histograms *histograms;
+};
+
+static void
+bdev_io_type_histograms_get_channel_cb(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bdev_io_type_histograms_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, status, status == 0 ? ctx->histograms : NULL);
+	bdev_io_type_histograms_free(ctx->histograms);
+	free(ctx);
+}
+
+static void
+bdev_io_type_histograms_get_channel(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bdev_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_bdev_io_type_histograms_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	uint32_t j, k;
+	int status = 0;
+
+	if (ch->io_type_histograms == NULL) {
+		status = -EFAULT;
+	} else {
+		for (j = 0; j < SPDK_COUNTOF(g_bdev_histogram_io_types); j++) {
+			for (k = 0; k < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; k++) {
+				spdk_histogram_data_merge(
+					ctx->histograms->histogram[g_bdev_histogram_io_types[j]][k],
+					ch->io_type_histograms->histogram[g_bdev_histogram_io_types[j]][k]);
+			}
+		}
+	}
+
+	spdk_for_each_channel_continue(i, status);
+}
+
+void
+spdk_bdev_histogram_get_by_io_type(struct spdk_bdev *bdev, spdk_bdev_io_type_histograms_cb cb_fn,
+				   void *cb_arg)
+{
+	struct spdk_bdev_io_type_histograms_ctx *ctx;
+
+	ctx = calloc(1, sizeof(struct spdk_bdev_io_type_histograms_ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->histograms = bdev_io_type_histograms_alloc();
+	if (ctx->histograms == NULL) {
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(__bdev_to_io_dev(bdev), bdev_io_type_histograms_get_channel, ctx,
+			      bdev_io_type_histograms_get_channel_cb);
+}
+
 size_t
 spdk_bdev_get_media_events(struct spdk_bdev_desc *desc, struct spdk_bdev_media_event *events,
 			   size_t max_events)
@@ -7132,6 +9020,22 @@ bdev_unlock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *_ch,
 	return 0;
 }
 
+int
+spdk_bdev_lock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			 uint64_t offset_blocks, uint64_t num_blocks,
+			 spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg)
+{
+	return bdev_lock_lba_range(desc, ch, offset_blocks, num_blocks, cb_fn, cb_arg);
+}
+
+int
+spdk_bdev_unlock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg)
+{
+	return bdev_unlock_lba_range(desc, ch, offset_blocks, num_blocks, cb_fn, cb_arg);
+}
+
 int
 spdk_bdev_get_memory_domains(struct spdk_bdev *bdev, struct spdk_memory_domain **domains,
 			     int array_size)
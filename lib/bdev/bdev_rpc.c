@@ -48,6 +48,10 @@ struct spdk_rpc_set_bdev_opts {
 	bool bdev_auto_examine;
 	uint32_t small_buf_pool_size;
 	uint32_t large_buf_pool_size;
+	uint32_t bdev_io_pool_size_per_socket;
+	uint32_t small_buf_pool_size_per_socket;
+	uint32_t large_buf_pool_size_per_socket;
+	bool numa_pools;
 };
 
 static const struct spdk_json_object_decoder rpc_set_bdev_opts_decoders[] = {
@@ -56,6 +60,10 @@ static const struct spdk_json_object_decoder rpc_set_bdev_opts_decoders[] = {
 	{"bdev_auto_examine", offsetof(struct spdk_rpc_set_bdev_opts, bdev_auto_examine), spdk_json_decode_bool, true},
 	{"small_buf_pool_size", offsetof(struct spdk_rpc_set_bdev_opts, small_buf_pool_size), spdk_json_decode_uint32, true},
 	{"large_buf_pool_size", offsetof(struct spdk_rpc_set_bdev_opts, large_buf_pool_size), spdk_json_decode_uint32, true},
+	{"bdev_io_pool_size_per_socket", offsetof(struct spdk_rpc_set_bdev_opts, bdev_io_pool_size_per_socket), spdk_json_decode_uint32, true},
+	{"small_buf_pool_size_per_socket", offsetof(struct spdk_rpc_set_bdev_opts, small_buf_pool_size_per_socket), spdk_json_decode_uint32, true},
+	{"large_buf_pool_size_per_socket", offsetof(struct spdk_rpc_set_bdev_opts, large_buf_pool_size_per_socket), spdk_json_decode_uint32, true},
+	{"numa_pools", offsetof(struct spdk_rpc_set_bdev_opts, numa_pools), spdk_json_decode_bool, true},
 };
 
 static void
@@ -69,7 +77,11 @@ rpc_bdev_set_options(struct spdk_jsonrpc_request *request, const struct spdk_jso
 	rpc_opts.bdev_io_cache_size = UINT32_MAX;
 	rpc_opts.small_buf_pool_size = UINT32_MAX;
 	rpc_opts.large_buf_pool_size = UINT32_MAX;
+	rpc_opts.bdev_io_pool_size_per_socket = UINT32_MAX;
+	rpc_opts.small_buf_pool_size_per_socket = UINT32_MAX;
+	rpc_opts.large_buf_pool_size_per_socket = UINT32_MAX;
 	rpc_opts.bdev_auto_examine = true;
+	rpc_opts.numa_pools = true;
 
 	if (params != NULL) {
 		if (spdk_json_decode_object(params, rpc_set_bdev_opts_decoders,
@@ -89,12 +101,22 @@ rpc_bdev_set_options(struct spdk_jsonrpc_request *request, const struct spdk_jso
 		bdev_opts.bdev_io_cache_size = rpc_opts.bdev_io_cache_size;
 	}
 	bdev_opts.bdev_auto_examine = rpc_opts.bdev_auto_examine;
+	bdev_opts.numa_pools = rpc_opts.numa_pools;
 	if (rpc_opts.small_buf_pool_size != UINT32_MAX) {
 		bdev_opts.small_buf_pool_size = rpc_opts.small_buf_pool_size;
 	}
 	if (rpc_opts.large_buf_pool_size != UINT32_MAX) {
 		bdev_opts.large_buf_pool_size = rpc_opts.large_buf_pool_size;
 	}
+	if (rpc_opts.bdev_io_pool_size_per_socket != UINT32_MAX) {
+		bdev_opts.bdev_io_pool_size_per_socket = rpc_opts.bdev_io_pool_size_per_socket;
+	}
+	if (rpc_opts.small_buf_pool_size_per_socket != UINT32_MAX) {
+		bdev_opts.small_buf_pool_size_per_socket = rpc_opts.small_buf_pool_size_per_socket;
+	}
+	if (rpc_opts.large_buf_pool_size_per_socket != UINT32_MAX) {
+		bdev_opts.large_buf_pool_size_per_socket = rpc_opts.large_buf_pool_size_per_socket;
+	}
 
 	rc = spdk_bdev_set_opts(&bdev_opts);
 
@@ -110,6 +132,55 @@ rpc_bdev_set_options(struct spdk_jsonrpc_request *request, const struct spdk_jso
 SPDK_RPC_REGISTER("bdev_set_options", rpc_bdev_set_options, SPDK_RPC_STARTUP)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_set_options, set_bdev_options)
 
+static void
+rpc_bdev_get_pool_stats(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct spdk_bdev_pool_stats *stats;
+	struct spdk_json_write_ctx *w;
+	uint32_t num_stats, i;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "bdev_get_pool_stats requires no parameters");
+		return;
+	}
+
+	num_stats = spdk_bdev_get_pool_stats(NULL, 0);
+	stats = calloc(spdk_max(num_stats, 1), sizeof(*stats));
+	if (stats == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	num_stats = spdk_min(num_stats, spdk_bdev_get_pool_stats(stats, num_stats));
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+	for (i = 0; i < num_stats; i++) {
+		spdk_json_write_object_begin(w);
+		if (stats[i].socket_id == (uint32_t)SPDK_ENV_SOCKET_ID_ANY) {
+			spdk_json_write_named_int32(w, "socket_id", SPDK_ENV_SOCKET_ID_ANY);
+		} else {
+			spdk_json_write_named_uint32(w, "socket_id", stats[i].socket_id);
+		}
+		spdk_json_write_named_uint32(w, "bdev_io_pool_size", stats[i].bdev_io_pool_size);
+		spdk_json_write_named_uint32(w, "bdev_io_pool_free", stats[i].bdev_io_pool_free);
+		spdk_json_write_named_uint32(w, "small_buf_pool_size", stats[i].small_buf_pool_size);
+		spdk_json_write_named_uint32(w, "small_buf_pool_free", stats[i].small_buf_pool_free);
+		spdk_json_write_named_uint32(w, "large_buf_pool_size", stats[i].large_buf_pool_size);
+		spdk_json_write_named_uint32(w, "large_buf_pool_free", stats[i].large_buf_pool_free);
+		spdk_json_write_named_uint64(w, "remote_bdev_io_allocs", stats[i].remote_bdev_io_allocs);
+		spdk_json_write_named_uint64(w, "remote_buf_allocs", stats[i].remote_buf_allocs);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+	free(stats);
+}
+SPDK_RPC_REGISTER("bdev_get_pool_stats", rpc_bdev_get_pool_stats, SPDK_RPC_RUNTIME)
+
 static void
 rpc_bdev_wait_for_examine_cpl(void *arg)
 {
@@ -222,6 +293,12 @@ rpc_bdev_get_iostat_cb(struct spdk_bdev *bdev,
 
 		spdk_json_write_named_uint64(w, "unmap_latency_ticks", stat->unmap_latency_ticks);
 
+		spdk_json_write_named_uint64(w, "bytes_copied", stat->bytes_copied);
+
+		spdk_json_write_named_uint64(w, "num_copy_ops", stat->num_copy_ops);
+
+		spdk_json_write_named_uint64(w, "copy_latency_ticks", stat->copy_latency_ticks);
+
 		if (spdk_bdev_get_qd_sampling_period(bdev)) {
 			spdk_json_write_named_uint64(w, "queue_depth_polling_period",
 						     spdk_bdev_get_qd_sampling_period(bdev));
@@ -431,6 +508,8 @@ rpc_dump_bdev_info(struct spdk_json_write_ctx *w,
 				   spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_NVME_ADMIN));
 	spdk_json_write_named_bool(w, "nvme_io",
 				   spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_NVME_IO));
+	spdk_json_write_named_bool(w, "copy",
+				   spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_COPY));
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_named_object_begin(w, "driver_specific");
@@ -647,6 +726,447 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_set_qos_limit", rpc_bdev_set_qos_limit, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_set_qos_limit, set_bdev_qos_limit)
 
+struct rpc_bdev_set_qos_class {
+	char		*name;
+	char		*class_name;
+	uint32_t	weight;
+	uint64_t	latency_target_us;
+};
+
+static void
+free_rpc_bdev_set_qos_class(struct rpc_bdev_set_qos_class *r)
+{
+	free(r->name);
+	free(r->class_name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_set_qos_class_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_qos_class, name), spdk_json_decode_string},
+	{"class", offsetof(struct rpc_bdev_set_qos_class, class_name), spdk_json_decode_string},
+	{"weight", offsetof(struct rpc_bdev_set_qos_class, weight), spdk_json_decode_uint32, true},
+	{
+		"latency_target_us", offsetof(struct rpc_bdev_set_qos_class, latency_target_us),
+		spdk_json_decode_uint64, true
+	},
+};
+
+static void
+rpc_bdev_set_qos_class_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to configure QoS class: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_set_qos_class(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_qos_class req = {};
+	struct spdk_bdev *bdev;
+
+	req.weight = 1;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_qos_class_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_qos_class_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_bdev_set_qos_class(bdev, req.class_name, req.weight, req.latency_target_us,
+				rpc_bdev_set_qos_class_complete, request);
+
+cleanup:
+	free_rpc_bdev_set_qos_class(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_set_qos_class", rpc_bdev_set_qos_class, SPDK_RPC_RUNTIME)
+
+static const struct spdk_json_object_decoder rpc_bdev_delete_qos_class_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_qos_class, name), spdk_json_decode_string},
+	{"class", offsetof(struct rpc_bdev_set_qos_class, class_name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_delete_qos_class(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_qos_class req = {};
+	struct spdk_bdev *bdev;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_delete_qos_class_decoders,
+				    SPDK_COUNTOF(rpc_bdev_delete_qos_class_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_delete_qos_class(bdev, req.class_name);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to delete QoS class: %s",
+						     spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_set_qos_class(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_delete_qos_class", rpc_bdev_delete_qos_class, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_get_qos_class_stats {
+	char *name;
+};
+
+static void
+free_rpc_bdev_get_qos_class_stats(struct rpc_bdev_get_qos_class_stats *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_get_qos_class_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_get_qos_class_stats, name), spdk_json_decode_string},
+};
+
+static void
+rpc_dump_qos_class_stat(void *cb_arg, const struct spdk_bdev_qos_class_stat *stat)
+{
+	struct spdk_json_write_ctx *w = cb_arg;
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "class", stat->name);
+	spdk_json_write_named_uint32(w, "weight", stat->weight);
+	spdk_json_write_named_uint64(w, "latency_target_us", stat->latency_target_us);
+	spdk_json_write_named_bool(w, "latency_target_missed", stat->latency_target_missed);
+	spdk_json_write_named_uint64(w, "ios_per_sec_limit", stat->ios_per_sec_limit);
+	spdk_json_write_named_uint64(w, "num_ios", stat->num_ios);
+	spdk_json_write_named_uint64(w, "bytes", stat->bytes);
+	spdk_json_write_named_uint64(w, "latency_ticks", stat->latency_ticks);
+	spdk_json_write_named_uint64(w, "num_over_latency_target", stat->num_over_latency_target);
+	spdk_json_write_object_end(w);
+}
+
+static void
+rpc_bdev_get_qos_class_stats(struct spdk_jsonrpc_request *request,
+			     const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_qos_class_stats req = {};
+	struct spdk_json_write_ctx *w;
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_get_qos_class_stats_decoders,
+				    SPDK_COUNTOF(rpc_bdev_get_qos_class_stats_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(bdev));
+	spdk_json_write_named_uint64(w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(w, "classes");
+	spdk_bdev_get_qos_class_stats(bdev, rpc_dump_qos_class_stat, w);
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_get_qos_class_stats(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_get_qos_class_stats", rpc_bdev_get_qos_class_stats, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_enable_desc_stats {
+	char *name;
+	bool enable;
+};
+
+static void
+free_rpc_bdev_enable_desc_stats(struct rpc_bdev_enable_desc_stats *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_enable_desc_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_enable_desc_stats, name), spdk_json_decode_string},
+	{"enable", offsetof(struct rpc_bdev_enable_desc_stats, enable), spdk_json_decode_bool},
+};
+
+static void
+rpc_bdev_enable_desc_stats_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(request, status, spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_enable_desc_stats(struct spdk_jsonrpc_request *request,
+			   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_enable_desc_stats req = {};
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_enable_desc_stats_decoders,
+				    SPDK_COUNTOF(rpc_bdev_enable_desc_stats_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_bdev_desc_stats_enable(bdev, req.enable, rpc_bdev_enable_desc_stats_complete, request);
+
+cleanup:
+	free_rpc_bdev_enable_desc_stats(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_enable_desc_stats", rpc_bdev_enable_desc_stats, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_get_top_descs {
+	char *name;
+	char *sort_by;
+	uint32_t count;
+};
+
+static void
+free_rpc_bdev_get_top_descs(struct rpc_bdev_get_top_descs *r)
+{
+	free(r->name);
+	free(r->sort_by);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_get_top_descs_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_get_top_descs, name), spdk_json_decode_string},
+	{"sort_by", offsetof(struct rpc_bdev_get_top_descs, sort_by), spdk_json_decode_string, true},
+	{"count", offsetof(struct rpc_bdev_get_top_descs, count), spdk_json_decode_uint32, true},
+};
+
+struct rpc_top_desc {
+	const struct spdk_bdev_desc_stat *stat;
+	uint64_t iops;
+	uint64_t bandwidth;
+};
+
+struct rpc_bdev_get_top_descs_ctx {
+	struct spdk_jsonrpc_request *request;
+	struct spdk_bdev *bdev;
+	bool by_bandwidth;
+	uint32_t count;
+};
+
+static int
+rpc_top_desc_cmp_iops(const void *_a, const void *_b)
+{
+	const struct rpc_top_desc *a = _a, *b = _b;
+
+	if (a->iops != b->iops) {
+		return a->iops < b->iops ? 1 : -1;
+	}
+
+	return a->bandwidth < b->bandwidth ? 1 : a->bandwidth > b->bandwidth ? -1 : 0;
+}
+
+static int
+rpc_top_desc_cmp_bandwidth(const void *_a, const void *_b)
+{
+	const struct rpc_top_desc *a = _a, *b = _b;
+
+	if (a->bandwidth != b->bandwidth) {
+		return a->bandwidth < b->bandwidth ? 1 : -1;
+	}
+
+	return a->iops < b->iops ? 1 : a->iops > b->iops ? -1 : 0;
+}
+
+static uint64_t
+rpc_top_desc_rate(uint64_t count, uint64_t ticks)
+{
+	return ticks == 0 ? 0 : (uint64_t)((double)count * spdk_get_ticks_hz() / ticks);
+}
+
+static void
+rpc_bdev_get_top_descs_cb(void *cb_arg, int status, const struct spdk_bdev_desc_stat *stats,
+			  uint32_t num_stats)
+{
+	struct rpc_bdev_get_top_descs_ctx *ctx = cb_arg;
+	struct spdk_json_write_ctx *w;
+	struct rpc_top_desc *top;
+	uint32_t i;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, status, spdk_strerror(-status));
+		free(ctx);
+		return;
+	}
+
+	top = calloc(num_stats, sizeof(*top));
+	if (top == NULL && num_stats > 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, -ENOMEM, spdk_strerror(ENOMEM));
+		free(ctx);
+		return;
+	}
+
+	for (i = 0; i < num_stats; i++) {
+		top[i].stat = &stats[i];
+		top[i].iops = rpc_top_desc_rate(stats[i].interval_ops, stats[i].interval_ticks);
+		top[i].bandwidth = rpc_top_desc_rate(stats[i].interval_bytes, stats[i].interval_ticks);
+	}
+
+	if (num_stats > 0) {
+		qsort(top, num_stats, sizeof(*top),
+		      ctx->by_bandwidth ? rpc_top_desc_cmp_bandwidth : rpc_top_desc_cmp_iops);
+	}
+
+	if (ctx->count != 0) {
+		num_stats = spdk_min(num_stats, ctx->count);
+	}
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(ctx->bdev));
+	spdk_json_write_named_uint64(w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(w, "descs");
+	for (i = 0; i < num_stats; i++) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint64(w, "id", top[i].stat->id);
+		if (top[i].stat->label != NULL) {
+			spdk_json_write_named_string(w, "label", top[i].stat->label);
+		}
+		spdk_json_write_named_uint64(w, "iops", top[i].iops);
+		spdk_json_write_named_uint64(w, "bandwidth_bytes_per_sec", top[i].bandwidth);
+		spdk_json_write_named_uint64(w, "io_outstanding", top[i].stat->io_outstanding);
+		spdk_json_write_named_uint64(w, "bytes_read", top[i].stat->stat.bytes_read);
+		spdk_json_write_named_uint64(w, "num_read_ops", top[i].stat->stat.num_read_ops);
+		spdk_json_write_named_uint64(w, "bytes_written", top[i].stat->stat.bytes_written);
+		spdk_json_write_named_uint64(w, "num_write_ops", top[i].stat->stat.num_write_ops);
+		spdk_json_write_named_uint64(w, "bytes_unmapped", top[i].stat->stat.bytes_unmapped);
+		spdk_json_write_named_uint64(w, "num_unmap_ops", top[i].stat->stat.num_unmap_ops);
+		spdk_json_write_named_uint64(w, "read_latency_ticks",
+					     top[i].stat->stat.read_latency_ticks);
+		spdk_json_write_named_uint64(w, "write_latency_ticks",
+					     top[i].stat->stat.write_latency_ticks);
+		spdk_json_write_named_uint64(w, "unmap_latency_ticks",
+					     top[i].stat->stat.unmap_latency_ticks);
+		spdk_json_write_named_uint64(w, "bytes_copied", top[i].stat->stat.bytes_copied);
+		spdk_json_write_named_uint64(w, "num_copy_ops", top[i].stat->stat.num_copy_ops);
+		spdk_json_write_named_uint64(w, "copy_latency_ticks",
+					     top[i].stat->stat.copy_latency_ticks);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+	free(top);
+	free(ctx);
+}
+
+static void
+rpc_bdev_get_top_descs(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_top_descs req = {};
+	struct rpc_bdev_get_top_descs_ctx *ctx;
+	struct spdk_bdev *bdev;
+
+	req.count = 10;
+
+	if (spdk_json_decode_object(params, rpc_bdev_get_top_descs_decoders,
+				    SPDK_COUNTOF(rpc_bdev_get_top_descs_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	if (req.sort_by != NULL && strcmp(req.sort_by, "iops") != 0 &&
+	    strcmp(req.sort_by, "bandwidth") != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Invalid sort_by: %s", req.sort_by);
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+
+	ctx->request = request;
+	ctx->bdev = bdev;
+	ctx->by_bandwidth = req.sort_by != NULL && strcmp(req.sort_by, "bandwidth") == 0;
+	ctx->count = req.count;
+
+	spdk_bdev_get_desc_stats(bdev, rpc_bdev_get_top_descs_cb, ctx);
+
+cleanup:
+	free_rpc_bdev_get_top_descs(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_get_top_descs", rpc_bdev_get_top_descs, SPDK_RPC_RUNTIME)
+
 /* SPDK_RPC_ENABLE_BDEV_HISTOGRAM */
 
 struct rpc_bdev_enable_histogram_request {
@@ -804,3 +1324,136 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_get_histogram", rpc_bdev_get_histogram, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_get_histogram, get_bdev_histogram)
+
+static const struct {
+	enum spdk_bdev_io_type io_type;
+	const char *name;
+} g_rpc_histogram_io_types[] = {
+	{ SPDK_BDEV_IO_TYPE_READ, "read" },
+	{ SPDK_BDEV_IO_TYPE_WRITE, "write" },
+	{ SPDK_BDEV_IO_TYPE_UNMAP, "unmap" },
+	{ SPDK_BDEV_IO_TYPE_WRITE_ZEROES, "write_zeroes" },
+};
+
+static uint64_t
+rpc_histogram_ticks_to_ns(uint64_t ticks, uint64_t tick_rate)
+{
+	double ns = (double)ticks * SPDK_SEC_TO_NSEC / tick_rate;
+
+	return ns < (double)UINT64_MAX ? (uint64_t)ns : UINT64_MAX;
+}
+
+static void
+rpc_dump_histogram_percentiles(struct spdk_json_write_ctx *w,
+			       const struct spdk_histogram_data *histogram)
+{
+	uint64_t tick_rate = spdk_get_ticks_hz();
+	uint64_t num_ios = 0, i;
+
+	for (i = 0; i < SPDK_HISTOGRAM_NUM_BUCKETS(histogram); i++) {
+		num_ios += histogram->bucket[i];
+	}
+
+	spdk_json_write_named_uint64(w, "num_ios", num_ios);
+	spdk_json_write_named_uint64(w, "p50_ns", rpc_histogram_ticks_to_ns(
+					     spdk_histogram_data_get_percentile(histogram, 50), tick_rate));
+	spdk_json_write_named_uint64(w, "p99_ns", rpc_histogram_ticks_to_ns(
+					     spdk_histogram_data_get_percentile(histogram, 99), tick_rate));
+	spdk_json_write_named_uint64(w, "p99_9_ns", rpc_histogram_ticks_to_ns(
+					     spdk_histogram_data_get_percentile(histogram, 99.9), tick_rate));
+	spdk_json_write_named_uint64(w, "p99_99_ns", rpc_histogram_ticks_to_ns(
+					     spdk_histogram_data_get_percentile(histogram, 99.99), tick_rate));
+}
+
+static void
+_rpc_bdev_io_type_histograms_cb(void *cb_arg, int status,
+				const struct spdk_bdev_io_type_histograms *histograms)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	struct spdk_histogram_data *merged;
+	struct spdk_histogram_data *const *histogram;
+	uint64_t limit;
+	uint32_t i, j;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(-status));
+		return;
+	}
+
+	merged = spdk_histogram_data_alloc_sized(SPDK_BDEV_HISTOGRAM_IO_TYPE_BUCKET_SHIFT);
+	if (merged == NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(ENOMEM));
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_array_begin(w, "io_types");
+	for (i = 0; i < SPDK_COUNTOF(g_rpc_histogram_io_types); i++) {
+		histogram = histograms->histogram[g_rpc_histogram_io_types[i].io_type];
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "io_type", g_rpc_histogram_io_types[i].name);
+
+		spdk_histogram_data_reset(merged);
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			spdk_histogram_data_merge(merged, histogram[j]);
+		}
+		rpc_dump_histogram_percentiles(w, merged);
+
+		spdk_json_write_named_array_begin(w, "size_classes");
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			spdk_json_write_object_begin(w);
+			limit = spdk_bdev_histogram_get_size_class_limit(j);
+			if (limit == UINT64_MAX) {
+				spdk_json_write_named_null(w, "max_bytes");
+			} else {
+				spdk_json_write_named_uint64(w, "max_bytes", limit);
+			}
+			rpc_dump_histogram_percentiles(w, histogram[j]);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+	spdk_histogram_data_free(merged);
+}
+
+static void
+rpc_bdev_get_histogram_percentiles(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_histogram_request req = {NULL};
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_get_histogram_request_decoders,
+				    SPDK_COUNTOF(rpc_bdev_get_histogram_request_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_bdev_histogram_get_by_io_type(bdev, _rpc_bdev_io_type_histograms_cb, request);
+
+cleanup:
+	free_rpc_bdev_get_histogram_request(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_get_histogram_percentiles", rpc_bdev_get_histogram_percentiles,
+		  SPDK_RPC_RUNTIME)
@@ -317,6 +317,17 @@ spdk_bdev_part_submit_request(struct spdk_bdev_part_channel *ch, struct spdk_bde
 	offset = bdev_io->u.bdev.offset_blocks;
 	remapped_offset = offset + part->internal.offset_blocks;
 
+	/* Unless reference tags have to be remapped, pass the I/O itself down to the base
+	 *  bdev instead of allocating a child I/O just to add the offset.
+	 */
+	if (spdk_likely(!(bdev_io->bdev->dif_check_flags & SPDK_DIF_FLAGS_REFTAG_CHECK))) {
+		rc = spdk_bdev_io_forward(bdev_io, base_desc, base_ch, remapped_offset);
+		if (rc != -ENOTSUP) {
+			return rc;
+		}
+		rc = 0;
+	}
+
 	/* Modify the I/O to adjust for the offset within the base bdev. */
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
@@ -378,6 +389,13 @@ spdk_bdev_part_submit_request(struct spdk_bdev_part_channel *ch, struct spdk_bde
 					   bdev_io->u.bdev.num_blocks, bdev_io->u.bdev.zcopy.populate,
 					   bdev_part_complete_zcopy_io, bdev_io);
 		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		rc = spdk_bdev_copy_blocks(base_desc, base_ch, remapped_offset,
+					   bdev_io->u.bdev.copy.src_offset_blocks +
+					   part->internal.offset_blocks,
+					   bdev_io->u.bdev.num_blocks, bdev_part_complete_io,
+					   bdev_io);
+		break;
 	default:
 		SPDK_ERRLOG("unknown I/O type %d\n", bdev_io->type);
 		return SPDK_BDEV_IO_STATUS_FAILED;
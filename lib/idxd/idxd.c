@@ -424,9 +424,14 @@ _idxd_prep_batch_cmd(struct spdk_idxd_io_channel *chan, spdk_idxd_req_cb cb_fn,
 	op->desc = desc;
 	SPDK_DEBUGLOG(idxd, "Prep batch %p index %u\n", batch, batch->index);
 
-	batch->index++;
-
 	desc->flags = IDXD_FLAG_COMPLETION_ADDR_VALID | IDXD_FLAG_REQUEST_COMPLETION;
+	/* Fence the descriptors so that a batch executes in order and each one
+	 * can use the result of the previous ones. */
+	if (batch->index > 0) {
+		desc->flags |= IDXD_FLAG_FENCE;
+	}
+
+	batch->index++;
 	op->cb_arg = cb_arg;
 	op->cb_fn = cb_fn;
 	op->batch = batch;
@@ -749,6 +754,7 @@ spdk_idxd_batch_create(struct spdk_idxd_io_channel *chan)
 		batch = TAILQ_FIRST(&chan->batch_pool);
 		batch->index = 0;
 		batch->chan = chan;
+		batch->op = NULL;
 		TAILQ_REMOVE(&chan->batch_pool, batch, link);
 	} else {
 		/* The application needs to handle this. */
@@ -764,6 +770,7 @@ _free_batch(struct idxd_batch *batch, struct spdk_idxd_io_channel *chan)
 	SPDK_DEBUGLOG(idxd, "Free batch %p\n", batch);
 	batch->index = 0;
 	batch->chan = NULL;
+	batch->op = NULL;
 	TAILQ_INSERT_TAIL(&chan->batch_pool, batch, link);
 }
 
@@ -778,7 +785,7 @@ spdk_idxd_batch_cancel(struct spdk_idxd_io_channel *chan, struct idxd_batch *bat
 		return -EINVAL;
 	}
 
-	if (batch->index > 0) {
+	if (batch->op != NULL) {
 		SPDK_ERRLOG("Cannot cancel batch, already submitted to HW.\n");
 		return -EINVAL;
 	}
@@ -832,6 +839,7 @@ spdk_idxd_batch_submit(struct spdk_idxd_io_channel *chan, struct idxd_batch *bat
 	desc->desc_list_addr = desc_addr;
 	desc->desc_count = batch->index;
 	op->batch = batch;
+	batch->op = op;
 	assert(batch->index <= DESC_PER_BATCH);
 
 	/* Add the batch elements completion contexts to the outstanding list to be polled. */
@@ -1104,6 +1112,19 @@ _dump_sw_error_reg(struct spdk_idxd_io_channel *chan)
 #define IDXD_COMPLETION(x) ((x) > (0) ? (1) : (0))
 #define IDXD_FAILURE(x) ((x) > (1) ? (1) : (0))
 #define IDXD_SW_ERROR(x) ((x) &= (0x1) ? (1) : (0))
+
+/*
+ * The descriptors of a batch are fenced, so the device abandons the ones following
+ * a failed descriptor without writing their completion record. They are known to be
+ * done once the batch descriptor completed.
+ */
+static inline bool
+_is_batch_op_abandoned(struct idxd_ops *op)
+{
+	return op->batch != NULL && op->batch->op != NULL && op->batch->op != op &&
+	       IDXD_COMPLETION(op->batch->op->hw.status);
+}
+
 int
 spdk_idxd_process_events(struct spdk_idxd_io_channel *chan)
 {
@@ -1116,12 +1137,14 @@ spdk_idxd_process_events(struct spdk_idxd_io_channel *chan)
 	assert(chan != NULL);
 
 	TAILQ_FOREACH_SAFE(op, &chan->ops_outstanding, link, tmp) {
-		if (IDXD_COMPLETION(op->hw.status)) {
+		if (IDXD_COMPLETION(op->hw.status) || _is_batch_op_abandoned(op)) {
 
 			TAILQ_REMOVE(&chan->ops_outstanding, op, link);
 			rc++;
 
-			if (spdk_unlikely(IDXD_FAILURE(op->hw.status))) {
+			if (spdk_unlikely(!IDXD_COMPLETION(op->hw.status))) {
+				status = -ECANCELED;
+			} else if (spdk_unlikely(IDXD_FAILURE(op->hw.status))) {
 				status = -EINVAL;
 				_dump_sw_error_reg(chan);
 			}
@@ -1149,6 +1172,7 @@ spdk_idxd_process_events(struct spdk_idxd_io_channel *chan)
 			op->hw.status = 0;
 			if (op->desc->opcode == IDXD_OPCODE_BATCH) {
 				_free_batch(op->batch, chan);
+				TAILQ_INSERT_HEAD(&chan->ops_pool, op, link);
 			} else if (op->batch == NULL) {
 				TAILQ_INSERT_HEAD(&chan->ops_pool, op, link);
 			}
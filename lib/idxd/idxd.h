@@ -77,6 +77,8 @@ static inline void movdir64b(void *dst, const void *src)
 struct idxd_batch {
 	struct idxd_hw_desc		*user_desc;
 	struct idxd_ops			*user_ops;
+	/* Batch descriptor operation, set once the batch is submitted. */
+	struct idxd_ops			*op;
 	uint8_t				index;
 	struct spdk_idxd_io_channel	*chan;
 	TAILQ_ENTRY(idxd_batch)		link;
@@ -59,6 +59,9 @@
 #define NVME_TCP_MAX_R2T_DEFAULT		1
 #define NVME_TCP_PDU_H2C_MIN_DATA_SIZE		4096
 
+/* C2H data of at least this size is received directly into the request buffers. */
+#define NVME_TCP_C2H_DIRECT_MIN_DATA_SIZE	4096
+
 /* NVMe TCP transport extensions for spdk_nvme_ctrlr */
 struct nvme_tcp_ctrlr {
 	struct spdk_nvme_ctrlr			ctrlr;
@@ -71,6 +74,8 @@ struct nvme_tcp_poll_group {
 	int64_t num_completions;
 
 	TAILQ_HEAD(, nvme_tcp_qpair) needs_poll;
+	/* PDUs waiting for their header digests to be computed in a batch */
+	TAILQ_HEAD(, nvme_tcp_pdu) hdgst_pdus;
 	struct spdk_nvme_tcp_stat stats;
 };
 
@@ -93,6 +98,9 @@ struct nvme_tcp_qpair {
 	uint16_t				num_entries;
 	uint16_t				async_complete;
 
+	/* The number of outstanding requests expecting C2H data to be received directly. */
+	uint16_t				num_c2h_direct_reqs;
+
 	struct {
 		uint16_t host_hdgst_enable: 1;
 		uint16_t host_ddgst_enable: 1;
@@ -137,6 +145,7 @@ struct nvme_tcp_req {
 	uint16_t				ttag_r2t_next;
 	bool					in_capsule_data;
 	bool					pdu_in_use;
+	bool					c2h_direct;
 	/* It is used to track whether the req can be safely freed */
 	union {
 		uint8_t raw;
@@ -209,6 +218,7 @@ nvme_tcp_req_get(struct nvme_tcp_qpair *tqpair)
 	tcp_req->req = NULL;
 	tcp_req->in_capsule_data = false;
 	tcp_req->pdu_in_use = false;
+	tcp_req->c2h_direct = false;
 	tcp_req->r2tl_remain = 0;
 	tcp_req->r2tl_remain_next = 0;
 	tcp_req->active_r2ts = 0;
@@ -225,6 +235,10 @@ static void
 nvme_tcp_req_put(struct nvme_tcp_qpair *tqpair, struct nvme_tcp_req *tcp_req)
 {
 	assert(tcp_req->state != NVME_TCP_REQ_FREE);
+	if (tcp_req->c2h_direct) {
+		assert(tqpair->num_c2h_direct_reqs > 0);
+		tqpair->num_c2h_direct_reqs--;
+	}
 	tcp_req->state = NVME_TCP_REQ_FREE;
 	TAILQ_INSERT_HEAD(&tqpair->free_reqs, tcp_req, link);
 }
@@ -480,6 +494,8 @@ nvme_tcp_qpair_write_pdu(struct nvme_tcp_qpair *tqpair,
 			 nvme_tcp_qpair_xfer_complete_cb cb_fn,
 			 void *cb_arg)
 {
+	struct spdk_nvme_qpair *qpair = &tqpair->qpair;
+	struct nvme_tcp_poll_group *tgroup;
 	int hlen;
 	uint32_t crc32c;
 
@@ -490,6 +506,15 @@ nvme_tcp_qpair_write_pdu(struct nvme_tcp_qpair *tqpair,
 
 	/* Header Digest */
 	if (g_nvme_tcp_hdgst[pdu->hdr.common.pdu_type] && tqpair->flags.host_hdgst_enable) {
+		/* Computed together with the other PDUs sent during this poll */
+		if (qpair->poll_group != NULL &&
+		    qpair->poll_group_tailq_head == &qpair->poll_group->connected_qpairs &&
+		    nvme_qpair_get_state(qpair) >= NVME_QPAIR_CONNECTED) {
+			tgroup = nvme_tcp_poll_group(qpair->poll_group);
+			TAILQ_INSERT_TAIL(&tgroup->hdgst_pdus, pdu, tailq);
+			return 0;
+		}
+
 		crc32c = nvme_tcp_pdu_calc_header_digest(pdu);
 		MAKE_DIGEST_WORD((uint8_t *)pdu->hdr.raw + hlen, crc32c);
 	}
@@ -499,6 +524,28 @@ nvme_tcp_qpair_write_pdu(struct nvme_tcp_qpair *tqpair,
 	return 0;
 }
 
+static void
+nvme_tcp_poll_group_flush_hdgst(struct nvme_tcp_poll_group *tgroup)
+{
+	struct nvme_tcp_pdu *pdus[NVME_TCP_HDGST_BATCH_SIZE];
+	int i, count;
+
+	while (!TAILQ_EMPTY(&tgroup->hdgst_pdus)) {
+		count = 0;
+		while (count < NVME_TCP_HDGST_BATCH_SIZE && !TAILQ_EMPTY(&tgroup->hdgst_pdus)) {
+			pdus[count] = TAILQ_FIRST(&tgroup->hdgst_pdus);
+			TAILQ_REMOVE(&tgroup->hdgst_pdus, pdus[count], tailq);
+			count++;
+		}
+
+		nvme_tcp_pdus_set_header_digest(pdus, count);
+
+		for (i = 0; i < count; i++) {
+			pdu_data_crc32_compute(pdus[i]);
+		}
+	}
+}
+
 /*
  * Build SGL describing contiguous payload buffer.
  */
@@ -612,6 +659,10 @@ nvme_tcp_req_init(struct nvme_tcp_qpair *tqpair, struct nvme_request *req,
 			req->cmd.dptr.sgl1.address = 0;
 			tcp_req->in_capsule_data = true;
 		}
+	} else if (xfer == SPDK_NVME_DATA_CONTROLLER_TO_HOST &&
+		   req->payload_size >= NVME_TCP_C2H_DIRECT_MIN_DATA_SIZE) {
+		tcp_req->c2h_direct = true;
+		tqpair->num_c2h_direct_reqs++;
 	}
 
 	return 0;
@@ -1600,6 +1651,19 @@ nvme_tcp_pdu_psh_handle(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 
 }
 
+/* While large C2H data is expected, read PDU headers without read ahead. Otherwise the
+ * socket may buffer the C2H data following a header and copy it to the request later.
+ */
+static inline int
+nvme_tcp_qpair_read_hdr(struct nvme_tcp_qpair *tqpair, int bytes, void *buf)
+{
+	if (tqpair->num_c2h_direct_reqs != 0) {
+		return nvme_tcp_read_data_direct(tqpair->sock, bytes, buf);
+	}
+
+	return nvme_tcp_read_data(tqpair->sock, bytes, buf);
+}
+
 static int
 nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 {
@@ -1620,9 +1684,9 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH:
 			pdu = tqpair->recv_pdu;
 			if (pdu->ch_valid_bytes < sizeof(struct spdk_nvme_tcp_common_pdu_hdr)) {
-				rc = nvme_tcp_read_data(tqpair->sock,
-							sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
-							(uint8_t *)&pdu->hdr.common + pdu->ch_valid_bytes);
+				rc = nvme_tcp_qpair_read_hdr(tqpair,
+							     sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
+							     (uint8_t *)&pdu->hdr.common + pdu->ch_valid_bytes);
 				if (rc < 0) {
 					nvme_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_ERROR);
 					break;
@@ -1640,9 +1704,9 @@ nvme_tcp_read_pdu(struct nvme_tcp_qpair *tqpair, uint32_t *reaped)
 		/* Wait for the pdu specific header  */
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH:
 			pdu = tqpair->recv_pdu;
-			rc = nvme_tcp_read_data(tqpair->sock,
-						pdu->psh_len - pdu->psh_valid_bytes,
-						(uint8_t *)&pdu->hdr.raw + sizeof(struct spdk_nvme_tcp_common_pdu_hdr) + pdu->psh_valid_bytes);
+			rc = nvme_tcp_qpair_read_hdr(tqpair,
+						     pdu->psh_len - pdu->psh_valid_bytes,
+						     (uint8_t *)&pdu->hdr.raw + sizeof(struct spdk_nvme_tcp_common_pdu_hdr) + pdu->psh_valid_bytes);
 			if (rc < 0) {
 				nvme_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_ERROR);
 				break;
@@ -2198,6 +2262,7 @@ nvme_tcp_poll_group_create(void)
 	}
 
 	TAILQ_INIT(&group->needs_poll);
+	TAILQ_INIT(&group->hdgst_pdus);
 
 	group->sock_group = spdk_sock_group_create(group);
 	if (group->sock_group == NULL) {
@@ -2247,6 +2312,9 @@ nvme_tcp_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair)
 		tqpair->needs_poll = false;
 	}
 
+	/* Don't leave any of this qpair's PDUs behind in the group */
+	nvme_tcp_poll_group_flush_hdgst(group);
+
 	if (tqpair->sock && group->sock_group) {
 		if (spdk_sock_group_remove_sock(group->sock_group, tqpair->sock)) {
 			return -EPROTO;
@@ -2304,6 +2372,8 @@ nvme_tcp_poll_group_process_completions(struct spdk_nvme_transport_poll_group *t
 	group->num_completions = 0;
 	group->stats.polls++;
 
+	nvme_tcp_poll_group_flush_hdgst(group);
+
 	num_events = spdk_sock_group_poll(group->sock_group);
 
 	STAILQ_FOREACH_SAFE(qpair, &tgroup->disconnected_qpairs, poll_group_stailq, tmp_qpair) {
@@ -2316,6 +2386,8 @@ nvme_tcp_poll_group_process_completions(struct spdk_nvme_transport_poll_group *t
 		nvme_tcp_qpair_sock_cb(&tqpair->qpair, group->sock_group, tqpair->sock);
 	}
 
+	nvme_tcp_poll_group_flush_hdgst(group);
+
 	if (spdk_unlikely(num_events < 0)) {
 		return num_events;
 	}
@@ -2228,6 +2228,8 @@ static const struct spdk_nvme_cmds_and_effect_log_page g_cmds_and_effect_log_pag
 		[SPDK_NVME_OPC_DATASET_MANAGEMENT]	= {1, 1, 0, 0, 0, 0, 0, 0},
 		/* COMPARE */
 		[SPDK_NVME_OPC_COMPARE]			= {1, 0, 0, 0, 0, 0, 0, 0},
+		/* COPY */
+		[SPDK_NVME_OPC_COPY]			= {1, 1, 0, 0, 0, 0, 0, 0},
 	},
 };
 
@@ -2565,6 +2567,8 @@ spdk_nvmf_ctrlr_identify_ctrlr(struct spdk_nvmf_ctrlr *ctrlr, struct spdk_nvme_c
 
 		cdata->oncs.dsm = nvmf_ctrlr_dsm_supported(ctrlr);
 		cdata->oncs.write_zeroes = nvmf_ctrlr_write_zeroes_supported(ctrlr);
+		cdata->oncs.copy = nvmf_ctrlr_copy_supported(ctrlr);
+		cdata->ocfs.copy_format0 = cdata->oncs.copy;
 		cdata->oncs.reservations = ctrlr->cdata.oncs.reservations;
 		if (subsystem->flags.ana_reporting) {
 			cdata->anatt = ANA_TRANSITION_TIME_IN_SEC;
@@ -3569,6 +3573,7 @@ nvmf_ns_reservation_request_check(struct spdk_nvmf_subsystem_pg_ns_info *ns_info
 	case SPDK_NVME_OPC_WRITE_UNCORRECTABLE:
 	case SPDK_NVME_OPC_WRITE_ZEROES:
 	case SPDK_NVME_OPC_DATASET_MANAGEMENT:
+	case SPDK_NVME_OPC_COPY:
 		if (rtype == SPDK_NVME_RESERVE_WRITE_EXCLUSIVE ||
 		    rtype == SPDK_NVME_RESERVE_EXCLUSIVE_ACCESS) {
 			status = SPDK_NVME_SC_RESERVATION_CONFLICT;
@@ -3885,6 +3890,8 @@ nvmf_ctrlr_process_io_cmd(struct spdk_nvmf_request *req)
 		return nvmf_bdev_ctrlr_flush_cmd(bdev, desc, ch, req);
 	case SPDK_NVME_OPC_DATASET_MANAGEMENT:
 		return nvmf_bdev_ctrlr_dsm_cmd(bdev, desc, ch, req);
+	case SPDK_NVME_OPC_COPY:
+		return nvmf_bdev_ctrlr_copy_cmd(bdev, desc, ch, req);
 	case SPDK_NVME_OPC_RESERVATION_REGISTER:
 	case SPDK_NVME_OPC_RESERVATION_ACQUIRE:
 	case SPDK_NVME_OPC_RESERVATION_RELEASE:
@@ -88,6 +88,40 @@ nvmf_ctrlr_write_zeroes_supported(struct spdk_nvmf_ctrlr *ctrlr)
 	return nvmf_subsystem_bdev_io_type_supported(ctrlr->subsys, SPDK_BDEV_IO_TYPE_WRITE_ZEROES);
 }
 
+static bool
+nvmf_bdev_copy_supported(struct spdk_bdev *bdev)
+{
+	/* spdk_bdev_copy_blocks() emulates copy with reads and writes on bdevs without
+	 *  native copy support.
+	 */
+	return spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_COPY) ||
+	       (spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_READ) &&
+		spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_WRITE));
+}
+
+bool
+nvmf_ctrlr_copy_supported(struct spdk_nvmf_ctrlr *ctrlr)
+{
+	struct spdk_nvmf_subsystem *subsystem = ctrlr->subsys;
+	struct spdk_nvmf_ns *ns;
+
+	for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
+	     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
+		if (ns->bdev == NULL) {
+			continue;
+		}
+
+		if (!nvmf_bdev_copy_supported(ns->bdev)) {
+			SPDK_DEBUGLOG(nvmf, "Subsystem %s namespace %u (%s) does not support copy\n",
+				      spdk_nvmf_subsystem_get_nqn(subsystem),
+				      ns->opts.nsid, spdk_bdev_get_name(ns->bdev));
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static void
 nvmf_bdev_ctrlr_complete_cmd(struct spdk_bdev_io *bdev_io, bool success,
 			     void *cb_arg)
@@ -142,6 +176,7 @@ nvmf_bdev_ctrlr_identify_ns(struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *n
 	struct spdk_bdev *bdev = ns->bdev;
 	uint64_t num_blocks;
 	uint32_t phys_blocklen;
+	uint32_t max_copy;
 
 	num_blocks = spdk_bdev_get_num_blocks(bdev);
 
@@ -197,6 +232,15 @@ nvmf_bdev_ctrlr_identify_ns(struct spdk_nvmf_ns *ns, struct spdk_nvme_ns_data *n
 
 	nsdata->noiob = spdk_bdev_get_optimal_io_boundary(bdev);
 	nsdata->nmic.can_share = 1;
+
+	/* Only a single source range per Copy command is supported. */
+	max_copy = spdk_bdev_get_max_copy(bdev);
+	if (max_copy == 0 || max_copy > UINT16_MAX) {
+		max_copy = UINT16_MAX;
+	}
+	nsdata->mssrl = max_copy;
+	nsdata->mcl = max_copy;
+	nsdata->msrc = 0;
 	if (ns->ptpl_file != NULL) {
 		nsdata->nsrescap.rescap.persist = 1;
 	}
@@ -513,6 +557,79 @@ nvmf_bdev_ctrlr_write_zeroes_cmd(struct spdk_bdev *bdev, struct spdk_bdev_desc *
 	return SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS;
 }
 
+int
+nvmf_bdev_ctrlr_copy_cmd(struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+			 struct spdk_io_channel *ch, struct spdk_nvmf_request *req)
+{
+	uint64_t bdev_num_blocks = spdk_bdev_get_num_blocks(bdev);
+	struct spdk_nvme_cmd *cmd = &req->cmd->nvme_cmd;
+	struct spdk_nvme_cpl *rsp = &req->rsp->nvme_cpl;
+	struct spdk_nvme_scc_source_range *range;
+	uint64_t sdlba, slba, num_blocks;
+	uint32_t nr, format;
+	int rc;
+
+	/* SDLBA: CDW10 and CDW11 */
+	sdlba = from_le64(&cmd->cdw10);
+	/* NR: CDW12 bits 07:00, 0's based. Descriptor format: CDW12 bits 11:08 */
+	nr = (from_le32(&cmd->cdw12) & 0xFFu) + 1;
+	format = (from_le32(&cmd->cdw12) >> 8) & 0xFu;
+
+	if (format != 0) {
+		SPDK_ERRLOG("Copy descriptor format %" PRIu32 " is not supported\n", format);
+		rsp->status.sct = SPDK_NVME_SCT_GENERIC;
+		rsp->status.sc = SPDK_NVME_SC_INVALID_FIELD;
+		rsp->status.dnr = 1;
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
+	if (nr != 1) {
+		SPDK_ERRLOG("Copy with %" PRIu32 " source ranges is not supported\n", nr);
+		rsp->status.sct = SPDK_NVME_SCT_COMMAND_SPECIFIC;
+		rsp->status.sc = SPDK_NVME_SC_CMD_SIZE_LIMIT_SIZE_EXCEEDED;
+		rsp->status.dnr = 1;
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
+	if (req->length < sizeof(*range) || req->data == NULL) {
+		SPDK_ERRLOG("Copy source range descriptor > SGL length\n");
+		rsp->status.sct = SPDK_NVME_SCT_GENERIC;
+		rsp->status.sc = SPDK_NVME_SC_DATA_SGL_LENGTH_INVALID;
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
+	range = (struct spdk_nvme_scc_source_range *)req->data;
+	slba = range->slba;
+	num_blocks = (uint64_t)range->nlb + 1;
+
+	if (spdk_unlikely(!nvmf_bdev_ctrlr_lba_in_range(bdev_num_blocks, sdlba, num_blocks) ||
+			  !nvmf_bdev_ctrlr_lba_in_range(bdev_num_blocks, slba, num_blocks))) {
+		SPDK_ERRLOG("end of media\n");
+		rsp->status.sct = SPDK_NVME_SCT_GENERIC;
+		rsp->status.sc = SPDK_NVME_SC_LBA_OUT_OF_RANGE;
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
+	rc = spdk_bdev_copy_blocks(desc, ch, sdlba, slba, num_blocks,
+				   nvmf_bdev_ctrlr_complete_cmd, req);
+	if (spdk_unlikely(rc)) {
+		if (rc == -ENOMEM) {
+			nvmf_bdev_ctrl_queue_io(req, bdev, ch, nvmf_ctrlr_process_io_cmd_resubmit, req);
+			return SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS;
+		}
+		rsp->status.sct = SPDK_NVME_SCT_GENERIC;
+		if (rc == -EINVAL) {
+			rsp->status.sc = SPDK_NVME_SC_INVALID_FIELD;
+			rsp->status.dnr = 1;
+		} else {
+			rsp->status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+		}
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
+	return SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS;
+}
+
 int
 nvmf_bdev_ctrlr_flush_cmd(struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 			  struct spdk_io_channel *ch, struct spdk_nvmf_request *req)
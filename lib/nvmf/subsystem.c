@@ -1647,6 +1647,18 @@ spdk_nvmf_subsystem_add_ns_ext(struct spdk_nvmf_subsystem *subsystem, const char
 
 	ns->bdev = spdk_bdev_desc_get_bdev(ns->desc);
 
+	/* Account the I/O of each subsystem to the bdev QoS class named after its NQN. */
+	if (spdk_bdev_desc_set_qos_class(ns->desc, subsystem->subnqn) != 0) {
+		SPDK_WARNLOG("Subsystem %s: unable to set QoS class of bdev %s\n",
+			     subsystem->subnqn, bdev_name);
+	}
+
+	/* Report the subsystem in the per descriptor statistics of the bdev as well. */
+	if (spdk_bdev_desc_set_label(ns->desc, subsystem->subnqn) != 0) {
+		SPDK_WARNLOG("Subsystem %s: unable to set descriptor label of bdev %s\n",
+			     subsystem->subnqn, bdev_name);
+	}
+
 	if (spdk_bdev_get_md_size(ns->bdev) != 0 && !spdk_bdev_is_md_interleaved(ns->bdev)) {
 		SPDK_ERRLOG("Can't attach bdev with separate metadata.\n");
 		spdk_bdev_close(ns->desc);
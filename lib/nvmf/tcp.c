@@ -220,6 +220,13 @@ struct spdk_nvmf_tcp_req  {
 	 */
 	uint32_t				h2c_offset;
 
+	/*
+	 * Data digest of an H2C data PDU carrying the whole request, saved while
+	 * the digest of the received data is computed by the accel framework.
+	 */
+	uint8_t					h2c_ddgst[SPDK_NVME_TCP_DIGEST_LEN];
+	uint32_t				h2c_ddgst_crc32;
+
 	STAILQ_ENTRY(spdk_nvmf_tcp_req)		link;
 	TAILQ_ENTRY(spdk_nvmf_tcp_req)		state_link;
 };
@@ -247,6 +254,12 @@ struct spdk_nvmf_tcp_qpair {
 	bool					host_hdgst_enable;
 	bool					host_ddgst_enable;
 
+	/* Number of digest calculations submitted to the accel framework and not yet
+	 * completed. The qpair is not destroyed until it drops to zero. */
+	uint32_t				num_pending_digests;
+	spdk_nvmf_transport_qpair_fini_cb	fini_cb_fn;
+	void					*fini_cb_arg;
+
 	/* This is a spare PDU used for sending special management
 	 * operations. Primarily, this is used for the initial
 	 * connection response and c2h termination request. */
@@ -295,6 +308,9 @@ struct spdk_nvmf_tcp_poll_group {
 	TAILQ_HEAD(, spdk_nvmf_tcp_qpair)	qpairs;
 	TAILQ_HEAD(, spdk_nvmf_tcp_qpair)	await_req;
 
+	/* PDUs waiting for their header digests to be computed in a batch */
+	TAILQ_HEAD(, nvme_tcp_pdu)		hdgst_pdus;
+
 	struct spdk_io_channel			*accel_channel;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
@@ -494,12 +510,22 @@ nvmf_tcp_dump_qpair_req_contents(struct spdk_nvmf_tcp_qpair *tqpair)
 static void
 nvmf_tcp_qpair_destroy(struct spdk_nvmf_tcp_qpair *tqpair)
 {
+	struct nvme_tcp_pdu *pdu, *tmp_pdu;
 	int err = 0;
 
 	spdk_trace_record(TRACE_TCP_QP_DESTROY, 0, 0, (uintptr_t)tqpair);
 
 	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
 
+	assert(tqpair->num_pending_digests == 0);
+	if (tqpair->group) {
+		TAILQ_FOREACH_SAFE(pdu, &tqpair->group->hdgst_pdus, tailq, tmp_pdu) {
+			if (pdu->qpair == tqpair) {
+				TAILQ_REMOVE(&tqpair->group->hdgst_pdus, pdu, tailq);
+			}
+		}
+	}
+
 	err = spdk_sock_close(&tqpair->sock);
 	assert(err == 0);
 	nvmf_tcp_cleanup_all_states(tqpair);
@@ -522,6 +548,26 @@ nvmf_tcp_qpair_destroy(struct spdk_nvmf_tcp_qpair *tqpair)
 	SPDK_DEBUGLOG(nvmf_tcp, "Leave\n");
 }
 
+static void
+nvmf_tcp_qpair_put_digest(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	spdk_nvmf_transport_qpair_fini_cb cb_fn;
+	void *cb_arg;
+
+	assert(tqpair->num_pending_digests > 0);
+	tqpair->num_pending_digests--;
+
+	/* Finish the destruction deferred by nvmf_tcp_close_qpair() */
+	if (tqpair->num_pending_digests == 0 && tqpair->state == NVME_TCP_QPAIR_STATE_EXITED) {
+		cb_fn = tqpair->fini_cb_fn;
+		cb_arg = tqpair->fini_cb_arg;
+		nvmf_tcp_qpair_destroy(tqpair);
+		if (cb_fn) {
+			cb_fn(cb_arg);
+		}
+	}
+}
+
 static void
 nvmf_tcp_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json_write_ctx *w)
 {
@@ -888,17 +934,19 @@ static void
 data_crc32_accel_done(void *cb_arg, int status)
 {
 	struct nvme_tcp_pdu *pdu = cb_arg;
+	struct spdk_nvmf_tcp_qpair *tqpair = pdu->qpair;
 
 	if (spdk_unlikely(status)) {
 		SPDK_ERRLOG("Failed to compute the data digest for pdu =%p\n", pdu);
 		_pdu_write_done(pdu, status);
-		return;
-	}
+	} else {
+		pdu->data_digest_crc32 ^= SPDK_CRC32C_XOR;
+		MAKE_DIGEST_WORD(pdu->data_digest, pdu->data_digest_crc32);
 
-	pdu->data_digest_crc32 ^= SPDK_CRC32C_XOR;
-	MAKE_DIGEST_WORD(pdu->data_digest, pdu->data_digest_crc32);
+		_tcp_write_pdu(pdu);
+	}
 
-	_tcp_write_pdu(pdu);
+	nvmf_tcp_qpair_put_digest(tqpair);
 }
 
 static void
@@ -906,15 +954,22 @@ pdu_data_crc32_compute(struct nvme_tcp_pdu *pdu)
 {
 	struct spdk_nvmf_tcp_qpair *tqpair = pdu->qpair;
 	uint32_t crc32c;
+	int rc;
 
 	/* Data Digest */
 	if (pdu->data_len > 0 && g_nvme_tcp_ddgst[pdu->hdr.common.pdu_type] && tqpair->host_ddgst_enable) {
 		/* Only suport this limitated case for the first step */
 		if (spdk_likely(!pdu->dif_ctx && (pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT == 0)
 				&& tqpair->group)) {
-			spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &pdu->data_digest_crc32,
-						  pdu->data_iov, pdu->data_iovcnt, 0, data_crc32_accel_done, pdu);
-			return;
+			tqpair->num_pending_digests++;
+			rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel,
+						       &pdu->data_digest_crc32,
+						       pdu->data_iov, pdu->data_iovcnt, 0,
+						       data_crc32_accel_done, pdu);
+			if (spdk_likely(rc == 0)) {
+				return;
+			}
+			tqpair->num_pending_digests--;
 		}
 
 		crc32c = nvme_tcp_pdu_calc_data_digest(pdu);
@@ -944,6 +999,12 @@ nvmf_tcp_qpair_write_pdu(struct spdk_nvmf_tcp_qpair *tqpair,
 
 	/* Header Digest */
 	if (g_nvme_tcp_hdgst[pdu->hdr.common.pdu_type] && tqpair->host_hdgst_enable) {
+		if (tqpair->group) {
+			/* Computed together with the other PDUs sent during this poll */
+			TAILQ_INSERT_TAIL(&tqpair->group->hdgst_pdus, pdu, tailq);
+			return;
+		}
+
 		crc32c = nvme_tcp_pdu_calc_header_digest(pdu);
 		MAKE_DIGEST_WORD((uint8_t *)pdu->hdr.raw + hlen, crc32c);
 	}
@@ -952,6 +1013,28 @@ nvmf_tcp_qpair_write_pdu(struct spdk_nvmf_tcp_qpair *tqpair,
 	pdu_data_crc32_compute(pdu);
 }
 
+static void
+nvmf_tcp_poll_group_flush_hdgst(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	struct nvme_tcp_pdu *pdus[NVME_TCP_HDGST_BATCH_SIZE];
+	int i, count;
+
+	while (!TAILQ_EMPTY(&tgroup->hdgst_pdus)) {
+		count = 0;
+		while (count < NVME_TCP_HDGST_BATCH_SIZE && !TAILQ_EMPTY(&tgroup->hdgst_pdus)) {
+			pdus[count] = TAILQ_FIRST(&tgroup->hdgst_pdus);
+			TAILQ_REMOVE(&tgroup->hdgst_pdus, pdus[count], tailq);
+			count++;
+		}
+
+		nvme_tcp_pdus_set_header_digest(pdus, count);
+
+		for (i = 0; i < count; i++) {
+			pdu_data_crc32_compute(pdus[i]);
+		}
+	}
+}
+
 static int
 nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair)
 {
@@ -1211,6 +1294,7 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport)
 
 	TAILQ_INIT(&tgroup->qpairs);
 	TAILQ_INIT(&tgroup->await_req);
+	TAILQ_INIT(&tgroup->hdgst_pdus);
 
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 
@@ -1676,21 +1760,12 @@ nvmf_tcp_send_r2t_pdu(struct spdk_nvmf_tcp_qpair *tqpair,
 }
 
 static void
-nvmf_tcp_h2c_data_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
-				 struct spdk_nvmf_tcp_qpair *tqpair,
-				 struct nvme_tcp_pdu *pdu)
+nvmf_tcp_h2c_data_received(struct spdk_nvmf_tcp_transport *ttransport,
+			   struct spdk_nvmf_tcp_req *tcp_req, uint32_t data_len)
 {
-	struct spdk_nvmf_tcp_req *tcp_req;
 	struct spdk_nvme_cpl *rsp;
 
-	tcp_req = pdu->req;
-	assert(tcp_req != NULL);
-
-	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
-
-	tcp_req->h2c_offset += pdu->data_len;
-
-	nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY);
+	tcp_req->h2c_offset += data_len;
 
 	/* Wait for all of the data to arrive AND for the initial R2T PDU send to be
 	 * acknowledged before moving on. */
@@ -1708,6 +1783,86 @@ nvmf_tcp_h2c_data_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	}
 }
 
+static void
+nvmf_tcp_h2c_data_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
+				 struct spdk_nvmf_tcp_qpair *tqpair,
+				 struct nvme_tcp_pdu *pdu)
+{
+	struct spdk_nvmf_tcp_req *tcp_req;
+	uint32_t data_len;
+
+	tcp_req = pdu->req;
+	assert(tcp_req != NULL);
+
+	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
+
+	data_len = pdu->data_len;
+	nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY);
+
+	nvmf_tcp_h2c_data_received(ttransport, tcp_req, data_len);
+}
+
+static void
+nvmf_tcp_h2c_data_crc32_done(void *cb_arg, int status)
+{
+	struct spdk_nvmf_tcp_req *tcp_req = cb_arg;
+	struct spdk_nvmf_tcp_qpair *tqpair = SPDK_CONTAINEROF(tcp_req->req.qpair,
+					     struct spdk_nvmf_tcp_qpair, qpair);
+	struct spdk_nvmf_tcp_transport *ttransport = SPDK_CONTAINEROF(tqpair->qpair.transport,
+			struct spdk_nvmf_tcp_transport, transport);
+	struct spdk_nvme_cpl *rsp = &tcp_req->req.rsp->nvme_cpl;
+	uint32_t crc32c;
+
+	if (spdk_likely(tqpair->state == NVME_TCP_QPAIR_STATE_RUNNING)) {
+		crc32c = tcp_req->h2c_ddgst_crc32 ^ SPDK_CRC32C_XOR;
+		if (spdk_unlikely(status || !MATCH_DIGEST_WORD(tcp_req->h2c_ddgst, crc32c))) {
+			SPDK_ERRLOG("Data digest error on tqpair=(%p) with tcp_req=%p\n",
+				    tqpair, tcp_req);
+			rsp->status.sc = SPDK_NVME_SC_COMMAND_TRANSIENT_TRANSPORT_ERROR;
+		}
+
+		nvmf_tcp_h2c_data_received(ttransport, tcp_req, tcp_req->req.length);
+	}
+
+	nvmf_tcp_qpair_put_digest(tqpair);
+}
+
+/*
+ * Verify the data digest of an H2C data PDU with the accel framework. Only PDUs
+ * carrying the whole request are handled, so that the digest can be computed
+ * over the request's buffers while the next PDU is already being received.
+ */
+static int
+nvmf_tcp_h2c_data_crc32_submit(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu)
+{
+	struct spdk_nvmf_tcp_req *tcp_req = pdu->req;
+	int rc;
+
+	assert(tcp_req != NULL);
+
+	if (pdu->dif_ctx || !tqpair->group || tcp_req->h2c_offset != 0 ||
+	    pdu->data_len != tcp_req->req.length ||
+	    pdu->data_len % SPDK_NVME_TCP_DIGEST_ALIGNMENT != 0) {
+		return -ENOTSUP;
+	}
+
+	memcpy(tcp_req->h2c_ddgst, pdu->data_digest, sizeof(tcp_req->h2c_ddgst));
+	nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY);
+
+	tqpair->num_pending_digests++;
+	rc = spdk_accel_submit_crc32cv(tqpair->group->accel_channel, &tcp_req->h2c_ddgst_crc32,
+				       tcp_req->req.iov, tcp_req->req.iovcnt, 0,
+				       nvmf_tcp_h2c_data_crc32_done, tcp_req);
+	if (spdk_unlikely(rc != 0)) {
+		/* The PDU has already been released, so verify the request's buffers here */
+		tcp_req->h2c_ddgst_crc32 = spdk_crc32c_iov_update(tcp_req->req.iov,
+					   tcp_req->req.iovcnt, SPDK_CRC32C_XOR);
+		nvmf_tcp_h2c_data_crc32_done(tcp_req, 0);
+	}
+
+	return 0;
+}
+
 static void
 nvmf_tcp_h2c_term_req_dump(struct spdk_nvme_tcp_term_req_hdr *h2c_term_req)
 {
@@ -1795,6 +1950,11 @@ nvmf_tcp_pdu_payload_handle(struct spdk_nvmf_tcp_qpair *tqpair,
 	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
 	/* check data digest if need */
 	if (pdu->ddgst_enable) {
+		if (pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_H2C_DATA &&
+		    nvmf_tcp_h2c_data_crc32_submit(tqpair, pdu) == 0) {
+			return;
+		}
+
 		crc32c = nvme_tcp_pdu_calc_data_digest(pdu);
 		rc = MATCH_DIGEST_WORD(pdu->data_digest, crc32c);
 		if (rc == 0) {
@@ -2796,6 +2956,8 @@ nvmf_tcp_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 	assert(tqpair->group == tgroup);
 
 	SPDK_DEBUGLOG(nvmf_tcp, "remove tqpair=%p from the tgroup=%p\n", tqpair, tgroup);
+	nvmf_tcp_poll_group_flush_hdgst(tgroup);
+
 	if (tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_REQ) {
 		TAILQ_REMOVE(&tgroup->await_req, tqpair, link);
 	} else {
@@ -2836,6 +2998,14 @@ nvmf_tcp_close_qpair(struct spdk_nvmf_qpair *qpair,
 
 	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
 	nvmf_tcp_qpair_set_state(tqpair, NVME_TCP_QPAIR_STATE_EXITED);
+
+	if (tqpair->num_pending_digests > 0) {
+		/* nvmf_tcp_qpair_put_digest() destroys the qpair once the accel framework is done */
+		tqpair->fini_cb_fn = cb_fn;
+		tqpair->fini_cb_arg = cb_arg;
+		return;
+	}
+
 	nvmf_tcp_qpair_destroy(tqpair);
 
 	if (cb_fn) {
@@ -2860,6 +3030,8 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		return 0;
 	}
 
+	nvmf_tcp_poll_group_flush_hdgst(tgroup);
+
 	STAILQ_FOREACH_SAFE(req, &group->pending_buf_queue, buf_link, req_tmp) {
 		tcp_req = SPDK_CONTAINEROF(req, struct spdk_nvmf_tcp_req, req);
 		if (nvmf_tcp_req_process(ttransport, tcp_req) == false) {
@@ -2876,6 +3048,8 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		nvmf_tcp_sock_process(tqpair);
 	}
 
+	nvmf_tcp_poll_group_flush_hdgst(tgroup);
+
 	return rc;
 }
 
@@ -420,6 +420,22 @@ spdk_sock_readv(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
 	return sock->net_impl->readv(sock, iov, iovcnt);
 }
 
+ssize_t
+spdk_sock_readv_direct(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
+{
+	if (sock == NULL || sock->flags.closed) {
+		errno = EBADF;
+		return -1;
+	}
+
+	/* Implementations without a receive buffer don't read ahead anyway. */
+	if (sock->net_impl->readv_direct == NULL) {
+		return sock->net_impl->readv(sock, iov, iovcnt);
+	}
+
+	return sock->net_impl->readv_direct(sock, iov, iovcnt);
+}
+
 ssize_t
 spdk_sock_writev(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
 {
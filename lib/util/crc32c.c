@@ -33,6 +33,7 @@
 
 #include "util_internal.h"
 #include "spdk/crc32.h"
+#include "spdk/util.h"
 
 #ifdef SPDK_CONFIG_ISAL
 #define SPDK_HAVE_ISAL
@@ -45,6 +46,11 @@
 #include <x86intrin.h>
 #endif
 
+#if defined(__x86_64__) && defined(__SSE4_2__)
+#define SPDK_HAVE_CRC32C_MULTI
+#include <x86intrin.h>
+#endif
+
 #ifdef SPDK_HAVE_ISAL
 
 uint32_t
@@ -149,3 +155,60 @@ spdk_crc32c_iov_update(struct iovec *iov, int iovcnt, uint32_t crc32c)
 
 	return crc32c;
 }
+
+#ifdef SPDK_HAVE_CRC32C_MULTI
+
+/*
+ * The crc32 instruction has a latency of 3 cycles but a throughput of 1 per cycle,
+ * so running three independent streams side by side keeps the unit busy.
+ */
+#define CRC32C_MULTI_LANES 3
+
+static void
+crc32c_update_lanes(const struct iovec *iovs, uint32_t *crcs)
+{
+	const uint8_t *buf[CRC32C_MULTI_LANES];
+	uint64_t crc[CRC32C_MULTI_LANES];
+	uint64_t block;
+	size_t len, count;
+	int i;
+
+	len = iovs[0].iov_len;
+	for (i = 0; i < CRC32C_MULTI_LANES; i++) {
+		buf[i] = iovs[i].iov_base;
+		crc[i] = crcs[i];
+		len = spdk_min(len, iovs[i].iov_len);
+	}
+
+	/* Interleave the 64-bit blocks that all of the buffers have in common. */
+	for (count = len / 8; count > 0; count--) {
+		for (i = 0; i < CRC32C_MULTI_LANES; i++) {
+			memcpy(&block, buf[i], sizeof(block));
+			crc[i] = _mm_crc32_u64(crc[i], block);
+			buf[i] += sizeof(block);
+		}
+	}
+
+	len &= ~(size_t)7;
+	for (i = 0; i < CRC32C_MULTI_LANES; i++) {
+		crcs[i] = spdk_crc32c_update(buf[i], iovs[i].iov_len - len, (uint32_t)crc[i]);
+	}
+}
+
+#endif
+
+void
+spdk_crc32c_update_multi(const struct iovec *iovs, uint32_t *crcs, int count)
+{
+	int i = 0;
+
+#ifdef SPDK_HAVE_CRC32C_MULTI
+	for (; i + CRC32C_MULTI_LANES <= count; i += CRC32C_MULTI_LANES) {
+		crc32c_update_lanes(&iovs[i], &crcs[i]);
+	}
+#endif
+
+	for (; i < count; i++) {
+		crcs[i] = spdk_crc32c_update(iovs[i].iov_base, iovs[i].iov_len, crcs[i]);
+	}
+}
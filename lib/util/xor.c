@@ -0,0 +1,303 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/xor.h"
+#include "spdk/config.h"
+#include "spdk/assert.h"
+#include "spdk/util.h"
+
+#ifdef SPDK_CONFIG_ISAL
+#define SPDK_HAVE_ISAL
+#include <isa-l/include/raid.h>
+
+/* ISA-L xor_gen() requires buffers and length aligned to the SIMD register width */
+#define SPDK_XOR_ISAL_ALIGN 32
+#define SPDK_XOR_ISAL_MAX_SOURCES 254
+#endif
+
+#define SPDK_XOR_BASIC_ALIGN sizeof(uint64_t)
+
+static void
+xor_gen_unaligned(void *dest, void **sources, uint32_t n, size_t len)
+{
+	uint32_t i;
+	size_t off;
+
+	for (off = 0; off + sizeof(uint64_t) <= len; off += sizeof(uint64_t)) {
+		uint64_t w, tmp;
+
+		/*
+		 * Use memcpy() to avoid unaligned loads, which are undefined behavior in C.
+		 * The compiler will optimize out the memcpy() in release builds.
+		 */
+		memcpy(&tmp, (uint8_t *)sources[0] + off, sizeof(tmp));
+		for (i = 1; i < n; i++) {
+			memcpy(&w, (uint8_t *)sources[i] + off, sizeof(w));
+			tmp ^= w;
+		}
+		memcpy((uint8_t *)dest + off, &tmp, sizeof(tmp));
+	}
+
+	for (; off < len; off++) {
+		uint8_t tmp = ((uint8_t *)sources[0])[off];
+
+		for (i = 1; i < n; i++) {
+			tmp ^= ((uint8_t *)sources[i])[off];
+		}
+		((uint8_t *)dest)[off] = tmp;
+	}
+}
+
+static void
+xor_gen_basic(void *dest, void **sources, uint32_t n, size_t len)
+{
+	uint64_t *d = dest;
+	size_t words = len / sizeof(uint64_t);
+	size_t i;
+	uint32_t j;
+
+	/* Process 4 words at a time so that the compiler can keep them in vector registers */
+	for (i = 0; i + 4 <= words; i += 4) {
+		const uint64_t *s = sources[0];
+		uint64_t w0 = s[i], w1 = s[i + 1], w2 = s[i + 2], w3 = s[i + 3];
+
+		for (j = 1; j < n; j++) {
+			s = sources[j];
+			w0 ^= s[i];
+			w1 ^= s[i + 1];
+			w2 ^= s[i + 2];
+			w3 ^= s[i + 3];
+		}
+
+		d[i] = w0;
+		d[i + 1] = w1;
+		d[i + 2] = w2;
+		d[i + 3] = w3;
+	}
+
+	for (; i < words; i++) {
+		uint64_t w = ((const uint64_t *)sources[0])[i];
+
+		for (j = 1; j < n; j++) {
+			w ^= ((const uint64_t *)sources[j])[i];
+		}
+		d[i] = w;
+	}
+}
+
+static bool
+xor_buffers_aligned(void *dest, void **sources, uint32_t n, size_t len, size_t alignment)
+{
+	uint32_t i;
+
+	if ((uintptr_t)dest % alignment || len % alignment) {
+		return false;
+	}
+
+	for (i = 0; i < n; i++) {
+		if ((uintptr_t)sources[i] % alignment) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int
+spdk_xor_gen(void *dest, void **sources, uint32_t n, size_t len)
+{
+	if (n < 2) {
+		return -EINVAL;
+	}
+
+#ifdef SPDK_HAVE_ISAL
+	if (n <= SPDK_XOR_ISAL_MAX_SOURCES && len <= INT_MAX &&
+	    xor_buffers_aligned(dest, sources, n, len, SPDK_XOR_ISAL_ALIGN)) {
+		void *buffers[SPDK_XOR_ISAL_MAX_SOURCES + 1];
+
+		memcpy(buffers, sources, n * sizeof(*sources));
+		buffers[n] = dest;
+
+		if (xor_gen(n + 1, len, buffers) == 0) {
+			return 0;
+		}
+	}
+#endif
+
+	if (xor_buffers_aligned(dest, sources, n, len, SPDK_XOR_BASIC_ALIGN)) {
+		xor_gen_basic(dest, sources, n, len);
+	} else {
+		xor_gen_unaligned(dest, sources, n, len);
+	}
+
+	return 0;
+}
+
+/* Multiply each of the 8 bytes packed in v by 2 in GF(2^8) */
+static inline uint64_t
+gf_mul2_u64(uint64_t v)
+{
+	uint64_t hi = (v >> 7) & 0x0101010101010101ULL;
+
+	return ((v << 1) & 0xfefefefefefefefeULL) ^ (hi * 0x1d);
+}
+
+static inline uint8_t
+gf_mul2_u8(uint8_t v)
+{
+	return (v << 1) ^ ((v & 0x80) ? 0x1d : 0);
+}
+
+/*
+ * Q is computed with Horner's rule starting from the last source, so that
+ * source i ends up multiplied by 2^i.
+ */
+static void
+pq_gen_unaligned(void *p, void *q, void **sources, uint32_t n, size_t len)
+{
+	uint32_t i;
+	size_t off;
+
+	for (off = 0; off + sizeof(uint64_t) <= len; off += sizeof(uint64_t)) {
+		uint64_t w, wp, wq;
+
+		memcpy(&wp, (uint8_t *)sources[n - 1] + off, sizeof(wp));
+		wq = wp;
+		for (i = n - 1; i > 0; i--) {
+			memcpy(&w, (uint8_t *)sources[i - 1] + off, sizeof(w));
+			wp ^= w;
+			wq = gf_mul2_u64(wq) ^ w;
+		}
+		memcpy((uint8_t *)p + off, &wp, sizeof(wp));
+		memcpy((uint8_t *)q + off, &wq, sizeof(wq));
+	}
+
+	for (; off < len; off++) {
+		uint8_t wp = ((uint8_t *)sources[n - 1])[off];
+		uint8_t wq = wp;
+
+		for (i = n - 1; i > 0; i--) {
+			uint8_t w = ((uint8_t *)sources[i - 1])[off];
+
+			wp ^= w;
+			wq = gf_mul2_u8(wq) ^ w;
+		}
+		((uint8_t *)p)[off] = wp;
+		((uint8_t *)q)[off] = wq;
+	}
+}
+
+static void
+pq_gen_basic(void *p, void *q, void **sources, uint32_t n, size_t len)
+{
+	uint64_t *dp = p, *dq = q;
+	size_t words = len / sizeof(uint64_t);
+	size_t i;
+	uint32_t j;
+
+	for (i = 0; i + 2 <= words; i += 2) {
+		const uint64_t *s = sources[n - 1];
+		uint64_t p0 = s[i], p1 = s[i + 1];
+		uint64_t q0 = p0, q1 = p1;
+
+		for (j = n - 1; j > 0; j--) {
+			s = sources[j - 1];
+			p0 ^= s[i];
+			p1 ^= s[i + 1];
+			q0 = gf_mul2_u64(q0) ^ s[i];
+			q1 = gf_mul2_u64(q1) ^ s[i + 1];
+		}
+
+		dp[i] = p0;
+		dp[i + 1] = p1;
+		dq[i] = q0;
+		dq[i + 1] = q1;
+	}
+
+	for (; i < words; i++) {
+		uint64_t wp = ((const uint64_t *)sources[n - 1])[i];
+		uint64_t wq = wp;
+
+		for (j = n - 1; j > 0; j--) {
+			uint64_t w = ((const uint64_t *)sources[j - 1])[i];
+
+			wp ^= w;
+			wq = gf_mul2_u64(wq) ^ w;
+		}
+		dp[i] = wp;
+		dq[i] = wq;
+	}
+}
+
+int
+spdk_pq_gen(void *p, void *q, void **sources, uint32_t n, size_t len)
+{
+	if (n < 2) {
+		return -EINVAL;
+	}
+
+#ifdef SPDK_HAVE_ISAL
+	if (n <= SPDK_XOR_ISAL_MAX_SOURCES - 1 && len <= INT_MAX &&
+	    xor_buffers_aligned(p, sources, n, len, SPDK_XOR_ISAL_ALIGN) &&
+	    (uintptr_t)q % SPDK_XOR_ISAL_ALIGN == 0) {
+		void *buffers[SPDK_XOR_ISAL_MAX_SOURCES + 1];
+
+		memcpy(buffers, sources, n * sizeof(*sources));
+		buffers[n] = p;
+		buffers[n + 1] = q;
+
+		if (pq_gen(n + 2, len, buffers) == 0) {
+			return 0;
+		}
+	}
+#endif
+
+	if (xor_buffers_aligned(p, sources, n, len, SPDK_XOR_BASIC_ALIGN) &&
+	    (uintptr_t)q % SPDK_XOR_BASIC_ALIGN == 0) {
+		pq_gen_basic(p, q, sources, n, len);
+	} else {
+		pq_gen_unaligned(p, q, sources, n, len);
+	}
+
+	return 0;
+}
+
+size_t
+spdk_xor_get_optimal_alignment(void)
+{
+#ifdef SPDK_HAVE_ISAL
+	return SPDK_XOR_ISAL_ALIGN;
+#else
+	return SPDK_XOR_BASIC_ALIGN;
+#endif
+}
@@ -1549,6 +1549,10 @@ spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_
 	}
 	bdev = spdk_bdev_desc_get_bdev(bvdev->bdev_desc);
 
+	if (spdk_bdev_desc_set_label(bvdev->bdev_desc, name) != 0) {
+		SPDK_WARNLOG("%s: unable to set descriptor label of bdev '%s'\n", name, dev_name);
+	}
+
 	vdev = &bvdev->vdev;
 	vdev->virtio_features = SPDK_VHOST_BLK_FEATURES_BASE;
 	vdev->disabled_features = SPDK_VHOST_BLK_DISABLED_FEATURES;
@@ -72,7 +72,7 @@ DEPDIRS-nvme += vfio_user
 endif
 
 DEPDIRS-blob := log util thread
-DEPDIRS-accel := log util thread json
+DEPDIRS-accel := log util thread $(JSON_LIBS)
 DEPDIRS-jsonrpc := log util json
 DEPDIRS-virtio := log util json thread
 
@@ -147,8 +147,10 @@ DEPDIRS-bdev_rpc := $(BDEV_DEPS)
 DEPDIRS-bdev_split := $(BDEV_DEPS)
 
 DEPDIRS-bdev_aio := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_cache := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_compress := $(BDEV_DEPS_THREAD) reduce
 DEPDIRS-bdev_crypto := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_dedup := $(BDEV_DEPS_THREAD) accel
 DEPDIRS-bdev_delay := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_iscsi := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_null := $(BDEV_DEPS_THREAD)
@@ -158,8 +160,10 @@ DEPDIRS-bdev_passthru := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_pmem := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_raid := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_rbd := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_readahead := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_uring := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_virtio := $(BDEV_DEPS_THREAD) virtio
+DEPDIRS-bdev_write_merge := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_zone_block := $(BDEV_DEPS_THREAD)
 ifeq ($(OS),Linux)
 DEPDIRS-bdev_ftl := $(BDEV_DEPS_THREAD) ftl
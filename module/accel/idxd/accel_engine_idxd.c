@@ -247,6 +247,102 @@ queue_tasks:
 	return 0;
 }
 
+static void
+idxd_batch_task_done(void *cb_arg, int status)
+{
+	struct spdk_accel_task *accel_task = cb_arg;
+
+	spdk_accel_task_complete(accel_task, status);
+}
+
+static void
+idxd_batch_done(void *cb_arg, int status)
+{
+	struct spdk_accel_batch *batch = cb_arg;
+	struct idxd_io_channel *chan = spdk_io_channel_get_ctx(batch->accel_ch->engine_ch);
+
+	assert(chan->num_outstanding > 0);
+	spdk_trace_record(TRACE_IDXD_OP_COMPLETE, 0, 0, 0, chan->num_outstanding - 1);
+	if (chan->num_outstanding-- == chan->max_outstanding) {
+		chan->state = IDXD_CHANNEL_ACTIVE;
+	}
+
+	spdk_accel_batch_complete(batch, status);
+}
+
+static int
+_prep_batch_task(struct idxd_io_channel *chan, struct idxd_batch *idxd_batch,
+		 struct spdk_accel_task *task)
+{
+	uint8_t fill_pattern = (uint8_t)task->fill_pattern;
+
+	switch (task->op_code) {
+	case ACCEL_OPCODE_MEMMOVE:
+		return spdk_idxd_batch_prep_copy(chan->chan, idxd_batch, task->dst, task->src, task->nbytes,
+						 idxd_batch_task_done, task);
+	case ACCEL_OPCODE_DUALCAST:
+		return spdk_idxd_batch_prep_dualcast(chan->chan, idxd_batch, task->dst, task->dst2, task->src,
+						     task->nbytes, idxd_batch_task_done, task);
+	case ACCEL_OPCODE_COMPARE:
+		return spdk_idxd_batch_prep_compare(chan->chan, idxd_batch, task->src, task->src2,
+						    task->nbytes, idxd_batch_task_done, task);
+	case ACCEL_OPCODE_MEMFILL:
+		memset(&task->fill_pattern, fill_pattern, sizeof(uint64_t));
+		return spdk_idxd_batch_prep_fill(chan->chan, idxd_batch, task->dst, task->fill_pattern,
+						 task->nbytes, idxd_batch_task_done, task);
+	case ACCEL_OPCODE_CRC32C:
+		return spdk_idxd_batch_prep_crc32c(chan->chan, idxd_batch, task->crc_dst, task->src, task->seed,
+						   task->nbytes, idxd_batch_task_done, task);
+	case ACCEL_OPCODE_COPY_CRC32C:
+		return spdk_idxd_batch_prep_copy_crc32c(chan->chan, idxd_batch, task->dst, task->src,
+							task->crc_dst, task->seed, task->nbytes,
+							idxd_batch_task_done, task);
+	default:
+		return -EINVAL;
+	}
+}
+
+/* Maps an accel batch to a single DSA batch descriptor. When the channel can't
+ * take it right now, the accel framework submits the tasks one by one instead,
+ * which goes through the regular queueing.
+ */
+static int
+idxd_submit_batch(struct spdk_io_channel *ch, struct spdk_accel_batch *batch)
+{
+	struct idxd_io_channel *chan = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *task;
+	struct idxd_batch *idxd_batch;
+	int rc;
+
+	if (chan->state != IDXD_CHANNEL_ACTIVE || chan->num_outstanding == chan->max_outstanding) {
+		return -EBUSY;
+	}
+
+	idxd_batch = spdk_idxd_batch_create(chan->chan);
+	if (idxd_batch == NULL) {
+		return -EBUSY;
+	}
+
+	TAILQ_FOREACH(task, &batch->tasks, link) {
+		rc = _prep_batch_task(chan, idxd_batch, task);
+		if (rc) {
+			spdk_idxd_batch_cancel(chan->chan, idxd_batch);
+			return rc;
+		}
+	}
+
+	rc = spdk_idxd_batch_submit(chan->chan, idxd_batch, idxd_batch_done, batch);
+	if (rc) {
+		spdk_idxd_batch_cancel(chan->chan, idxd_batch);
+		return rc;
+	}
+
+	chan->num_outstanding++;
+	spdk_trace_record(TRACE_IDXD_OP_SUBMIT, 0, 0, 0, chan->num_outstanding);
+
+	return 0;
+}
+
 static int
 idxd_poll(void *arg)
 {
@@ -285,9 +381,12 @@ idxd_get_capabilities(void)
 }
 
 static struct spdk_accel_engine idxd_accel_engine = {
+	.name			= "idxd",
 	.get_capabilities	= idxd_get_capabilities,
 	.get_io_channel		= idxd_get_io_channel,
 	.submit_tasks		= idxd_submit_tasks,
+	.batch_get_max		= spdk_idxd_batch_get_max,
+	.submit_batch		= idxd_submit_batch,
 };
 
 static int
@@ -0,0 +1,500 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/queue.h"
+#include "spdk/util.h"
+
+#include "cache_table.h"
+
+enum cache_queue {
+	CACHE_QUEUE_FREE,
+	/* A1in: lines seen once, FIFO */
+	CACHE_QUEUE_RECENT,
+	/* Am: lines seen more than once, LRU */
+	CACHE_QUEUE_FREQUENT,
+	/* A1out: tags of lines evicted from A1in, FIFO */
+	CACHE_QUEUE_GHOST,
+	CACHE_QUEUE_COUNT,
+};
+
+struct cache_entry {
+	uint64_t			tag;
+	/* NULL for ghost entries */
+	void				*data;
+	struct cache_entry		*hash_next;
+	TAILQ_ENTRY(cache_entry)	link;
+	enum cache_queue		queue;
+};
+
+TAILQ_HEAD(cache_entry_list, cache_entry);
+
+struct cache_shard {
+	pthread_spinlock_t		lock;
+	uint64_t			write_seq;
+
+	struct cache_entry		**buckets;
+	uint64_t			bucket_mask;
+
+	/* Line entries followed by ghost entries */
+	struct cache_entry		*entries;
+	uint64_t			num_lines;
+	uint64_t			num_ghosts;
+	/* Size A1in is allowed to grow to before Am lines get evicted */
+	uint64_t			recent_max;
+
+	struct cache_entry_list		free_lines;
+	struct cache_entry_list		free_ghosts;
+	struct cache_entry_list		queue[CACHE_QUEUE_COUNT];
+	uint64_t			queue_len[CACHE_QUEUE_COUNT];
+
+	uint64_t			insertions;
+	uint64_t			evictions;
+	uint64_t			invalidations;
+	uint64_t			ghost_hits;
+} __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
+
+struct cache_table {
+	struct cache_shard		*shards;
+	uint32_t			num_shards;
+	uint32_t			line_size;
+	uint64_t			num_lines;
+	void				*data;
+	uint64_t			memory_bytes;
+};
+
+static inline uint64_t
+cache_hash(uint64_t tag)
+{
+	return tag * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline struct cache_shard *
+cache_get_shard(struct cache_table *table, uint64_t tag)
+{
+	return &table->shards[(cache_hash(tag) >> 32) & (table->num_shards - 1)];
+}
+
+static struct cache_entry *
+cache_shard_lookup(struct cache_shard *shard, uint64_t tag)
+{
+	struct cache_entry *entry;
+
+	entry = shard->buckets[cache_hash(tag) & shard->bucket_mask];
+	while (entry != NULL && entry->tag != tag) {
+		entry = entry->hash_next;
+	}
+
+	return entry;
+}
+
+static void
+cache_shard_hash_insert(struct cache_shard *shard, struct cache_entry *entry)
+{
+	struct cache_entry **bucket = &shard->buckets[cache_hash(entry->tag) & shard->bucket_mask];
+
+	entry->hash_next = *bucket;
+	*bucket = entry;
+}
+
+static void
+cache_shard_hash_remove(struct cache_shard *shard, struct cache_entry *entry)
+{
+	struct cache_entry **prev = &shard->buckets[cache_hash(entry->tag) & shard->bucket_mask];
+
+	while (*prev != entry) {
+		assert(*prev != NULL);
+		prev = &(*prev)->hash_next;
+	}
+	*prev = entry->hash_next;
+	entry->hash_next = NULL;
+}
+
+static void
+cache_shard_enqueue(struct cache_shard *shard, struct cache_entry *entry, enum cache_queue queue)
+{
+	entry->queue = queue;
+	TAILQ_INSERT_TAIL(&shard->queue[queue], entry, link);
+	shard->queue_len[queue]++;
+}
+
+static void
+cache_shard_dequeue(struct cache_shard *shard, struct cache_entry *entry)
+{
+	assert(shard->queue_len[entry->queue] > 0);
+	TAILQ_REMOVE(&shard->queue[entry->queue], entry, link);
+	shard->queue_len[entry->queue]--;
+	entry->queue = CACHE_QUEUE_FREE;
+}
+
+static void
+cache_shard_remember_ghost(struct cache_shard *shard, uint64_t tag)
+{
+	struct cache_entry *ghost;
+
+	ghost = TAILQ_FIRST(&shard->free_ghosts);
+	if (ghost != NULL) {
+		TAILQ_REMOVE(&shard->free_ghosts, ghost, link);
+	} else {
+		/* Forget the oldest ghost */
+		ghost = TAILQ_FIRST(&shard->queue[CACHE_QUEUE_GHOST]);
+		assert(ghost != NULL);
+		cache_shard_dequeue(shard, ghost);
+		cache_shard_hash_remove(shard, ghost);
+	}
+
+	ghost->tag = tag;
+	cache_shard_hash_insert(shard, ghost);
+	cache_shard_enqueue(shard, ghost, CACHE_QUEUE_GHOST);
+}
+
+/*
+ * Free up a line following 2Q: take the oldest A1in line while A1in is above
+ * its share of the shard (or Am is empty) and remember its tag in A1out,
+ * otherwise drop the least recently used Am line.
+ */
+static struct cache_entry *
+cache_shard_reclaim(struct cache_shard *shard)
+{
+	struct cache_entry *victim;
+
+	if (shard->queue_len[CACHE_QUEUE_RECENT] > shard->recent_max ||
+	    shard->queue_len[CACHE_QUEUE_FREQUENT] == 0) {
+		victim = TAILQ_FIRST(&shard->queue[CACHE_QUEUE_RECENT]);
+		assert(victim != NULL);
+		cache_shard_dequeue(shard, victim);
+		cache_shard_hash_remove(shard, victim);
+		cache_shard_remember_ghost(shard, victim->tag);
+	} else {
+		victim = TAILQ_FIRST(&shard->queue[CACHE_QUEUE_FREQUENT]);
+		cache_shard_dequeue(shard, victim);
+		cache_shard_hash_remove(shard, victim);
+	}
+
+	shard->evictions++;
+
+	return victim;
+}
+
+static void
+cache_iov_copy(struct iovec *iovs, int iovcnt, size_t iov_offset, void *buf, size_t len,
+	       bool to_iovs)
+{
+	uint8_t *ptr = buf;
+	size_t n;
+	int i;
+
+	for (i = 0; i < iovcnt && len > 0; i++) {
+		if (iov_offset >= iovs[i].iov_len) {
+			iov_offset -= iovs[i].iov_len;
+			continue;
+		}
+
+		n = spdk_min(len, iovs[i].iov_len - iov_offset);
+		if (to_iovs) {
+			memcpy((uint8_t *)iovs[i].iov_base + iov_offset, ptr, n);
+		} else {
+			memcpy(ptr, (uint8_t *)iovs[i].iov_base + iov_offset, n);
+		}
+
+		ptr += n;
+		len -= n;
+		iov_offset = 0;
+	}
+
+	assert(len == 0);
+}
+
+static int
+cache_shard_init(struct cache_shard *shard, struct cache_table *table, uint64_t num_lines,
+		 uint8_t *data)
+{
+	uint64_t num_buckets, i;
+	int q;
+
+	shard->num_lines = num_lines;
+	/* 2Q recommends Kin = 25% and Kout = 50% of the cache size */
+	shard->recent_max = spdk_max(num_lines / 4, 1);
+	shard->num_ghosts = spdk_max(num_lines / 2, 1);
+
+	num_buckets = spdk_align64pow2(num_lines + shard->num_ghosts);
+	shard->bucket_mask = num_buckets - 1;
+	shard->buckets = calloc(num_buckets, sizeof(*shard->buckets));
+	shard->entries = calloc(num_lines + shard->num_ghosts, sizeof(*shard->entries));
+	if (shard->buckets == NULL || shard->entries == NULL) {
+		goto err;
+	}
+	table->memory_bytes += num_buckets * sizeof(*shard->buckets) +
+			       (num_lines + shard->num_ghosts) * sizeof(*shard->entries);
+
+	TAILQ_INIT(&shard->free_lines);
+	TAILQ_INIT(&shard->free_ghosts);
+	for (q = 0; q < CACHE_QUEUE_COUNT; q++) {
+		TAILQ_INIT(&shard->queue[q]);
+	}
+
+	for (i = 0; i < num_lines; i++) {
+		shard->entries[i].data = data + i * table->line_size;
+		TAILQ_INSERT_TAIL(&shard->free_lines, &shard->entries[i], link);
+	}
+	for (; i < num_lines + shard->num_ghosts; i++) {
+		TAILQ_INSERT_TAIL(&shard->free_ghosts, &shard->entries[i], link);
+	}
+
+	if (pthread_spin_init(&shard->lock, PTHREAD_PROCESS_PRIVATE) != 0) {
+		goto err;
+	}
+
+	return 0;
+
+err:
+	free(shard->buckets);
+	free(shard->entries);
+	return -ENOMEM;
+}
+
+struct cache_table *
+cache_table_create(uint64_t num_lines, uint32_t line_size, uint32_t num_shards, int socket_id)
+{
+	struct cache_table *table;
+	uint64_t lines_per_shard;
+	uint32_t i;
+
+	if (num_shards == 0 || !spdk_u32_is_pow2(num_shards) || line_size == 0 ||
+	    num_lines < num_shards) {
+		return NULL;
+	}
+
+	table = calloc(1, sizeof(*table));
+	if (table == NULL) {
+		return NULL;
+	}
+
+	/* Every shard gets the same number of lines, the remainder is left unused */
+	lines_per_shard = num_lines / num_shards;
+	table->num_shards = num_shards;
+	table->line_size = line_size;
+	table->num_lines = lines_per_shard * num_shards;
+
+	table->shards = calloc(num_shards, sizeof(*table->shards));
+	table->data = spdk_zmalloc(table->num_lines * line_size, 0x1000, NULL, socket_id,
+				   SPDK_MALLOC_DMA);
+	if (table->shards == NULL || table->data == NULL) {
+		table->num_shards = 0;
+		cache_table_free(table);
+		return NULL;
+	}
+	table->memory_bytes = sizeof(*table) + num_shards * sizeof(*table->shards) +
+			      table->num_lines * line_size;
+
+	for (i = 0; i < num_shards; i++) {
+		if (cache_shard_init(&table->shards[i], table, lines_per_shard,
+				     (uint8_t *)table->data + i * lines_per_shard * line_size) != 0) {
+			/* Only shards initialized so far have a valid lock */
+			table->num_shards = i;
+			cache_table_free(table);
+			return NULL;
+		}
+	}
+
+	return table;
+}
+
+void
+cache_table_free(struct cache_table *table)
+{
+	uint32_t i;
+
+	if (table == NULL) {
+		return;
+	}
+
+	if (table->shards != NULL) {
+		for (i = 0; i < table->num_shards; i++) {
+			pthread_spin_destroy(&table->shards[i].lock);
+			free(table->shards[i].buckets);
+			free(table->shards[i].entries);
+		}
+	}
+	free(table->shards);
+	spdk_free(table->data);
+	free(table);
+}
+
+uint64_t
+cache_table_get_seq(struct cache_table *table, uint64_t tag)
+{
+	return __atomic_load_n(&cache_get_shard(table, tag)->write_seq, __ATOMIC_ACQUIRE);
+}
+
+void
+cache_table_bump_seq(struct cache_table *table, uint64_t tag)
+{
+	__atomic_fetch_add(&cache_get_shard(table, tag)->write_seq, 1, __ATOMIC_ACQ_REL);
+}
+
+bool
+cache_table_read(struct cache_table *table, uint64_t tag, uint32_t line_offset, size_t len,
+		 struct iovec *iovs, int iovcnt, size_t iov_offset)
+{
+	struct cache_shard *shard = cache_get_shard(table, tag);
+	struct cache_entry *entry;
+
+	assert(line_offset + len <= table->line_size);
+
+	pthread_spin_lock(&shard->lock);
+	entry = cache_shard_lookup(shard, tag);
+	if (entry == NULL || entry->queue == CACHE_QUEUE_GHOST) {
+		pthread_spin_unlock(&shard->lock);
+		return false;
+	}
+
+	cache_iov_copy(iovs, iovcnt, iov_offset, (uint8_t *)entry->data + line_offset, len, true);
+
+	/* A1in is a FIFO, hits there don't change anything.  Am is an LRU. */
+	if (entry->queue == CACHE_QUEUE_FREQUENT) {
+		TAILQ_REMOVE(&shard->queue[CACHE_QUEUE_FREQUENT], entry, link);
+		TAILQ_INSERT_TAIL(&shard->queue[CACHE_QUEUE_FREQUENT], entry, link);
+	}
+	pthread_spin_unlock(&shard->lock);
+
+	return true;
+}
+
+void
+cache_table_insert(struct cache_table *table, uint64_t tag, struct iovec *iovs, int iovcnt,
+		   size_t iov_offset)
+{
+	struct cache_shard *shard = cache_get_shard(table, tag);
+	struct cache_entry *entry;
+	enum cache_queue queue = CACHE_QUEUE_RECENT;
+
+	pthread_spin_lock(&shard->lock);
+	entry = cache_shard_lookup(shard, tag);
+	if (entry != NULL) {
+		if (entry->queue != CACHE_QUEUE_GHOST) {
+			cache_iov_copy(iovs, iovcnt, iov_offset, entry->data, table->line_size, false);
+			pthread_spin_unlock(&shard->lock);
+			return;
+		}
+
+		/* Seen again shortly after leaving A1in, this line is worth keeping */
+		cache_shard_dequeue(shard, entry);
+		cache_shard_hash_remove(shard, entry);
+		TAILQ_INSERT_TAIL(&shard->free_ghosts, entry, link);
+		shard->ghost_hits++;
+		queue = CACHE_QUEUE_FREQUENT;
+	}
+
+	entry = TAILQ_FIRST(&shard->free_lines);
+	if (entry != NULL) {
+		TAILQ_REMOVE(&shard->free_lines, entry, link);
+	} else {
+		entry = cache_shard_reclaim(shard);
+	}
+
+	entry->tag = tag;
+	cache_iov_copy(iovs, iovcnt, iov_offset, entry->data, table->line_size, false);
+	cache_shard_hash_insert(shard, entry);
+	cache_shard_enqueue(shard, entry, queue);
+	shard->insertions++;
+	pthread_spin_unlock(&shard->lock);
+}
+
+bool
+cache_table_update(struct cache_table *table, uint64_t tag, uint32_t line_offset, size_t len,
+		   struct iovec *iovs, int iovcnt, size_t iov_offset)
+{
+	struct cache_shard *shard = cache_get_shard(table, tag);
+	struct cache_entry *entry;
+	bool cached = false;
+
+	assert(line_offset + len <= table->line_size);
+
+	pthread_spin_lock(&shard->lock);
+	entry = cache_shard_lookup(shard, tag);
+	if (entry != NULL && entry->queue != CACHE_QUEUE_GHOST) {
+		cache_iov_copy(iovs, iovcnt, iov_offset, (uint8_t *)entry->data + line_offset, len, false);
+		cached = true;
+	}
+	pthread_spin_unlock(&shard->lock);
+
+	return cached;
+}
+
+void
+cache_table_invalidate(struct cache_table *table, uint64_t tag)
+{
+	struct cache_shard *shard = cache_get_shard(table, tag);
+	struct cache_entry *entry;
+
+	pthread_spin_lock(&shard->lock);
+	entry = cache_shard_lookup(shard, tag);
+	if (entry != NULL && entry->queue != CACHE_QUEUE_GHOST) {
+		cache_shard_dequeue(shard, entry);
+		cache_shard_hash_remove(shard, entry);
+		TAILQ_INSERT_TAIL(&shard->free_lines, entry, link);
+		shard->invalidations++;
+	}
+	pthread_spin_unlock(&shard->lock);
+}
+
+void
+cache_table_get_stats(struct cache_table *table, struct cache_table_stats *stats)
+{
+	struct cache_shard *shard;
+	uint32_t i;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->num_lines = table->num_lines;
+	stats->memory_bytes = table->memory_bytes;
+
+	for (i = 0; i < table->num_shards; i++) {
+		shard = &table->shards[i];
+
+		pthread_spin_lock(&shard->lock);
+		stats->lines_recent += shard->queue_len[CACHE_QUEUE_RECENT];
+		stats->lines_frequent += shard->queue_len[CACHE_QUEUE_FREQUENT];
+		stats->ghosts += shard->queue_len[CACHE_QUEUE_GHOST];
+		stats->insertions += shard->insertions;
+		stats->evictions += shard->evictions;
+		stats->invalidations += shard->invalidations;
+		stats->ghost_hits += shard->ghost_hits;
+		pthread_spin_unlock(&shard->lock);
+	}
+
+	stats->lines_used = stats->lines_recent + stats->lines_frequent;
+}
@@ -0,0 +1,145 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Sharded block cache used by the cache vbdev.
+ *
+ * The cache holds fixed size lines, each identified by a tag (the line index
+ * on the base bdev).  Lines are spread over a power of two number of shards,
+ * each protected by its own spinlock, so lookups issued from different
+ * threads only contend when they hash to the same shard.
+ *
+ * Every shard runs the 2Q replacement policy: lines read once enter a FIFO
+ * (A1in) and are evicted from there first, leaving only their tag behind in
+ * a ghost queue (A1out).  A line that misses again while its tag is still in
+ * A1out is promoted to an LRU queue (Am).  A large sequential scan therefore
+ * churns through A1in without displacing the working set held in Am.
+ */
+
+#ifndef SPDK_CACHE_TABLE_H
+#define SPDK_CACHE_TABLE_H
+
+#include "spdk/stdinc.h"
+
+struct cache_table;
+
+struct cache_table_stats {
+	/* Number of lines the cache can hold */
+	uint64_t num_lines;
+	/* Number of lines currently holding data */
+	uint64_t lines_used;
+	/* Lines in the A1in (seen once) queue */
+	uint64_t lines_recent;
+	/* Lines in the Am (seen more than once) queue */
+	uint64_t lines_frequent;
+	/* Tags remembered in the A1out ghost queue */
+	uint64_t ghosts;
+	uint64_t insertions;
+	uint64_t evictions;
+	uint64_t invalidations;
+	/* Insertions promoted straight to Am because of a ghost hit */
+	uint64_t ghost_hits;
+	/* Bytes of data and metadata allocated for the table */
+	uint64_t memory_bytes;
+};
+
+/**
+ * Allocate a cache table.
+ *
+ * Line data is allocated from DMA-able (hugepage backed) memory on the given
+ * socket.
+ *
+ * \param num_lines Total number of lines.  Must be at least num_shards.
+ * \param line_size Size of a single line in bytes.
+ * \param num_shards Number of shards.  Must be a power of two.
+ * \param socket_id NUMA socket to allocate line data on.
+ *
+ * \return the table on success, NULL on failure.
+ */
+struct cache_table *cache_table_create(uint64_t num_lines, uint32_t line_size,
+				       uint32_t num_shards, int socket_id);
+
+void cache_table_free(struct cache_table *table);
+
+/**
+ * Get the write sequence number of the shard holding a tag.
+ *
+ * The sequence is bumped by cache_table_bump_seq() every time a line of the
+ * shard is written or invalidated.  Readers sample it before fetching data
+ * from the base bdev and only insert the data if it did not move, so that a
+ * write racing with a read miss can never leave stale data in the cache.
+ */
+uint64_t cache_table_get_seq(struct cache_table *table, uint64_t tag);
+
+void cache_table_bump_seq(struct cache_table *table, uint64_t tag);
+
+/**
+ * Copy part of a cached line into an iovec.
+ *
+ * \param table Cache table.
+ * \param tag Line to read.
+ * \param line_offset Offset within the line, in bytes.
+ * \param len Number of bytes to copy.
+ * \param iovs Destination iovec.
+ * \param iovcnt Number of elements in iovs.
+ * \param iov_offset Offset into the iovec at which to start copying.
+ *
+ * \return true on a hit, false if the line is not cached.
+ */
+bool cache_table_read(struct cache_table *table, uint64_t tag, uint32_t line_offset,
+		      size_t len, struct iovec *iovs, int iovcnt, size_t iov_offset);
+
+/**
+ * Insert a full line, evicting another one if needed.  If the line is
+ * already cached its data is replaced.
+ */
+void cache_table_insert(struct cache_table *table, uint64_t tag, struct iovec *iovs,
+			int iovcnt, size_t iov_offset);
+
+/**
+ * Overwrite part of a line if it is cached.  Does not affect its position
+ * in the replacement queues.
+ *
+ * \return true if the line was cached and has been updated.
+ */
+bool cache_table_update(struct cache_table *table, uint64_t tag, uint32_t line_offset,
+			size_t len, struct iovec *iovs, int iovcnt, size_t iov_offset);
+
+/**
+ * Drop a line from the cache, if present.
+ */
+void cache_table_invalidate(struct cache_table *table, uint64_t tag);
+
+void cache_table_get_stats(struct cache_table *table, struct cache_table_stats *stats);
+
+#endif /* SPDK_CACHE_TABLE_H */
@@ -0,0 +1,891 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * DRAM read cache placed in front of another bdev.  Reads are served from
+ * a sharded in-memory block cache when every line they touch is present and
+ * forwarded to the base bdev otherwise.  Writes always go to the base bdev;
+ * depending on the mode they either update or invalidate the cached lines.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_cache.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+static int vbdev_cache_init(void);
+static int vbdev_cache_get_ctx_size(void);
+static void vbdev_cache_examine(struct spdk_bdev *bdev);
+static void vbdev_cache_finish(void);
+static int vbdev_cache_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module cache_if = {
+	.name = "cache",
+	.module_init = vbdev_cache_init,
+	.get_ctx_size = vbdev_cache_get_ctx_size,
+	.examine_config = vbdev_cache_examine,
+	.module_fini = vbdev_cache_finish,
+	.config_json = vbdev_cache_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(cache, &cache_if)
+
+/* Cache bdevs requested over RPC, kept so they can be created in examine()
+ * once their base bdev shows up.
+ */
+struct bdev_cache_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_cache_opts		opts;
+	TAILQ_ENTRY(bdev_cache_names)	link;
+};
+static TAILQ_HEAD(, bdev_cache_names) g_bdev_cache_names = TAILQ_HEAD_INITIALIZER(
+			g_bdev_cache_names);
+
+struct vbdev_cache {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		cache_bdev;
+	struct cache_table		*table;
+	struct vbdev_cache_opts		opts;
+	uint32_t			line_shift;
+	struct spdk_thread		*thread;
+	TAILQ_ENTRY(vbdev_cache)	link;
+};
+static TAILQ_HEAD(, vbdev_cache) g_cache_nodes = TAILQ_HEAD_INITIALIZER(g_cache_nodes);
+
+/* Counters are only touched by the channel's thread and collected with
+ * spdk_for_each_channel(), so the I/O path needs no atomics.
+ */
+struct cache_io_channel {
+	struct spdk_io_channel	*base_ch;
+	uint64_t		read_hits;
+	uint64_t		read_misses;
+};
+
+struct cache_bdev_io {
+	/* Sum of the write sequences of the lines a read miss covers */
+	uint64_t			seq;
+
+	struct spdk_io_channel		*ch;
+
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+/* Called for each line touched by an I/O.  Returning false stops the walk. */
+typedef bool (*cache_line_fn)(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io,
+			      uint64_t tag, uint32_t line_offset, uint32_t len, size_t iov_offset,
+			      void *ctx);
+
+static void vbdev_cache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+
+static const char *g_cache_mode_names[] = {
+	[VBDEV_CACHE_MODE_WRITE_THROUGH] = "write_through",
+	[VBDEV_CACHE_MODE_WRITE_INVALIDATE] = "write_invalidate",
+};
+
+const char *
+vbdev_cache_mode_to_str(enum vbdev_cache_mode mode)
+{
+	if (mode >= SPDK_COUNTOF(g_cache_mode_names)) {
+		return NULL;
+	}
+
+	return g_cache_mode_names[mode];
+}
+
+int
+vbdev_cache_mode_from_str(const char *str, enum vbdev_cache_mode *mode)
+{
+	size_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_cache_mode_names); i++) {
+		if (strcmp(str, g_cache_mode_names[i]) == 0) {
+			*mode = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static bool
+cache_foreach_line(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, cache_line_fn fn,
+		   void *ctx)
+{
+	uint64_t start = bdev_io->u.bdev.offset_blocks * cache->cache_bdev.blocklen;
+	uint64_t end = start + bdev_io->u.bdev.num_blocks * cache->cache_bdev.blocklen;
+	uint64_t pos;
+	uint32_t line_offset, len;
+
+	for (pos = start; pos < end; pos += len) {
+		line_offset = pos & (cache->opts.line_size - 1);
+		len = spdk_min(cache->opts.line_size - line_offset, end - pos);
+		if (!fn(cache, bdev_io, pos >> cache->line_shift, line_offset, len, pos - start, ctx)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+cache_line_read(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	return cache_table_read(cache->table, tag, line_offset, len, bdev_io->u.bdev.iovs,
+				bdev_io->u.bdev.iovcnt, iov_offset);
+}
+
+static bool
+cache_line_insert(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		  uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	/* Partially read lines can't be cached, the rest of their data is unknown */
+	if (len == cache->opts.line_size) {
+		cache_table_insert(cache->table, tag, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+				   iov_offset);
+	}
+
+	return true;
+}
+
+static bool
+cache_line_update(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		  uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	cache_table_update(cache->table, tag, line_offset, len, bdev_io->u.bdev.iovs,
+			   bdev_io->u.bdev.iovcnt, iov_offset);
+	cache_table_bump_seq(cache->table, tag);
+
+	return true;
+}
+
+static bool
+cache_line_invalidate(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		      uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	cache_table_invalidate(cache->table, tag);
+	cache_table_bump_seq(cache->table, tag);
+
+	return true;
+}
+
+static bool
+cache_line_bump_seq(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		    uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	cache_table_bump_seq(cache->table, tag);
+
+	return true;
+}
+
+static bool
+cache_line_sum_seq(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io, uint64_t tag,
+		   uint32_t line_offset, uint32_t len, size_t iov_offset, void *ctx)
+{
+	uint64_t *seq = ctx;
+
+	*seq += cache_table_get_seq(cache->table, tag);
+
+	return true;
+}
+
+static uint64_t
+cache_io_seq(struct vbdev_cache *cache, struct spdk_bdev_io *bdev_io)
+{
+	uint64_t seq = 0;
+
+	cache_foreach_line(cache, bdev_io, cache_line_sum_seq, &seq);
+
+	return seq;
+}
+
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_cache *cache = io_device;
+
+	cache_table_free(cache->table);
+	free(cache->cache_bdev.name);
+	free(cache);
+}
+
+static void
+_vbdev_cache_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+static int
+vbdev_cache_destruct(void *ctx)
+{
+	struct vbdev_cache *cache = ctx;
+
+	TAILQ_REMOVE(&g_cache_nodes, cache, link);
+
+	spdk_bdev_module_release_bdev(cache->base_bdev);
+
+	/* Close the underlying bdev on its same opened thread. */
+	if (cache->thread && cache->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(cache->thread, _vbdev_cache_destruct, cache->base_desc);
+	} else {
+		spdk_bdev_close(cache->base_desc);
+	}
+
+	spdk_io_device_unregister(cache, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+_cache_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+_cache_complete_read(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_cache, cache_bdev);
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)orig_io->driver_ctx;
+
+	/* A write to any of these lines since the read was submitted means the
+	 * data we got back may already be stale, so leave it out of the cache.
+	 */
+	if (success && cache_io_seq(cache, orig_io) == io_ctx->seq) {
+		cache_foreach_line(cache, orig_io, cache_line_insert, NULL);
+	}
+
+	_cache_complete_io(bdev_io, success, orig_io);
+}
+
+static void
+_cache_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_cache, cache_bdev);
+
+	if (success && orig_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
+	    cache->opts.mode == VBDEV_CACHE_MODE_WRITE_THROUGH) {
+		cache_foreach_line(cache, orig_io, cache_line_update, NULL);
+	} else {
+		/* Also drops anything a read racing with this I/O managed to insert */
+		cache_foreach_line(cache, orig_io, cache_line_invalidate, NULL);
+	}
+
+	_cache_complete_io(bdev_io, success, orig_io);
+}
+
+static void
+vbdev_cache_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_cache_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_cache_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_cache_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, cache_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_cache_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+cache_handle_submit_rc(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, int rc)
+{
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+
+	if (rc == 0) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io_ctx->ch = ch;
+		vbdev_cache_queue_io(bdev_io);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+cache_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache, cache_bdev);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+	int rc;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (cache_foreach_line(cache, bdev_io, cache_line_read, NULL)) {
+		cache_ch->read_hits++;
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	cache_ch->read_misses++;
+	io_ctx->seq = cache_io_seq(cache, bdev_io);
+	rc = spdk_bdev_readv_blocks(cache->base_desc, cache_ch->base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, _cache_complete_read, bdev_io);
+	cache_handle_submit_rc(ch, bdev_io, rc);
+}
+
+static void
+vbdev_cache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_cache *cache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache, cache_bdev);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, cache_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (cache->opts.mode == VBDEV_CACHE_MODE_WRITE_THROUGH) {
+			cache_foreach_line(cache, bdev_io, cache_line_bump_seq, NULL);
+		} else {
+			cache_foreach_line(cache, bdev_io, cache_line_invalidate, NULL);
+		}
+		rc = spdk_bdev_writev_blocks(cache->base_desc, cache_ch->base_ch, bdev_io->u.bdev.iovs,
+					     bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					     bdev_io->u.bdev.num_blocks, _cache_complete_write,
+					     bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		cache_foreach_line(cache, bdev_io, cache_line_invalidate, NULL);
+		rc = spdk_bdev_write_zeroes_blocks(cache->base_desc, cache_ch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _cache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		cache_foreach_line(cache, bdev_io, cache_line_invalidate, NULL);
+		rc = spdk_bdev_unmap_blocks(cache->base_desc, cache_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _cache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(cache->base_desc, cache_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _cache_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(cache->base_desc, cache_ch->base_ch,
+				     _cache_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("cache: unsupported I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	cache_handle_submit_rc(ch, bdev_io, rc);
+}
+
+static bool
+vbdev_cache_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_cache *cache = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(cache->base_bdev, io_type);
+	default:
+		/* Anything else could modify data behind the cache's back */
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_cache_get_io_channel(void *ctx)
+{
+	struct vbdev_cache *cache = ctx;
+
+	return spdk_get_io_channel(cache);
+}
+
+static void
+vbdev_cache_write_opts_json(struct vbdev_cache *cache, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&cache->cache_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(cache->base_bdev));
+	spdk_json_write_named_uint64(w, "cache_size_mb", cache->opts.cache_size_mb);
+	spdk_json_write_named_uint32(w, "line_size", cache->opts.line_size);
+	spdk_json_write_named_uint32(w, "num_shards", cache->opts.num_shards);
+	spdk_json_write_named_string(w, "mode", vbdev_cache_mode_to_str(cache->opts.mode));
+}
+
+static int
+vbdev_cache_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache = ctx;
+
+	spdk_json_write_named_object_begin(w, "cache");
+	vbdev_cache_write_opts_json(cache, w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_cache_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache;
+
+	TAILQ_FOREACH(cache, &g_cache_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_cache_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_cache_write_opts_json(cache, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+cache_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct cache_io_channel *cache_ch = ctx_buf;
+	struct vbdev_cache *cache = io_device;
+
+	cache_ch->base_ch = spdk_bdev_get_io_channel(cache->base_desc);
+	if (cache_ch->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+cache_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct cache_io_channel *cache_ch = ctx_buf;
+
+	spdk_put_io_channel(cache_ch->base_ch);
+}
+
+static void
+vbdev_cache_free_name(struct bdev_cache_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_cache_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_cache_insert_name(const char *bdev_name, const char *vbdev_name,
+			const struct vbdev_cache_opts *opts, struct bdev_cache_names **_name)
+{
+	struct bdev_cache_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_cache_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("cache bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_cache_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_cache_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->bdev_name || !name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate bdev names\n");
+		free(name->bdev_name);
+		free(name->vbdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+	name->opts = *opts;
+
+	TAILQ_INSERT_TAIL(&g_bdev_cache_names, name, link);
+	*_name = name;
+
+	return 0;
+}
+
+static int
+vbdev_cache_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_cache_finish(void)
+{
+	struct bdev_cache_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_cache_names))) {
+		vbdev_cache_free_name(name);
+	}
+}
+
+static int
+vbdev_cache_get_ctx_size(void)
+{
+	return sizeof(struct cache_bdev_io);
+}
+
+static const struct spdk_bdev_fn_table vbdev_cache_fn_table = {
+	.destruct		= vbdev_cache_destruct,
+	.submit_request		= vbdev_cache_submit_request,
+	.io_type_supported	= vbdev_cache_io_type_supported,
+	.get_io_channel		= vbdev_cache_get_io_channel,
+	.dump_info_json		= vbdev_cache_dump_info_json,
+};
+
+static void
+vbdev_cache_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_cache *cache, *tmp;
+
+	TAILQ_FOREACH_SAFE(cache, &g_cache_nodes, link, tmp) {
+		if (bdev_find == cache->base_bdev) {
+			spdk_bdev_unregister(&cache->cache_bdev, NULL, NULL);
+		}
+	}
+}
+
+static void
+vbdev_cache_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			       void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_cache_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+vbdev_cache_validate_base(struct bdev_cache_names *name, struct spdk_bdev *bdev)
+{
+	if (bdev->md_len != 0) {
+		SPDK_ERRLOG("cache bdev %s: base bdev %s has metadata, which is not supported\n",
+			    name->vbdev_name, name->bdev_name);
+		return -ENOTSUP;
+	}
+
+	if (name->opts.line_size % bdev->blocklen != 0) {
+		SPDK_ERRLOG("cache bdev %s: line size %" PRIu32 " is not a multiple of block size %"
+			    PRIu32 "\n", name->vbdev_name, name->opts.line_size, bdev->blocklen);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int
+vbdev_cache_register(struct bdev_cache_names *name)
+{
+	struct vbdev_cache *cache;
+	struct spdk_bdev *bdev;
+	uint64_t num_lines;
+	int rc;
+
+	cache = calloc(1, sizeof(struct vbdev_cache));
+	if (!cache) {
+		SPDK_ERRLOG("could not allocate cache node\n");
+		return -ENOMEM;
+	}
+
+	cache->cache_bdev.name = strdup(name->vbdev_name);
+	if (!cache->cache_bdev.name) {
+		SPDK_ERRLOG("could not allocate cache bdev name\n");
+		free(cache);
+		return -ENOMEM;
+	}
+	cache->cache_bdev.product_name = "cache";
+	cache->opts = name->opts;
+	cache->line_shift = spdk_u32log2(cache->opts.line_size);
+
+	rc = spdk_bdev_open_ext(name->bdev_name, true, vbdev_cache_base_bdev_event_cb,
+				NULL, &cache->base_desc);
+	if (rc) {
+		if (rc != -ENODEV) {
+			SPDK_ERRLOG("could not open bdev %s\n", name->bdev_name);
+		}
+		goto err_name;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(cache->base_desc);
+	cache->base_bdev = bdev;
+
+	rc = vbdev_cache_validate_base(name, bdev);
+	if (rc) {
+		goto err_close;
+	}
+
+	num_lines = cache->opts.cache_size_mb * 1024 * 1024 / cache->opts.line_size;
+	cache->table = cache_table_create(num_lines, cache->opts.line_size, cache->opts.num_shards,
+					  SPDK_ENV_SOCKET_ID_ANY);
+	if (!cache->table) {
+		SPDK_ERRLOG("could not allocate %" PRIu64 " MiB cache for %s\n",
+			    cache->opts.cache_size_mb, name->vbdev_name);
+		rc = -ENOMEM;
+		goto err_close;
+	}
+
+	cache->cache_bdev.write_cache = bdev->write_cache;
+	cache->cache_bdev.required_alignment = bdev->required_alignment;
+	cache->cache_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+	cache->cache_bdev.blocklen = bdev->blocklen;
+	cache->cache_bdev.blockcnt = bdev->blockcnt;
+
+	cache->cache_bdev.ctxt = cache;
+	cache->cache_bdev.fn_table = &vbdev_cache_fn_table;
+	cache->cache_bdev.module = &cache_if;
+
+	cache->thread = spdk_get_thread();
+
+	rc = spdk_bdev_module_claim_bdev(bdev, cache->base_desc, cache->cache_bdev.module);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name->bdev_name);
+		goto err_table;
+	}
+
+	TAILQ_INSERT_TAIL(&g_cache_nodes, cache, link);
+	spdk_io_device_register(cache, cache_bdev_ch_create_cb, cache_bdev_ch_destroy_cb,
+				sizeof(struct cache_io_channel), name->vbdev_name);
+
+	rc = spdk_bdev_register(&cache->cache_bdev);
+	if (rc) {
+		SPDK_ERRLOG("could not register cache bdev %s\n", name->vbdev_name);
+		TAILQ_REMOVE(&g_cache_nodes, cache, link);
+		spdk_io_device_unregister(cache, NULL);
+		spdk_bdev_module_release_bdev(bdev);
+		goto err_table;
+	}
+
+	SPDK_NOTICELOG("created cache bdev %s on %s\n", name->vbdev_name, name->bdev_name);
+
+	return 0;
+
+err_table:
+	cache_table_free(cache->table);
+err_close:
+	spdk_bdev_close(cache->base_desc);
+err_name:
+	free(cache->cache_bdev.name);
+	free(cache);
+	return rc;
+}
+
+int
+bdev_cache_create_disk(const char *bdev_name, const char *vbdev_name,
+		       const struct vbdev_cache_opts *opts)
+{
+	struct bdev_cache_names *name;
+	int rc;
+
+	if (opts->line_size < 512 || !spdk_u32_is_pow2(opts->line_size)) {
+		SPDK_ERRLOG("cache line size must be a power of two of at least 512 bytes\n");
+		return -EINVAL;
+	}
+
+	if (opts->num_shards == 0 || !spdk_u32_is_pow2(opts->num_shards)) {
+		SPDK_ERRLOG("number of cache shards must be a power of two\n");
+		return -EINVAL;
+	}
+
+	if (opts->cache_size_mb * 1024 * 1024 / opts->line_size < opts->num_shards) {
+		SPDK_ERRLOG("cache is too small to hold a line in each shard\n");
+		return -EINVAL;
+	}
+
+	if (vbdev_cache_mode_to_str(opts->mode) == NULL) {
+		SPDK_ERRLOG("invalid cache mode %d\n", opts->mode);
+		return -EINVAL;
+	}
+
+	rc = vbdev_cache_insert_name(bdev_name, vbdev_name, opts, &name);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_cache_register(name);
+	if (rc == -ENODEV) {
+		/* This is not an error, we tracked the name above and it still
+		 * may show up later.
+		 */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc) {
+		vbdev_cache_free_name(name);
+	}
+
+	return rc;
+}
+
+void
+bdev_cache_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_cache_names *name;
+
+	if (!bdev || bdev->module != &cache_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	/* Remove the association (vbdev, bdev) so that the vbdev does not get
+	 * re-created if the same bdev is constructed at some other time.
+	 */
+	TAILQ_FOREACH(name, &g_bdev_cache_names, link) {
+		if (strcmp(name->vbdev_name, bdev->name) == 0) {
+			vbdev_cache_free_name(name);
+			break;
+		}
+	}
+
+	spdk_bdev_unregister(bdev, cb_fn, cb_arg);
+}
+
+struct cache_get_stats_ctx {
+	struct vbdev_cache		*cache;
+	struct vbdev_cache_stats	stats;
+	vbdev_cache_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+cache_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct cache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+
+	ctx->stats.read_hits += cache_ch->read_hits;
+	ctx->stats.read_misses += cache_ch->read_misses;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+cache_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct cache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	cache_table_get_stats(ctx->cache->table, &ctx->stats.table);
+	ctx->cb_fn(ctx->cb_arg, status, &ctx->stats);
+	free(ctx);
+}
+
+void
+bdev_cache_get_stats(struct spdk_bdev *bdev, vbdev_cache_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct cache_get_stats_ctx *ctx;
+
+	if (!bdev || bdev->module != &cache_if) {
+		cb_fn(cb_arg, -ENODEV, NULL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->cache = bdev->ctxt;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(ctx->cache, cache_get_stats_channel, ctx, cache_get_stats_done);
+}
+
+static void
+vbdev_cache_examine(struct spdk_bdev *bdev)
+{
+	struct bdev_cache_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_cache_names, link) {
+		if (strcmp(name->bdev_name, bdev->name) == 0) {
+			vbdev_cache_register(name);
+		}
+	}
+
+	spdk_bdev_module_examine_done(&cache_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_cache)
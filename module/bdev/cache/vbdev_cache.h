@@ -0,0 +1,107 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPDK_VBDEV_CACHE_H
+#define SPDK_VBDEV_CACHE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+#include "cache_table.h"
+
+#define VBDEV_CACHE_DEFAULT_LINE_SIZE	4096
+#define VBDEV_CACHE_DEFAULT_NUM_SHARDS	16
+
+enum vbdev_cache_mode {
+	/* Writes update lines already in the cache */
+	VBDEV_CACHE_MODE_WRITE_THROUGH,
+	/* Writes drop the lines they touch from the cache */
+	VBDEV_CACHE_MODE_WRITE_INVALIDATE,
+};
+
+struct vbdev_cache_opts {
+	/* Size of the DRAM cache in MiB */
+	uint64_t		cache_size_mb;
+	/* Cache line size in bytes, a power of two and a multiple of the block size */
+	uint32_t		line_size;
+	/* Number of independently locked shards, a power of two */
+	uint32_t		num_shards;
+	enum vbdev_cache_mode	mode;
+};
+
+struct vbdev_cache_stats {
+	uint64_t			read_hits;
+	uint64_t			read_misses;
+	struct cache_table_stats	table;
+};
+
+typedef void (*vbdev_cache_get_stats_cb)(void *cb_arg, int rc,
+		const struct vbdev_cache_stats *stats);
+
+const char *vbdev_cache_mode_to_str(enum vbdev_cache_mode mode);
+int vbdev_cache_mode_from_str(const char *str, enum vbdev_cache_mode *mode);
+
+/**
+ * Create new cache bdev.
+ *
+ * \param bdev_name Bdev on which cache vbdev will be created.
+ * \param vbdev_name Name of the cache bdev.
+ * \param opts Cache options.
+ * \return 0 on success, other on failure.
+ */
+int bdev_cache_create_disk(const char *bdev_name, const char *vbdev_name,
+			   const struct vbdev_cache_opts *opts);
+
+/**
+ * Delete cache bdev.
+ *
+ * \param bdev Pointer to cache bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_cache_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+			    void *cb_arg);
+
+/**
+ * Collect hit/miss counters from all channels of a cache bdev along with the
+ * state of its cache table.
+ *
+ * \param bdev Pointer to cache bdev.
+ * \param cb_fn Function to call with the statistics.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_cache_get_stats(struct spdk_bdev *bdev, vbdev_cache_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_CACHE_H */
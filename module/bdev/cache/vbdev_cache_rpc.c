@@ -0,0 +1,245 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "vbdev_cache.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_bdev_cache_create {
+	char *base_bdev_name;
+	char *name;
+	struct vbdev_cache_opts opts;
+};
+
+static void
+free_rpc_bdev_cache_create(struct rpc_bdev_cache_create *r)
+{
+	free(r->base_bdev_name);
+	free(r->name);
+}
+
+static int
+decode_cache_mode(const struct spdk_json_val *val, void *out)
+{
+	enum vbdev_cache_mode *mode = out;
+	char *str = NULL;
+	int rc;
+
+	rc = spdk_json_decode_string(val, &str);
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = vbdev_cache_mode_from_str(str, mode);
+	free(str);
+
+	return rc;
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_cache_create_decoders[] = {
+	{"base_bdev_name", offsetof(struct rpc_bdev_cache_create, base_bdev_name), spdk_json_decode_string},
+	{"name", offsetof(struct rpc_bdev_cache_create, name), spdk_json_decode_string},
+	{"cache_size_mb", offsetof(struct rpc_bdev_cache_create, opts.cache_size_mb), spdk_json_decode_uint64},
+	{"line_size", offsetof(struct rpc_bdev_cache_create, opts.line_size), spdk_json_decode_uint32, true},
+	{"num_shards", offsetof(struct rpc_bdev_cache_create, opts.num_shards), spdk_json_decode_uint32, true},
+	{"mode", offsetof(struct rpc_bdev_cache_create, opts.mode), decode_cache_mode, true},
+};
+
+static void
+rpc_bdev_cache_create(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_cache_create req = {
+		.opts = {
+			.line_size = VBDEV_CACHE_DEFAULT_LINE_SIZE,
+			.num_shards = VBDEV_CACHE_DEFAULT_NUM_SHARDS,
+			.mode = VBDEV_CACHE_MODE_WRITE_THROUGH,
+		},
+	};
+	struct spdk_json_write_ctx *w;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_cache_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_cache_create_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(vbdev_cache, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_cache_create_disk(req.base_bdev_name, req.name, &req.opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_string(w, req.name);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_cache_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_cache_create", rpc_bdev_cache_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_cache_name {
+	char *name;
+};
+
+static void
+free_rpc_bdev_cache_name(struct rpc_bdev_cache_name *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_cache_name_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_cache_name, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_cache_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	spdk_jsonrpc_send_bool_response(request, bdeverrno == 0);
+}
+
+static void
+rpc_bdev_cache_delete(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_cache_name req = {NULL};
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_cache_name_decoders,
+				    SPDK_COUNTOF(rpc_bdev_cache_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	bdev_cache_delete_disk(bdev, rpc_bdev_cache_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_cache_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_cache_delete", rpc_bdev_cache_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_cache_get_stats_ctx {
+	struct spdk_jsonrpc_request	*request;
+	struct spdk_bdev		*bdev;
+};
+
+static void
+rpc_bdev_cache_get_stats_cb(void *cb_arg, int rc, const struct vbdev_cache_stats *stats)
+{
+	struct rpc_bdev_cache_get_stats_ctx *ctx = cb_arg;
+	struct spdk_json_write_ctx *w;
+	uint64_t reads;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+		free(ctx);
+		return;
+	}
+
+	reads = stats->read_hits + stats->read_misses;
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(ctx->bdev));
+	spdk_json_write_named_uint64(w, "read_hits", stats->read_hits);
+	spdk_json_write_named_uint64(w, "read_misses", stats->read_misses);
+	spdk_json_write_named_uint64(w, "hit_ratio_percent",
+				     reads ? stats->read_hits * 100 / reads : 0);
+	spdk_json_write_named_uint64(w, "insertions", stats->table.insertions);
+	spdk_json_write_named_uint64(w, "evictions", stats->table.evictions);
+	spdk_json_write_named_uint64(w, "invalidations", stats->table.invalidations);
+	spdk_json_write_named_uint64(w, "ghost_hits", stats->table.ghost_hits);
+	spdk_json_write_named_uint64(w, "num_lines", stats->table.num_lines);
+	spdk_json_write_named_uint64(w, "lines_used", stats->table.lines_used);
+	spdk_json_write_named_uint64(w, "lines_recent", stats->table.lines_recent);
+	spdk_json_write_named_uint64(w, "lines_frequent", stats->table.lines_frequent);
+	spdk_json_write_named_uint64(w, "memory_bytes", stats->table.memory_bytes);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+	free(ctx);
+}
+
+static void
+rpc_bdev_cache_get_stats(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_cache_name req = {NULL};
+	struct rpc_bdev_cache_get_stats_ctx *ctx;
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_cache_name_decoders,
+				    SPDK_COUNTOF(rpc_bdev_cache_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+	ctx->request = request;
+	ctx->bdev = bdev;
+
+	bdev_cache_get_stats(bdev, rpc_bdev_cache_get_stats_cb, ctx);
+
+cleanup:
+	free_rpc_bdev_cache_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_cache_get_stats", rpc_bdev_cache_get_stats, SPDK_RPC_RUNTIME)
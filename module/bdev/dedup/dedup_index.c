@@ -0,0 +1,389 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dedup_index.h"
+
+#include "spdk/endian.h"
+#include "spdk/util.h"
+
+struct dedup_chunk {
+	uint8_t			fp[DEDUP_FP_LEN];
+	uint32_t		refcnt;
+	/* Next chunk in the same hash bucket, or in the free list */
+	uint32_t		next;
+	/* The data of the chunk has been written */
+	bool			written;
+	/* The chunk is linked in its hash bucket */
+	bool			indexed;
+};
+
+struct dedup_index {
+	pthread_spinlock_t	lock;
+	uint64_t		num_logical;
+	uint64_t		num_physical;
+	/* Chunk number plus one of each logical block, 0 if unmapped */
+	uint32_t		*map;
+	struct dedup_chunk	*chunks;
+	uint32_t		*buckets;
+	uint32_t		bucket_shift;
+	uint32_t		free_head;
+	uint64_t		mapped_chunks;
+	uint64_t		used_chunks;
+	uint64_t		indexed_chunks;
+	uint64_t		memory_bytes;
+};
+
+static inline uint32_t *
+dedup_bucket(struct dedup_index *index, const uint8_t *fp)
+{
+	uint64_t key;
+
+	/* Fingerprints are uniformly distributed, but CRC-32C ones only fill the first bytes */
+	memcpy(&key, fp, sizeof(key));
+
+	return &index->buckets[(key * 0x9E3779B97F4A7C15ULL) >> index->bucket_shift];
+}
+
+static uint32_t
+dedup_hash_find(struct dedup_index *index, const uint8_t *fp)
+{
+	uint32_t chunk;
+
+	for (chunk = *dedup_bucket(index, fp); chunk != DEDUP_INVALID_CHUNK;
+	     chunk = index->chunks[chunk].next) {
+		if (memcmp(index->chunks[chunk].fp, fp, DEDUP_FP_LEN) == 0) {
+			return chunk;
+		}
+	}
+
+	return DEDUP_INVALID_CHUNK;
+}
+
+static void
+dedup_hash_remove(struct dedup_index *index, uint32_t chunk)
+{
+	uint32_t *prev = dedup_bucket(index, index->chunks[chunk].fp);
+
+	while (*prev != chunk) {
+		assert(*prev != DEDUP_INVALID_CHUNK);
+		prev = &index->chunks[*prev].next;
+	}
+	*prev = index->chunks[chunk].next;
+	index->chunks[chunk].indexed = false;
+	index->indexed_chunks--;
+}
+
+static void
+dedup_chunk_release(struct dedup_index *index, uint32_t chunk)
+{
+	struct dedup_chunk *c = &index->chunks[chunk];
+
+	assert(c->refcnt > 0);
+	if (--c->refcnt != 0) {
+		return;
+	}
+
+	if (c->indexed) {
+		dedup_hash_remove(index, chunk);
+	}
+	c->written = false;
+	c->next = index->free_head;
+	index->free_head = chunk;
+	index->used_chunks--;
+}
+
+static void
+dedup_build_free_list(struct dedup_index *index)
+{
+	uint64_t i;
+
+	/* Push in reverse so that chunks are handed out in ascending order */
+	index->free_head = DEDUP_INVALID_CHUNK;
+	index->used_chunks = 0;
+	for (i = index->num_physical; i > 0; i--) {
+		if (index->chunks[i - 1].refcnt == 0) {
+			index->chunks[i - 1].next = index->free_head;
+			index->free_head = i - 1;
+		} else {
+			index->used_chunks++;
+		}
+	}
+}
+
+struct dedup_index *
+dedup_index_create(uint64_t num_logical, uint64_t num_physical)
+{
+	struct dedup_index *index;
+	uint64_t num_buckets, i;
+	uint32_t bits;
+
+	if (num_logical == 0 || num_physical == 0 || num_physical > DEDUP_MAX_CHUNKS) {
+		return NULL;
+	}
+
+	index = calloc(1, sizeof(*index));
+	if (index == NULL) {
+		return NULL;
+	}
+
+	/* About one bucket per chunk, so chains stay a couple of entries long */
+	bits = spdk_max(spdk_u64log2(num_physical), 1);
+	num_buckets = 1ULL << bits;
+	index->bucket_shift = 64 - bits;
+	index->num_logical = num_logical;
+	index->num_physical = num_physical;
+
+	index->map = calloc(num_logical, sizeof(*index->map));
+	index->chunks = calloc(num_physical, sizeof(*index->chunks));
+	index->buckets = malloc(num_buckets * sizeof(*index->buckets));
+	if (index->map == NULL || index->chunks == NULL || index->buckets == NULL ||
+	    pthread_spin_init(&index->lock, PTHREAD_PROCESS_PRIVATE) != 0) {
+		free(index->map);
+		free(index->chunks);
+		free(index->buckets);
+		free(index);
+		return NULL;
+	}
+
+	for (i = 0; i < num_buckets; i++) {
+		index->buckets[i] = DEDUP_INVALID_CHUNK;
+	}
+	dedup_build_free_list(index);
+
+	index->memory_bytes = sizeof(*index) + num_logical * sizeof(*index->map) +
+			      num_physical * sizeof(*index->chunks) +
+			      num_buckets * sizeof(*index->buckets);
+
+	return index;
+}
+
+void
+dedup_index_free(struct dedup_index *index)
+{
+	if (index == NULL) {
+		return;
+	}
+
+	pthread_spin_destroy(&index->lock);
+	free(index->map);
+	free(index->chunks);
+	free(index->buckets);
+	free(index);
+}
+
+uint32_t
+dedup_index_lookup(struct dedup_index *index, const uint8_t *fp)
+{
+	uint32_t chunk;
+
+	pthread_spin_lock(&index->lock);
+	chunk = dedup_hash_find(index, fp);
+	if (chunk != DEDUP_INVALID_CHUNK) {
+		index->chunks[chunk].refcnt++;
+	}
+	pthread_spin_unlock(&index->lock);
+
+	return chunk;
+}
+
+uint32_t
+dedup_index_alloc(struct dedup_index *index)
+{
+	uint32_t chunk;
+
+	pthread_spin_lock(&index->lock);
+	chunk = index->free_head;
+	if (chunk != DEDUP_INVALID_CHUNK) {
+		index->free_head = index->chunks[chunk].next;
+		index->chunks[chunk].refcnt = 1;
+		index->used_chunks++;
+	}
+	pthread_spin_unlock(&index->lock);
+
+	return chunk;
+}
+
+void
+dedup_index_insert(struct dedup_index *index, uint32_t chunk, const uint8_t *fp)
+{
+	struct dedup_chunk *c = &index->chunks[chunk];
+	uint32_t *bucket;
+
+	pthread_spin_lock(&index->lock);
+	assert(c->refcnt > 0 && !c->indexed);
+	c->written = true;
+	if (dedup_hash_find(index, fp) == DEDUP_INVALID_CHUNK) {
+		memcpy(c->fp, fp, DEDUP_FP_LEN);
+		bucket = dedup_bucket(index, fp);
+		c->next = *bucket;
+		*bucket = chunk;
+		c->indexed = true;
+		index->indexed_chunks++;
+	}
+	pthread_spin_unlock(&index->lock);
+}
+
+bool
+dedup_index_get_unindexed(struct dedup_index *index, uint32_t chunk)
+{
+	struct dedup_chunk *c = &index->chunks[chunk];
+	bool got = false;
+
+	pthread_spin_lock(&index->lock);
+	if (c->refcnt > 0 && c->written && !c->indexed) {
+		c->refcnt++;
+		got = true;
+	}
+	pthread_spin_unlock(&index->lock);
+
+	return got;
+}
+
+void
+dedup_index_put(struct dedup_index *index, const uint32_t *chunks, uint32_t count)
+{
+	uint32_t i;
+
+	pthread_spin_lock(&index->lock);
+	for (i = 0; i < count; i++) {
+		if (chunks[i] != DEDUP_INVALID_CHUNK) {
+			dedup_chunk_release(index, chunks[i]);
+		}
+	}
+	pthread_spin_unlock(&index->lock);
+}
+
+void
+dedup_index_map_get(struct dedup_index *index, uint64_t lba, uint32_t count, uint32_t *chunks)
+{
+	uint32_t i, entry;
+
+	assert(lba + count <= index->num_logical);
+
+	pthread_spin_lock(&index->lock);
+	for (i = 0; i < count; i++) {
+		entry = index->map[lba + i];
+		if (entry != 0) {
+			index->chunks[entry - 1].refcnt++;
+		}
+		chunks[i] = entry - 1;
+	}
+	pthread_spin_unlock(&index->lock);
+}
+
+void
+dedup_index_map_set(struct dedup_index *index, uint64_t lba, uint32_t count,
+		    const uint32_t *chunks, uint32_t *old_chunks)
+{
+	uint32_t i, entry;
+
+	assert(lba + count <= index->num_logical);
+
+	pthread_spin_lock(&index->lock);
+	for (i = 0; i < count; i++) {
+		entry = index->map[lba + i];
+		old_chunks[i] = entry - 1;
+		index->mapped_chunks -= entry != 0;
+
+		/* DEDUP_INVALID_CHUNK + 1 wraps around to 0, i.e. unmapped */
+		index->map[lba + i] = chunks[i] + 1;
+		index->mapped_chunks += chunks[i] != DEDUP_INVALID_CHUNK;
+	}
+	pthread_spin_unlock(&index->lock);
+}
+
+void
+dedup_index_map_copy(struct dedup_index *index, uint64_t lba, uint64_t count, uint32_t *entries)
+{
+	uint64_t i;
+
+	assert(lba + count <= index->num_logical);
+
+	pthread_spin_lock(&index->lock);
+	for (i = 0; i < count; i++) {
+		to_le32(&entries[i], index->map[lba + i]);
+	}
+	pthread_spin_unlock(&index->lock);
+}
+
+int
+dedup_index_map_restore(struct dedup_index *index, uint64_t lba, uint64_t count,
+			const uint32_t *entries)
+{
+	struct dedup_chunk *c;
+	uint32_t entry;
+	uint64_t i;
+
+	assert(lba + count <= index->num_logical);
+
+	for (i = 0; i < count; i++) {
+		entry = from_le32(&entries[i]);
+		if (entry > index->num_physical) {
+			return -EINVAL;
+		}
+
+		if (index->map[lba + i] != 0) {
+			index->chunks[index->map[lba + i] - 1].refcnt--;
+			index->mapped_chunks--;
+		}
+
+		index->map[lba + i] = entry;
+		if (entry != 0) {
+			c = &index->chunks[entry - 1];
+			c->refcnt++;
+			c->written = true;
+			index->mapped_chunks++;
+		}
+	}
+
+	return 0;
+}
+
+void
+dedup_index_restore_done(struct dedup_index *index)
+{
+	dedup_build_free_list(index);
+}
+
+void
+dedup_index_get_stats(struct dedup_index *index, struct dedup_index_stats *stats)
+{
+	pthread_spin_lock(&index->lock);
+	stats->num_logical_chunks = index->num_logical;
+	stats->num_physical_chunks = index->num_physical;
+	stats->mapped_chunks = index->mapped_chunks;
+	stats->used_chunks = index->used_chunks;
+	stats->indexed_chunks = index->indexed_chunks;
+	stats->memory_bytes = index->memory_bytes;
+	pthread_spin_unlock(&index->lock);
+}
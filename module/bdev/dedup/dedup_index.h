@@ -0,0 +1,168 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Metadata of the dedup vbdev.
+ *
+ * Logical blocks of a dedup bdev are mapped to physical chunks of its backing
+ * bdev through the logical-to-physical (L2P) map.  Physical chunks are
+ * reference counted, so data written to several logical blocks is stored only
+ * once.  The fingerprint index finds the chunk already holding some data.  It
+ * is a hash table chained through the per-chunk entries, so neither lookups
+ * nor insertions allocate memory.
+ *
+ * A chunk is never overwritten while it is referenced: new data always goes to
+ * a newly allocated chunk and the old one is released once the map no longer
+ * points to it.  This keeps the data of every indexed chunk stable.
+ *
+ * Everything is protected by a single spinlock.  Operations only touch a few
+ * entries, the I/O to the backing bdev is done outside of it.
+ */
+
+#ifndef SPDK_DEDUP_INDEX_H
+#define SPDK_DEDUP_INDEX_H
+
+#include "spdk/stdinc.h"
+
+/* Fingerprints are truncated to this many bytes */
+#define DEDUP_FP_LEN		16
+#define DEDUP_INVALID_CHUNK	UINT32_MAX
+/* Largest number of physical chunks, so that chunk numbers fit in a map entry */
+#define DEDUP_MAX_CHUNKS	(UINT32_MAX - 1)
+
+struct dedup_index;
+
+struct dedup_index_stats {
+	uint64_t num_logical_chunks;
+	uint64_t num_physical_chunks;
+	/* Logical blocks mapped to a physical chunk */
+	uint64_t mapped_chunks;
+	/* Physical chunks referenced by the map or by I/O in progress */
+	uint64_t used_chunks;
+	/* Chunks that can be found by their fingerprint */
+	uint64_t indexed_chunks;
+	/* Bytes allocated for the map, the chunk entries and the hash buckets */
+	uint64_t memory_bytes;
+};
+
+/**
+ * Allocate an index with every logical block unmapped and every chunk free.
+ *
+ * \param num_logical Number of logical blocks (map entries).
+ * \param num_physical Number of physical chunks, at most DEDUP_MAX_CHUNKS.
+ *
+ * \return the index on success, NULL on failure.
+ */
+struct dedup_index *dedup_index_create(uint64_t num_logical, uint64_t num_physical);
+
+void dedup_index_free(struct dedup_index *index);
+
+/**
+ * Find the chunk holding data with the given fingerprint and take a reference
+ * on it.
+ *
+ * \return the chunk, or DEDUP_INVALID_CHUNK if the fingerprint isn't indexed.
+ */
+uint32_t dedup_index_lookup(struct dedup_index *index, const uint8_t *fp);
+
+/**
+ * Allocate a free chunk to write new data to.  The caller holds the only
+ * reference on it.  The chunk can't be found in the index until its data has
+ * been written and dedup_index_insert() has been called.
+ *
+ * \return the chunk, or DEDUP_INVALID_CHUNK if there is no free chunk left.
+ */
+uint32_t dedup_index_alloc(struct dedup_index *index);
+
+/**
+ * Mark the data of an allocated chunk as written and add it to the index.  If
+ * another chunk with the same fingerprint is already indexed, the chunk is
+ * left out of the index.
+ */
+void dedup_index_insert(struct dedup_index *index, uint32_t chunk, const uint8_t *fp);
+
+/**
+ * Take a reference on a chunk whose data was written before the index was
+ * created and isn't indexed yet, to compute its fingerprint.
+ *
+ * \return true if a reference was taken.
+ */
+bool dedup_index_get_unindexed(struct dedup_index *index, uint32_t chunk);
+
+/**
+ * Release references on chunks.  A chunk that isn't referenced anymore is
+ * removed from the index and freed.  DEDUP_INVALID_CHUNK entries are skipped.
+ */
+void dedup_index_put(struct dedup_index *index, const uint32_t *chunks, uint32_t count);
+
+/**
+ * Look up the chunks mapped to a range of logical blocks and take a reference
+ * on each of them, so they can't be reused while they are being read.
+ * Unmapped blocks are returned as DEDUP_INVALID_CHUNK.
+ */
+void dedup_index_map_get(struct dedup_index *index, uint64_t lba, uint32_t count,
+			 uint32_t *chunks);
+
+/**
+ * Map a range of logical blocks to new chunks, or unmap them if the new chunk
+ * is DEDUP_INVALID_CHUNK.  The references held by the caller on the new
+ * chunks are handed over to the map, and the references the map held on the
+ * previous chunks are handed over to the caller through old_chunks.
+ */
+void dedup_index_map_set(struct dedup_index *index, uint64_t lba, uint32_t count,
+			 const uint32_t *chunks, uint32_t *old_chunks);
+
+/**
+ * Copy map entries in their on-disk format: the chunk number plus one, or 0
+ * for an unmapped block, in little endian.
+ */
+void dedup_index_map_copy(struct dedup_index *index, uint64_t lba, uint64_t count,
+			  uint32_t *entries);
+
+/**
+ * Set map entries read back from disk.  Must only be called before the index
+ * is used for I/O, and be followed by dedup_index_restore_done().
+ *
+ * \return 0 on success, -EINVAL if an entry refers to a chunk out of range.
+ */
+int dedup_index_map_restore(struct dedup_index *index, uint64_t lba, uint64_t count,
+			    const uint32_t *entries);
+
+/**
+ * Rebuild the list of free chunks once the whole map has been restored.
+ */
+void dedup_index_restore_done(struct dedup_index *index);
+
+void dedup_index_get_stats(struct dedup_index *index, struct dedup_index_stats *stats);
+
+#endif /* SPDK_DEDUP_INDEX_H */
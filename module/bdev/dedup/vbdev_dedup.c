@@ -0,0 +1,2157 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Dedup virtual bdev.  Every block of the dedup bdev is a chunk of data.
+ * Written chunks are fingerprinted and looked up in an in-memory index; a
+ * chunk whose data is already stored on the base bdev is only mapped to the
+ * existing copy, so duplicate writes cost a metadata update instead of a
+ * data write.
+ *
+ * Layout of the base bdev, in chunks:
+ *
+ *   0                    superblock
+ *   map_offset ...       logical-to-physical map, one 32-bit entry per block
+ *   data_offset ...      data chunks
+ *
+ * The map is written through: a write completes once its data and the map
+ * pages it changed are on the base bdev.  Map pages are only written from the
+ * thread that created the bdev, which orders the writes of each page.
+ *
+ * Fingerprints are either SHA-256, computed on the CPU and trusted as is, or
+ * CRC-32C, computed through the accel framework so it can be offloaded, with
+ * every match read back and compared.  They are not stored on disk: once an
+ * existing dedup bdev is loaded, the data chunks are read back in the
+ * background to index them again.
+ */
+
+#include "spdk/stdinc.h"
+
+#include <openssl/evp.h>
+
+#include "vbdev_dedup.h"
+#include "dedup_index.h"
+#include "spdk/accel_engine.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+#define DEDUP_SB_SIGNATURE	"SPDKDDUP"
+#define DEDUP_SB_VERSION	1
+#define DEDUP_MIN_CHUNK_SIZE	512
+#define DEDUP_MAX_CHUNK_SIZE	(128 * 1024)
+/* Chunks of a single I/O, the bdev layer splits larger ones */
+#define DEDUP_MAX_IO_CHUNKS	32
+/* Every chunk boundary can split one iovec of the I/O in two */
+#define DEDUP_MAX_IOVS		BDEV_IO_NUM_CHILD_IOV
+#define DEDUP_REQ_IOVS		(DEDUP_MAX_IOVS + DEDUP_MAX_IO_CHUNKS)
+/* An I/O touches at most two map pages, see vbdev_dedup_register() */
+#define DEDUP_MAX_IO_PAGES	2
+/* Map chunks read at once while loading */
+#define DEDUP_LOAD_CHUNKS	64
+/* Chunks checked for indexing per poll of the background rebuild */
+#define DEDUP_SCAN_BATCH	(64 * DEDUP_MAX_IO_CHUNKS)
+
+struct dedup_sb {
+	char			signature[8];
+	uint32_t		version;
+	uint32_t		chunk_size;
+	uint64_t		num_logical_chunks;
+	uint64_t		num_physical_chunks;
+	/* Offsets on the base bdev, in chunks */
+	uint64_t		map_offset;
+	uint64_t		data_offset;
+	struct spdk_uuid	uuid;
+	uint8_t			reserved[448];
+};
+SPDK_STATIC_ASSERT(sizeof(struct dedup_sb) == 512, "Incorrect size");
+
+static int vbdev_dedup_init(void);
+static int vbdev_dedup_get_ctx_size(void);
+static void vbdev_dedup_examine(struct spdk_bdev *bdev);
+static void vbdev_dedup_finish(void);
+static int vbdev_dedup_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module dedup_if = {
+	.name = "dedup",
+	.module_init = vbdev_dedup_init,
+	.get_ctx_size = vbdev_dedup_get_ctx_size,
+	.examine_disk = vbdev_dedup_examine,
+	.module_fini = vbdev_dedup_finish,
+	.config_json = vbdev_dedup_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(dedup, &dedup_if)
+
+/* Dedup bdevs requested over RPC, kept so they can be loaded in examine()
+ * once their base bdev shows up.
+ */
+struct bdev_dedup_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_dedup_opts		opts;
+	TAILQ_ENTRY(bdev_dedup_names)	link;
+};
+static TAILQ_HEAD(, bdev_dedup_names) g_bdev_dedup_names = TAILQ_HEAD_INITIALIZER(
+			g_bdev_dedup_names);
+
+struct dedup_req;
+
+struct dedup_map_waiter {
+	struct dedup_req		*req;
+	TAILQ_ENTRY(dedup_map_waiter)	link;
+};
+
+/* A write of one map page, carrying the updates of the requests waiting on it */
+struct dedup_map_write {
+	struct vbdev_dedup		*dedup;
+	uint64_t			page;
+	void				*buf;
+	TAILQ_HEAD(, dedup_map_waiter)	waiters;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+	TAILQ_ENTRY(dedup_map_write)	link;
+};
+
+struct dedup_map_page {
+	/* Write of the page in progress, if any */
+	struct dedup_map_write		*write;
+	/* Requests updated the page after that write copied it */
+	TAILQ_HEAD(, dedup_map_waiter)	waiters;
+};
+
+/* Background indexing of the chunks of a loaded dedup bdev */
+struct dedup_scan {
+	struct spdk_poller		*poller;
+	EVP_MD_CTX			*md_ctx;
+	void				*buf;
+	uint64_t			next_chunk;
+	uint64_t			first_chunk;
+	uint32_t			chunks[DEDUP_MAX_IO_CHUNKS];
+	uint32_t			num_chunks;
+	bool				reading;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+struct vbdev_dedup {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		dedup_bdev;
+	struct vbdev_dedup_opts		opts;
+	struct dedup_sb			sb;
+	struct dedup_index		*index;
+	uint32_t			chunk_size;
+	/* Base bdev blocks per chunk */
+	uint32_t			chunk_blocks;
+	uint64_t			map_chunks;
+	uint32_t			entries_per_page;
+	struct dedup_map_page		*map_pages;
+	TAILQ_HEAD(, dedup_map_write)	free_map_writes;
+	/* Thread the bdev was created on, which writes the map pages */
+	struct spdk_thread		*thread;
+	struct spdk_io_channel		*md_ch;
+	struct dedup_scan		scan;
+	/* Thread destruct() was called on, to report its completion */
+	struct spdk_thread		*destruct_thread;
+	bool				destructing;
+	TAILQ_ENTRY(vbdev_dedup)	link;
+};
+static TAILQ_HEAD(, vbdev_dedup) g_dedup_nodes = TAILQ_HEAD_INITIALIZER(g_dedup_nodes);
+
+struct dedup_io_channel {
+	struct spdk_io_channel		*base_ch;
+	/* Channel to compute CRC-32C fingerprints on */
+	struct spdk_io_channel		*accel_ch;
+	/* Context to compute SHA-256 fingerprints with */
+	EVP_MD_CTX			*md_ctx;
+	TAILQ_HEAD(, dedup_req)		free_reqs;
+	struct vbdev_dedup_stats	stats;
+};
+
+enum dedup_phase {
+	DEDUP_PHASE_READ,
+	DEDUP_PHASE_VERIFY,
+	DEDUP_PHASE_WRITE,
+};
+
+enum dedup_chunk_state {
+	/* Nothing to do on the base bdev */
+	DEDUP_CHUNK_NONE,
+	/* Read the chunk mapped to the block */
+	DEDUP_CHUNK_READ,
+	/* Write the data to a newly allocated chunk */
+	DEDUP_CHUNK_NEW,
+	/* Read a chunk with the same CRC-32C back to compare it with the data */
+	DEDUP_CHUNK_VERIFY,
+	/* Map the block to a chunk already holding the same data */
+	DEDUP_CHUNK_DUP,
+};
+
+struct dedup_chunk_io {
+	uint8_t				fp[DEDUP_FP_LEN];
+	uint32_t			crc;
+	/* Part of the I/O buffer holding the chunk, in dedup_req.iovs */
+	uint16_t			iov_idx;
+	uint16_t			iovcnt;
+	enum dedup_chunk_state		state;
+};
+
+/* State of a read or write while it moves between the base bdev and the index */
+struct dedup_req {
+	struct spdk_bdev_io		*bdev_io;
+	struct vbdev_dedup		*dedup;
+	struct dedup_io_channel		*dedup_ch;
+	struct spdk_thread		*thread;
+	uint64_t			offset_chunks;
+	uint32_t			num_chunks;
+	enum dedup_phase		phase;
+	/* First chunk not submitted yet in the current phase */
+	uint32_t			cursor;
+	uint32_t			outstanding;
+	bool				failed;
+	/* Chunk holding the data of each block, referenced by the request */
+	uint32_t			chunks[DEDUP_MAX_IO_CHUNKS];
+	/* Chunks the blocks were mapped to, released once the map is on disk */
+	uint32_t			old_chunks[DEDUP_MAX_IO_CHUNKS];
+	struct dedup_chunk_io		cio[DEDUP_MAX_IO_CHUNKS];
+	struct iovec			iovs[DEDUP_REQ_IOVS];
+	/* Data of CRC-32C matches, read back for comparison */
+	void				*verify_buf;
+	uint32_t			pages_pending;
+	struct dedup_map_waiter		waiters[DEDUP_MAX_IO_PAGES];
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+	TAILQ_ENTRY(dedup_req)		link;
+};
+
+struct dedup_bdev_io {
+	struct dedup_req		*req;
+	struct spdk_io_channel		*ch;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static const char *g_fingerprint_names[] = {
+	[VBDEV_DEDUP_FP_SHA256] = "sha256",
+	[VBDEV_DEDUP_FP_CRC32C] = "crc32c",
+};
+
+const char *
+vbdev_dedup_fingerprint_str(enum vbdev_dedup_fingerprint fingerprint)
+{
+	if ((size_t)fingerprint >= SPDK_COUNTOF(g_fingerprint_names)) {
+		return NULL;
+	}
+
+	return g_fingerprint_names[fingerprint];
+}
+
+int
+vbdev_dedup_fingerprint_parse(const char *str, enum vbdev_dedup_fingerprint *fingerprint)
+{
+	size_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_fingerprint_names); i++) {
+		if (strcmp(str, g_fingerprint_names[i]) == 0) {
+			*fingerprint = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static inline uint64_t
+dedup_data_offset_blocks(struct vbdev_dedup *dedup, uint32_t chunk)
+{
+	return (dedup->sb.data_offset + chunk) * dedup->chunk_blocks;
+}
+
+static int
+dedup_fp_sha256(EVP_MD_CTX *md_ctx, struct iovec *iovs, int iovcnt, uint8_t *fp)
+{
+	uint8_t digest[EVP_MAX_MD_SIZE];
+	unsigned int len;
+	int i;
+
+	if (EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) != 1) {
+		return -EIO;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		if (EVP_DigestUpdate(md_ctx, iovs[i].iov_base, iovs[i].iov_len) != 1) {
+			return -EIO;
+		}
+	}
+
+	if (EVP_DigestFinal_ex(md_ctx, digest, &len) != 1) {
+		return -EIO;
+	}
+
+	memcpy(fp, digest, DEDUP_FP_LEN);
+
+	return 0;
+}
+
+static inline void
+dedup_fp_crc32c(uint32_t crc, uint8_t *fp)
+{
+	memset(fp, 0, DEDUP_FP_LEN);
+	memcpy(fp, &crc, sizeof(crc));
+}
+
+/*
+ * I/O path
+ */
+
+static void vbdev_dedup_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+
+static struct dedup_req *
+dedup_req_get(struct vbdev_dedup *dedup, struct dedup_io_channel *dedup_ch)
+{
+	struct dedup_req *req;
+
+	req = TAILQ_FIRST(&dedup_ch->free_reqs);
+	if (req != NULL) {
+		TAILQ_REMOVE(&dedup_ch->free_reqs, req, link);
+		return req;
+	}
+
+	/* Requests are only allocated the first time this many I/O are outstanding */
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		return NULL;
+	}
+
+	if (dedup->opts.fingerprint == VBDEV_DEDUP_FP_CRC32C) {
+		req->verify_buf = spdk_dma_malloc((size_t)DEDUP_MAX_IO_CHUNKS * dedup->chunk_size,
+						  spdk_bdev_get_buf_align(dedup->base_bdev), NULL);
+		if (req->verify_buf == NULL) {
+			free(req);
+			return NULL;
+		}
+	}
+
+	req->dedup = dedup;
+	req->dedup_ch = dedup_ch;
+
+	return req;
+}
+
+static void
+dedup_req_free(struct dedup_req *req)
+{
+	spdk_dma_free(req->verify_buf);
+	free(req);
+}
+
+static void
+dedup_req_complete(struct dedup_req *req, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = req->bdev_io;
+
+	req->bdev_io = NULL;
+	TAILQ_INSERT_HEAD(&req->dedup_ch->free_reqs, req, link);
+	spdk_bdev_io_complete(bdev_io, status);
+}
+
+/* Split the I/O buffer at chunk boundaries */
+static int
+dedup_req_slice_iovs(struct dedup_req *req)
+{
+	struct spdk_bdev_io *bdev_io = req->bdev_io;
+	uint32_t chunk_size = req->dedup->chunk_size;
+	size_t iov_off = 0, len;
+	int iov = 0, idx = 0;
+	uint32_t i, left;
+
+	for (i = 0; i < req->num_chunks; i++) {
+		req->cio[i].iov_idx = idx;
+		for (left = chunk_size; left > 0; left -= len) {
+			if (iov >= bdev_io->u.bdev.iovcnt || idx >= DEDUP_REQ_IOVS) {
+				return -EINVAL;
+			}
+
+			len = spdk_min(left, bdev_io->u.bdev.iovs[iov].iov_len - iov_off);
+			req->iovs[idx].iov_base = (uint8_t *)bdev_io->u.bdev.iovs[iov].iov_base +
+						  iov_off;
+			req->iovs[idx].iov_len = len;
+			idx++;
+
+			iov_off += len;
+			if (iov_off == bdev_io->u.bdev.iovs[iov].iov_len) {
+				iov++;
+				iov_off = 0;
+			}
+		}
+		req->cio[i].iovcnt = idx - req->cio[i].iov_idx;
+	}
+
+	return 0;
+}
+
+static bool
+dedup_iov_equal(struct iovec *iovs, int iovcnt, const uint8_t *buf)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (memcmp(iovs[i].iov_base, buf, iovs[i].iov_len) != 0) {
+			return false;
+		}
+		buf += iovs[i].iov_len;
+	}
+
+	return true;
+}
+
+/* Find the next run of chunks in the given state mapped to consecutive chunks */
+static uint32_t
+dedup_next_run(struct dedup_req *req, enum dedup_chunk_state state, uint32_t *first)
+{
+	uint32_t i = req->cursor, n;
+
+	while (i < req->num_chunks && req->cio[i].state != state) {
+		i++;
+	}
+
+	*first = i;
+	if (i == req->num_chunks) {
+		return 0;
+	}
+
+	for (n = 1; i + n < req->num_chunks; n++) {
+		if (req->cio[i + n].state != state || req->chunks[i + n] != req->chunks[i] + n) {
+			break;
+		}
+	}
+
+	return n;
+}
+
+static void dedup_phase_done(struct dedup_req *req);
+
+static void
+dedup_run_put(struct dedup_req *req)
+{
+	assert(req->outstanding > 0);
+	if (--req->outstanding == 0 && req->cursor == req->num_chunks) {
+		dedup_phase_done(req);
+	}
+}
+
+static void
+_dedup_run_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	if (!success) {
+		req->failed = true;
+	}
+
+	dedup_run_put(req);
+}
+
+/* Submit the base bdev I/O of the current phase, one per run of chunks */
+static void
+dedup_submit_runs(void *arg)
+{
+	struct dedup_req *req = arg;
+	struct vbdev_dedup *dedup = req->dedup;
+	struct dedup_io_channel *dedup_ch = req->dedup_ch;
+	enum dedup_chunk_state state;
+	struct dedup_chunk_io *cio;
+	struct iovec *iovs;
+	uint32_t first, n;
+	uint64_t offset, num_blocks;
+	int iovcnt, rc;
+
+	switch (req->phase) {
+	case DEDUP_PHASE_READ:
+		state = DEDUP_CHUNK_READ;
+		break;
+	case DEDUP_PHASE_VERIFY:
+		state = DEDUP_CHUNK_VERIFY;
+		break;
+	default:
+		state = DEDUP_CHUNK_NEW;
+		break;
+	}
+
+	/* Hold the request until everything is submitted */
+	req->outstanding++;
+
+	while (!req->failed && (n = dedup_next_run(req, state, &first)) != 0) {
+		cio = &req->cio[first];
+		iovs = &req->iovs[cio->iov_idx];
+		iovcnt = cio[n - 1].iov_idx + cio[n - 1].iovcnt - cio->iov_idx;
+		offset = dedup_data_offset_blocks(dedup, req->chunks[first]);
+		num_blocks = (uint64_t)n * dedup->chunk_blocks;
+
+		switch (req->phase) {
+		case DEDUP_PHASE_READ:
+			rc = spdk_bdev_readv_blocks(dedup->base_desc, dedup_ch->base_ch, iovs, iovcnt,
+						    offset, num_blocks, _dedup_run_done, req);
+			break;
+		case DEDUP_PHASE_VERIFY:
+			rc = spdk_bdev_read_blocks(dedup->base_desc, dedup_ch->base_ch,
+						   (uint8_t *)req->verify_buf +
+						   (size_t)first * dedup->chunk_size,
+						   offset, num_blocks, _dedup_run_done, req);
+			break;
+		default:
+			rc = spdk_bdev_writev_blocks(dedup->base_desc, dedup_ch->base_ch, iovs, iovcnt,
+						     offset, num_blocks, _dedup_run_done, req);
+			break;
+		}
+
+		if (rc == -ENOMEM) {
+			req->bdev_io_wait.bdev = dedup->base_bdev;
+			req->bdev_io_wait.cb_fn = dedup_submit_runs;
+			req->bdev_io_wait.cb_arg = req;
+
+			rc = spdk_bdev_queue_io_wait(dedup->base_bdev, dedup_ch->base_ch,
+						     &req->bdev_io_wait);
+			if (rc == 0) {
+				/* The cursor isn't at the end, completions won't end the phase */
+				req->outstanding--;
+				return;
+			}
+			SPDK_ERRLOG("Queue io failed in dedup_submit_runs, rc=%d.\n", rc);
+		}
+
+		if (rc != 0) {
+			req->failed = true;
+			break;
+		}
+
+		req->outstanding++;
+		req->cursor = first + n;
+	}
+
+	req->cursor = req->num_chunks;
+	dedup_run_put(req);
+}
+
+static void
+dedup_start_phase(struct dedup_req *req, enum dedup_phase phase)
+{
+	req->phase = phase;
+	req->cursor = 0;
+	dedup_submit_runs(req);
+}
+
+static void
+dedup_read(struct dedup_req *req)
+{
+	struct dedup_chunk_io *cio;
+	struct iovec *iov;
+	uint32_t i;
+	int j;
+
+	if (dedup_req_slice_iovs(req) != 0) {
+		SPDK_ERRLOG("dedup: could not split the buffer of a read\n");
+		dedup_req_complete(req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedup_index_map_get(req->dedup->index, req->offset_chunks, req->num_chunks, req->chunks);
+
+	for (i = 0; i < req->num_chunks; i++) {
+		cio = &req->cio[i];
+		if (req->chunks[i] != DEDUP_INVALID_CHUNK) {
+			cio->state = DEDUP_CHUNK_READ;
+			continue;
+		}
+
+		/* Blocks never written, or unmapped, read as zeroes */
+		cio->state = DEDUP_CHUNK_NONE;
+		for (j = 0; j < cio->iovcnt; j++) {
+			iov = &req->iovs[cio->iov_idx + j];
+			memset(iov->iov_base, 0, iov->iov_len);
+		}
+	}
+
+	dedup_start_phase(req, DEDUP_PHASE_READ);
+}
+
+static void
+dedup_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	if (!success) {
+		dedup_req_complete(io_ctx->req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedup_read(io_ctx->req);
+}
+
+/* Drop everything a write holds before its blocks were remapped */
+static void
+dedup_write_fail(struct dedup_req *req)
+{
+	dedup_index_put(req->dedup->index, req->chunks, req->num_chunks);
+	dedup_req_complete(req, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+_dedup_map_persisted(void *arg)
+{
+	struct dedup_req *req = arg;
+
+	/* The map on disk no longer points to the old chunks, they can be reused */
+	dedup_index_put(req->dedup->index, req->old_chunks, req->num_chunks);
+	dedup_req_complete(req, req->failed ? SPDK_BDEV_IO_STATUS_FAILED :
+			   SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void dedup_map_write_page(struct vbdev_dedup *dedup, uint64_t page);
+
+static void
+_dedup_persist_map(void *arg)
+{
+	struct dedup_req *req = arg;
+	struct vbdev_dedup *dedup = req->dedup;
+	struct dedup_map_page *map_page;
+	uint64_t first, last, page;
+	uint32_t i;
+
+	first = req->offset_chunks / dedup->entries_per_page;
+	last = (req->offset_chunks + req->num_chunks - 1) / dedup->entries_per_page;
+	assert(last - first < DEDUP_MAX_IO_PAGES);
+
+	req->pages_pending = last - first + 1;
+	for (page = first, i = 0; page <= last; page++, i++) {
+		map_page = &dedup->map_pages[page];
+		req->waiters[i].req = req;
+		TAILQ_INSERT_TAIL(&map_page->waiters, &req->waiters[i], link);
+		if (map_page->write == NULL) {
+			dedup_map_write_page(dedup, page);
+		}
+	}
+}
+
+/* Point the blocks of a write, unmap or write zeroes to their new chunks */
+static void
+dedup_commit(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	uint32_t i;
+
+	for (i = 0; i < req->num_chunks; i++) {
+		if (req->cio[i].state == DEDUP_CHUNK_NEW) {
+			dedup_index_insert(dedup->index, req->chunks[i], req->cio[i].fp);
+		}
+	}
+
+	dedup_index_map_set(dedup->index, req->offset_chunks, req->num_chunks, req->chunks,
+			    req->old_chunks);
+
+	spdk_thread_send_msg(dedup->thread, _dedup_persist_map, req);
+}
+
+static void
+dedup_verify_done(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	struct dedup_chunk_io *cio;
+	uint32_t i;
+
+	for (i = 0; i < req->num_chunks; i++) {
+		cio = &req->cio[i];
+		if (cio->state != DEDUP_CHUNK_VERIFY) {
+			continue;
+		}
+
+		if (dedup_iov_equal(&req->iovs[cio->iov_idx], cio->iovcnt,
+				    (uint8_t *)req->verify_buf + (size_t)i * dedup->chunk_size)) {
+			cio->state = DEDUP_CHUNK_DUP;
+			req->dedup_ch->stats.duplicate_chunks++;
+			continue;
+		}
+
+		/* Same CRC-32C, different data */
+		req->dedup_ch->stats.verify_mismatches++;
+		dedup_index_put(dedup->index, &req->chunks[i], 1);
+		req->chunks[i] = dedup_index_alloc(dedup->index);
+		if (req->chunks[i] == DEDUP_INVALID_CHUNK) {
+			SPDK_DEBUGLOG(vbdev_dedup, "%s: out of chunks\n", dedup->dedup_bdev.name);
+			req->failed = true;
+		}
+		cio->state = DEDUP_CHUNK_NEW;
+	}
+
+	if (req->failed) {
+		dedup_write_fail(req);
+		return;
+	}
+
+	dedup_start_phase(req, DEDUP_PHASE_WRITE);
+}
+
+static void
+dedup_phase_done(struct dedup_req *req)
+{
+	switch (req->phase) {
+	case DEDUP_PHASE_READ:
+		dedup_index_put(req->dedup->index, req->chunks, req->num_chunks);
+		dedup_req_complete(req, req->failed ? SPDK_BDEV_IO_STATUS_FAILED :
+				   SPDK_BDEV_IO_STATUS_SUCCESS);
+		break;
+	case DEDUP_PHASE_VERIFY:
+		if (req->failed) {
+			dedup_write_fail(req);
+		} else {
+			dedup_verify_done(req);
+		}
+		break;
+	case DEDUP_PHASE_WRITE:
+		if (req->failed) {
+			dedup_write_fail(req);
+		} else {
+			dedup_commit(req);
+		}
+		break;
+	}
+}
+
+/* Map every chunk of a write to a copy of its data, existing or new */
+static void
+dedup_write_lookup(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	struct vbdev_dedup_stats *stats = &req->dedup_ch->stats;
+	bool verify = dedup->opts.fingerprint == VBDEV_DEDUP_FP_CRC32C;
+	bool any_verify = false;
+	struct dedup_chunk_io *cio;
+	uint32_t i;
+
+	stats->write_chunks += req->num_chunks;
+
+	for (i = 0; i < req->num_chunks; i++) {
+		cio = &req->cio[i];
+		req->chunks[i] = DEDUP_INVALID_CHUNK;
+		cio->state = DEDUP_CHUNK_NONE;
+		if (req->failed) {
+			continue;
+		}
+
+		req->chunks[i] = dedup_index_lookup(dedup->index, cio->fp);
+		if (req->chunks[i] != DEDUP_INVALID_CHUNK) {
+			if (verify) {
+				cio->state = DEDUP_CHUNK_VERIFY;
+				stats->verify_reads++;
+				any_verify = true;
+			} else {
+				cio->state = DEDUP_CHUNK_DUP;
+				stats->duplicate_chunks++;
+			}
+			continue;
+		}
+
+		req->chunks[i] = dedup_index_alloc(dedup->index);
+		if (req->chunks[i] == DEDUP_INVALID_CHUNK) {
+			SPDK_DEBUGLOG(vbdev_dedup, "%s: out of chunks\n", dedup->dedup_bdev.name);
+			req->failed = true;
+			continue;
+		}
+		cio->state = DEDUP_CHUNK_NEW;
+	}
+
+	if (req->failed) {
+		dedup_write_fail(req);
+		return;
+	}
+
+	dedup_start_phase(req, any_verify ? DEDUP_PHASE_VERIFY : DEDUP_PHASE_WRITE);
+}
+
+static void
+_dedup_crc32c_done(void *cb_arg, int status)
+{
+	struct dedup_req *req = cb_arg;
+	uint32_t i;
+
+	if (status != 0) {
+		req->failed = true;
+	}
+
+	if (--req->outstanding != 0) {
+		return;
+	}
+
+	for (i = 0; i < req->num_chunks; i++) {
+		dedup_fp_crc32c(req->cio[i].crc, req->cio[i].fp);
+	}
+	dedup_write_lookup(req);
+}
+
+static void
+dedup_write(struct dedup_req *req)
+{
+	struct dedup_io_channel *dedup_ch = req->dedup_ch;
+	struct dedup_chunk_io *cio;
+	struct iovec *iovs;
+	uint32_t i;
+	int rc;
+
+	if (dedup_req_slice_iovs(req) != 0) {
+		SPDK_ERRLOG("dedup: could not split the buffer of a write\n");
+		dedup_req_complete(req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (req->dedup->opts.fingerprint == VBDEV_DEDUP_FP_SHA256) {
+		for (i = 0; i < req->num_chunks; i++) {
+			cio = &req->cio[i];
+			if (dedup_fp_sha256(dedup_ch->md_ctx, &req->iovs[cio->iov_idx], cio->iovcnt,
+					    cio->fp) != 0) {
+				SPDK_ERRLOG("dedup: could not compute SHA-256\n");
+				req->failed = true;
+				break;
+			}
+		}
+		dedup_write_lookup(req);
+		return;
+	}
+
+	/* Hold the request until everything is submitted. Each CRC is counted before it is
+	 *  submitted, as its callback may be called before the submit call returns.
+	 */
+	req->outstanding = 1;
+	for (i = 0; i < req->num_chunks; i++) {
+		cio = &req->cio[i];
+		iovs = &req->iovs[cio->iov_idx];
+		req->outstanding++;
+		rc = spdk_accel_submit_crc32cv(dedup_ch->accel_ch, &cio->crc, iovs, cio->iovcnt, 0,
+					       _dedup_crc32c_done, req);
+		if (rc != 0) {
+			req->outstanding--;
+			/* Same result as the software accel engine, with a seed of 0 */
+			cio->crc = spdk_crc32c_iov_update(iovs, cio->iovcnt, ~0U);
+		}
+	}
+	_dedup_crc32c_done(req, 0);
+}
+
+static void
+dedup_unmap(struct dedup_req *req)
+{
+	uint32_t i;
+
+	for (i = 0; i < req->num_chunks; i++) {
+		req->chunks[i] = DEDUP_INVALID_CHUNK;
+		req->cio[i].state = DEDUP_CHUNK_NONE;
+	}
+
+	dedup_commit(req);
+}
+
+static void
+_dedup_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+vbdev_dedup_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_dedup_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_dedup_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dedup_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_dedup_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, dedup_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_dedup_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+vbdev_dedup_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_dedup *dedup = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedup, dedup_bdev);
+	struct dedup_io_channel *dedup_ch = spdk_io_channel_get_ctx(ch);
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_req *req;
+	int rc;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		/* Data and map are written through, only the base bdev cache is left */
+		rc = spdk_bdev_flush_blocks(dedup->base_desc, dedup_ch->base_ch, 0,
+					    dedup->base_bdev->blockcnt,
+					    _dedup_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(dedup->base_desc, dedup_ch->base_ch,
+				     _dedup_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		req = dedup_req_get(dedup, dedup_ch);
+		if (req == NULL) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+			return;
+		}
+
+		io_ctx->req = req;
+		req->bdev_io = bdev_io;
+		req->thread = spdk_get_thread();
+		req->offset_chunks = bdev_io->u.bdev.offset_blocks;
+		req->num_chunks = bdev_io->u.bdev.num_blocks;
+		req->outstanding = 0;
+		req->failed = false;
+		assert(req->num_chunks <= DEDUP_MAX_IO_CHUNKS);
+
+		switch (bdev_io->type) {
+		case SPDK_BDEV_IO_TYPE_READ:
+			spdk_bdev_io_get_buf(bdev_io, dedup_read_get_buf_cb,
+					     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+			break;
+		case SPDK_BDEV_IO_TYPE_WRITE:
+			dedup_write(req);
+			break;
+		default:
+			dedup_unmap(req);
+			break;
+		}
+		return;
+	default:
+		SPDK_ERRLOG("dedup: unsupported I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io_ctx->ch = ch;
+		vbdev_dedup_queue_io(bdev_io);
+	} else if (rc != 0) {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+/*
+ * Map pages, only written from dedup->thread
+ */
+
+static void
+dedup_map_waiter_done(struct dedup_map_waiter *waiter, bool success)
+{
+	struct dedup_req *req = waiter->req;
+
+	if (!success) {
+		req->failed = true;
+	}
+
+	if (--req->pages_pending == 0) {
+		spdk_thread_send_msg(req->thread, _dedup_map_persisted, req);
+	}
+}
+
+static struct dedup_map_write *
+dedup_map_write_get(struct vbdev_dedup *dedup)
+{
+	struct dedup_map_write *write;
+
+	write = TAILQ_FIRST(&dedup->free_map_writes);
+	if (write != NULL) {
+		TAILQ_REMOVE(&dedup->free_map_writes, write, link);
+		return write;
+	}
+
+	write = calloc(1, sizeof(*write));
+	if (write == NULL) {
+		return NULL;
+	}
+
+	write->buf = spdk_dma_zmalloc(dedup->chunk_size, spdk_bdev_get_buf_align(dedup->base_bdev),
+				      NULL);
+	if (write->buf == NULL) {
+		free(write);
+		return NULL;
+	}
+
+	write->dedup = dedup;
+	TAILQ_INIT(&write->waiters);
+
+	return write;
+}
+
+static void dedup_map_write_done(struct dedup_map_write *write, bool success);
+
+static void
+_dedup_map_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	spdk_bdev_free_io(bdev_io);
+	dedup_map_write_done(cb_arg, success);
+}
+
+static void
+dedup_map_write_submit(void *arg)
+{
+	struct dedup_map_write *write = arg;
+	struct vbdev_dedup *dedup = write->dedup;
+	int rc;
+
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->md_ch, write->buf,
+				    (dedup->sb.map_offset + write->page) * dedup->chunk_blocks,
+				    dedup->chunk_blocks, _dedup_map_write_done, write);
+	if (rc == -ENOMEM) {
+		write->bdev_io_wait.bdev = dedup->base_bdev;
+		write->bdev_io_wait.cb_fn = dedup_map_write_submit;
+		write->bdev_io_wait.cb_arg = write;
+
+		rc = spdk_bdev_queue_io_wait(dedup->base_bdev, dedup->md_ch, &write->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+		SPDK_ERRLOG("Queue io failed in dedup_map_write_submit, rc=%d.\n", rc);
+	}
+
+	if (rc != 0) {
+		dedup_map_write_done(write, false);
+	}
+}
+
+/* Write the current content of a map page for the requests waiting on it */
+static void
+dedup_map_write_page(struct vbdev_dedup *dedup, uint64_t page)
+{
+	struct dedup_map_page *map_page = &dedup->map_pages[page];
+	struct dedup_map_write *write;
+	struct dedup_map_waiter *waiter;
+	uint64_t lba, count;
+
+	assert(map_page->write == NULL);
+
+	write = dedup_map_write_get(dedup);
+	if (write == NULL) {
+		SPDK_ERRLOG("%s: could not allocate a map page write\n", dedup->dedup_bdev.name);
+		while ((waiter = TAILQ_FIRST(&map_page->waiters))) {
+			TAILQ_REMOVE(&map_page->waiters, waiter, link);
+			dedup_map_waiter_done(waiter, false);
+		}
+		return;
+	}
+
+	write->page = page;
+	TAILQ_SWAP(&write->waiters, &map_page->waiters, dedup_map_waiter, link);
+	map_page->write = write;
+
+	lba = page * dedup->entries_per_page;
+	count = spdk_min(dedup->entries_per_page, dedup->sb.num_logical_chunks - lba);
+	dedup_index_map_copy(dedup->index, lba, count, write->buf);
+	memset((uint32_t *)write->buf + count, 0,
+	       (dedup->entries_per_page - count) * sizeof(uint32_t));
+
+	dedup_map_write_submit(write);
+}
+
+static void
+dedup_map_write_done(struct dedup_map_write *write, bool success)
+{
+	struct vbdev_dedup *dedup = write->dedup;
+	struct dedup_map_page *map_page = &dedup->map_pages[write->page];
+	struct dedup_map_waiter *waiter;
+
+	if (!success) {
+		SPDK_ERRLOG("%s: could not write map page %" PRIu64 "\n", dedup->dedup_bdev.name,
+			    write->page);
+	}
+
+	while ((waiter = TAILQ_FIRST(&write->waiters))) {
+		TAILQ_REMOVE(&write->waiters, waiter, link);
+		dedup_map_waiter_done(waiter, success);
+	}
+
+	map_page->write = NULL;
+	TAILQ_INSERT_HEAD(&dedup->free_map_writes, write, link);
+
+	/* Updates made while the page was being written go out with the next write */
+	if (!TAILQ_EMPTY(&map_page->waiters)) {
+		dedup_map_write_page(dedup, write->page);
+	}
+}
+
+static bool
+vbdev_dedup_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return true;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(dedup->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_dedup_get_io_channel(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	return spdk_get_io_channel(dedup);
+}
+
+static void
+vbdev_dedup_write_opts_json(struct vbdev_dedup *dedup, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&dedup->dedup_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(dedup->base_bdev));
+	spdk_json_write_named_uint32(w, "chunk_size", dedup->opts.chunk_size);
+	spdk_json_write_named_uint64(w, "logical_size_mb", dedup->opts.logical_size_mb);
+	spdk_json_write_named_string(w, "fingerprint",
+				     vbdev_dedup_fingerprint_str(dedup->opts.fingerprint));
+}
+
+static int
+vbdev_dedup_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	spdk_json_write_named_object_begin(w, "dedup");
+	vbdev_dedup_write_opts_json(dedup, w);
+	spdk_json_write_named_uint64(w, "num_physical_chunks", dedup->sb.num_physical_chunks);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_dedup_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *dedup;
+
+	TAILQ_FOREACH(dedup, &g_dedup_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_dedup_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_dedup_write_opts_json(dedup, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+dedup_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct dedup_io_channel *dedup_ch = ctx_buf;
+	struct vbdev_dedup *dedup = io_device;
+
+	TAILQ_INIT(&dedup_ch->free_reqs);
+
+	dedup_ch->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	if (dedup_ch->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	if (dedup->opts.fingerprint == VBDEV_DEDUP_FP_CRC32C) {
+		dedup_ch->accel_ch = spdk_accel_engine_get_io_channel();
+		if (dedup_ch->accel_ch == NULL) {
+			spdk_put_io_channel(dedup_ch->base_ch);
+			return -ENOMEM;
+		}
+	} else {
+		dedup_ch->md_ctx = EVP_MD_CTX_new();
+		if (dedup_ch->md_ctx == NULL) {
+			spdk_put_io_channel(dedup_ch->base_ch);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void
+dedup_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct dedup_io_channel *dedup_ch = ctx_buf;
+	struct dedup_req *req;
+
+	if (dedup_ch->accel_ch != NULL) {
+		spdk_put_io_channel(dedup_ch->accel_ch);
+	}
+	EVP_MD_CTX_free(dedup_ch->md_ctx);
+	spdk_put_io_channel(dedup_ch->base_ch);
+
+	while ((req = TAILQ_FIRST(&dedup_ch->free_reqs))) {
+		TAILQ_REMOVE(&dedup_ch->free_reqs, req, link);
+		dedup_req_free(req);
+	}
+}
+
+static void
+vbdev_dedup_free(struct vbdev_dedup *dedup)
+{
+	struct dedup_map_write *write;
+
+	while ((write = TAILQ_FIRST(&dedup->free_map_writes))) {
+		TAILQ_REMOVE(&dedup->free_map_writes, write, link);
+		spdk_dma_free(write->buf);
+		free(write);
+	}
+
+	EVP_MD_CTX_free(dedup->scan.md_ctx);
+	spdk_dma_free(dedup->scan.buf);
+	dedup_index_free(dedup->index);
+	free(dedup->map_pages);
+	free(dedup->dedup_bdev.name);
+	free(dedup);
+}
+
+static void
+_vbdev_dedup_destruct_done(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	spdk_bdev_destruct_done(&dedup->dedup_bdev, 0);
+	vbdev_dedup_free(dedup);
+}
+
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_dedup *dedup = io_device;
+
+	spdk_thread_send_msg(dedup->destruct_thread, _vbdev_dedup_destruct_done, dedup);
+}
+
+static void
+vbdev_dedup_close(struct vbdev_dedup *dedup)
+{
+	spdk_put_io_channel(dedup->md_ch);
+	spdk_bdev_close(dedup->base_desc);
+	spdk_io_device_unregister(dedup, _device_unregister_cb);
+}
+
+static void
+_vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	spdk_poller_unregister(&dedup->scan.poller);
+	dedup->destructing = true;
+
+	/* A scan read still uses the base bdev, it closes it on completion */
+	if (!dedup->scan.reading) {
+		vbdev_dedup_close(dedup);
+	}
+}
+
+static int
+vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	TAILQ_REMOVE(&g_dedup_nodes, dedup, link);
+
+	spdk_bdev_module_release_bdev(dedup->base_bdev);
+
+	/* The scan and the metadata channel live on the creation thread */
+	dedup->destruct_thread = spdk_get_thread();
+	spdk_thread_send_msg(dedup->thread, _vbdev_dedup_destruct, dedup);
+
+	return 1;
+}
+
+static void
+vbdev_dedup_free_name(struct bdev_dedup_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_dedup_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_dedup_insert_name(const char *bdev_name, const char *vbdev_name,
+			const struct vbdev_dedup_opts *opts, struct bdev_dedup_names **_name)
+{
+	struct bdev_dedup_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_dedup_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("dedup bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_dedup_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_dedup_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->bdev_name || !name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate bdev names\n");
+		free(name->bdev_name);
+		free(name->vbdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+	name->opts = *opts;
+
+	TAILQ_INSERT_TAIL(&g_bdev_dedup_names, name, link);
+	*_name = name;
+
+	return 0;
+}
+
+static int
+vbdev_dedup_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_dedup_finish(void)
+{
+	struct bdev_dedup_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_dedup_names))) {
+		vbdev_dedup_free_name(name);
+	}
+}
+
+static int
+vbdev_dedup_get_ctx_size(void)
+{
+	return sizeof(struct dedup_bdev_io);
+}
+
+static const struct spdk_bdev_fn_table vbdev_dedup_fn_table = {
+	.destruct		= vbdev_dedup_destruct,
+	.submit_request		= vbdev_dedup_submit_request,
+	.io_type_supported	= vbdev_dedup_io_type_supported,
+	.get_io_channel		= vbdev_dedup_get_io_channel,
+	.dump_info_json		= vbdev_dedup_dump_info_json,
+};
+
+static void
+vbdev_dedup_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_dedup *dedup, *tmp;
+
+	TAILQ_FOREACH_SAFE(dedup, &g_dedup_nodes, link, tmp) {
+		if (bdev_find == dedup->base_bdev) {
+			spdk_bdev_unregister(&dedup->dedup_bdev, NULL, NULL);
+		}
+	}
+}
+
+static void
+vbdev_dedup_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			       void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_dedup_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+/*
+ * Index rebuild of a loaded dedup bdev, on dedup->thread
+ */
+
+static int dedup_scan_poll(void *arg);
+
+static void
+dedup_scan_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	struct dedup_scan *scan = &dedup->scan;
+	uint8_t fp[DEDUP_FP_LEN];
+	uint8_t *data;
+	struct iovec iov;
+	uint32_t i;
+
+	spdk_bdev_free_io(bdev_io);
+	scan->reading = false;
+
+	for (i = 0; i < scan->num_chunks && success; i++) {
+		if (scan->chunks[i] == DEDUP_INVALID_CHUNK) {
+			continue;
+		}
+
+		data = (uint8_t *)scan->buf + (size_t)i * dedup->chunk_size;
+		if (dedup->opts.fingerprint == VBDEV_DEDUP_FP_CRC32C) {
+			dedup_fp_crc32c(spdk_crc32c_update(data, dedup->chunk_size, ~0U), fp);
+		} else {
+			iov.iov_base = data;
+			iov.iov_len = dedup->chunk_size;
+			if (dedup_fp_sha256(scan->md_ctx, &iov, 1, fp) != 0) {
+				continue;
+			}
+		}
+		dedup_index_insert(dedup->index, scan->chunks[i], fp);
+	}
+	dedup_index_put(dedup->index, scan->chunks, scan->num_chunks);
+
+	if (dedup->destructing) {
+		vbdev_dedup_close(dedup);
+		return;
+	}
+
+	if (!success) {
+		/* Chunks left out of the index are still read and written, just not deduplicated */
+		SPDK_ERRLOG("%s: could not read chunks to rebuild the index\n",
+			    dedup->dedup_bdev.name);
+		spdk_poller_unregister(&scan->poller);
+		return;
+	}
+
+	scan->next_chunk = scan->first_chunk + scan->num_chunks;
+}
+
+static int
+dedup_scan_poll(void *arg)
+{
+	struct vbdev_dedup *dedup = arg;
+	struct dedup_scan *scan = &dedup->scan;
+	uint64_t checked = 0;
+	bool found;
+	uint32_t i;
+	int rc;
+
+	if (scan->reading) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	while (scan->next_chunk < dedup->sb.num_physical_chunks && checked < DEDUP_SCAN_BATCH) {
+		scan->first_chunk = scan->next_chunk;
+		scan->num_chunks = spdk_min(DEDUP_MAX_IO_CHUNKS,
+					    dedup->sb.num_physical_chunks - scan->first_chunk);
+		checked += scan->num_chunks;
+
+		found = false;
+		for (i = 0; i < scan->num_chunks; i++) {
+			scan->chunks[i] = DEDUP_INVALID_CHUNK;
+			if (dedup_index_get_unindexed(dedup->index, scan->first_chunk + i)) {
+				scan->chunks[i] = scan->first_chunk + i;
+				found = true;
+			}
+		}
+
+		if (!found) {
+			scan->next_chunk += scan->num_chunks;
+			continue;
+		}
+
+		rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->md_ch, scan->buf,
+					   dedup_data_offset_blocks(dedup, scan->first_chunk),
+					   (uint64_t)scan->num_chunks * dedup->chunk_blocks,
+					   dedup_scan_read_done, dedup);
+		if (rc != 0) {
+			/* Try the same chunks again on the next poll */
+			dedup_index_put(dedup->index, scan->chunks, scan->num_chunks);
+			return SPDK_POLLER_BUSY;
+		}
+
+		scan->reading = true;
+		return SPDK_POLLER_BUSY;
+	}
+
+	if (scan->next_chunk == dedup->sb.num_physical_chunks) {
+		SPDK_NOTICELOG("%s: index rebuilt\n", dedup->dedup_bdev.name);
+		spdk_poller_unregister(&scan->poller);
+	}
+
+	return checked > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static int
+dedup_scan_start(struct vbdev_dedup *dedup)
+{
+	struct dedup_scan *scan = &dedup->scan;
+
+	if (dedup->opts.fingerprint == VBDEV_DEDUP_FP_SHA256) {
+		scan->md_ctx = EVP_MD_CTX_new();
+		if (scan->md_ctx == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	scan->buf = spdk_dma_malloc((size_t)DEDUP_MAX_IO_CHUNKS * dedup->chunk_size,
+				    spdk_bdev_get_buf_align(dedup->base_bdev), NULL);
+	if (scan->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	scan->poller = SPDK_POLLER_REGISTER(dedup_scan_poll, dedup, 0);
+	if (scan->poller == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * Creation of a dedup bdev, formatting or loading the base bdev
+ */
+
+struct dedup_load_ctx {
+	struct bdev_dedup_names		*name;
+	struct vbdev_dedup		*dedup;
+	void				*buf;
+	uint64_t			next_map_chunk;
+	bool				loaded;
+	/* Called from examine() rather than from an RPC */
+	bool				examine;
+	vbdev_dedup_create_cb		cb_fn;
+	void				*cb_arg;
+};
+
+static int
+vbdev_dedup_register(struct dedup_load_ctx *ctx)
+{
+	struct vbdev_dedup *dedup = ctx->dedup;
+	struct spdk_bdev *bdev = dedup->base_bdev;
+	uint64_t i;
+	int rc;
+
+	dedup->map_pages = calloc(dedup->map_chunks, sizeof(*dedup->map_pages));
+	if (dedup->map_pages == NULL) {
+		return -ENOMEM;
+	}
+	for (i = 0; i < dedup->map_chunks; i++) {
+		TAILQ_INIT(&dedup->map_pages[i].waiters);
+	}
+
+	dedup->dedup_bdev.write_cache = bdev->write_cache;
+	dedup->dedup_bdev.required_alignment = bdev->required_alignment;
+	dedup->dedup_bdev.blocklen = dedup->chunk_size;
+	dedup->dedup_bdev.blockcnt = dedup->sb.num_logical_chunks;
+	dedup->dedup_bdev.uuid = dedup->sb.uuid;
+	/* A map page covers at least 128 blocks and is aligned to the boundary, so
+	 * a read or write never spans two of them.  Unmaps and write zeroes are
+	 * only limited in size and span at most two.
+	 */
+	dedup->dedup_bdev.optimal_io_boundary = DEDUP_MAX_IO_CHUNKS;
+	dedup->dedup_bdev.split_on_optimal_io_boundary = true;
+	dedup->dedup_bdev.max_num_segments = DEDUP_MAX_IOVS;
+	dedup->dedup_bdev.max_unmap = DEDUP_MAX_IO_CHUNKS;
+	dedup->dedup_bdev.max_unmap_segments = 1;
+	dedup->dedup_bdev.max_write_zeroes = DEDUP_MAX_IO_CHUNKS;
+
+	dedup->dedup_bdev.ctxt = dedup;
+	dedup->dedup_bdev.fn_table = &vbdev_dedup_fn_table;
+	dedup->dedup_bdev.module = &dedup_if;
+
+	if (ctx->loaded) {
+		rc = dedup_scan_start(dedup);
+		if (rc) {
+			spdk_poller_unregister(&dedup->scan.poller);
+			return rc;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&g_dedup_nodes, dedup, link);
+	spdk_io_device_register(dedup, dedup_bdev_ch_create_cb, dedup_bdev_ch_destroy_cb,
+				sizeof(struct dedup_io_channel), ctx->name->vbdev_name);
+
+	rc = spdk_bdev_register(&dedup->dedup_bdev);
+	if (rc) {
+		SPDK_ERRLOG("could not register dedup bdev %s\n", ctx->name->vbdev_name);
+		TAILQ_REMOVE(&g_dedup_nodes, dedup, link);
+		spdk_io_device_unregister(dedup, NULL);
+		spdk_poller_unregister(&dedup->scan.poller);
+		return rc;
+	}
+
+	SPDK_NOTICELOG("%s dedup bdev %s on %s: %" PRIu64 " blocks, %" PRIu64 " data chunks\n",
+		       ctx->loaded ? "loaded" : "created", ctx->name->vbdev_name,
+		       ctx->name->bdev_name, dedup->sb.num_logical_chunks,
+		       dedup->sb.num_physical_chunks);
+
+	return 0;
+}
+
+static void
+dedup_load_done(struct dedup_load_ctx *ctx, int rc)
+{
+	struct vbdev_dedup *dedup = ctx->dedup;
+
+	if (rc == 0) {
+		rc = vbdev_dedup_register(ctx);
+	}
+
+	if (rc != 0) {
+		SPDK_ERRLOG("could not create dedup bdev %s: %s\n", ctx->name->vbdev_name,
+			    spdk_strerror(-rc));
+		spdk_put_io_channel(dedup->md_ch);
+		spdk_bdev_module_release_bdev(dedup->base_bdev);
+		spdk_bdev_close(dedup->base_desc);
+		vbdev_dedup_free(dedup);
+	}
+
+	spdk_dma_free(ctx->buf);
+
+	if (ctx->examine) {
+		spdk_bdev_module_examine_done(&dedup_if);
+	} else {
+		if (rc != 0) {
+			vbdev_dedup_free_name(ctx->name);
+		}
+		ctx->cb_fn(ctx->cb_arg, rc);
+	}
+	free(ctx);
+}
+
+static void dedup_load_map(struct dedup_load_ctx *ctx);
+
+static void
+dedup_load_map_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_load_ctx *ctx = cb_arg;
+	struct vbdev_dedup *dedup = ctx->dedup;
+	uint64_t num_chunks, lba, count;
+
+	spdk_bdev_free_io(bdev_io);
+	if (!success) {
+		dedup_load_done(ctx, -EIO);
+		return;
+	}
+
+	num_chunks = spdk_min(DEDUP_LOAD_CHUNKS, dedup->map_chunks - ctx->next_map_chunk);
+	lba = ctx->next_map_chunk * dedup->entries_per_page;
+	count = spdk_min(num_chunks * dedup->entries_per_page, dedup->sb.num_logical_chunks - lba);
+	if (dedup_index_map_restore(dedup->index, lba, count, ctx->buf) != 0) {
+		SPDK_ERRLOG("%s: map refers to chunks out of range\n", ctx->name->vbdev_name);
+		dedup_load_done(ctx, -EINVAL);
+		return;
+	}
+
+	ctx->next_map_chunk += num_chunks;
+	dedup_load_map(ctx);
+}
+
+static void
+dedup_load_map(struct dedup_load_ctx *ctx)
+{
+	struct vbdev_dedup *dedup = ctx->dedup;
+	uint64_t num_chunks, offset;
+	int rc;
+
+	if (ctx->next_map_chunk == dedup->map_chunks) {
+		dedup_index_restore_done(dedup->index);
+		dedup_load_done(ctx, 0);
+		return;
+	}
+
+	num_chunks = spdk_min(DEDUP_LOAD_CHUNKS, dedup->map_chunks - ctx->next_map_chunk);
+	offset = (dedup->sb.map_offset + ctx->next_map_chunk) * dedup->chunk_blocks;
+	rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->md_ch, ctx->buf, offset,
+				   num_chunks * dedup->chunk_blocks, dedup_load_map_done, ctx);
+	if (rc != 0) {
+		dedup_load_done(ctx, rc);
+	}
+}
+
+static inline uint64_t
+dedup_map_chunks(uint64_t num_logical_chunks, uint32_t chunk_size)
+{
+	return spdk_divide_round_up(num_logical_chunks * sizeof(uint32_t), chunk_size);
+}
+
+static bool
+dedup_chunk_size_valid(uint32_t chunk_size, uint32_t blocklen)
+{
+	return spdk_u32_is_pow2(chunk_size) && chunk_size >= DEDUP_MIN_CHUNK_SIZE &&
+	       chunk_size <= DEDUP_MAX_CHUNK_SIZE && chunk_size >= blocklen &&
+	       chunk_size % blocklen == 0;
+}
+
+static int
+dedup_sb_validate(struct vbdev_dedup *dedup, const struct dedup_sb *sb)
+{
+	struct spdk_bdev *bdev = dedup->base_bdev;
+	uint64_t map_chunks = dedup_map_chunks(sb->num_logical_chunks, sb->chunk_size);
+
+	if (sb->version != DEDUP_SB_VERSION) {
+		SPDK_ERRLOG("unsupported dedup metadata version %u\n", sb->version);
+		return -ENOTSUP;
+	}
+
+	if (!dedup_chunk_size_valid(sb->chunk_size, bdev->blocklen) ||
+	    sb->num_logical_chunks == 0 || sb->num_physical_chunks == 0 ||
+	    sb->num_physical_chunks > DEDUP_MAX_CHUNKS || sb->map_offset != 1 ||
+	    sb->data_offset != sb->map_offset + map_chunks ||
+	    (sb->data_offset + sb->num_physical_chunks) * (sb->chunk_size / bdev->blocklen) >
+	    bdev->blockcnt) {
+		SPDK_ERRLOG("dedup metadata on %s is inconsistent\n", bdev->name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Lay out a new dedup bdev on the whole base bdev */
+static int
+dedup_sb_init(struct vbdev_dedup *dedup, struct dedup_sb *sb)
+{
+	uint64_t base_chunks, num_logical, map_chunks, num_physical;
+	uint32_t chunk_size = dedup->chunk_size;
+
+	base_chunks = dedup->base_bdev->blockcnt / dedup->chunk_blocks;
+	if (base_chunks < 3) {
+		return -ENOSPC;
+	}
+
+	if (dedup->opts.logical_size_mb != 0) {
+		num_logical = dedup->opts.logical_size_mb * 1024 * 1024 / chunk_size;
+	} else {
+		/* As many blocks as there are data chunks left once the map is stored */
+		num_logical = (base_chunks - 1) * chunk_size / (chunk_size + sizeof(uint32_t));
+	}
+	map_chunks = dedup_map_chunks(num_logical, chunk_size);
+	if (num_logical == 0 || 1 + map_chunks >= base_chunks) {
+		return -ENOSPC;
+	}
+	num_physical = spdk_min(base_chunks - 1 - map_chunks, DEDUP_MAX_CHUNKS);
+
+	memset(sb, 0, sizeof(*sb));
+	memcpy(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = DEDUP_SB_VERSION;
+	sb->chunk_size = chunk_size;
+	sb->num_logical_chunks = num_logical;
+	sb->num_physical_chunks = num_physical;
+	sb->map_offset = 1;
+	sb->data_offset = 1 + map_chunks;
+	spdk_uuid_generate(&sb->uuid);
+
+	return 0;
+}
+
+/* Geometry shared by new and loaded dedup bdevs, once the superblock is known */
+static int
+dedup_setup(struct dedup_load_ctx *ctx)
+{
+	struct vbdev_dedup *dedup = ctx->dedup;
+
+	dedup->chunk_size = dedup->sb.chunk_size;
+	dedup->chunk_blocks = dedup->chunk_size / dedup->base_bdev->blocklen;
+	dedup->map_chunks = dedup->sb.data_offset - dedup->sb.map_offset;
+	dedup->entries_per_page = dedup->chunk_size / sizeof(uint32_t);
+
+	/* Report what's on disk, so the saved configuration loads it again */
+	dedup->opts.chunk_size = dedup->chunk_size;
+	ctx->name->opts.chunk_size = dedup->chunk_size;
+
+	dedup->index = dedup_index_create(dedup->sb.num_logical_chunks,
+					  dedup->sb.num_physical_chunks);
+	if (dedup->index == NULL) {
+		return -ENOMEM;
+	}
+
+	/* Room to read the map in batches, the superblock was copied out already */
+	spdk_dma_free(ctx->buf);
+	ctx->buf = spdk_dma_zmalloc((size_t)DEDUP_LOAD_CHUNKS * dedup->chunk_size,
+				    spdk_bdev_get_buf_align(dedup->base_bdev), NULL);
+	if (ctx->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+dedup_format_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_load_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	dedup_load_done(ctx, success ? 0 : -EIO);
+}
+
+static void
+dedup_format_map_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_load_ctx *ctx = cb_arg;
+	struct vbdev_dedup *dedup = ctx->dedup;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+	if (!success) {
+		dedup_load_done(ctx, -EIO);
+		return;
+	}
+
+	/* The superblock goes last, a format cut short leaves no dedup bdev behind */
+	memset(ctx->buf, 0, dedup->chunk_size);
+	memcpy(ctx->buf, &dedup->sb, sizeof(dedup->sb));
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->md_ch, ctx->buf, 0,
+				    dedup->chunk_blocks, dedup_format_sb_done, ctx);
+	if (rc != 0) {
+		dedup_load_done(ctx, rc);
+	}
+}
+
+static void
+dedup_load_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_load_ctx *ctx = cb_arg;
+	struct vbdev_dedup *dedup = ctx->dedup;
+	const struct dedup_sb *sb = ctx->buf;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+	if (!success) {
+		dedup_load_done(ctx, -EIO);
+		return;
+	}
+
+	if (memcmp(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature)) == 0) {
+		rc = dedup_sb_validate(dedup, sb);
+		if (rc == 0) {
+			dedup->sb = *sb;
+			ctx->loaded = true;
+			rc = dedup_setup(ctx);
+		}
+		if (rc != 0) {
+			dedup_load_done(ctx, rc);
+			return;
+		}
+
+		if (dedup->opts.logical_size_mb != 0 &&
+		    dedup->opts.logical_size_mb * 1024 * 1024 / dedup->chunk_size !=
+		    dedup->sb.num_logical_chunks) {
+			SPDK_NOTICELOG("%s: keeping the size of the existing dedup bdev\n",
+				       ctx->name->vbdev_name);
+		}
+
+		dedup_load_map(ctx);
+		return;
+	}
+
+	rc = dedup_sb_init(dedup, &dedup->sb);
+	if (rc == 0) {
+		rc = dedup_setup(ctx);
+	}
+	if (rc != 0) {
+		dedup_load_done(ctx, rc);
+		return;
+	}
+
+	rc = spdk_bdev_write_zeroes_blocks(dedup->base_desc, dedup->md_ch,
+					   dedup->sb.map_offset * dedup->chunk_blocks,
+					   dedup->map_chunks * dedup->chunk_blocks,
+					   dedup_format_map_done, ctx);
+	if (rc != 0) {
+		dedup_load_done(ctx, rc);
+	}
+}
+
+static int
+vbdev_dedup_load(struct bdev_dedup_names *name, bool examine, vbdev_dedup_create_cb cb_fn,
+		 void *cb_arg)
+{
+	struct dedup_load_ctx *ctx;
+	struct vbdev_dedup *dedup;
+	struct spdk_bdev *bdev;
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx));
+	dedup = calloc(1, sizeof(struct vbdev_dedup));
+	if (!ctx || !dedup) {
+		SPDK_ERRLOG("could not allocate dedup node\n");
+		free(ctx);
+		free(dedup);
+		return -ENOMEM;
+	}
+
+	ctx->name = name;
+	ctx->dedup = dedup;
+	ctx->examine = examine;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	TAILQ_INIT(&dedup->free_map_writes);
+	dedup->dedup_bdev.name = strdup(name->vbdev_name);
+	if (!dedup->dedup_bdev.name) {
+		SPDK_ERRLOG("could not allocate dedup bdev name\n");
+		rc = -ENOMEM;
+		goto err_free;
+	}
+	dedup->dedup_bdev.product_name = "dedup";
+	dedup->opts = name->opts;
+
+	rc = spdk_bdev_open_ext(name->bdev_name, true, vbdev_dedup_base_bdev_event_cb,
+				NULL, &dedup->base_desc);
+	if (rc) {
+		if (rc != -ENODEV) {
+			SPDK_ERRLOG("could not open bdev %s\n", name->bdev_name);
+		}
+		goto err_free;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(dedup->base_desc);
+	dedup->base_bdev = bdev;
+
+	if (bdev->md_len != 0) {
+		SPDK_ERRLOG("dedup bdev %s: base bdev %s has metadata, which is not supported\n",
+			    name->vbdev_name, name->bdev_name);
+		rc = -ENOTSUP;
+		goto err_close;
+	}
+
+	/* The superblock fits in the smallest chunk, read it with the requested
+	 * size even if the bdev was created with another one.
+	 */
+	if (!dedup_chunk_size_valid(dedup->opts.chunk_size, bdev->blocklen)) {
+		SPDK_ERRLOG("dedup bdev %s: chunk size %u doesn't fit block size %u of %s\n",
+			    name->vbdev_name, dedup->opts.chunk_size, bdev->blocklen,
+			    name->bdev_name);
+		rc = -EINVAL;
+		goto err_close;
+	}
+	dedup->chunk_size = dedup->opts.chunk_size;
+	dedup->chunk_blocks = dedup->chunk_size / bdev->blocklen;
+
+	ctx->buf = spdk_dma_zmalloc(dedup->chunk_size, spdk_bdev_get_buf_align(bdev), NULL);
+	if (!ctx->buf) {
+		rc = -ENOMEM;
+		goto err_close;
+	}
+
+	dedup->thread = spdk_get_thread();
+
+	rc = spdk_bdev_module_claim_bdev(bdev, dedup->base_desc, &dedup_if);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name->bdev_name);
+		goto err_close;
+	}
+
+	dedup->md_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	if (!dedup->md_ch) {
+		rc = -ENOMEM;
+		goto err_release;
+	}
+
+	rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->md_ch, ctx->buf, 0, dedup->chunk_blocks,
+				   dedup_load_sb_done, ctx);
+	if (rc) {
+		spdk_put_io_channel(dedup->md_ch);
+		goto err_release;
+	}
+
+	return 0;
+
+err_release:
+	spdk_bdev_module_release_bdev(bdev);
+err_close:
+	spdk_bdev_close(dedup->base_desc);
+err_free:
+	spdk_dma_free(ctx->buf);
+	free(dedup->dedup_bdev.name);
+	free(dedup);
+	free(ctx);
+	return rc;
+}
+
+void
+bdev_dedup_create_disk(const char *bdev_name, const char *vbdev_name,
+		       const struct vbdev_dedup_opts *opts, vbdev_dedup_create_cb cb_fn,
+		       void *cb_arg)
+{
+	struct bdev_dedup_names *name;
+	int rc;
+
+	if (vbdev_dedup_fingerprint_str(opts->fingerprint) == NULL) {
+		SPDK_ERRLOG("dedup fingerprint %d is not supported\n", opts->fingerprint);
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	rc = vbdev_dedup_insert_name(bdev_name, vbdev_name, opts, &name);
+	if (rc) {
+		cb_fn(cb_arg, rc);
+		return;
+	}
+
+	rc = vbdev_dedup_load(name, false, cb_fn, cb_arg);
+	if (rc == -ENODEV) {
+		/* This is not an error, we tracked the name above and it still
+		 * may show up later.
+		 */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		cb_fn(cb_arg, 0);
+	} else if (rc) {
+		vbdev_dedup_free_name(name);
+		cb_fn(cb_arg, rc);
+	}
+}
+
+void
+bdev_dedup_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_dedup_names *name;
+
+	if (!bdev || bdev->module != &dedup_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	/* Remove the association (vbdev, bdev) so that the vbdev does not get
+	 * re-created if the same bdev is constructed at some other time.
+	 */
+	TAILQ_FOREACH(name, &g_bdev_dedup_names, link) {
+		if (strcmp(name->vbdev_name, bdev->name) == 0) {
+			vbdev_dedup_free_name(name);
+			break;
+		}
+	}
+
+	spdk_bdev_unregister(bdev, cb_fn, cb_arg);
+}
+
+struct dedup_get_stats_ctx {
+	struct vbdev_dedup_stats	stats;
+	vbdev_dedup_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+dedup_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct dedup_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct dedup_io_channel *dedup_ch = spdk_io_channel_get_ctx(ch);
+
+	ctx->stats.write_chunks += dedup_ch->stats.write_chunks;
+	ctx->stats.duplicate_chunks += dedup_ch->stats.duplicate_chunks;
+	ctx->stats.verify_reads += dedup_ch->stats.verify_reads;
+	ctx->stats.verify_mismatches += dedup_ch->stats.verify_mismatches;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+dedup_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct dedup_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct vbdev_dedup *dedup = spdk_io_channel_iter_get_io_device(i);
+	struct dedup_index_stats index_stats;
+
+	dedup_index_get_stats(dedup->index, &index_stats);
+	ctx->stats.num_logical_chunks = index_stats.num_logical_chunks;
+	ctx->stats.num_physical_chunks = index_stats.num_physical_chunks;
+	ctx->stats.mapped_chunks = index_stats.mapped_chunks;
+	ctx->stats.used_chunks = index_stats.used_chunks;
+	ctx->stats.indexed_chunks = index_stats.indexed_chunks;
+	ctx->stats.index_memory_bytes = index_stats.memory_bytes;
+
+	ctx->cb_fn(ctx->cb_arg, status, &ctx->stats);
+	free(ctx);
+}
+
+void
+bdev_dedup_get_stats(struct spdk_bdev *bdev, vbdev_dedup_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct dedup_get_stats_ctx *ctx;
+
+	if (!bdev || bdev->module != &dedup_if) {
+		cb_fn(cb_arg, -ENODEV, NULL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(bdev->ctxt, dedup_get_stats_channel, ctx, dedup_get_stats_done);
+}
+
+static void
+vbdev_dedup_examine(struct spdk_bdev *bdev)
+{
+	struct bdev_dedup_names *name;
+
+	/* Only one dedup bdev can claim the base bdev */
+	TAILQ_FOREACH(name, &g_bdev_dedup_names, link) {
+		if (strcmp(name->bdev_name, bdev->name) == 0 &&
+		    vbdev_dedup_load(name, true, NULL, NULL) == 0) {
+			return;
+		}
+	}
+
+	spdk_bdev_module_examine_done(&dedup_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_dedup)
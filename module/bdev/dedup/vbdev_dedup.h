@@ -0,0 +1,117 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPDK_VBDEV_DEDUP_H
+#define SPDK_VBDEV_DEDUP_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+#define VBDEV_DEDUP_DEFAULT_CHUNK_SIZE	4096
+
+enum vbdev_dedup_fingerprint {
+	/* SHA-256 on the CPU, trusted without comparing the data */
+	VBDEV_DEDUP_FP_SHA256,
+	/* CRC-32C through the accel framework, matches are verified against the stored data */
+	VBDEV_DEDUP_FP_CRC32C,
+};
+
+struct vbdev_dedup_opts {
+	/* Block size of the dedup bdev, the unit of deduplication */
+	uint32_t			chunk_size;
+	/* Size of the dedup bdev, 0 to match the space available for data on the base bdev */
+	uint64_t			logical_size_mb;
+	enum vbdev_dedup_fingerprint	fingerprint;
+};
+
+struct vbdev_dedup_stats {
+	/* Size and usage of the metadata, see struct dedup_index_stats */
+	uint64_t	num_logical_chunks;
+	uint64_t	num_physical_chunks;
+	uint64_t	mapped_chunks;
+	uint64_t	used_chunks;
+	uint64_t	indexed_chunks;
+	uint64_t	index_memory_bytes;
+	/* Chunks written and how many of them were found to be duplicates */
+	uint64_t	write_chunks;
+	uint64_t	duplicate_chunks;
+	/* CRC-32C matches read back to compare and how many of them differed */
+	uint64_t	verify_reads;
+	uint64_t	verify_mismatches;
+};
+
+typedef void (*vbdev_dedup_create_cb)(void *cb_arg, int rc);
+typedef void (*vbdev_dedup_get_stats_cb)(void *cb_arg, int rc,
+		const struct vbdev_dedup_stats *stats);
+
+const char *vbdev_dedup_fingerprint_str(enum vbdev_dedup_fingerprint fingerprint);
+int vbdev_dedup_fingerprint_parse(const char *str, enum vbdev_dedup_fingerprint *fingerprint);
+
+/**
+ * Create new dedup bdev.
+ *
+ * If the base bdev already holds a dedup bdev, its metadata is loaded and the
+ * size options are ignored.  Otherwise the base bdev is formatted.
+ *
+ * \param bdev_name Bdev on which dedup vbdev will be created.
+ * \param vbdev_name Name of the dedup bdev.
+ * \param opts Dedup options.
+ * \param cb_fn Function to call once the dedup bdev is registered, or
+ * immediately if the base bdev doesn't exist yet.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_dedup_create_disk(const char *bdev_name, const char *vbdev_name,
+			    const struct vbdev_dedup_opts *opts, vbdev_dedup_create_cb cb_fn,
+			    void *cb_arg);
+
+/**
+ * Delete dedup bdev.  Its metadata stays on the base bdev.
+ *
+ * \param bdev Pointer to dedup bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_dedup_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+/**
+ * Collect dedup statistics of a dedup bdev.
+ *
+ * \param bdev Pointer to dedup bdev.
+ * \param cb_fn Function to call with the statistics.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_dedup_get_stats(struct spdk_bdev *bdev, vbdev_dedup_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_DEDUP_H */
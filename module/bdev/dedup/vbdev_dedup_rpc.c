@@ -0,0 +1,254 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "vbdev_dedup.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_bdev_dedup_create {
+	char *base_bdev_name;
+	char *name;
+	struct vbdev_dedup_opts opts;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+free_rpc_bdev_dedup_create(struct rpc_bdev_dedup_create *r)
+{
+	free(r->base_bdev_name);
+	free(r->name);
+	free(r);
+}
+
+static int
+decode_fingerprint(const struct spdk_json_val *val, void *out)
+{
+	enum vbdev_dedup_fingerprint *fingerprint = out;
+	char *str = NULL;
+	int rc;
+
+	rc = spdk_json_decode_string(val, &str);
+	if (rc == 0) {
+		rc = vbdev_dedup_fingerprint_parse(str, fingerprint);
+		free(str);
+	}
+
+	return rc;
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_dedup_create_decoders[] = {
+	{"base_bdev_name", offsetof(struct rpc_bdev_dedup_create, base_bdev_name), spdk_json_decode_string},
+	{"name", offsetof(struct rpc_bdev_dedup_create, name), spdk_json_decode_string},
+	{"chunk_size", offsetof(struct rpc_bdev_dedup_create, opts.chunk_size), spdk_json_decode_uint32, true},
+	{"logical_size_mb", offsetof(struct rpc_bdev_dedup_create, opts.logical_size_mb), spdk_json_decode_uint64, true},
+	{"fingerprint", offsetof(struct rpc_bdev_dedup_create, opts.fingerprint), decode_fingerprint, true},
+};
+
+static void
+rpc_bdev_dedup_create_cb(void *cb_arg, int rc)
+{
+	struct rpc_bdev_dedup_create *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+	} else {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, req->name);
+		spdk_jsonrpc_end_result(req->request, w);
+	}
+
+	free_rpc_bdev_dedup_create(req);
+}
+
+static void
+rpc_bdev_dedup_create(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_create *req;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	req->request = request;
+	req->opts.chunk_size = VBDEV_DEDUP_DEFAULT_CHUNK_SIZE;
+	req->opts.fingerprint = VBDEV_DEDUP_FP_SHA256;
+
+	if (spdk_json_decode_object(params, rpc_bdev_dedup_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_dedup_create_decoders),
+				    req)) {
+		SPDK_DEBUGLOG(vbdev_dedup, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		free_rpc_bdev_dedup_create(req);
+		return;
+	}
+
+	/* Formatting or loading the base bdev reads and writes it, reply once done */
+	bdev_dedup_create_disk(req->base_bdev_name, req->name, &req->opts,
+			       rpc_bdev_dedup_create_cb, req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_create", rpc_bdev_dedup_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_dedup_name {
+	char *name;
+};
+
+static void
+free_rpc_bdev_dedup_name(struct rpc_bdev_dedup_name *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_dedup_name_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_dedup_name, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_dedup_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	spdk_jsonrpc_send_bool_response(request, bdeverrno == 0);
+}
+
+static void
+rpc_bdev_dedup_delete(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_name req = {NULL};
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_dedup_name_decoders,
+				    SPDK_COUNTOF(rpc_bdev_dedup_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	bdev_dedup_delete_disk(bdev, rpc_bdev_dedup_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_dedup_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_delete", rpc_bdev_dedup_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_dedup_get_stats_ctx {
+	struct spdk_jsonrpc_request	*request;
+	struct spdk_bdev		*bdev;
+};
+
+static void
+rpc_bdev_dedup_get_stats_cb(void *cb_arg, int rc, const struct vbdev_dedup_stats *stats)
+{
+	struct rpc_bdev_dedup_get_stats_ctx *ctx = cb_arg;
+	struct spdk_json_write_ctx *w;
+	char ratio[32];
+	int len;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+		free(ctx);
+		return;
+	}
+
+	/* Blocks holding data per chunk storing it */
+	len = snprintf(ratio, sizeof(ratio), "%.2f", stats->used_chunks == 0 ? 1.0 :
+		       (double)stats->mapped_chunks / stats->used_chunks);
+
+	w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(ctx->bdev));
+	spdk_json_write_named_uint64(w, "num_logical_chunks", stats->num_logical_chunks);
+	spdk_json_write_named_uint64(w, "num_physical_chunks", stats->num_physical_chunks);
+	spdk_json_write_named_uint64(w, "mapped_chunks", stats->mapped_chunks);
+	spdk_json_write_named_uint64(w, "used_chunks", stats->used_chunks);
+	spdk_json_write_named_uint64(w, "indexed_chunks", stats->indexed_chunks);
+	spdk_json_write_name(w, "dedup_ratio");
+	spdk_json_write_val_raw(w, ratio, len);
+	spdk_json_write_named_uint64(w, "index_memory_bytes", stats->index_memory_bytes);
+	spdk_json_write_named_uint64(w, "write_chunks", stats->write_chunks);
+	spdk_json_write_named_uint64(w, "duplicate_chunks", stats->duplicate_chunks);
+	spdk_json_write_named_uint64(w, "verify_reads", stats->verify_reads);
+	spdk_json_write_named_uint64(w, "verify_mismatches", stats->verify_mismatches);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(ctx->request, w);
+
+	free(ctx);
+}
+
+static void
+rpc_bdev_dedup_get_stats(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_name req = {NULL};
+	struct rpc_bdev_dedup_get_stats_ctx *ctx;
+	struct spdk_bdev *bdev;
+
+	if (spdk_json_decode_object(params, rpc_bdev_dedup_name_decoders,
+				    SPDK_COUNTOF(rpc_bdev_dedup_name_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+	ctx->request = request;
+	ctx->bdev = bdev;
+
+	bdev_dedup_get_stats(bdev, rpc_bdev_dedup_get_stats_cb, ctx);
+
+cleanup:
+	free_rpc_bdev_dedup_name(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_get_stats", rpc_bdev_dedup_get_stats, SPDK_RPC_RUNTIME)
@@ -458,9 +458,11 @@ vbdev_delay_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
 	struct vbdev_delay *delay_node = (struct vbdev_delay *)ctx;
 
-	if (io_type == SPDK_BDEV_IO_TYPE_ZCOPY) {
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+	case SPDK_BDEV_IO_TYPE_COPY:
 		return false;
-	} else {
+	default:
 		return spdk_bdev_io_type_supported(delay_node->base_bdev, io_type);
 	}
 }
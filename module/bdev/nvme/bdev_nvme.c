@@ -111,6 +111,19 @@ struct nvme_bdev_io {
 
 	/* How many times the current I/O was retried. */
 	int32_t retry_count;
+
+	/** Whether the I/O is counted in the statistics of io_path. */
+	bool io_path_tracked;
+
+	/** Tick count when the I/O was submitted to io_path. */
+	uint64_t submit_tsc;
+
+	/** Owner of the shared qpair the I/O was passed to, if any. */
+	struct nvme_ctrlr_channel *shared_ctrlr_ch;
+
+	/** Status of the I/O completed on the shared qpair for the submitting thread. */
+	int shared_rc;
+	bool shared_has_cpl;
 };
 
 struct nvme_probe_skip_entry {
@@ -136,6 +149,8 @@ static struct spdk_bdev_nvme_opts g_opts = {
 	.io_queue_requests = 0,
 	.delay_cmd_submit = SPDK_BDEV_NVME_DEFAULT_DELAY_CMD_SUBMIT,
 	.bdev_retry_count = 0,
+	.io_qpair_share_threads = 0,
+	.io_qpair_promote_iops = 0,
 };
 
 #define NVME_HOTPLUG_POLL_PERIOD_MAX			10000000ULL
@@ -635,6 +650,8 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&nbdev_ch->retry_io_list);
 
 	pthread_mutex_lock(&nbdev->mutex);
+	nbdev_ch->mp_policy = nbdev->mp_policy;
+
 	TAILQ_FOREACH(nvme_ns, &nbdev->nvme_ns_list, tailq) {
 		rc = _bdev_nvme_add_io_path(nbdev_ch, nvme_ns);
 		if (rc != 0) {
@@ -704,10 +721,33 @@ nvme_ns_is_accessible(struct nvme_ns *nvme_ns)
 	return false;
 }
 
+static inline struct spdk_nvme_qpair *
+nvme_ctrlr_channel_get_qpair(struct nvme_ctrlr_channel *ctrlr_ch)
+{
+	if (spdk_unlikely(ctrlr_ch->shared_qpair != NULL)) {
+		return ctrlr_ch->shared_qpair->owner_ch->qpair;
+	}
+
+	return ctrlr_ch->qpair;
+}
+
+/* Return the qpair to submit the NVMe commands of the I/O to. An I/O passed to a shared
+ * qpair stays on it even if the submitting channel was promoted meanwhile.
+ */
+static inline struct spdk_nvme_qpair *
+bdev_nvme_io_get_qpair(struct nvme_bdev_io *bio)
+{
+	if (spdk_unlikely(bio->shared_ctrlr_ch != NULL)) {
+		return bio->shared_ctrlr_ch->qpair;
+	}
+
+	return bio->io_path->ctrlr_ch->qpair;
+}
+
 static inline bool
 nvme_io_path_is_connected(struct nvme_io_path *io_path)
 {
-	return io_path->ctrlr_ch->qpair != NULL;
+	return nvme_ctrlr_channel_get_qpair(io_path->ctrlr_ch) != NULL;
 }
 
 static inline bool
@@ -768,15 +808,11 @@ nvme_ctrlr_is_available(struct nvme_ctrlr *nvme_ctrlr)
 	return true;
 }
 
-static inline struct nvme_io_path *
-bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
+static struct nvme_io_path *
+_bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 {
 	struct nvme_io_path *io_path, *non_optimized = NULL;
 
-	if (spdk_likely(nbdev_ch->current_io_path != NULL)) {
-		return nbdev_ch->current_io_path;
-	}
-
 	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
 		if (spdk_unlikely(!nvme_io_path_is_connected(io_path))) {
 			/* The device is currently resetting. */
@@ -804,6 +840,157 @@ bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 	return non_optimized;
 }
 
+/* Larger than any latency in ticks, so that paths without any sample get I/Os first. */
+#define NVME_IO_PATH_LATENCY_WEIGHT_SCALE	(1ULL << 32)
+
+static inline int64_t
+nvme_io_path_latency_weight(struct nvme_io_path *io_path)
+{
+	return NVME_IO_PATH_LATENCY_WEIGHT_SCALE / spdk_max(io_path->avg_latency_ticks, 1);
+}
+
+/* Choose one of the available paths in the specified ANA state by the multipath policy.
+ * The search starts after the last chosen path so that ties are broken in turn.
+ */
+static struct nvme_io_path *
+_bdev_nvme_find_io_path_active_active(struct nvme_bdev_channel *nbdev_ch,
+				      enum spdk_nvme_ana_state ana_state)
+{
+	struct nvme_io_path *start = NULL, *io_path, *best = NULL;
+	int64_t total_weight = 0, weight;
+
+	if (nbdev_ch->current_io_path != NULL) {
+		start = STAILQ_NEXT(nbdev_ch->current_io_path, stailq);
+	}
+	if (start == NULL) {
+		start = STAILQ_FIRST(&nbdev_ch->io_path_list);
+	}
+
+	io_path = start;
+	do {
+		if (nvme_io_path_is_available(io_path) &&
+		    io_path->nvme_ns->ana_state == ana_state) {
+			switch (nbdev_ch->mp_policy) {
+			case BDEV_NVME_MP_POLICY_QUEUE_DEPTH:
+				if (best == NULL ||
+				    io_path->io_outstanding < best->io_outstanding) {
+					best = io_path;
+				}
+				break;
+			case BDEV_NVME_MP_POLICY_LATENCY:
+				/* Smooth weighted round robin. */
+				weight = nvme_io_path_latency_weight(io_path);
+				io_path->lat_credit += weight;
+				total_weight += weight;
+				if (best == NULL || io_path->lat_credit > best->lat_credit) {
+					best = io_path;
+				}
+				break;
+			default:
+				return io_path;
+			}
+		}
+
+		io_path = STAILQ_NEXT(io_path, stailq);
+		if (io_path == NULL) {
+			io_path = STAILQ_FIRST(&nbdev_ch->io_path_list);
+		}
+	} while (io_path != start);
+
+	if (best != NULL) {
+		best->lat_credit -= total_weight;
+	}
+
+	return best;
+}
+
+static struct nvme_io_path *
+bdev_nvme_find_io_path_active_active(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_io_path *io_path;
+
+	if (spdk_unlikely(STAILQ_EMPTY(&nbdev_ch->io_path_list))) {
+		return NULL;
+	}
+
+	io_path = _bdev_nvme_find_io_path_active_active(nbdev_ch, SPDK_NVME_ANA_OPTIMIZED_STATE);
+	if (io_path == NULL) {
+		io_path = _bdev_nvme_find_io_path_active_active(nbdev_ch,
+				SPDK_NVME_ANA_NON_OPTIMIZED_STATE);
+	}
+
+	if (io_path != NULL) {
+		nbdev_ch->current_io_path = io_path;
+	}
+
+	return io_path;
+}
+
+static inline struct nvme_io_path *
+bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
+{
+	if (spdk_unlikely(nbdev_ch->mp_policy != BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE)) {
+		return bdev_nvme_find_io_path_active_active(nbdev_ch);
+	}
+
+	if (spdk_likely(nbdev_ch->current_io_path != NULL)) {
+		return nbdev_ch->current_io_path;
+	}
+
+	return _bdev_nvme_find_io_path(nbdev_ch);
+}
+
+static inline void
+nvme_io_path_start_io(struct nvme_bdev_io *bio)
+{
+	bio->io_path->io_outstanding++;
+	bio->submit_tsc = spdk_get_ticks();
+	bio->io_path_tracked = true;
+}
+
+static inline void
+nvme_io_path_end_io(struct nvme_bdev_io *bio, bool success)
+{
+	struct nvme_io_path *io_path = bio->io_path;
+	struct spdk_bdev_io *bdev_io;
+	uint64_t ticks;
+
+	if (!bio->io_path_tracked) {
+		return;
+	}
+
+	bio->io_path_tracked = false;
+
+	assert(io_path->io_outstanding > 0);
+	io_path->io_outstanding--;
+
+	if (!success) {
+		return;
+	}
+
+	ticks = spdk_get_ticks() - bio->submit_tsc;
+
+	io_path->num_ios++;
+	io_path->latency_ticks += ticks;
+	if (io_path->avg_latency_ticks == 0) {
+		io_path->avg_latency_ticks = ticks;
+	} else {
+		io_path->avg_latency_ticks = (io_path->avg_latency_ticks * 7 + ticks) / 8;
+	}
+
+	bdev_io = spdk_bdev_io_from_ctx(bio);
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_COMPARE:
+	case SPDK_BDEV_IO_TYPE_ZONE_APPEND:
+		io_path->bytes += bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+		break;
+	default:
+		break;
+	}
+}
+
 /* Return true if there is any io_path whose qpair is active or ctrlr is not failed,
  * or false otherwise.
  *
@@ -910,6 +1097,18 @@ bdev_nvme_queue_retry_io(struct nvme_bdev_channel *nbdev_ch,
 				    delay_ms * 1000ULL);
 }
 
+static void bdev_nvme_shared_qpair_io_done(void *ctx);
+
+/* Complete an I/O submitted to a shared qpair on the thread which submitted it. */
+static void
+bdev_nvme_shared_qpair_io_forward(struct nvme_bdev_io *bio)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	struct spdk_io_channel *ch = spdk_bdev_io_get_io_channel(bdev_io);
+
+	spdk_thread_send_msg(spdk_io_channel_get_thread(ch), bdev_nvme_shared_qpair_io_done, bio);
+}
+
 static inline void
 bdev_nvme_io_complete_nvme_status(struct nvme_bdev_io *bio,
 				  const struct spdk_nvme_cpl *cpl)
@@ -922,6 +1121,15 @@ bdev_nvme_io_complete_nvme_status(struct nvme_bdev_io *bio,
 
 	assert(!bdev_nvme_io_type_is_admin(bdev_io->type));
 
+	if (spdk_unlikely(bio->shared_ctrlr_ch != NULL)) {
+		bio->cpl = *cpl;
+		bio->shared_has_cpl = true;
+		bdev_nvme_shared_qpair_io_forward(bio);
+		return;
+	}
+
+	nvme_io_path_end_io(bio, spdk_nvme_cpl_is_success(cpl));
+
 	if (spdk_likely(spdk_nvme_cpl_is_success(cpl))) {
 		goto complete;
 	}
@@ -977,6 +1185,15 @@ bdev_nvme_io_complete(struct nvme_bdev_io *bio, int rc)
 	struct nvme_bdev_channel *nbdev_ch;
 	enum spdk_bdev_io_status io_status;
 
+	if (spdk_unlikely(bio->shared_ctrlr_ch != NULL)) {
+		bio->shared_rc = rc;
+		bio->shared_has_cpl = false;
+		bdev_nvme_shared_qpair_io_forward(bio);
+		return;
+	}
+
+	nvme_io_path_end_io(bio, rc == 0);
+
 	switch (rc) {
 	case 0:
 		io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
@@ -1004,6 +1221,20 @@ bdev_nvme_io_complete(struct nvme_bdev_io *bio, int rc)
 	spdk_bdev_io_complete(bdev_io, io_status);
 }
 
+static void
+bdev_nvme_shared_qpair_io_done(void *ctx)
+{
+	struct nvme_bdev_io *bio = ctx;
+
+	bio->shared_ctrlr_ch = NULL;
+
+	if (bio->shared_has_cpl) {
+		bdev_nvme_io_complete_nvme_status(bio, &bio->cpl);
+	} else {
+		bdev_nvme_io_complete(bio, bio->shared_rc);
+	}
+}
+
 static inline void
 bdev_nvme_admin_passthru_complete(struct nvme_bdev_io *bio, int rc)
 {
@@ -1092,11 +1323,18 @@ bdev_nvme_disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_
 	}
 }
 
+static int nvme_poll_group_process_shared_qpairs(struct nvme_poll_group *group);
+
 static int
 bdev_nvme_poll(void *arg)
 {
 	struct nvme_poll_group *group = arg;
 	int64_t num_completions;
+	int num_submissions = 0;
+
+	if (spdk_unlikely(!TAILQ_EMPTY(&group->shared_qpair_list))) {
+		num_submissions = nvme_poll_group_process_shared_qpairs(group);
+	}
 
 	if (group->collect_spin_stat && group->start_ticks == 0) {
 		group->start_ticks = spdk_get_ticks();
@@ -1116,7 +1354,7 @@ bdev_nvme_poll(void *arg)
 		}
 	}
 
-	return num_completions > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+	return (num_completions > 0 || num_submissions > 0) ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
 static int
@@ -1382,9 +1620,12 @@ bdev_nvme_reset_create_qpair(struct spdk_io_channel_iter *i)
 {
 	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
 	struct nvme_ctrlr_channel *ctrlr_ch = spdk_io_channel_get_ctx(_ch);
-	int rc;
+	int rc = 0;
 
-	rc = bdev_nvme_create_qpair(ctrlr_ch);
+	/* The shared qpair is recreated on the channel of its owner thread. */
+	if (ctrlr_ch->shared_qpair == NULL) {
+		rc = bdev_nvme_create_qpair(ctrlr_ch);
+	}
 
 	spdk_for_each_channel_continue(i, rc);
 }
@@ -1538,107 +1779,439 @@ bdev_nvme_reset_io_continue(void *cb_arg, bool success)
 {
 	struct nvme_bdev_io *bio = cb_arg;
 
-	bio->cpl.cdw0 = !success;
+	bio->cpl.cdw0 = !success;
+
+	spdk_thread_send_msg(bio->orig_thread, _bdev_nvme_reset_io_continue, bio);
+}
+
+static int
+_bdev_nvme_reset_io(struct nvme_io_path *io_path, struct nvme_bdev_io *bio)
+{
+	struct nvme_ctrlr_channel *ctrlr_ch = io_path->ctrlr_ch;
+	struct nvme_ctrlr *nvme_ctrlr;
+	struct spdk_bdev_io *bdev_io;
+	int rc;
+
+	nvme_ctrlr = nvme_ctrlr_channel_get_ctrlr(ctrlr_ch);
+
+	rc = bdev_nvme_reset(nvme_ctrlr);
+	if (rc == 0) {
+		assert(bio->io_path == NULL);
+		bio->io_path = io_path;
+
+		assert(nvme_ctrlr->reset_cb_fn == NULL);
+		assert(nvme_ctrlr->reset_cb_arg == NULL);
+		nvme_ctrlr->reset_cb_fn = bdev_nvme_reset_io_continue;
+		nvme_ctrlr->reset_cb_arg = bio;
+	} else if (rc == -EBUSY) {
+		/*
+		 * Reset call is queued only if it is from the app framework. This is on purpose so that
+		 * we don't interfere with the app framework reset strategy. i.e. we are deferring to the
+		 * upper level. If they are in the middle of a reset, we won't try to schedule another one.
+		 */
+		bdev_io = spdk_bdev_io_from_ctx(bio);
+		TAILQ_INSERT_TAIL(&ctrlr_ch->pending_resets, bdev_io, module_link);
+	} else {
+		return rc;
+	}
+
+	return 0;
+}
+
+static void
+bdev_nvme_reset_io(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio)
+{
+	struct nvme_io_path *io_path;
+	int rc;
+
+	bio->cpl.cdw0 = 0;
+	bio->orig_thread = spdk_get_thread();
+
+	/* Reset only the first nvme_ctrlr in the nvme_bdev_ctrlr for now.
+	 *
+	 * TODO: Reset all nvme_ctrlrs in the nvme_bdev_ctrlr sequentially.
+	 * This will be done in the following patches.
+	 */
+	io_path = STAILQ_FIRST(&nbdev_ch->io_path_list);
+	assert(io_path != NULL);
+
+	rc = _bdev_nvme_reset_io(io_path, bio);
+	if (rc != 0) {
+		bio->cpl.cdw0 = 1;
+		bdev_nvme_reset_io_complete(bio);
+	}
+}
+
+static int
+bdev_nvme_failover(struct nvme_ctrlr *nvme_ctrlr, bool remove)
+{
+	pthread_mutex_lock(&nvme_ctrlr->mutex);
+	if (nvme_ctrlr->destruct) {
+		pthread_mutex_unlock(&nvme_ctrlr->mutex);
+		/* Don't bother resetting if the controller is in the process of being destructed. */
+		return -ENXIO;
+	}
+
+	if (nvme_ctrlr->resetting) {
+		pthread_mutex_unlock(&nvme_ctrlr->mutex);
+		SPDK_NOTICELOG("Unable to perform reset, already in progress.\n");
+		return -EBUSY;
+	}
+
+	bdev_nvme_failover_trid(nvme_ctrlr, remove);
+
+	nvme_ctrlr->resetting = true;
+
+	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+
+	spdk_thread_send_msg(nvme_ctrlr->thread, _bdev_nvme_reset, nvme_ctrlr);
+	return 0;
+}
+
+static int bdev_nvme_unmap(struct nvme_bdev_io *bio, uint64_t offset_blocks,
+			   uint64_t num_blocks);
+
+static int bdev_nvme_write_zeroes(struct nvme_bdev_io *bio, uint64_t offset_blocks,
+				  uint64_t num_blocks);
+
+static int bdev_nvme_copy(struct nvme_bdev_io *bio, uint64_t dst_offset_blocks,
+			  uint64_t src_offset_blocks, uint64_t num_blocks);
+
+/* Submit the NVMe commands of an I/O to the qpair of its io_path or of its shared qpair. */
+static int
+_bdev_nvme_submit_io(struct nvme_bdev_io *bio)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	struct spdk_bdev *bdev = bdev_io->bdev;
+	int rc;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		rc = bdev_nvme_readv(bio,
+				     bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt,
+				     bdev_io->u.bdev.md_buf,
+				     bdev_io->u.bdev.num_blocks,
+				     bdev_io->u.bdev.offset_blocks,
+				     bdev->dif_check_flags,
+				     bdev_io->internal.ext_opts);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		rc = bdev_nvme_writev(bio,
+				      bdev_io->u.bdev.iovs,
+				      bdev_io->u.bdev.iovcnt,
+				      bdev_io->u.bdev.md_buf,
+				      bdev_io->u.bdev.num_blocks,
+				      bdev_io->u.bdev.offset_blocks,
+				      bdev->dif_check_flags,
+				      bdev_io->internal.ext_opts);
+		break;
+	case SPDK_BDEV_IO_TYPE_COMPARE:
+		rc = bdev_nvme_comparev(bio,
+					bdev_io->u.bdev.iovs,
+					bdev_io->u.bdev.iovcnt,
+					bdev_io->u.bdev.md_buf,
+					bdev_io->u.bdev.num_blocks,
+					bdev_io->u.bdev.offset_blocks,
+					bdev->dif_check_flags);
+		break;
+	case SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE:
+		rc = bdev_nvme_comparev_and_writev(bio,
+						   bdev_io->u.bdev.iovs,
+						   bdev_io->u.bdev.iovcnt,
+						   bdev_io->u.bdev.fused_iovs,
+						   bdev_io->u.bdev.fused_iovcnt,
+						   bdev_io->u.bdev.md_buf,
+						   bdev_io->u.bdev.num_blocks,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev->dif_check_flags);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		rc = bdev_nvme_unmap(bio,
+				     bdev_io->u.bdev.offset_blocks,
+				     bdev_io->u.bdev.num_blocks);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		rc =  bdev_nvme_write_zeroes(bio,
+					     bdev_io->u.bdev.offset_blocks,
+					     bdev_io->u.bdev.num_blocks);
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		rc = bdev_nvme_copy(bio,
+				    bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.copy.src_offset_blocks,
+				    bdev_io->u.bdev.num_blocks);
+		break;
+	case SPDK_BDEV_IO_TYPE_ZONE_APPEND:
+		rc = bdev_nvme_zone_appendv(bio,
+					    bdev_io->u.bdev.iovs,
+					    bdev_io->u.bdev.iovcnt,
+					    bdev_io->u.bdev.md_buf,
+					    bdev_io->u.bdev.num_blocks,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev->dif_check_flags);
+		break;
+	case SPDK_BDEV_IO_TYPE_GET_ZONE_INFO:
+		rc = bdev_nvme_get_zone_info(bio,
+					     bdev_io->u.zone_mgmt.zone_id,
+					     bdev_io->u.zone_mgmt.num_zones,
+					     bdev_io->u.zone_mgmt.buf);
+		break;
+	case SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT:
+		rc = bdev_nvme_zone_management(bio,
+					       bdev_io->u.zone_mgmt.zone_id,
+					       bdev_io->u.zone_mgmt.zone_action);
+		break;
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+		rc = bdev_nvme_io_passthru(bio,
+					   &bdev_io->u.nvme_passthru.cmd,
+					   bdev_io->u.nvme_passthru.buf,
+					   bdev_io->u.nvme_passthru.nbytes);
+		break;
+	case SPDK_BDEV_IO_TYPE_NVME_IO_MD:
+		rc = bdev_nvme_io_passthru_md(bio,
+					      &bdev_io->u.nvme_passthru.cmd,
+					      bdev_io->u.nvme_passthru.buf,
+					      bdev_io->u.nvme_passthru.nbytes,
+					      bdev_io->u.nvme_passthru.md_buf,
+					      bdev_io->u.nvme_passthru.md_len);
+		break;
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	return rc;
+}
+
+#define NVME_SHARED_QPAIR_RING_SIZE	4096
+#define NVME_SHARED_QPAIR_BATCH_SIZE	32
+
+/* Join an existing shared qpair of the ctrlr which has room for one more thread. */
+static bool
+nvme_ctrlr_channel_join_shared_qpair(struct nvme_ctrlr *nvme_ctrlr,
+				     struct nvme_ctrlr_channel *ctrlr_ch)
+{
+	struct nvme_shared_qpair *sq;
+
+	pthread_mutex_lock(&nvme_ctrlr->mutex);
+	TAILQ_FOREACH(sq, &nvme_ctrlr->shared_qpairs, tailq) {
+		/* The owner thread counts as one of the threads. */
+		if (sq->num_members + 1 < g_opts.io_qpair_share_threads) {
+			__atomic_fetch_add(&sq->num_members, 1, __ATOMIC_RELAXED);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+
+	if (sq == NULL) {
+		return false;
+	}
+
+	ctrlr_ch->shared_qpair = sq;
+	ctrlr_ch->shared_num_ios = 0;
+	ctrlr_ch->shared_window_tsc = spdk_get_ticks();
+
+	SPDK_DEBUGLOG(bdev_nvme, "ctrlr_ch %p joined shared qpair %p of ctrlr_ch %p\n",
+		      ctrlr_ch, sq, sq->owner_ch);
+
+	return true;
+}
+
+static void
+nvme_ctrlr_channel_leave_shared_qpair(struct nvme_ctrlr_channel *ctrlr_ch)
+{
+	struct nvme_ctrlr *nvme_ctrlr = nvme_ctrlr_channel_get_ctrlr(ctrlr_ch);
+	struct nvme_shared_qpair *sq = ctrlr_ch->shared_qpair;
+
+	pthread_mutex_lock(&nvme_ctrlr->mutex);
+	assert(sq->num_members > 0);
+	__atomic_fetch_sub(&sq->num_members, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+
+	ctrlr_ch->shared_qpair = NULL;
+}
+
+/* Offer the qpair of ctrlr_ch to the ctrlr_chs of other threads. */
+static void
+nvme_ctrlr_channel_share_qpair(struct nvme_ctrlr *nvme_ctrlr,
+			       struct nvme_ctrlr_channel *ctrlr_ch)
+{
+	struct nvme_shared_qpair *sq;
+	struct spdk_io_channel *ch __attribute__((unused));
+
+	sq = calloc(1, sizeof(*sq));
+	if (sq == NULL) {
+		return;
+	}
+
+	sq->ring = spdk_ring_create(SPDK_RING_TYPE_MP_SC, NVME_SHARED_QPAIR_RING_SIZE,
+				    SPDK_ENV_SOCKET_ID_ANY);
+	if (sq->ring == NULL) {
+		SPDK_ERRLOG("Failed to allocate ring for shared qpair.\n");
+		free(sq);
+		return;
+	}
+
+	sq->owner_ch = ctrlr_ch;
+
+	/* Keep ctrlr_ch, and hence its qpair, alive while any other thread uses it. */
+	ch = spdk_get_io_channel(nvme_ctrlr);
+	assert(ch == spdk_io_channel_from_ctx(ctrlr_ch));
+
+	TAILQ_INSERT_TAIL(&ctrlr_ch->group->shared_qpair_list, sq, group_tailq);
+
+	pthread_mutex_lock(&nvme_ctrlr->mutex);
+	TAILQ_INSERT_TAIL(&nvme_ctrlr->shared_qpairs, sq, tailq);
+	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+}
+
+/* Submit the I/Os other threads put to the shared qpair. Called by the owner thread. */
+static int
+nvme_shared_qpair_process(struct nvme_shared_qpair *sq)
+{
+	void *bios[NVME_SHARED_QPAIR_BATCH_SIZE];
+	struct nvme_bdev_io *bio;
+	size_t count, i;
+	int rc;
+
+	count = spdk_ring_dequeue(sq->ring, bios, NVME_SHARED_QPAIR_BATCH_SIZE);
+
+	for (i = 0; i < count; i++) {
+		bio = bios[i];
+		assert(bio->shared_ctrlr_ch == sq->owner_ch);
+
+		if (spdk_likely(sq->owner_ch->qpair != NULL)) {
+			rc = _bdev_nvme_submit_io(bio);
+		} else {
+			rc = -ENXIO;
+		}
+
+		if (spdk_unlikely(rc != 0)) {
+			bdev_nvme_io_complete(bio, rc);
+		}
+	}
+
+	return count;
+}
+
+/* Free the shared qpair if neither the owner thread nor any other thread uses it anymore. */
+static void
+nvme_shared_qpair_try_release(struct nvme_shared_qpair *sq)
+{
+	struct nvme_ctrlr_channel *ctrlr_ch = sq->owner_ch;
+	struct nvme_ctrlr *nvme_ctrlr = nvme_ctrlr_channel_get_ctrlr(ctrlr_ch);
+
+	pthread_mutex_lock(&nvme_ctrlr->mutex);
+	if (sq->num_members != 0) {
+		pthread_mutex_unlock(&nvme_ctrlr->mutex);
+		return;
+	}
+	TAILQ_REMOVE(&nvme_ctrlr->shared_qpairs, sq, tailq);
+	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+
+	/* Submit the I/Os the last members put before leaving. */
+	while (nvme_shared_qpair_process(sq) != 0) {
+	}
+
+	TAILQ_REMOVE(&ctrlr_ch->group->shared_qpair_list, sq, group_tailq);
+	spdk_ring_free(sq->ring);
+	free(sq);
 
-	spdk_thread_send_msg(bio->orig_thread, _bdev_nvme_reset_io_continue, bio);
+	spdk_put_io_channel(spdk_io_channel_from_ctx(ctrlr_ch));
 }
 
 static int
-_bdev_nvme_reset_io(struct nvme_io_path *io_path, struct nvme_bdev_io *bio)
+nvme_poll_group_process_shared_qpairs(struct nvme_poll_group *group)
 {
-	struct nvme_ctrlr_channel *ctrlr_ch = io_path->ctrlr_ch;
-	struct nvme_ctrlr *nvme_ctrlr;
-	struct spdk_bdev_io *bdev_io;
-	int rc;
-
-	nvme_ctrlr = nvme_ctrlr_channel_get_ctrlr(ctrlr_ch);
+	struct nvme_shared_qpair *sq, *tmp_sq;
+	int num_submissions = 0;
 
-	rc = bdev_nvme_reset(nvme_ctrlr);
-	if (rc == 0) {
-		assert(bio->io_path == NULL);
-		bio->io_path = io_path;
+	TAILQ_FOREACH_SAFE(sq, &group->shared_qpair_list, group_tailq, tmp_sq) {
+		num_submissions += nvme_shared_qpair_process(sq);
 
-		assert(nvme_ctrlr->reset_cb_fn == NULL);
-		assert(nvme_ctrlr->reset_cb_arg == NULL);
-		nvme_ctrlr->reset_cb_fn = bdev_nvme_reset_io_continue;
-		nvme_ctrlr->reset_cb_arg = bio;
-	} else if (rc == -EBUSY) {
-		/*
-		 * Reset call is queued only if it is from the app framework. This is on purpose so that
-		 * we don't interfere with the app framework reset strategy. i.e. we are deferring to the
-		 * upper level. If they are in the middle of a reset, we won't try to schedule another one.
-		 */
-		bdev_io = spdk_bdev_io_from_ctx(bio);
-		TAILQ_INSERT_TAIL(&ctrlr_ch->pending_resets, bdev_io, module_link);
-	} else {
-		return rc;
+		if (spdk_unlikely(TAILQ_EMPTY(&sq->owner_ch->io_path_list)) &&
+		    __atomic_load_n(&sq->num_members, __ATOMIC_RELAXED) == 0) {
+			nvme_shared_qpair_try_release(sq);
+		}
 	}
 
-	return 0;
+	return num_submissions;
 }
 
+/* Move a busy thread from the shared qpair to a qpair of its own. */
 static void
-bdev_nvme_reset_io(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio)
+nvme_ctrlr_channel_update_shared_iops(struct nvme_ctrlr_channel *ctrlr_ch)
 {
-	struct nvme_io_path *io_path;
-	int rc;
+	uint64_t now, elapsed, ticks_hz, iops;
 
-	bio->cpl.cdw0 = 0;
-	bio->orig_thread = spdk_get_thread();
+	ctrlr_ch->shared_num_ios++;
 
-	/* Reset only the first nvme_ctrlr in the nvme_bdev_ctrlr for now.
-	 *
-	 * TODO: Reset all nvme_ctrlrs in the nvme_bdev_ctrlr sequentially.
-	 * This will be done in the following patches.
-	 */
-	io_path = STAILQ_FIRST(&nbdev_ch->io_path_list);
-	assert(io_path != NULL);
+	now = spdk_get_ticks();
+	ticks_hz = spdk_get_ticks_hz();
+	elapsed = now - ctrlr_ch->shared_window_tsc;
+	if (elapsed < ticks_hz) {
+		return;
+	}
 
-	rc = _bdev_nvme_reset_io(io_path, bio);
-	if (rc != 0) {
-		bio->cpl.cdw0 = 1;
-		bdev_nvme_reset_io_complete(bio);
+	iops = ctrlr_ch->shared_num_ios * ticks_hz / elapsed;
+	ctrlr_ch->shared_num_ios = 0;
+	ctrlr_ch->shared_window_tsc = now;
+
+	if (iops <= g_opts.io_qpair_promote_iops) {
+		return;
+	}
+
+	/* If the qpair can't be created, stay on the shared qpair and try again later. */
+	if (bdev_nvme_create_qpair(ctrlr_ch) != 0) {
+		return;
 	}
+
+	SPDK_DEBUGLOG(bdev_nvme, "ctrlr_ch %p got a dedicated qpair at %" PRIu64 " IOPS\n",
+		      ctrlr_ch, iops);
+
+	nvme_ctrlr_channel_leave_shared_qpair(ctrlr_ch);
 }
 
 static int
-bdev_nvme_failover(struct nvme_ctrlr *nvme_ctrlr, bool remove)
+bdev_nvme_shared_qpair_submit(struct nvme_bdev_io *bio)
 {
-	pthread_mutex_lock(&nvme_ctrlr->mutex);
-	if (nvme_ctrlr->destruct) {
-		pthread_mutex_unlock(&nvme_ctrlr->mutex);
-		/* Don't bother resetting if the controller is in the process of being destructed. */
-		return -ENXIO;
-	}
+	struct nvme_ctrlr_channel *ctrlr_ch = bio->io_path->ctrlr_ch;
+	struct nvme_shared_qpair *sq;
 
-	if (nvme_ctrlr->resetting) {
-		pthread_mutex_unlock(&nvme_ctrlr->mutex);
-		SPDK_NOTICELOG("Unable to perform reset, already in progress.\n");
-		return -EBUSY;
+	if (g_opts.io_qpair_promote_iops != 0) {
+		nvme_ctrlr_channel_update_shared_iops(ctrlr_ch);
+		if (ctrlr_ch->shared_qpair == NULL) {
+			return _bdev_nvme_submit_io(bio);
+		}
 	}
 
-	bdev_nvme_failover_trid(nvme_ctrlr, remove);
-
-	nvme_ctrlr->resetting = true;
+	sq = ctrlr_ch->shared_qpair;
 
-	pthread_mutex_unlock(&nvme_ctrlr->mutex);
+	bio->shared_ctrlr_ch = sq->owner_ch;
+	if (spdk_unlikely(spdk_ring_enqueue(sq->ring, (void **)&bio, 1, NULL) != 1)) {
+		bio->shared_ctrlr_ch = NULL;
+		return -ENOMEM;
+	}
 
-	spdk_thread_send_msg(nvme_ctrlr->thread, _bdev_nvme_reset, nvme_ctrlr);
 	return 0;
 }
 
-static int bdev_nvme_unmap(struct nvme_bdev_io *bio, uint64_t offset_blocks,
-			   uint64_t num_blocks);
+static inline int
+bdev_nvme_submit_io(struct nvme_bdev_io *bio)
+{
+	if (spdk_unlikely(bio->io_path->ctrlr_ch->shared_qpair != NULL)) {
+		return bdev_nvme_shared_qpair_submit(bio);
+	}
 
-static int bdev_nvme_write_zeroes(struct nvme_bdev_io *bio, uint64_t offset_blocks,
-				  uint64_t num_blocks);
+	return _bdev_nvme_submit_io(bio);
+}
 
 static void
 bdev_nvme_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		     bool success)
 {
 	struct nvme_bdev_io *bio = (struct nvme_bdev_io *)bdev_io->driver_ctx;
-	struct spdk_bdev *bdev = bdev_io->bdev;
 	int ret;
 
 	if (!success) {
@@ -1651,14 +2224,7 @@ bdev_nvme_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		goto exit;
 	}
 
-	ret = bdev_nvme_readv(bio,
-			      bdev_io->u.bdev.iovs,
-			      bdev_io->u.bdev.iovcnt,
-			      bdev_io->u.bdev.md_buf,
-			      bdev_io->u.bdev.num_blocks,
-			      bdev_io->u.bdev.offset_blocks,
-			      bdev->dif_check_flags,
-			      bdev_io->internal.ext_opts);
+	ret = bdev_nvme_submit_io(bio);
 
 exit:
 	if (spdk_unlikely(ret != 0)) {
@@ -1676,6 +2242,8 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 	int rc = 0;
 
 	nbdev_io->io_path = bdev_nvme_find_io_path(nbdev_ch);
+	nbdev_io->io_path_tracked = false;
+	nbdev_io->shared_ctrlr_ch = NULL;
 	if (spdk_unlikely(!nbdev_io->io_path)) {
 		if (!bdev_nvme_io_type_is_admin(bdev_io->type)) {
 			rc = -ENXIO;
@@ -1685,65 +2253,20 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 		/* Admin commands do not use the optimal I/O path.
 		 * Simply fall through even if it is not found.
 		 */
+	} else if (!bdev_nvme_io_type_is_admin(bdev_io->type)) {
+		nvme_io_path_start_io(nbdev_io);
 	}
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 		if (bdev_io->u.bdev.iovs && bdev_io->u.bdev.iovs[0].iov_base) {
-			rc = bdev_nvme_readv(nbdev_io,
-					     bdev_io->u.bdev.iovs,
-					     bdev_io->u.bdev.iovcnt,
-					     bdev_io->u.bdev.md_buf,
-					     bdev_io->u.bdev.num_blocks,
-					     bdev_io->u.bdev.offset_blocks,
-					     bdev->dif_check_flags,
-					     bdev_io->internal.ext_opts);
+			rc = bdev_nvme_submit_io(nbdev_io);
 		} else {
 			spdk_bdev_io_get_buf(bdev_io, bdev_nvme_get_buf_cb,
 					     bdev_io->u.bdev.num_blocks * bdev->blocklen);
 			rc = 0;
 		}
 		break;
-	case SPDK_BDEV_IO_TYPE_WRITE:
-		rc = bdev_nvme_writev(nbdev_io,
-				      bdev_io->u.bdev.iovs,
-				      bdev_io->u.bdev.iovcnt,
-				      bdev_io->u.bdev.md_buf,
-				      bdev_io->u.bdev.num_blocks,
-				      bdev_io->u.bdev.offset_blocks,
-				      bdev->dif_check_flags,
-				      bdev_io->internal.ext_opts);
-		break;
-	case SPDK_BDEV_IO_TYPE_COMPARE:
-		rc = bdev_nvme_comparev(nbdev_io,
-					bdev_io->u.bdev.iovs,
-					bdev_io->u.bdev.iovcnt,
-					bdev_io->u.bdev.md_buf,
-					bdev_io->u.bdev.num_blocks,
-					bdev_io->u.bdev.offset_blocks,
-					bdev->dif_check_flags);
-		break;
-	case SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE:
-		rc = bdev_nvme_comparev_and_writev(nbdev_io,
-						   bdev_io->u.bdev.iovs,
-						   bdev_io->u.bdev.iovcnt,
-						   bdev_io->u.bdev.fused_iovs,
-						   bdev_io->u.bdev.fused_iovcnt,
-						   bdev_io->u.bdev.md_buf,
-						   bdev_io->u.bdev.num_blocks,
-						   bdev_io->u.bdev.offset_blocks,
-						   bdev->dif_check_flags);
-		break;
-	case SPDK_BDEV_IO_TYPE_UNMAP:
-		rc = bdev_nvme_unmap(nbdev_io,
-				     bdev_io->u.bdev.offset_blocks,
-				     bdev_io->u.bdev.num_blocks);
-		break;
-	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
-		rc =  bdev_nvme_write_zeroes(nbdev_io,
-					     bdev_io->u.bdev.offset_blocks,
-					     bdev_io->u.bdev.num_blocks);
-		break;
 	case SPDK_BDEV_IO_TYPE_RESET:
 		nbdev_io->io_path = NULL;
 		bdev_nvme_reset_io(nbdev_ch, nbdev_io);
@@ -1753,26 +2276,6 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 				     bdev_io->u.bdev.offset_blocks,
 				     bdev_io->u.bdev.num_blocks);
 		break;
-	case SPDK_BDEV_IO_TYPE_ZONE_APPEND:
-		rc = bdev_nvme_zone_appendv(nbdev_io,
-					    bdev_io->u.bdev.iovs,
-					    bdev_io->u.bdev.iovcnt,
-					    bdev_io->u.bdev.md_buf,
-					    bdev_io->u.bdev.num_blocks,
-					    bdev_io->u.bdev.offset_blocks,
-					    bdev->dif_check_flags);
-		break;
-	case SPDK_BDEV_IO_TYPE_GET_ZONE_INFO:
-		rc = bdev_nvme_get_zone_info(nbdev_io,
-					     bdev_io->u.zone_mgmt.zone_id,
-					     bdev_io->u.zone_mgmt.num_zones,
-					     bdev_io->u.zone_mgmt.buf);
-		break;
-	case SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT:
-		rc = bdev_nvme_zone_management(nbdev_io,
-					       bdev_io->u.zone_mgmt.zone_id,
-					       bdev_io->u.zone_mgmt.zone_action);
-		break;
 	case SPDK_BDEV_IO_TYPE_NVME_ADMIN:
 		nbdev_io->io_path = NULL;
 		bdev_nvme_admin_passthru(nbdev_ch,
@@ -1781,20 +2284,6 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 					 bdev_io->u.nvme_passthru.buf,
 					 bdev_io->u.nvme_passthru.nbytes);
 		break;
-	case SPDK_BDEV_IO_TYPE_NVME_IO:
-		rc = bdev_nvme_io_passthru(nbdev_io,
-					   &bdev_io->u.nvme_passthru.cmd,
-					   bdev_io->u.nvme_passthru.buf,
-					   bdev_io->u.nvme_passthru.nbytes);
-		break;
-	case SPDK_BDEV_IO_TYPE_NVME_IO_MD:
-		rc = bdev_nvme_io_passthru_md(nbdev_io,
-					      &bdev_io->u.nvme_passthru.cmd,
-					      bdev_io->u.nvme_passthru.buf,
-					      bdev_io->u.nvme_passthru.nbytes,
-					      bdev_io->u.nvme_passthru.md_buf,
-					      bdev_io->u.nvme_passthru.md_len);
-		break;
 	case SPDK_BDEV_IO_TYPE_ABORT:
 		nbdev_io->io_path = NULL;
 		nbdev_io_to_abort = (struct nvme_bdev_io *)bdev_io->u.abort.bio_to_abort->driver_ctx;
@@ -1803,7 +2292,7 @@ bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 				nbdev_io_to_abort);
 		break;
 	default:
-		rc = -EINVAL;
+		rc = bdev_nvme_submit_io(nbdev_io);
 		break;
 	}
 
@@ -1851,6 +2340,10 @@ bdev_nvme_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 		cdata = spdk_nvme_ctrlr_get_data(ctrlr);
 		return cdata->oncs.write_zeroes;
 
+	case SPDK_BDEV_IO_TYPE_COPY:
+		cdata = spdk_nvme_ctrlr_get_data(ctrlr);
+		return cdata->oncs.copy;
+
 	case SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE:
 		if (spdk_nvme_ctrlr_get_flags(ctrlr) &
 		    SPDK_NVME_CTRLR_COMPARE_AND_WRITE_SUPPORTED) {
@@ -1896,6 +2389,11 @@ bdev_nvme_create_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&ctrlr_ch->pending_resets);
 	TAILQ_INIT(&ctrlr_ch->io_path_list);
 
+	if (g_opts.io_qpair_share_threads > 1 &&
+	    nvme_ctrlr_channel_join_shared_qpair(nvme_ctrlr, ctrlr_ch)) {
+		return 0;
+	}
+
 	rc = bdev_nvme_create_qpair(ctrlr_ch);
 	if (rc != 0) {
 		/* nvme ctrlr can't create IO qpair during reset. In that case ctrlr_ch->qpair
@@ -1904,6 +2402,8 @@ bdev_nvme_create_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 		if (!nvme_ctrlr->resetting) {
 			goto err_qpair;
 		}
+	} else if (g_opts.io_qpair_share_threads > 1) {
+		nvme_ctrlr_channel_share_qpair(nvme_ctrlr, ctrlr_ch);
 	}
 
 	return 0;
@@ -1922,6 +2422,10 @@ bdev_nvme_destroy_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 
 	assert(ctrlr_ch->group != NULL);
 
+	if (ctrlr_ch->shared_qpair != NULL) {
+		nvme_ctrlr_channel_leave_shared_qpair(ctrlr_ch);
+	}
+
 	bdev_nvme_destroy_qpair(ctrlr_ch);
 
 	TAILQ_REMOVE(&ctrlr_ch->group->ctrlr_ch_list, ctrlr_ch, tailq);
@@ -1961,6 +2465,7 @@ bdev_nvme_create_poll_group_cb(void *io_device, void *ctx_buf)
 	struct nvme_poll_group *group = ctx_buf;
 
 	TAILQ_INIT(&group->ctrlr_ch_list);
+	TAILQ_INIT(&group->shared_qpair_list);
 
 	group->group = spdk_nvme_poll_group_create(group, &g_bdev_nvme_accel_fn_table);
 	if (group->group == NULL) {
@@ -1992,6 +2497,7 @@ bdev_nvme_destroy_poll_group_cb(void *io_device, void *ctx_buf)
 	struct nvme_poll_group *group = ctx_buf;
 
 	assert(TAILQ_EMPTY(&group->ctrlr_ch_list));
+	assert(TAILQ_EMPTY(&group->shared_qpair_list));
 
 	if (group->accel_channel) {
 		spdk_put_io_channel(group->accel_channel);
@@ -2166,6 +2672,43 @@ nvme_namespace_info_json(struct spdk_json_write_ctx *w,
 	spdk_json_write_object_end(w);
 }
 
+void
+nvme_io_path_info_json(struct spdk_json_write_ctx *w, struct nvme_io_path *io_path)
+{
+	struct nvme_ns *nvme_ns = io_path->nvme_ns;
+	struct nvme_ctrlr *nvme_ctrlr = nvme_ns->ctrlr;
+	struct nvme_bdev_channel *nbdev_ch = io_path->nbdev_ch;
+	struct nvme_bdev *nbdev;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+
+	nbdev = spdk_io_channel_get_io_device(spdk_io_channel_from_ctx(nbdev_ch));
+
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "bdev_name", nbdev->disk.name);
+	spdk_json_write_named_string(w, "multipath_policy",
+				     bdev_nvme_multipath_policy_str(nbdev_ch->mp_policy));
+	spdk_json_write_named_uint32(w, "cntlid",
+				     spdk_nvme_ctrlr_get_data(nvme_ctrlr->ctrlr)->cntlid);
+
+	spdk_json_write_named_object_begin(w, "trid");
+	nvme_bdev_dump_trid_json(&nvme_ctrlr->active_path_id->trid, w);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_string(w, "ana_state", _nvme_ana_state_str(nvme_ns->ana_state));
+	spdk_json_write_named_bool(w, "connected", nvme_io_path_is_connected(io_path));
+	spdk_json_write_named_bool(w, "current", nbdev_ch->current_io_path == io_path);
+	spdk_json_write_named_uint64(w, "io_outstanding", io_path->io_outstanding);
+	spdk_json_write_named_uint64(w, "num_ios", io_path->num_ios);
+	spdk_json_write_named_uint64(w, "bytes", io_path->bytes);
+	spdk_json_write_named_uint64(w, "avg_latency_us",
+				     io_path->avg_latency_ticks * SPDK_SEC_TO_USEC / ticks_hz);
+	spdk_json_write_named_uint64(w, "total_latency_us",
+				     io_path->latency_ticks * SPDK_SEC_TO_USEC / ticks_hz);
+
+	spdk_json_write_object_end(w);
+}
+
 static int
 bdev_nvme_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 {
@@ -2331,6 +2874,17 @@ nvme_disk_create(struct spdk_bdev *disk, const char *base_name,
 	if (cdata->oncs.write_zeroes) {
 		disk->max_write_zeroes = UINT16_MAX + 1;
 	}
+	if (cdata->oncs.copy) {
+		/* Only a single source range is used per copy. */
+		nsdata = spdk_nvme_ns_get_data(ns);
+		disk->max_copy = UINT16_MAX + 1;
+		if (nsdata->mssrl != 0) {
+			disk->max_copy = spdk_min(disk->max_copy, nsdata->mssrl);
+		}
+		if (nsdata->mcl != 0) {
+			disk->max_copy = spdk_min(disk->max_copy, nsdata->mcl);
+		}
+	}
 	disk->blocklen = spdk_nvme_ns_get_extended_sector_size(ns);
 	disk->blockcnt = spdk_nvme_ns_get_num_sectors(ns);
 	disk->optimal_io_boundary = spdk_nvme_ns_get_optimal_io_boundary(ns);
@@ -3207,6 +3761,7 @@ nvme_ctrlr_create(struct spdk_nvme_ctrlr *ctrlr,
 	}
 
 	TAILQ_INIT(&nvme_ctrlr->trids);
+	TAILQ_INIT(&nvme_ctrlr->shared_qpairs);
 
 	RB_INIT(&nvme_ctrlr->namespaces);
 
@@ -3408,6 +3963,11 @@ bdev_nvme_validate_opts(const struct spdk_bdev_nvme_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->io_qpair_promote_iops != 0 && opts->io_qpair_share_threads < 2) {
+		SPDK_WARNLOG("Invalid option: io_qpair_promote_iops requires io_qpair_share_threads.\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -4168,7 +4728,7 @@ bdev_nvme_get_zone_info_done(void *ref, const struct spdk_nvme_cpl *cpl)
 	}
 
 	ns = bio->io_path->nvme_ns->ns;
-	qpair = bio->io_path->ctrlr_ch->qpair;
+	qpair = bdev_nvme_io_get_qpair(bio);
 
 	zone_report_bufsize = spdk_nvme_ns_get_max_io_xfer_size(ns);
 	max_zones_per_buf = (zone_report_bufsize - sizeof(*bio->zone_report_buf)) /
@@ -4419,7 +4979,7 @@ bdev_nvme_no_pi_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iov_offset = 0;
 
 	rc = spdk_nvme_ns_cmd_readv_with_md(bio->io_path->nvme_ns->ns,
-					    bio->io_path->ctrlr_ch->qpair,
+					    bdev_nvme_io_get_qpair(bio),
 					    lba, lba_count,
 					    bdev_nvme_no_pi_readv_done, bio, 0,
 					    bdev_nvme_queued_reset_sgl, bdev_nvme_queued_next_sge,
@@ -4437,7 +4997,7 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		struct spdk_bdev_ext_io_opts *ext_opts)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "read %" PRIu64 " blocks with offset %#" PRIx64 "\n",
@@ -4484,7 +5044,7 @@ bdev_nvme_writev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		 uint32_t flags, struct spdk_bdev_ext_io_opts *ext_opts)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "write %" PRIu64 " blocks with offset %#" PRIx64 "\n",
@@ -4531,7 +5091,7 @@ bdev_nvme_zone_appendv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 		       uint32_t flags)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	int rc;
 
 	SPDK_DEBUGLOG(bdev_nvme, "zone append %" PRIu64 " blocks to zone start lba %#" PRIx64 "\n",
@@ -4577,7 +5137,7 @@ bdev_nvme_comparev(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iov_offset = 0;
 
 	rc = spdk_nvme_ns_cmd_comparev_with_md(bio->io_path->nvme_ns->ns,
-					       bio->io_path->ctrlr_ch->qpair,
+					       bdev_nvme_io_get_qpair(bio),
 					       lba, lba_count,
 					       bdev_nvme_comparev_done, bio, flags,
 					       bdev_nvme_queued_reset_sgl, bdev_nvme_queued_next_sge,
@@ -4595,7 +5155,7 @@ bdev_nvme_comparev_and_writev(struct nvme_bdev_io *bio, struct iovec *cmp_iov, i
 			      void *md, uint64_t lba_count, uint64_t lba, uint32_t flags)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
 	int rc;
 
@@ -4685,7 +5245,7 @@ bdev_nvme_unmap(struct nvme_bdev_io *bio, uint64_t offset_blocks, uint64_t num_b
 	range->starting_lba = offset;
 
 	rc = spdk_nvme_ns_cmd_dataset_management(bio->io_path->nvme_ns->ns,
-			bio->io_path->ctrlr_ch->qpair,
+			bdev_nvme_io_get_qpair(bio),
 			SPDK_NVME_DSM_ATTR_DEALLOCATE,
 			dsm_ranges, num_ranges,
 			bdev_nvme_queued_done, bio);
@@ -4702,18 +5262,38 @@ bdev_nvme_write_zeroes(struct nvme_bdev_io *bio, uint64_t offset_blocks, uint64_
 	}
 
 	return spdk_nvme_ns_cmd_write_zeroes(bio->io_path->nvme_ns->ns,
-					     bio->io_path->ctrlr_ch->qpair,
+					     bdev_nvme_io_get_qpair(bio),
 					     offset_blocks, num_blocks,
 					     bdev_nvme_queued_done, bio,
 					     0);
 }
 
+static int
+bdev_nvme_copy(struct nvme_bdev_io *bio, uint64_t dst_offset_blocks, uint64_t src_offset_blocks,
+	       uint64_t num_blocks)
+{
+	struct spdk_nvme_scc_source_range range = {
+		.slba = src_offset_blocks,
+		.nlb = num_blocks - 1,
+	};
+
+	if (num_blocks > UINT16_MAX + 1) {
+		SPDK_ERRLOG("NVMe copy is limited to 16-bit block count per source range\n");
+		return -EINVAL;
+	}
+
+	return spdk_nvme_ns_cmd_copy(bio->io_path->nvme_ns->ns,
+				     bdev_nvme_io_get_qpair(bio),
+				     &range, 1, dst_offset_blocks,
+				     bdev_nvme_queued_done, bio);
+}
+
 static int
 bdev_nvme_get_zone_info(struct nvme_bdev_io *bio, uint64_t zone_id, uint32_t num_zones,
 			struct spdk_bdev_zone_info *info)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	uint32_t zone_report_bufsize = spdk_nvme_ns_get_max_io_xfer_size(ns);
 	uint64_t zone_size = spdk_nvme_zns_ns_get_zone_size_sectors(ns);
 	uint64_t total_zones = spdk_nvme_zns_ns_get_num_zones(ns);
@@ -4744,7 +5324,7 @@ bdev_nvme_zone_management(struct nvme_bdev_io *bio, uint64_t zone_id,
 			  enum spdk_bdev_zone_action action)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 
 	switch (action) {
 	case SPDK_BDEV_ZONE_CLOSE:
@@ -4814,7 +5394,7 @@ bdev_nvme_io_passthru(struct nvme_bdev_io *bio, struct spdk_nvme_cmd *cmd,
 		      void *buf, size_t nbytes)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	uint32_t max_xfer_size = spdk_nvme_ns_get_max_io_xfer_size(ns);
 	struct spdk_nvme_ctrlr *ctrlr = spdk_nvme_ns_get_ctrlr(ns);
 
@@ -4838,7 +5418,7 @@ bdev_nvme_io_passthru_md(struct nvme_bdev_io *bio, struct spdk_nvme_cmd *cmd,
 			 void *buf, size_t nbytes, void *md_buf, size_t md_len)
 {
 	struct spdk_nvme_ns *ns = bio->io_path->nvme_ns->ns;
-	struct spdk_nvme_qpair *qpair = bio->io_path->ctrlr_ch->qpair;
+	struct spdk_nvme_qpair *qpair = bdev_nvme_io_get_qpair(bio);
 	size_t nr_sectors = nbytes / spdk_nvme_ns_get_extended_sector_size(ns);
 	uint32_t max_xfer_size = spdk_nvme_ns_get_max_io_xfer_size(ns);
 	struct spdk_nvme_ctrlr *ctrlr = spdk_nvme_ns_get_ctrlr(ns);
@@ -4893,6 +5473,7 @@ bdev_nvme_abort(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
 	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
 		nvme_ctrlr = nvme_ctrlr_channel_get_ctrlr(io_path->ctrlr_ch);
 
+		/* I/Os on a shared qpair are owned by another thread and are not aborted. */
 		rc = spdk_nvme_ctrlr_cmd_abort_ext(nvme_ctrlr->ctrlr,
 						   io_path->ctrlr_ch->qpair,
 						   bio_to_abort,
@@ -4952,6 +5533,8 @@ bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "io_queue_requests", g_opts.io_queue_requests);
 	spdk_json_write_named_bool(w, "delay_cmd_submit", g_opts.delay_cmd_submit);
 	spdk_json_write_named_int32(w, "bdev_retry_count", g_opts.bdev_retry_count);
+	spdk_json_write_named_uint32(w, "io_qpair_share_threads", g_opts.io_qpair_share_threads);
+	spdk_json_write_named_uint32(w, "io_qpair_promote_iops", g_opts.io_qpair_promote_iops);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -5021,6 +5604,133 @@ bdev_nvme_config_json(struct spdk_json_write_ctx *w)
 	return 0;
 }
 
+const char *
+bdev_nvme_multipath_policy_str(enum bdev_nvme_multipath_policy policy)
+{
+	switch (policy) {
+	case BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE:
+		return "active_passive";
+	case BDEV_NVME_MP_POLICY_ROUND_ROBIN:
+		return "round_robin";
+	case BDEV_NVME_MP_POLICY_QUEUE_DEPTH:
+		return "queue_depth";
+	case BDEV_NVME_MP_POLICY_LATENCY:
+		return "latency";
+	default:
+		return NULL;
+	}
+}
+
+struct bdev_nvme_set_multipath_policy_ctx {
+	struct spdk_bdev_desc *desc;
+	enum bdev_nvme_multipath_policy policy;
+	bdev_nvme_set_multipath_policy_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+bdev_nvme_set_multipath_policy_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct bdev_nvme_set_multipath_policy_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	assert(ctx != NULL);
+	assert(ctx->desc != NULL);
+	assert(ctx->cb_fn != NULL);
+
+	spdk_bdev_close(ctx->desc);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+
+	free(ctx);
+}
+
+static void
+_bdev_nvme_set_multipath_policy(struct spdk_io_channel_iter *i)
+{
+	struct bdev_nvme_set_multipath_policy_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct nvme_bdev_channel *nbdev_ch = spdk_io_channel_get_ctx(_ch);
+	struct nvme_io_path *io_path;
+
+	nbdev_ch->mp_policy = ctx->policy;
+
+	/* The cached path is only valid for the active-passive policy. Clear it and the
+	 * statistics which are used to choose a path so that the new policy starts afresh.
+	 */
+	nbdev_ch->current_io_path = NULL;
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		io_path->lat_credit = 0;
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+dummy_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *ctx)
+{
+}
+
+void
+bdev_nvme_set_multipath_policy(const char *name, enum bdev_nvme_multipath_policy policy,
+			       bdev_nvme_set_multipath_policy_cb cb_fn, void *cb_arg)
+{
+	struct bdev_nvme_set_multipath_policy_ctx *ctx;
+	struct spdk_bdev *bdev;
+	struct nvme_bdev *nbdev;
+	int rc;
+
+	assert(cb_fn != NULL);
+
+	if (bdev_nvme_multipath_policy_str(policy) == NULL) {
+		rc = -EINVAL;
+		goto err_alloc;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to alloc context.\n");
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	ctx->policy = policy;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	rc = spdk_bdev_open_ext(name, false, dummy_bdev_event_cb, NULL, &ctx->desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("bdev %s is not registered in this module.\n", name);
+		rc = -ENODEV;
+		goto err_open;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(ctx->desc);
+	if (bdev->module != &nvme_if) {
+		SPDK_ERRLOG("bdev %s is not registered in this module.\n", name);
+		rc = -ENODEV;
+		goto err_module;
+	}
+
+	nbdev = SPDK_CONTAINEROF(bdev, struct nvme_bdev, disk);
+
+	pthread_mutex_lock(&nbdev->mutex);
+	nbdev->mp_policy = policy;
+	pthread_mutex_unlock(&nbdev->mutex);
+
+	spdk_for_each_channel(nbdev,
+			      _bdev_nvme_set_multipath_policy,
+			      ctx,
+			      bdev_nvme_set_multipath_policy_done);
+	return;
+
+err_module:
+	spdk_bdev_close(ctx->desc);
+err_open:
+	free(ctx);
+err_alloc:
+	cb_fn(cb_arg, rc);
+}
+
 struct spdk_nvme_ctrlr *
 bdev_nvme_get_ctrlr(struct spdk_bdev *bdev)
 {
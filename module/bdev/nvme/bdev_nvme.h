@@ -47,6 +47,17 @@ extern bool g_bdev_nvme_module_finish;
 
 #define NVME_MAX_CONTROLLERS 1024
 
+enum bdev_nvme_multipath_policy {
+	/* Submit all I/Os to a single path and fail over to another when it fails. */
+	BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE = 0,
+	/* Spread I/Os evenly across all usable paths. */
+	BDEV_NVME_MP_POLICY_ROUND_ROBIN,
+	/* Submit each I/O to the usable path with the fewest outstanding I/Os. */
+	BDEV_NVME_MP_POLICY_QUEUE_DEPTH,
+	/* Spread I/Os across usable paths in proportion to their inverse latency. */
+	BDEV_NVME_MP_POLICY_LATENCY,
+};
+
 typedef void (*spdk_bdev_create_nvme_fn)(void *ctx, size_t bdev_count, int rc);
 
 struct nvme_async_probe_ctx {
@@ -83,6 +94,7 @@ struct nvme_bdev_io;
 struct nvme_bdev_ctrlr;
 struct nvme_bdev;
 struct nvme_io_path;
+struct nvme_shared_qpair;
 
 struct nvme_path_id {
 	struct spdk_nvme_transport_id		trid;
@@ -137,6 +149,9 @@ struct nvme_ctrlr {
 
 	struct nvme_async_probe_ctx		*probe_ctx;
 
+	/* I/O qpairs shared by multiple threads. Protected by mutex. */
+	TAILQ_HEAD(, nvme_shared_qpair)		shared_qpairs;
+
 	pthread_mutex_t				mutex;
 };
 
@@ -155,6 +170,7 @@ struct nvme_bdev {
 	int			ref;
 	TAILQ_HEAD(, nvme_ns)	nvme_ns_list;
 	bool			opal;
+	enum bdev_nvme_multipath_policy	mp_policy;
 	TAILQ_ENTRY(nvme_bdev)	tailq;
 };
 
@@ -167,6 +183,29 @@ struct nvme_ctrlr_channel {
 	/* The following is used to update io_path cache of nvme_bdev_channels. */
 	TAILQ_HEAD(, nvme_io_path)	io_path_list;
 
+	/* Set if this channel has no qpair of its own and submits I/O through the
+	 * qpair of another thread instead.
+	 */
+	struct nvme_shared_qpair	*shared_qpair;
+
+	/* The following are used to promote the channel to a dedicated qpair. */
+	uint64_t			shared_num_ios;
+	uint64_t			shared_window_tsc;
+};
+
+/* I/O qpair of a ctrlr_ch which is shared with the ctrlr_chs of other threads.
+ * The other threads put I/Os to the ring, and the poll group of the owner thread
+ * submits them to the qpair. Completions are sent back to the submitting threads.
+ */
+struct nvme_shared_qpair {
+	struct nvme_ctrlr_channel	*owner_ch;
+	struct spdk_ring		*ring;
+
+	/* The number of ctrlr_chs of other threads using this qpair. */
+	uint32_t			num_members;
+
+	TAILQ_ENTRY(nvme_shared_qpair)	tailq;
+	TAILQ_ENTRY(nvme_shared_qpair)	group_tailq;
 };
 
 #define nvme_ctrlr_channel_get_ctrlr(ctrlr_ch)	\
@@ -180,10 +219,24 @@ struct nvme_io_path {
 	/* The following are used to update io_path cache of the nvme_bdev_channel. */
 	struct nvme_bdev_channel	*nbdev_ch;
 	TAILQ_ENTRY(nvme_io_path)	tailq;
+
+	/* The following are statistics of the path. They are accessed only by
+	 * the thread which owns nbdev_ch.
+	 */
+	uint64_t			io_outstanding;
+	uint64_t			num_ios;
+	uint64_t			bytes;
+	uint64_t			latency_ticks;
+	/* Moving average of I/O latency, used by BDEV_NVME_MP_POLICY_LATENCY. */
+	uint64_t			avg_latency_ticks;
+	/* Credit of the smooth weighted round robin for BDEV_NVME_MP_POLICY_LATENCY. */
+	int64_t				lat_credit;
 };
 
 struct nvme_bdev_channel {
+	/* Cached path for the active-passive policy, or the last chosen path otherwise. */
 	struct nvme_io_path			*current_io_path;
+	enum bdev_nvme_multipath_policy		mp_policy;
 	STAILQ_HEAD(, nvme_io_path)		io_path_list;
 	TAILQ_HEAD(retry_io_head, spdk_bdev_io)	retry_io_list;
 	struct spdk_poller			*retry_io_poller;
@@ -198,6 +251,7 @@ struct nvme_poll_group {
 	uint64_t				start_ticks;
 	uint64_t				end_ticks;
 	TAILQ_HEAD(, nvme_ctrlr_channel)	ctrlr_ch_list;
+	TAILQ_HEAD(, nvme_shared_qpair)		shared_qpair_list;
 };
 
 struct nvme_ctrlr *nvme_ctrlr_get_by_name(const char *name);
@@ -211,6 +265,8 @@ void nvme_bdev_ctrlr_for_each(nvme_bdev_ctrlr_for_each_fn fn, void *ctx);
 void nvme_bdev_dump_trid_json(const struct spdk_nvme_transport_id *trid,
 			      struct spdk_json_write_ctx *w);
 
+void nvme_io_path_info_json(struct spdk_json_write_ctx *w, struct nvme_io_path *io_path);
+
 struct nvme_ns *nvme_ctrlr_get_ns(struct nvme_ctrlr *nvme_ctrlr, uint32_t nsid);
 struct nvme_ns *nvme_ctrlr_get_first_active_ns(struct nvme_ctrlr *nvme_ctrlr);
 struct nvme_ns *nvme_ctrlr_get_next_active_ns(struct nvme_ctrlr *nvme_ctrlr, struct nvme_ns *ns);
@@ -238,6 +294,10 @@ struct spdk_bdev_nvme_opts {
 	bool delay_cmd_submit;
 	/* The number of attempts per I/O in the bdev layer before an I/O fails. */
 	int32_t bdev_retry_count;
+	/* The maximum number of threads sharing an I/O qpair. 0 or 1 disables sharing. */
+	uint32_t io_qpair_share_threads;
+	/* IOPS of a thread above which it gets its own I/O qpair. 0 means never. */
+	uint32_t io_qpair_promote_iops;
 };
 
 struct spdk_nvme_qpair *bdev_nvme_get_io_qpair(struct spdk_io_channel *ctrlr_io_ch);
@@ -278,4 +338,21 @@ int bdev_nvme_delete(const char *name, const struct nvme_path_id *path_id);
  */
 int bdev_nvme_reset_rpc(struct nvme_ctrlr *nvme_ctrlr, bdev_nvme_reset_cb cb_fn, void *cb_arg);
 
+typedef void (*bdev_nvme_set_multipath_policy_cb)(void *cb_arg, int rc);
+
+/**
+ * Set multipath policy of the NVMe bdev.
+ *
+ * \param name NVMe bdev name
+ * \param policy Multipath policy
+ * \param cb_fn Function to be called back after completion
+ * \param cb_arg Argument for callback function
+ */
+void bdev_nvme_set_multipath_policy(const char *name,
+				    enum bdev_nvme_multipath_policy policy,
+				    bdev_nvme_set_multipath_policy_cb cb_fn,
+				    void *cb_arg);
+
+const char *bdev_nvme_multipath_policy_str(enum bdev_nvme_multipath_policy policy);
+
 #endif /* SPDK_BDEV_NVME_H */
@@ -90,6 +90,8 @@ static const struct spdk_json_object_decoder rpc_bdev_nvme_options_decoders[] =
 	{"delay_cmd_submit", offsetof(struct spdk_bdev_nvme_opts, delay_cmd_submit), spdk_json_decode_bool, true},
 	{"transport_retry_count", offsetof(struct spdk_bdev_nvme_opts, transport_retry_count), spdk_json_decode_uint32, true},
 	{"bdev_retry_count", offsetof(struct spdk_bdev_nvme_opts, bdev_retry_count), spdk_json_decode_int32, true},
+	{"io_qpair_share_threads", offsetof(struct spdk_bdev_nvme_opts, io_qpair_share_threads), spdk_json_decode_uint32, true},
+	{"io_qpair_promote_iops", offsetof(struct spdk_bdev_nvme_opts, io_qpair_promote_iops), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -1548,3 +1550,202 @@ rpc_bdev_nvme_get_controller_health_info(struct spdk_jsonrpc_request *request,
 }
 SPDK_RPC_REGISTER("bdev_nvme_get_controller_health_info",
 		  rpc_bdev_nvme_get_controller_health_info, SPDK_RPC_RUNTIME)
+
+static int
+rpc_decode_mp_policy(const struct spdk_json_val *val, void *out)
+{
+	enum bdev_nvme_multipath_policy *policy = out;
+
+	if (spdk_json_strequal(val, "active_passive") == true) {
+		*policy = BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE;
+	} else if (spdk_json_strequal(val, "round_robin") == true) {
+		*policy = BDEV_NVME_MP_POLICY_ROUND_ROBIN;
+	} else if (spdk_json_strequal(val, "queue_depth") == true) {
+		*policy = BDEV_NVME_MP_POLICY_QUEUE_DEPTH;
+	} else if (spdk_json_strequal(val, "latency") == true) {
+		*policy = BDEV_NVME_MP_POLICY_LATENCY;
+	} else {
+		SPDK_NOTICELOG("Invalid parameter value: policy\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+struct rpc_set_multipath_policy {
+	char *name;
+	enum bdev_nvme_multipath_policy policy;
+};
+
+static void
+free_rpc_set_multipath_policy(struct rpc_set_multipath_policy *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_set_multipath_policy_decoders[] = {
+	{"name", offsetof(struct rpc_set_multipath_policy, name), spdk_json_decode_string},
+	{"policy", offsetof(struct rpc_set_multipath_policy, policy), rpc_decode_mp_policy},
+};
+
+struct rpc_set_multipath_policy_ctx {
+	struct rpc_set_multipath_policy req;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+rpc_bdev_nvme_set_multipath_policy_done(void *cb_arg, int rc)
+{
+	struct rpc_set_multipath_policy_ctx *ctx = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(ctx->request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+	}
+
+	free_rpc_set_multipath_policy(&ctx->req);
+	free(ctx);
+}
+
+static void
+rpc_bdev_nvme_set_multipath_policy(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_set_multipath_policy_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_set_multipath_policy_decoders,
+				    SPDK_COUNTOF(rpc_set_multipath_policy_decoders),
+				    &ctx->req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	ctx->request = request;
+
+	bdev_nvme_set_multipath_policy(ctx->req.name, ctx->req.policy,
+				       rpc_bdev_nvme_set_multipath_policy_done, ctx);
+	return;
+
+cleanup:
+	free_rpc_set_multipath_policy(&ctx->req);
+	free(ctx);
+}
+SPDK_RPC_REGISTER("bdev_nvme_set_multipath_policy", rpc_bdev_nvme_set_multipath_policy,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_get_io_paths {
+	char *name;
+};
+
+static void
+free_rpc_get_io_paths(struct rpc_get_io_paths *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_get_io_paths_decoders[] = {
+	{"name", offsetof(struct rpc_get_io_paths, name), spdk_json_decode_string, true},
+};
+
+struct rpc_get_io_paths_ctx {
+	struct rpc_get_io_paths req;
+	struct spdk_jsonrpc_request *request;
+	struct spdk_json_write_ctx *w;
+};
+
+static void
+rpc_bdev_nvme_get_io_paths_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct rpc_get_io_paths_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	spdk_json_write_array_end(ctx->w);
+
+	spdk_json_write_object_end(ctx->w);
+
+	spdk_jsonrpc_end_result(ctx->request, ctx->w);
+
+	free_rpc_get_io_paths(&ctx->req);
+	free(ctx);
+}
+
+static void
+_rpc_bdev_nvme_get_io_paths(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct nvme_poll_group *group = spdk_io_channel_get_ctx(_ch);
+	struct rpc_get_io_paths_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct nvme_ctrlr_channel *ctrlr_ch;
+	struct nvme_io_path *io_path;
+	struct spdk_io_channel *ch;
+	struct nvme_bdev *nbdev;
+
+	spdk_json_write_object_begin(ctx->w);
+
+	spdk_json_write_named_string(ctx->w, "thread", spdk_thread_get_name(spdk_get_thread()));
+
+	spdk_json_write_named_array_begin(ctx->w, "io_paths");
+
+	TAILQ_FOREACH(ctrlr_ch, &group->ctrlr_ch_list, tailq) {
+		TAILQ_FOREACH(io_path, &ctrlr_ch->io_path_list, tailq) {
+			ch = spdk_io_channel_from_ctx(io_path->nbdev_ch);
+			nbdev = spdk_io_channel_get_io_device(ch);
+
+			if (ctx->req.name == NULL || strcmp(ctx->req.name, nbdev->disk.name) == 0) {
+				nvme_io_path_info_json(ctx->w, io_path);
+			}
+		}
+	}
+
+	spdk_json_write_array_end(ctx->w);
+
+	spdk_json_write_object_end(ctx->w);
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+rpc_bdev_nvme_get_io_paths(struct spdk_jsonrpc_request *request,
+			   const struct spdk_json_val *params)
+{
+	struct rpc_get_io_paths_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (params != NULL &&
+	    spdk_json_decode_object(params, rpc_get_io_paths_decoders,
+				    SPDK_COUNTOF(rpc_get_io_paths_decoders),
+				    &ctx->req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+
+		free_rpc_get_io_paths(&ctx->req);
+		free(ctx);
+		return;
+	}
+
+	ctx->request = request;
+	ctx->w = spdk_jsonrpc_begin_result(request);
+
+	spdk_json_write_object_begin(ctx->w);
+
+	spdk_json_write_named_array_begin(ctx->w, "poll_groups");
+
+	spdk_for_each_channel(&g_nvme_bdev_ctrlrs,
+			      _rpc_bdev_nvme_get_io_paths,
+			      ctx,
+			      rpc_bdev_nvme_get_io_paths_done);
+}
+SPDK_RPC_REGISTER("bdev_nvme_get_io_paths", rpc_bdev_nvme_get_io_paths, SPDK_RPC_RUNTIME)
@@ -191,6 +191,12 @@ nvme_rpc_io_cmd_bdev_nvme(struct rpc_bdev_nvme_send_cmd_ctx *ctx, struct spdk_nv
 
 	ctx->ctrlr_io_ch = spdk_get_io_channel(_nvme_ctrlr);
 	io_qpair = bdev_nvme_get_io_qpair(ctx->ctrlr_io_ch);
+	if (io_qpair == NULL) {
+		/* The qpair is being reset, or this thread shares the qpair of another thread. */
+		spdk_put_io_channel(ctx->ctrlr_io_ch);
+		ctx->ctrlr_io_ch = NULL;
+		return -ENXIO;
+	}
 
 	ret = spdk_nvme_ctrlr_cmd_io_raw_with_md(_nvme_ctrlr->ctrlr, io_qpair,
 			cmd, buf, nbytes, md_buf, nvme_rpc_bdev_nvme_cb, ctx);
@@ -383,6 +383,11 @@ vbdev_passthru_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
 	struct vbdev_passthru *pt_node = (struct vbdev_passthru *)ctx;
 
+	/* Copy isn't passed through, so let the bdev layer emulate it with reads and writes. */
+	if (io_type == SPDK_BDEV_IO_TYPE_COPY) {
+		return false;
+	}
+
 	return spdk_bdev_io_type_supported(pt_node->base_bdev, io_type);
 }
 
@@ -40,8 +40,16 @@
 #include "spdk/json.h"
 #include "spdk/string.h"
 
+/* Default size of the base bdev range rebuilt at once */
+#define RAID_BDEV_REBUILD_WINDOW_SIZE_KB_DEFAULT 1024
+
 static bool g_shutdown_started = false;
 
+static struct raid_bdev_opts g_raid_bdev_opts = {
+	.rebuild_window_size_kb = RAID_BDEV_REBUILD_WINDOW_SIZE_KB_DEFAULT,
+	.rebuild_max_bandwidth_mb_sec = 0,
+};
+
 /* raid bdev config as read from config file */
 struct raid_config	g_raid_config = {
 	.raid_bdev_config_head = TAILQ_HEAD_INITIALIZER(g_raid_config.raid_bdev_config_head),
@@ -123,6 +131,8 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 	assert(raid_bdev->state == RAID_BDEV_STATE_ONLINE);
 
 	raid_ch->num_channels = raid_bdev->num_base_bdevs;
+	TAILQ_INIT(&raid_ch->ios);
+	raid_ch->io_seq = 0;
 
 	raid_ch->base_channel = calloc(raid_ch->num_channels,
 				       sizeof(struct spdk_io_channel *));
@@ -134,24 +144,38 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		/*
 		 * Get the spdk_io_channel for all the base bdevs. This is used during
 		 * split logic to send the respective child bdev ios to respective base
-		 * bdev io channel.
+		 * bdev io channel. The base bdevs missing from a degraded raid bdev
+		 * don't get a channel.
 		 */
+		if (raid_bdev->base_bdev_info[i].desc == NULL) {
+			continue;
+		}
 		raid_ch->base_channel[i] = spdk_bdev_get_io_channel(
 						   raid_bdev->base_bdev_info[i].desc);
 		if (!raid_ch->base_channel[i]) {
-			uint8_t j;
-
-			for (j = 0; j < i; j++) {
-				spdk_put_io_channel(raid_ch->base_channel[j]);
-			}
-			free(raid_ch->base_channel);
-			raid_ch->base_channel = NULL;
 			SPDK_ERRLOG("Unable to create io channel for base bdev\n");
-			return -ENOMEM;
+			goto err;
+		}
+	}
+
+	if (raid_bdev->module->get_io_channel) {
+		raid_ch->module_channel = raid_bdev->module->get_io_channel(raid_bdev);
+		if (!raid_ch->module_channel) {
+			SPDK_ERRLOG("Unable to create io channel for raid module\n");
+			goto err;
 		}
 	}
 
 	return 0;
+err:
+	for (i = 0; i < raid_ch->num_channels; i++) {
+		if (raid_ch->base_channel[i] != NULL) {
+			spdk_put_io_channel(raid_ch->base_channel[i]);
+		}
+	}
+	free(raid_ch->base_channel);
+	raid_ch->base_channel = NULL;
+	return -ENOMEM;
 }
 
 /*
@@ -174,10 +198,19 @@ raid_bdev_destroy_cb(void *io_device, void *ctx_buf)
 
 	assert(raid_ch != NULL);
 	assert(raid_ch->base_channel);
+
+	if (raid_ch->module_channel) {
+		spdk_put_io_channel(raid_ch->module_channel);
+		raid_ch->module_channel = NULL;
+	}
+
+	assert(TAILQ_EMPTY(&raid_ch->ios));
+
 	for (i = 0; i < raid_ch->num_channels; i++) {
 		/* Free base bdev channels */
-		assert(raid_ch->base_channel[i] != NULL);
-		spdk_put_io_channel(raid_ch->base_channel[i]);
+		if (raid_ch->base_channel[i] != NULL) {
+			spdk_put_io_channel(raid_ch->base_channel[i]);
+		}
 	}
 	free(raid_ch->base_channel);
 	raid_ch->base_channel = NULL;
@@ -252,11 +285,37 @@ raid_bdev_free_base_bdev_resource(struct raid_bdev *raid_bdev,
 	}
 	base_info->desc = NULL;
 	base_info->bdev = NULL;
+	base_info->rebuilding = false;
+	base_info->rebuild_checkpoint = 0;
+	base_info->resync = false;
 
 	assert(raid_bdev->num_base_bdevs_discovered);
 	raid_bdev->num_base_bdevs_discovered--;
 }
 
+/*
+ * brief:
+ * raid_bdev_destruct_finish unregisters the io device of the raid bdev
+ * params:
+ * raid_bdev - pointer to raid_bdev
+ * returns:
+ * none
+ */
+static void
+raid_bdev_destruct_finish(struct raid_bdev *raid_bdev)
+{
+	if (g_shutdown_started) {
+		TAILQ_REMOVE(&g_raid_bdev_configured_list, raid_bdev, state_link);
+		if (raid_bdev->module->stop != NULL) {
+			raid_bdev->module->stop(raid_bdev);
+		}
+		raid_bdev->state = RAID_BDEV_STATE_OFFLINE;
+		TAILQ_INSERT_TAIL(&g_raid_bdev_offline_list, raid_bdev, state_link);
+	}
+
+	spdk_io_device_unregister(raid_bdev, NULL);
+}
+
 /*
  * brief:
  * raid_bdev_destruct is the destruct function table pointer for raid bdev
@@ -264,7 +323,8 @@ raid_bdev_free_base_bdev_resource(struct raid_bdev *raid_bdev,
  * ctxt - pointer to raid_bdev
  * returns:
  * 0 - success
- * non zero - failure
+ * 1 - destruct will be completed when the pending base bdev updates are done
+ * negative - failure
  */
 static int
 raid_bdev_destruct(void *ctxt)
@@ -279,24 +339,23 @@ raid_bdev_destruct(void *ctxt)
 		/*
 		 * Close all base bdev descriptors for which call has come from below
 		 * layers.  Also close the descriptors if we have started shutdown.
+		 * Base bdevs being released from a degraded raid bdev have their
+		 * descriptor closed when that is done.
 		 */
-		if (g_shutdown_started ||
-		    ((base_info->remove_scheduled == true) &&
-		     (base_info->bdev != NULL))) {
+		if (base_info->desc == NULL) {
+			continue;
+		}
+		if (g_shutdown_started || base_info->remove_scheduled == true) {
 			raid_bdev_free_base_bdev_resource(raid_bdev, base_info);
 		}
 	}
 
-	if (g_shutdown_started) {
-		TAILQ_REMOVE(&g_raid_bdev_configured_list, raid_bdev, state_link);
-		if (raid_bdev->module->stop != NULL) {
-			raid_bdev->module->stop(raid_bdev);
-		}
-		raid_bdev->state = RAID_BDEV_STATE_OFFLINE;
-		TAILQ_INSERT_TAIL(&g_raid_bdev_offline_list, raid_bdev, state_link);
+	if (raid_bdev->num_base_bdev_updates > 0) {
+		/* The io device is still iterated, raid_bdev_base_bdev_update_done() finishes this */
+		return 1;
 	}
 
-	spdk_io_device_unregister(raid_bdev, NULL);
+	raid_bdev_destruct_finish(raid_bdev);
 
 	if (raid_bdev->num_base_bdevs_discovered == 0) {
 		/* Free raid_bdev when there are no base bdevs left */
@@ -312,9 +371,29 @@ raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status sta
 {
 	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
 
+	TAILQ_REMOVE(&raid_io->raid_ch->ios, raid_io, link);
 	spdk_bdev_io_complete(bdev_io, status);
 }
 
+/*
+ * brief:
+ * raid_bdev_channel_get_module_ctx returns the context of the raid module's
+ * own IO channel, obtained with the module's get_io_channel callback.
+ * params:
+ * raid_ch - pointer to raid bdev io channel
+ * returns:
+ * pointer to the module channel context or NULL if the module has no channel
+ */
+void *
+raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch)
+{
+	if (raid_ch->module_channel == NULL) {
+		return NULL;
+	}
+
+	return spdk_io_channel_get_ctx(raid_ch->module_channel);
+}
+
 /*
  * brief:
  * raid_bdev_io_complete_part - signal the completion of a part of the expected
@@ -425,6 +504,14 @@ raid_bdev_submit_reset_request(struct raid_bdev_io *raid_io)
 		i = raid_io->base_bdev_io_submitted;
 		base_info = &raid_bdev->base_bdev_info[i];
 		base_ch = raid_io->raid_ch->base_channel[i];
+		if (base_info->desc == NULL || base_ch == NULL) {
+			/* Nothing to reset on a missing base bdev */
+			raid_io->base_bdev_io_submitted++;
+			if (raid_bdev_io_complete_part(raid_io, 1, SPDK_BDEV_IO_STATUS_SUCCESS)) {
+				return;
+			}
+			continue;
+		}
 		ret = spdk_bdev_reset(base_info->desc, base_ch,
 				      raid_base_bdev_reset_complete, raid_io);
 		if (ret == 0) {
@@ -487,6 +574,8 @@ raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 	raid_io->base_bdev_io_remaining = 0;
 	raid_io->base_bdev_io_submitted = 0;
 	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	raid_io->seq = raid_io->raid_ch->io_seq++;
+	TAILQ_INSERT_TAIL(&raid_io->raid_ch->ios, raid_io, link);
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
@@ -540,7 +629,7 @@ _raid_bdev_io_type_supported(struct raid_bdev *raid_bdev, enum spdk_bdev_io_type
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		if (base_info->bdev == NULL) {
-			assert(false);
+			/* Missing base bdev of a degraded raid bdev */
 			continue;
 		}
 
@@ -603,25 +692,19 @@ raid_bdev_get_io_channel(void *ctxt)
 
 /*
  * brief:
- * raid_bdev_dump_info_json is the function table pointer for raid bdev
+ * raid_bdev_write_info_json writes the raid bdev configuration, state and raid
+ * module specific information to the json context
  * params:
- * ctx - pointer to raid_bdev
+ * raid_bdev - pointer to raid_bdev
  * w - pointer to json context
  * returns:
- * 0 - success
- * non zero - failure
+ * none
  */
-static int
-raid_bdev_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+void
+raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w)
 {
-	struct raid_bdev *raid_bdev = ctx;
 	struct raid_base_bdev_info *base_info;
 
-	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_dump_config_json\n");
-	assert(raid_bdev != NULL);
-
-	/* Dump the raid bdev configuration related information */
-	spdk_json_write_named_object_begin(w, "raid");
 	spdk_json_write_named_uint32(w, "strip_size_kb", raid_bdev->strip_size_kb);
 	spdk_json_write_named_uint32(w, "state", raid_bdev->state);
 	spdk_json_write_named_string(w, "raid_level", raid_bdev_level_to_str(raid_bdev->level));
@@ -638,6 +721,37 @@ raid_bdev_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 		}
 	}
 	spdk_json_write_array_end(w);
+
+	if (raid_bdev->rebuild != NULL) {
+		raid_bdev_rebuild_write_info_json(raid_bdev, w);
+	}
+
+	if (raid_bdev->module->dump_info_json != NULL) {
+		raid_bdev->module->dump_info_json(raid_bdev, w);
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_dump_info_json is the function table pointer for raid bdev
+ * params:
+ * ctx - pointer to raid_bdev
+ * w - pointer to json context
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+static int
+raid_bdev_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct raid_bdev *raid_bdev = ctx;
+
+	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_dump_config_json\n");
+	assert(raid_bdev != NULL);
+
+	/* Dump the raid bdev configuration related information */
+	spdk_json_write_named_object_begin(w, "raid");
+	raid_bdev_write_info_json(raid_bdev, w);
 	spdk_json_write_object_end(w);
 
 	return 0;
@@ -657,6 +771,7 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 {
 	struct raid_bdev *raid_bdev = bdev->ctxt;
 	struct raid_base_bdev_info *base_info;
+	uint8_t i;
 
 	spdk_json_write_object_begin(w);
 
@@ -668,9 +783,13 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 	spdk_json_write_named_string(w, "raid_level", raid_bdev_level_to_str(raid_bdev->level));
 
 	spdk_json_write_named_array_begin(w, "base_bdevs");
-	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
 		if (base_info->bdev) {
 			spdk_json_write_string(w, base_info->bdev->name);
+		} else if (raid_bdev->config != NULL && raid_bdev->config->base_bdev[i].name != NULL) {
+			/* Missing base bdev of a degraded raid bdev, added back when it appears */
+			spdk_json_write_string(w, raid_bdev->config->base_bdev[i].name);
 		}
 	}
 	spdk_json_write_array_end(w);
@@ -868,8 +987,12 @@ static struct {
 } g_raid_level_names[] = {
 	{ "raid0", RAID0 },
 	{ "0", RAID0 },
+	{ "raid1", RAID1 },
+	{ "1", RAID1 },
 	{ "raid5", RAID5 },
 	{ "5", RAID5 },
+	{ "raid6", RAID6 },
+	{ "6", RAID6 },
 	{ }
 };
 
@@ -987,12 +1110,58 @@ raid_bdev_can_claim_bdev(const char *bdev_name, struct raid_bdev_config **_raid_
 	return false;
 }
 
+void
+raid_bdev_get_opts(struct raid_bdev_opts *opts)
+{
+	*opts = g_raid_bdev_opts;
+}
+
+int
+raid_bdev_set_opts(const struct raid_bdev_opts *opts)
+{
+	if (opts->rebuild_window_size_kb == 0) {
+		SPDK_ERRLOG("Rebuild window size must be greater than 0\n");
+		return -EINVAL;
+	}
+
+	g_raid_bdev_opts = *opts;
+
+	return 0;
+}
+
+/*
+ * brief:
+ * raid_bdev_config_json writes the raid bdev module options to the json context
+ * params:
+ * w - pointer to json context
+ * returns:
+ * 0 - success
+ */
+static int
+raid_bdev_config_json(struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "method", "bdev_raid_set_options");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_uint32(w, "rebuild_window_size_kb",
+				     g_raid_bdev_opts.rebuild_window_size_kb);
+	spdk_json_write_named_uint32(w, "rebuild_max_bandwidth_mb_sec",
+				     g_raid_bdev_opts.rebuild_max_bandwidth_mb_sec);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
 
 static struct spdk_bdev_module g_raid_if = {
 	.name = "raid",
 	.module_init = raid_bdev_init,
 	.fini_start = raid_bdev_fini_start,
 	.module_fini = raid_bdev_exit,
+	.config_json = raid_bdev_config_json,
 	.get_ctx_size = raid_bdev_get_ctx_size,
 	.examine_config = raid_bdev_examine,
 	.async_init = false,
@@ -1132,11 +1301,17 @@ raid_bdev_alloc_base_bdev_resource(struct raid_bdev *raid_bdev, const char *bdev
 
 	SPDK_DEBUGLOG(bdev_raid, "bdev %s is claimed\n", bdev_name);
 
-	assert(raid_bdev->state != RAID_BDEV_STATE_ONLINE);
 	assert(base_bdev_slot < raid_bdev->num_base_bdevs);
+	assert(raid_bdev->base_bdev_info[base_bdev_slot].bdev == NULL);
 
 	raid_bdev->base_bdev_info[base_bdev_slot].thread = spdk_get_thread();
 	raid_bdev->base_bdev_info[base_bdev_slot].bdev = bdev;
+	raid_bdev->base_bdev_info[base_bdev_slot].remove_scheduled = false;
+	/* A base bdev added to an online raid bdev has to be rebuilt before it is read */
+	raid_bdev->base_bdev_info[base_bdev_slot].rebuilding = raid_bdev->state ==
+			RAID_BDEV_STATE_ONLINE;
+	raid_bdev->base_bdev_info[base_bdev_slot].rebuild_checkpoint = 0;
+	raid_bdev->base_bdev_info[base_bdev_slot].resync = false;
 	raid_bdev->base_bdev_info[base_bdev_slot].desc = desc;
 	raid_bdev->num_base_bdevs_discovered++;
 	assert(raid_bdev->num_base_bdevs_discovered <= raid_bdev->num_base_bdevs);
@@ -1166,7 +1341,11 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 	assert(raid_bdev->state == RAID_BDEV_STATE_CONFIGURING);
 	assert(raid_bdev->num_base_bdevs_discovered == raid_bdev->num_base_bdevs);
 
+	raid_bdev->base_bdev_min_blockcnt = UINT64_MAX;
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		raid_bdev->base_bdev_min_blockcnt = spdk_min(raid_bdev->base_bdev_min_blockcnt,
+						    base_info->bdev->blockcnt);
+
 		/* Check blocklen for all base bdevs that it should be same */
 		if (blocklen == 0) {
 			blocklen = base_info->bdev->blocklen;
@@ -1245,7 +1424,6 @@ raid_bdev_deconfigure(struct raid_bdev *raid_bdev, raid_bdev_destruct_cb cb_fn,
 		return;
 	}
 
-	assert(raid_bdev->num_base_bdevs == raid_bdev->num_base_bdevs_discovered);
 	TAILQ_REMOVE(&g_raid_bdev_configured_list, raid_bdev, state_link);
 	if (raid_bdev->module->stop != NULL) {
 		raid_bdev->module->stop(raid_bdev);
@@ -1290,6 +1468,257 @@ raid_bdev_find_by_base_bdev(struct spdk_bdev *base_bdev, struct raid_bdev **_rai
 	return false;
 }
 
+/*
+ * A base bdev slot update, i.e. a base bdev added to or released from an online
+ * raid bdev, applied to all the raid bdev channels
+ */
+struct raid_bdev_base_bdev_update {
+	struct raid_bdev		*raid_bdev;
+	struct raid_base_bdev_info	*base_info;
+
+	/* Descriptor of the base bdev being released */
+	struct spdk_bdev_desc		*desc;
+
+	/* State of the release from the channel being iterated */
+	struct spdk_io_channel_iter	*iter;
+	struct spdk_io_channel		*base_ch;
+	uint64_t			io_seq;
+	struct spdk_poller		*poller;
+};
+
+/* Period of checking if the raid IOs using a released base bdev channel are done */
+#define RAID_BDEV_RELEASE_POLL_PERIOD_US 100
+
+static inline uint8_t
+raid_bdev_base_bdev_slot(const struct raid_bdev *raid_bdev,
+			 const struct raid_base_bdev_info *base_info)
+{
+	return base_info - raid_bdev->base_bdev_info;
+}
+
+/*
+ * brief:
+ * raid_bdev_base_bdev_update_done is called when a base bdev slot update is done
+ * and completes the destruct of the raid bdev if it was waiting for it
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * returns:
+ * none
+ */
+static void
+raid_bdev_base_bdev_update_done(struct raid_bdev *raid_bdev)
+{
+	bool cleanup;
+
+	assert(raid_bdev->num_base_bdev_updates > 0);
+	raid_bdev->num_base_bdev_updates--;
+
+	if (!raid_bdev->destruct_called || raid_bdev->num_base_bdev_updates > 0) {
+		return;
+	}
+
+	raid_bdev_destruct_finish(raid_bdev);
+
+	/* The unregister callback may free the config, detach it first */
+	cleanup = raid_bdev->num_base_bdevs_discovered == 0;
+	if (cleanup && raid_bdev->config != NULL) {
+		raid_bdev->config->raid_bdev = NULL;
+		raid_bdev->config = NULL;
+	}
+
+	spdk_bdev_destruct_done(&raid_bdev->bdev, 0);
+
+	if (cleanup) {
+		raid_bdev_cleanup(raid_bdev);
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_channel_base_bdev_released checks if the raid IOs submitted to the
+ * channel being iterated before the base bdev was released are done and puts the
+ * base bdev channel if so
+ * params:
+ * update - base bdev slot update
+ * returns:
+ * true - base bdev channel is not used anymore
+ * false - some raid IOs may still use it
+ */
+static bool
+raid_bdev_channel_base_bdev_released(struct raid_bdev_base_bdev_update *update)
+{
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(update->iter);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	struct raid_bdev_io *raid_io = TAILQ_FIRST(&raid_ch->ios);
+
+	if (update->base_ch == NULL) {
+		return true;
+	}
+
+	if (raid_io != NULL && raid_io->seq < update->io_seq) {
+		return false;
+	}
+
+	spdk_put_io_channel(update->base_ch);
+	update->base_ch = NULL;
+
+	return true;
+}
+
+static int
+raid_bdev_channel_release_poll(void *arg)
+{
+	struct raid_bdev_base_bdev_update *update = arg;
+
+	if (!raid_bdev_channel_base_bdev_released(update)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&update->poller);
+	spdk_for_each_channel_continue(update->iter, 0);
+
+	return SPDK_POLLER_BUSY;
+}
+
+/*
+ * brief:
+ * raid_bdev_channel_release_base_bdev stops new raid IOs from using the channel
+ * of the released base bdev and puts it when the raid IOs that may still use it
+ * are done
+ * params:
+ * i - io channel iterator
+ * returns:
+ * none
+ */
+static void
+raid_bdev_channel_release_base_bdev(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_base_bdev_update *update = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	uint8_t slot = raid_bdev_base_bdev_slot(update->raid_bdev, update->base_info);
+
+	update->iter = i;
+	update->base_ch = raid_ch->base_channel[slot];
+	update->io_seq = raid_ch->io_seq;
+	raid_ch->base_channel[slot] = NULL;
+
+	if (raid_bdev_channel_base_bdev_released(update)) {
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+
+	update->poller = SPDK_POLLER_REGISTER(raid_bdev_channel_release_poll, update,
+					      RAID_BDEV_RELEASE_POLL_PERIOD_US);
+}
+
+static void
+raid_bdev_release_base_bdev_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_base_bdev_update *update = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = update->raid_bdev;
+	struct raid_base_bdev_info *base_info = update->base_info;
+
+	assert(status == 0);
+
+	SPDK_NOTICELOG("Base bdev %s released from raid bdev %s\n", base_info->bdev->name,
+		       raid_bdev->bdev.name);
+
+	base_info->desc = update->desc;
+	raid_bdev_free_base_bdev_resource(raid_bdev, base_info);
+	free(update);
+
+	raid_bdev_base_bdev_update_done(raid_bdev);
+}
+
+static void
+_raid_bdev_release_base_bdev(void *ctx)
+{
+	struct raid_bdev_base_bdev_update *update = ctx;
+
+	spdk_for_each_channel(update->raid_bdev, raid_bdev_channel_release_base_bdev, update,
+			      raid_bdev_release_base_bdev_done);
+}
+
+/*
+ * brief:
+ * raid_bdev_can_release_base_bdev checks if the raid bdev can stay online
+ * without the base bdev
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * base_info - base bdev to release
+ * returns:
+ * true - the raid bdev can run degraded without the base bdev
+ * false - the raid bdev has to go offline
+ */
+static bool
+raid_bdev_can_release_base_bdev(struct raid_bdev *raid_bdev,
+				struct raid_base_bdev_info *base_info)
+{
+	struct raid_base_bdev_info *iter;
+	uint8_t operational = 0;
+
+	if (raid_bdev->state != RAID_BDEV_STATE_ONLINE || raid_bdev->destruct_called ||
+	    raid_bdev->destroy_started || raid_bdev_max_degraded(raid_bdev) == 0) {
+		return false;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, iter) {
+		if (iter != base_info && iter->desc != NULL && !iter->remove_scheduled &&
+		    !iter->rebuilding) {
+			operational++;
+		}
+	}
+
+	return operational >= raid_bdev->num_base_bdevs - raid_bdev_max_degraded(raid_bdev);
+}
+
+/*
+ * brief:
+ * raid_bdev_release_base_bdev releases the base bdev from the online raid bdev,
+ * which keeps running degraded. The base bdev descriptor is closed once none of
+ * the raid bdev channels uses the base bdev anymore. If the base bdev is being
+ * rebuilt, the rebuild is stopped first.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * base_info - base bdev to release
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+static int
+raid_bdev_release_base_bdev(struct raid_bdev *raid_bdev, struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev_base_bdev_update *update;
+
+	update = calloc(1, sizeof(*update));
+	if (!update) {
+		return -ENOMEM;
+	}
+
+	SPDK_NOTICELOG("Releasing base bdev %s from raid bdev %s\n", base_info->bdev->name,
+		       raid_bdev->bdev.name);
+
+	update->raid_bdev = raid_bdev;
+	update->base_info = base_info;
+	update->desc = base_info->desc;
+
+	/* No new IO gets to the base bdev from now on */
+	base_info->desc = NULL;
+	base_info->remove_scheduled = true;
+	raid_bdev->num_base_bdev_updates++;
+
+	if (raid_bdev->rebuild != NULL &&
+	    raid_bdev_rebuild_get_base_idx(raid_bdev->rebuild) ==
+	    raid_bdev_base_bdev_slot(raid_bdev, base_info)) {
+		raid_bdev_rebuild_stop(raid_bdev, _raid_bdev_release_base_bdev, update);
+	} else {
+		_raid_bdev_release_base_bdev(update);
+	}
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_remove_base_bdev function is called by below layers when base_bdev
@@ -1314,7 +1743,16 @@ raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev)
 		return;
 	}
 
-	assert(base_info->desc);
+	if (base_info->desc == NULL) {
+		SPDK_DEBUGLOG(bdev_raid, "bdev '%s' is already being released\n", base_bdev->name);
+		return;
+	}
+
+	if (raid_bdev_can_release_base_bdev(raid_bdev, base_info) &&
+	    raid_bdev_release_base_bdev(raid_bdev, base_info) == 0) {
+		return;
+	}
+
 	base_info->remove_scheduled = true;
 
 	if (raid_bdev->destruct_called == true ||
@@ -1334,6 +1772,45 @@ raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev)
 	raid_bdev_deconfigure(raid_bdev, NULL, NULL);
 }
 
+/*
+ * brief:
+ * raid_bdev_remove_base_bdev_by_name removes a base bdev from its raid bdev.
+ * A base bdev can't be removed from an online raid bdev that can't run without it.
+ * params:
+ * bdev_name - name of the base bdev
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_remove_base_bdev_by_name(const char *bdev_name)
+{
+	struct spdk_bdev *bdev;
+	struct raid_bdev *raid_bdev;
+	struct raid_base_bdev_info *base_info;
+
+	bdev = spdk_bdev_get_by_name(bdev_name);
+	if (bdev == NULL || !raid_bdev_find_by_base_bdev(bdev, &raid_bdev, &base_info)) {
+		SPDK_ERRLOG("Base bdev %s is not part of any raid bdev\n", bdev_name);
+		return -ENODEV;
+	}
+
+	if (base_info->desc == NULL) {
+		return -EALREADY;
+	}
+
+	if (raid_bdev->state == RAID_BDEV_STATE_ONLINE &&
+	    !raid_bdev_can_release_base_bdev(raid_bdev, base_info)) {
+		SPDK_ERRLOG("Raid bdev %s can't run without base bdev %s\n", raid_bdev->bdev.name,
+			    bdev_name);
+		return -EBUSY;
+	}
+
+	raid_bdev_remove_base_bdev(bdev);
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_event_base_bdev function is called by below layers when base_bdev
@@ -1398,11 +1875,11 @@ raid_bdev_remove_base_devices(struct raid_bdev_config *raid_cfg,
 	raid_bdev->destroy_started = true;
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
-		if (base_info->bdev == NULL) {
+		if (base_info->bdev == NULL || base_info->desc == NULL) {
+			/* Missing or being released from the degraded raid bdev */
 			continue;
 		}
 
-		assert(base_info->desc);
 		base_info->remove_scheduled = true;
 
 		if (raid_bdev->destruct_called == true ||
@@ -1426,6 +1903,124 @@ raid_bdev_remove_base_devices(struct raid_bdev_config *raid_cfg,
 	raid_bdev_deconfigure(raid_bdev, cb_fn, cb_arg);
 }
 
+static void
+raid_bdev_channel_add_base_bdev(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_base_bdev_update *update = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	uint8_t slot = raid_bdev_base_bdev_slot(update->raid_bdev, update->base_info);
+	int rc = 0;
+
+	/* Channels created after the base bdev was added already have it */
+	if (update->base_info->desc != NULL && raid_ch->base_channel[slot] == NULL) {
+		raid_ch->base_channel[slot] = spdk_bdev_get_io_channel(update->base_info->desc);
+		if (raid_ch->base_channel[slot] == NULL) {
+			SPDK_ERRLOG("Unable to create io channel for base bdev\n");
+			rc = -ENOMEM;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+static void
+raid_bdev_add_base_bdev_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_base_bdev_update *update = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = update->raid_bdev;
+	struct raid_base_bdev_info *base_info = update->base_info;
+	int rc = status;
+
+	free(update);
+
+	/* The base bdev may have been removed in the meantime */
+	if (base_info->desc != NULL) {
+		/* Base bdevs added while another one is rebuilt wait for their turn */
+		if (rc == 0 && raid_bdev->rebuild == NULL) {
+			rc = raid_bdev_rebuild_start(raid_bdev, raid_bdev_base_bdev_slot(raid_bdev, base_info));
+		}
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to start rebuild of base bdev %s: %s\n", base_info->bdev->name,
+				    spdk_strerror(-rc));
+			raid_bdev_remove_base_bdev(base_info->bdev);
+		}
+	}
+
+	raid_bdev_base_bdev_update_done(raid_bdev);
+}
+
+/*
+ * brief:
+ * raid_bdev_add_base_device_online adds a base bdev to an empty slot of an online
+ * degraded raid bdev. The base bdev content is rebuilt in the background, it is
+ * only read below the rebuild checkpoint until then.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * bdev_name - base bdev name
+ * base_bdev_slot - position to add base bdev
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+static int
+raid_bdev_add_base_device_online(struct raid_bdev *raid_bdev, const char *bdev_name,
+				 uint8_t base_bdev_slot)
+{
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[base_bdev_slot];
+	struct raid_bdev_base_bdev_update *update;
+	struct spdk_bdev *bdev;
+	int rc;
+
+	if (raid_bdev->module->rebuild_base_bdev_data == NULL) {
+		SPDK_ERRLOG("Base bdevs can't be added to online %s bdev '%s'\n",
+			    raid_bdev_level_to_str(raid_bdev->level), raid_bdev->bdev.name);
+		return -ENOTSUP;
+	}
+
+	if (raid_bdev->destruct_called || raid_bdev->destroy_started) {
+		return -EBUSY;
+	}
+
+	if (base_info->bdev != NULL) {
+		SPDK_ERRLOG("Slot %u of raid bdev '%s' is in use\n", base_bdev_slot,
+			    raid_bdev->bdev.name);
+		return -EBUSY;
+	}
+
+	update = calloc(1, sizeof(*update));
+	if (!update) {
+		return -ENOMEM;
+	}
+
+	rc = raid_bdev_alloc_base_bdev_resource(raid_bdev, bdev_name, base_bdev_slot);
+	if (rc != 0) {
+		free(update);
+		return rc;
+	}
+
+	bdev = base_info->bdev;
+	if (bdev->blocklen != raid_bdev->bdev.blocklen ||
+	    bdev->blockcnt < raid_bdev->base_bdev_min_blockcnt) {
+		SPDK_ERRLOG("Base bdev '%s' is too small or has a different block size\n", bdev_name);
+		raid_bdev_free_base_bdev_resource(raid_bdev, base_info);
+		free(update);
+		return -EINVAL;
+	}
+
+	SPDK_NOTICELOG("Base bdev %s added to raid bdev %s, starting rebuild\n", bdev_name,
+		       raid_bdev->bdev.name);
+
+	update->raid_bdev = raid_bdev;
+	update->base_info = base_info;
+	raid_bdev->num_base_bdev_updates++;
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_add_base_bdev, update,
+			      raid_bdev_add_base_bdev_done);
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_add_base_device function is the actual function which either adds
@@ -1452,6 +2047,10 @@ raid_bdev_add_base_device(struct raid_bdev_config *raid_cfg, const char *bdev_na
 		return -ENODEV;
 	}
 
+	if (raid_bdev->state == RAID_BDEV_STATE_ONLINE) {
+		return raid_bdev_add_base_device_online(raid_bdev, bdev_name, base_bdev_slot);
+	}
+
 	rc = raid_bdev_alloc_base_bdev_resource(raid_bdev, bdev_name, base_bdev_slot);
 	if (rc != 0) {
 		if (rc != -ENODEV) {
@@ -1511,6 +2110,62 @@ raid_bdev_add_base_devices(struct raid_bdev_config *raid_cfg)
 	return rc;
 }
 
+/*
+ * brief:
+ * raid_bdev_add_base_bdev adds a base bdev to a missing slot of a raid bdev. An
+ * online raid bdev rebuilds the content of the base bdev. The slot configured
+ * with the same base bdev name is used first, then the first missing one.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * bdev_name - base bdev name
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *bdev_name)
+{
+	struct raid_bdev_config *raid_cfg = raid_bdev->config;
+	uint8_t slot = UINT8_MAX;
+	char *old_name;
+	uint8_t i;
+	int rc;
+
+	if (raid_cfg == NULL || spdk_bdev_get_by_name(bdev_name) == NULL) {
+		return -ENODEV;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_bdev->base_bdev_info[i].bdev != NULL) {
+			continue;
+		}
+		if (raid_cfg->base_bdev[i].name != NULL &&
+		    strcmp(raid_cfg->base_bdev[i].name, bdev_name) == 0) {
+			slot = i;
+			break;
+		}
+		if (slot == UINT8_MAX) {
+			slot = i;
+		}
+	}
+
+	if (slot == UINT8_MAX) {
+		SPDK_ERRLOG("Raid bdev '%s' has no missing base bdev\n", raid_bdev->bdev.name);
+		return -EEXIST;
+	}
+
+	old_name = raid_cfg->base_bdev[slot].name;
+	raid_cfg->base_bdev[slot].name = NULL;
+	rc = raid_bdev_config_add_base_bdev(raid_cfg, bdev_name, slot);
+	if (rc != 0) {
+		raid_cfg->base_bdev[slot].name = old_name;
+		return rc;
+	}
+	free(old_name);
+
+	return raid_bdev_add_base_device(raid_cfg, bdev_name, slot);
+}
+
 /*
  * brief:
  * raid_bdev_examine function is the examine function call by the below layers
@@ -39,7 +39,9 @@
 enum raid_level {
 	INVALID_RAID_LEVEL	= -1,
 	RAID0			= 0,
+	RAID1			= 1,
 	RAID5			= 5,
+	RAID6			= 6,
 };
 
 /*
@@ -87,6 +89,20 @@ struct raid_base_bdev_info {
 
 	/* thread where base device is opened */
 	struct spdk_thread	*thread;
+
+	/*
+	 * Set while the base bdev is being rebuilt. Only its blocks below the
+	 * rebuild checkpoint hold valid data, the rest is not accessed by the
+	 * raid modules until the rebuild gets there.
+	 */
+	bool			rebuilding;
+	uint64_t		rebuild_checkpoint;
+
+	/*
+	 * Set if the base bdev only needs to be resynchronized, i.e. it is rebuilt
+	 * but only the ranges the raid module reports as out of sync are copied.
+	 */
+	bool			resync;
 };
 
 /*
@@ -106,7 +122,11 @@ struct raid_bdev_io {
 	/* Used for tracking progress on io requests sent to member disks. */
 	uint64_t			base_bdev_io_remaining;
 	uint8_t				base_bdev_io_submitted;
-	uint8_t				base_bdev_io_status;
+	enum spdk_bdev_io_status	base_bdev_io_status;
+
+	/* Link in the channel list of IOs in progress and submission sequence number */
+	TAILQ_ENTRY(raid_bdev_io)	link;
+	uint64_t			seq;
 };
 
 /*
@@ -160,11 +180,20 @@ struct raid_bdev {
 	/* Set to true if destroy of this raid bdev is started. */
 	bool				destroy_started;
 
+	/* Number of base bdevs being added to or released from the raid bdev channels */
+	uint8_t				num_base_bdev_updates;
+
+	/* Number of blocks of the smallest base bdev the raid bdev was started with */
+	uint64_t			base_bdev_min_blockcnt;
+
 	/* Module for RAID-level specific operations */
 	struct raid_bdev_module		*module;
 
 	/* Private data for the raid module */
 	void				*module_private;
+
+	/* Rebuild of a base bdev in progress, NULL if there is none */
+	struct raid_bdev_rebuild	*rebuild;
 };
 
 #define RAID_FOR_EACH_BASE_BDEV(r, i) \
@@ -226,6 +255,18 @@ struct raid_bdev_io_channel {
 
 	/* Number of IO channels */
 	uint8_t			num_channels;
+
+	/* Private raid module IO channel */
+	struct spdk_io_channel	*module_channel;
+
+	/*
+	 * IOs in progress on this channel, in submission order, used to find out
+	 * when the channel of a removed base bdev can't be used by any IO anymore.
+	 */
+	TAILQ_HEAD(, raid_bdev_io) ios;
+
+	/* Sequence number of the next IO submitted on this channel */
+	uint64_t		io_seq;
 };
 
 /* TAIL heads for various raid bdev lists */
@@ -242,6 +283,18 @@ extern struct raid_config		g_raid_config;
 
 typedef void (*raid_bdev_destruct_cb)(void *cb_ctx, int rc);
 
+/* Options of the raid bdev module */
+struct raid_bdev_opts {
+	/* Size of the base bdev range rebuilt at once, in KB */
+	uint32_t rebuild_window_size_kb;
+
+	/* Maximum rebuild bandwidth per raid bdev, in MB/s, 0 for no limit */
+	uint32_t rebuild_max_bandwidth_mb_sec;
+};
+
+void raid_bdev_get_opts(struct raid_bdev_opts *opts);
+int raid_bdev_set_opts(const struct raid_bdev_opts *opts);
+
 int raid_bdev_create(struct raid_bdev_config *raid_cfg);
 int raid_bdev_add_base_devices(struct raid_bdev_config *raid_cfg);
 void raid_bdev_remove_base_devices(struct raid_bdev_config *raid_cfg,
@@ -254,6 +307,9 @@ void raid_bdev_config_cleanup(struct raid_bdev_config *raid_cfg);
 struct raid_bdev_config *raid_bdev_config_find_by_name(const char *raid_name);
 enum raid_level raid_bdev_parse_raid_level(const char *str);
 const char *raid_bdev_level_to_str(enum raid_level level);
+void raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
+int raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *bdev_name);
+int raid_bdev_remove_base_bdev_by_name(const char *bdev_name);
 
 /*
  * RAID module descriptor
@@ -267,7 +323,8 @@ struct raid_bdev_module {
 
 	/*
 	 * Maximum number of base bdevs that can be removed without failing
-	 * the array.
+	 * the array. RAID_BDEV_MAX_DEGRADED_ALL_BUT_ONE if the array keeps
+	 * working as long as one base bdev is left.
 	 */
 	uint8_t base_bdevs_max_degraded;
 
@@ -292,9 +349,44 @@ struct raid_bdev_module {
 	/* Handler for requests without payload (flush, unmap). Optional. */
 	void (*submit_null_payload_request)(struct raid_bdev_io *raid_io);
 
+	/*
+	 * Called when a raid bdev IO channel is created, to get the raid module's
+	 * own IO channel for the current thread. The module context can later be
+	 * obtained with raid_bdev_channel_get_module_ctx(). Optional.
+	 */
+	struct spdk_io_channel *(*get_io_channel)(struct raid_bdev *raid_bdev);
+
+	/*
+	 * Called to dump the raid module specific information and statistics of
+	 * the raid bdev into the "raid" object of the bdev info. Optional.
+	 */
+	void (*dump_info_json)(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
+
+	/*
+	 * Called by the rebuild process to generate the content of num_blocks
+	 * blocks of the base bdev base_idx, starting at base_offset_blocks, into
+	 * base_buf. Both are multiples of the strip size and stripe_buf holds the
+	 * data of the corresponding stripes, as read from the raid bdev. Required
+	 * for the base bdevs of the raid bdev to be rebuilt.
+	 */
+	int (*rebuild_base_bdev_data)(struct raid_bdev *raid_bdev, uint8_t base_idx,
+				      uint64_t base_offset_blocks, uint64_t num_blocks,
+				      void *stripe_buf, void *base_buf);
+
+	/*
+	 * Called by the rebuild process of a base bdev being resynchronized to
+	 * check if num_blocks blocks of the base bdev base_idx, starting at
+	 * base_offset_blocks, are out of sync. The ranges that are not get
+	 * skipped. Required for the base bdevs to be resynchronized.
+	 */
+	bool (*rebuild_range_needed)(struct raid_bdev *raid_bdev, uint8_t base_idx,
+				     uint64_t base_offset_blocks, uint64_t num_blocks);
+
 	TAILQ_ENTRY(raid_bdev_module) link;
 };
 
+#define RAID_BDEV_MAX_DEGRADED_ALL_BUT_ONE UINT8_MAX
+
 void raid_bdev_module_list_add(struct raid_bdev_module *raid_module);
 
 #define __RAID_MODULE_REGISTER(line) __RAID_MODULE_REGISTER_(line)
@@ -307,6 +399,74 @@ __RAID_MODULE_REGISTER(__LINE__)(void)					\
     raid_bdev_module_list_add(_module);					\
 }
 
+/* Maximum number of base bdevs the raid bdev can run without */
+static inline uint8_t
+raid_bdev_max_degraded(const struct raid_bdev *raid_bdev)
+{
+	if (raid_bdev->module->base_bdevs_max_degraded == RAID_BDEV_MAX_DEGRADED_ALL_BUT_ONE) {
+		return raid_bdev->num_base_bdevs - 1;
+	}
+
+	return raid_bdev->module->base_bdevs_max_degraded;
+}
+
+/*
+ * Stripe geometry of the parity raid levels. Each stripe has one strip on every
+ * base bdev and base_bdevs_max_degraded of them hold the parity. The parity
+ * rotates across the base bdevs from the last one to the first one and the data
+ * strips of a stripe start right after the parity strips (left-symmetric
+ * layout), so sequential IO touches all base bdevs evenly.
+ */
+static inline uint8_t
+raid_bdev_stripe_data_strips_num(const struct raid_bdev *raid_bdev)
+{
+	return raid_bdev->num_base_bdevs - raid_bdev_max_degraded(raid_bdev);
+}
+
+/* Index of the base bdev holding the parity strip parity_num (0 for P, 1 for Q) of a stripe */
+static inline uint8_t
+raid_bdev_stripe_parity_base_idx(const struct raid_bdev *raid_bdev, uint64_t stripe_index,
+				 uint8_t parity_num)
+{
+	uint8_t num_base_bdevs = raid_bdev->num_base_bdevs;
+
+	return (num_base_bdevs - 1 - stripe_index % num_base_bdevs + parity_num) % num_base_bdevs;
+}
+
+/* Index of the base bdev holding the data strip data_num of a stripe */
+static inline uint8_t
+raid_bdev_stripe_data_base_idx(const struct raid_bdev *raid_bdev, uint64_t stripe_index,
+			       uint8_t data_num)
+{
+	return raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index,
+						raid_bdev->module->base_bdevs_max_degraded + data_num);
+}
+
+/* Number of blocks of each base bdev used by the stripes of the raid bdev */
+static inline uint64_t
+raid_bdev_base_bdev_blockcnt(const struct raid_bdev *raid_bdev)
+{
+	return raid_bdev->bdev.blockcnt / raid_bdev_stripe_data_strips_num(raid_bdev);
+}
+
+/*
+ * Check if the raid IO can access the blocks of a base bdev starting at
+ * base_offset_blocks. The base bdev may be missing or, while it is being
+ * rebuilt, hold valid data only below the rebuild checkpoint. The checkpoint
+ * only moves forward and the range it passes is locked for writing until the
+ * new value is published, so a stale value can only make a read reconstruct
+ * data that is already there.
+ */
+static inline bool
+raid_bdev_io_base_bdev_available(const struct raid_bdev_io *raid_io, uint8_t base_idx,
+				 uint64_t base_offset_blocks)
+{
+	const struct raid_base_bdev_info *base_info = &raid_io->raid_bdev->base_bdev_info[base_idx];
+
+	return base_info->desc != NULL && raid_io->raid_ch->base_channel[base_idx] != NULL &&
+	       (!base_info->rebuilding || base_offset_blocks < base_info->rebuild_checkpoint);
+}
+
 bool
 raid_bdev_io_complete_part(struct raid_bdev_io *raid_io, uint64_t completed,
 			   enum spdk_bdev_io_status status);
@@ -315,5 +475,12 @@ raid_bdev_queue_io_wait(struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
 			struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn);
 void
 raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status);
+void *
+raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch);
+
+int raid_bdev_rebuild_start(struct raid_bdev *raid_bdev, uint8_t base_idx);
+uint8_t raid_bdev_rebuild_get_base_idx(const struct raid_bdev_rebuild *rebuild);
+void raid_bdev_rebuild_stop(struct raid_bdev *raid_bdev, void (*cb_fn)(void *cb_arg), void *cb_arg);
+void raid_bdev_rebuild_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
 
 #endif /* SPDK_BDEV_RAID_INTERNAL_H */
@@ -0,0 +1,608 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "bdev_raid.h"
+
+#include "spdk/env.h"
+#include "spdk/thread.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#include "spdk/log.h"
+
+/* Bounds of the delay between two rebuild windows */
+#define RAID_BDEV_REBUILD_DELAY_MIN_US 100
+#define RAID_BDEV_REBUILD_DELAY_MAX_US (100 * 1000)
+
+/*
+ * A window taking more than this many times the best recent window time is
+ * considered slowed down by the foreground IO and the rebuild backs off.
+ */
+#define RAID_BDEV_REBUILD_LATENCY_FACTOR 2
+
+/* The best window time grows by 1/2^shift every window, so that it follows load changes */
+#define RAID_BDEV_REBUILD_LATENCY_DECAY_SHIFT 4
+
+struct raid_bdev_rebuild {
+	struct raid_bdev		*raid_bdev;
+
+	/* The rebuilt base bdev, its descriptor and channel */
+	uint8_t				base_idx;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_io_channel		*base_ch;
+
+	/* Descriptor and channel of the raid bdev, the data of the stripes is read through it */
+	struct spdk_bdev_desc		*desc;
+	struct spdk_io_channel		*ch;
+
+	/* Data of the stripes of a window and the rebuilt content of the base bdev */
+	void				*stripe_buf;
+	void				*base_buf;
+
+	uint8_t				data_strips;
+
+	/* Window being rebuilt, in base bdev blocks */
+	uint64_t			offset;
+	uint64_t			num_blocks;
+
+	uint64_t			window_blocks;
+	uint64_t			total_blocks;
+
+	/* Rate control */
+	uint64_t			start_tsc;
+	/* Checkpoint the rebuild was started or resumed from */
+	uint64_t			start_offset;
+	uint64_t			window_tsc;
+	uint64_t			best_window_ticks;
+	uint64_t			delay_us;
+	struct spdk_poller		*delay_poller;
+
+	/* Status of the window being rebuilt */
+	int				status;
+
+	bool				stopping;
+	void				(*stop_cb)(void *cb_arg);
+	void				*stop_cb_arg;
+
+	struct spdk_bdev_io_wait_entry	waitq_entry;
+};
+
+static void raid_bdev_rebuild_window_start(struct raid_bdev_rebuild *rebuild);
+
+uint8_t
+raid_bdev_rebuild_get_base_idx(const struct raid_bdev_rebuild *rebuild)
+{
+	return rebuild->base_idx;
+}
+
+static void
+raid_bdev_rebuild_free(struct raid_bdev_rebuild *rebuild)
+{
+	if (rebuild->base_ch) {
+		spdk_put_io_channel(rebuild->base_ch);
+	}
+	if (rebuild->ch) {
+		spdk_put_io_channel(rebuild->ch);
+	}
+	if (rebuild->desc) {
+		spdk_bdev_close(rebuild->desc);
+	}
+	spdk_free(rebuild->stripe_buf);
+	spdk_free(rebuild->base_buf);
+	free(rebuild);
+}
+
+/* Start the rebuild of the next base bdev waiting for it, if there is any */
+static void
+raid_bdev_rebuild_next(struct raid_bdev *raid_bdev)
+{
+	struct raid_base_bdev_info *base_info;
+	int rc;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (!base_info->rebuilding || base_info->desc == NULL) {
+			continue;
+		}
+
+		rc = raid_bdev_rebuild_start(raid_bdev, base_info - raid_bdev->base_bdev_info);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to start rebuild of base bdev %s: %s\n", base_info->bdev->name,
+				    spdk_strerror(-rc));
+			raid_bdev_remove_base_bdev_by_name(base_info->bdev->name);
+			continue;
+		}
+
+		return;
+	}
+}
+
+static void
+raid_bdev_rebuild_finish(struct raid_bdev_rebuild *rebuild, int status)
+{
+	struct raid_bdev *raid_bdev = rebuild->raid_bdev;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[rebuild->base_idx];
+	void (*stop_cb)(void *cb_arg) = rebuild->stop_cb;
+	void *stop_cb_arg = rebuild->stop_cb_arg;
+	bool stopping = rebuild->stopping;
+
+	assert(raid_bdev->rebuild == rebuild);
+	raid_bdev->rebuild = NULL;
+
+	if (status == 0) {
+		SPDK_NOTICELOG("Rebuild of base bdev %s of raid bdev %s done in %" PRIu64 " s\n",
+			       base_info->bdev->name, raid_bdev->bdev.name,
+			       (spdk_get_ticks() - rebuild->start_tsc) / spdk_get_ticks_hz());
+		base_info->rebuilding = false;
+		base_info->resync = false;
+	} else if (!stopping) {
+		SPDK_ERRLOG("Rebuild of base bdev %s of raid bdev %s failed at block %" PRIu64 ": %s\n",
+			    base_info->bdev->name, raid_bdev->bdev.name, rebuild->offset,
+			    spdk_strerror(-status));
+	}
+
+	if (!stopping && status != 0) {
+		/* Don't keep a base bdev that is never going to be in sync */
+		raid_bdev_remove_base_bdev_by_name(base_info->bdev->name);
+	}
+
+	/*
+	 * A rebuild stopped without a callback is stopped because the raid bdev is
+	 * going away. Otherwise go on with the next base bdev, before the raid bdev
+	 * descriptor is closed as the raid bdev may be freed after that.
+	 */
+	if (!stopping || stop_cb != NULL) {
+		raid_bdev_rebuild_next(raid_bdev);
+	}
+
+	raid_bdev_rebuild_free(rebuild);
+
+	if (stop_cb) {
+		stop_cb(stop_cb_arg);
+	}
+}
+
+/*
+ * Adjust the delay before the next window. The time a window takes, compared to
+ * the best recent one, tells how busy the base bdevs are with foreground IO: the
+ * delay is doubled while the windows are slowed down and reduced step by step
+ * when they are not, so the rebuild backs off quickly and comes back gradually.
+ * The delay also keeps the rebuild under the bandwidth limit, if there is one.
+ */
+static void
+raid_bdev_rebuild_throttle(struct raid_bdev_rebuild *rebuild)
+{
+	struct raid_bdev *raid_bdev = rebuild->raid_bdev;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t window_ticks = spdk_get_ticks() - rebuild->window_tsc;
+	uint64_t window_us = window_ticks * SPDK_SEC_TO_USEC / ticks_hz;
+	struct raid_bdev_opts opts;
+
+	if (rebuild->best_window_ticks == 0 || window_ticks < rebuild->best_window_ticks) {
+		rebuild->best_window_ticks = window_ticks;
+	} else {
+		rebuild->best_window_ticks += (rebuild->best_window_ticks >>
+					       RAID_BDEV_REBUILD_LATENCY_DECAY_SHIFT) + 1;
+	}
+
+	if (window_ticks > rebuild->best_window_ticks * RAID_BDEV_REBUILD_LATENCY_FACTOR) {
+		rebuild->delay_us = spdk_min(spdk_max(rebuild->delay_us * 2,
+						      RAID_BDEV_REBUILD_DELAY_MIN_US),
+					     RAID_BDEV_REBUILD_DELAY_MAX_US);
+	} else if (rebuild->delay_us > RAID_BDEV_REBUILD_DELAY_MIN_US) {
+		rebuild->delay_us -= RAID_BDEV_REBUILD_DELAY_MIN_US;
+	} else {
+		rebuild->delay_us = 0;
+	}
+
+	raid_bdev_get_opts(&opts);
+	if (opts.rebuild_max_bandwidth_mb_sec > 0) {
+		uint64_t bytes = rebuild->num_blocks << raid_bdev->blocklen_shift;
+		uint64_t min_window_us = bytes * SPDK_SEC_TO_USEC /
+					 ((uint64_t)opts.rebuild_max_bandwidth_mb_sec * 1024 * 1024);
+
+		if (window_us + rebuild->delay_us < min_window_us) {
+			rebuild->delay_us = min_window_us - window_us;
+		}
+	}
+}
+
+static int
+raid_bdev_rebuild_delay_poll(void *arg)
+{
+	struct raid_bdev_rebuild *rebuild = arg;
+
+	spdk_poller_unregister(&rebuild->delay_poller);
+	raid_bdev_rebuild_window_start(rebuild);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+raid_bdev_rebuild_unlocked(void *cb_arg, int status)
+{
+	struct raid_bdev_rebuild *rebuild = cb_arg;
+
+	if (rebuild->status != 0 || status != 0) {
+		raid_bdev_rebuild_finish(rebuild, rebuild->status != 0 ? rebuild->status : status);
+		return;
+	}
+
+	raid_bdev_rebuild_throttle(rebuild);
+	rebuild->offset += rebuild->num_blocks;
+
+	if (rebuild->delay_us == 0 || rebuild->stopping) {
+		raid_bdev_rebuild_window_start(rebuild);
+		return;
+	}
+
+	rebuild->delay_poller = SPDK_POLLER_REGISTER(raid_bdev_rebuild_delay_poll, rebuild,
+			       rebuild->delay_us);
+}
+
+static void
+raid_bdev_rebuild_window_done(struct raid_bdev_rebuild *rebuild, int status)
+{
+	uint64_t data_strips = rebuild->data_strips;
+	int rc;
+
+	rebuild->status = status;
+
+	rc = spdk_bdev_unlock_lba_range(rebuild->desc, rebuild->ch, rebuild->offset * data_strips,
+					rebuild->num_blocks * data_strips, raid_bdev_rebuild_unlocked,
+					rebuild);
+	if (rc != 0) {
+		raid_bdev_rebuild_finish(rebuild, status != 0 ? status : rc);
+	}
+}
+
+static void
+raid_bdev_rebuild_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_rebuild *rebuild = cb_arg;
+	struct raid_base_bdev_info *base_info;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		raid_bdev_rebuild_window_done(rebuild, -EIO);
+		return;
+	}
+
+	/* Publish the new checkpoint while the window is still locked for writing */
+	base_info = &rebuild->raid_bdev->base_bdev_info[rebuild->base_idx];
+	base_info->rebuild_checkpoint = rebuild->offset + rebuild->num_blocks;
+
+	raid_bdev_rebuild_window_done(rebuild, 0);
+}
+
+static void
+raid_bdev_rebuild_write(void *ctx)
+{
+	struct raid_bdev_rebuild *rebuild = ctx;
+	int rc;
+
+	rc = spdk_bdev_write_blocks(rebuild->base_desc, rebuild->base_ch, rebuild->base_buf,
+				    rebuild->offset, rebuild->num_blocks,
+				    raid_bdev_rebuild_write_done, rebuild);
+	if (rc == -ENOMEM) {
+		rebuild->waitq_entry.bdev = spdk_bdev_desc_get_bdev(rebuild->base_desc);
+		rebuild->waitq_entry.cb_fn = raid_bdev_rebuild_write;
+		rebuild->waitq_entry.cb_arg = rebuild;
+		spdk_bdev_queue_io_wait(rebuild->waitq_entry.bdev, rebuild->base_ch,
+					&rebuild->waitq_entry);
+	} else if (rc != 0) {
+		raid_bdev_rebuild_window_done(rebuild, rc);
+	}
+}
+
+static void
+raid_bdev_rebuild_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_rebuild *rebuild = cb_arg;
+	struct raid_bdev *raid_bdev = rebuild->raid_bdev;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		raid_bdev_rebuild_window_done(rebuild, -EIO);
+		return;
+	}
+
+	rc = raid_bdev->module->rebuild_base_bdev_data(raid_bdev, rebuild->base_idx, rebuild->offset,
+			rebuild->num_blocks, rebuild->stripe_buf,
+			rebuild->base_buf);
+	if (rc != 0) {
+		raid_bdev_rebuild_window_done(rebuild, rc);
+		return;
+	}
+
+	raid_bdev_rebuild_write(rebuild);
+}
+
+static void
+raid_bdev_rebuild_read(void *ctx)
+{
+	struct raid_bdev_rebuild *rebuild = ctx;
+	uint64_t data_strips = rebuild->data_strips;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(rebuild->desc, rebuild->ch, rebuild->stripe_buf,
+				   rebuild->offset * data_strips, rebuild->num_blocks * data_strips,
+				   raid_bdev_rebuild_read_done, rebuild);
+	if (rc == -ENOMEM) {
+		rebuild->waitq_entry.bdev = &rebuild->raid_bdev->bdev;
+		rebuild->waitq_entry.cb_fn = raid_bdev_rebuild_read;
+		rebuild->waitq_entry.cb_arg = rebuild;
+		spdk_bdev_queue_io_wait(rebuild->waitq_entry.bdev, rebuild->ch, &rebuild->waitq_entry);
+	} else if (rc != 0) {
+		raid_bdev_rebuild_window_done(rebuild, rc);
+	}
+}
+
+static void
+raid_bdev_rebuild_locked(void *cb_arg, int status)
+{
+	struct raid_bdev_rebuild *rebuild = cb_arg;
+
+	if (status != 0) {
+		raid_bdev_rebuild_finish(rebuild, status);
+		return;
+	}
+
+	raid_bdev_rebuild_read(rebuild);
+}
+
+/*
+ * Rebuild the next window of the base bdev. The stripes of the window are read
+ * through the raid bdev, which reconstructs the data of the rebuilt base bdev,
+ * and its content is generated from them. The window is locked for writing
+ * until the checkpoint is moved past it, so that no write to it gets lost.
+ * A base bdev being resynchronized is written by the raid module regardless of
+ * the checkpoint, so the windows it doesn't need are skipped without locking.
+ */
+static void
+raid_bdev_rebuild_window_start(struct raid_bdev_rebuild *rebuild)
+{
+	struct raid_bdev *raid_bdev = rebuild->raid_bdev;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[rebuild->base_idx];
+	uint64_t data_strips = rebuild->data_strips;
+	int rc;
+
+	if (rebuild->stopping) {
+		raid_bdev_rebuild_finish(rebuild, -ECANCELED);
+		return;
+	}
+
+	for (;;) {
+		if (rebuild->offset == rebuild->total_blocks) {
+			raid_bdev_rebuild_finish(rebuild, 0);
+			return;
+		}
+
+		rebuild->num_blocks = spdk_min(rebuild->window_blocks,
+					       rebuild->total_blocks - rebuild->offset);
+
+		if (!base_info->resync ||
+		    raid_bdev->module->rebuild_range_needed(raid_bdev, rebuild->base_idx,
+				    rebuild->offset, rebuild->num_blocks)) {
+			break;
+		}
+
+		rebuild->offset += rebuild->num_blocks;
+		base_info->rebuild_checkpoint = rebuild->offset;
+	}
+
+	rebuild->window_tsc = spdk_get_ticks();
+
+	rc = spdk_bdev_lock_lba_range(rebuild->desc, rebuild->ch, rebuild->offset * data_strips,
+				      rebuild->num_blocks * data_strips, raid_bdev_rebuild_locked,
+				      rebuild);
+	if (rc != 0) {
+		raid_bdev_rebuild_finish(rebuild, rc);
+	}
+}
+
+static void
+raid_bdev_rebuild_stop_now(struct raid_bdev_rebuild *rebuild)
+{
+	rebuild->stopping = true;
+
+	/* Otherwise the window in progress stops the rebuild when it is done */
+	if (rebuild->delay_poller != NULL) {
+		spdk_poller_unregister(&rebuild->delay_poller);
+		raid_bdev_rebuild_finish(rebuild, -ECANCELED);
+	}
+}
+
+static void
+raid_bdev_rebuild_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			   void *event_ctx)
+{
+	struct raid_bdev_rebuild *rebuild = event_ctx;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		raid_bdev_rebuild_stop_now(rebuild);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_rebuild_start starts the rebuild of a base bdev of the raid bdev from
+ * its rebuild checkpoint. Only one base bdev is rebuilt at a time.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * base_idx - index of the base bdev to rebuild
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_rebuild_start(struct raid_bdev *raid_bdev, uint8_t base_idx)
+{
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[base_idx];
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	struct raid_bdev_rebuild *rebuild;
+	struct raid_bdev_opts opts;
+	size_t buf_align;
+	uint64_t window_strips;
+	int rc;
+
+	assert(base_info->rebuilding && base_info->desc != NULL);
+	assert(raid_bdev->module->rebuild_base_bdev_data != NULL);
+	assert(!base_info->resync || raid_bdev->module->rebuild_range_needed != NULL);
+
+	if (raid_bdev->rebuild != NULL) {
+		return -EBUSY;
+	}
+
+	rebuild = calloc(1, sizeof(*rebuild));
+	if (!rebuild) {
+		return -ENOMEM;
+	}
+
+	raid_bdev_get_opts(&opts);
+	window_strips = spdk_max(((uint64_t)opts.rebuild_window_size_kb * 1024 / blocklen) >>
+				 raid_bdev->strip_size_shift, 1);
+
+	rebuild->raid_bdev = raid_bdev;
+	rebuild->base_idx = base_idx;
+	rebuild->base_desc = base_info->desc;
+	rebuild->data_strips = raid_bdev_stripe_data_strips_num(raid_bdev);
+	rebuild->window_blocks = window_strips << raid_bdev->strip_size_shift;
+	rebuild->total_blocks = raid_bdev_base_bdev_blockcnt(raid_bdev);
+	rebuild->offset = base_info->rebuild_checkpoint;
+
+	rc = spdk_bdev_open_ext(raid_bdev->bdev.name, false, raid_bdev_rebuild_event_cb, rebuild,
+				&rebuild->desc);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rebuild->ch = spdk_bdev_get_io_channel(rebuild->desc);
+	rebuild->base_ch = spdk_bdev_get_io_channel(rebuild->base_desc);
+	if (!rebuild->ch || !rebuild->base_ch) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	buf_align = spdk_max(spdk_bdev_get_buf_align(&raid_bdev->bdev),
+			     spdk_bdev_get_buf_align(base_info->bdev));
+	rebuild->stripe_buf = spdk_malloc((rebuild->window_blocks * rebuild->data_strips) *
+					  blocklen, buf_align, NULL, SPDK_ENV_LCORE_ID_ANY,
+					  SPDK_MALLOC_DMA);
+	rebuild->base_buf = spdk_malloc(rebuild->window_blocks * blocklen, buf_align, NULL,
+					SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (!rebuild->stripe_buf || !rebuild->base_buf) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	SPDK_NOTICELOG("Rebuilding base bdev %s of raid bdev %s from block %" PRIu64 "\n",
+		       base_info->bdev->name, raid_bdev->bdev.name, rebuild->offset);
+
+	raid_bdev->rebuild = rebuild;
+	rebuild->start_tsc = spdk_get_ticks();
+	rebuild->start_offset = rebuild->offset;
+
+	raid_bdev_rebuild_window_start(rebuild);
+
+	return 0;
+err:
+	raid_bdev_rebuild_free(rebuild);
+	return rc;
+}
+
+/*
+ * brief:
+ * raid_bdev_rebuild_stop stops the rebuild of the raid bdev. The rebuild
+ * checkpoint stays where the last rebuilt window ends.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * cb_fn - called when the rebuild is stopped
+ * cb_arg - argument to cb_fn
+ * returns:
+ * none
+ */
+void
+raid_bdev_rebuild_stop(struct raid_bdev *raid_bdev, void (*cb_fn)(void *cb_arg), void *cb_arg)
+{
+	struct raid_bdev_rebuild *rebuild = raid_bdev->rebuild;
+
+	assert(rebuild != NULL);
+	assert(rebuild->stop_cb == NULL);
+
+	rebuild->stop_cb = cb_fn;
+	rebuild->stop_cb_arg = cb_arg;
+
+	raid_bdev_rebuild_stop_now(rebuild);
+}
+
+/*
+ * brief:
+ * raid_bdev_rebuild_write_info_json writes the rebuild progress to the json context
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * w - pointer to json context
+ * returns:
+ * none
+ */
+void
+raid_bdev_rebuild_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w)
+{
+	struct raid_bdev_rebuild *rebuild = raid_bdev->rebuild;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[rebuild->base_idx];
+	uint64_t elapsed_us = (spdk_get_ticks() - rebuild->start_tsc) * SPDK_SEC_TO_USEC /
+			      spdk_get_ticks_hz();
+	uint64_t done_blocks = base_info->rebuild_checkpoint;
+	/* The bandwidth only counts what was rebuilt since the rebuild was last resumed */
+	uint64_t rebuilt_blocks = done_blocks - spdk_min(done_blocks, rebuild->start_offset);
+	uint64_t done_mb = (rebuilt_blocks << raid_bdev->blocklen_shift) / (1024 * 1024);
+
+	spdk_json_write_named_object_begin(w, "rebuild");
+	spdk_json_write_named_string(w, "base_bdev", base_info->bdev->name);
+	spdk_json_write_named_uint64(w, "blocks_done", done_blocks);
+	spdk_json_write_named_uint64(w, "blocks_total", rebuild->total_blocks);
+	spdk_json_write_named_uint32(w, "percent", done_blocks * 100 / rebuild->total_blocks);
+	spdk_json_write_named_uint64(w, "elapsed_ms", elapsed_us / 1000);
+	spdk_json_write_named_uint64(w, "bandwidth_mb_sec",
+				     elapsed_us ? done_mb * SPDK_SEC_TO_USEC / elapsed_us : 0);
+	spdk_json_write_named_uint64(w, "delay_us", rebuild->delay_us);
+	spdk_json_write_object_end(w);
+}
@@ -47,6 +47,9 @@
 struct rpc_bdev_raid_get_bdevs {
 	/* category - all or online or configuring or offline */
 	char *category;
+
+	/* verbose - list the raid bdev information instead of the names only */
+	bool verbose;
 };
 
 /*
@@ -68,8 +71,34 @@ free_rpc_bdev_raid_get_bdevs(struct rpc_bdev_raid_get_bdevs *req)
  */
 static const struct spdk_json_object_decoder rpc_bdev_raid_get_bdevs_decoders[] = {
 	{"category", offsetof(struct rpc_bdev_raid_get_bdevs, category), spdk_json_decode_string},
+	{"verbose", offsetof(struct rpc_bdev_raid_get_bdevs, verbose), spdk_json_decode_bool, true},
 };
 
+/*
+ * brief:
+ * rpc_bdev_raid_write_bdev writes a raid bdev entry of the bdev_raid_get_bdevs output,
+ * either its name or, in verbose mode, an object with the raid bdev information
+ * params:
+ * w - pointer to json context
+ * raid_bdev - pointer to raid_bdev
+ * verbose - write the raid bdev information
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_write_bdev(struct spdk_json_write_ctx *w, struct raid_bdev *raid_bdev, bool verbose)
+{
+	if (!verbose) {
+		spdk_json_write_string(w, raid_bdev->bdev.name);
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", raid_bdev->bdev.name);
+	raid_bdev_write_info_json(raid_bdev, w);
+	spdk_json_write_object_end(w);
+}
+
 /*
  * brief:
  * rpc_bdev_raid_get_bdevs function is the RPC for rpc_bdev_raid_get_bdevs. This is used to list
@@ -79,7 +108,8 @@ static const struct spdk_json_object_decoder rpc_bdev_raid_get_bdevs_decoders[]
  * is registered with bdev layer. "configuring" is the raid bdev which does not have
  * full configuration discovered yet. "offline" is the raid bdev which is not
  * registered with bdev as of now and it has encountered any error or user has
- * requested to offline the raid.
+ * requested to offline the raid. With verbose set, the configuration, state and
+ * statistics of each raid bdev are listed instead of its name.
  * params:
  * request - pointer to json rpc request
  * params - pointer to request parameters
@@ -116,19 +146,19 @@ rpc_bdev_raid_get_bdevs(struct spdk_jsonrpc_request *request,
 	/* Get raid bdev list based on the category requested */
 	if (strcmp(req.category, "all") == 0) {
 		TAILQ_FOREACH(raid_bdev, &g_raid_bdev_list, global_link) {
-			spdk_json_write_string(w, raid_bdev->bdev.name);
+			rpc_bdev_raid_write_bdev(w, raid_bdev, req.verbose);
 		}
 	} else if (strcmp(req.category, "online") == 0) {
 		TAILQ_FOREACH(raid_bdev, &g_raid_bdev_configured_list, state_link) {
-			spdk_json_write_string(w, raid_bdev->bdev.name);
+			rpc_bdev_raid_write_bdev(w, raid_bdev, req.verbose);
 		}
 	} else if (strcmp(req.category, "configuring") == 0) {
 		TAILQ_FOREACH(raid_bdev, &g_raid_bdev_configuring_list, state_link) {
-			spdk_json_write_string(w, raid_bdev->bdev.name);
+			rpc_bdev_raid_write_bdev(w, raid_bdev, req.verbose);
 		}
 	} else {
 		TAILQ_FOREACH(raid_bdev, &g_raid_bdev_offline_list, state_link) {
-			spdk_json_write_string(w, raid_bdev->bdev.name);
+			rpc_bdev_raid_write_bdev(w, raid_bdev, req.verbose);
 		}
 	}
 	spdk_json_write_array_end(w);
@@ -432,3 +462,191 @@ cleanup:
 }
 SPDK_RPC_REGISTER("bdev_raid_delete", rpc_bdev_raid_delete, SPDK_RPC_RUNTIME)
 SPDK_RPC_REGISTER_ALIAS_DEPRECATED(bdev_raid_delete, destroy_raid_bdev)
+
+/*
+ * Input structure for RPC adding a base bdev to a raid bdev
+ */
+struct rpc_bdev_raid_add_base_bdev {
+	/* raid bdev name */
+	char *raid_bdev;
+
+	/* base bdev name */
+	char *base_bdev;
+};
+
+static void
+free_rpc_bdev_raid_add_base_bdev(struct rpc_bdev_raid_add_base_bdev *req)
+{
+	free(req->raid_bdev);
+	free(req->base_bdev);
+}
+
+/*
+ * Decoder object for RPC bdev_raid_add_base_bdev
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_add_base_bdev_decoders[] = {
+	{"raid_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, raid_bdev), spdk_json_decode_string},
+	{"base_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, base_bdev), spdk_json_decode_string},
+};
+
+/*
+ * brief:
+ * rpc_bdev_raid_add_base_bdev function is the RPC for adding a base bdev to a
+ * missing slot of a raid bdev. The base bdev is rebuilt in the background if the
+ * raid bdev is online.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_add_base_bdev(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_raid_add_base_bdev req = {};
+	struct raid_bdev_config *raid_cfg;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_raid_add_base_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_raid_add_base_bdev_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	raid_cfg = raid_bdev_config_find_by_name(req.raid_bdev);
+	if (raid_cfg == NULL || raid_cfg->raid_bdev == NULL) {
+		spdk_jsonrpc_send_error_response_fmt(request, -ENODEV,
+						     "raid bdev %s is not found", req.raid_bdev);
+		goto cleanup;
+	}
+
+	rc = raid_bdev_add_base_bdev(raid_cfg->raid_bdev, req.base_bdev);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, rc,
+						     "Failed to add base bdev %s to RAID bdev %s: %s",
+						     req.base_bdev, req.raid_bdev, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_raid_add_base_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_raid_add_base_bdev", rpc_bdev_raid_add_base_bdev, SPDK_RPC_RUNTIME)
+
+/*
+ * Input structure for RPC removing a base bdev from its raid bdev
+ */
+struct rpc_bdev_raid_remove_base_bdev {
+	/* base bdev name */
+	char *name;
+};
+
+static void
+free_rpc_bdev_raid_remove_base_bdev(struct rpc_bdev_raid_remove_base_bdev *req)
+{
+	free(req->name);
+}
+
+/*
+ * Decoder object for RPC bdev_raid_remove_base_bdev
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_remove_base_bdev_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_raid_remove_base_bdev, name), spdk_json_decode_string},
+};
+
+/*
+ * brief:
+ * rpc_bdev_raid_remove_base_bdev function is the RPC for removing a base bdev
+ * from its raid bdev, which keeps running degraded if it can.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_remove_base_bdev(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_raid_remove_base_bdev req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_raid_remove_base_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_raid_remove_base_bdev_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = raid_bdev_remove_base_bdev_by_name(req.name);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, rc, "Failed to remove base bdev %s: %s",
+						     req.name, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_raid_remove_base_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_raid_remove_base_bdev", rpc_bdev_raid_remove_base_bdev, SPDK_RPC_RUNTIME)
+
+/*
+ * Decoder object for RPC bdev_raid_set_options
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_set_options_decoders[] = {
+	{
+		"rebuild_window_size_kb", offsetof(struct raid_bdev_opts, rebuild_window_size_kb),
+		spdk_json_decode_uint32, true
+	},
+	{
+		"rebuild_max_bandwidth_mb_sec",
+		offsetof(struct raid_bdev_opts, rebuild_max_bandwidth_mb_sec),
+		spdk_json_decode_uint32, true
+	},
+};
+
+/*
+ * brief:
+ * rpc_bdev_raid_set_options function is the RPC for setting the raid bdev module
+ * options. The options of a rebuild are taken when it starts, except for the
+ * bandwidth limit which applies immediately.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct raid_bdev_opts opts;
+	int rc;
+
+	raid_bdev_get_opts(&opts);
+	if (params && spdk_json_decode_object(params, rpc_bdev_raid_set_options_decoders,
+					      SPDK_COUNTOF(rpc_bdev_raid_set_options_decoders),
+					      &opts)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	rc = raid_bdev_set_opts(&opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+SPDK_RPC_REGISTER("bdev_raid_set_options", rpc_bdev_raid_set_options,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
@@ -0,0 +1,1279 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "bdev_raid.h"
+
+#include "spdk/env.h"
+#include "spdk/thread.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#include "spdk/log.h"
+
+/*
+ * Write-intent bitmap. Every base bdev keeps a copy of it in the blocks right
+ * after the mirrored data: a header block followed by one bit per region of
+ * the raid bdev. The bit of a region is written to the base bdevs before the
+ * region is modified and cleared once the region has been idle for a while,
+ * so after an unclean shutdown only the regions with their bit set may differ
+ * between the base bdevs and need to be resynchronized.
+ */
+#define RAID1_BITMAP_MAGIC		"SPDKR1BM"
+#define RAID1_BITMAP_VERSION		1
+
+/* The regions grow beyond the minimum size if the bitmap would not fit in RAID1_BITMAP_MAX_BYTES */
+#define RAID1_BITMAP_REGION_SIZE_MIN_MB	64
+#define RAID1_BITMAP_MAX_BYTES		4096
+
+/* Minimum time a region has to be idle before its bit gets cleared */
+#define RAID1_BITMAP_CLEAN_DELAY_SEC	5
+
+struct raid1_bitmap_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	blocklen;
+	uint64_t	data_blocks;
+	uint64_t	region_blocks;
+	uint64_t	num_regions;
+
+	/* Incremented on every update, a base bdev with a lower value missed some writes */
+	uint64_t	seq;
+};
+SPDK_STATIC_ASSERT(sizeof(struct raid1_bitmap_header) == 48, "Incorrect size");
+
+struct raid1_info;
+
+/* Bitmap of a base bdev being read when the raid bdev starts */
+struct raid1_bitmap_load_ctx {
+	struct raid1_info	*r1info;
+	uint8_t			base_idx;
+	struct spdk_io_channel	*ch;
+	bool			success;
+};
+
+struct raid1_info {
+	/* The parent raid bdev */
+	struct raid_bdev		*raid_bdev;
+
+	/* Number of blocks of each base bdev holding the data, the bitmap follows them */
+	uint64_t			data_blocks;
+
+	/* Size of the bitmap on the base bdevs, including the header block */
+	uint64_t			bitmap_blocks;
+	size_t				bitmap_bytes;
+
+	uint64_t			region_blocks;
+	uint32_t			region_shift;
+	uint64_t			num_regions;
+
+	size_t				buf_align;
+
+	/* Protects the bitmap state below */
+	pthread_spinlock_t		lock;
+
+	/* Current bitmap, in its on-disk format */
+	void				*bitmap_buf;
+	struct raid1_bitmap_header	*header;
+	uint8_t				*bits;
+
+	/* Bits known to be set on all the base bdevs the bitmap is written to */
+	uint8_t				*flushed_bits;
+
+	/* Regions out of sync when the raid bdev was started */
+	uint8_t				*resync_bits;
+
+	/* Regions written since the last cleanup and number of writes in progress per region */
+	uint8_t				*recent_bits;
+	uint32_t			*region_writes;
+	uint64_t			last_clean_tsc;
+
+	bool				loaded;
+	bool				flushing;
+	uint64_t			flushes;
+
+	/* Raid IOs waiting for the bitmap to be loaded or flushed */
+	TAILQ_HEAD(, spdk_bdev_io_wait_entry) waiters;
+
+	/* Bitmap flush in progress, only used by the thread that started it */
+	void				*flush_buf;
+	struct spdk_io_channel		**flush_channels;
+	uint8_t				flush_submitted;
+	uint8_t				flush_remaining;
+	int				flush_status;
+	void				(*flush_cb)(void *cb_arg, int status);
+	void				*flush_cb_arg;
+	struct spdk_bdev_io_wait_entry	flush_waitq_entry;
+
+	/* Bitmap load, done on the thread that started the raid bdev */
+	void				*load_buf;
+	struct raid1_bitmap_load_ctx	*load_ctx;
+	struct spdk_io_channel		**load_channels;
+	uint32_t			load_remaining;
+	bool				load_in_progress;
+
+	bool				stopping;
+	bool				unregistered;
+};
+
+struct raid1_io_channel {
+	/* Base bdev to start looking from for the next read, rotated to spread ties */
+	uint8_t		next_read_idx;
+
+	/* Number of reads in progress on each base bdev from this channel */
+	uint32_t	reads_outstanding[0];
+};
+
+static inline bool
+raid1_bit_test(const uint8_t *bits, uint64_t i)
+{
+	return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+static inline void
+raid1_bit_set(uint8_t *bits, uint64_t i)
+{
+	bits[i / 8] |= 1 << (i % 8);
+}
+
+static inline void
+raid1_bit_clear(uint8_t *bits, uint64_t i)
+{
+	bits[i / 8] &= ~(1 << (i % 8));
+}
+
+static inline uint64_t
+raid1_first_region(const struct raid1_info *r1info, uint64_t offset_blocks)
+{
+	return offset_blocks >> r1info->region_shift;
+}
+
+static inline uint64_t
+raid1_last_region(const struct raid1_info *r1info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	return (offset_blocks + num_blocks - 1) >> r1info->region_shift;
+}
+
+static bool
+raid1_regions_need_resync(const struct raid1_info *r1info, uint64_t offset_blocks,
+			  uint64_t num_blocks)
+{
+	uint64_t i;
+
+	for (i = raid1_first_region(r1info, offset_blocks);
+	     i <= raid1_last_region(r1info, offset_blocks, num_blocks); i++) {
+		if (raid1_bit_test(r1info->resync_bits, i)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* A base bdev the bitmap is written to holds all the data outside of the dirty regions */
+static inline bool
+raid1_bitmap_base_bdev_target(const struct raid_base_bdev_info *base_info,
+			      struct spdk_io_channel *ch)
+{
+	return base_info->desc != NULL && ch != NULL &&
+	       (!base_info->rebuilding || base_info->resync);
+}
+
+static void raid1_bitmap_flush_submit(void *ctx);
+
+static void
+raid1_bitmap_wake_waiters(struct raid1_info *r1info, int status)
+{
+	TAILQ_HEAD(, spdk_bdev_io_wait_entry) waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	struct spdk_bdev_io_wait_entry *entry;
+	struct raid_bdev_io *raid_io;
+
+	pthread_spin_lock(&r1info->lock);
+	TAILQ_SWAP(&waiters, &r1info->waiters, spdk_bdev_io_wait_entry, link);
+	pthread_spin_unlock(&r1info->lock);
+
+	while ((entry = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, entry, link);
+		raid_io = entry->cb_arg;
+		if (status != 0) {
+			raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_FAILED;
+		}
+		spdk_thread_send_msg(spdk_bdev_io_get_thread(spdk_bdev_io_from_ctx(raid_io)),
+				     entry->cb_fn, raid_io);
+	}
+}
+
+/* Must be called with the lock held */
+static void
+raid1_bitmap_wait(struct raid1_info *r1info, struct raid_bdev_io *raid_io,
+		  spdk_bdev_io_wait_cb cb_fn)
+{
+	raid_io->waitq_entry.bdev = &r1info->raid_bdev->bdev;
+	raid_io->waitq_entry.cb_fn = cb_fn;
+	raid_io->waitq_entry.cb_arg = raid_io;
+	TAILQ_INSERT_TAIL(&r1info->waiters, &raid_io->waitq_entry, link);
+}
+
+static void
+raid1_bitmap_flush_done(struct raid1_info *r1info)
+{
+	void (*cb)(void *cb_arg, int status) = r1info->flush_cb;
+	void *cb_arg = r1info->flush_cb_arg;
+	int status = r1info->flush_status;
+
+	pthread_spin_lock(&r1info->lock);
+	if (status == 0) {
+		memcpy(r1info->flushed_bits, (uint8_t *)r1info->flush_buf + r1info->raid_bdev->bdev.blocklen,
+		       r1info->bitmap_bytes);
+		r1info->flushes++;
+	}
+	r1info->flushing = false;
+	pthread_spin_unlock(&r1info->lock);
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write the bitmap of raid bdev %s: %s\n",
+			    r1info->raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	/* The waiters check again if their regions are marked and start the next flush if not */
+	raid1_bitmap_wake_waiters(r1info, status);
+
+	if (cb) {
+		cb(cb_arg, status);
+	}
+}
+
+static void
+raid1_bitmap_flush_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid1_info *r1info = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		r1info->flush_status = -EIO;
+	}
+
+	assert(r1info->flush_remaining > 0);
+	if (--r1info->flush_remaining == 0) {
+		raid1_bitmap_flush_done(r1info);
+	}
+}
+
+static void
+raid1_bitmap_flush_submit(void *ctx)
+{
+	struct raid1_info *r1info = ctx;
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *ch;
+	int ret;
+
+	for (; r1info->flush_submitted < raid_bdev->num_base_bdevs; r1info->flush_submitted++) {
+		base_info = &raid_bdev->base_bdev_info[r1info->flush_submitted];
+		ch = r1info->flush_channels[r1info->flush_submitted];
+
+		if (r1info->stopping || !raid1_bitmap_base_bdev_target(base_info, ch)) {
+			r1info->flush_remaining--;
+			continue;
+		}
+
+		ret = spdk_bdev_write_blocks(base_info->desc, ch, r1info->flush_buf, r1info->data_blocks,
+					     r1info->bitmap_blocks, raid1_bitmap_flush_write_done, r1info);
+		if (ret == -ENOMEM) {
+			r1info->flush_waitq_entry.bdev = base_info->bdev;
+			r1info->flush_waitq_entry.cb_fn = raid1_bitmap_flush_submit;
+			r1info->flush_waitq_entry.cb_arg = r1info;
+			spdk_bdev_queue_io_wait(base_info->bdev, ch, &r1info->flush_waitq_entry);
+			return;
+		} else if (ret != 0) {
+			r1info->flush_status = ret;
+			r1info->flush_remaining--;
+		}
+	}
+
+	if (r1info->flush_remaining == 0) {
+		raid1_bitmap_flush_done(r1info);
+	}
+}
+
+/*
+ * Write the current bitmap to the base bdevs, using the given base bdev
+ * channels of the current thread. The caller sets the flushing flag, only
+ * one flush is in progress at a time. The bits cleared since the last flush
+ * can't be relied on to be set on the base bdevs from now on, whatever the
+ * outcome of this one, so they are cleared in flushed_bits right away.
+ */
+static void
+raid1_bitmap_flush(struct raid1_info *r1info, struct spdk_io_channel **channels,
+		   void (*cb)(void *cb_arg, int status), void *cb_arg)
+{
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint8_t *flush_bits = (uint8_t *)r1info->flush_buf + raid_bdev->bdev.blocklen;
+	bool targets = false;
+	size_t i;
+
+	assert(r1info->flushing);
+
+	pthread_spin_lock(&r1info->lock);
+	r1info->header->seq++;
+	memcpy(r1info->flush_buf, r1info->bitmap_buf, r1info->bitmap_blocks * raid_bdev->bdev.blocklen);
+	for (i = 0; i < r1info->bitmap_bytes; i++) {
+		r1info->flushed_bits[i] &= flush_bits[i];
+	}
+	pthread_spin_unlock(&r1info->lock);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (raid1_bitmap_base_bdev_target(base_info,
+						  channels[base_info - raid_bdev->base_bdev_info])) {
+			targets = true;
+		}
+	}
+
+	r1info->flush_channels = channels;
+	r1info->flush_submitted = 0;
+	r1info->flush_remaining = raid_bdev->num_base_bdevs;
+	r1info->flush_status = targets ? 0 : -ENODEV;
+	r1info->flush_cb = cb;
+	r1info->flush_cb_arg = cb_arg;
+
+	raid1_bitmap_flush_submit(r1info);
+}
+
+/*
+ * Clear the bits of the regions not written for RAID1_BITMAP_CLEAN_DELAY_SEC.
+ * The regions being resynchronized keep their bits until the resync is done.
+ * Must be called with the lock held, returns true if the bitmap needs to be
+ * flushed.
+ */
+static bool
+raid1_bitmap_clean(struct raid1_info *r1info)
+{
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint64_t now = spdk_get_ticks();
+	bool resync = false;
+	uint64_t i;
+
+	if (!r1info->loaded ||
+	    now - r1info->last_clean_tsc < RAID1_BITMAP_CLEAN_DELAY_SEC * spdk_get_ticks_hz()) {
+		return false;
+	}
+	r1info->last_clean_tsc = now;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->resync) {
+			resync = true;
+		}
+	}
+
+	for (i = 0; i < r1info->num_regions; i++) {
+		if (raid1_bit_test(r1info->bits, i) && !raid1_bit_test(r1info->recent_bits, i) &&
+		    r1info->region_writes[i] == 0 &&
+		    !(resync && raid1_bit_test(r1info->resync_bits, i))) {
+			raid1_bit_clear(r1info->bits, i);
+		}
+	}
+	memset(r1info->recent_bits, 0, r1info->bitmap_bytes);
+
+	return memcmp(r1info->bits, r1info->flushed_bits, r1info->bitmap_bytes) != 0;
+}
+
+static bool
+raid1_read_base_bdev_available(struct raid_bdev_io *raid_io, uint8_t base_idx)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_base_bdev_info *base_info = &raid_io->raid_bdev->base_bdev_info[base_idx];
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+
+	if (base_info->desc == NULL || raid_io->raid_ch->base_channel[base_idx] == NULL) {
+		return false;
+	}
+
+	if (!base_info->rebuilding || offset_blocks + num_blocks <= base_info->rebuild_checkpoint) {
+		return true;
+	}
+
+	/* A base bdev being resynchronized only lacks the data of the dirty regions */
+	return base_info->resync &&
+	       !raid1_regions_need_resync(raid_io->raid_bdev->module_private, offset_blocks, num_blocks);
+}
+
+static void raid1_submit_read_request(struct raid_bdev_io *raid_io);
+
+static void
+_raid1_submit_read_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid1_submit_read_request(raid_io);
+}
+
+static void
+raid1_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+	struct raid1_io_channel *r1ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint8_t num_base_bdevs = raid_io->raid_bdev->num_base_bdevs;
+	uint8_t base_idx = raid_io->base_bdev_io_submitted;
+	uint64_t i;
+
+	spdk_bdev_free_io(bdev_io);
+	r1ch->reads_outstanding[base_idx]--;
+
+	if (success) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	/*
+	 * Try the next base bdevs, up to the one before the base bdev read first.
+	 * base_bdev_io_remaining holds the distance from that one.
+	 */
+	for (i = raid_io->base_bdev_io_remaining + 1; i < num_base_bdevs; i++) {
+		uint8_t idx = (base_idx + i - raid_io->base_bdev_io_remaining) % num_base_bdevs;
+
+		if (raid1_read_base_bdev_available(raid_io, idx)) {
+			raid_io->base_bdev_io_remaining = i;
+			raid_io->base_bdev_io_submitted = idx;
+			raid1_submit_read_request(raid_io);
+			return;
+		}
+	}
+
+	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid1_submit_read_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_io_channel *r1ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint8_t base_idx = raid_io->base_bdev_io_submitted;
+	struct raid_base_bdev_info *base_info = &raid_io->raid_bdev->base_bdev_info[base_idx];
+	struct spdk_io_channel *base_ch = raid_io->raid_ch->base_channel[base_idx];
+	int ret;
+
+	ret = spdk_bdev_readv_blocks(base_info->desc, base_ch, bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				     bdev_io->u.bdev.num_blocks, raid1_read_done, raid_io);
+	if (ret == 0) {
+		r1ch->reads_outstanding[base_idx]++;
+	} else if (ret == -ENOMEM) {
+		raid_bdev_queue_io_wait(raid_io, base_info->bdev, base_ch, _raid1_submit_read_request);
+	} else {
+		SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+		assert(false);
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+/*
+ * Read from the base bdev with the least reads in progress from this channel.
+ * Unlike round robin, this keeps the base bdevs equally busy when they don't
+ * serve the reads equally fast. Ties are broken by starting the search from
+ * the next base bdev every time.
+ */
+static void
+raid1_read(struct raid_bdev_io *raid_io)
+{
+	struct raid1_io_channel *r1ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint8_t num_base_bdevs = raid_io->raid_bdev->num_base_bdevs;
+	uint8_t start = r1ch->next_read_idx;
+	int best = -1;
+	uint8_t i, idx;
+
+	r1ch->next_read_idx = (start + 1) % num_base_bdevs;
+
+	for (i = 0; i < num_base_bdevs; i++) {
+		idx = (start + i) % num_base_bdevs;
+		if (!raid1_read_base_bdev_available(raid_io, idx)) {
+			continue;
+		}
+
+		if (best < 0 || r1ch->reads_outstanding[idx] < r1ch->reads_outstanding[best]) {
+			best = idx;
+		}
+	}
+
+	if (best < 0) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid_io->base_bdev_io_remaining = 0;
+	raid_io->base_bdev_io_submitted = best;
+	raid1_submit_read_request(raid_io);
+}
+
+static void
+raid1_write_cleaned(void *cb_arg, int status)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	/* Bits left set on the base bdevs only cause extra resync */
+	raid_bdev_io_complete(raid_io, raid_io->base_bdev_io_status);
+}
+
+static void
+raid1_write_done(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+	uint64_t i;
+	bool flush = false;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_FLUSH) {
+		raid_bdev_io_complete(raid_io, raid_io->base_bdev_io_status);
+		return;
+	}
+
+	pthread_spin_lock(&r1info->lock);
+	for (i = raid1_first_region(r1info, bdev_io->u.bdev.offset_blocks);
+	     i <= raid1_last_region(r1info, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+	     i++) {
+		assert(r1info->region_writes[i] > 0);
+		r1info->region_writes[i]--;
+	}
+	if (!r1info->flushing && raid1_bitmap_clean(r1info)) {
+		r1info->flushing = true;
+		flush = true;
+	}
+	pthread_spin_unlock(&r1info->lock);
+
+	if (flush) {
+		/* The base bdev channels of this IO are needed until the flush is done */
+		raid1_bitmap_flush(r1info, raid_io->raid_ch->base_channel, raid1_write_cleaned, raid_io);
+	} else {
+		raid_bdev_io_complete(raid_io, raid_io->base_bdev_io_status);
+	}
+}
+
+static void
+raid1_write_base_bdev_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	assert(raid_io->base_bdev_io_remaining > 0);
+	if (--raid_io->base_bdev_io_remaining == 0) {
+		raid1_write_done(raid_io);
+	}
+}
+
+static void raid1_write_submit(struct raid_bdev_io *raid_io);
+
+static void
+_raid1_write_submit(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid1_write_submit(raid_io);
+}
+
+/*
+ * Submit the write, unmap or flush to all the base bdevs, including the ones
+ * being rebuilt, so they don't have to be resynchronized again.
+ */
+static void
+raid1_write_submit(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_io_channel *base_ch;
+	uint8_t i;
+	int ret;
+
+	for (i = raid_io->base_bdev_io_submitted; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+		base_ch = raid_io->raid_ch->base_channel[i];
+
+		if (base_info->desc == NULL || base_ch == NULL) {
+			raid_io->base_bdev_io_remaining--;
+			continue;
+		}
+
+		switch (bdev_io->type) {
+		case SPDK_BDEV_IO_TYPE_WRITE:
+			ret = spdk_bdev_writev_blocks(base_info->desc, base_ch, bdev_io->u.bdev.iovs,
+						      bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+						      bdev_io->u.bdev.num_blocks, raid1_write_base_bdev_done,
+						      raid_io);
+			break;
+		case SPDK_BDEV_IO_TYPE_UNMAP:
+			ret = spdk_bdev_unmap_blocks(base_info->desc, base_ch, bdev_io->u.bdev.offset_blocks,
+						     bdev_io->u.bdev.num_blocks, raid1_write_base_bdev_done,
+						     raid_io);
+			break;
+		case SPDK_BDEV_IO_TYPE_FLUSH:
+			ret = spdk_bdev_flush_blocks(base_info->desc, base_ch, bdev_io->u.bdev.offset_blocks,
+						     bdev_io->u.bdev.num_blocks, raid1_write_base_bdev_done,
+						     raid_io);
+			break;
+		default:
+			SPDK_ERRLOG("Recvd not supported io type %u\n", bdev_io->type);
+			assert(0);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (ret == -ENOMEM) {
+			raid_io->base_bdev_io_submitted = i;
+			raid_bdev_queue_io_wait(raid_io, base_info->bdev, base_ch, _raid1_write_submit);
+			return;
+		} else if (ret != 0) {
+			SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+			assert(false);
+			raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_FAILED;
+			raid_io->base_bdev_io_remaining--;
+		}
+	}
+	raid_io->base_bdev_io_submitted = i;
+
+	if (raid_io->base_bdev_io_remaining == 0) {
+		raid1_write_done(raid_io);
+	}
+}
+
+static void
+raid1_write_start(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	bool available = false;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc != NULL &&
+		    raid_io->raid_ch->base_channel[base_info - raid_bdev->base_bdev_info] != NULL) {
+			available = true;
+		}
+	}
+
+	if (!available) {
+		raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_FAILED;
+		raid1_write_done(raid_io);
+		return;
+	}
+
+	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+	raid_io->base_bdev_io_submitted = 0;
+	raid1_write_submit(raid_io);
+}
+
+static void raid1_write_mark_regions(struct raid_bdev_io *raid_io);
+
+static void
+_raid1_write_mark_regions(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	if (raid_io->base_bdev_io_status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid1_write_done(raid_io);
+		return;
+	}
+
+	raid1_write_mark_regions(raid_io);
+}
+
+/*
+ * The regions written must be marked in the bitmap on the base bdevs before
+ * the write is submitted. If they are not yet, wait for the flush of the
+ * bitmap, starting it if none is in progress.
+ */
+static void
+raid1_write_mark_regions(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+	bool marked = r1info->loaded;
+	bool flush = false;
+	uint64_t i;
+
+	pthread_spin_lock(&r1info->lock);
+	for (i = raid1_first_region(r1info, bdev_io->u.bdev.offset_blocks);
+	     i <= raid1_last_region(r1info, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+	     i++) {
+		raid1_bit_set(r1info->bits, i);
+		raid1_bit_set(r1info->recent_bits, i);
+		if (!raid1_bit_test(r1info->flushed_bits, i)) {
+			marked = false;
+		}
+	}
+
+	if (!marked) {
+		raid1_bitmap_wait(r1info, raid_io, _raid1_write_mark_regions);
+		if (r1info->loaded && !r1info->flushing) {
+			r1info->flushing = true;
+			flush = true;
+		}
+	}
+	pthread_spin_unlock(&r1info->lock);
+
+	if (marked) {
+		raid1_write_start(raid_io);
+	} else if (flush) {
+		raid1_bitmap_flush(r1info, raid_io->raid_ch->base_channel, NULL, NULL);
+	}
+}
+
+static void
+raid1_write(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+	uint64_t i;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_FLUSH) {
+		raid1_write_start(raid_io);
+		return;
+	}
+
+	pthread_spin_lock(&r1info->lock);
+	for (i = raid1_first_region(r1info, bdev_io->u.bdev.offset_blocks);
+	     i <= raid1_last_region(r1info, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+	     i++) {
+		r1info->region_writes[i]++;
+	}
+	pthread_spin_unlock(&r1info->lock);
+
+	raid1_write_mark_regions(raid_io);
+}
+
+static void raid1_submit_rw_request(struct raid_bdev_io *raid_io);
+
+static void
+_raid1_submit_rw_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid1_submit_rw_request(raid_io);
+}
+
+static void
+raid1_submit_rw_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+
+	/* It is not known which base bdevs are in sync until the bitmaps are loaded */
+	if (!r1info->loaded) {
+		pthread_spin_lock(&r1info->lock);
+		if (!r1info->loaded) {
+			raid1_bitmap_wait(r1info, raid_io, _raid1_submit_rw_request);
+			pthread_spin_unlock(&r1info->lock);
+			return;
+		}
+		pthread_spin_unlock(&r1info->lock);
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		raid1_read(raid_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		raid1_write(raid_io);
+		break;
+	default:
+		SPDK_ERRLOG("Recvd not supported io type %u\n", bdev_io->type);
+		assert(0);
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static void
+raid1_info_free(struct raid1_info *r1info)
+{
+	assert(TAILQ_EMPTY(&r1info->waiters));
+	pthread_spin_destroy(&r1info->lock);
+	spdk_free(r1info->bitmap_buf);
+	spdk_free(r1info->flush_buf);
+	free(r1info->flushed_bits);
+	free(r1info->resync_bits);
+	free(r1info->recent_bits);
+	free(r1info->region_writes);
+	free(r1info->load_channels);
+	free(r1info->load_ctx);
+	spdk_free(r1info->load_buf);
+	free(r1info);
+}
+
+static void
+raid1_bitmap_load_cleanup(struct raid1_info *r1info)
+{
+	uint8_t i;
+
+	for (i = 0; i < r1info->raid_bdev->num_base_bdevs; i++) {
+		if (r1info->load_channels[i]) {
+			spdk_put_io_channel(r1info->load_channels[i]);
+		}
+	}
+	free(r1info->load_channels);
+	free(r1info->load_ctx);
+	spdk_free(r1info->load_buf);
+	r1info->load_channels = NULL;
+	r1info->load_ctx = NULL;
+	r1info->load_buf = NULL;
+	r1info->load_in_progress = false;
+}
+
+static void
+raid1_bitmap_load_flushed(void *cb_arg, int status)
+{
+	struct raid1_info *r1info = cb_arg;
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	int ret;
+
+	raid1_bitmap_load_cleanup(r1info);
+
+	if (r1info->unregistered) {
+		raid1_info_free(r1info);
+		return;
+	}
+
+	if (r1info->stopping || raid_bdev->destruct_called || raid_bdev->rebuild != NULL) {
+		return;
+	}
+
+	/* The rebuild goes on with the other base bdevs when this one is done */
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (!base_info->rebuilding || base_info->desc == NULL) {
+			continue;
+		}
+
+		ret = raid_bdev_rebuild_start(raid_bdev, base_info - raid_bdev->base_bdev_info);
+		if (ret != 0) {
+			SPDK_ERRLOG("Failed to start %s of base bdev %s: %s\n",
+				    base_info->resync ? "resync" : "rebuild", base_info->bdev->name,
+				    spdk_strerror(-ret));
+		}
+		break;
+	}
+}
+
+static bool
+raid1_bitmap_header_valid(struct raid1_info *r1info, const struct raid1_bitmap_header *header)
+{
+	return memcmp(header->magic, RAID1_BITMAP_MAGIC, sizeof(header->magic)) == 0 &&
+	       header->version == RAID1_BITMAP_VERSION &&
+	       header->blocklen == r1info->raid_bdev->bdev.blocklen &&
+	       header->data_blocks == r1info->data_blocks &&
+	       header->region_blocks == r1info->region_blocks &&
+	       header->num_regions == r1info->num_regions;
+}
+
+/*
+ * All the bitmaps are read, find out which base bdevs are in sync. These are
+ * the ones with a valid bitmap and the highest sequence number, any of them
+ * can be the source of the resync of the regions dirty in their bitmaps. The
+ * other base bdevs missed some writes and are rebuilt entirely.
+ */
+static void
+raid1_bitmap_load_done(struct raid1_info *r1info)
+{
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t bitmap_size = r1info->bitmap_blocks * blocklen;
+	struct raid1_bitmap_load_ctx *ctx;
+	struct raid1_bitmap_header *header;
+	struct raid_base_bdev_info *base_info;
+	uint64_t max_seq = 0;
+	bool in_sync_found = false;
+	bool resync = false;
+	int source = -1;
+	uint8_t i;
+	size_t j;
+
+	if (r1info->stopping) {
+		raid1_bitmap_load_flushed(r1info, -ECANCELED);
+		return;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		ctx = &r1info->load_ctx[i];
+		header = (struct raid1_bitmap_header *)((uint8_t *)r1info->load_buf + i * bitmap_size);
+		ctx->success = ctx->success && raid1_bitmap_header_valid(r1info, header);
+		if (ctx->success) {
+			max_seq = spdk_max(max_seq, header->seq);
+		}
+	}
+
+	pthread_spin_lock(&r1info->lock);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		uint8_t *bits;
+
+		ctx = &r1info->load_ctx[i];
+		header = (struct raid1_bitmap_header *)((uint8_t *)r1info->load_buf + i * bitmap_size);
+		if (!ctx->success || header->seq != max_seq) {
+			ctx->success = false;
+			continue;
+		}
+
+		bits = (uint8_t *)header + blocklen;
+		for (j = 0; j < r1info->bitmap_bytes; j++) {
+			r1info->bits[j] |= bits[j];
+			r1info->resync_bits[j] |= bits[j];
+			r1info->flushed_bits[j] = in_sync_found ? (r1info->flushed_bits[j] & bits[j]) : bits[j];
+			if (bits[j] != 0) {
+				resync = true;
+			}
+		}
+		in_sync_found = true;
+		if (source < 0) {
+			source = i;
+		}
+	}
+
+	if (source < 0) {
+		/* A new raid bdev, or none of the bitmaps can be trusted */
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->desc != NULL) {
+				source = base_info - raid_bdev->base_bdev_info;
+				break;
+			}
+		}
+	}
+	if (!in_sync_found && source >= 0) {
+		SPDK_NOTICELOG("No valid bitmap found on raid bdev %s, synchronizing all base bdevs with %s\n",
+			       raid_bdev->bdev.name, raid_bdev->base_bdev_info[source].bdev->name);
+	}
+	r1info->header->seq = max_seq;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+		if (i == source || base_info->desc == NULL) {
+			continue;
+		}
+
+		if (!r1info->load_ctx[i].success) {
+			base_info->rebuilding = true;
+			base_info->resync = false;
+			base_info->rebuild_checkpoint = 0;
+		} else if (resync) {
+			base_info->rebuilding = true;
+			base_info->resync = true;
+			base_info->rebuild_checkpoint = 0;
+		}
+	}
+
+	r1info->last_clean_tsc = spdk_get_ticks();
+	r1info->loaded = true;
+	r1info->flushing = true;
+	pthread_spin_unlock(&r1info->lock);
+
+	raid1_bitmap_wake_waiters(r1info, 0);
+
+	/* Write the new sequence number, the base bdevs not in sync are left out from now on */
+	raid1_bitmap_flush(r1info, r1info->load_channels, raid1_bitmap_load_flushed, r1info);
+}
+
+static void
+raid1_bitmap_load_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid1_bitmap_load_ctx *ctx = cb_arg;
+	struct raid1_info *r1info = ctx->r1info;
+
+	spdk_bdev_free_io(bdev_io);
+
+	ctx->success = success;
+
+	if (--r1info->load_remaining == 0) {
+		raid1_bitmap_load_done(r1info);
+	}
+}
+
+static void
+raid1_bitmap_load(void *ctx)
+{
+	struct raid1_info *r1info = ctx;
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	size_t bitmap_size = r1info->bitmap_blocks * raid_bdev->bdev.blocklen;
+	struct raid_base_bdev_info *base_info;
+	struct raid1_bitmap_load_ctx *load_ctx;
+	uint8_t i;
+	int ret;
+
+	/* Keep the load from completing before all the reads are submitted */
+	r1info->load_remaining = raid_bdev->num_base_bdevs + 1;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+		load_ctx = &r1info->load_ctx[i];
+		load_ctx->r1info = r1info;
+		load_ctx->base_idx = i;
+
+		if (r1info->stopping || base_info->desc == NULL) {
+			r1info->load_remaining--;
+			continue;
+		}
+
+		r1info->load_channels[i] = spdk_bdev_get_io_channel(base_info->desc);
+		if (r1info->load_channels[i] == NULL) {
+			r1info->load_remaining--;
+			continue;
+		}
+
+		ret = spdk_bdev_read_blocks(base_info->desc, r1info->load_channels[i],
+					    (uint8_t *)r1info->load_buf + i * bitmap_size, r1info->data_blocks,
+					    r1info->bitmap_blocks, raid1_bitmap_load_read_done, load_ctx);
+		if (ret != 0) {
+			SPDK_ERRLOG("Failed to read the bitmap of base bdev %s: %s\n", base_info->bdev->name,
+				    spdk_strerror(-ret));
+			r1info->load_remaining--;
+		}
+	}
+
+	if (--r1info->load_remaining == 0) {
+		raid1_bitmap_load_done(r1info);
+	}
+}
+
+static int
+raid1_ioch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+raid1_ioch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+static struct spdk_io_channel *
+raid1_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid1_info *r1info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r1info);
+}
+
+/*
+ * Lay out the data and the bitmap on the base bdevs. The region size is the
+ * smallest power of 2 multiple of RAID1_BITMAP_REGION_SIZE_MIN_MB that keeps
+ * the bitmap within RAID1_BITMAP_MAX_BYTES.
+ */
+static int
+raid1_bitmap_init(struct raid1_info *r1info, uint64_t base_bdev_blockcnt)
+{
+	struct raid_bdev *raid_bdev = r1info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t region_blocks = (uint64_t)RAID1_BITMAP_REGION_SIZE_MIN_MB * 1024 * 1024 / blocklen;
+	uint64_t bitmap_blocks;
+
+	while (spdk_divide_round_up(base_bdev_blockcnt, region_blocks) > RAID1_BITMAP_MAX_BYTES * 8) {
+		region_blocks *= 2;
+	}
+	bitmap_blocks = 1 + spdk_divide_round_up(spdk_divide_round_up(base_bdev_blockcnt,
+			region_blocks), blocklen * 8);
+
+	if (base_bdev_blockcnt < bitmap_blocks + raid_bdev->strip_size) {
+		SPDK_ERRLOG("Base bdevs of raid bdev %s are too small\n", raid_bdev->bdev.name);
+		return -EINVAL;
+	}
+
+	r1info->data_blocks = (base_bdev_blockcnt - bitmap_blocks) & ~((uint64_t)raid_bdev->strip_size - 1);
+	r1info->region_blocks = region_blocks;
+	r1info->region_shift = spdk_u64log2(region_blocks);
+	r1info->num_regions = spdk_divide_round_up(r1info->data_blocks, region_blocks);
+	r1info->bitmap_blocks = bitmap_blocks;
+	r1info->bitmap_bytes = spdk_divide_round_up(r1info->num_regions, 8);
+
+	r1info->bitmap_buf = spdk_zmalloc(bitmap_blocks * blocklen, r1info->buf_align, NULL,
+					  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	r1info->flush_buf = spdk_zmalloc(bitmap_blocks * blocklen, r1info->buf_align, NULL,
+					 SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	r1info->flushed_bits = calloc(1, r1info->bitmap_bytes);
+	r1info->resync_bits = calloc(1, r1info->bitmap_bytes);
+	r1info->recent_bits = calloc(1, r1info->bitmap_bytes);
+	r1info->region_writes = calloc(r1info->num_regions, sizeof(*r1info->region_writes));
+	r1info->load_buf = spdk_zmalloc(bitmap_blocks * blocklen * raid_bdev->num_base_bdevs,
+					r1info->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	r1info->load_ctx = calloc(raid_bdev->num_base_bdevs, sizeof(*r1info->load_ctx));
+	r1info->load_channels = calloc(raid_bdev->num_base_bdevs, sizeof(*r1info->load_channels));
+	if (!r1info->bitmap_buf || !r1info->flush_buf || !r1info->flushed_bits ||
+	    !r1info->resync_bits || !r1info->recent_bits || !r1info->region_writes ||
+	    !r1info->load_buf || !r1info->load_ctx || !r1info->load_channels) {
+		SPDK_ERRLOG("Failed to allocate the bitmap of raid bdev %s\n", raid_bdev->bdev.name);
+		return -ENOMEM;
+	}
+
+	r1info->header = r1info->bitmap_buf;
+	memcpy(r1info->header->magic, RAID1_BITMAP_MAGIC, sizeof(r1info->header->magic));
+	r1info->header->version = RAID1_BITMAP_VERSION;
+	r1info->header->blocklen = blocklen;
+	r1info->header->data_blocks = r1info->data_blocks;
+	r1info->header->region_blocks = r1info->region_blocks;
+	r1info->header->num_regions = r1info->num_regions;
+	r1info->bits = (uint8_t *)r1info->bitmap_buf + blocklen;
+
+	return 0;
+}
+
+static int
+raid1_start(struct raid_bdev *raid_bdev)
+{
+	uint64_t min_blockcnt = UINT64_MAX;
+	struct raid_base_bdev_info *base_info;
+	struct raid1_info *r1info;
+	int ret;
+
+	r1info = calloc(1, sizeof(*r1info));
+	if (!r1info) {
+		SPDK_ERRLOG("Failed to allocate r1info\n");
+		return -ENOMEM;
+	}
+	r1info->raid_bdev = raid_bdev;
+	pthread_spin_init(&r1info->lock, PTHREAD_PROCESS_PRIVATE);
+	TAILQ_INIT(&r1info->waiters);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		min_blockcnt = spdk_min(min_blockcnt, base_info->bdev->blockcnt);
+		if (base_info->bdev->required_alignment > 0) {
+			r1info->buf_align = spdk_max(r1info->buf_align, 1UL << base_info->bdev->required_alignment);
+		}
+	}
+
+	ret = raid1_bitmap_init(r1info, min_blockcnt);
+	if (ret != 0) {
+		raid1_info_free(r1info);
+		return ret;
+	}
+
+	raid_bdev->bdev.blockcnt = r1info->data_blocks;
+	raid_bdev->module_private = r1info;
+
+	spdk_io_device_register(r1info, raid1_ioch_create, raid1_ioch_destroy,
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(uint32_t), NULL);
+
+	/* The IOs wait until the bitmaps are read from the base bdevs */
+	r1info->load_in_progress = true;
+	spdk_thread_send_msg(spdk_get_thread(), raid1_bitmap_load, r1info);
+
+	return 0;
+}
+
+static void
+raid1_io_device_unregister_done(void *io_device)
+{
+	struct raid1_info *r1info = io_device;
+
+	r1info->unregistered = true;
+	if (!r1info->load_in_progress) {
+		raid1_info_free(r1info);
+	}
+}
+
+static void
+raid1_stop(struct raid_bdev *raid_bdev)
+{
+	struct raid1_info *r1info = raid_bdev->module_private;
+
+	raid_bdev->module_private = NULL;
+	r1info->stopping = true;
+
+	/* The raid bdev channels may still be open, free r1info when they are gone */
+	spdk_io_device_unregister(r1info, raid1_io_device_unregister_done);
+}
+
+static int
+raid1_rebuild_base_bdev_data(struct raid_bdev *raid_bdev, uint8_t base_idx,
+			     uint64_t base_offset_blocks, uint64_t num_blocks,
+			     void *stripe_buf, void *base_buf)
+{
+	memcpy(base_buf, stripe_buf, num_blocks << raid_bdev->blocklen_shift);
+
+	return 0;
+}
+
+static bool
+raid1_rebuild_range_needed(struct raid_bdev *raid_bdev, uint8_t base_idx,
+			   uint64_t base_offset_blocks, uint64_t num_blocks)
+{
+	return raid1_regions_need_resync(raid_bdev->module_private, base_offset_blocks, num_blocks);
+}
+
+static void
+raid1_dump_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w)
+{
+	struct raid1_info *r1info = raid_bdev->module_private;
+	uint64_t dirty_regions = 0, flushes, i;
+
+	if (r1info == NULL) {
+		/* Not started or already stopped */
+		return;
+	}
+
+	pthread_spin_lock(&r1info->lock);
+	for (i = 0; i < r1info->num_regions; i++) {
+		dirty_regions += raid1_bit_test(r1info->bits, i);
+	}
+	flushes = r1info->flushes;
+	pthread_spin_unlock(&r1info->lock);
+
+	spdk_json_write_named_object_begin(w, "write_intent_bitmap");
+	spdk_json_write_named_uint64(w, "region_size_kb",
+				     (r1info->region_blocks << raid_bdev->blocklen_shift) / 1024);
+	spdk_json_write_named_uint64(w, "regions", r1info->num_regions);
+	spdk_json_write_named_uint64(w, "dirty_regions", dirty_regions);
+	spdk_json_write_named_uint64(w, "flushes", flushes);
+	spdk_json_write_object_end(w);
+}
+
+static struct raid_bdev_module g_raid1_module = {
+	.level = RAID1,
+	.base_bdevs_min = 2,
+	.base_bdevs_max_degraded = RAID_BDEV_MAX_DEGRADED_ALL_BUT_ONE,
+	.start = raid1_start,
+	.stop = raid1_stop,
+	.submit_rw_request = raid1_submit_rw_request,
+	.submit_null_payload_request = raid1_submit_rw_request,
+	.get_io_channel = raid1_get_io_channel,
+	.dump_info_json = raid1_dump_info_json,
+	.rebuild_base_bdev_data = raid1_rebuild_base_bdev_data,
+	.rebuild_range_needed = raid1_rebuild_range_needed,
+};
+RAID_MODULE_REGISTER(&g_raid1_module)
+
+SPDK_LOG_REGISTER_COMPONENT(bdev_raid1)
@@ -34,33 +34,1839 @@
 #include "bdev_raid.h"
 
 #include "spdk/env.h"
+#include "spdk/likely.h"
 #include "spdk/thread.h"
 #include "spdk/string.h"
 #include "spdk/util.h"
+#include "spdk/xor.h"
 
 #include "spdk/log.h"
 
+/* Number of shards of the stripe lock table. Must be a power of 2. */
+#define RAID5_STRIPE_LOCK_SHARDS 64
+
+/* Maximum number of idle stripe requests kept per IO channel */
+#define RAID5_MAX_CACHED_STRIPE_REQUESTS 32
+
+/* Initial number of iovecs allocated for each chunk of a stripe request */
+#define RAID5_CHUNK_IOVCNT_INIT 4
+
+/* Upper limits of the number of stripe cache entries and of their total size */
+#define RAID5_STRIPE_CACHE_MAX_ENTRIES 256
+#define RAID5_STRIPE_CACHE_MAX_SIZE_MB 32
+
+/* Maximum number of partial writes merged into a single stripe update */
+#define RAID5_MAX_BATCH_SIZE 32
+
+struct raid5_stripe_request;
+
+/* Range of blocks within a strip */
+struct raid5_strip_range {
+	uint64_t offset;
+	uint64_t blocks;
+};
+
+struct raid5_stripe_cache_entry {
+	/* Index of the cached stripe, UINT64_MAX if the entry is not used */
+	uint64_t stripe_index;
+
+	/* Set while the entry is used by the holder of the stripe lock */
+	bool busy;
+
+	/* Strip-sized buffers of the stripe, in the order of the stripe request chunks */
+	void *buf;
+
+	/* Link in the shard LRU list */
+	TAILQ_ENTRY(raid5_stripe_cache_entry) link;
+
+	/* Ranges of the strips whose content is known to match the base bdevs */
+	struct raid5_strip_range valid[0];
+};
+
+struct raid5_stripe_cache_stats {
+	/* Partial stripe updates that did not have to read anything */
+	uint64_t hits;
+
+	/* Partial stripe updates that had to read old data or parity */
+	uint64_t misses;
+
+	/* Partial stripe updates written as full stripes, with parity generated from data only */
+	uint64_t full_stripe_conversions;
+
+	/* Partial writes merged into the update of another write of the same stripe */
+	uint64_t coalesced_writes;
+};
+
+struct raid5_stripe_lock_shard {
+	pthread_spinlock_t lock;
+
+	/* Stripe requests holding a stripe lock */
+	TAILQ_HEAD(, raid5_stripe_request) active;
+
+	/* Stripe requests waiting for a stripe lock */
+	TAILQ_HEAD(, raid5_stripe_request) waiting;
+
+	/* Stripe cache entries of the stripes of this shard, least recently used first */
+	TAILQ_HEAD(, raid5_stripe_cache_entry) cache_lru;
+
+	struct raid5_stripe_cache_stats cache_stats;
+};
+
 struct raid5_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
 
-	/* Number of data blocks in a stripe (without parity) */
-	uint64_t stripe_blocks;
+	/* Number of data blocks in a stripe (without parity) */
+	uint64_t stripe_blocks;
+
+	/* Number of stripes on this array */
+	uint64_t total_stripes;
+
+	/* Alignment of the stripe request buffers */
+	size_t buf_align;
+
+	/* Number of stripe cache entries */
+	uint32_t cache_entries_num;
+
+	/* Stripe locks serializing the parity updates, sharded by stripe index */
+	struct raid5_stripe_lock_shard stripe_locks[RAID5_STRIPE_LOCK_SHARDS];
+
+	/* XOR sources of the parity rebuild, one per data strip */
+	void *rebuild_srcs[0];
+};
+
+struct raid5_io_channel {
+	/* Idle stripe requests with already allocated buffers */
+	TAILQ_HEAD(, raid5_stripe_request) free_requests;
+
+	/* Number of requests in the free_requests list */
+	uint32_t num_free_requests;
+};
+
+enum raid5_stripe_request_type {
+	RAID5_STRIPE_REQUEST_READ,
+	RAID5_STRIPE_REQUEST_FULL_STRIPE_WRITE,
+	RAID5_STRIPE_REQUEST_RMW_WRITE,
+};
+
+enum raid5_stripe_cache_result {
+	RAID5_STRIPE_CACHE_NONE,
+	RAID5_STRIPE_CACHE_HIT,
+	RAID5_STRIPE_CACHE_MISS,
+	RAID5_STRIPE_CACHE_FULL_STRIPE,
+};
+
+struct raid5_chunk {
+	/* The stripe request this chunk belongs to */
+	struct raid5_stripe_request *r5req;
+
+	/* Index of the base bdev holding this chunk in the current stripe */
+	uint8_t base_idx;
+
+	/* Range of the chunk accessed by the parent IO, in blocks within the strip */
+	uint64_t req_offset;
+	uint64_t req_blocks;
+
+	/* Part of the parent IO payload corresponding to the accessed range */
+	struct iovec *iovs;
+	int iovcnt;
+	int iovcnt_max;
+
+	/* Strip-sized buffer used for old data, parity and reconstruction */
+	void *buf;
+
+	/* Base bdev IO of the current stage, in blocks within the strip */
+	uint64_t io_offset;
+	uint64_t io_blocks;
+	struct iovec *io_iovs;
+	int io_iovcnt;
+	struct iovec buf_iov;
+
+	/* Range of the chunk written by all the requests of a batch */
+	uint64_t batch_offset;
+	uint64_t batch_blocks;
+
+	/* Set if the base bdev IO of the current stage failed */
+	bool failed;
+};
+
+typedef void (*raid5_stripe_request_cb)(struct raid5_stripe_request *r5req);
+
+/* One iovec array taking part in an XOR, with the walk position inside it */
+struct raid5_xor_vec {
+	struct iovec *iovs;
+	int iovcnt;
+	int idx;
+	size_t off;
+};
+
+struct raid5_stripe_request {
+	struct raid5_info *r5info;
+
+	struct raid5_io_channel *r5ch;
+
+	/* The parent raid IO */
+	struct raid_bdev_io *raid_io;
+
+	/* Thread on which the request is processed */
+	struct spdk_thread *thread;
+
+	enum raid5_stripe_request_type type;
+
+	/* Index of the stripe, also the strip index on each base bdev */
+	uint64_t stripe_index;
+
+	/* The first and last data chunks accessed by the parent IO */
+	uint8_t first_chunk;
+	uint8_t last_chunk;
+
+	/* The parity chunk of the stripe, last entry of the chunks array */
+	struct raid5_chunk *parity_chunk;
+
+	/* Data chunk being reconstructed by a degraded read */
+	struct raid5_chunk *degraded_chunk;
+
+	/* State of the current stage of base bdev IOs */
+	enum spdk_bdev_io_type stage_io_type;
+	uint8_t stage_submit_next;
+	/* One per base bdev IO, plus a reference held while they are submitted */
+	uint16_t stage_remaining;
+	raid5_stripe_request_cb stage_cb;
+
+	/* Stripe lock state */
+	bool stripe_locked;
+	raid5_stripe_request_cb lock_cb;
+	TAILQ_ENTRY(raid5_stripe_request) lock_link;
+
+	/* Stripe cache entry used by the request while it holds the stripe lock */
+	struct raid5_stripe_cache_entry *cache_entry;
+	enum raid5_stripe_cache_result cache_result;
+
+	/* Partial writes of the same stripe merged into this one, linked by lock_link */
+	TAILQ_HEAD(, raid5_stripe_request) batch;
+	uint32_t batch_size;
+
+	/* Set if the request is not part of the batch update because it can't be written */
+	bool batch_excluded;
+
+	struct spdk_bdev_io_wait_entry waitq_entry;
+
+	/* Link in the channel free_requests list */
+	TAILQ_ENTRY(raid5_stripe_request) link;
+
+	/* Base of the chunk buffers, allocated as a single block */
+	void *bufs;
+
+	/* XOR scratch space: the destination and up to num_base_bdevs sources */
+	struct raid5_xor_vec *xor_vecs;
+	void **xor_srcs;
+	uint8_t xor_nsrc;
+
+	/* Chunks of the stripe, data chunks first, parity last */
+	struct raid5_chunk chunks[0];
+};
+
+#define RAID5_FOR_EACH_CHUNK(r, c) \
+	for (c = r->chunks; c < r->chunks + r->r5info->raid_bdev->num_base_bdevs; c++)
+
+#define RAID5_FOR_EACH_DATA_CHUNK(r, c) \
+	for (c = r->chunks; c < r->parity_chunk; c++)
+
+#define RAID5_FOR_EACH_BATCH_REQUEST(r, b) \
+	for (b = r; b != NULL; b = (b == r ? TAILQ_FIRST(&r->batch) : TAILQ_NEXT(b, lock_link)))
+
+static inline size_t
+raid5_chunk_idx(const struct raid5_chunk *chunk)
+{
+	return chunk - chunk->r5req->chunks;
+}
+
+static inline bool
+raid5_chunk_available(const struct raid5_chunk *chunk)
+{
+	const struct raid5_stripe_request *r5req = chunk->r5req;
+
+	return raid_bdev_io_base_bdev_available(r5req->raid_io, chunk->base_idx,
+						r5req->stripe_index << r5req->r5info->raid_bdev->strip_size_shift);
+}
+
+/* Check if any data chunk written by the request is not available */
+static bool
+raid5_stripe_request_degraded(const struct raid5_stripe_request *r5req)
+{
+	const struct raid5_chunk *chunk;
+
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		if (!raid5_chunk_available(chunk)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Start an XOR into dest, the sources are then added with raid5_xor_add_src() */
+static void
+raid5_xor_init(struct raid5_stripe_request *r5req, struct iovec *dest_iovs, int dest_iovcnt)
+{
+	r5req->xor_vecs[0].iovs = dest_iovs;
+	r5req->xor_vecs[0].iovcnt = dest_iovcnt;
+	r5req->xor_nsrc = 0;
+}
+
+static void
+raid5_xor_add_src(struct raid5_stripe_request *r5req, struct iovec *iovs, int iovcnt)
+{
+	struct raid5_xor_vec *vec = &r5req->xor_vecs[++r5req->xor_nsrc];
+
+	assert(r5req->xor_nsrc <= r5req->r5info->raid_bdev->num_base_bdevs);
+	vec->iovs = iovs;
+	vec->iovcnt = iovcnt;
+}
+
+/*
+ * XOR the sources into dest, walking all the iovec arrays in lockstep so that
+ * each contiguous segment common to all of them is handled by a single call to
+ * the vectorized XOR routine. dest may also be one of the sources.
+ */
+static int
+raid5_xor_iovs(struct raid5_stripe_request *r5req, size_t len)
+{
+	struct raid5_xor_vec *vecs = r5req->xor_vecs;
+	uint8_t nsrc = r5req->xor_nsrc;
+	uint16_t i, nvec = nsrc + 1;
+	int ret;
+
+	for (i = 0; i < nvec; i++) {
+		vecs[i].idx = 0;
+		vecs[i].off = 0;
+	}
+
+	while (len > 0) {
+		size_t seg = len;
+
+		for (i = 0; i < nvec; i++) {
+			assert(vecs[i].idx < vecs[i].iovcnt);
+			seg = spdk_min(seg, vecs[i].iovs[vecs[i].idx].iov_len - vecs[i].off);
+		}
+
+		for (i = 1; i < nvec; i++) {
+			r5req->xor_srcs[i - 1] = (uint8_t *)vecs[i].iovs[vecs[i].idx].iov_base +
+						 vecs[i].off;
+		}
+
+		ret = spdk_xor_gen((uint8_t *)vecs[0].iovs[vecs[0].idx].iov_base + vecs[0].off,
+				   r5req->xor_srcs, nsrc, seg);
+		if (ret != 0) {
+			return ret;
+		}
+
+		for (i = 0; i < nvec; i++) {
+			vecs[i].off += seg;
+			if (vecs[i].off == vecs[i].iovs[vecs[i].idx].iov_len) {
+				vecs[i].off = 0;
+				vecs[i].idx++;
+			}
+		}
+
+		len -= seg;
+	}
+
+	return 0;
+}
+
+/*
+ * Map the part of the parent IO payload starting at offset bytes and spanning
+ * len bytes to the chunk iovecs.
+ */
+static int
+raid5_chunk_map_iovs(struct raid5_chunk *chunk, const struct iovec *iovs, int iovcnt,
+		     uint64_t offset, uint64_t len)
+{
+	int i;
+
+	chunk->iovcnt = 0;
+
+	for (i = 0; i < iovcnt && len > 0; i++) {
+		uint64_t seg;
+
+		if (offset >= iovs[i].iov_len) {
+			offset -= iovs[i].iov_len;
+			continue;
+		}
+
+		if (chunk->iovcnt == chunk->iovcnt_max) {
+			struct iovec *tmp;
+			int iovcnt_max = chunk->iovcnt_max * 2;
+
+			tmp = realloc(chunk->iovs, iovcnt_max * sizeof(*tmp));
+			if (!tmp) {
+				return -ENOMEM;
+			}
+			chunk->iovs = tmp;
+			chunk->iovcnt_max = iovcnt_max;
+		}
+
+		seg = spdk_min(iovs[i].iov_len - offset, len);
+		chunk->iovs[chunk->iovcnt].iov_base = (uint8_t *)iovs[i].iov_base + offset;
+		chunk->iovs[chunk->iovcnt].iov_len = seg;
+		chunk->iovcnt++;
+
+		offset = 0;
+		len -= seg;
+	}
+
+	if (len > 0) {
+		assert(false);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void
+raid5_chunk_set_io_iov(struct raid5_chunk *chunk, void *buf, uint64_t offset, uint64_t blocks)
+{
+	uint32_t blocklen_shift = chunk->r5req->r5info->raid_bdev->blocklen_shift;
+
+	chunk->io_offset = offset;
+	chunk->io_blocks = blocks;
+	chunk->buf_iov.iov_base = buf;
+	chunk->buf_iov.iov_len = blocks << blocklen_shift;
+	chunk->io_iovs = &chunk->buf_iov;
+	chunk->io_iovcnt = 1;
+}
+
+static void
+raid5_chunk_set_io_buf(struct raid5_chunk *chunk, uint64_t offset, uint64_t blocks)
+{
+	uint32_t blocklen_shift = chunk->r5req->r5info->raid_bdev->blocklen_shift;
+
+	raid5_chunk_set_io_iov(chunk, (uint8_t *)chunk->buf + (offset << blocklen_shift), offset,
+			       blocks);
+}
+
+static void
+raid5_chunk_set_io_req(struct raid5_chunk *chunk)
+{
+	chunk->io_offset = chunk->req_offset;
+	chunk->io_blocks = chunk->req_blocks;
+	chunk->io_iovs = chunk->iovs;
+	chunk->io_iovcnt = chunk->iovcnt;
+}
+
+static void
+raid5_stripe_request_destroy(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *chunk;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		free(chunk->iovs);
+	}
+	free(r5req->xor_vecs);
+	free(r5req->xor_srcs);
+	spdk_free(r5req->bufs);
+	free(r5req);
+}
+
+static struct raid5_stripe_request *
+raid5_stripe_request_create(struct raid5_info *r5info, struct raid5_io_channel *r5ch)
+{
+	struct raid_bdev *raid_bdev = r5info->raid_bdev;
+	struct raid5_stripe_request *r5req;
+	struct raid5_chunk *chunk;
+	size_t strip_bytes = (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift;
+
+	r5req = calloc(1, sizeof(*r5req) + sizeof(*chunk) * raid_bdev->num_base_bdevs);
+	if (!r5req) {
+		return NULL;
+	}
+
+	r5req->r5info = r5info;
+	r5req->r5ch = r5ch;
+	r5req->parity_chunk = &r5req->chunks[raid_bdev->num_base_bdevs - 1];
+
+	r5req->bufs = spdk_malloc(strip_bytes * raid_bdev->num_base_bdevs, r5info->buf_align, NULL,
+				  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (!r5req->bufs) {
+		free(r5req);
+		return NULL;
+	}
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		chunk->r5req = r5req;
+		chunk->buf = (uint8_t *)r5req->bufs + strip_bytes * raid5_chunk_idx(chunk);
+		chunk->iovcnt_max = RAID5_CHUNK_IOVCNT_INIT;
+		chunk->iovs = calloc(chunk->iovcnt_max, sizeof(*chunk->iovs));
+		if (!chunk->iovs) {
+			raid5_stripe_request_destroy(r5req);
+			return NULL;
+		}
+	}
+
+	r5req->xor_vecs = calloc(raid_bdev->num_base_bdevs + 1, sizeof(*r5req->xor_vecs));
+	r5req->xor_srcs = calloc(raid_bdev->num_base_bdevs, sizeof(*r5req->xor_srcs));
+	if (!r5req->xor_vecs || !r5req->xor_srcs) {
+		raid5_stripe_request_destroy(r5req);
+		return NULL;
+	}
+
+	return r5req;
+}
+
+static struct raid5_stripe_request *
+raid5_stripe_request_get(struct raid5_info *r5info, struct raid5_io_channel *r5ch)
+{
+	struct raid5_stripe_request *r5req;
+
+	r5req = TAILQ_FIRST(&r5ch->free_requests);
+	if (r5req) {
+		TAILQ_REMOVE(&r5ch->free_requests, r5req, link);
+		r5ch->num_free_requests--;
+		return r5req;
+	}
+
+	return raid5_stripe_request_create(r5info, r5ch);
+}
+
+static void
+raid5_stripe_request_put(struct raid5_stripe_request *r5req)
+{
+	struct raid5_io_channel *r5ch = r5req->r5ch;
+
+	if (r5ch->num_free_requests < RAID5_MAX_CACHED_STRIPE_REQUESTS) {
+		TAILQ_INSERT_HEAD(&r5ch->free_requests, r5req, link);
+		r5ch->num_free_requests++;
+	} else {
+		raid5_stripe_request_destroy(r5req);
+	}
+}
+
+static inline struct raid5_stripe_lock_shard *
+raid5_stripe_lock_shard(struct raid5_info *r5info, uint64_t stripe_index)
+{
+	return &r5info->stripe_locks[stripe_index & (RAID5_STRIPE_LOCK_SHARDS - 1)];
+}
+
+static inline void *
+raid5_stripe_cache_entry_buf(const struct raid5_stripe_request *r5req,
+			     const struct raid5_chunk *chunk, uint64_t offset)
+{
+	const struct raid_bdev *raid_bdev = r5req->r5info->raid_bdev;
+
+	return (uint8_t *)r5req->cache_entry->buf +
+	       (((raid5_chunk_idx(chunk) << raid_bdev->strip_size_shift) + offset) <<
+		raid_bdev->blocklen_shift);
+}
+
+static void
+raid5_stripe_cache_entry_invalidate(struct raid5_stripe_cache_entry *entry, uint8_t num_chunks)
+{
+	memset(entry->valid, 0, sizeof(entry->valid[0]) * num_chunks);
+}
+
+static bool
+raid5_stripe_cache_entry_is_valid(const struct raid5_stripe_cache_entry *entry,
+				  uint8_t num_chunks)
+{
+	uint8_t i;
+
+	for (i = 0; i < num_chunks; i++) {
+		if (entry->valid[i].blocks > 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Bind a stripe cache entry to a request that has just acquired the stripe
+ * lock. Partial writes get the entry of their stripe or recycle the least
+ * recently used idle one, full stripe writes drop the cached content of their
+ * stripe. Must be called with the shard lock held.
+ */
+static void
+raid5_stripe_cache_acquire(struct raid5_stripe_lock_shard *shard,
+			   struct raid5_stripe_request *r5req)
+{
+	uint8_t num_chunks = r5req->r5info->raid_bdev->num_base_bdevs;
+	struct raid5_stripe_cache_entry *entry;
+
+	assert(r5req->cache_entry == NULL);
+
+	TAILQ_FOREACH(entry, &shard->cache_lru, link) {
+		if (entry->stripe_index == r5req->stripe_index) {
+			break;
+		}
+	}
+
+	if (r5req->type == RAID5_STRIPE_REQUEST_FULL_STRIPE_WRITE) {
+		if (entry) {
+			assert(!entry->busy);
+			raid5_stripe_cache_entry_invalidate(entry, num_chunks);
+		}
+		return;
+	} else if (r5req->type != RAID5_STRIPE_REQUEST_RMW_WRITE) {
+		return;
+	}
+
+	if (!entry) {
+		TAILQ_FOREACH(entry, &shard->cache_lru, link) {
+			if (!entry->busy) {
+				break;
+			}
+		}
+		if (!entry) {
+			return;
+		}
+		entry->stripe_index = r5req->stripe_index;
+		raid5_stripe_cache_entry_invalidate(entry, num_chunks);
+	}
+
+	assert(!entry->busy);
+	entry->busy = true;
+	r5req->cache_entry = entry;
+}
+
+/* Must be called with the shard lock held */
+static void
+raid5_stripe_cache_release(struct raid5_stripe_lock_shard *shard,
+			   struct raid5_stripe_request *r5req)
+{
+	struct raid5_stripe_cache_entry *entry = r5req->cache_entry;
+
+	if (!entry) {
+		return;
+	}
+
+	switch (r5req->cache_result) {
+	case RAID5_STRIPE_CACHE_HIT:
+		shard->cache_stats.hits++;
+		break;
+	case RAID5_STRIPE_CACHE_MISS:
+		shard->cache_stats.misses++;
+		break;
+	case RAID5_STRIPE_CACHE_FULL_STRIPE:
+		shard->cache_stats.full_stripe_conversions++;
+		break;
+	default:
+		break;
+	}
+	shard->cache_stats.coalesced_writes += r5req->batch_size;
+
+	/* Entries without valid content are recycled first */
+	TAILQ_REMOVE(&shard->cache_lru, entry, link);
+	if (raid5_stripe_cache_entry_is_valid(entry, r5req->r5info->raid_bdev->num_base_bdevs)) {
+		TAILQ_INSERT_TAIL(&shard->cache_lru, entry, link);
+	} else {
+		entry->stripe_index = UINT64_MAX;
+		TAILQ_INSERT_HEAD(&shard->cache_lru, entry, link);
+	}
+
+	entry->busy = false;
+	r5req->cache_entry = NULL;
+}
+
+/*
+ * Merge the partial writes of the same stripe waiting right behind a request
+ * that has just acquired the stripe lock into its update. Only the writes
+ * submitted on the same thread are merged, as they have to be completed there.
+ * Must be called with the shard lock held.
+ */
+static void
+raid5_stripe_batch_gather(struct raid5_stripe_lock_shard *shard,
+			  struct raid5_stripe_request *r5req)
+{
+	struct raid5_stripe_request *tmp, *next;
+
+	TAILQ_FOREACH_SAFE(tmp, &shard->waiting, lock_link, next) {
+		if (tmp->stripe_index != r5req->stripe_index) {
+			continue;
+		}
+
+		if (tmp->type != RAID5_STRIPE_REQUEST_RMW_WRITE || tmp->thread != r5req->thread ||
+		    r5req->batch_size == RAID5_MAX_BATCH_SIZE) {
+			break;
+		}
+
+		TAILQ_REMOVE(&shard->waiting, tmp, lock_link);
+		TAILQ_INSERT_TAIL(&r5req->batch, tmp, lock_link);
+		tmp->stripe_locked = false;
+		r5req->batch_size++;
+	}
+}
+
+static void
+_raid5_stripe_lock_acquired(void *ctx)
+{
+	struct raid5_stripe_request *r5req = ctx;
+
+	r5req->lock_cb(r5req);
+}
+
+/*
+ * Serialize the requests modifying the parity of the same stripe. Requests from
+ * any thread may contend for a stripe, so the lock table is sharded by stripe
+ * index to keep the critical sections short and mostly uncontended. The stripe
+ * cache is sharded the same way and protected by the same locks.
+ */
+static void
+raid5_stripe_lock(struct raid5_stripe_request *r5req, raid5_stripe_request_cb cb)
+{
+	struct raid5_stripe_lock_shard *shard;
+	struct raid5_stripe_request *tmp;
+
+	assert(!r5req->stripe_locked);
+	shard = raid5_stripe_lock_shard(r5req->r5info, r5req->stripe_index);
+	r5req->lock_cb = cb;
+	r5req->stripe_locked = true;
+
+	pthread_spin_lock(&shard->lock);
+	TAILQ_FOREACH(tmp, &shard->active, lock_link) {
+		if (tmp->stripe_index == r5req->stripe_index) {
+			TAILQ_INSERT_TAIL(&shard->waiting, r5req, lock_link);
+			pthread_spin_unlock(&shard->lock);
+			return;
+		}
+	}
+	TAILQ_INSERT_TAIL(&shard->active, r5req, lock_link);
+	raid5_stripe_cache_acquire(shard, r5req);
+	pthread_spin_unlock(&shard->lock);
+
+	cb(r5req);
+}
+
+static void
+raid5_stripe_unlock(struct raid5_stripe_request *r5req)
+{
+	struct raid5_stripe_lock_shard *shard;
+	struct raid5_stripe_request *tmp;
+
+	assert(r5req->stripe_locked);
+	shard = raid5_stripe_lock_shard(r5req->r5info, r5req->stripe_index);
+	r5req->stripe_locked = false;
+
+	pthread_spin_lock(&shard->lock);
+	raid5_stripe_cache_release(shard, r5req);
+	TAILQ_REMOVE(&shard->active, r5req, lock_link);
+	TAILQ_FOREACH(tmp, &shard->waiting, lock_link) {
+		if (tmp->stripe_index == r5req->stripe_index) {
+			TAILQ_REMOVE(&shard->waiting, tmp, lock_link);
+			TAILQ_INSERT_TAIL(&shard->active, tmp, lock_link);
+			raid5_stripe_cache_acquire(shard, tmp);
+			if (tmp->cache_entry) {
+				raid5_stripe_batch_gather(shard, tmp);
+			}
+			break;
+		}
+	}
+	pthread_spin_unlock(&shard->lock);
+
+	if (tmp) {
+		spdk_thread_send_msg(tmp->thread, _raid5_stripe_lock_acquired, tmp);
+	}
+}
+
+static void
+raid5_stripe_request_complete(struct raid5_stripe_request *r5req, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = r5req->raid_io;
+
+	assert(TAILQ_EMPTY(&r5req->batch));
+
+	if (r5req->stripe_locked) {
+		raid5_stripe_unlock(r5req);
+	}
+
+	raid5_stripe_request_put(r5req);
+
+	raid_bdev_io_complete(raid_io, status);
+}
+
+static void
+raid5_stage_put(struct raid5_stripe_request *r5req)
+{
+	assert(r5req->stage_remaining > 0);
+	if (--r5req->stage_remaining == 0) {
+		r5req->stage_cb(r5req);
+	}
+}
+
+static void
+raid5_chunk_io_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid5_chunk *chunk = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		chunk->failed = true;
+	}
+
+	raid5_stage_put(chunk->r5req);
+}
+
+static void raid5_stage_submit(struct raid5_stripe_request *r5req);
+
+static void
+_raid5_stage_submit(void *ctx)
+{
+	struct raid5_stripe_request *r5req = ctx;
+
+	raid5_stage_submit(r5req);
+}
+
+/*
+ * Submit the base bdev IOs of the current stage. The stage holds an extra
+ * reference until all of them are submitted, so that its completion callback
+ * never runs while this function still walks the chunks. Base bdevs that are
+ * not available are not submitted to and their chunks are marked as failed.
+ */
+static void
+raid5_stage_submit(struct raid5_stripe_request *r5req)
+{
+	struct raid_bdev_io *raid_io = r5req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t i;
+	int ret;
+
+	for (i = r5req->stage_submit_next; i < raid_bdev->num_base_bdevs; i++) {
+		struct raid5_chunk *chunk = &r5req->chunks[i];
+		struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[chunk->base_idx];
+		struct spdk_io_channel *base_ch = raid_io->raid_ch->base_channel[chunk->base_idx];
+		uint64_t base_offset_blocks;
+
+		if (chunk->io_blocks == 0) {
+			continue;
+		}
+
+		if (!raid5_chunk_available(chunk)) {
+			chunk->failed = true;
+			r5req->stage_remaining--;
+			continue;
+		}
+
+		base_offset_blocks = (r5req->stripe_index << raid_bdev->strip_size_shift) +
+				     chunk->io_offset;
+
+		if (r5req->stage_io_type == SPDK_BDEV_IO_TYPE_READ) {
+			ret = spdk_bdev_readv_blocks(base_info->desc, base_ch,
+						     chunk->io_iovs, chunk->io_iovcnt,
+						     base_offset_blocks, chunk->io_blocks,
+						     raid5_chunk_io_complete, chunk);
+		} else {
+			assert(r5req->stage_io_type == SPDK_BDEV_IO_TYPE_WRITE);
+			ret = spdk_bdev_writev_blocks(base_info->desc, base_ch,
+						      chunk->io_iovs, chunk->io_iovcnt,
+						      base_offset_blocks, chunk->io_blocks,
+						      raid5_chunk_io_complete, chunk);
+		}
+
+		if (spdk_unlikely(ret != 0)) {
+			if (ret == -ENOMEM) {
+				r5req->stage_submit_next = i;
+				r5req->waitq_entry.bdev = base_info->bdev;
+				r5req->waitq_entry.cb_fn = _raid5_stage_submit;
+				r5req->waitq_entry.cb_arg = r5req;
+				spdk_bdev_queue_io_wait(base_info->bdev, base_ch, &r5req->waitq_entry);
+				return;
+			}
+
+			SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+			assert(false);
+			chunk->failed = true;
+			r5req->stage_remaining--;
+		}
+	}
+
+	raid5_stage_put(r5req);
+}
+
+static void
+raid5_stage_start(struct raid5_stripe_request *r5req, enum spdk_bdev_io_type io_type,
+		  raid5_stripe_request_cb cb)
+{
+	struct raid5_chunk *chunk;
+
+	r5req->stage_io_type = io_type;
+	r5req->stage_cb = cb;
+	r5req->stage_submit_next = 0;
+	r5req->stage_remaining = 1;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		chunk->failed = false;
+		if (chunk->io_blocks > 0) {
+			r5req->stage_remaining++;
+		}
+	}
+
+	raid5_stage_submit(r5req);
+}
+
+static bool
+raid5_stage_failed(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *chunk;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk->failed) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Don't submit writes to the missing base bdevs. Returns the number of chunks
+ * that could not be written.
+ */
+static uint8_t
+raid5_stage_skip_missing(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *chunk;
+	uint8_t missing = 0;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk->io_blocks > 0 && !raid5_chunk_available(chunk)) {
+			chunk->io_blocks = 0;
+			missing++;
+		}
+	}
+
+	return missing;
+}
+
+static void
+raid5_write_done(struct raid5_stripe_request *r5req)
+{
+	raid5_stripe_request_complete(r5req, raid5_stage_failed(r5req) ?
+				      SPDK_BDEV_IO_STATUS_FAILED : SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+raid5_reconstruct_read_done(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *degraded = r5req->degraded_chunk;
+	struct raid5_chunk *chunk;
+	int ret;
+
+	if (raid5_stage_failed(r5req)) {
+		SPDK_ERRLOG("Failed to reconstruct stripe %" PRIu64 "\n", r5req->stripe_index);
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid5_xor_init(r5req, degraded->iovs, degraded->iovcnt);
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk != degraded) {
+			raid5_xor_add_src(r5req, chunk->io_iovs, chunk->io_iovcnt);
+		}
+	}
+
+	ret = raid5_xor_iovs(r5req,
+			     degraded->req_blocks << r5req->r5info->raid_bdev->blocklen_shift);
+
+	raid5_stripe_request_complete(r5req, ret == 0 ?
+				      SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid5_reconstruct_read(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *degraded = r5req->degraded_chunk;
+	struct raid5_chunk *chunk;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk == degraded) {
+			chunk->io_blocks = 0;
+		} else {
+			raid5_chunk_set_io_buf(chunk, degraded->req_offset, degraded->req_blocks);
+		}
+	}
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_READ, raid5_reconstruct_read_done);
+}
+
+static void
+raid5_read_done(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *chunk;
+
+	r5req->degraded_chunk = NULL;
+
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		if (!chunk->failed) {
+			continue;
+		}
+
+		if (r5req->degraded_chunk != NULL) {
+			SPDK_ERRLOG("Failed to read stripe %" PRIu64 " from more than one base bdev\n",
+				    r5req->stripe_index);
+			raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+
+		r5req->degraded_chunk = chunk;
+	}
+
+	if (r5req->degraded_chunk == NULL) {
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	SPDK_DEBUGLOG(bdev_raid5, "reconstructing chunk %zu of stripe %" PRIu64 "\n",
+		      raid5_chunk_idx(r5req->degraded_chunk), r5req->stripe_index);
+
+	/* Lock the stripe so that the parity is consistent with the data we read */
+	raid5_stripe_lock(r5req, raid5_reconstruct_read);
+}
+
+static void
+raid5_submit_read(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *chunk;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		raid5_chunk_set_io_req(chunk);
+	}
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_READ, raid5_read_done);
+}
+
+static void
+raid5_full_stripe_write(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	struct raid5_chunk *chunk;
+	int ret;
+
+	raid5_chunk_set_io_buf(parity, 0, r5req->r5info->raid_bdev->strip_size);
+
+	raid5_xor_init(r5req, parity->io_iovs, parity->io_iovcnt);
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		raid5_xor_add_src(r5req, chunk->iovs, chunk->iovcnt);
+		raid5_chunk_set_io_req(chunk);
+	}
+
+	/* No old data is needed, the parity is generated from the new data only */
+	ret = raid5_xor_iovs(r5req, parity->buf_iov.iov_len);
+	if (ret != 0) {
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (raid5_stage_skip_missing(r5req) >
+	    r5req->r5info->raid_bdev->module->base_bdevs_max_degraded) {
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_WRITE, raid5_write_done);
+}
+
+static void
+raid5_rmw_read_done(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	uint32_t blocklen_shift = r5req->r5info->raid_bdev->blocklen_shift;
+	struct raid5_chunk *chunk;
+	int ret;
+
+	if (raid5_stage_failed(r5req)) {
+		SPDK_ERRLOG("Failed to read old data of stripe %" PRIu64 "\n", r5req->stripe_index);
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* new parity = old parity ^ old data ^ new data, for each modified range */
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		struct iovec parity_iov = {
+			.iov_base = (uint8_t *)parity->buf + (chunk->req_offset << blocklen_shift),
+			.iov_len = chunk->req_blocks << blocklen_shift,
+		};
+
+		raid5_xor_init(r5req, &parity_iov, 1);
+		raid5_xor_add_src(r5req, &parity_iov, 1);
+		raid5_xor_add_src(r5req, &chunk->buf_iov, 1);
+		raid5_xor_add_src(r5req, chunk->iovs, chunk->iovcnt);
+
+		ret = raid5_xor_iovs(r5req, parity_iov.iov_len);
+		if (ret != 0) {
+			raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+	}
+
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		raid5_chunk_set_io_req(chunk);
+	}
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_WRITE, raid5_write_done);
+}
+
+static void
+raid5_strip_range_merge(struct raid5_strip_range *range, uint64_t offset, uint64_t blocks)
+{
+	uint64_t end = offset + blocks;
+
+	if (range->blocks > 0 && offset <= range->offset + range->blocks && range->offset <= end) {
+		end = spdk_max(end, range->offset + range->blocks);
+		range->offset = spdk_min(offset, range->offset);
+		range->blocks = end - range->offset;
+	} else {
+		range->offset = offset;
+		range->blocks = blocks;
+	}
+}
+
+/*
+ * Get the part of the range starting at offset and spanning blocks that is not
+ * covered by range. If that is not contiguous, the whole range is returned.
+ */
+static void
+raid5_strip_range_missing(const struct raid5_strip_range *range, uint64_t offset,
+			  uint64_t blocks, struct raid5_strip_range *missing)
+{
+	uint64_t end = offset + blocks;
+	uint64_t range_end = range->offset + range->blocks;
+
+	missing->offset = offset;
+	missing->blocks = blocks;
+
+	if (range->blocks == 0 || range->offset >= end || range_end <= offset) {
+		return;
+	}
+
+	if (range->offset <= offset) {
+		missing->offset = spdk_min(range_end, end);
+		missing->blocks = end - missing->offset;
+	} else if (range_end >= end) {
+		missing->blocks = range->offset - offset;
+	}
+}
+
+static void
+raid5_stripe_batch_complete(struct raid5_stripe_request *r5req, enum spdk_bdev_io_status status)
+{
+	struct raid5_stripe_request *tmp;
 
-	/* Number of stripes on this array */
-	uint64_t total_stripes;
-};
+	while ((tmp = TAILQ_FIRST(&r5req->batch))) {
+		struct raid_bdev_io *raid_io = tmp->raid_io;
+		bool excluded = tmp->batch_excluded;
+
+		TAILQ_REMOVE(&r5req->batch, tmp, lock_link);
+		raid5_stripe_request_put(tmp);
+
+		raid_bdev_io_complete(raid_io, excluded ? SPDK_BDEV_IO_STATUS_FAILED : status);
+	}
+
+	raid5_stripe_request_complete(r5req, r5req->batch_excluded ?
+				      SPDK_BDEV_IO_STATUS_FAILED : status);
+}
+
+static void
+raid5_stripe_batch_write_done(struct raid5_stripe_request *r5req)
+{
+	if (raid5_stage_failed(r5req)) {
+		/* The cached content may not match the base bdevs anymore */
+		raid5_stripe_cache_entry_invalidate(r5req->cache_entry,
+						    r5req->r5info->raid_bdev->num_base_bdevs);
+		raid5_stripe_batch_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid5_stripe_batch_complete(r5req, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+/* XOR the cached data of the chunk ranges written by the batch into the cached parity */
+static int
+raid5_stripe_batch_xor_parity(struct raid5_stripe_request *r5req)
+{
+	uint32_t blocklen_shift = r5req->r5info->raid_bdev->blocklen_shift;
+	struct raid5_chunk *chunk;
+	void *srcs[2];
+	int ret;
+
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		if (chunk->batch_blocks == 0) {
+			continue;
+		}
+
+		srcs[0] = raid5_stripe_cache_entry_buf(r5req, r5req->parity_chunk, chunk->batch_offset);
+		srcs[1] = raid5_stripe_cache_entry_buf(r5req, chunk, chunk->batch_offset);
+
+		ret = spdk_xor_gen(srcs[0], srcs, SPDK_COUNTOF(srcs),
+				   chunk->batch_blocks << blocklen_shift);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Apply the writes of the batch to the cached stripe, in the order they were
+ * submitted, update the cached parity and write the modified ranges back.
+ */
+static void
+raid5_stripe_batch_update(struct raid5_stripe_request *r5req)
+{
+	struct raid_bdev *raid_bdev = r5req->r5info->raid_bdev;
+	struct raid5_stripe_cache_entry *entry = r5req->cache_entry;
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	struct raid5_stripe_request *tmp;
+	struct raid5_chunk *chunk;
+	int ret = 0;
+
+	if (r5req->cache_result != RAID5_STRIPE_CACHE_FULL_STRIPE && parity->batch_blocks > 0) {
+		/* Remove the old data from the parity */
+		ret = raid5_stripe_batch_xor_parity(r5req);
+	}
+
+	RAID5_FOR_EACH_BATCH_REQUEST(r5req, tmp) {
+		if (tmp->batch_excluded) {
+			continue;
+		}
+
+		for (chunk = &tmp->chunks[tmp->first_chunk];
+		     chunk <= &tmp->chunks[tmp->last_chunk]; chunk++) {
+			struct iovec iov = {
+				.iov_base = raid5_stripe_cache_entry_buf(r5req, chunk, chunk->req_offset),
+				.iov_len = chunk->req_blocks << raid_bdev->blocklen_shift,
+			};
+
+			spdk_iovcpy(chunk->iovs, chunk->iovcnt, &iov, 1);
+		}
+	}
+
+	if (ret == 0 && r5req->cache_result == RAID5_STRIPE_CACHE_FULL_STRIPE) {
+		void **srcs = r5req->xor_srcs;
+		uint8_t nsrc = 0;
+
+		RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+			srcs[nsrc++] = raid5_stripe_cache_entry_buf(r5req, chunk, 0);
+		}
+
+		parity->batch_offset = 0;
+		parity->batch_blocks = raid_bdev->strip_size;
+		ret = spdk_xor_gen(raid5_stripe_cache_entry_buf(r5req, parity, 0), srcs, nsrc,
+				   (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift);
+	} else if (ret == 0 && parity->batch_blocks > 0) {
+		/* Add the new data to the parity */
+		ret = raid5_stripe_batch_xor_parity(r5req);
+	}
+
+	if (ret != 0) {
+		raid5_stripe_cache_entry_invalidate(entry, raid_bdev->num_base_bdevs);
+		raid5_stripe_batch_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk->batch_blocks == 0) {
+			chunk->io_blocks = 0;
+			continue;
+		}
+
+		raid5_strip_range_merge(&entry->valid[raid5_chunk_idx(chunk)], chunk->batch_offset,
+					chunk->batch_blocks);
+		raid5_chunk_set_io_iov(chunk, raid5_stripe_cache_entry_buf(r5req, chunk,
+				       chunk->batch_offset), chunk->batch_offset, chunk->batch_blocks);
+	}
+
+	/* The parity is not maintained while its base bdev is missing */
+	if (parity->batch_blocks == 0) {
+		entry->valid[raid5_chunk_idx(parity)].blocks = 0;
+	}
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_WRITE, raid5_stripe_batch_write_done);
+}
+
+static void
+raid5_stripe_batch_read_done(struct raid5_stripe_request *r5req)
+{
+	struct raid5_stripe_cache_entry *entry = r5req->cache_entry;
+	struct raid5_chunk *chunk;
+
+	if (raid5_stage_failed(r5req)) {
+		SPDK_ERRLOG("Failed to read old data of stripe %" PRIu64 "\n", r5req->stripe_index);
+		raid5_stripe_cache_entry_invalidate(entry, r5req->r5info->raid_bdev->num_base_bdevs);
+		raid5_stripe_batch_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk->batch_blocks > 0) {
+			raid5_strip_range_merge(&entry->valid[raid5_chunk_idx(chunk)], chunk->batch_offset,
+						chunk->batch_blocks);
+		}
+	}
+
+	raid5_stripe_batch_update(r5req);
+}
+
+/*
+ * Check that the writes of the batch cover the range of the chunk written by
+ * the batch without holes.
+ */
+static bool
+raid5_stripe_batch_chunk_contiguous(struct raid5_stripe_request *r5req,
+				    const struct raid5_chunk *chunk)
+{
+	size_t idx = raid5_chunk_idx(chunk);
+	uint64_t end = chunk->batch_offset;
+	struct raid5_stripe_request *tmp;
+	bool progress;
+
+	do {
+		progress = false;
+		RAID5_FOR_EACH_BATCH_REQUEST(r5req, tmp) {
+			const struct raid5_chunk *c = &tmp->chunks[idx];
+
+			if (!tmp->batch_excluded && c->req_blocks > 0 && c->req_offset <= end &&
+			    c->req_offset + c->req_blocks > end) {
+				end = c->req_offset + c->req_blocks;
+				progress = true;
+			}
+		}
+	} while (progress);
+
+	return end == chunk->batch_offset + chunk->batch_blocks;
+}
+
+/*
+ * Compute the ranges of the chunks written by the batch. Writes to the missing
+ * base bdevs are excluded from the batch and failed. Returns false if no write
+ * is left.
+ */
+static bool
+raid5_stripe_batch_prepare(struct raid5_stripe_request *r5req)
+{
+	struct raid5_stripe_request *tmp;
+	struct raid5_chunk *chunk;
+	bool writable = false;
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		chunk->io_blocks = 0;
+		chunk->batch_offset = 0;
+		chunk->batch_blocks = 0;
+	}
+
+	RAID5_FOR_EACH_BATCH_REQUEST(r5req, tmp) {
+		for (chunk = &tmp->chunks[tmp->first_chunk];
+		     chunk <= &tmp->chunks[tmp->last_chunk]; chunk++) {
+			if (!raid5_chunk_available(chunk)) {
+				SPDK_ERRLOG("Base bdev %u went missing during a batched stripe write\n",
+					    chunk->base_idx);
+				tmp->batch_excluded = true;
+				break;
+			}
+		}
+
+		if (tmp->batch_excluded) {
+			continue;
+		}
+
+		for (chunk = &tmp->chunks[tmp->first_chunk];
+		     chunk <= &tmp->chunks[tmp->last_chunk]; chunk++) {
+			struct raid5_chunk *batch_chunk = &r5req->chunks[raid5_chunk_idx(chunk)];
+			uint64_t start = chunk->req_offset, end = chunk->req_offset + chunk->req_blocks;
+
+			if (batch_chunk->batch_blocks > 0) {
+				start = spdk_min(start, batch_chunk->batch_offset);
+				end = spdk_max(end, batch_chunk->batch_offset + batch_chunk->batch_blocks);
+			}
+			batch_chunk->batch_offset = start;
+			batch_chunk->batch_blocks = end - start;
+		}
+
+		writable = true;
+	}
+
+	return writable;
+}
+
+/*
+ * Write a batch of partial writes of a stripe through the stripe cache. If the
+ * rest of the stripe is cached, the parity is generated from the data like for
+ * a full stripe write. Otherwise it is updated with the difference between the
+ * old and the new data, reading only what is not cached yet.
+ */
+static void
+raid5_stripe_batch_write(struct raid5_stripe_request *r5req)
+{
+	struct raid_bdev *raid_bdev = r5req->r5info->raid_bdev;
+	struct raid5_stripe_cache_entry *entry = r5req->cache_entry;
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	bool parity_available = raid5_chunk_available(parity);
+	bool full_stripe = parity_available;
+	bool read = false;
+	struct raid5_chunk *chunk;
+
+	if (!raid5_stripe_batch_prepare(r5req)) {
+		raid5_stripe_batch_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		struct raid5_strip_range range = entry->valid[raid5_chunk_idx(chunk)];
+
+		if (chunk->batch_blocks > 0) {
+			uint64_t end = chunk->batch_offset + chunk->batch_blocks;
+
+			if (parity->batch_blocks > 0) {
+				end = spdk_max(end, parity->batch_offset + parity->batch_blocks);
+				parity->batch_offset = spdk_min(parity->batch_offset, chunk->batch_offset);
+			} else {
+				parity->batch_offset = chunk->batch_offset;
+			}
+			parity->batch_blocks = end - parity->batch_offset;
+
+			if (range.blocks < raid_bdev->strip_size &&
+			    !raid5_stripe_batch_chunk_contiguous(r5req, chunk)) {
+				full_stripe = false;
+			}
+			raid5_strip_range_merge(&range, chunk->batch_offset, chunk->batch_blocks);
+		}
+
+		if (range.blocks < raid_bdev->strip_size) {
+			full_stripe = false;
+		}
+	}
+
+	if (full_stripe) {
+		r5req->cache_result = RAID5_STRIPE_CACHE_FULL_STRIPE;
+		raid5_stripe_batch_update(r5req);
+		return;
+	}
+
+	if (!parity_available) {
+		parity->batch_offset = 0;
+		parity->batch_blocks = 0;
+	}
+
+	/* Read the old data and parity of the written ranges that are not cached */
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		struct raid5_strip_range missing;
+
+		if (chunk->batch_blocks == 0) {
+			continue;
+		}
+
+		/* Without a parity to update, only the holes left between the writes are read */
+		if (!parity_available && raid5_stripe_batch_chunk_contiguous(r5req, chunk)) {
+			continue;
+		}
+
+		raid5_strip_range_missing(&entry->valid[raid5_chunk_idx(chunk)], chunk->batch_offset,
+					  chunk->batch_blocks, &missing);
+		if (missing.blocks > 0) {
+			raid5_chunk_set_io_iov(chunk, raid5_stripe_cache_entry_buf(r5req, chunk,
+					       missing.offset), missing.offset, missing.blocks);
+			read = true;
+		}
+	}
+
+	if (!read) {
+		r5req->cache_result = RAID5_STRIPE_CACHE_HIT;
+		raid5_stripe_batch_update(r5req);
+		return;
+	}
+
+	r5req->cache_result = RAID5_STRIPE_CACHE_MISS;
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_READ, raid5_stripe_batch_read_done);
+}
+
+static void
+raid5_degraded_write_read_done(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *degraded = r5req->degraded_chunk;
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	uint32_t blocklen_shift = r5req->r5info->raid_bdev->blocklen_shift;
+	uint64_t offset = parity->io_offset, blocks = parity->io_blocks;
+	struct iovec degraded_iov = {
+		.iov_base = (uint8_t *)degraded->buf + (offset << blocklen_shift),
+		.iov_len = blocks << blocklen_shift,
+	};
+	struct raid5_chunk *chunk;
+	int ret;
+
+	if (raid5_stage_failed(r5req)) {
+		SPDK_ERRLOG("Failed to read stripe %" PRIu64 " for a degraded write\n",
+			    r5req->stripe_index);
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Reconstruct the old data of the missing chunk */
+	raid5_xor_init(r5req, &degraded_iov, 1);
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk != degraded) {
+			raid5_xor_add_src(r5req, &chunk->buf_iov, 1);
+		}
+	}
+
+	ret = raid5_xor_iovs(r5req, degraded_iov.iov_len);
+	if (ret != 0) {
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Apply the new data and generate the parity of the whole range from the data */
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		struct iovec iov = {
+			.iov_base = (uint8_t *)chunk->buf + (chunk->req_offset << blocklen_shift),
+			.iov_len = chunk->req_blocks << blocklen_shift,
+		};
+
+		spdk_iovcpy(chunk->iovs, chunk->iovcnt, &iov, 1);
+	}
+
+	raid5_xor_init(r5req, &parity->buf_iov, 1);
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		raid5_xor_add_src(r5req, chunk == degraded ? &degraded_iov : &chunk->buf_iov, 1);
+		chunk->io_blocks = 0;
+	}
+
+	ret = raid5_xor_iovs(r5req, parity->buf_iov.iov_len);
+	if (ret != 0) {
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		raid5_chunk_set_io_req(chunk);
+	}
+
+	raid5_stage_skip_missing(r5req);
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_WRITE, raid5_write_done);
+}
+
+/*
+ * Partial stripe write to a data chunk on a base bdev that is missing or not
+ * rebuilt yet. The old data of that chunk is needed for the parity update, so
+ * the written range of all the other chunks is read to reconstruct it and the
+ * new parity is generated from the data with the new data applied.
+ */
+static void
+raid5_degraded_write(struct raid5_stripe_request *r5req)
+{
+	uint64_t start = UINT64_MAX, end = 0;
+	struct raid5_chunk *chunk;
+
+	r5req->degraded_chunk = NULL;
+
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		if (!raid5_chunk_available(chunk)) {
+			r5req->degraded_chunk = chunk;
+		}
+		start = spdk_min(start, chunk->req_offset);
+		end = spdk_max(end, chunk->req_offset + chunk->req_blocks);
+	}
+
+	assert(r5req->degraded_chunk != NULL);
+
+	/* Any other missing chunk, including the parity, fails the read */
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		if (chunk == r5req->degraded_chunk) {
+			chunk->io_blocks = 0;
+		} else {
+			raid5_chunk_set_io_buf(chunk, start, end - start);
+		}
+	}
+
+	SPDK_DEBUGLOG(bdev_raid5, "degraded write of chunk %zu of stripe %" PRIu64 "\n",
+		      raid5_chunk_idx(r5req->degraded_chunk), r5req->stripe_index);
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_READ, raid5_degraded_write_read_done);
+}
+
+static void raid5_rmw_write(struct raid5_stripe_request *r5req);
+
+/*
+ * Take the degraded writes, or all the writes, out of the batch of a request.
+ * They lock the stripe again and are handled on their own once it is released.
+ */
+static void
+raid5_stripe_batch_split(struct raid5_stripe_request *r5req, bool all)
+{
+	struct raid5_stripe_request *tmp, *next;
+
+	TAILQ_FOREACH_SAFE(tmp, &r5req->batch, lock_link, next) {
+		if (all || raid5_stripe_request_degraded(tmp)) {
+			TAILQ_REMOVE(&r5req->batch, tmp, lock_link);
+			r5req->batch_size--;
+			raid5_stripe_lock(tmp, raid5_rmw_write);
+		}
+	}
+}
+
+static void
+raid5_rmw_write(struct raid5_stripe_request *r5req)
+{
+	struct raid5_chunk *parity = r5req->parity_chunk;
+	uint64_t parity_start = UINT64_MAX, parity_end = 0;
+	struct raid5_chunk *chunk;
+
+	/* The old data of a missing chunk can't be cached, so degraded writes bypass the cache */
+	if (raid5_stripe_request_degraded(r5req)) {
+		if (r5req->cache_entry != NULL) {
+			raid5_stripe_batch_split(r5req, true);
+			raid5_stripe_cache_entry_invalidate(r5req->cache_entry,
+							    r5req->r5info->raid_bdev->num_base_bdevs);
+		}
+		raid5_degraded_write(r5req);
+		return;
+	}
+
+	if (r5req->cache_entry != NULL) {
+		raid5_stripe_batch_split(r5req, false);
+		raid5_stripe_batch_write(r5req);
+		return;
+	}
+
+	RAID5_FOR_EACH_CHUNK(r5req, chunk) {
+		chunk->io_blocks = 0;
+	}
+
+	for (chunk = &r5req->chunks[r5req->first_chunk];
+	     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+		raid5_chunk_set_io_buf(chunk, chunk->req_offset, chunk->req_blocks);
+		parity_start = spdk_min(parity_start, chunk->req_offset);
+		parity_end = spdk_max(parity_end, chunk->req_offset + chunk->req_blocks);
+	}
+
+	/* With the parity base bdev missing only the data is written, the old data isn't needed */
+	if (!raid5_chunk_available(parity)) {
+		for (chunk = &r5req->chunks[r5req->first_chunk];
+		     chunk <= &r5req->chunks[r5req->last_chunk]; chunk++) {
+			raid5_chunk_set_io_req(chunk);
+		}
+		raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_WRITE, raid5_write_done);
+		return;
+	}
 
-static inline uint8_t
-raid5_stripe_data_chunks_num(const struct raid_bdev *raid_bdev)
+	raid5_chunk_set_io_buf(parity, parity_start, parity_end - parity_start);
+
+	raid5_stage_start(r5req, SPDK_BDEV_IO_TYPE_READ, raid5_rmw_read_done);
+}
+
+static int
+raid5_stripe_request_init(struct raid5_stripe_request *r5req, struct raid_bdev_io *raid_io,
+			  uint64_t stripe_index, uint64_t stripe_offset, uint64_t num_blocks)
 {
-	return raid_bdev->num_base_bdevs - raid_bdev->module->base_bdevs_max_degraded;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	uint64_t end_offset = stripe_offset + num_blocks - 1;
+	struct raid5_chunk *chunk;
+	int ret;
+
+	r5req->raid_io = raid_io;
+	r5req->thread = spdk_get_thread();
+	r5req->stripe_index = stripe_index;
+	r5req->stripe_locked = false;
+	r5req->degraded_chunk = NULL;
+	r5req->cache_entry = NULL;
+	r5req->cache_result = RAID5_STRIPE_CACHE_NONE;
+	TAILQ_INIT(&r5req->batch);
+	r5req->batch_size = 0;
+	r5req->batch_excluded = false;
+	r5req->first_chunk = stripe_offset >> raid_bdev->strip_size_shift;
+	r5req->last_chunk = end_offset >> raid_bdev->strip_size_shift;
+
+	RAID5_FOR_EACH_DATA_CHUNK(r5req, chunk) {
+		uint8_t chunk_idx = raid5_chunk_idx(chunk);
+		uint64_t chunk_start;
+
+		chunk->base_idx = raid_bdev_stripe_data_base_idx(raid_bdev, stripe_index, chunk_idx);
+		chunk->io_blocks = 0;
+
+		if (chunk_idx < r5req->first_chunk || chunk_idx > r5req->last_chunk) {
+			chunk->req_offset = 0;
+			chunk->req_blocks = 0;
+			chunk->iovcnt = 0;
+			continue;
+		}
+
+		chunk->req_offset = chunk_idx == r5req->first_chunk ?
+				    stripe_offset & (raid_bdev->strip_size - 1) : 0;
+		chunk->req_blocks = (chunk_idx == r5req->last_chunk ?
+				     (end_offset & (raid_bdev->strip_size - 1)) + 1 :
+				     raid_bdev->strip_size) - chunk->req_offset;
+
+		chunk_start = ((uint64_t)chunk_idx << raid_bdev->strip_size_shift) +
+			      chunk->req_offset;
+		ret = raid5_chunk_map_iovs(chunk, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					   (chunk_start - stripe_offset) << raid_bdev->blocklen_shift,
+					   chunk->req_blocks << raid_bdev->blocklen_shift);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	r5req->parity_chunk->base_idx = raid_bdev_stripe_parity_base_idx(raid_bdev,
+					stripe_index, 0);
+	r5req->parity_chunk->req_offset = 0;
+	r5req->parity_chunk->req_blocks = 0;
+	r5req->parity_chunk->iovcnt = 0;
+	r5req->parity_chunk->io_blocks = 0;
+
+	return 0;
 }
 
 static void
 raid5_submit_rw_request(struct raid_bdev_io *raid_io)
 {
-	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5_info *r5info = raid_bdev->module_private;
+	struct raid5_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint64_t stripe_index = offset_blocks / r5info->stripe_blocks;
+	uint64_t stripe_offset = offset_blocks % r5info->stripe_blocks;
+	struct raid5_stripe_request *r5req;
+	int ret;
+
+	if (stripe_offset + num_blocks > r5info->stripe_blocks) {
+		assert(false);
+		SPDK_ERRLOG("I/O spans stripe boundary!\n");
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	r5req = raid5_stripe_request_get(r5info, r5ch);
+	if (spdk_unlikely(!r5req)) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		return;
+	}
+
+	ret = raid5_stripe_request_init(r5req, raid_io, stripe_index, stripe_offset, num_blocks);
+	if (spdk_unlikely(ret != 0)) {
+		raid5_stripe_request_complete(r5req, ret == -ENOMEM ?
+					      SPDK_BDEV_IO_STATUS_NOMEM : SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		r5req->type = RAID5_STRIPE_REQUEST_READ;
+		raid5_submit_read(r5req);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (stripe_offset == 0 && num_blocks == r5info->stripe_blocks) {
+			r5req->type = RAID5_STRIPE_REQUEST_FULL_STRIPE_WRITE;
+			raid5_stripe_lock(r5req, raid5_full_stripe_write);
+		} else {
+			r5req->type = RAID5_STRIPE_REQUEST_RMW_WRITE;
+			raid5_stripe_lock(r5req, raid5_rmw_write);
+		}
+		break;
+	default:
+		SPDK_ERRLOG("Recvd not supported io type %u\n", bdev_io->type);
+		assert(0);
+		raid5_stripe_request_complete(r5req, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static int
+raid5_ioch_create(void *io_device, void *ctx_buf)
+{
+	struct raid5_io_channel *r5ch = ctx_buf;
+
+	TAILQ_INIT(&r5ch->free_requests);
+	r5ch->num_free_requests = 0;
+
+	return 0;
+}
+
+static void
+raid5_ioch_destroy(void *io_device, void *ctx_buf)
+{
+	struct raid5_io_channel *r5ch = ctx_buf;
+	struct raid5_stripe_request *r5req;
+
+	while ((r5req = TAILQ_FIRST(&r5ch->free_requests))) {
+		TAILQ_REMOVE(&r5ch->free_requests, r5req, link);
+		raid5_stripe_request_destroy(r5req);
+	}
+}
+
+static struct spdk_io_channel *
+raid5_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid5_info *r5info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r5info);
+}
+
+static void
+raid5_stripe_cache_free(struct raid5_info *r5info)
+{
+	struct raid5_stripe_cache_entry *entry;
+	int i;
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		while ((entry = TAILQ_FIRST(&r5info->stripe_locks[i].cache_lru))) {
+			assert(!entry->busy);
+			TAILQ_REMOVE(&r5info->stripe_locks[i].cache_lru, entry, link);
+			spdk_free(entry->buf);
+			free(entry);
+		}
+	}
+}
+
+/*
+ * Allocate the stripe cache entries and spread them across the shards. Each
+ * entry holds a whole stripe, including the parity, and the number of entries
+ * is limited so that the cache doesn't take more than
+ * RAID5_STRIPE_CACHE_MAX_SIZE_MB of memory.
+ */
+static int
+raid5_stripe_cache_init(struct raid5_info *r5info)
+{
+	struct raid_bdev *raid_bdev = r5info->raid_bdev;
+	size_t entry_size = ((size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift) *
+			    raid_bdev->num_base_bdevs;
+	struct raid5_stripe_cache_entry *entry;
+	uint32_t i;
+
+	r5info->cache_entries_num = spdk_min(RAID5_STRIPE_CACHE_MAX_ENTRIES,
+					     RAID5_STRIPE_CACHE_MAX_SIZE_MB * 1024 * 1024 / entry_size);
+
+	for (i = 0; i < r5info->cache_entries_num; i++) {
+		entry = calloc(1, sizeof(*entry) + sizeof(entry->valid[0]) * raid_bdev->num_base_bdevs);
+		if (!entry) {
+			goto err;
+		}
+
+		entry->buf = spdk_malloc(entry_size, r5info->buf_align, NULL, SPDK_ENV_LCORE_ID_ANY,
+					 SPDK_MALLOC_DMA);
+		if (!entry->buf) {
+			free(entry);
+			goto err;
+		}
+		entry->stripe_index = UINT64_MAX;
+
+		TAILQ_INSERT_TAIL(&r5info->stripe_locks[i % RAID5_STRIPE_LOCK_SHARDS].cache_lru, entry,
+				  link);
+	}
+
+	return 0;
+err:
+	SPDK_ERRLOG("Failed to allocate the stripe cache\n");
+	raid5_stripe_cache_free(r5info);
+	return -ENOMEM;
 }
 
 static int
@@ -69,8 +1875,11 @@ raid5_start(struct raid_bdev *raid_bdev)
 	uint64_t min_blockcnt = UINT64_MAX;
 	struct raid_base_bdev_info *base_info;
 	struct raid5_info *r5info;
+	size_t buf_align = spdk_xor_get_optimal_alignment();
+	int i, ret;
 
-	r5info = calloc(1, sizeof(*r5info));
+	r5info = calloc(1, sizeof(*r5info) + sizeof(void *) *
+			raid_bdev_stripe_data_strips_num(raid_bdev));
 	if (!r5info) {
 		SPDK_ERRLOG("Failed to allocate r5info\n");
 		return -ENOMEM;
@@ -79,10 +1888,28 @@ raid5_start(struct raid_bdev *raid_bdev)
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->bdev->blockcnt);
+		buf_align = spdk_max(buf_align, 1UL << base_info->bdev->required_alignment);
 	}
 
 	r5info->total_stripes = min_blockcnt / raid_bdev->strip_size;
-	r5info->stripe_blocks = raid_bdev->strip_size * raid5_stripe_data_chunks_num(raid_bdev);
+	r5info->stripe_blocks = raid_bdev->strip_size * raid_bdev_stripe_data_strips_num(raid_bdev);
+	r5info->buf_align = buf_align;
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		pthread_spin_init(&r5info->stripe_locks[i].lock, PTHREAD_PROCESS_PRIVATE);
+		TAILQ_INIT(&r5info->stripe_locks[i].active);
+		TAILQ_INIT(&r5info->stripe_locks[i].waiting);
+		TAILQ_INIT(&r5info->stripe_locks[i].cache_lru);
+	}
+
+	ret = raid5_stripe_cache_init(r5info);
+	if (ret != 0) {
+		for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+			pthread_spin_destroy(&r5info->stripe_locks[i].lock);
+		}
+		free(r5info);
+		return ret;
+	}
 
 	raid_bdev->bdev.blockcnt = r5info->stripe_blocks * r5info->total_stripes;
 	raid_bdev->bdev.optimal_io_boundary = r5info->stripe_blocks;
@@ -90,15 +1917,112 @@ raid5_start(struct raid_bdev *raid_bdev)
 
 	raid_bdev->module_private = r5info;
 
+	spdk_io_device_register(r5info, raid5_ioch_create, raid5_ioch_destroy,
+				sizeof(struct raid5_io_channel), NULL);
+
 	return 0;
 }
 
+static void
+raid5_io_device_unregister_done(void *io_device)
+{
+	struct raid5_info *r5info = io_device;
+	int i;
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		assert(TAILQ_EMPTY(&r5info->stripe_locks[i].active));
+		assert(TAILQ_EMPTY(&r5info->stripe_locks[i].waiting));
+		pthread_spin_destroy(&r5info->stripe_locks[i].lock);
+	}
+
+	raid5_stripe_cache_free(r5info);
+	free(r5info);
+}
+
 static void
 raid5_stop(struct raid_bdev *raid_bdev)
 {
 	struct raid5_info *r5info = raid_bdev->module_private;
 
-	free(r5info);
+	raid_bdev->module_private = NULL;
+
+	/* The raid bdev channels may still be open, free r5info when they are gone */
+	spdk_io_device_unregister(r5info, raid5_io_device_unregister_done);
+}
+
+static int
+raid5_rebuild_base_bdev_data(struct raid_bdev *raid_bdev, uint8_t base_idx,
+			     uint64_t base_offset_blocks, uint64_t num_blocks,
+			     void *stripe_buf, void *base_buf)
+{
+	uint8_t data_strips = raid_bdev_stripe_data_strips_num(raid_bdev);
+	size_t strip_bytes = (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	uint64_t stripe_index = base_offset_blocks >> raid_bdev->strip_size_shift;
+	uint64_t num_stripes = num_blocks >> raid_bdev->strip_size_shift;
+	uint8_t *stripe = stripe_buf, *strip = base_buf;
+	void **srcs = ((struct raid5_info *)raid_bdev->module_private)->rebuild_srcs;
+	uint64_t i;
+	uint8_t j;
+	int ret;
+
+	for (i = 0; i < num_stripes; i++, stripe_index++) {
+		if (raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index, 0) == base_idx) {
+			for (j = 0; j < data_strips; j++) {
+				srcs[j] = stripe + j * strip_bytes;
+			}
+
+			ret = spdk_xor_gen(strip, srcs, data_strips, strip_bytes);
+			if (ret != 0) {
+				return ret;
+			}
+		} else {
+			for (j = 0; j < data_strips; j++) {
+				if (raid_bdev_stripe_data_base_idx(raid_bdev, stripe_index, j) == base_idx) {
+					break;
+				}
+			}
+			assert(j < data_strips);
+
+			memcpy(strip, stripe + j * strip_bytes, strip_bytes);
+		}
+
+		stripe += data_strips * strip_bytes;
+		strip += strip_bytes;
+	}
+
+	return 0;
+}
+
+static void
+raid5_dump_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w)
+{
+	struct raid5_info *r5info = raid_bdev->module_private;
+	struct raid5_stripe_cache_stats stats = {};
+	int i;
+
+	if (r5info == NULL) {
+		/* Not started or already stopped */
+		return;
+	}
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		struct raid5_stripe_lock_shard *shard = &r5info->stripe_locks[i];
+
+		pthread_spin_lock(&shard->lock);
+		stats.hits += shard->cache_stats.hits;
+		stats.misses += shard->cache_stats.misses;
+		stats.full_stripe_conversions += shard->cache_stats.full_stripe_conversions;
+		stats.coalesced_writes += shard->cache_stats.coalesced_writes;
+		pthread_spin_unlock(&shard->lock);
+	}
+
+	spdk_json_write_named_object_begin(w, "stripe_cache");
+	spdk_json_write_named_uint32(w, "entries", r5info->cache_entries_num);
+	spdk_json_write_named_uint64(w, "hits", stats.hits);
+	spdk_json_write_named_uint64(w, "misses", stats.misses);
+	spdk_json_write_named_uint64(w, "full_stripe_conversions", stats.full_stripe_conversions);
+	spdk_json_write_named_uint64(w, "coalesced_writes", stats.coalesced_writes);
+	spdk_json_write_object_end(w);
 }
 
 static struct raid_bdev_module g_raid5_module = {
@@ -108,6 +2032,9 @@ static struct raid_bdev_module g_raid5_module = {
 	.start = raid5_start,
 	.stop = raid5_stop,
 	.submit_rw_request = raid5_submit_rw_request,
+	.get_io_channel = raid5_get_io_channel,
+	.dump_info_json = raid5_dump_info_json,
+	.rebuild_base_bdev_data = raid5_rebuild_base_bdev_data,
 };
 RAID_MODULE_REGISTER(&g_raid5_module)
 
@@ -0,0 +1,1369 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "bdev_raid.h"
+
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/thread.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+#include "spdk/xor.h"
+
+#include "spdk/log.h"
+
+/* Number of shards of the stripe lock table. Must be a power of 2. */
+#define RAID6_STRIPE_LOCK_SHARDS 64
+
+/* Maximum number of idle stripe requests kept per IO channel */
+#define RAID6_MAX_CACHED_STRIPE_REQUESTS 32
+
+/* Initial number of iovecs allocated for each chunk of a stripe request */
+#define RAID6_CHUNK_IOVCNT_INIT 4
+
+/* Number of parity chunks of a stripe, also the number of chunks that can be lost */
+#define RAID6_PARITY_CHUNKS 2
+
+struct raid6_stripe_request;
+
+struct raid6_stripe_lock_shard {
+	pthread_spinlock_t lock;
+
+	/* Stripe requests holding a stripe lock */
+	TAILQ_HEAD(, raid6_stripe_request) active;
+
+	/* Stripe requests waiting for a stripe lock */
+	TAILQ_HEAD(, raid6_stripe_request) waiting;
+};
+
+struct raid6_info {
+	/* The parent raid bdev */
+	struct raid_bdev *raid_bdev;
+
+	/* Number of data blocks in a stripe (without parity) */
+	uint64_t stripe_blocks;
+
+	/* Number of stripes on this array */
+	uint64_t total_stripes;
+
+	/* Alignment of the stripe request buffers */
+	size_t buf_align;
+
+	/* Strip-sized buffer of zeroes, standing for the lost data in the syndrome calculation */
+	void *zero_buf;
+
+	/* Stripe locks serializing the parity updates, sharded by stripe index */
+	struct raid6_stripe_lock_shard stripe_locks[RAID6_STRIPE_LOCK_SHARDS];
+};
+
+struct raid6_io_channel {
+	/* Idle stripe requests with already allocated buffers */
+	TAILQ_HEAD(, raid6_stripe_request) free_requests;
+
+	/* Number of requests in the free_requests list */
+	uint32_t num_free_requests;
+};
+
+struct raid6_chunk {
+	/* The stripe request this chunk belongs to */
+	struct raid6_stripe_request *r6req;
+
+	/* Index of the base bdev holding this chunk in the current stripe */
+	uint8_t base_idx;
+
+	/* Range of the chunk accessed by the parent IO, in blocks within the strip */
+	uint64_t req_offset;
+	uint64_t req_blocks;
+
+	/* Part of the parent IO payload corresponding to the accessed range */
+	struct iovec *iovs;
+	int iovcnt;
+	int iovcnt_max;
+
+	/* Strip-sized buffer used for old data, parity and reconstruction */
+	void *buf;
+
+	/* Base bdev IO of the current stage, in blocks within the strip */
+	uint64_t io_offset;
+	uint64_t io_blocks;
+	struct iovec *io_iovs;
+	int io_iovcnt;
+	struct iovec buf_iov;
+
+	/* Set if the base bdev IO of the current stage failed */
+	bool failed;
+
+	/* Set if the content of the chunk can't be read and has to be reconstructed */
+	bool lost;
+};
+
+typedef void (*raid6_stripe_request_cb)(struct raid6_stripe_request *r6req);
+
+struct raid6_stripe_request {
+	struct raid6_info *r6info;
+
+	struct raid6_io_channel *r6ch;
+
+	/* The parent raid IO */
+	struct raid_bdev_io *raid_io;
+
+	/* Thread on which the request is processed */
+	struct spdk_thread *thread;
+
+	/* Index of the stripe, also the strip index on each base bdev */
+	uint64_t stripe_index;
+
+	/* The first and last data chunks accessed by the parent IO */
+	uint8_t first_chunk;
+	uint8_t last_chunk;
+
+	/* The P and Q parity chunks of the stripe, last entries of the chunks array */
+	struct raid6_chunk *p_chunk;
+	struct raid6_chunk *q_chunk;
+
+	/* Range of the strips read for reconstruction or parity generation */
+	uint64_t range_offset;
+	uint64_t range_blocks;
+
+	/* Set once all the chunks that are not lost have been read for reconstruction */
+	bool reconstruct;
+
+	/* State of the current stage of base bdev IOs */
+	enum spdk_bdev_io_type stage_io_type;
+	uint8_t stage_submit_next;
+	/* One per base bdev IO, plus a reference held while they are submitted */
+	uint16_t stage_remaining;
+	raid6_stripe_request_cb stage_cb;
+
+	/* Stripe lock state */
+	bool stripe_locked;
+	raid6_stripe_request_cb lock_cb;
+	TAILQ_ENTRY(raid6_stripe_request) lock_link;
+
+	struct spdk_bdev_io_wait_entry waitq_entry;
+
+	/* Link in the channel free_requests list */
+	TAILQ_ENTRY(raid6_stripe_request) link;
+
+	/* Base of the chunk buffers, allocated as a single block */
+	void *bufs;
+
+	/* Chunks of the stripe, data chunks first, then P and Q */
+	struct raid6_chunk chunks[0];
+};
+
+#define RAID6_FOR_EACH_CHUNK(r, c) \
+	for (c = r->chunks; c < r->chunks + r->r6info->raid_bdev->num_base_bdevs; c++)
+
+#define RAID6_FOR_EACH_DATA_CHUNK(r, c) \
+	for (c = r->chunks; c < r->p_chunk; c++)
+
+/*
+ * Logarithm and exponent tables of GF(2^8) with the polynomial 0x11d and the
+ * generator 2, as used by spdk_pq_gen(). The exponent table is doubled so that
+ * the sum of two logarithms can index it directly.
+ */
+static uint8_t g_gf_log[256];
+static uint8_t g_gf_exp[255 * 2];
+
+static void
+raid6_gf_init(void)
+{
+	uint8_t x = 1;
+	int i;
+
+	for (i = 0; i < 255; i++) {
+		g_gf_exp[i] = g_gf_exp[i + 255] = x;
+		g_gf_log[x] = i;
+		x = (x << 1) ^ ((x & 0x80) ? 0x1d : 0);
+	}
+}
+
+static inline uint8_t
+raid6_gf_mul(uint8_t a, uint8_t b)
+{
+	if (a == 0 || b == 0) {
+		return 0;
+	}
+
+	return g_gf_exp[g_gf_log[a] + g_gf_log[b]];
+}
+
+static inline uint8_t
+raid6_gf_inv(uint8_t a)
+{
+	assert(a != 0);
+	return g_gf_exp[255 - g_gf_log[a]];
+}
+
+static inline uint8_t
+raid6_gf_pow2(uint8_t n)
+{
+	return g_gf_exp[n % 255];
+}
+
+static void
+raid6_gf_mul_table(uint8_t c, uint8_t table[256])
+{
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		table[i] = raid6_gf_mul(i, c);
+	}
+}
+
+static inline size_t
+raid6_chunk_idx(const struct raid6_chunk *chunk)
+{
+	return chunk - chunk->r6req->chunks;
+}
+
+static inline bool
+raid6_chunk_available(const struct raid6_chunk *chunk)
+{
+	const struct raid6_stripe_request *r6req = chunk->r6req;
+
+	return raid_bdev_io_base_bdev_available(r6req->raid_io, chunk->base_idx,
+						r6req->stripe_index << r6req->r6info->raid_bdev->strip_size_shift);
+}
+
+/*
+ * Generate the P and Q parity of the sources into the p and q buffers, walking
+ * all the source iovec arrays in lockstep so that each contiguous segment common
+ * to all of them is handled by a single call to spdk_pq_gen().
+ */
+static int
+raid6_pq_gen_iovs(uint8_t *p, uint8_t *q, struct iovec **src_iovs, int *src_iovcnts,
+		  uint8_t nsrc, size_t len)
+{
+	int idx[UINT8_MAX] = {};
+	size_t off[UINT8_MAX] = {};
+	void *srcs[UINT8_MAX];
+	uint8_t i;
+	int ret;
+
+	while (len > 0) {
+		size_t seg = len;
+
+		for (i = 0; i < nsrc; i++) {
+			assert(idx[i] < src_iovcnts[i]);
+			seg = spdk_min(seg, src_iovs[i][idx[i]].iov_len - off[i]);
+		}
+
+		for (i = 0; i < nsrc; i++) {
+			srcs[i] = (uint8_t *)src_iovs[i][idx[i]].iov_base + off[i];
+		}
+
+		ret = spdk_pq_gen(p, q, srcs, nsrc, seg);
+		if (ret != 0) {
+			return ret;
+		}
+
+		for (i = 0; i < nsrc; i++) {
+			off[i] += seg;
+			if (off[i] == src_iovs[i][idx[i]].iov_len) {
+				off[i] = 0;
+				idx[i]++;
+			}
+		}
+
+		p += seg;
+		q += seg;
+		len -= seg;
+	}
+
+	return 0;
+}
+
+/*
+ * Map the part of the parent IO payload starting at offset bytes and spanning
+ * len bytes to the chunk iovecs.
+ */
+static int
+raid6_chunk_map_iovs(struct raid6_chunk *chunk, const struct iovec *iovs, int iovcnt,
+		     uint64_t offset, uint64_t len)
+{
+	int i;
+
+	chunk->iovcnt = 0;
+
+	for (i = 0; i < iovcnt && len > 0; i++) {
+		uint64_t seg;
+
+		if (offset >= iovs[i].iov_len) {
+			offset -= iovs[i].iov_len;
+			continue;
+		}
+
+		if (chunk->iovcnt == chunk->iovcnt_max) {
+			struct iovec *tmp;
+			int iovcnt_max = chunk->iovcnt_max * 2;
+
+			tmp = realloc(chunk->iovs, iovcnt_max * sizeof(*tmp));
+			if (!tmp) {
+				return -ENOMEM;
+			}
+			chunk->iovs = tmp;
+			chunk->iovcnt_max = iovcnt_max;
+		}
+
+		seg = spdk_min(iovs[i].iov_len - offset, len);
+		chunk->iovs[chunk->iovcnt].iov_base = (uint8_t *)iovs[i].iov_base + offset;
+		chunk->iovs[chunk->iovcnt].iov_len = seg;
+		chunk->iovcnt++;
+
+		offset = 0;
+		len -= seg;
+	}
+
+	if (len > 0) {
+		assert(false);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static inline void *
+raid6_chunk_buf(const struct raid6_chunk *chunk, uint64_t offset)
+{
+	return (uint8_t *)chunk->buf + (offset << chunk->r6req->r6info->raid_bdev->blocklen_shift);
+}
+
+static void
+raid6_chunk_set_io_buf(struct raid6_chunk *chunk, uint64_t offset, uint64_t blocks)
+{
+	uint32_t blocklen_shift = chunk->r6req->r6info->raid_bdev->blocklen_shift;
+
+	chunk->io_offset = offset;
+	chunk->io_blocks = blocks;
+	chunk->buf_iov.iov_base = raid6_chunk_buf(chunk, offset);
+	chunk->buf_iov.iov_len = blocks << blocklen_shift;
+	chunk->io_iovs = &chunk->buf_iov;
+	chunk->io_iovcnt = 1;
+}
+
+static void
+raid6_chunk_set_io_req(struct raid6_chunk *chunk)
+{
+	chunk->io_offset = chunk->req_offset;
+	chunk->io_blocks = chunk->req_blocks;
+	chunk->io_iovs = chunk->iovs;
+	chunk->io_iovcnt = chunk->iovcnt;
+}
+
+/* Check if the old content of a data chunk is needed to generate the parity of the range */
+static inline bool
+raid6_chunk_needs_old_data(const struct raid6_chunk *chunk)
+{
+	const struct raid6_stripe_request *r6req = chunk->r6req;
+
+	return chunk->req_blocks == 0 || chunk->req_offset > r6req->range_offset ||
+	       chunk->req_offset + chunk->req_blocks < r6req->range_offset + r6req->range_blocks;
+}
+
+static void
+raid6_stripe_request_destroy(struct raid6_stripe_request *r6req)
+{
+	struct raid6_chunk *chunk;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		free(chunk->iovs);
+	}
+	spdk_free(r6req->bufs);
+	free(r6req);
+}
+
+static struct raid6_stripe_request *
+raid6_stripe_request_create(struct raid6_info *r6info, struct raid6_io_channel *r6ch)
+{
+	struct raid_bdev *raid_bdev = r6info->raid_bdev;
+	struct raid6_stripe_request *r6req;
+	struct raid6_chunk *chunk;
+	size_t strip_bytes = (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift;
+
+	r6req = calloc(1, sizeof(*r6req) + sizeof(*chunk) * raid_bdev->num_base_bdevs);
+	if (!r6req) {
+		return NULL;
+	}
+
+	r6req->r6info = r6info;
+	r6req->r6ch = r6ch;
+	r6req->p_chunk = &r6req->chunks[raid_bdev->num_base_bdevs - 2];
+	r6req->q_chunk = &r6req->chunks[raid_bdev->num_base_bdevs - 1];
+
+	r6req->bufs = spdk_malloc(strip_bytes * raid_bdev->num_base_bdevs, r6info->buf_align, NULL,
+				  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (!r6req->bufs) {
+		free(r6req);
+		return NULL;
+	}
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		chunk->r6req = r6req;
+		chunk->buf = (uint8_t *)r6req->bufs + strip_bytes * raid6_chunk_idx(chunk);
+		chunk->iovcnt_max = RAID6_CHUNK_IOVCNT_INIT;
+		chunk->iovs = calloc(chunk->iovcnt_max, sizeof(*chunk->iovs));
+		if (!chunk->iovs) {
+			raid6_stripe_request_destroy(r6req);
+			return NULL;
+		}
+	}
+
+	return r6req;
+}
+
+static struct raid6_stripe_request *
+raid6_stripe_request_get(struct raid6_info *r6info, struct raid6_io_channel *r6ch)
+{
+	struct raid6_stripe_request *r6req;
+
+	r6req = TAILQ_FIRST(&r6ch->free_requests);
+	if (r6req) {
+		TAILQ_REMOVE(&r6ch->free_requests, r6req, link);
+		r6ch->num_free_requests--;
+		return r6req;
+	}
+
+	return raid6_stripe_request_create(r6info, r6ch);
+}
+
+static void
+raid6_stripe_request_put(struct raid6_stripe_request *r6req)
+{
+	struct raid6_io_channel *r6ch = r6req->r6ch;
+
+	if (r6ch->num_free_requests < RAID6_MAX_CACHED_STRIPE_REQUESTS) {
+		TAILQ_INSERT_HEAD(&r6ch->free_requests, r6req, link);
+		r6ch->num_free_requests++;
+	} else {
+		raid6_stripe_request_destroy(r6req);
+	}
+}
+
+static inline struct raid6_stripe_lock_shard *
+raid6_stripe_lock_shard(struct raid6_info *r6info, uint64_t stripe_index)
+{
+	return &r6info->stripe_locks[stripe_index & (RAID6_STRIPE_LOCK_SHARDS - 1)];
+}
+
+static void
+_raid6_stripe_lock_acquired(void *ctx)
+{
+	struct raid6_stripe_request *r6req = ctx;
+
+	r6req->lock_cb(r6req);
+}
+
+/* Serialize the requests modifying the parity of the same stripe */
+static void
+raid6_stripe_lock(struct raid6_stripe_request *r6req, raid6_stripe_request_cb cb)
+{
+	struct raid6_stripe_lock_shard *shard;
+	struct raid6_stripe_request *tmp;
+
+	assert(!r6req->stripe_locked);
+	shard = raid6_stripe_lock_shard(r6req->r6info, r6req->stripe_index);
+	r6req->lock_cb = cb;
+	r6req->stripe_locked = true;
+
+	pthread_spin_lock(&shard->lock);
+	TAILQ_FOREACH(tmp, &shard->active, lock_link) {
+		if (tmp->stripe_index == r6req->stripe_index) {
+			TAILQ_INSERT_TAIL(&shard->waiting, r6req, lock_link);
+			pthread_spin_unlock(&shard->lock);
+			return;
+		}
+	}
+	TAILQ_INSERT_TAIL(&shard->active, r6req, lock_link);
+	pthread_spin_unlock(&shard->lock);
+
+	cb(r6req);
+}
+
+static void
+raid6_stripe_unlock(struct raid6_stripe_request *r6req)
+{
+	struct raid6_stripe_lock_shard *shard;
+	struct raid6_stripe_request *tmp;
+
+	assert(r6req->stripe_locked);
+	shard = raid6_stripe_lock_shard(r6req->r6info, r6req->stripe_index);
+	r6req->stripe_locked = false;
+
+	pthread_spin_lock(&shard->lock);
+	TAILQ_REMOVE(&shard->active, r6req, lock_link);
+	TAILQ_FOREACH(tmp, &shard->waiting, lock_link) {
+		if (tmp->stripe_index == r6req->stripe_index) {
+			TAILQ_REMOVE(&shard->waiting, tmp, lock_link);
+			TAILQ_INSERT_TAIL(&shard->active, tmp, lock_link);
+			break;
+		}
+	}
+	pthread_spin_unlock(&shard->lock);
+
+	if (tmp) {
+		spdk_thread_send_msg(tmp->thread, _raid6_stripe_lock_acquired, tmp);
+	}
+}
+
+static void
+raid6_stripe_request_complete(struct raid6_stripe_request *r6req, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = r6req->raid_io;
+
+	if (r6req->stripe_locked) {
+		raid6_stripe_unlock(r6req);
+	}
+
+	raid6_stripe_request_put(r6req);
+
+	raid_bdev_io_complete(raid_io, status);
+}
+
+static void
+raid6_stage_put(struct raid6_stripe_request *r6req)
+{
+	assert(r6req->stage_remaining > 0);
+	if (--r6req->stage_remaining == 0) {
+		r6req->stage_cb(r6req);
+	}
+}
+
+static void
+raid6_chunk_io_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid6_chunk *chunk = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		chunk->failed = true;
+	}
+
+	raid6_stage_put(chunk->r6req);
+}
+
+static void raid6_stage_submit(struct raid6_stripe_request *r6req);
+
+static void
+_raid6_stage_submit(void *ctx)
+{
+	struct raid6_stripe_request *r6req = ctx;
+
+	raid6_stage_submit(r6req);
+}
+
+/*
+ * Submit the base bdev IOs of the current stage. The stage holds an extra
+ * reference until all of them are submitted, so that its completion callback
+ * never runs while this function still walks the chunks. Base bdevs that are
+ * not available are not submitted to and their chunks are marked as failed.
+ */
+static void
+raid6_stage_submit(struct raid6_stripe_request *r6req)
+{
+	struct raid_bdev_io *raid_io = r6req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t i;
+	int ret;
+
+	for (i = r6req->stage_submit_next; i < raid_bdev->num_base_bdevs; i++) {
+		struct raid6_chunk *chunk = &r6req->chunks[i];
+		struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[chunk->base_idx];
+		struct spdk_io_channel *base_ch = raid_io->raid_ch->base_channel[chunk->base_idx];
+		uint64_t base_offset_blocks;
+
+		if (chunk->io_blocks == 0) {
+			continue;
+		}
+
+		if (!raid6_chunk_available(chunk)) {
+			chunk->failed = true;
+			r6req->stage_remaining--;
+			continue;
+		}
+
+		base_offset_blocks = (r6req->stripe_index << raid_bdev->strip_size_shift) +
+				     chunk->io_offset;
+
+		if (r6req->stage_io_type == SPDK_BDEV_IO_TYPE_READ) {
+			ret = spdk_bdev_readv_blocks(base_info->desc, base_ch,
+						     chunk->io_iovs, chunk->io_iovcnt,
+						     base_offset_blocks, chunk->io_blocks,
+						     raid6_chunk_io_complete, chunk);
+		} else {
+			assert(r6req->stage_io_type == SPDK_BDEV_IO_TYPE_WRITE);
+			ret = spdk_bdev_writev_blocks(base_info->desc, base_ch,
+						      chunk->io_iovs, chunk->io_iovcnt,
+						      base_offset_blocks, chunk->io_blocks,
+						      raid6_chunk_io_complete, chunk);
+		}
+
+		if (spdk_unlikely(ret != 0)) {
+			if (ret == -ENOMEM) {
+				r6req->stage_submit_next = i;
+				r6req->waitq_entry.bdev = base_info->bdev;
+				r6req->waitq_entry.cb_fn = _raid6_stage_submit;
+				r6req->waitq_entry.cb_arg = r6req;
+				spdk_bdev_queue_io_wait(base_info->bdev, base_ch, &r6req->waitq_entry);
+				return;
+			}
+
+			SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+			assert(false);
+			chunk->failed = true;
+			r6req->stage_remaining--;
+		}
+	}
+
+	raid6_stage_put(r6req);
+}
+
+static void
+raid6_stage_start(struct raid6_stripe_request *r6req, enum spdk_bdev_io_type io_type,
+		  raid6_stripe_request_cb cb)
+{
+	struct raid6_chunk *chunk;
+
+	r6req->stage_io_type = io_type;
+	r6req->stage_cb = cb;
+	r6req->stage_submit_next = 0;
+	r6req->stage_remaining = 1;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		chunk->failed = false;
+		if (chunk->io_blocks > 0) {
+			r6req->stage_remaining++;
+		}
+	}
+
+	raid6_stage_submit(r6req);
+}
+
+static bool
+raid6_stage_failed(struct raid6_stripe_request *r6req)
+{
+	struct raid6_chunk *chunk;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		if (chunk->failed) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Chunks that could not be read in the current stage have to be reconstructed */
+static void
+raid6_stage_mark_lost(struct raid6_stripe_request *r6req)
+{
+	struct raid6_chunk *chunk;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		if (chunk->failed) {
+			chunk->lost = true;
+		}
+	}
+}
+
+/* Read the range of the request from all the chunks that are not lost */
+static void
+raid6_stripe_read_range(struct raid6_stripe_request *r6req, raid6_stripe_request_cb cb)
+{
+	struct raid6_chunk *chunk;
+
+	r6req->reconstruct = true;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		if (chunk->lost) {
+			chunk->io_blocks = 0;
+		} else {
+			raid6_chunk_set_io_buf(chunk, r6req->range_offset, r6req->range_blocks);
+		}
+	}
+
+	raid6_stage_start(r6req, SPDK_BDEV_IO_TYPE_READ, cb);
+}
+
+/*
+ * Reconstruct the range of the lost data chunks in their buffers from the other
+ * chunks of the stripe, read by raid6_stripe_read_range(). With one data chunk
+ * lost it is recovered from P, or from Q if P is lost too. Two lost data chunks
+ * x < y are recovered by solving, for each byte:
+ *
+ *   P ^ P' = D_x ^ D_y
+ *   Q ^ Q' = 2^x * D_x ^ 2^y * D_y
+ *
+ * where P' and Q' are the syndromes of the stripe with the lost data replaced
+ * by zeroes.
+ */
+static int
+raid6_reconstruct(struct raid6_stripe_request *r6req)
+{
+	struct raid6_info *r6info = r6req->r6info;
+	uint32_t blocklen_shift = r6info->raid_bdev->blocklen_shift;
+	struct raid6_chunk *p = r6req->p_chunk, *q = r6req->q_chunk;
+	size_t len = r6req->range_blocks << blocklen_shift;
+	struct raid6_chunk *chunk, *lost[RAID6_PARITY_CHUNKS];
+	void *srcs[UINT8_MAX];
+	uint8_t nsrc = 0, nlost = 0;
+	uint8_t *x, *y, *pbuf, *qbuf;
+	uint8_t table_a[256], table_b[256];
+	size_t i;
+	int ret;
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		if (!chunk->lost) {
+			srcs[nsrc++] = raid6_chunk_buf(chunk, r6req->range_offset);
+			continue;
+		}
+
+		if (nlost == RAID6_PARITY_CHUNKS) {
+			return -EIO;
+		}
+		lost[nlost++] = chunk;
+		srcs[nsrc++] = r6info->zero_buf;
+	}
+
+	if (nlost == 0) {
+		return 0;
+	} else if (nlost + p->lost + q->lost > RAID6_PARITY_CHUNKS) {
+		return -EIO;
+	}
+
+	x = raid6_chunk_buf(lost[0], r6req->range_offset);
+	pbuf = raid6_chunk_buf(p, r6req->range_offset);
+	qbuf = raid6_chunk_buf(q, r6req->range_offset);
+
+	if (nlost == 1 && !p->lost) {
+		/* D_x = P ^ the other data chunks */
+		srcs[raid6_chunk_idx(lost[0])] = pbuf;
+		return spdk_xor_gen(x, srcs, nsrc, len);
+	}
+
+	if (nlost == 1) {
+		/* D_x = (Q ^ Q') / 2^x, P is lost so its buffer takes the unused P' */
+		ret = spdk_pq_gen(pbuf, x, srcs, nsrc, len);
+		if (ret != 0) {
+			return ret;
+		}
+
+		raid6_gf_mul_table(raid6_gf_inv(raid6_gf_pow2(raid6_chunk_idx(lost[0]))), table_a);
+		for (i = 0; i < len; i++) {
+			x[i] = table_a[x[i] ^ qbuf[i]];
+		}
+
+		return 0;
+	}
+
+	y = raid6_chunk_buf(lost[1], r6req->range_offset);
+
+	ret = spdk_pq_gen(x, y, srcs, nsrc, len);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/*
+	 * D_x = (2^(y-x) * (P ^ P') ^ 2^-x * (Q ^ Q')) / (2^(y-x) ^ 1)
+	 * D_y = P ^ P' ^ D_x
+	 */
+	{
+		uint8_t a = raid6_gf_pow2(raid6_chunk_idx(lost[1]) - raid6_chunk_idx(lost[0]));
+		uint8_t denom_inv = raid6_gf_inv(a ^ 1);
+
+		raid6_gf_mul_table(raid6_gf_mul(a, denom_inv), table_a);
+		raid6_gf_mul_table(raid6_gf_mul(raid6_gf_inv(raid6_gf_pow2(raid6_chunk_idx(lost[0]))),
+						denom_inv), table_b);
+	}
+
+	for (i = 0; i < len; i++) {
+		uint8_t pxy = x[i] ^ pbuf[i];
+		uint8_t dx = table_a[pxy] ^ table_b[y[i] ^ qbuf[i]];
+
+		x[i] = dx;
+		y[i] = pxy ^ dx;
+	}
+
+	return 0;
+}
+
+/*
+ * Fail writes to stripes that already lost more chunks than the parity can
+ * recover. Writes to the missing base bdevs are not submitted, their content is
+ * kept consistent through the parity only.
+ */
+static bool
+raid6_stage_skip_missing(struct raid6_stripe_request *r6req)
+{
+	struct raid6_chunk *chunk;
+	uint8_t missing = 0;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		if (!raid6_chunk_available(chunk)) {
+			chunk->io_blocks = 0;
+			missing++;
+		}
+	}
+
+	return missing <= r6req->r6info->raid_bdev->module->base_bdevs_max_degraded;
+}
+
+static void
+raid6_write_done(struct raid6_stripe_request *r6req)
+{
+	raid6_stripe_request_complete(r6req, raid6_stage_failed(r6req) ?
+				      SPDK_BDEV_IO_STATUS_FAILED : SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+raid6_reconstruct_read_done(struct raid6_stripe_request *r6req)
+{
+	uint32_t blocklen_shift = r6req->r6info->raid_bdev->blocklen_shift;
+	uint64_t range_end = r6req->range_offset + r6req->range_blocks;
+	struct raid6_chunk *chunk;
+
+	raid6_stage_mark_lost(r6req);
+
+	if (raid6_reconstruct(r6req) != 0) {
+		SPDK_ERRLOG("Failed to reconstruct stripe %" PRIu64 "\n", r6req->stripe_index);
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Chunks lost only now were already read into the payload by the first stage */
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		if (chunk->lost && chunk->req_blocks > 0 && chunk->req_offset >= r6req->range_offset &&
+		    chunk->req_offset + chunk->req_blocks <= range_end) {
+			struct iovec iov = {
+				.iov_base = raid6_chunk_buf(chunk, chunk->req_offset),
+				.iov_len = chunk->req_blocks << blocklen_shift,
+			};
+
+			spdk_iovcpy(&iov, 1, chunk->iovs, chunk->iovcnt);
+		}
+	}
+
+	raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+raid6_reconstruct_read(struct raid6_stripe_request *r6req)
+{
+	raid6_stripe_read_range(r6req, raid6_reconstruct_read_done);
+}
+
+static void
+raid6_read_done(struct raid6_stripe_request *r6req)
+{
+	uint64_t range_start = UINT64_MAX, range_end = 0;
+	struct raid6_chunk *chunk;
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		if (chunk->failed) {
+			chunk->lost = true;
+			range_start = spdk_min(range_start, chunk->req_offset);
+			range_end = spdk_max(range_end, chunk->req_offset + chunk->req_blocks);
+		}
+	}
+
+	if (range_end == 0) {
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	SPDK_DEBUGLOG(bdev_raid6, "reconstructing stripe %" PRIu64 "\n", r6req->stripe_index);
+
+	r6req->range_offset = range_start;
+	r6req->range_blocks = range_end - range_start;
+
+	/* Lock the stripe so that the parity is consistent with the data we read */
+	raid6_stripe_lock(r6req, raid6_reconstruct_read);
+}
+
+static void
+raid6_submit_read(struct raid6_stripe_request *r6req)
+{
+	struct raid6_chunk *chunk;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		raid6_chunk_set_io_req(chunk);
+	}
+
+	raid6_stage_start(r6req, SPDK_BDEV_IO_TYPE_READ, raid6_read_done);
+}
+
+static void
+raid6_full_stripe_write(struct raid6_stripe_request *r6req)
+{
+	struct raid_bdev *raid_bdev = r6req->r6info->raid_bdev;
+	struct raid6_chunk *chunk;
+	struct iovec *src_iovs[UINT8_MAX];
+	int src_iovcnts[UINT8_MAX];
+	uint8_t nsrc = 0;
+	int ret;
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		src_iovs[nsrc] = chunk->iovs;
+		src_iovcnts[nsrc] = chunk->iovcnt;
+		nsrc++;
+		raid6_chunk_set_io_req(chunk);
+	}
+
+	raid6_chunk_set_io_buf(r6req->p_chunk, 0, raid_bdev->strip_size);
+	raid6_chunk_set_io_buf(r6req->q_chunk, 0, raid_bdev->strip_size);
+
+	/* No old data is needed, the parity is generated from the new data only */
+	ret = raid6_pq_gen_iovs(r6req->p_chunk->buf, r6req->q_chunk->buf, src_iovs, src_iovcnts,
+				nsrc, (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift);
+	if (ret != 0 || !raid6_stage_skip_missing(r6req)) {
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid6_stage_start(r6req, SPDK_BDEV_IO_TYPE_WRITE, raid6_write_done);
+}
+
+/*
+ * Generate the parity of the range from the new data and the old data read
+ * into the chunk buffers, then write the new data and the parity.
+ */
+static void
+raid6_partial_write_update(struct raid6_stripe_request *r6req)
+{
+	uint32_t blocklen_shift = r6req->r6info->raid_bdev->blocklen_shift;
+	struct raid6_chunk *chunk;
+	struct iovec range_iovs[UINT8_MAX];
+	struct iovec *src_iovs[UINT8_MAX];
+	int src_iovcnts[UINT8_MAX];
+	uint8_t nsrc = 0;
+	int ret;
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		if (!raid6_chunk_needs_old_data(chunk)) {
+			src_iovs[nsrc] = chunk->iovs;
+			src_iovcnts[nsrc] = chunk->iovcnt;
+		} else {
+			if (chunk->req_blocks > 0) {
+				struct iovec iov = {
+					.iov_base = raid6_chunk_buf(chunk, chunk->req_offset),
+					.iov_len = chunk->req_blocks << blocklen_shift,
+				};
+
+				spdk_iovcpy(chunk->iovs, chunk->iovcnt, &iov, 1);
+			}
+			range_iovs[nsrc].iov_base = raid6_chunk_buf(chunk, r6req->range_offset);
+			range_iovs[nsrc].iov_len = r6req->range_blocks << blocklen_shift;
+			src_iovs[nsrc] = &range_iovs[nsrc];
+			src_iovcnts[nsrc] = 1;
+		}
+		nsrc++;
+
+		if (chunk->req_blocks > 0) {
+			raid6_chunk_set_io_req(chunk);
+		} else {
+			chunk->io_blocks = 0;
+		}
+	}
+
+	raid6_chunk_set_io_buf(r6req->p_chunk, r6req->range_offset, r6req->range_blocks);
+	raid6_chunk_set_io_buf(r6req->q_chunk, r6req->range_offset, r6req->range_blocks);
+
+	ret = raid6_pq_gen_iovs(r6req->p_chunk->buf_iov.iov_base, r6req->q_chunk->buf_iov.iov_base,
+				src_iovs, src_iovcnts, nsrc, r6req->range_blocks << blocklen_shift);
+	if (ret != 0 || !raid6_stage_skip_missing(r6req)) {
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid6_stage_start(r6req, SPDK_BDEV_IO_TYPE_WRITE, raid6_write_done);
+}
+
+static void
+raid6_partial_write_read_done(struct raid6_stripe_request *r6req)
+{
+	if (raid6_stage_failed(r6req)) {
+		raid6_stage_mark_lost(r6req);
+
+		if (!r6req->reconstruct) {
+			/* Read the rest of the stripe to reconstruct what could not be read */
+			raid6_stripe_read_range(r6req, raid6_partial_write_read_done);
+			return;
+		}
+	}
+
+	if (r6req->reconstruct && raid6_reconstruct(r6req) != 0) {
+		SPDK_ERRLOG("Failed to reconstruct stripe %" PRIu64 "\n", r6req->stripe_index);
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	raid6_partial_write_update(r6req);
+}
+
+/*
+ * Partial stripe writes generate the parity of the range of the strips they
+ * modify from the whole data of the range (reconstruct-write), as updating Q
+ * in place would need the GF multiplication of the data delta. The old data of
+ * the range not covered by the write is read first. If some of it is on a
+ * missing base bdev, the whole range of all the chunks is read instead and the
+ * missing data is reconstructed.
+ */
+static void
+raid6_partial_write(struct raid6_stripe_request *r6req)
+{
+	uint64_t range_start = UINT64_MAX, range_end = 0;
+	bool reconstruct = false;
+	struct raid6_chunk *chunk;
+
+	for (chunk = &r6req->chunks[r6req->first_chunk];
+	     chunk <= &r6req->chunks[r6req->last_chunk]; chunk++) {
+		range_start = spdk_min(range_start, chunk->req_offset);
+		range_end = spdk_max(range_end, chunk->req_offset + chunk->req_blocks);
+	}
+	r6req->range_offset = range_start;
+	r6req->range_blocks = range_end - range_start;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		chunk->lost = !raid6_chunk_available(chunk);
+		chunk->io_blocks = 0;
+	}
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		if (raid6_chunk_needs_old_data(chunk)) {
+			if (chunk->lost) {
+				reconstruct = true;
+				break;
+			}
+			raid6_chunk_set_io_buf(chunk, r6req->range_offset, r6req->range_blocks);
+		}
+	}
+
+	if (reconstruct) {
+		raid6_stripe_read_range(r6req, raid6_partial_write_read_done);
+	} else {
+		raid6_stage_start(r6req, SPDK_BDEV_IO_TYPE_READ, raid6_partial_write_read_done);
+	}
+}
+
+static int
+raid6_stripe_request_init(struct raid6_stripe_request *r6req, struct raid_bdev_io *raid_io,
+			  uint64_t stripe_index, uint64_t stripe_offset, uint64_t num_blocks)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	uint64_t end_offset = stripe_offset + num_blocks - 1;
+	struct raid6_chunk *chunk;
+	int ret;
+
+	r6req->raid_io = raid_io;
+	r6req->thread = spdk_get_thread();
+	r6req->stripe_index = stripe_index;
+	r6req->stripe_locked = false;
+	r6req->reconstruct = false;
+	r6req->first_chunk = stripe_offset >> raid_bdev->strip_size_shift;
+	r6req->last_chunk = end_offset >> raid_bdev->strip_size_shift;
+
+	RAID6_FOR_EACH_CHUNK(r6req, chunk) {
+		chunk->lost = false;
+		chunk->io_blocks = 0;
+		chunk->req_offset = 0;
+		chunk->req_blocks = 0;
+		chunk->iovcnt = 0;
+	}
+
+	RAID6_FOR_EACH_DATA_CHUNK(r6req, chunk) {
+		uint8_t chunk_idx = raid6_chunk_idx(chunk);
+		uint64_t chunk_start;
+
+		chunk->base_idx = raid_bdev_stripe_data_base_idx(raid_bdev, stripe_index, chunk_idx);
+
+		if (chunk_idx < r6req->first_chunk || chunk_idx > r6req->last_chunk) {
+			continue;
+		}
+
+		chunk->req_offset = chunk_idx == r6req->first_chunk ?
+				    stripe_offset & (raid_bdev->strip_size - 1) : 0;
+		chunk->req_blocks = (chunk_idx == r6req->last_chunk ?
+				     (end_offset & (raid_bdev->strip_size - 1)) + 1 :
+				     raid_bdev->strip_size) - chunk->req_offset;
+
+		chunk_start = ((uint64_t)chunk_idx << raid_bdev->strip_size_shift) +
+			      chunk->req_offset;
+		ret = raid6_chunk_map_iovs(chunk, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+					   (chunk_start - stripe_offset) << raid_bdev->blocklen_shift,
+					   chunk->req_blocks << raid_bdev->blocklen_shift);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	r6req->p_chunk->base_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index, 0);
+	r6req->q_chunk->base_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index, 1);
+
+	return 0;
+}
+
+static void
+raid6_submit_rw_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid6_info *r6info = raid_bdev->module_private;
+	struct raid6_io_channel *r6ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint64_t stripe_index = offset_blocks / r6info->stripe_blocks;
+	uint64_t stripe_offset = offset_blocks % r6info->stripe_blocks;
+	struct raid6_stripe_request *r6req;
+	int ret;
+
+	if (stripe_offset + num_blocks > r6info->stripe_blocks) {
+		assert(false);
+		SPDK_ERRLOG("I/O spans stripe boundary!\n");
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	r6req = raid6_stripe_request_get(r6info, r6ch);
+	if (spdk_unlikely(!r6req)) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		return;
+	}
+
+	ret = raid6_stripe_request_init(r6req, raid_io, stripe_index, stripe_offset, num_blocks);
+	if (spdk_unlikely(ret != 0)) {
+		raid6_stripe_request_complete(r6req, ret == -ENOMEM ?
+					      SPDK_BDEV_IO_STATUS_NOMEM : SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		raid6_submit_read(r6req);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (stripe_offset == 0 && num_blocks == r6info->stripe_blocks) {
+			raid6_stripe_lock(r6req, raid6_full_stripe_write);
+		} else {
+			raid6_stripe_lock(r6req, raid6_partial_write);
+		}
+		break;
+	default:
+		SPDK_ERRLOG("Recvd not supported io type %u\n", bdev_io->type);
+		assert(0);
+		raid6_stripe_request_complete(r6req, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static int
+raid6_ioch_create(void *io_device, void *ctx_buf)
+{
+	struct raid6_io_channel *r6ch = ctx_buf;
+
+	TAILQ_INIT(&r6ch->free_requests);
+	r6ch->num_free_requests = 0;
+
+	return 0;
+}
+
+static void
+raid6_ioch_destroy(void *io_device, void *ctx_buf)
+{
+	struct raid6_io_channel *r6ch = ctx_buf;
+	struct raid6_stripe_request *r6req;
+
+	while ((r6req = TAILQ_FIRST(&r6ch->free_requests))) {
+		TAILQ_REMOVE(&r6ch->free_requests, r6req, link);
+		raid6_stripe_request_destroy(r6req);
+	}
+}
+
+static struct spdk_io_channel *
+raid6_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid6_info *r6info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r6info);
+}
+
+static int
+raid6_start(struct raid_bdev *raid_bdev)
+{
+	uint64_t min_blockcnt = UINT64_MAX;
+	struct raid_base_bdev_info *base_info;
+	struct raid6_info *r6info;
+	size_t buf_align = spdk_xor_get_optimal_alignment();
+	int i;
+
+	if (g_gf_exp[0] == 0) {
+		raid6_gf_init();
+	}
+
+	r6info = calloc(1, sizeof(*r6info));
+	if (!r6info) {
+		SPDK_ERRLOG("Failed to allocate r6info\n");
+		return -ENOMEM;
+	}
+	r6info->raid_bdev = raid_bdev;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		min_blockcnt = spdk_min(min_blockcnt, base_info->bdev->blockcnt);
+		buf_align = spdk_max(buf_align, 1UL << base_info->bdev->required_alignment);
+	}
+
+	r6info->total_stripes = min_blockcnt / raid_bdev->strip_size;
+	r6info->stripe_blocks = raid_bdev->strip_size * raid_bdev_stripe_data_strips_num(raid_bdev);
+	r6info->buf_align = buf_align;
+
+	r6info->zero_buf = spdk_zmalloc((size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift,
+					buf_align, NULL, SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (!r6info->zero_buf) {
+		SPDK_ERRLOG("Failed to allocate the zero buffer\n");
+		free(r6info);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < RAID6_STRIPE_LOCK_SHARDS; i++) {
+		pthread_spin_init(&r6info->stripe_locks[i].lock, PTHREAD_PROCESS_PRIVATE);
+		TAILQ_INIT(&r6info->stripe_locks[i].active);
+		TAILQ_INIT(&r6info->stripe_locks[i].waiting);
+	}
+
+	raid_bdev->bdev.blockcnt = r6info->stripe_blocks * r6info->total_stripes;
+	raid_bdev->bdev.optimal_io_boundary = r6info->stripe_blocks;
+	raid_bdev->bdev.split_on_optimal_io_boundary = true;
+
+	raid_bdev->module_private = r6info;
+
+	spdk_io_device_register(r6info, raid6_ioch_create, raid6_ioch_destroy,
+				sizeof(struct raid6_io_channel), NULL);
+
+	return 0;
+}
+
+static void
+raid6_io_device_unregister_done(void *io_device)
+{
+	struct raid6_info *r6info = io_device;
+	int i;
+
+	for (i = 0; i < RAID6_STRIPE_LOCK_SHARDS; i++) {
+		assert(TAILQ_EMPTY(&r6info->stripe_locks[i].active));
+		assert(TAILQ_EMPTY(&r6info->stripe_locks[i].waiting));
+		pthread_spin_destroy(&r6info->stripe_locks[i].lock);
+	}
+
+	spdk_free(r6info->zero_buf);
+	free(r6info);
+}
+
+static void
+raid6_stop(struct raid_bdev *raid_bdev)
+{
+	struct raid6_info *r6info = raid_bdev->module_private;
+
+	raid_bdev->module_private = NULL;
+
+	/* The raid bdev channels may still be open, free r6info when they are gone */
+	spdk_io_device_unregister(r6info, raid6_io_device_unregister_done);
+}
+
+static int
+raid6_rebuild_base_bdev_data(struct raid_bdev *raid_bdev, uint8_t base_idx,
+			     uint64_t base_offset_blocks, uint64_t num_blocks,
+			     void *stripe_buf, void *base_buf)
+{
+	uint8_t data_strips = raid_bdev_stripe_data_strips_num(raid_bdev);
+	size_t strip_bytes = (size_t)raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	uint64_t stripe_index = base_offset_blocks >> raid_bdev->strip_size_shift;
+	uint64_t num_stripes = num_blocks >> raid_bdev->strip_size_shift;
+	uint8_t *stripe = stripe_buf, *strip = base_buf;
+	void *srcs[UINT8_MAX];
+	void *p = NULL;
+	uint64_t i;
+	uint8_t j;
+	int ret = 0;
+
+	for (i = 0; i < num_stripes && ret == 0; i++, stripe_index++) {
+		for (j = 0; j < data_strips; j++) {
+			srcs[j] = stripe + j * strip_bytes;
+		}
+
+		if (raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index, 0) == base_idx) {
+			ret = spdk_xor_gen(strip, srcs, data_strips, strip_bytes);
+		} else if (raid_bdev_stripe_parity_base_idx(raid_bdev, stripe_index, 1) == base_idx) {
+			/* P is generated along with Q, into a scratch buffer */
+			if (p == NULL) {
+				p = malloc(strip_bytes);
+				if (p == NULL) {
+					return -ENOMEM;
+				}
+			}
+			ret = spdk_pq_gen(p, strip, srcs, data_strips, strip_bytes);
+		} else {
+			for (j = 0; j < data_strips; j++) {
+				if (raid_bdev_stripe_data_base_idx(raid_bdev, stripe_index, j) == base_idx) {
+					break;
+				}
+			}
+			assert(j < data_strips);
+
+			memcpy(strip, srcs[j], strip_bytes);
+		}
+
+		stripe += data_strips * strip_bytes;
+		strip += strip_bytes;
+	}
+
+	free(p);
+
+	return ret;
+}
+
+static struct raid_bdev_module g_raid6_module = {
+	.level = RAID6,
+	.base_bdevs_min = 4,
+	.base_bdevs_max_degraded = RAID6_PARITY_CHUNKS,
+	.start = raid6_start,
+	.stop = raid6_stop,
+	.submit_rw_request = raid6_submit_rw_request,
+	.get_io_channel = raid6_get_io_channel,
+	.rebuild_base_bdev_data = raid6_rebuild_base_bdev_data,
+};
+RAID_MODULE_REGISTER(&g_raid6_module)
+
+SPDK_LOG_REGISTER_COMPONENT(bdev_raid6)
@@ -0,0 +1,1194 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Readahead virtual bdev.  Every channel tracks a few read streams.  Once a
+ * stream has issued consecutive reads, the data following it is prefetched
+ * from the base bdev into buffers taken from a pool shared by all channels,
+ * and later reads of the stream are served from memory.  The prefetch window
+ * of a stream grows while its prefetched data gets read and shrinks when it
+ * is dropped unread.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_readahead.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* Consecutive reads needed before a stream starts being prefetched */
+#define RA_SEQUENTIAL_THRESHOLD		2
+
+/* Writes are tracked with a sequence number per 1 MiB chunk of the bdev, hashed
+ * into a fixed number of slots.  Prefetched data is only used if the sequence
+ * numbers of the chunks it covers didn't change since it was read.
+ */
+#define RA_WRITE_SEQ_CHUNK_SIZE		(1024 * 1024)
+#define RA_WRITE_SEQ_SLOTS		256
+
+/* Each stream has at most the window being read and the one after it prefetched */
+#define RA_STREAM_MAX_BUFFERS		2
+
+static int vbdev_readahead_init(void);
+static int vbdev_readahead_get_ctx_size(void);
+static void vbdev_readahead_examine(struct spdk_bdev *bdev);
+static void vbdev_readahead_finish(void);
+static int vbdev_readahead_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module readahead_if = {
+	.name = "readahead",
+	.module_init = vbdev_readahead_init,
+	.get_ctx_size = vbdev_readahead_get_ctx_size,
+	.examine_config = vbdev_readahead_examine,
+	.module_fini = vbdev_readahead_finish,
+	.config_json = vbdev_readahead_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(readahead, &readahead_if)
+
+/* Readahead bdevs requested over RPC, kept so they can be created in examine()
+ * once their base bdev shows up.
+ */
+struct bdev_readahead_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_readahead_opts	opts;
+	TAILQ_ENTRY(bdev_readahead_names)	link;
+};
+static TAILQ_HEAD(, bdev_readahead_names) g_bdev_readahead_names = TAILQ_HEAD_INITIALIZER(
+			g_bdev_readahead_names);
+
+struct vbdev_readahead {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		ra_bdev;
+	struct vbdev_readahead_opts	opts;
+	uint64_t			min_window_blocks;
+	uint64_t			max_window_blocks;
+	uint64_t			seq_chunk_blocks;
+	uint64_t			write_seq[RA_WRITE_SEQ_SLOTS];
+	struct spdk_mempool		*pool;
+	uint64_t			pool_count;
+	struct spdk_thread		*thread;
+	TAILQ_ENTRY(vbdev_readahead)	link;
+};
+static TAILQ_HEAD(, vbdev_readahead) g_ra_nodes = TAILQ_HEAD_INITIALIZER(g_ra_nodes);
+
+static uint32_t g_ra_pool_id;
+
+struct ra_stream;
+struct ra_io_channel;
+
+struct ra_buffer {
+	/* NULL once the stream dropped this buffer while it was being read */
+	struct ra_stream		*stream;
+	struct ra_io_channel		*ra_ch;
+	void				*data;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	uint64_t			served_blocks;
+	uint64_t			seq;
+	bool				ready;
+	/* Reads waiting for this buffer to be filled */
+	TAILQ_HEAD(, spdk_bdev_io)	waiters;
+	TAILQ_ENTRY(ra_buffer)		link;
+};
+
+struct ra_stream {
+	/* Offset the next read of the stream is expected at */
+	uint64_t			next_offset;
+	uint64_t			window_blocks;
+	uint32_t			seq_count;
+	uint64_t			last_used;
+	uint32_t			num_buffers;
+	struct ra_buffer		*buffers[RA_STREAM_MAX_BUFFERS];
+};
+
+/* Streams are tracked per channel, so the I/O path doesn't need any locks.
+ * Only the buffer pool and the write sequence numbers are shared.
+ */
+struct ra_io_channel {
+	struct spdk_io_channel		*base_ch;
+	struct ra_stream		*streams;
+	struct ra_buffer		*buffers;
+	TAILQ_HEAD(, ra_buffer)		free_buffers;
+	uint64_t			tick;
+	struct vbdev_readahead_stats	stats;
+};
+
+struct ra_bdev_io {
+	struct spdk_io_channel		*ch;
+
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static void vbdev_readahead_submit_request(struct spdk_io_channel *ch,
+		struct spdk_bdev_io *bdev_io);
+
+static inline uint64_t *
+ra_write_seq_slot(struct vbdev_readahead *ra_node, uint64_t chunk)
+{
+	return &ra_node->write_seq[chunk % RA_WRITE_SEQ_SLOTS];
+}
+
+static uint64_t
+ra_get_write_seq(struct vbdev_readahead *ra_node, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t chunk, last_chunk, seq = 0;
+
+	chunk = offset_blocks / ra_node->seq_chunk_blocks;
+	last_chunk = (offset_blocks + num_blocks - 1) / ra_node->seq_chunk_blocks;
+	last_chunk = spdk_min(last_chunk, chunk + RA_WRITE_SEQ_SLOTS - 1);
+	for (; chunk <= last_chunk; chunk++) {
+		seq += __atomic_load_n(ra_write_seq_slot(ra_node, chunk), __ATOMIC_ACQUIRE);
+	}
+
+	return seq;
+}
+
+static void
+ra_bump_write_seq(struct vbdev_readahead *ra_node, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t chunk, last_chunk;
+
+	chunk = offset_blocks / ra_node->seq_chunk_blocks;
+	last_chunk = (offset_blocks + num_blocks - 1) / ra_node->seq_chunk_blocks;
+	last_chunk = spdk_min(last_chunk, chunk + RA_WRITE_SEQ_SLOTS - 1);
+	for (; chunk <= last_chunk; chunk++) {
+		__atomic_fetch_add(ra_write_seq_slot(ra_node, chunk), 1, __ATOMIC_ACQ_REL);
+	}
+}
+
+static inline bool
+ra_buffer_valid(struct vbdev_readahead *ra_node, struct ra_buffer *buf)
+{
+	return ra_get_write_seq(ra_node, buf->offset_blocks, buf->num_blocks) == buf->seq;
+}
+
+static inline bool
+ra_buffer_contains(struct ra_buffer *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	return offset_blocks >= buf->offset_blocks &&
+	       offset_blocks + num_blocks <= buf->offset_blocks + buf->num_blocks;
+}
+
+static void
+ra_buffer_put(struct vbdev_readahead *ra_node, struct ra_buffer *buf)
+{
+	struct ra_io_channel *ra_ch = buf->ra_ch;
+
+	assert(TAILQ_EMPTY(&buf->waiters));
+	ra_ch->stats.wasted_blocks += buf->num_blocks - buf->served_blocks;
+	spdk_mempool_put(ra_node->pool, buf->data);
+	buf->data = NULL;
+	buf->stream = NULL;
+	TAILQ_INSERT_TAIL(&ra_ch->free_buffers, buf, link);
+}
+
+/* Drop a buffer from its stream.  If adapt is set, the window of the stream is
+ * resized depending on how much of the buffer was read.
+ */
+static void
+ra_stream_drop_buffer(struct vbdev_readahead *ra_node, struct ra_stream *stream, uint32_t idx,
+		      bool adapt)
+{
+	struct ra_buffer *buf = stream->buffers[idx];
+
+	if (adapt) {
+		if (buf->served_blocks == buf->num_blocks) {
+			stream->window_blocks = spdk_min(stream->window_blocks * 2,
+							 ra_node->max_window_blocks);
+		} else if (buf->served_blocks < buf->num_blocks / 2) {
+			stream->window_blocks = spdk_max(stream->window_blocks / 2,
+							 ra_node->min_window_blocks);
+		}
+	}
+
+	stream->num_buffers--;
+	memmove(&stream->buffers[idx], &stream->buffers[idx + 1],
+		(stream->num_buffers - idx) * sizeof(stream->buffers[0]));
+
+	if (buf->ready) {
+		ra_buffer_put(ra_node, buf);
+	} else {
+		/* Still being read, the completion will release it */
+		buf->stream = NULL;
+	}
+}
+
+static void
+ra_stream_reset(struct vbdev_readahead *ra_node, struct ra_stream *stream)
+{
+	while (stream->num_buffers > 0) {
+		ra_stream_drop_buffer(ra_node, stream, 0, false);
+	}
+
+	stream->seq_count = 0;
+	stream->window_blocks = ra_node->min_window_blocks;
+}
+
+static struct ra_stream *
+ra_stream_lookup(struct vbdev_readahead *ra_node, struct ra_io_channel *ra_ch,
+		 uint64_t offset_blocks)
+{
+	struct ra_stream *stream, *lru = NULL;
+	uint32_t i, j;
+
+	for (i = 0; i < ra_node->opts.max_streams; i++) {
+		stream = &ra_ch->streams[i];
+		if (stream->seq_count == 0) {
+			if (lru == NULL || lru->seq_count != 0) {
+				lru = stream;
+			}
+			continue;
+		}
+
+		if (offset_blocks == stream->next_offset) {
+			return stream;
+		}
+
+		for (j = 0; j < stream->num_buffers; j++) {
+			if (ra_buffer_contains(stream->buffers[j], offset_blocks, 1)) {
+				return stream;
+			}
+		}
+
+		if (lru == NULL || (lru->seq_count != 0 && stream->last_used < lru->last_used)) {
+			lru = stream;
+		}
+	}
+
+	/* Not part of any known stream, start tracking a new one */
+	ra_stream_reset(ra_node, lru);
+
+	return lru;
+}
+
+static void
+ra_copy_to_iovs(struct iovec *iovs, int iovcnt, size_t iov_offset, void *buf, size_t len)
+{
+	uint8_t *ptr = buf;
+	size_t n;
+	int i;
+
+	for (i = 0; i < iovcnt && len > 0; i++) {
+		if (iov_offset >= iovs[i].iov_len) {
+			iov_offset -= iovs[i].iov_len;
+			continue;
+		}
+
+		n = spdk_min(len, iovs[i].iov_len - iov_offset);
+		memcpy((uint8_t *)iovs[i].iov_base + iov_offset, ptr, n);
+		ptr += n;
+		len -= n;
+		iov_offset = 0;
+	}
+
+	assert(len == 0);
+}
+
+static void
+ra_buffer_serve(struct ra_buffer *buf, struct spdk_bdev_io *bdev_io, uint64_t offset_blocks,
+		uint64_t num_blocks)
+{
+	uint32_t blocklen = bdev_io->bdev->blocklen;
+
+	ra_copy_to_iovs(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+			(offset_blocks - bdev_io->u.bdev.offset_blocks) * blocklen,
+			(uint8_t *)buf->data + (offset_blocks - buf->offset_blocks) * blocklen,
+			num_blocks * blocklen);
+	buf->served_blocks += num_blocks;
+}
+
+static void
+_ra_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+_ra_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+
+	/* Also catches prefetches issued while the write was outstanding */
+	ra_bump_write_seq(ra_node, orig_io->u.bdev.offset_blocks, orig_io->u.bdev.num_blocks);
+	_ra_complete_io(bdev_io, success, orig_io);
+}
+
+static void
+vbdev_readahead_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct ra_bdev_io *io_ctx = (struct ra_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_readahead_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_readahead_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct ra_bdev_io *io_ctx = (struct ra_bdev_io *)bdev_io->driver_ctx;
+	struct ra_io_channel *ra_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_readahead_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, ra_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_readahead_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+ra_handle_submit_rc(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, int rc)
+{
+	struct ra_bdev_io *io_ctx = (struct ra_bdev_io *)bdev_io->driver_ctx;
+
+	if (rc == 0) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io_ctx->ch = ch;
+		vbdev_readahead_queue_io(bdev_io);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+ra_submit_base_read(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct ra_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(ra_node->base_desc, ra_ch->base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, _ra_complete_io, bdev_io);
+	ra_handle_submit_rc(ch, bdev_io, rc);
+}
+
+static void
+_ra_prefetch_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ra_buffer *buf = cb_arg;
+	struct ra_io_channel *ra_ch = buf->ra_ch;
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(ra_ch);
+	struct vbdev_readahead *ra_node = spdk_io_channel_get_io_device(ch);
+	struct spdk_bdev_io *waiter;
+	struct ra_stream *stream;
+	bool valid;
+	uint32_t i;
+
+	spdk_bdev_free_io(bdev_io);
+
+	buf->ready = true;
+	valid = success && ra_buffer_valid(ra_node, buf);
+
+	while ((waiter = TAILQ_FIRST(&buf->waiters))) {
+		TAILQ_REMOVE(&buf->waiters, waiter, module_link);
+		if (valid) {
+			ra_buffer_serve(buf, waiter, waiter->u.bdev.offset_blocks, waiter->u.bdev.num_blocks);
+			ra_ch->stats.read_hits++;
+			spdk_bdev_io_complete(waiter, SPDK_BDEV_IO_STATUS_SUCCESS);
+		} else {
+			ra_submit_base_read(ch, waiter);
+		}
+	}
+
+	stream = buf->stream;
+	if (stream == NULL) {
+		ra_buffer_put(ra_node, buf);
+	} else if (!valid) {
+		for (i = 0; i < stream->num_buffers; i++) {
+			if (stream->buffers[i] == buf) {
+				ra_stream_drop_buffer(ra_node, stream, i, false);
+				break;
+			}
+		}
+	}
+
+	/* Release the reference taken when the prefetch was submitted */
+	spdk_put_io_channel(ch);
+}
+
+static void
+ra_stream_prefetch(struct vbdev_readahead *ra_node, struct ra_io_channel *ra_ch,
+		   struct ra_stream *stream, uint64_t read_end)
+{
+	struct ra_buffer *buf, *last;
+	struct spdk_io_channel *ch;
+	uint64_t offset_blocks, num_blocks;
+	int rc;
+
+	if (stream->seq_count < RA_SEQUENTIAL_THRESHOLD ||
+	    stream->num_buffers == RA_STREAM_MAX_BUFFERS) {
+		return;
+	}
+
+	if (stream->num_buffers > 0) {
+		last = stream->buffers[stream->num_buffers - 1];
+		/* Start reading the next window once half of the last one was consumed */
+		if (read_end < last->offset_blocks + last->num_blocks / 2) {
+			return;
+		}
+		offset_blocks = last->offset_blocks + last->num_blocks;
+	} else {
+		offset_blocks = read_end;
+	}
+
+	if (offset_blocks >= ra_node->ra_bdev.blockcnt) {
+		return;
+	}
+	num_blocks = spdk_min(stream->window_blocks, ra_node->ra_bdev.blockcnt - offset_blocks);
+
+	buf = TAILQ_FIRST(&ra_ch->free_buffers);
+	if (buf == NULL) {
+		return;
+	}
+
+	/* Keep the channel alive until the prefetch completes */
+	ch = spdk_get_io_channel(ra_node);
+	if (ch == NULL) {
+		return;
+	}
+
+	buf->data = spdk_mempool_get(ra_node->pool);
+	if (buf->data == NULL) {
+		spdk_put_io_channel(ch);
+		return;
+	}
+
+	buf->stream = stream;
+	buf->offset_blocks = offset_blocks;
+	buf->num_blocks = num_blocks;
+	buf->served_blocks = 0;
+	buf->seq = ra_get_write_seq(ra_node, offset_blocks, num_blocks);
+	buf->ready = false;
+
+	rc = spdk_bdev_read_blocks(ra_node->base_desc, ra_ch->base_ch, buf->data, offset_blocks,
+				   num_blocks, _ra_prefetch_done, buf);
+	if (rc != 0) {
+		spdk_mempool_put(ra_node->pool, buf->data);
+		buf->data = NULL;
+		buf->stream = NULL;
+		spdk_put_io_channel(ch);
+		return;
+	}
+
+	TAILQ_REMOVE(&ra_ch->free_buffers, buf, link);
+	stream->buffers[stream->num_buffers++] = buf;
+	ra_ch->stats.prefetch_ios++;
+	ra_ch->stats.prefetch_blocks += num_blocks;
+}
+
+/* Try to serve a read from the buffers of its stream.  Returns false if the
+ * read has to go to the base bdev.
+ */
+static bool
+ra_stream_read(struct vbdev_readahead *ra_node, struct ra_io_channel *ra_ch,
+	       struct ra_stream *stream, struct spdk_bdev_io *bdev_io)
+{
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t end = offset_blocks + bdev_io->u.bdev.num_blocks;
+	struct ra_buffer *buf;
+	uint64_t pos, n;
+	uint32_t i, first;
+
+	/* A read in flight covering the whole request is as good as a hit */
+	for (i = 0; i < stream->num_buffers; i++) {
+		buf = stream->buffers[i];
+		if (!buf->ready && ra_buffer_contains(buf, offset_blocks, end - offset_blocks)) {
+			TAILQ_INSERT_TAIL(&buf->waiters, bdev_io, module_link);
+			return true;
+		}
+	}
+
+	/* Otherwise all the data has to be in buffers already filled */
+	for (i = 0; i < stream->num_buffers; i++) {
+		if (ra_buffer_contains(stream->buffers[i], offset_blocks, 1)) {
+			break;
+		}
+	}
+	first = i;
+	for (pos = offset_blocks; i < stream->num_buffers && pos < end; i++) {
+		buf = stream->buffers[i];
+		if (!buf->ready || pos < buf->offset_blocks) {
+			return false;
+		}
+		pos = buf->offset_blocks + buf->num_blocks;
+	}
+	if (pos < end) {
+		return false;
+	}
+
+	for (i = first, pos = offset_blocks; pos < end; i++) {
+		buf = stream->buffers[i];
+		n = spdk_min(end, buf->offset_blocks + buf->num_blocks) - pos;
+		ra_buffer_serve(buf, bdev_io, pos, n);
+		pos += n;
+	}
+
+	ra_ch->stats.read_hits++;
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	return true;
+}
+
+static void
+ra_read(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct ra_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t read_end = offset_blocks + bdev_io->u.bdev.num_blocks;
+	struct ra_stream *stream;
+	struct ra_buffer *buf;
+	uint32_t i;
+
+	ra_ch->stats.read_ios++;
+
+	stream = ra_stream_lookup(ra_node, ra_ch, offset_blocks);
+	stream->seq_count++;
+	stream->last_used = ++ra_ch->tick;
+	stream->next_offset = read_end;
+
+	/* Drop buffers the stream has moved past, as well as stale ones */
+	for (i = 0; i < stream->num_buffers;) {
+		buf = stream->buffers[i];
+		if (buf->offset_blocks + buf->num_blocks <= offset_blocks) {
+			ra_stream_drop_buffer(ra_node, stream, i, true);
+		} else if (buf->ready && !ra_buffer_valid(ra_node, buf)) {
+			ra_stream_drop_buffer(ra_node, stream, i, false);
+		} else {
+			i++;
+		}
+	}
+
+	if (!ra_stream_read(ra_node, ra_ch, stream, bdev_io)) {
+		ra_submit_base_read(ch, bdev_io);
+	}
+
+	/* Reads larger than the window gain nothing from prefetching */
+	if (bdev_io->u.bdev.num_blocks <= ra_node->max_window_blocks) {
+		ra_stream_prefetch(ra_node, ra_ch, stream, read_end);
+	}
+}
+
+static void
+ra_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	ra_read(ch, bdev_io);
+}
+
+static void
+vbdev_readahead_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct ra_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, ra_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		ra_bump_write_seq(ra_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_writev_blocks(ra_node->base_desc, ra_ch->base_ch, bdev_io->u.bdev.iovs,
+					     bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					     bdev_io->u.bdev.num_blocks, _ra_complete_write,
+					     bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		ra_bump_write_seq(ra_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_write_zeroes_blocks(ra_node->base_desc, ra_ch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _ra_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		ra_bump_write_seq(ra_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_unmap_blocks(ra_node->base_desc, ra_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _ra_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(ra_node->base_desc, ra_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _ra_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(ra_node->base_desc, ra_ch->base_ch,
+				     _ra_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("readahead: unsupported I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	ra_handle_submit_rc(ch, bdev_io, rc);
+}
+
+static bool
+vbdev_readahead_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_readahead *ra_node = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(ra_node->base_bdev, io_type);
+	default:
+		/* Anything else could modify data without invalidating prefetched buffers */
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_readahead_get_io_channel(void *ctx)
+{
+	struct vbdev_readahead *ra_node = ctx;
+
+	return spdk_get_io_channel(ra_node);
+}
+
+static void
+vbdev_readahead_write_opts_json(struct vbdev_readahead *ra_node, struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&ra_node->ra_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(ra_node->base_bdev));
+	spdk_json_write_named_uint32(w, "min_window_kb", ra_node->opts.min_window_kb);
+	spdk_json_write_named_uint32(w, "max_window_kb", ra_node->opts.max_window_kb);
+	spdk_json_write_named_uint32(w, "buffer_pool_mb", ra_node->opts.buffer_pool_mb);
+	spdk_json_write_named_uint32(w, "max_streams", ra_node->opts.max_streams);
+}
+
+static int
+vbdev_readahead_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_readahead *ra_node = ctx;
+
+	spdk_json_write_named_object_begin(w, "readahead");
+	vbdev_readahead_write_opts_json(ra_node, w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_readahead_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_readahead *ra_node;
+
+	TAILQ_FOREACH(ra_node, &g_ra_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_readahead_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_readahead_write_opts_json(ra_node, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+ra_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct ra_io_channel *ra_ch = ctx_buf;
+	struct vbdev_readahead *ra_node = io_device;
+	uint32_t i, num_buffers;
+
+	num_buffers = ra_node->opts.max_streams * RA_STREAM_MAX_BUFFERS;
+	ra_ch->streams = calloc(ra_node->opts.max_streams, sizeof(*ra_ch->streams));
+	ra_ch->buffers = calloc(num_buffers, sizeof(*ra_ch->buffers));
+	if (ra_ch->streams == NULL || ra_ch->buffers == NULL) {
+		goto err;
+	}
+
+	for (i = 0; i < ra_node->opts.max_streams; i++) {
+		ra_ch->streams[i].window_blocks = ra_node->min_window_blocks;
+	}
+
+	TAILQ_INIT(&ra_ch->free_buffers);
+	for (i = 0; i < num_buffers; i++) {
+		ra_ch->buffers[i].ra_ch = ra_ch;
+		TAILQ_INIT(&ra_ch->buffers[i].waiters);
+		TAILQ_INSERT_TAIL(&ra_ch->free_buffers, &ra_ch->buffers[i], link);
+	}
+
+	ra_ch->base_ch = spdk_bdev_get_io_channel(ra_node->base_desc);
+	if (ra_ch->base_ch == NULL) {
+		goto err;
+	}
+
+	return 0;
+
+err:
+	free(ra_ch->streams);
+	free(ra_ch->buffers);
+	return -ENOMEM;
+}
+
+static void
+ra_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct ra_io_channel *ra_ch = ctx_buf;
+	struct vbdev_readahead *ra_node = io_device;
+	uint32_t i;
+
+	/* In-flight prefetches hold a channel reference, so every buffer is filled by now */
+	for (i = 0; i < ra_node->opts.max_streams; i++) {
+		ra_stream_reset(ra_node, &ra_ch->streams[i]);
+	}
+
+	spdk_put_io_channel(ra_ch->base_ch);
+	free(ra_ch->streams);
+	free(ra_ch->buffers);
+}
+
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_readahead *ra_node = io_device;
+
+	spdk_mempool_free(ra_node->pool);
+	free(ra_node->ra_bdev.name);
+	free(ra_node);
+}
+
+static void
+_vbdev_readahead_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+static int
+vbdev_readahead_destruct(void *ctx)
+{
+	struct vbdev_readahead *ra_node = ctx;
+
+	TAILQ_REMOVE(&g_ra_nodes, ra_node, link);
+
+	spdk_bdev_module_release_bdev(ra_node->base_bdev);
+
+	/* Close the underlying bdev on its same opened thread. */
+	if (ra_node->thread && ra_node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(ra_node->thread, _vbdev_readahead_destruct, ra_node->base_desc);
+	} else {
+		spdk_bdev_close(ra_node->base_desc);
+	}
+
+	spdk_io_device_unregister(ra_node, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+vbdev_readahead_free_name(struct bdev_readahead_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_readahead_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_readahead_insert_name(const char *bdev_name, const char *vbdev_name,
+			    const struct vbdev_readahead_opts *opts,
+			    struct bdev_readahead_names **_name)
+{
+	struct bdev_readahead_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_readahead_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("readahead bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_readahead_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_readahead_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->bdev_name || !name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate bdev names\n");
+		free(name->bdev_name);
+		free(name->vbdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+	name->opts = *opts;
+
+	TAILQ_INSERT_TAIL(&g_bdev_readahead_names, name, link);
+	*_name = name;
+
+	return 0;
+}
+
+static int
+vbdev_readahead_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_readahead_finish(void)
+{
+	struct bdev_readahead_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_readahead_names))) {
+		vbdev_readahead_free_name(name);
+	}
+}
+
+static int
+vbdev_readahead_get_ctx_size(void)
+{
+	return sizeof(struct ra_bdev_io);
+}
+
+static const struct spdk_bdev_fn_table vbdev_readahead_fn_table = {
+	.destruct		= vbdev_readahead_destruct,
+	.submit_request		= vbdev_readahead_submit_request,
+	.io_type_supported	= vbdev_readahead_io_type_supported,
+	.get_io_channel		= vbdev_readahead_get_io_channel,
+	.dump_info_json		= vbdev_readahead_dump_info_json,
+};
+
+static void
+vbdev_readahead_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_readahead *ra_node, *tmp;
+
+	TAILQ_FOREACH_SAFE(ra_node, &g_ra_nodes, link, tmp) {
+		if (bdev_find == ra_node->base_bdev) {
+			spdk_bdev_unregister(&ra_node->ra_bdev, NULL, NULL);
+		}
+	}
+}
+
+static void
+vbdev_readahead_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+				   void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_readahead_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+vbdev_readahead_register(struct bdev_readahead_names *name)
+{
+	struct vbdev_readahead *ra_node;
+	struct spdk_bdev *bdev;
+	char pool_name[32];
+	int rc;
+
+	ra_node = calloc(1, sizeof(struct vbdev_readahead));
+	if (!ra_node) {
+		SPDK_ERRLOG("could not allocate readahead node\n");
+		return -ENOMEM;
+	}
+
+	ra_node->ra_bdev.name = strdup(name->vbdev_name);
+	if (!ra_node->ra_bdev.name) {
+		SPDK_ERRLOG("could not allocate readahead bdev name\n");
+		free(ra_node);
+		return -ENOMEM;
+	}
+	ra_node->ra_bdev.product_name = "readahead";
+	ra_node->opts = name->opts;
+
+	rc = spdk_bdev_open_ext(name->bdev_name, true, vbdev_readahead_base_bdev_event_cb,
+				NULL, &ra_node->base_desc);
+	if (rc) {
+		if (rc != -ENODEV) {
+			SPDK_ERRLOG("could not open bdev %s\n", name->bdev_name);
+		}
+		goto err_name;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(ra_node->base_desc);
+	ra_node->base_bdev = bdev;
+
+	if (bdev->md_len != 0) {
+		SPDK_ERRLOG("readahead bdev %s: base bdev %s has metadata, which is not supported\n",
+			    name->vbdev_name, name->bdev_name);
+		rc = -ENOTSUP;
+		goto err_close;
+	}
+
+	ra_node->min_window_blocks = spdk_max((uint64_t)ra_node->opts.min_window_kb * 1024 /
+					      bdev->blocklen, 1);
+	ra_node->max_window_blocks = spdk_max((uint64_t)ra_node->opts.max_window_kb * 1024 /
+					      bdev->blocklen, 1);
+	ra_node->seq_chunk_blocks = spdk_max(RA_WRITE_SEQ_CHUNK_SIZE / bdev->blocklen, 1);
+
+	ra_node->pool_count = (uint64_t)ra_node->opts.buffer_pool_mb * 1024 / ra_node->opts.max_window_kb;
+	snprintf(pool_name, sizeof(pool_name), "readahead_%" PRIu32, g_ra_pool_id++);
+	ra_node->pool = spdk_mempool_create(pool_name, ra_node->pool_count,
+					    ra_node->max_window_blocks * bdev->blocklen,
+					    0, SPDK_ENV_SOCKET_ID_ANY);
+	if (!ra_node->pool) {
+		SPDK_ERRLOG("could not allocate readahead buffer pool for %s\n", name->vbdev_name);
+		rc = -ENOMEM;
+		goto err_close;
+	}
+
+	ra_node->ra_bdev.write_cache = bdev->write_cache;
+	ra_node->ra_bdev.required_alignment = bdev->required_alignment;
+	ra_node->ra_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+	ra_node->ra_bdev.blocklen = bdev->blocklen;
+	ra_node->ra_bdev.blockcnt = bdev->blockcnt;
+
+	ra_node->ra_bdev.ctxt = ra_node;
+	ra_node->ra_bdev.fn_table = &vbdev_readahead_fn_table;
+	ra_node->ra_bdev.module = &readahead_if;
+
+	ra_node->thread = spdk_get_thread();
+
+	rc = spdk_bdev_module_claim_bdev(bdev, ra_node->base_desc, ra_node->ra_bdev.module);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name->bdev_name);
+		goto err_pool;
+	}
+
+	TAILQ_INSERT_TAIL(&g_ra_nodes, ra_node, link);
+	spdk_io_device_register(ra_node, ra_bdev_ch_create_cb, ra_bdev_ch_destroy_cb,
+				sizeof(struct ra_io_channel), name->vbdev_name);
+
+	rc = spdk_bdev_register(&ra_node->ra_bdev);
+	if (rc) {
+		SPDK_ERRLOG("could not register readahead bdev %s\n", name->vbdev_name);
+		TAILQ_REMOVE(&g_ra_nodes, ra_node, link);
+		spdk_io_device_unregister(ra_node, NULL);
+		spdk_bdev_module_release_bdev(bdev);
+		goto err_pool;
+	}
+
+	SPDK_NOTICELOG("created readahead bdev %s on %s\n", name->vbdev_name, name->bdev_name);
+
+	return 0;
+
+err_pool:
+	spdk_mempool_free(ra_node->pool);
+err_close:
+	spdk_bdev_close(ra_node->base_desc);
+err_name:
+	free(ra_node->ra_bdev.name);
+	free(ra_node);
+	return rc;
+}
+
+int
+bdev_readahead_create_disk(const char *bdev_name, const char *vbdev_name,
+			   const struct vbdev_readahead_opts *opts)
+{
+	struct bdev_readahead_names *name;
+	int rc;
+
+	if (opts->min_window_kb == 0 || opts->max_window_kb < opts->min_window_kb) {
+		SPDK_ERRLOG("readahead window must be non-zero and min_window_kb <= max_window_kb\n");
+		return -EINVAL;
+	}
+
+	if (opts->max_streams == 0) {
+		SPDK_ERRLOG("readahead needs at least one stream per channel\n");
+		return -EINVAL;
+	}
+
+	if ((uint64_t)opts->buffer_pool_mb * 1024 < opts->max_window_kb) {
+		SPDK_ERRLOG("readahead buffer pool can't hold a single window\n");
+		return -EINVAL;
+	}
+
+	rc = vbdev_readahead_insert_name(bdev_name, vbdev_name, opts, &name);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_readahead_register(name);
+	if (rc == -ENODEV) {
+		/* This is not an error, we tracked the name above and it still
+		 * may show up later.
+		 */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc) {
+		vbdev_readahead_free_name(name);
+	}
+
+	return rc;
+}
+
+void
+bdev_readahead_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_readahead_names *name;
+
+	if (!bdev || bdev->module != &readahead_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	/* Remove the association (vbdev, bdev) so that the vbdev does not get
+	 * re-created if the same bdev is constructed at some other time.
+	 */
+	TAILQ_FOREACH(name, &g_bdev_readahead_names, link) {
+		if (strcmp(name->vbdev_name, bdev->name) == 0) {
+			vbdev_readahead_free_name(name);
+			break;
+		}
+	}
+
+	spdk_bdev_unregister(bdev, cb_fn, cb_arg);
+}
+
+struct ra_get_stats_ctx {
+	struct vbdev_readahead		*ra_node;
+	struct vbdev_readahead_stats	stats;
+	vbdev_readahead_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+ra_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct ra_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct ra_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+
+	ctx->stats.read_ios += ra_ch->stats.read_ios;
+	ctx->stats.read_hits += ra_ch->stats.read_hits;
+	ctx->stats.prefetch_ios += ra_ch->stats.prefetch_ios;
+	ctx->stats.prefetch_blocks += ra_ch->stats.prefetch_blocks;
+	ctx->stats.wasted_blocks += ra_ch->stats.wasted_blocks;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+ra_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct ra_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->stats.buffers_total = ctx->ra_node->pool_count;
+	ctx->stats.buffers_free = spdk_mempool_count(ctx->ra_node->pool);
+	ctx->cb_fn(ctx->cb_arg, status, &ctx->stats);
+	free(ctx);
+}
+
+void
+bdev_readahead_get_stats(struct spdk_bdev *bdev, vbdev_readahead_get_stats_cb cb_fn,
+			 void *cb_arg)
+{
+	struct ra_get_stats_ctx *ctx;
+
+	if (!bdev || bdev->module != &readahead_if) {
+		cb_fn(cb_arg, -ENODEV, NULL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->ra_node = bdev->ctxt;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(ctx->ra_node, ra_get_stats_channel, ctx, ra_get_stats_done);
+}
+
+static void
+vbdev_readahead_examine(struct spdk_bdev *bdev)
+{
+	struct bdev_readahead_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_readahead_names, link) {
+		if (strcmp(name->bdev_name, bdev->name) == 0) {
+			vbdev_readahead_register(name);
+		}
+	}
+
+	spdk_bdev_module_examine_done(&readahead_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_readahead)
@@ -0,0 +1,104 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPDK_VBDEV_READAHEAD_H
+#define SPDK_VBDEV_READAHEAD_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+#define VBDEV_READAHEAD_DEFAULT_MIN_WINDOW_KB	64
+#define VBDEV_READAHEAD_DEFAULT_MAX_WINDOW_KB	1024
+#define VBDEV_READAHEAD_DEFAULT_BUFFER_POOL_MB	64
+#define VBDEV_READAHEAD_DEFAULT_MAX_STREAMS	8
+
+struct vbdev_readahead_opts {
+	/* Size of the first prefetch of a stream */
+	uint32_t	min_window_kb;
+	/* Largest prefetch a stream can grow to, also the size of a pool buffer */
+	uint32_t	max_window_kb;
+	/* Memory set aside for prefetched data, shared by all channels */
+	uint32_t	buffer_pool_mb;
+	/* Number of sequential streams tracked per channel */
+	uint32_t	max_streams;
+};
+
+struct vbdev_readahead_stats {
+	uint64_t	read_ios;
+	/* Reads served from prefetched data */
+	uint64_t	read_hits;
+	uint64_t	prefetch_ios;
+	uint64_t	prefetch_blocks;
+	/* Prefetched blocks dropped before being read */
+	uint64_t	wasted_blocks;
+	uint64_t	buffers_total;
+	uint64_t	buffers_free;
+};
+
+typedef void (*vbdev_readahead_get_stats_cb)(void *cb_arg, int rc,
+		const struct vbdev_readahead_stats *stats);
+
+/**
+ * Create new readahead bdev.
+ *
+ * \param bdev_name Bdev on which readahead vbdev will be created.
+ * \param vbdev_name Name of the readahead bdev.
+ * \param opts Readahead options.
+ * \return 0 on success, other on failure.
+ */
+int bdev_readahead_create_disk(const char *bdev_name, const char *vbdev_name,
+			       const struct vbdev_readahead_opts *opts);
+
+/**
+ * Delete readahead bdev.
+ *
+ * \param bdev Pointer to readahead bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_readahead_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				void *cb_arg);
+
+/**
+ * Collect readahead statistics from all channels of a readahead bdev.
+ *
+ * \param bdev Pointer to readahead bdev.
+ * \param cb_fn Function to call with the statistics.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_readahead_get_stats(struct spdk_bdev *bdev, vbdev_readahead_get_stats_cb cb_fn,
+			      void *cb_arg);
+
+#endif /* SPDK_VBDEV_READAHEAD_H */
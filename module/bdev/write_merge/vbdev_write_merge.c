@@ -0,0 +1,915 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Write merge virtual bdev.  Small writes are held on their channel for a
+ * short window and writes to adjacent blocks are coalesced into a single
+ * vectored write to the base bdev.  This trades a little latency for fewer,
+ * larger writes, which pays off on backends with a high per-I/O cost such as
+ * aio, uring or rbd.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_write_merge.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* Iovecs a merged write can carry, the same as a child I/O of the bdev layer */
+#define WM_MAX_IOVS	BDEV_IO_NUM_CHILD_IOV
+
+static int vbdev_write_merge_init(void);
+static int vbdev_write_merge_get_ctx_size(void);
+static void vbdev_write_merge_examine(struct spdk_bdev *bdev);
+static void vbdev_write_merge_finish(void);
+static int vbdev_write_merge_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module write_merge_if = {
+	.name = "write_merge",
+	.module_init = vbdev_write_merge_init,
+	.get_ctx_size = vbdev_write_merge_get_ctx_size,
+	.examine_config = vbdev_write_merge_examine,
+	.module_fini = vbdev_write_merge_finish,
+	.config_json = vbdev_write_merge_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(write_merge, &write_merge_if)
+
+/* Write merge bdevs requested over RPC, kept so they can be created in examine()
+ * once their base bdev shows up.
+ */
+struct bdev_write_merge_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_write_merge_opts	opts;
+	TAILQ_ENTRY(bdev_write_merge_names)	link;
+};
+static TAILQ_HEAD(, bdev_write_merge_names) g_bdev_write_merge_names = TAILQ_HEAD_INITIALIZER(
+			g_bdev_write_merge_names);
+
+struct vbdev_write_merge {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		wm_bdev;
+	struct vbdev_write_merge_opts	opts;
+	uint64_t			max_merge_blocks;
+	int				max_iovs;
+	/* Merged writes don't cross this boundary if the base bdev splits on it */
+	uint64_t			boundary_blocks;
+	uint64_t			window_ticks;
+	struct spdk_thread		*thread;
+	TAILQ_ENTRY(vbdev_write_merge)	link;
+};
+static TAILQ_HEAD(, vbdev_write_merge) g_wm_nodes = TAILQ_HEAD_INITIALIZER(g_wm_nodes);
+
+struct wm_io_channel;
+
+/* A run of writes to adjacent blocks, submitted to the base bdev as one write */
+struct wm_run {
+	struct wm_io_channel		*wm_ch;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	uint64_t			start_tsc;
+	struct iovec			iovs[WM_MAX_IOVS];
+	int				iovcnt;
+	uint32_t			num_ios;
+	/* The writes the run is made of, completed along with it */
+	TAILQ_HEAD(, spdk_bdev_io)	ios;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+	TAILQ_ENTRY(wm_run)		link;
+};
+
+/* Runs are built per channel, so the I/O path doesn't need any locks */
+struct wm_io_channel {
+	struct spdk_io_channel		*base_ch;
+	/* The run still accepting writes, if any */
+	struct wm_run			*pending;
+	TAILQ_HEAD(, wm_run)		free_runs;
+	struct spdk_poller		*poller;
+	struct vbdev_write_merge_stats	stats;
+};
+
+struct wm_bdev_io {
+	struct spdk_io_channel		*ch;
+
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static void vbdev_write_merge_submit_request(struct spdk_io_channel *ch,
+		struct spdk_bdev_io *bdev_io);
+
+static void
+_wm_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+vbdev_write_merge_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct wm_bdev_io *io_ctx = (struct wm_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_write_merge_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_write_merge_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct wm_bdev_io *io_ctx = (struct wm_bdev_io *)bdev_io->driver_ctx;
+	struct wm_io_channel *wm_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_write_merge_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, wm_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_write_merge_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+wm_handle_submit_rc(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, int rc)
+{
+	struct wm_bdev_io *io_ctx = (struct wm_bdev_io *)bdev_io->driver_ctx;
+
+	if (rc == 0) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		io_ctx->ch = ch;
+		vbdev_write_merge_queue_io(bdev_io);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static struct wm_run *
+wm_run_get(struct wm_io_channel *wm_ch)
+{
+	struct wm_run *run;
+
+	run = TAILQ_FIRST(&wm_ch->free_runs);
+	if (run != NULL) {
+		TAILQ_REMOVE(&wm_ch->free_runs, run, link);
+		return run;
+	}
+
+	/* Runs are only allocated the first time this many writes are outstanding */
+	run = calloc(1, sizeof(*run));
+	if (run != NULL) {
+		run->wm_ch = wm_ch;
+		TAILQ_INIT(&run->ios);
+	}
+
+	return run;
+}
+
+static void
+wm_run_complete(struct wm_run *run, enum spdk_bdev_io_status status)
+{
+	struct wm_io_channel *wm_ch = run->wm_ch;
+	struct spdk_bdev_io *bdev_io;
+
+	while ((bdev_io = TAILQ_FIRST(&run->ios))) {
+		TAILQ_REMOVE(&run->ios, bdev_io, module_link);
+		spdk_bdev_io_complete(bdev_io, status);
+	}
+
+	TAILQ_INSERT_HEAD(&wm_ch->free_runs, run, link);
+}
+
+static void
+_wm_run_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct wm_run *run = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	wm_run_complete(run, success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+wm_run_submit(void *arg)
+{
+	struct wm_run *run = arg;
+	struct wm_io_channel *wm_ch = run->wm_ch;
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(wm_ch);
+	struct vbdev_write_merge *wm_node = spdk_io_channel_get_io_device(ch);
+	int rc;
+
+	rc = spdk_bdev_writev_blocks(wm_node->base_desc, wm_ch->base_ch, run->iovs, run->iovcnt,
+				     run->offset_blocks, run->num_blocks, _wm_run_done, run);
+	if (rc == 0) {
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		run->bdev_io_wait.bdev = &wm_node->wm_bdev;
+		run->bdev_io_wait.cb_fn = wm_run_submit;
+		run->bdev_io_wait.cb_arg = run;
+
+		rc = spdk_bdev_queue_io_wait(&wm_node->wm_bdev, wm_ch->base_ch, &run->bdev_io_wait);
+		if (rc == 0) {
+			return;
+		}
+		SPDK_ERRLOG("Queue io failed in wm_run_submit, rc=%d.\n", rc);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+	}
+
+	wm_run_complete(run, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+/* Send the pending run of the channel to the base bdev */
+static void
+wm_flush(struct wm_io_channel *wm_ch, bool window_expired)
+{
+	struct wm_run *run = wm_ch->pending;
+
+	if (run == NULL) {
+		return;
+	}
+
+	wm_ch->pending = NULL;
+	wm_ch->stats.base_write_ios++;
+	if (run->num_ios > 1) {
+		wm_ch->stats.merged_ios++;
+	}
+	if (window_expired) {
+		wm_ch->stats.window_flushes++;
+	}
+
+	wm_run_submit(run);
+}
+
+static int
+wm_ch_poll(void *arg)
+{
+	struct wm_io_channel *wm_ch = arg;
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(wm_ch);
+	struct vbdev_write_merge *wm_node = spdk_io_channel_get_io_device(ch);
+	struct wm_run *run = wm_ch->pending;
+
+	if (run == NULL || spdk_get_ticks() - run->start_tsc < wm_node->window_ticks) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	wm_flush(wm_ch, true);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static inline bool
+wm_run_overlaps(struct wm_run *run, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	return offset_blocks < run->offset_blocks + run->num_blocks &&
+	       run->offset_blocks < offset_blocks + num_blocks;
+}
+
+static bool
+wm_run_can_append(struct vbdev_write_merge *wm_node, struct wm_run *run,
+		  struct spdk_bdev_io *bdev_io)
+{
+	uint64_t end = run->offset_blocks + run->num_blocks;
+
+	if (bdev_io->u.bdev.offset_blocks != end ||
+	    run->num_blocks + bdev_io->u.bdev.num_blocks > wm_node->max_merge_blocks ||
+	    run->iovcnt + bdev_io->u.bdev.iovcnt > wm_node->max_iovs) {
+		return false;
+	}
+
+	end += bdev_io->u.bdev.num_blocks;
+	if (wm_node->boundary_blocks != 0 &&
+	    run->offset_blocks / wm_node->boundary_blocks != (end - 1) / wm_node->boundary_blocks) {
+		return false;
+	}
+
+	return true;
+}
+
+static void
+wm_write(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_write_merge *wm_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_write_merge,
+					    wm_bdev);
+	struct wm_io_channel *wm_ch = spdk_io_channel_get_ctx(ch);
+	struct wm_run *run = wm_ch->pending;
+	int rc;
+
+	wm_ch->stats.write_ios++;
+
+	if (run != NULL && !wm_run_can_append(wm_node, run, bdev_io)) {
+		wm_flush(wm_ch, false);
+		run = NULL;
+	}
+
+	if (run == NULL) {
+		/* Writes that can't grow any further aren't worth holding */
+		if (bdev_io->u.bdev.num_blocks >= wm_node->max_merge_blocks ||
+		    bdev_io->u.bdev.iovcnt > wm_node->max_iovs ||
+		    (run = wm_run_get(wm_ch)) == NULL) {
+			wm_ch->stats.base_write_ios++;
+			rc = spdk_bdev_writev_blocks(wm_node->base_desc, wm_ch->base_ch,
+						     bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+						     bdev_io->u.bdev.offset_blocks,
+						     bdev_io->u.bdev.num_blocks, _wm_complete_io,
+						     bdev_io);
+			wm_handle_submit_rc(ch, bdev_io, rc);
+			return;
+		}
+
+		run->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		run->num_blocks = 0;
+		run->iovcnt = 0;
+		run->num_ios = 0;
+		run->start_tsc = spdk_get_ticks();
+		wm_ch->pending = run;
+	}
+
+	memcpy(&run->iovs[run->iovcnt], bdev_io->u.bdev.iovs,
+	       bdev_io->u.bdev.iovcnt * sizeof(struct iovec));
+	run->iovcnt += bdev_io->u.bdev.iovcnt;
+	run->num_blocks += bdev_io->u.bdev.num_blocks;
+	run->num_ios++;
+	TAILQ_INSERT_TAIL(&run->ios, bdev_io, module_link);
+
+	if (run->num_blocks == wm_node->max_merge_blocks || run->iovcnt == wm_node->max_iovs ||
+	    (wm_node->boundary_blocks != 0 &&
+	     (run->offset_blocks + run->num_blocks) % wm_node->boundary_blocks == 0)) {
+		wm_flush(wm_ch, false);
+	}
+}
+
+static void
+vbdev_write_merge_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_write_merge *wm_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_write_merge,
+					    wm_bdev);
+	struct wm_io_channel *wm_ch = spdk_io_channel_get_ctx(ch);
+	int rc;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		wm_write(ch, bdev_io);
+		return;
+	}
+
+	/* Anything but a read of other blocks has to be ordered after the held writes */
+	if (wm_ch->pending != NULL &&
+	    (bdev_io->type != SPDK_BDEV_IO_TYPE_READ ||
+	     wm_run_overlaps(wm_ch->pending, bdev_io->u.bdev.offset_blocks,
+			     bdev_io->u.bdev.num_blocks))) {
+		wm_flush(wm_ch, false);
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		rc = spdk_bdev_readv_blocks(wm_node->base_desc, wm_ch->base_ch, bdev_io->u.bdev.iovs,
+					    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks, _wm_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		rc = spdk_bdev_write_zeroes_blocks(wm_node->base_desc, wm_ch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _wm_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		rc = spdk_bdev_unmap_blocks(wm_node->base_desc, wm_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _wm_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(wm_node->base_desc, wm_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _wm_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(wm_node->base_desc, wm_ch->base_ch,
+				     _wm_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("write_merge: unsupported I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	wm_handle_submit_rc(ch, bdev_io, rc);
+}
+
+static bool
+vbdev_write_merge_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_write_merge *wm_node = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(wm_node->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_write_merge_get_io_channel(void *ctx)
+{
+	struct vbdev_write_merge *wm_node = ctx;
+
+	return spdk_get_io_channel(wm_node);
+}
+
+static void
+vbdev_write_merge_write_opts_json(struct vbdev_write_merge *wm_node,
+				  struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&wm_node->wm_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(wm_node->base_bdev));
+	spdk_json_write_named_uint32(w, "merge_window_us", wm_node->opts.merge_window_us);
+	spdk_json_write_named_uint32(w, "max_merge_kb", wm_node->opts.max_merge_kb);
+}
+
+static int
+vbdev_write_merge_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_write_merge *wm_node = ctx;
+
+	spdk_json_write_named_object_begin(w, "write_merge");
+	vbdev_write_merge_write_opts_json(wm_node, w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_write_merge_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_write_merge *wm_node;
+
+	TAILQ_FOREACH(wm_node, &g_wm_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_write_merge_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_write_merge_write_opts_json(wm_node, w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+wm_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct wm_io_channel *wm_ch = ctx_buf;
+	struct vbdev_write_merge *wm_node = io_device;
+
+	TAILQ_INIT(&wm_ch->free_runs);
+
+	wm_ch->base_ch = spdk_bdev_get_io_channel(wm_node->base_desc);
+	if (wm_ch->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	/* Poll a few times per window, so writes aren't held much longer than it */
+	wm_ch->poller = SPDK_POLLER_REGISTER(wm_ch_poll, wm_ch, wm_node->opts.merge_window_us / 4);
+	if (wm_ch->poller == NULL) {
+		spdk_put_io_channel(wm_ch->base_ch);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+wm_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct wm_io_channel *wm_ch = ctx_buf;
+	struct wm_run *run;
+
+	/* Held writes are outstanding I/O, so nothing should be pending here */
+	assert(wm_ch->pending == NULL);
+	if (wm_ch->pending != NULL) {
+		wm_run_complete(wm_ch->pending, SPDK_BDEV_IO_STATUS_ABORTED);
+		wm_ch->pending = NULL;
+	}
+
+	spdk_poller_unregister(&wm_ch->poller);
+	spdk_put_io_channel(wm_ch->base_ch);
+
+	while ((run = TAILQ_FIRST(&wm_ch->free_runs))) {
+		TAILQ_REMOVE(&wm_ch->free_runs, run, link);
+		free(run);
+	}
+}
+
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_write_merge *wm_node = io_device;
+
+	free(wm_node->wm_bdev.name);
+	free(wm_node);
+}
+
+static void
+_vbdev_write_merge_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+static int
+vbdev_write_merge_destruct(void *ctx)
+{
+	struct vbdev_write_merge *wm_node = ctx;
+
+	TAILQ_REMOVE(&g_wm_nodes, wm_node, link);
+
+	spdk_bdev_module_release_bdev(wm_node->base_bdev);
+
+	/* Close the underlying bdev on its same opened thread. */
+	if (wm_node->thread && wm_node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(wm_node->thread, _vbdev_write_merge_destruct, wm_node->base_desc);
+	} else {
+		spdk_bdev_close(wm_node->base_desc);
+	}
+
+	spdk_io_device_unregister(wm_node, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+vbdev_write_merge_free_name(struct bdev_write_merge_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_write_merge_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_write_merge_insert_name(const char *bdev_name, const char *vbdev_name,
+			      const struct vbdev_write_merge_opts *opts,
+			      struct bdev_write_merge_names **_name)
+{
+	struct bdev_write_merge_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_write_merge_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("write merge bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_write_merge_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_write_merge_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->bdev_name || !name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate bdev names\n");
+		free(name->bdev_name);
+		free(name->vbdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+	name->opts = *opts;
+
+	TAILQ_INSERT_TAIL(&g_bdev_write_merge_names, name, link);
+	*_name = name;
+
+	return 0;
+}
+
+static int
+vbdev_write_merge_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_write_merge_finish(void)
+{
+	struct bdev_write_merge_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_write_merge_names))) {
+		vbdev_write_merge_free_name(name);
+	}
+}
+
+static int
+vbdev_write_merge_get_ctx_size(void)
+{
+	return sizeof(struct wm_bdev_io);
+}
+
+static const struct spdk_bdev_fn_table vbdev_write_merge_fn_table = {
+	.destruct		= vbdev_write_merge_destruct,
+	.submit_request		= vbdev_write_merge_submit_request,
+	.io_type_supported	= vbdev_write_merge_io_type_supported,
+	.get_io_channel		= vbdev_write_merge_get_io_channel,
+	.dump_info_json		= vbdev_write_merge_dump_info_json,
+};
+
+static void
+vbdev_write_merge_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_write_merge *wm_node, *tmp;
+
+	TAILQ_FOREACH_SAFE(wm_node, &g_wm_nodes, link, tmp) {
+		if (bdev_find == wm_node->base_bdev) {
+			spdk_bdev_unregister(&wm_node->wm_bdev, NULL, NULL);
+		}
+	}
+}
+
+static void
+vbdev_write_merge_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+				     void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_write_merge_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+vbdev_write_merge_register(struct bdev_write_merge_names *name)
+{
+	struct vbdev_write_merge *wm_node;
+	struct spdk_bdev *bdev;
+	uint64_t max_bytes;
+	int rc;
+
+	wm_node = calloc(1, sizeof(struct vbdev_write_merge));
+	if (!wm_node) {
+		SPDK_ERRLOG("could not allocate write merge node\n");
+		return -ENOMEM;
+	}
+
+	wm_node->wm_bdev.name = strdup(name->vbdev_name);
+	if (!wm_node->wm_bdev.name) {
+		SPDK_ERRLOG("could not allocate write merge bdev name\n");
+		free(wm_node);
+		return -ENOMEM;
+	}
+	wm_node->wm_bdev.product_name = "write_merge";
+	wm_node->opts = name->opts;
+
+	rc = spdk_bdev_open_ext(name->bdev_name, true, vbdev_write_merge_base_bdev_event_cb,
+				NULL, &wm_node->base_desc);
+	if (rc) {
+		if (rc != -ENODEV) {
+			SPDK_ERRLOG("could not open bdev %s\n", name->bdev_name);
+		}
+		goto err_name;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(wm_node->base_desc);
+	wm_node->base_bdev = bdev;
+
+	if (bdev->md_len != 0) {
+		SPDK_ERRLOG("write merge bdev %s: base bdev %s has metadata, which is not supported\n",
+			    name->vbdev_name, name->bdev_name);
+		rc = -ENOTSUP;
+		goto err_close;
+	}
+
+	/* Don't build writes the bdev layer would have to split again */
+	max_bytes = (uint64_t)wm_node->opts.max_merge_kb * 1024;
+	wm_node->max_iovs = WM_MAX_IOVS;
+	if (bdev->max_segment_size != 0 && bdev->max_num_segments != 0) {
+		max_bytes = spdk_min(max_bytes, (uint64_t)bdev->max_segment_size * bdev->max_num_segments);
+		wm_node->max_iovs = spdk_min(wm_node->max_iovs, (int)bdev->max_num_segments);
+	}
+	wm_node->max_merge_blocks = spdk_max(max_bytes / bdev->blocklen, 1);
+	if (bdev->split_on_optimal_io_boundary) {
+		wm_node->boundary_blocks = bdev->optimal_io_boundary;
+	}
+	wm_node->window_ticks = (uint64_t)wm_node->opts.merge_window_us * spdk_get_ticks_hz() /
+				SPDK_SEC_TO_USEC;
+
+	wm_node->wm_bdev.write_cache = bdev->write_cache;
+	wm_node->wm_bdev.required_alignment = bdev->required_alignment;
+	wm_node->wm_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+	wm_node->wm_bdev.blocklen = bdev->blocklen;
+	wm_node->wm_bdev.blockcnt = bdev->blockcnt;
+
+	wm_node->wm_bdev.ctxt = wm_node;
+	wm_node->wm_bdev.fn_table = &vbdev_write_merge_fn_table;
+	wm_node->wm_bdev.module = &write_merge_if;
+
+	wm_node->thread = spdk_get_thread();
+
+	rc = spdk_bdev_module_claim_bdev(bdev, wm_node->base_desc, wm_node->wm_bdev.module);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name->bdev_name);
+		goto err_close;
+	}
+
+	TAILQ_INSERT_TAIL(&g_wm_nodes, wm_node, link);
+	spdk_io_device_register(wm_node, wm_bdev_ch_create_cb, wm_bdev_ch_destroy_cb,
+				sizeof(struct wm_io_channel), name->vbdev_name);
+
+	rc = spdk_bdev_register(&wm_node->wm_bdev);
+	if (rc) {
+		SPDK_ERRLOG("could not register write merge bdev %s\n", name->vbdev_name);
+		TAILQ_REMOVE(&g_wm_nodes, wm_node, link);
+		spdk_io_device_unregister(wm_node, NULL);
+		spdk_bdev_module_release_bdev(bdev);
+		goto err_close;
+	}
+
+	SPDK_NOTICELOG("created write merge bdev %s on %s\n", name->vbdev_name, name->bdev_name);
+
+	return 0;
+
+err_close:
+	spdk_bdev_close(wm_node->base_desc);
+err_name:
+	free(wm_node->wm_bdev.name);
+	free(wm_node);
+	return rc;
+}
+
+int
+bdev_write_merge_create_disk(const char *bdev_name, const char *vbdev_name,
+			     const struct vbdev_write_merge_opts *opts)
+{
+	struct bdev_write_merge_names *name;
+	int rc;
+
+	if (opts->max_merge_kb == 0) {
+		SPDK_ERRLOG("write merge max_merge_kb must be non-zero\n");
+		return -EINVAL;
+	}
+
+	rc = vbdev_write_merge_insert_name(bdev_name, vbdev_name, opts, &name);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_write_merge_register(name);
+	if (rc == -ENODEV) {
+		/* This is not an error, we tracked the name above and it still
+		 * may show up later.
+		 */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc) {
+		vbdev_write_merge_free_name(name);
+	}
+
+	return rc;
+}
+
+void
+bdev_write_merge_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_write_merge_names *name;
+
+	if (!bdev || bdev->module != &write_merge_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	/* Remove the association (vbdev, bdev) so that the vbdev does not get
+	 * re-created if the same bdev is constructed at some other time.
+	 */
+	TAILQ_FOREACH(name, &g_bdev_write_merge_names, link) {
+		if (strcmp(name->vbdev_name, bdev->name) == 0) {
+			vbdev_write_merge_free_name(name);
+			break;
+		}
+	}
+
+	spdk_bdev_unregister(bdev, cb_fn, cb_arg);
+}
+
+struct wm_get_stats_ctx {
+	struct vbdev_write_merge_stats	stats;
+	vbdev_write_merge_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+wm_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct wm_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct wm_io_channel *wm_ch = spdk_io_channel_get_ctx(ch);
+
+	ctx->stats.write_ios += wm_ch->stats.write_ios;
+	ctx->stats.base_write_ios += wm_ch->stats.base_write_ios;
+	ctx->stats.merged_ios += wm_ch->stats.merged_ios;
+	ctx->stats.window_flushes += wm_ch->stats.window_flushes;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+wm_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct wm_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, status, &ctx->stats);
+	free(ctx);
+}
+
+void
+bdev_write_merge_get_stats(struct spdk_bdev *bdev, vbdev_write_merge_get_stats_cb cb_fn,
+			   void *cb_arg)
+{
+	struct wm_get_stats_ctx *ctx;
+
+	if (!bdev || bdev->module != &write_merge_if) {
+		cb_fn(cb_arg, -ENODEV, NULL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(bdev->ctxt, wm_get_stats_channel, ctx, wm_get_stats_done);
+}
+
+static void
+vbdev_write_merge_examine(struct spdk_bdev *bdev)
+{
+	struct bdev_write_merge_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_write_merge_names, link) {
+		if (strcmp(name->bdev_name, bdev->name) == 0) {
+			vbdev_write_merge_register(name);
+		}
+	}
+
+	spdk_bdev_module_examine_done(&write_merge_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_write_merge)
@@ -0,0 +1,96 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPDK_VBDEV_WRITE_MERGE_H
+#define SPDK_VBDEV_WRITE_MERGE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+#define VBDEV_WRITE_MERGE_DEFAULT_WINDOW_US	50
+#define VBDEV_WRITE_MERGE_DEFAULT_MAX_MERGE_KB	128
+
+struct vbdev_write_merge_opts {
+	/* How long a write is held waiting for adjacent writes */
+	uint32_t	merge_window_us;
+	/* Largest write submitted to the base bdev, further capped by its limits */
+	uint32_t	max_merge_kb;
+};
+
+struct vbdev_write_merge_stats {
+	uint64_t	write_ios;
+	/* Writes submitted to the base bdev */
+	uint64_t	base_write_ios;
+	/* Base writes carrying more than one write */
+	uint64_t	merged_ios;
+	/* Base writes sent because the merge window expired */
+	uint64_t	window_flushes;
+};
+
+typedef void (*vbdev_write_merge_get_stats_cb)(void *cb_arg, int rc,
+		const struct vbdev_write_merge_stats *stats);
+
+/**
+ * Create new write merge bdev.
+ *
+ * \param bdev_name Bdev on which write merge vbdev will be created.
+ * \param vbdev_name Name of the write merge bdev.
+ * \param opts Write merge options.
+ * \return 0 on success, other on failure.
+ */
+int bdev_write_merge_create_disk(const char *bdev_name, const char *vbdev_name,
+				 const struct vbdev_write_merge_opts *opts);
+
+/**
+ * Delete write merge bdev.
+ *
+ * \param bdev Pointer to write merge bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_write_merge_delete_disk(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				  void *cb_arg);
+
+/**
+ * Collect write merge statistics from all channels of a write merge bdev.
+ *
+ * \param bdev Pointer to write merge bdev.
+ * \param cb_fn Function to call with the statistics.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_write_merge_get_stats(struct spdk_bdev *bdev, vbdev_write_merge_get_stats_cb cb_fn,
+				void *cb_arg);
+
+#endif /* SPDK_VBDEV_WRITE_MERGE_H */
@@ -949,6 +949,51 @@ posix_sock_readv(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
 	return posix_sock_recv_from_pipe(sock, iov, iovcnt);
 }
 
+static ssize_t
+posix_sock_readv_direct(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
+{
+	struct spdk_posix_sock *sock = __posix_sock(_sock);
+	struct spdk_posix_sock_group_impl *group = __posix_group_impl(sock->base.group_impl);
+	ssize_t rc;
+	size_t len;
+	int i;
+
+	if (sock->recv_pipe == NULL) {
+		return posix_sock_readv(_sock, iov, iovcnt);
+	}
+
+	if (sock->pipe_has_data) {
+		return posix_sock_recv_from_pipe(sock, iov, iovcnt);
+	}
+
+	/* If the socket is not in a group, we must assume it always has
+	 * data waiting for us because it is not epolled */
+	if (group != NULL && !sock->socket_has_data) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	rc = readv(sock->fd, iov, iovcnt);
+	if (group == NULL) {
+		return rc;
+	}
+
+	len = 0;
+	for (i = 0; i < iovcnt; i++) {
+		len += iov[i].iov_len;
+	}
+
+	/* Errors count as draining the socket data, as does a short read. The pipe is
+	 *  empty, so nothing is left to report for this socket until it is epolled again.
+	 */
+	if (rc <= 0 || (size_t)rc < len) {
+		sock->socket_has_data = false;
+		TAILQ_REMOVE(&group->socks_with_data, sock, link);
+	}
+
+	return rc;
+}
+
 static ssize_t
 posix_sock_recv(struct spdk_sock *sock, void *buf, size_t len)
 {
@@ -1543,6 +1588,7 @@ static struct spdk_net_impl g_posix_net_impl = {
 	.close		= posix_sock_close,
 	.recv		= posix_sock_recv,
 	.readv		= posix_sock_readv,
+	.readv_direct	= posix_sock_readv_direct,
 	.writev		= posix_sock_writev,
 	.writev_async	= posix_sock_writev_async,
 	.flush		= posix_sock_flush,
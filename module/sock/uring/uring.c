@@ -724,6 +724,18 @@ uring_sock_readv(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
 	return uring_sock_recv_from_pipe(sock, iov, iovcnt);
 }
 
+static ssize_t
+uring_sock_readv_direct(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
+{
+	struct spdk_uring_sock *sock = __uring_sock(_sock);
+
+	if (sock->recv_pipe != NULL && spdk_pipe_reader_bytes_available(sock->recv_pipe) != 0) {
+		return uring_sock_recv_from_pipe(sock, iov, iovcnt);
+	}
+
+	return readv(sock->fd, iov, iovcnt);
+}
+
 static ssize_t
 uring_sock_recv(struct spdk_sock *sock, void *buf, size_t len)
 {
@@ -1567,6 +1579,7 @@ static struct spdk_net_impl g_uring_net_impl = {
 	.close		= uring_sock_close,
 	.recv		= uring_sock_recv,
 	.readv		= uring_sock_readv,
+	.readv_direct	= uring_sock_readv_direct,
 	.writev		= uring_sock_writev,
 	.writev_async	= uring_sock_writev_async,
 	.flush          = uring_sock_flush,
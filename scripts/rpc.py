@@ -182,7 +182,11 @@ if __name__ == "__main__":
                                   bdev_io_cache_size=args.bdev_io_cache_size,
                                   bdev_auto_examine=args.bdev_auto_examine,
                                   small_buf_pool_size=args.small_buf_pool_size,
-                                  large_buf_pool_size=args.large_buf_pool_size)
+                                  large_buf_pool_size=args.large_buf_pool_size,
+                                  bdev_io_pool_size_per_socket=args.bdev_io_pool_size_per_socket,
+                                  small_buf_pool_size_per_socket=args.small_buf_pool_size_per_socket,
+                                  large_buf_pool_size_per_socket=args.large_buf_pool_size_per_socket,
+                                  numa_pools=args.numa_pools)
 
     p = subparsers.add_parser('bdev_set_options', aliases=['set_bdev_options'],
                               help="""Set options of bdev subsystem""")
@@ -190,12 +194,23 @@ if __name__ == "__main__":
     p.add_argument('-c', '--bdev-io-cache-size', help='Maximum number of bdev_io structures cached per thread', type=int)
     p.add_argument('-s', '--small-buf-pool-size', help='Maximum number of small buf (i.e., 8KB) pool size', type=int)
     p.add_argument('-l', '--large-buf-pool-size', help='Maximum number of large buf (i.e., 64KB) pool size', type=int)
+    p.add_argument('--bdev-io-pool-size-per-socket', help='Number of bdev_io structures in the pool of each NUMA node', type=int)
+    p.add_argument('--small-buf-pool-size-per-socket', help='Number of small bufs in the pool of each NUMA node', type=int)
+    p.add_argument('--large-buf-pool-size-per-socket', help='Number of large bufs in the pool of each NUMA node', type=int)
+    p.add_argument('--disable-numa-pools', dest='numa_pools', help='Share a single set of pools among all NUMA nodes', action='store_false')
     group = p.add_mutually_exclusive_group()
     group.add_argument('-e', '--enable-auto-examine', dest='bdev_auto_examine', help='Allow to auto examine', action='store_true')
     group.add_argument('-d', '--disable-auto-examine', dest='bdev_auto_examine', help='Not allow to auto examine', action='store_false')
     p.set_defaults(bdev_auto_examine=True)
     p.set_defaults(func=bdev_set_options)
 
+    def bdev_get_pool_stats(args):
+        print_json(rpc.bdev.bdev_get_pool_stats(args.client))
+
+    p = subparsers.add_parser('bdev_get_pool_stats',
+                              help="""Display usage of the bdev_io and data buffer pools of each NUMA node""")
+    p.set_defaults(func=bdev_get_pool_stats)
+
     def bdev_examine(args):
         rpc.bdev.bdev_examine(args.client,
                               name=args.name)
@@ -471,7 +486,9 @@ if __name__ == "__main__":
                                        io_queue_requests=args.io_queue_requests,
                                        delay_cmd_submit=args.delay_cmd_submit,
                                        transport_retry_count=args.transport_retry_count,
-                                       bdev_retry_count=args.bdev_retry_count)
+                                       bdev_retry_count=args.bdev_retry_count,
+                                       io_qpair_share_threads=args.io_qpair_share_threads,
+                                       io_qpair_promote_iops=args.io_qpair_promote_iops)
 
     p = subparsers.add_parser('bdev_nvme_set_options', aliases=['set_bdev_nvme_options'],
                               help='Set options for the bdev nvme type. This is startup command.')
@@ -506,6 +523,10 @@ if __name__ == "__main__":
                    help='the number of attempts per I/O in the transport layer when an I/O fails.', type=int)
     p.add_argument('-r', '--bdev-retry-count',
                    help='the number of attempts per I/O in the bdev layer when an I/O fails. -1 means infinite retries.', type=int)
+    p.add_argument('--io-qpair-share-threads',
+                   help='the number of threads which share an I/O qpair of a controller. 0 or 1 disables sharing.', type=int)
+    p.add_argument('--io-qpair-promote-iops',
+                   help='IOPS above which a thread moves from a shared to a dedicated I/O qpair. 0 means never.', type=int)
 
     p.set_defaults(func=bdev_nvme_set_options)
 
@@ -860,6 +881,143 @@ if __name__ == "__main__":
     p.add_argument('name', help='pmem bdev name')
     p.set_defaults(func=bdev_pmem_delete)
 
+    def bdev_cache_create(args):
+        print_json(rpc.bdev.bdev_cache_create(args.client,
+                                              base_bdev_name=args.base_bdev_name,
+                                              name=args.name,
+                                              cache_size_mb=args.cache_size_mb,
+                                              line_size=args.line_size,
+                                              num_shards=args.num_shards,
+                                              mode=args.mode))
+
+    p = subparsers.add_parser('bdev_cache_create',
+                              help='Add a DRAM read cache bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the cache bdev", required=True)
+    p.add_argument('-s', '--cache-size-mb', help="Size of the cache in MiB", type=int, required=True)
+    p.add_argument('-l', '--line-size', help="Cache line size in bytes", type=int)
+    p.add_argument('-n', '--num-shards', help="Number of independently locked cache shards", type=int)
+    p.add_argument('-m', '--mode', help="Write handling", choices=['write_through', 'write_invalidate'])
+    p.set_defaults(func=bdev_cache_create)
+
+    def bdev_cache_delete(args):
+        rpc.bdev.bdev_cache_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_cache_delete', help='Delete a cache bdev')
+    p.add_argument('name', help='cache bdev name')
+    p.set_defaults(func=bdev_cache_delete)
+
+    def bdev_cache_get_stats(args):
+        print_dict(rpc.bdev.bdev_cache_get_stats(args.client,
+                                                 name=args.name))
+
+    p = subparsers.add_parser('bdev_cache_get_stats', help='Display statistics of a cache bdev')
+    p.add_argument('name', help='cache bdev name')
+    p.set_defaults(func=bdev_cache_get_stats)
+
+    def bdev_readahead_create(args):
+        print_json(rpc.bdev.bdev_readahead_create(args.client,
+                                                  base_bdev_name=args.base_bdev_name,
+                                                  name=args.name,
+                                                  min_window_kb=args.min_window_kb,
+                                                  max_window_kb=args.max_window_kb,
+                                                  buffer_pool_mb=args.buffer_pool_mb,
+                                                  max_streams=args.max_streams))
+
+    p = subparsers.add_parser('bdev_readahead_create',
+                              help='Add a readahead bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the readahead bdev", required=True)
+    p.add_argument('--min-window-kb', help="Size of the first prefetch of a stream in KiB", type=int)
+    p.add_argument('--max-window-kb', help="Maximum prefetch size in KiB", type=int)
+    p.add_argument('--buffer-pool-mb', help="Memory for prefetched data in MiB", type=int)
+    p.add_argument('--max-streams', help="Number of sequential streams tracked per thread", type=int)
+    p.set_defaults(func=bdev_readahead_create)
+
+    def bdev_readahead_delete(args):
+        rpc.bdev.bdev_readahead_delete(args.client,
+                                       name=args.name)
+
+    p = subparsers.add_parser('bdev_readahead_delete', help='Delete a readahead bdev')
+    p.add_argument('name', help='readahead bdev name')
+    p.set_defaults(func=bdev_readahead_delete)
+
+    def bdev_readahead_get_stats(args):
+        print_dict(rpc.bdev.bdev_readahead_get_stats(args.client,
+                                                     name=args.name))
+
+    p = subparsers.add_parser('bdev_readahead_get_stats', help='Display statistics of a readahead bdev')
+    p.add_argument('name', help='readahead bdev name')
+    p.set_defaults(func=bdev_readahead_get_stats)
+
+    def bdev_write_merge_create(args):
+        print_json(rpc.bdev.bdev_write_merge_create(args.client,
+                                                    base_bdev_name=args.base_bdev_name,
+                                                    name=args.name,
+                                                    merge_window_us=args.merge_window_us,
+                                                    max_merge_kb=args.max_merge_kb))
+
+    p = subparsers.add_parser('bdev_write_merge_create',
+                              help='Add a write merge bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the write merge bdev", required=True)
+    p.add_argument('--merge-window-us', help="How long writes are held waiting for adjacent writes in microseconds",
+                   type=int)
+    p.add_argument('--max-merge-kb', help="Maximum size of a merged write in KiB", type=int)
+    p.set_defaults(func=bdev_write_merge_create)
+
+    def bdev_write_merge_delete(args):
+        rpc.bdev.bdev_write_merge_delete(args.client,
+                                         name=args.name)
+
+    p = subparsers.add_parser('bdev_write_merge_delete', help='Delete a write merge bdev')
+    p.add_argument('name', help='write merge bdev name')
+    p.set_defaults(func=bdev_write_merge_delete)
+
+    def bdev_write_merge_get_stats(args):
+        print_dict(rpc.bdev.bdev_write_merge_get_stats(args.client,
+                                                       name=args.name))
+
+    p = subparsers.add_parser('bdev_write_merge_get_stats', help='Display statistics of a write merge bdev')
+    p.add_argument('name', help='write merge bdev name')
+    p.set_defaults(func=bdev_write_merge_get_stats)
+
+    def bdev_dedup_create(args):
+        print_json(rpc.bdev.bdev_dedup_create(args.client,
+                                              base_bdev_name=args.base_bdev_name,
+                                              name=args.name,
+                                              chunk_size=args.chunk_size,
+                                              logical_size_mb=args.logical_size_mb,
+                                              fingerprint=args.fingerprint))
+
+    p = subparsers.add_parser('bdev_dedup_create',
+                              help='Add a dedup bdev on existing bdev, or load the one stored on it')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the dedup bdev", required=True)
+    p.add_argument('-c', '--chunk-size', help="Block size of the dedup bdev in bytes, the unit of deduplication",
+                   type=int)
+    p.add_argument('-s', '--logical-size-mb', help="Size of the dedup bdev in MiB", type=int)
+    p.add_argument('-f', '--fingerprint', help="Fingerprint of the data",
+                   choices=['sha256', 'crc32c'])
+    p.set_defaults(func=bdev_dedup_create)
+
+    def bdev_dedup_delete(args):
+        rpc.bdev.bdev_dedup_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_dedup_delete', help='Delete a dedup bdev')
+    p.add_argument('name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_delete)
+
+    def bdev_dedup_get_stats(args):
+        print_dict(rpc.bdev.bdev_dedup_get_stats(args.client,
+                                                 name=args.name))
+
+    p = subparsers.add_parser('bdev_dedup_get_stats', help='Display statistics of a dedup bdev')
+    p.add_argument('name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_get_stats)
+
     def bdev_passthru_create(args):
         print_json(rpc.bdev.bdev_passthru_create(args.client,
                                                  base_bdev_name=args.base_bdev_name,
@@ -916,6 +1074,14 @@ if __name__ == "__main__":
     p.add_argument('name', help='bdev name')
     p.set_defaults(func=bdev_get_histogram)
 
+    def bdev_get_histogram_percentiles(args):
+        print_dict(rpc.bdev.bdev_get_histogram_percentiles(args.client, name=args.name))
+
+    p = subparsers.add_parser('bdev_get_histogram_percentiles',
+                              help='Get latency percentiles by I/O type and size class for specified bdev')
+    p.add_argument('name', help='bdev name')
+    p.set_defaults(func=bdev_get_histogram_percentiles)
+
     def bdev_set_qd_sampling_period(args):
         rpc.bdev.bdev_set_qd_sampling_period(args.client,
                                              name=args.name,
@@ -954,6 +1120,70 @@ if __name__ == "__main__":
                    type=int, required=False)
     p.set_defaults(func=bdev_set_qos_limit)
 
+    def bdev_set_qos_class(args):
+        rpc.bdev.bdev_set_qos_class(args.client,
+                                    name=args.name,
+                                    qos_class=args.qos_class,
+                                    weight=args.weight,
+                                    latency_target_us=args.latency_target_us)
+
+    p = subparsers.add_parser('bdev_set_qos_class',
+                              help='Create or update a QoS class on a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('qos_class', help='QoS class name. Example: gold')
+    p.add_argument('-w', '--weight', help='Fair-share weight of the class (default: 1)',
+                   type=int, required=False)
+    p.add_argument('-l', '--latency-target-us',
+                   help='99th percentile latency target in microseconds. 0 means none.',
+                   type=int, required=False)
+    p.set_defaults(func=bdev_set_qos_class)
+
+    def bdev_delete_qos_class(args):
+        rpc.bdev.bdev_delete_qos_class(args.client,
+                                       name=args.name,
+                                       qos_class=args.qos_class)
+
+    p = subparsers.add_parser('bdev_delete_qos_class',
+                              help='Delete a QoS class of a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('qos_class', help='QoS class name. Example: gold')
+    p.set_defaults(func=bdev_delete_qos_class)
+
+    def bdev_get_qos_class_stats(args):
+        print_dict(rpc.bdev.bdev_get_qos_class_stats(args.client, name=args.name))
+
+    p = subparsers.add_parser('bdev_get_qos_class_stats',
+                              help='Get per-class QoS statistics of a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.set_defaults(func=bdev_get_qos_class_stats)
+
+    def bdev_enable_desc_stats(args):
+        rpc.bdev.bdev_enable_desc_stats(args.client, name=args.name, enable=args.enable)
+
+    p = subparsers.add_parser('bdev_enable_desc_stats',
+                              help='Enable or disable per-descriptor I/O statistics of a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('-e', '--enable', default=True, dest='enable', action='store_true',
+                   help='Enable and reset the statistics')
+    p.add_argument('-d', '--disable', dest='enable', action='store_false',
+                   help='Disable the statistics')
+    p.set_defaults(func=bdev_enable_desc_stats)
+
+    def bdev_get_top_descs(args):
+        print_dict(rpc.bdev.bdev_get_top_descs(args.client,
+                                               name=args.name,
+                                               sort_by=args.sort_by,
+                                               count=args.count))
+
+    p = subparsers.add_parser('bdev_get_top_descs',
+                              help='List the descriptors of a blockdev with the highest load')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('-s', '--sort-by', help='Sort by iops or bandwidth (default: iops)',
+                   choices=['iops', 'bandwidth'])
+    p.add_argument('-c', '--count', help='Maximum number of descriptors to list, 0 for all (default: 10)',
+                   type=int)
+    p.set_defaults(func=bdev_get_top_descs)
+
     def bdev_error_inject_error(args):
         rpc.bdev.bdev_error_inject_error(args.client,
                                          name=args.name,
@@ -997,6 +1227,26 @@ if __name__ == "__main__":
     p.add_argument('-c', '--name', help="Name of the NVMe bdev controller. Example: Nvme0", required=True)
     p.set_defaults(func=bdev_nvme_get_controller_health_info)
 
+    def bdev_nvme_set_multipath_policy(args):
+        rpc.bdev.bdev_nvme_set_multipath_policy(args.client,
+                                                name=args.name,
+                                                policy=args.policy)
+
+    p = subparsers.add_parser('bdev_nvme_set_multipath_policy',
+                              help="Set multipath policy of the NVMe bdev")
+    p.add_argument('-b', '--name', help='Name of the NVMe bdev', required=True)
+    p.add_argument('-p', '--policy', help='Multipath policy', required=True,
+                   choices=['active_passive', 'round_robin', 'queue_depth', 'latency'])
+    p.set_defaults(func=bdev_nvme_set_multipath_policy)
+
+    def bdev_nvme_get_io_paths(args):
+        print_dict(rpc.bdev.bdev_nvme_get_io_paths(args.client, name=args.name))
+
+    p = subparsers.add_parser('bdev_nvme_get_io_paths',
+                              help='Display I/O paths of NVMe bdevs and their statistics')
+    p.add_argument('-b', '--name', help='Name of the NVMe bdev', required=False)
+    p.set_defaults(func=bdev_nvme_get_io_paths)
+
     # iSCSI
     def iscsi_set_options(args):
         rpc.iscsi.iscsi_set_options(
@@ -1745,8 +1995,13 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.set_defaults(func=bdev_lvol_get_lvstores)
 
     def bdev_raid_get_bdevs(args):
-        print_array(rpc.bdev.bdev_raid_get_bdevs(args.client,
-                                                 category=args.category))
+        result = rpc.bdev.bdev_raid_get_bdevs(args.client,
+                                              category=args.category,
+                                              verbose=args.verbose)
+        if args.verbose:
+            print_dict(result)
+        else:
+            print_array(result)
 
     p = subparsers.add_parser('bdev_raid_get_bdevs', aliases=['get_raid_bdevs'],
                               help="""This is used to list all the raid bdev names based on the input category
@@ -1755,6 +2010,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     is the raid bdev which does not have full configuration discovered yet. 'offline' is the raid bdev which is not registered
     with bdev as of now and it has encountered any error or user has requested to offline the raid bdev""")
     p.add_argument('category', help='all or online or configuring or offline')
+    p.add_argument('-v', '--verbose', action='store_true',
+                   help='list the raid bdev information and statistics instead of the names')
     p.set_defaults(func=bdev_raid_get_bdevs)
 
     def bdev_raid_create(args):
@@ -1771,7 +2028,7 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                               help='Create new raid bdev')
     p.add_argument('-n', '--name', help='raid bdev name', required=True)
     p.add_argument('-z', '--strip-size-kb', help='strip size in KB', type=int)
-    p.add_argument('-r', '--raid-level', help='raid level, only raid level 0 is supported', required=True)
+    p.add_argument('-r', '--raid-level', help='raid level: raid0, raid1, raid5 or raid6', required=True)
     p.add_argument('-b', '--base-bdevs', help='base bdevs name, whitespace separated list in quotes', required=True)
     p.set_defaults(func=bdev_raid_create)
 
@@ -1783,6 +2040,36 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='raid bdev name')
     p.set_defaults(func=bdev_raid_delete)
 
+    def bdev_raid_add_base_bdev(args):
+        rpc.bdev.bdev_raid_add_base_bdev(args.client,
+                                         raid_bdev=args.raid_bdev,
+                                         base_bdev=args.base_bdev)
+    p = subparsers.add_parser('bdev_raid_add_base_bdev',
+                              help='Add a base bdev to a raid bdev in place of a missing one and rebuild it')
+    p.add_argument('raid_bdev', help='raid bdev name')
+    p.add_argument('base_bdev', help='base bdev name')
+    p.set_defaults(func=bdev_raid_add_base_bdev)
+
+    def bdev_raid_remove_base_bdev(args):
+        rpc.bdev.bdev_raid_remove_base_bdev(args.client,
+                                            name=args.name)
+    p = subparsers.add_parser('bdev_raid_remove_base_bdev',
+                              help='Remove a base bdev from the raid bdev it belongs to')
+    p.add_argument('name', help='base bdev name')
+    p.set_defaults(func=bdev_raid_remove_base_bdev)
+
+    def bdev_raid_set_options(args):
+        rpc.bdev.bdev_raid_set_options(args.client,
+                                       rebuild_window_size_kb=args.rebuild_window_size_kb,
+                                       rebuild_max_bandwidth_mb_sec=args.rebuild_max_bandwidth_mb_sec)
+    p = subparsers.add_parser('bdev_raid_set_options',
+                              help='Set options of the raid bdev module')
+    p.add_argument('-w', '--rebuild-window-size-kb',
+                   help='size of the region of the raid bdev rebuilt at once, in KiB', type=int)
+    p.add_argument('-b', '--rebuild-max-bandwidth-mb-sec',
+                   help='maximum rebuild bandwidth in MiB/s, 0 means no limit', type=int)
+    p.set_defaults(func=bdev_raid_set_options)
+
     # split
     def bdev_split_create(args):
         print_array(rpc.bdev.bdev_split_create(args.client,
@@ -2396,6 +2683,25 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                    help='How often the hotplug is processed for insert and remove events', type=int)
     p.set_defaults(func=bdev_virtio_blk_set_hotplug)
 
+    # accel
+    def accel_set_hw_threshold(args):
+        rpc.accel.accel_set_hw_threshold(args.client, opcode=args.opcode,
+                                         min_bytes=args.min_bytes)
+
+    p = subparsers.add_parser('accel_set_hw_threshold',
+                              help='Set the smallest operation of a given type submitted to the hardware engine.')
+    p.add_argument('opcode', help="""Operation type: copy, fill, compare, crc32c, dualcast, copy_crc32c,
+    xor, pq_gen, compress or decompress""")
+    p.add_argument('min_bytes', help='Smaller operations are done in software', type=int)
+    p.set_defaults(func=accel_set_hw_threshold)
+
+    def accel_get_stats(args):
+        print_dict(rpc.accel.accel_get_stats(args.client))
+
+    p = subparsers.add_parser('accel_get_stats',
+                              help='Display the number of operations and bytes processed by each accel engine.')
+    p.set_defaults(func=accel_get_stats)
+
     # ioat
     def ioat_scan_accel_engine(args):
         rpc.ioat.ioat_scan_accel_engine(args.client)
@@ -0,0 +1,14 @@
+def accel_set_hw_threshold(client, opcode, min_bytes):
+    """Set the smallest operation of a given type submitted to the hardware engine.
+
+    Args:
+        opcode: operation type, e.g. copy, fill, crc32c
+        min_bytes: smaller operations are done in software (0 to always use the hardware engine)
+    """
+    params = {'opcode': opcode, 'min_bytes': min_bytes}
+    return client.call('accel_set_hw_threshold', params)
+
+
+def accel_get_stats(client):
+    """Get the number of operations and bytes processed by each accel engine."""
+    return client.call('accel_get_stats')
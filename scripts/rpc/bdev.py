@@ -3,7 +3,9 @@ from .helpers import deprecated_alias
 
 @deprecated_alias('set_bdev_options')
 def bdev_set_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None, bdev_auto_examine=None,
-                     small_buf_pool_size=None, large_buf_pool_size=None):
+                     small_buf_pool_size=None, large_buf_pool_size=None, bdev_io_pool_size_per_socket=None,
+                     small_buf_pool_size_per_socket=None, large_buf_pool_size_per_socket=None,
+                     numa_pools=None):
     """Set parameters for the bdev subsystem.
 
     Args:
@@ -12,6 +14,10 @@ def bdev_set_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None, bd
         bdev_auto_examine: if set to false, the bdev layer will not examine every disks automatically (optional)
         small_buf_pool_size: maximum number of small buffer (8KB buffer) pool size (optional)
         large_buf_pool_size: maximum number of large buffer (64KB buffer) pool size (optional)
+        bdev_io_pool_size_per_socket: number of bdev_io structures in the pool of each NUMA node (optional)
+        small_buf_pool_size_per_socket: number of small buffers in the pool of each NUMA node (optional)
+        large_buf_pool_size_per_socket: number of large buffers in the pool of each NUMA node (optional)
+        numa_pools: if set to false, a single set of pools is shared by all NUMA nodes (optional)
     """
     params = {}
 
@@ -25,9 +31,26 @@ def bdev_set_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None, bd
         params['small_buf_pool_size'] = small_buf_pool_size
     if large_buf_pool_size:
         params['large_buf_pool_size'] = large_buf_pool_size
+    if bdev_io_pool_size_per_socket:
+        params['bdev_io_pool_size_per_socket'] = bdev_io_pool_size_per_socket
+    if small_buf_pool_size_per_socket:
+        params['small_buf_pool_size_per_socket'] = small_buf_pool_size_per_socket
+    if large_buf_pool_size_per_socket:
+        params['large_buf_pool_size_per_socket'] = large_buf_pool_size_per_socket
+    if numa_pools is not None:
+        params['numa_pools'] = numa_pools
     return client.call('bdev_set_options', params)
 
 
+def bdev_get_pool_stats(client):
+    """Get usage of the bdev_io and data buffer pools of each NUMA node.
+
+    Returns:
+        List of pool usage objects, one per NUMA node.
+    """
+    return client.call('bdev_get_pool_stats')
+
+
 def bdev_examine(client, name):
     """Examine a bdev manually. If the bdev does not exist yet when this RPC is called,
     it will be examined when it is created
@@ -313,16 +336,19 @@ def bdev_null_resize(client, name, new_size):
 
 
 @deprecated_alias('get_raid_bdevs')
-def bdev_raid_get_bdevs(client, category):
+def bdev_raid_get_bdevs(client, category, verbose=None):
     """Get list of raid bdevs based on category
 
     Args:
         category: any one of all or online or configuring or offline
+        verbose: list the raid bdev information and statistics instead of the names (optional)
 
     Returns:
-        List of raid bdev names
+        List of raid bdev names, or of raid bdev information objects if verbose is set
     """
     params = {'category': category}
+    if verbose:
+        params['verbose'] = verbose
     return client.call('bdev_raid_get_bdevs', params)
 
 
@@ -365,6 +391,51 @@ def bdev_raid_delete(client, name):
     return client.call('bdev_raid_delete', params)
 
 
+def bdev_raid_add_base_bdev(client, raid_bdev, base_bdev):
+    """Add a base bdev to a raid bdev in place of a missing one and rebuild it
+
+    Args:
+        raid_bdev: raid bdev name
+        base_bdev: base bdev name
+
+    Returns:
+        None
+    """
+    params = {'raid_bdev': raid_bdev, 'base_bdev': base_bdev}
+    return client.call('bdev_raid_add_base_bdev', params)
+
+
+def bdev_raid_remove_base_bdev(client, name):
+    """Remove a base bdev from the raid bdev it belongs to
+
+    Args:
+        name: base bdev name
+
+    Returns:
+        None
+    """
+    params = {'name': name}
+    return client.call('bdev_raid_remove_base_bdev', params)
+
+
+def bdev_raid_set_options(client, rebuild_window_size_kb=None, rebuild_max_bandwidth_mb_sec=None):
+    """Set options of the raid bdev module
+
+    Args:
+        rebuild_window_size_kb: size of the region of the raid bdev rebuilt at once, in KiB
+        rebuild_max_bandwidth_mb_sec: maximum rebuild bandwidth in MiB/s, 0 means no limit
+
+    Returns:
+        None
+    """
+    params = {}
+    if rebuild_window_size_kb is not None:
+        params['rebuild_window_size_kb'] = rebuild_window_size_kb
+    if rebuild_max_bandwidth_mb_sec is not None:
+        params['rebuild_max_bandwidth_mb_sec'] = rebuild_max_bandwidth_mb_sec
+    return client.call('bdev_raid_set_options', params)
+
+
 @deprecated_alias('construct_aio_bdev')
 def bdev_aio_create(client, filename, name, block_size=None):
     """Construct a Linux AIO block device.
@@ -432,7 +503,8 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
                           keep_alive_timeout_ms=None, retry_count=None, arbitration_burst=None,
                           low_priority_weight=None, medium_priority_weight=None, high_priority_weight=None,
                           nvme_adminq_poll_period_us=None, nvme_ioq_poll_period_us=None, io_queue_requests=None,
-                          delay_cmd_submit=None, transport_retry_count=None, bdev_retry_count=None):
+                          delay_cmd_submit=None, transport_retry_count=None, bdev_retry_count=None,
+                          io_qpair_share_threads=None, io_qpair_promote_iops=None):
     """Set options for the bdev nvme. This is startup command.
 
     Args:
@@ -451,6 +523,8 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
         delay_cmd_submit: Enable delayed NVMe command submission to allow batching of multiple commands (optional)
         transport_retry_count: The number of attempts per I/O in the transport layer when an I/O fails (optional)
         bdev_retry_count: The number of attempts per I/O in the bdev layer when an I/O fails. -1 means infinite retries. (optional)
+        io_qpair_share_threads: The number of threads which share an I/O qpair of a controller. 0 or 1 disables sharing. (optional)
+        io_qpair_promote_iops: IOPS above which a thread moves from a shared to a dedicated I/O qpair. 0 means never. (optional)
     """
     params = {}
 
@@ -500,6 +574,12 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
     if bdev_retry_count is not None:
         params['bdev_retry_count'] = bdev_retry_count
 
+    if io_qpair_share_threads is not None:
+        params['io_qpair_share_threads'] = io_qpair_share_threads
+
+    if io_qpair_promote_iops is not None:
+        params['io_qpair_promote_iops'] = io_qpair_promote_iops
+
     return client.call('bdev_nvme_set_options', params)
 
 
@@ -955,6 +1035,195 @@ def bdev_pmem_delete(client, name):
     return client.call('bdev_pmem_delete', params)
 
 
+def bdev_cache_create(client, base_bdev_name, name, cache_size_mb, line_size=None, num_shards=None,
+                      mode=None):
+    """Construct a DRAM read cache block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        cache_size_mb: size of the cache in MiB
+        line_size: cache line size in bytes (optional)
+        num_shards: number of independently locked cache shards (optional)
+        mode: write handling, "write_through" or "write_invalidate" (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+        'cache_size_mb': cache_size_mb,
+    }
+    if line_size is not None:
+        params['line_size'] = line_size
+    if num_shards is not None:
+        params['num_shards'] = num_shards
+    if mode is not None:
+        params['mode'] = mode
+    return client.call('bdev_cache_create', params)
+
+
+def bdev_cache_delete(client, name):
+    """Remove cache bdev from the system.
+
+    Args:
+        name: name of cache bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_cache_delete', params)
+
+
+def bdev_cache_get_stats(client, name):
+    """Get hit ratio, eviction and memory usage statistics of a cache bdev.
+
+    Args:
+        name: name of cache bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_cache_get_stats', params)
+
+
+def bdev_readahead_create(client, base_bdev_name, name, min_window_kb=None, max_window_kb=None,
+                          buffer_pool_mb=None, max_streams=None):
+    """Construct a readahead block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        min_window_kb: size of the first prefetch of a stream in KiB (optional)
+        max_window_kb: maximum prefetch size in KiB (optional)
+        buffer_pool_mb: memory for prefetched data in MiB (optional)
+        max_streams: number of sequential streams tracked per thread (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+    }
+    if min_window_kb is not None:
+        params['min_window_kb'] = min_window_kb
+    if max_window_kb is not None:
+        params['max_window_kb'] = max_window_kb
+    if buffer_pool_mb is not None:
+        params['buffer_pool_mb'] = buffer_pool_mb
+    if max_streams is not None:
+        params['max_streams'] = max_streams
+    return client.call('bdev_readahead_create', params)
+
+
+def bdev_readahead_delete(client, name):
+    """Remove readahead bdev from the system.
+
+    Args:
+        name: name of readahead bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_readahead_delete', params)
+
+
+def bdev_readahead_get_stats(client, name):
+    """Get prefetch and hit statistics of a readahead bdev.
+
+    Args:
+        name: name of readahead bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_readahead_get_stats', params)
+
+
+def bdev_write_merge_create(client, base_bdev_name, name, merge_window_us=None, max_merge_kb=None):
+    """Construct a write merge block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        merge_window_us: how long writes are held waiting for adjacent writes in microseconds (optional)
+        max_merge_kb: maximum size of a merged write in KiB (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+    }
+    if merge_window_us is not None:
+        params['merge_window_us'] = merge_window_us
+    if max_merge_kb is not None:
+        params['max_merge_kb'] = max_merge_kb
+    return client.call('bdev_write_merge_create', params)
+
+
+def bdev_write_merge_delete(client, name):
+    """Remove write merge bdev from the system.
+
+    Args:
+        name: name of write merge bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_write_merge_delete', params)
+
+
+def bdev_write_merge_get_stats(client, name):
+    """Get merge statistics of a write merge bdev.
+
+    Args:
+        name: name of write merge bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_write_merge_get_stats', params)
+
+
+def bdev_dedup_create(client, base_bdev_name, name, chunk_size=None, logical_size_mb=None,
+                      fingerprint=None):
+    """Construct a dedup block device, or load the one stored on the base bdev.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        chunk_size: block size of the dedup bdev in bytes, the unit of deduplication (optional)
+        logical_size_mb: size of the dedup bdev in MiB, defaults to the space available for data (optional)
+        fingerprint: fingerprint of the data, "sha256" or "crc32c" (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+    }
+    if chunk_size is not None:
+        params['chunk_size'] = chunk_size
+    if logical_size_mb is not None:
+        params['logical_size_mb'] = logical_size_mb
+    if fingerprint is not None:
+        params['fingerprint'] = fingerprint
+    return client.call('bdev_dedup_create', params)
+
+
+def bdev_dedup_delete(client, name):
+    """Remove dedup bdev from the system, keeping its data on the base bdev.
+
+    Args:
+        name: name of dedup bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_dedup_delete', params)
+
+
+def bdev_dedup_get_stats(client, name):
+    """Get deduplication statistics of a dedup bdev.
+
+    Args:
+        name: name of dedup bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_dedup_get_stats', params)
+
+
 @deprecated_alias('construct_passthru_bdev')
 def bdev_passthru_create(client, base_bdev_name, name):
     """Construct a pass-through block device.
@@ -1201,6 +1470,16 @@ def bdev_get_histogram(client, name):
     return client.call('bdev_get_histogram', params)
 
 
+def bdev_get_histogram_percentiles(client, name):
+    """Get latency percentiles by I/O type and size class for specified bdev.
+
+    Args:
+        name: name of bdev
+    """
+    params = {'name': name}
+    return client.call('bdev_get_histogram_percentiles', params)
+
+
 @deprecated_alias('bdev_inject_error')
 def bdev_error_inject_error(client, name, io_type, error_type, num=1):
     """Inject an error via an error bdev.
@@ -1266,6 +1545,71 @@ def bdev_set_qos_limit(
     return client.call('bdev_set_qos_limit', params)
 
 
+def bdev_set_qos_class(client, name, qos_class, weight=None, latency_target_us=None):
+    """Create or update a QoS class on a block device.
+
+    Args:
+        name: name of block device
+        qos_class: name of the QoS class
+        weight: fair-share weight of the class (default: 1)
+        latency_target_us: 99th percentile latency target in microseconds. 0 means none.
+    """
+    params = {'name': name, 'class': qos_class}
+    if weight is not None:
+        params['weight'] = weight
+    if latency_target_us is not None:
+        params['latency_target_us'] = latency_target_us
+    return client.call('bdev_set_qos_class', params)
+
+
+def bdev_delete_qos_class(client, name, qos_class):
+    """Delete a QoS class of a block device.
+
+    Args:
+        name: name of block device
+        qos_class: name of the QoS class
+    """
+    params = {'name': name, 'class': qos_class}
+    return client.call('bdev_delete_qos_class', params)
+
+
+def bdev_get_qos_class_stats(client, name):
+    """Get per-class QoS statistics of a block device.
+
+    Args:
+        name: name of block device
+    """
+    params = {'name': name}
+    return client.call('bdev_get_qos_class_stats', params)
+
+
+def bdev_enable_desc_stats(client, name, enable):
+    """Control per-descriptor I/O statistics on a block device.
+
+    Args:
+        name: name of block device
+        enable: True to enable and reset the statistics, False to disable them
+    """
+    params = {'name': name, 'enable': enable}
+    return client.call('bdev_enable_desc_stats', params)
+
+
+def bdev_get_top_descs(client, name, sort_by=None, count=None):
+    """Get the descriptors of a block device with the highest load since the previous query.
+
+    Args:
+        name: name of block device
+        sort_by: sort descriptors by "iops" or "bandwidth" (optional, default "iops")
+        count: maximum number of descriptors to list, 0 for all (optional, default 10)
+    """
+    params = {'name': name}
+    if sort_by:
+        params['sort_by'] = sort_by
+    if count is not None:
+        params['count'] = count
+    return client.call('bdev_get_top_descs', params)
+
+
 @deprecated_alias('apply_firmware')
 def bdev_nvme_apply_firmware(client, bdev_name, filename):
     """Download and commit firmware to NVMe device.
@@ -1286,6 +1630,35 @@ def bdev_nvme_get_transport_statistics(client):
     return client.call('bdev_nvme_get_transport_statistics')
 
 
+def bdev_nvme_set_multipath_policy(client, name, policy):
+    """Set multipath policy of the NVMe bdev
+
+    Args:
+        name: NVMe bdev name
+        policy: Multipath policy (active_passive, round_robin, queue_depth or latency)
+    """
+
+    params = {'name': name,
+              'policy': policy}
+
+    return client.call('bdev_nvme_set_multipath_policy', params)
+
+
+def bdev_nvme_get_io_paths(client, name=None):
+    """Display I/O paths of NVMe bdevs and their statistics
+
+    Args:
+        name: NVMe bdev name (optional)
+
+    Returns:
+        I/O paths of NVMe bdevs per poll group.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_nvme_get_io_paths', params)
+
+
 def bdev_nvme_get_controller_health_info(client, name):
     """Display health log of the required NVMe bdev controller.
 
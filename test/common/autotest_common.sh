@@ -145,6 +145,8 @@ export SPDK_TEST_NATIVE_DPDK
 export SPDK_AUTOTEST_X
 : ${SPDK_TEST_RAID5=0}
 export SPDK_TEST_RAID5
+: ${SPDK_TEST_RAID6=0}
+export SPDK_TEST_RAID6
 : ${SPDK_TEST_URING=0}
 export SPDK_TEST_URING
 : ${SPDK_TEST_USE_IGB_UIO:=0}
@@ -450,6 +452,10 @@ function get_config_params() {
 		config_params+=' --with-raid5'
 	fi
 
+	if [ $SPDK_TEST_RAID6 -eq 1 ]; then
+		config_params+=' --with-raid6'
+	fi
+
 	if [ $SPDK_TEST_VFIOUSER -eq 1 ]; then
 		config_params+=' --with-vfio-user'
 	fi
@@ -0,0 +1,490 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Mock base bdev shared by the unit tests of virtual bdev modules.  I/O submitted to the base
+ *  bdev are queued and completed by the test.  Include it after ut_multithread.c and the module
+ *  under test, once BLOCK_SIZE, BLOCK_CNT, UT_VBDEV_IO_CTX_SIZE (the driver_ctx size of the
+ *  module) and UT_VBDEV_SUBMIT_REQUEST (its submit_request function) are defined.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/bdev_module.h"
+#include "spdk_internal/mock.h"
+
+#if !defined(BLOCK_SIZE) || !defined(BLOCK_CNT)
+#error "BLOCK_SIZE and BLOCK_CNT of the base bdev must be defined"
+#endif
+
+#if !defined(UT_VBDEV_IO_CTX_SIZE) || !defined(UT_VBDEV_SUBMIT_REQUEST)
+#error "UT_VBDEV_IO_CTX_SIZE and UT_VBDEV_SUBMIT_REQUEST must be defined"
+#endif
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w, const char *name,
+		const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+
+struct ut_base_io {
+	enum spdk_bdev_io_type		type;
+	/* Used by the I/O submitted with a plain buffer */
+	struct iovec			iov;
+	struct iovec			*iovs;
+	int				iovcnt;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	TAILQ_ENTRY(ut_base_io)		link;
+};
+
+TAILQ_HEAD(ut_base_io_list, ut_base_io);
+
+typedef void (*ut_base_io_data_fn)(struct ut_base_io *io);
+typedef void (*ut_vbdev_delete_fn)(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				   void *cb_arg);
+
+struct spdk_bdev g_base_bdev = {
+	.name = "base0",
+	.blocklen = BLOCK_SIZE,
+	.blockcnt = BLOCK_CNT,
+};
+/* Makes opening the base bdev fail with -ENODEV when cleared */
+bool g_base_bdev_present = true;
+int g_base_io_device;
+/* Channel of the virtual bdev, see ut_vbdev_open_channel() */
+struct spdk_io_channel *g_ch;
+struct ut_base_io_list g_base_ios = TAILQ_HEAD_INITIALIZER(g_base_ios);
+uint32_t g_num_base_ios;
+uint32_t g_num_completions;
+/* Called with each base I/O completing successfully, e.g. to move its data */
+ut_base_io_data_fn g_base_io_data_fn;
+int g_delete_rc;
+
+static spdk_bdev_unregister_cb g_unregister_cb;
+static void *g_unregister_cb_arg;
+
+void ut_base_io_fill_lba(struct ut_base_io *io);
+bool ut_check_lba(const uint8_t *buf, uint64_t offset_blocks, uint64_t num_blocks);
+void ut_complete_base_io(bool success);
+void ut_complete_all_base_io(void);
+struct ut_base_io *ut_last_base_io(void);
+struct spdk_bdev_io *ut_submit_buf(struct spdk_bdev *bdev, enum spdk_bdev_io_type type,
+				   uint64_t offset_blocks, uint64_t num_blocks, void *buf);
+struct spdk_bdev_io *ut_submit(struct spdk_bdev *bdev, enum spdk_bdev_io_type type,
+			       uint64_t offset_blocks, uint64_t num_blocks, uint8_t pattern);
+void ut_free_io(struct spdk_bdev_io *bdev_io);
+void ut_vbdev_open_channel(void *io_device);
+void ut_delete_cb(void *cb_arg, int bdeverrno);
+void ut_vbdev_destroy(struct spdk_bdev *bdev, ut_vbdev_delete_fn delete_fn);
+int ut_base_init(void);
+int ut_base_fini(void);
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	if (!g_base_bdev_present || strcmp(bdev_name, g_base_bdev.name) != 0) {
+		return -ENODEV;
+	}
+
+	*_desc = (void *)&g_base_bdev;
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+static int
+ut_base_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_base_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(&g_base_io_device);
+}
+
+/* Modules destructing asynchronously finish the unregistration with spdk_bdev_destruct_done() */
+void
+spdk_bdev_unregister(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	g_unregister_cb = cb_fn;
+	g_unregister_cb_arg = cb_arg;
+	if (bdev->fn_table->destruct(bdev->ctxt) == 0) {
+		spdk_bdev_destruct_done(bdev, 0);
+	}
+}
+
+void
+spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
+{
+	spdk_bdev_unregister_cb cb_fn = g_unregister_cb;
+
+	g_unregister_cb = NULL;
+	if (cb_fn) {
+		cb_fn(g_unregister_cb_arg, bdeverrno);
+	}
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	/* I/O are always submitted with a buffer */
+	cb(g_ch, bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	bdev_io->internal.status = status;
+	g_num_completions++;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static void
+ut_queue_base_io(enum spdk_bdev_io_type type, struct iovec *iovs, int iovcnt,
+		 uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		 void *cb_arg)
+{
+	struct ut_base_io *io = calloc(1, sizeof(*io));
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	CU_ASSERT(offset_blocks + num_blocks <= BLOCK_CNT);
+	io->type = type;
+	io->iovs = iovs;
+	io->iovcnt = iovcnt;
+	io->offset_blocks = offset_blocks;
+	io->num_blocks = num_blocks;
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	TAILQ_INSERT_TAIL(&g_base_ios, io, link);
+	g_num_base_ios++;
+}
+
+static void
+ut_queue_base_io_buf(enum spdk_bdev_io_type type, void *buf, uint64_t offset_blocks,
+		     uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_io *io;
+
+	ut_queue_base_io(type, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	io->iov.iov_base = buf;
+	io->iov.iov_len = num_blocks * BLOCK_SIZE;
+	io->iovs = &io->iov;
+	io->iovcnt = 1;
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_READ, iov, iovcnt, offset_blocks, num_blocks, cb,
+			 cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_WRITE, iov, iovcnt, offset_blocks, num_blocks, cb,
+			 cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		      void *cb_arg)
+{
+	ut_queue_base_io_buf(SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, num_blocks, cb, cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	ut_queue_base_io_buf(SPDK_BDEV_IO_TYPE_WRITE, buf, offset_blocks, num_blocks, cb, cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			      uint64_t offset_blocks, uint64_t num_blocks,
+			      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_WRITE_ZEROES, NULL, 0, offset_blocks, num_blocks, cb,
+			 cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_flush_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_FLUSH, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_reset(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	ut_queue_base_io(SPDK_BDEV_IO_TYPE_RESET, NULL, 0, 0, 0, cb, cb_arg);
+	return 0;
+}
+
+/* Data hook filling every byte of a block read from the base bdev with the low byte of its LBA */
+void
+ut_base_io_fill_lba(struct ut_base_io *io)
+{
+	uint64_t offset = io->offset_blocks * BLOCK_SIZE;
+	uint8_t *buf;
+	size_t len, n;
+	int i;
+
+	if (io->type != SPDK_BDEV_IO_TYPE_READ) {
+		return;
+	}
+
+	for (i = 0; i < io->iovcnt; i++) {
+		buf = io->iovs[i].iov_base;
+		len = io->iovs[i].iov_len;
+		while (len > 0) {
+			n = spdk_min(len, BLOCK_SIZE - offset % BLOCK_SIZE);
+			memset(buf, (int)((offset / BLOCK_SIZE) & 0xff), n);
+			buf += n;
+			len -= n;
+			offset += n;
+		}
+	}
+}
+
+bool
+ut_check_lba(const uint8_t *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t i, j;
+
+	for (i = 0; i < num_blocks; i++) {
+		for (j = 0; j < BLOCK_SIZE; j++) {
+			if (buf[i * BLOCK_SIZE + j] != ((offset_blocks + i) & 0xff)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Complete the oldest I/O submitted to the base bdev */
+void
+ut_complete_base_io(bool success)
+{
+	struct ut_base_io *io = TAILQ_FIRST(&g_base_ios);
+	struct spdk_bdev_io *bdev_io;
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	TAILQ_REMOVE(&g_base_ios, io, link);
+
+	if (success && g_base_io_data_fn != NULL) {
+		g_base_io_data_fn(io);
+	}
+
+	bdev_io = calloc(1, sizeof(*bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	io->cb(bdev_io, success, io->cb_arg);
+	free(io);
+}
+
+void
+ut_complete_all_base_io(void)
+{
+	while (!TAILQ_EMPTY(&g_base_ios)) {
+		ut_complete_base_io(true);
+	}
+}
+
+struct ut_base_io *
+ut_last_base_io(void)
+{
+	return TAILQ_LAST(&g_base_ios, ut_base_io_list);
+}
+
+/* Submit an I/O to the virtual bdev, the buffer is owned by the caller */
+struct spdk_bdev_io *
+ut_submit_buf(struct spdk_bdev *bdev, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	      uint64_t num_blocks, void *buf)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + UT_VBDEV_IO_CTX_SIZE + sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+
+	bdev_io->bdev = bdev;
+	bdev_io->type = type;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	bdev_io->u.bdev.iovs = (struct iovec *)((uint8_t *)bdev_io->driver_ctx +
+						UT_VBDEV_IO_CTX_SIZE);
+	bdev_io->u.bdev.iovs[0].iov_base = buf;
+	bdev_io->u.bdev.iovs[0].iov_len = num_blocks * bdev->blocklen;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	UT_VBDEV_SUBMIT_REQUEST(g_ch, bdev_io);
+
+	return bdev_io;
+}
+
+/* Submit an I/O with a buffer filled with a pattern, free it with ut_free_io() */
+struct spdk_bdev_io *
+ut_submit(struct spdk_bdev *bdev, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	  uint64_t num_blocks, uint8_t pattern)
+{
+	void *buf;
+
+	buf = malloc(num_blocks * bdev->blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, pattern, num_blocks * bdev->blocklen);
+
+	return ut_submit_buf(bdev, type, offset_blocks, num_blocks, buf);
+}
+
+void
+ut_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io->u.bdev.iovs[0].iov_base);
+	free(bdev_io);
+}
+
+void
+ut_vbdev_open_channel(void *io_device)
+{
+	g_ch = spdk_get_io_channel(io_device);
+	SPDK_CU_ASSERT_FATAL(g_ch != NULL);
+	g_num_base_ios = 0;
+	g_num_completions = 0;
+}
+
+void
+ut_delete_cb(void *cb_arg, int bdeverrno)
+{
+	g_delete_rc = bdeverrno;
+}
+
+/* Complete the outstanding base I/O, put the channel and delete the virtual bdev */
+void
+ut_vbdev_destroy(struct spdk_bdev *bdev, ut_vbdev_delete_fn delete_fn)
+{
+	ut_complete_all_base_io();
+	spdk_put_io_channel(g_ch);
+	g_ch = NULL;
+	g_delete_rc = -1;
+	delete_fn(bdev, ut_delete_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_delete_rc == 0);
+}
+
+int
+ut_base_init(void)
+{
+	allocate_threads(1);
+	set_thread(0);
+	spdk_io_device_register(&g_base_io_device, ut_base_ch_create_cb, ut_base_ch_destroy_cb, 0,
+				"base0");
+	return 0;
+}
+
+int
+ut_base_fini(void)
+{
+	spdk_io_device_unregister(&g_base_io_device, NULL);
+	poll_threads();
+	free_threads();
+	return 0;
+}
@@ -129,6 +129,37 @@ histogram_merge(void)
 	spdk_histogram_data_free(h2);
 }
 
+static void
+histogram_percentile(void)
+{
+	struct spdk_histogram_data *h;
+	uint64_t i;
+
+	h = spdk_histogram_data_alloc();
+
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 50) == 0);
+
+	/* Values below 256 get a bucket of their own. */
+	for (i = 1; i <= 100; i++) {
+		spdk_histogram_data_tally(h, i);
+	}
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 0) == 1);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 50) == 50);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 99) == 99);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 99.9) == 100);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 100) == 100);
+
+	/* Larger values are reported as the upper bound of their bucket. */
+	spdk_histogram_data_tally(h, 50000);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 100) >= 50000);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 100) < 50000 + (50000 >> 7));
+
+	spdk_histogram_data_tally(h, UINT64_MAX);
+	CU_ASSERT(spdk_histogram_data_get_percentile(h, 100) == UINT64_MAX);
+
+	spdk_histogram_data_free(h);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -147,7 +178,8 @@ main(int argc, char **argv)
 
 	if (
 		CU_add_test(suite, "histogram_test", histogram_test) == NULL ||
-		CU_add_test(suite, "histogram_merge", histogram_merge) == NULL
+		CU_add_test(suite, "histogram_merge", histogram_merge) == NULL ||
+		CU_add_test(suite, "histogram_percentile", histogram_percentile) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
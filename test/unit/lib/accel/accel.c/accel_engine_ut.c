@@ -39,6 +39,14 @@
 
 DEFINE_STUB(spdk_json_write_array_begin, int, (struct spdk_json_write_ctx *w), 0);
 DEFINE_STUB(spdk_json_write_array_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w, const char *name,
+		const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
 
 /* global vars and setup/cleanup functions used for all test functions */
 struct spdk_accel_engine g_accel_engine = {};
@@ -67,6 +75,7 @@ test_setup(void)
 	g_sw_ch = (struct sw_accel_io_channel *)((char *)g_accel_ch->sw_engine_ch + sizeof(
 				struct spdk_io_channel));
 	TAILQ_INIT(&g_sw_ch->tasks_to_complete);
+	TAILQ_INIT(&g_sw_ch->batches_to_process);
 	return 0;
 }
 
@@ -758,6 +767,764 @@ test_spdk_accel_submit_copy_crc32c(void)
 	CU_ASSERT(expected_accel_task == &task);
 }
 
+static void
+test_spdk_accel_submit_xor(void)
+{
+	const uint64_t nbytes = TEST_SUBMIT_SIZE;
+	uint8_t dst[TEST_SUBMIT_SIZE];
+	uint8_t src1[TEST_SUBMIT_SIZE];
+	uint8_t src2[TEST_SUBMIT_SIZE];
+	uint8_t expected[TEST_SUBMIT_SIZE];
+	void *sources[] = { src1, src2 };
+	void *cb_arg = NULL;
+	int rc, i;
+	struct spdk_accel_task task;
+	struct spdk_accel_task *expected_accel_task = NULL;
+
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		src1[i] = i;
+		src2[i] = 0xa5;
+		expected[i] = i ^ 0xa5;
+	}
+
+	/* Fail with less than 2 sources */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 1, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	task.cb_fn = dummy_submit_cb_fn;
+	task.cb_arg = cb_arg;
+	task.accel_ch = g_accel_ch;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = ACCEL_XOR;
+	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+
+	/* HW accel submission OK. */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.dst == dst);
+	CU_ASSERT(task.nsrcs.srcs == sources);
+	CU_ASSERT(task.nsrcs.cnt == 2);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_XOR);
+	CU_ASSERT(task.nbytes == nbytes);
+	CU_ASSERT(g_dummy_submit_called == true);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	/* Reset values before next case */
+	g_dummy_submit_called = false;
+	g_accel_ch->engine->capabilities = 0;
+	task.dst = 0;
+	task.nsrcs.srcs = NULL;
+	task.nsrcs.cnt = 0;
+	task.op_code = 0xff;
+	task.nbytes = 0;
+	memset(dst, 0, TEST_SUBMIT_SIZE);
+
+	/* SW engine does the XOR. */
+	rc = spdk_accel_submit_xor(g_ch, dst, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.dst == dst);
+	CU_ASSERT(task.nsrcs.srcs == sources);
+	CU_ASSERT(task.nsrcs.cnt == 2);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_XOR);
+	CU_ASSERT(task.nbytes == nbytes);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(g_dummy_submit_cb_called == false);
+	CU_ASSERT(memcmp(dst, expected, TEST_SUBMIT_SIZE) == 0);
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+}
+
+static void
+test_spdk_accel_submit_pq_gen(void)
+{
+	const uint64_t nbytes = TEST_SUBMIT_SIZE;
+	uint8_t p[TEST_SUBMIT_SIZE];
+	uint8_t q[TEST_SUBMIT_SIZE];
+	uint8_t src1[TEST_SUBMIT_SIZE];
+	uint8_t src2[TEST_SUBMIT_SIZE];
+	void *sources[] = { src1, src2 };
+	void *cb_arg = NULL;
+	int rc, i;
+	struct spdk_accel_task task;
+	struct spdk_accel_task *expected_accel_task = NULL;
+
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		src1[i] = i;
+		src2[i] = 0x81;
+	}
+
+	/* Fail with less than 2 sources */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, 1, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -ENOMEM);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	task.cb_fn = dummy_submit_cb_fn;
+	task.cb_arg = cb_arg;
+	task.accel_ch = g_accel_ch;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = ACCEL_PQ_GEN;
+	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+
+	/* HW accel submission OK. */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.dst == p);
+	CU_ASSERT(task.dst2 == q);
+	CU_ASSERT(task.nsrcs.srcs == sources);
+	CU_ASSERT(task.nsrcs.cnt == 2);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_PQ_GEN);
+	CU_ASSERT(task.nbytes == nbytes);
+	CU_ASSERT(g_dummy_submit_called == true);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	/* Reset values before next case */
+	g_dummy_submit_called = false;
+	g_accel_ch->engine->capabilities = 0;
+	task.dst = 0;
+	task.dst2 = 0;
+	task.nsrcs.srcs = NULL;
+	task.nsrcs.cnt = 0;
+	task.op_code = 0xff;
+	task.nbytes = 0;
+
+	/* SW engine does the P+Q generation, Q = src1 ^ 2 * src2 in GF(2^8) */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, 2, nbytes, dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.dst == p);
+	CU_ASSERT(task.dst2 == q);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_PQ_GEN);
+	CU_ASSERT(task.nbytes == nbytes);
+	CU_ASSERT(task.status == 0);
+	CU_ASSERT(g_dummy_submit_cb_called == false);
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		CU_ASSERT(p[i] == (uint8_t)(i ^ 0x81));
+		CU_ASSERT(q[i] == (uint8_t)(i ^ 0x1f));
+	}
+	expected_accel_task = TAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, expected_accel_task, link);
+	CU_ASSERT(expected_accel_task == &task);
+}
+
+#define TEST_BATCH_TASKS 3
+static uint32_t
+batch_get_max_stub(void)
+{
+	return 2;
+}
+
+static int g_batch_cb_order[TEST_BATCH_TASKS];
+static int g_batch_cb_status[TEST_BATCH_TASKS];
+static int g_batch_cb_count;
+static int g_batch_status;
+static bool g_batch_done;
+
+static void
+batch_task_cb(void *cb_arg, int status)
+{
+	CU_ASSERT(g_batch_done == false);
+	SPDK_CU_ASSERT_FATAL(g_batch_cb_count < TEST_BATCH_TASKS);
+	g_batch_cb_order[g_batch_cb_count] = (int)(uintptr_t)cb_arg;
+	g_batch_cb_status[g_batch_cb_count] = status;
+	g_batch_cb_count++;
+}
+
+static void
+batch_cb(void *cb_arg, int status)
+{
+	g_batch_done = true;
+	g_batch_status = status;
+}
+
+static void
+batch_reset(void)
+{
+	memset(g_batch_cb_order, 0, sizeof(g_batch_cb_order));
+	memset(g_batch_cb_status, 0, sizeof(g_batch_cb_status));
+	g_batch_cb_count = 0;
+	g_batch_status = 0;
+	g_batch_done = false;
+}
+
+static void
+batch_setup_pools(struct spdk_accel_task *tasks, int num_tasks, struct spdk_accel_batch *batch)
+{
+	int i;
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	for (i = 0; i < num_tasks; i++) {
+		TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &tasks[i], link);
+	}
+
+	TAILQ_INIT(&g_accel_ch->batch_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->batch_pool, batch, link);
+}
+
+static int
+count_tasks(void)
+{
+	struct spdk_accel_task *task;
+	int count = 0;
+
+	TAILQ_FOREACH(task, &g_accel_ch->task_pool, link) {
+		count++;
+	}
+
+	return count;
+}
+
+static void
+test_spdk_accel_batch_sw(void)
+{
+	struct spdk_accel_task tasks[TEST_BATCH_TASKS] = {};
+	struct spdk_accel_batch _batch = {}, *batch;
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE];
+	uint32_t crc = 0;
+	int rc, i;
+
+	for (i = 0; i < TEST_SUBMIT_SIZE; i++) {
+		src[i] = i;
+	}
+	memset(dst, 0, sizeof(dst));
+	batch_setup_pools(tasks, TEST_BATCH_TASKS, &_batch);
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = 0;
+	g_accel_ch->engine->batch_get_max = NULL;
+	g_accel_ch->engine->submit_batch = NULL;
+	batch_reset();
+
+	CU_ASSERT(spdk_accel_batch_get_max(g_ch) == MAX_OPS_PER_BATCH);
+
+	batch = spdk_accel_batch_create(g_ch);
+	CU_ASSERT(batch == &_batch);
+	/* Only one batch in the pool */
+	CU_ASSERT(spdk_accel_batch_create(g_ch) == NULL);
+
+	/* An empty batch can't be submitted */
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Copy, then CRC-32C and compare of the copy */
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_crc32c(g_ch, batch, &crc, dst, 0, TEST_SUBMIT_SIZE, batch_task_cb,
+					  (void *)2);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_compare(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					   (void *)3);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(batch->count == TEST_BATCH_TASKS);
+	CU_ASSERT(batch->capabilities == (ACCEL_COPY | ACCEL_CRC32C | ACCEL_COMPARE));
+
+	/* Out of tasks */
+	rc = spdk_accel_batch_prep_fill(g_ch, batch, dst, 0, TEST_SUBMIT_SIZE, batch_task_cb, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	/* Nothing is executed or completed before the completion poller runs */
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_batch_cb_count == 0);
+	CU_ASSERT(g_batch_done == false);
+	CU_ASSERT(memcmp(dst, src, TEST_SUBMIT_SIZE) != 0);
+
+	/* A submitted batch can't be changed or cancelled */
+	CU_ASSERT(spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL) == -EINVAL);
+	CU_ASSERT(spdk_accel_batch_cancel(g_ch, batch) == -EINVAL);
+
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == 0);
+	CU_ASSERT(g_batch_cb_count == TEST_BATCH_TASKS);
+	for (i = 0; i < TEST_BATCH_TASKS; i++) {
+		CU_ASSERT(g_batch_cb_order[i] == i + 1);
+		CU_ASSERT(g_batch_cb_status[i] == 0);
+	}
+	CU_ASSERT(memcmp(dst, src, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(crc == spdk_crc32c_update(src, TEST_SUBMIT_SIZE, ~0));
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->batch_pool) == &_batch);
+
+	/* A miscompare doesn't stop the batch */
+	batch_reset();
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_fill(g_ch, batch, dst, 0xa5, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_compare(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					   (void *)2);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == 0);
+	CU_ASSERT(g_batch_cb_count == 2);
+	CU_ASSERT(g_batch_cb_status[0] == 0);
+	CU_ASSERT(g_batch_cb_status[1] != 0);
+	CU_ASSERT(memcmp(dst, src, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+
+	/* Cancel puts the tasks back without calling their callbacks */
+	batch_reset();
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS - 1);
+	rc = spdk_accel_batch_cancel(g_ch, batch);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->batch_pool) == &_batch);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_batch_cb_count == 0);
+	CU_ASSERT(g_batch_done == false);
+
+	/* The batch size is limited by the engine */
+	g_accel_ch->engine->batch_get_max = batch_get_max_stub;
+	CU_ASSERT(spdk_accel_batch_get_max(g_ch) == 2);
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	CU_ASSERT(spdk_accel_batch_prep_copy(g_ch, batch, dst, src, 1, NULL, NULL) == 0);
+	CU_ASSERT(spdk_accel_batch_prep_copy(g_ch, batch, dst, src, 1, NULL, NULL) == 0);
+	CU_ASSERT(spdk_accel_batch_prep_copy(g_ch, batch, dst, src, 1, NULL, NULL) == -EINVAL);
+	CU_ASSERT(spdk_accel_batch_cancel(g_ch, batch) == 0);
+	g_accel_ch->engine->batch_get_max = NULL;
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INIT(&g_accel_ch->batch_pool);
+}
+
+static struct spdk_accel_task *g_hw_task;
+static int
+hw_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *first_task)
+{
+	CU_ASSERT(g_hw_task == NULL);
+	CU_ASSERT(TAILQ_NEXT(first_task, link) == NULL);
+	g_hw_task = first_task;
+	return 0;
+}
+
+static struct spdk_accel_batch *g_hw_batch;
+static int g_hw_submit_batch_rc;
+static int
+hw_submit_batch(struct spdk_io_channel *ch, struct spdk_accel_batch *batch)
+{
+	if (g_hw_submit_batch_rc == 0) {
+		g_hw_batch = batch;
+	}
+	return g_hw_submit_batch_rc;
+}
+
+static void
+test_spdk_accel_batch_hw(void)
+{
+	struct spdk_accel_task tasks[TEST_BATCH_TASKS] = {};
+	struct spdk_accel_task *task;
+	struct spdk_accel_batch _batch = {}, *batch;
+	uint8_t src[TEST_SUBMIT_SIZE], dst[TEST_SUBMIT_SIZE];
+	int rc, i;
+
+	memset(src, 0x5a, sizeof(src));
+	memset(dst, 0, sizeof(dst));
+	batch_setup_pools(tasks, TEST_BATCH_TASKS, &_batch);
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = ACCEL_COPY;
+	g_accel_ch->engine->submit_tasks = hw_submit_tasks;
+	g_accel_ch->engine->batch_get_max = NULL;
+	g_accel_ch->engine->submit_batch = NULL;
+	g_hw_task = NULL;
+	batch_reset();
+
+	/* Without submit_batch, the copy goes to the engine alone, the rest is done
+	 * in software once it completed. A failure cancels the rest of the batch. */
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_fill(g_ch, batch, dst, 0xff, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)2);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)3);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_hw_task == NULL);
+
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_hw_task == &tasks[0]);
+	CU_ASSERT(g_batch_cb_count == 0);
+
+	/* The fill is done in software, the second copy goes to the engine */
+	task = g_hw_task;
+	g_hw_task = NULL;
+	spdk_accel_task_complete(task, 0);
+	CU_ASSERT(g_batch_cb_count == 2);
+	CU_ASSERT(g_hw_task == &tasks[2]);
+	CU_ASSERT(dst[0] == 0xff);
+
+	task = g_hw_task;
+	g_hw_task = NULL;
+	spdk_accel_task_complete(task, -EIO);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == -EIO);
+	CU_ASSERT(g_batch_cb_count == 3);
+	CU_ASSERT(g_batch_cb_status[2] == -EIO);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+
+	/* Failure of the first task cancels the others */
+	batch_reset();
+	memset(dst, 0, sizeof(dst));
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_prep_fill(g_ch, batch, dst, 0xff, TEST_SUBMIT_SIZE, batch_task_cb,
+					(void *)2);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	accel_comp_poll(g_sw_ch);
+	SPDK_CU_ASSERT_FATAL(g_hw_task != NULL);
+	task = g_hw_task;
+	g_hw_task = NULL;
+	spdk_accel_task_complete(task, -EIO);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == -EIO);
+	CU_ASSERT(g_batch_cb_count == 2);
+	CU_ASSERT(g_batch_cb_status[0] == -EIO);
+	CU_ASSERT(g_batch_cb_status[1] == -ECANCELED);
+	CU_ASSERT(dst[0] == 0);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+
+	/* With submit_batch, a batch the engine fully supports is handed over at once */
+	batch_reset();
+	g_accel_ch->engine->submit_batch = hw_submit_batch;
+	g_hw_submit_batch_rc = 0;
+	g_hw_batch = NULL;
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	for (i = 0; i < TEST_BATCH_TASKS; i++) {
+		rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb,
+						(void *)(uintptr_t)(i + 1));
+		CU_ASSERT(rc == 0);
+	}
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_hw_batch == batch);
+	CU_ASSERT(TAILQ_EMPTY(&batch->tasks));
+	for (i = 0; i < TEST_BATCH_TASKS; i++) {
+		spdk_accel_task_complete(&tasks[i], 0);
+	}
+	CU_ASSERT(g_batch_cb_count == TEST_BATCH_TASKS);
+	CU_ASSERT(g_batch_done == false);
+	spdk_accel_batch_complete(batch, 0);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == 0);
+	CU_ASSERT(count_tasks() == TEST_BATCH_TASKS);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->batch_pool) == &_batch);
+
+	/* A batch with tasks the engine doesn't support isn't handed over */
+	batch_reset();
+	g_hw_batch = NULL;
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_fill(g_ch, batch, dst, 0, TEST_SUBMIT_SIZE, batch_task_cb, (void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_hw_batch == NULL);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_cb_count == 1);
+
+	/* The engine can't take the batch, the tasks are submitted one by one */
+	batch_reset();
+	g_hw_submit_batch_rc = -EBUSY;
+	batch = spdk_accel_batch_create(g_ch);
+	SPDK_CU_ASSERT_FATAL(batch != NULL);
+	rc = spdk_accel_batch_prep_copy(g_ch, batch, dst, src, TEST_SUBMIT_SIZE, batch_task_cb, (void *)1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_batch_submit(g_ch, batch, batch_cb, NULL);
+	CU_ASSERT(rc == 0);
+	accel_comp_poll(g_sw_ch);
+	SPDK_CU_ASSERT_FATAL(g_hw_task != NULL);
+	task = g_hw_task;
+	g_hw_task = NULL;
+	spdk_accel_task_complete(task, 0);
+	CU_ASSERT(g_batch_done == true);
+	CU_ASSERT(g_batch_status == 0);
+	CU_ASSERT(g_batch_cb_count == 1);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INIT(&g_accel_ch->batch_pool);
+	g_accel_ch->engine->submit_batch = NULL;
+	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+}
+
+static void
+test_spdk_accel_submit_compress(void)
+{
+	uint8_t src[TEST_SUBMIT_SIZE];
+	uint8_t dst[TEST_SUBMIT_SIZE];
+	struct iovec src_iovs[2] = {
+		{ .iov_base = src, .iov_len = TEST_SUBMIT_SIZE / 2 },
+		{ .iov_base = src + TEST_SUBMIT_SIZE / 2, .iov_len = TEST_SUBMIT_SIZE / 2 },
+	};
+	struct iovec dst_iov = { .iov_base = dst, .iov_len = TEST_SUBMIT_SIZE };
+	uint32_t output_size;
+	void *cb_arg = NULL;
+	int rc;
+	struct spdk_accel_task task;
+
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = ACCEL_COMPRESS | ACCEL_DECOMPRESS;
+	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	TAILQ_INIT(&g_accel_ch->task_pool);
+
+	/* Fail with bad iovs */
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 0, src_iovs, 2, &output_size,
+					dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -EINVAL);
+	rc = spdk_accel_submit_decompress(g_ch, &dst_iov, 1, NULL, 2, &output_size,
+					  dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, src_iovs, 2, &output_size,
+					dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -ENOMEM);
+
+	task.cb_fn = dummy_submit_cb_fn;
+	task.cb_arg = cb_arg;
+	task.accel_ch = g_accel_ch;
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* HW accel submission OK. */
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, src_iovs, 2, &output_size,
+					dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.v.iovs == src_iovs);
+	CU_ASSERT(task.v.iovcnt == 2);
+	CU_ASSERT(task.d.iovs == &dst_iov);
+	CU_ASSERT(task.d.iovcnt == 1);
+	CU_ASSERT(task.output_size == &output_size);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_COMPRESS);
+	CU_ASSERT(g_dummy_submit_called == true);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_dummy_submit_called = false;
+
+	rc = spdk_accel_submit_decompress(g_ch, &dst_iov, 1, src_iovs, 2, &output_size,
+					  dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.v.iovs == src_iovs);
+	CU_ASSERT(task.d.iovs == &dst_iov);
+	CU_ASSERT(task.op_code == ACCEL_OPCODE_DECOMPRESS);
+	CU_ASSERT(g_dummy_submit_called == true);
+
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_dummy_submit_called = false;
+	g_accel_ch->engine->capabilities = 0;
+
+	/* Without a HW engine or ISA-L, (de)compression is not available and
+	 * the task is not consumed. */
+	g_sw_ch->deflate_stream = NULL;
+	rc = spdk_accel_submit_compress(g_ch, &dst_iov, 1, src_iovs, 2, &output_size,
+					dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -ENOTSUP);
+	rc = spdk_accel_submit_decompress(g_ch, &dst_iov, 1, src_iovs, 2, &output_size,
+					  dummy_submit_cb_fn, cb_arg);
+	CU_ASSERT(rc == -ENOTSUP);
+	CU_ASSERT(g_dummy_submit_called == false);
+	CU_ASSERT(TAILQ_FIRST(&g_accel_ch->task_pool) == &task);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+}
+
+static void
+test_spdk_accel_hw_threshold(void)
+{
+	uint8_t dst[TEST_SUBMIT_SIZE];
+	uint8_t src[TEST_SUBMIT_SIZE];
+	struct spdk_accel_task task;
+	enum accel_opcode op_code;
+	int rc;
+
+	memset(g_accel_ch->stats, 0, sizeof(g_accel_ch->stats));
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = ACCEL_COPY;
+	g_accel_ch->engine->submit_tasks = dummy_submit_tasks;
+	g_dummy_submit_called = false;
+
+	/* Only a single operation type can be set. */
+	rc = spdk_accel_set_hw_threshold(ACCEL_COPY | ACCEL_FILL, TEST_SUBMIT_SIZE);
+	CU_ASSERT(rc == -EINVAL);
+	rc = spdk_accel_set_hw_threshold(ACCEL_DIF, TEST_SUBMIT_SIZE);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Below the threshold, the copy is done in software. */
+	rc = spdk_accel_set_hw_threshold(ACCEL_COPY, TEST_SUBMIT_SIZE + 1);
+	CU_ASSERT(rc == 0);
+	memset(src, 0x5a, sizeof(src));
+	memset(dst, 0, sizeof(dst));
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == false);
+	CU_ASSERT(memcmp(dst, src, TEST_SUBMIT_SIZE) == 0);
+	CU_ASSERT(TAILQ_FIRST(&g_sw_ch->tasks_to_complete) == &task);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_SW][ACCEL_OPCODE_MEMMOVE].num_ops == 1);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_SW][ACCEL_OPCODE_MEMMOVE].num_bytes == TEST_SUBMIT_SIZE);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_HW][ACCEL_OPCODE_MEMMOVE].num_ops == 0);
+	TAILQ_REMOVE(&g_sw_ch->tasks_to_complete, &task, link);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+
+	/* At the threshold, it goes to the engine. */
+	rc = spdk_accel_set_hw_threshold(ACCEL_COPY, TEST_SUBMIT_SIZE);
+	CU_ASSERT(rc == 0);
+	rc = spdk_accel_submit_copy(g_ch, dst, src, TEST_SUBMIT_SIZE, dummy_submit_cb_fn, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_dummy_submit_called == true);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_HW][ACCEL_OPCODE_MEMMOVE].num_ops == 1);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_HW][ACCEL_OPCODE_MEMMOVE].num_bytes == TEST_SUBMIT_SIZE);
+	CU_ASSERT(g_accel_ch->stats[ACCEL_PATH_SW][ACCEL_OPCODE_MEMMOVE].num_ops == 1);
+
+	/* Opcode names used by the RPCs */
+	CU_ASSERT(accel_get_opcode_by_name("copy", &op_code) == 0);
+	CU_ASSERT(op_code == ACCEL_OPCODE_MEMMOVE);
+	CU_ASSERT(accel_get_opcode_by_name("pq_gen", &op_code) == 0);
+	CU_ASSERT(op_code == ACCEL_OPCODE_PQ_GEN);
+	CU_ASSERT(accel_get_opcode_by_name("batch", &op_code) == -EINVAL);
+	CU_ASSERT(strcmp(accel_get_opcode_name(ACCEL_OPCODE_COPY_CRC32C), "copy_crc32c") == 0);
+
+	spdk_accel_set_hw_threshold(ACCEL_COPY, 0);
+	g_dummy_submit_called = false;
+	g_accel_ch->engine->capabilities = 0;
+	memset(g_accel_ch->stats, 0, sizeof(g_accel_ch->stats));
+	TAILQ_INIT(&g_accel_ch->task_pool);
+}
+
+static uint32_t g_resubmit_count;
+static uint32_t g_resubmit_cb_count;
+
+static void
+resubmit_cb(void *cb_arg, int status)
+{
+	uint8_t *buf = cb_arg;
+	int rc;
+
+	CU_ASSERT(status == 0);
+	g_resubmit_cb_count++;
+	if (g_resubmit_count > 0) {
+		g_resubmit_count--;
+		rc = spdk_accel_submit_copy(g_ch, buf, buf + TEST_SUBMIT_SIZE, TEST_SUBMIT_SIZE,
+					    resubmit_cb, buf);
+		CU_ASSERT(rc == 0);
+	}
+}
+
+static void
+test_spdk_accel_sw_inline_completion(void)
+{
+	uint8_t buf[TEST_SUBMIT_SIZE * 2] = {};
+	struct spdk_accel_task task;
+	struct spdk_accel_opts opts = {}, saved_opts = {};
+	int rc;
+
+	spdk_accel_get_opts(&saved_opts, sizeof(saved_opts));
+	CU_ASSERT(saved_opts.sw_inline_completion == false);
+	CU_ASSERT(saved_opts.sw_inline_completion_budget > 0);
+
+	/* opts_size is required. */
+	CU_ASSERT(spdk_accel_set_opts(&opts) == -EINVAL);
+	CU_ASSERT(spdk_accel_set_opts(NULL) == -EINVAL);
+
+	TAILQ_INIT(&g_accel_ch->task_pool);
+	TAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	g_accel_ch->engine = &g_accel_engine;
+	g_accel_ch->engine->capabilities = 0;
+
+	/* Default mode: a resubmission from the callback waits for the next poll. */
+	g_resubmit_count = 2;
+	g_resubmit_cb_count = 0;
+	rc = spdk_accel_submit_copy(g_ch, buf, buf + TEST_SUBMIT_SIZE, TEST_SUBMIT_SIZE,
+				    resubmit_cb, buf);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_resubmit_cb_count == 0);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 1);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 2);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 3);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+
+	/* Inline mode: resubmissions complete within the same poll. Callbacks are
+	 * still never called from the submit call itself. */
+	spdk_accel_get_opts(&opts, sizeof(opts));
+	opts.sw_inline_completion = true;
+	opts.sw_inline_completion_budget = 4;
+	rc = spdk_accel_set_opts(&opts);
+	CU_ASSERT(rc == 0);
+
+	g_resubmit_count = 2;
+	g_resubmit_cb_count = 0;
+	rc = spdk_accel_submit_copy(g_ch, buf, buf + TEST_SUBMIT_SIZE, TEST_SUBMIT_SIZE,
+				    resubmit_cb, buf);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_resubmit_cb_count == 0);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 3);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+
+	/* The budget bounds the number of completions in one poll. */
+	g_resubmit_count = 10;
+	g_resubmit_cb_count = 0;
+	rc = spdk_accel_submit_copy(g_ch, buf, buf + TEST_SUBMIT_SIZE, TEST_SUBMIT_SIZE,
+				    resubmit_cb, buf);
+	CU_ASSERT(rc == 0);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 4);
+	CU_ASSERT(!TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 8);
+	accel_comp_poll(g_sw_ch);
+	CU_ASSERT(g_resubmit_cb_count == 11);
+	CU_ASSERT(TAILQ_EMPTY(&g_sw_ch->tasks_to_complete));
+
+	/* A zero budget falls back to the default. */
+	opts.sw_inline_completion_budget = 0;
+	rc = spdk_accel_set_opts(&opts);
+	CU_ASSERT(rc == 0);
+	spdk_accel_get_opts(&opts, sizeof(opts));
+	CU_ASSERT(opts.sw_inline_completion_budget == saved_opts.sw_inline_completion_budget);
+
+	rc = spdk_accel_set_opts(&saved_opts);
+	CU_ASSERT(rc == 0);
+	TAILQ_INIT(&g_accel_ch->task_pool);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -783,6 +1550,13 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32c_hw_engine_unsupported);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32cv);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_copy_crc32c);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_xor);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_pq_gen);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_compress);
+	CU_ADD_TEST(suite, test_spdk_accel_batch_sw);
+	CU_ADD_TEST(suite, test_spdk_accel_batch_hw);
+	CU_ADD_TEST(suite, test_spdk_accel_hw_threshold);
+	CU_ADD_TEST(suite, test_spdk_accel_sw_inline_completion);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
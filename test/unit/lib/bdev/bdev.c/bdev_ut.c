@@ -328,6 +328,7 @@ static bool g_io_types_supported[SPDK_BDEV_NUM_IO_TYPES] = {
 	[SPDK_BDEV_IO_TYPE_WRITE_ZEROES]	= true,
 	[SPDK_BDEV_IO_TYPE_ZCOPY]		= true,
 	[SPDK_BDEV_IO_TYPE_ABORT]		= true,
+	[SPDK_BDEV_IO_TYPE_COPY]		= true,
 };
 
 static void
@@ -3108,6 +3109,34 @@ histogram_io_count(void *ctx, uint64_t start, uint64_t end, uint64_t count,
 	g_count += count;
 }
 
+static uint64_t
+histogram_total_count(const struct spdk_histogram_data *histogram)
+{
+	g_count = 0;
+	spdk_histogram_data_iterate(histogram, histogram_io_count, NULL);
+	return g_count;
+}
+
+static void
+io_type_histograms_cb(void *cb_arg, int status,
+		      const struct spdk_bdev_io_type_histograms *histograms)
+{
+	g_status = status;
+	if (status != 0) {
+		return;
+	}
+
+	/* Count the I/O of each I/O type and size class. Untracked I/O types have no histograms. */
+	CU_ASSERT(histograms->histogram[SPDK_BDEV_IO_TYPE_FLUSH][0] == NULL);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_READ][0]) == 1);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_READ][2]) == 0);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_WRITE][0]) == 1);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_WRITE][1]) == 0);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_WRITE][2]) == 1);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_WRITE][3]) == 0);
+	CU_ASSERT(histogram_total_count(histograms->histogram[SPDK_BDEV_IO_TYPE_UNMAP][3]) == 1);
+}
+
 static void
 bdev_histograms(void)
 {
@@ -3178,6 +3207,25 @@ bdev_histograms(void)
 	spdk_histogram_data_iterate(g_histogram, histogram_io_count, NULL);
 	CU_ASSERT(g_count == 2);
 
+	/* Check the histograms by I/O type and size class: a 32KiB write and a 512KiB unmap */
+	rc = spdk_bdev_write_blocks(desc, ch, NULL, 0, 64, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_unmap_blocks(desc, ch, 0, 1024, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(10);
+	stub_complete_io(2);
+	poll_threads();
+
+	g_status = -1;
+	spdk_bdev_histogram_get_by_io_type(bdev, io_type_histograms_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+
+	CU_ASSERT(spdk_bdev_histogram_get_size_class_limit(0) == 4096);
+	CU_ASSERT(spdk_bdev_histogram_get_size_class_limit(SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES - 1) ==
+		  UINT64_MAX);
+	CU_ASSERT(spdk_bdev_histogram_get_size_class_limit(SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES) == 0);
+
 	/* Disable histogram */
 	spdk_bdev_histogram_enable(bdev, histogram_status_cb, NULL, false);
 	poll_threads();
@@ -3189,6 +3237,10 @@ bdev_histograms(void)
 	poll_threads();
 	CU_ASSERT(g_status == -EFAULT);
 
+	spdk_bdev_histogram_get_by_io_type(bdev, io_type_histograms_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EFAULT);
+
 	spdk_histogram_data_free(histogram);
 	spdk_put_io_channel(ch);
 	spdk_bdev_close(desc);
@@ -3197,6 +3249,177 @@ bdev_histograms(void)
 	poll_threads();
 }
 
+static struct spdk_bdev_desc_stat g_desc_stats[4];
+static char g_desc_stat_labels[4][16];
+static uint32_t g_num_desc_stats;
+
+static void
+desc_stats_cb(void *cb_arg, int status, const struct spdk_bdev_desc_stat *stats,
+	      uint32_t num_stats)
+{
+	uint32_t i;
+
+	g_status = status;
+	g_num_desc_stats = num_stats;
+	SPDK_CU_ASSERT_FATAL(num_stats <= SPDK_COUNTOF(g_desc_stats));
+
+	for (i = 0; i < num_stats; i++) {
+		g_desc_stats[i] = stats[i];
+		g_desc_stats[i].label = NULL;
+		snprintf(g_desc_stat_labels[i], sizeof(g_desc_stat_labels[i]), "%s",
+			 stats[i].label != NULL ? stats[i].label : "");
+	}
+}
+
+static void
+bdev_desc_stats(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc1 = NULL, *desc2 = NULL, *desc3 = NULL;
+	struct spdk_io_channel *ch1, *ch2, *ch3;
+	uint8_t buf[4096];
+	uint64_t desc2_id;
+	int rc;
+
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+
+	bdev = allocate_bdev("bdev");
+
+	rc = spdk_bdev_open_ext("bdev", true, bdev_ut_event_cb, NULL, &desc1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_open_ext("bdev", true, bdev_ut_event_cb, NULL, &desc2);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc1 != NULL && desc2 != NULL);
+	CU_ASSERT(spdk_bdev_desc_set_label(desc1, "host1") == 0);
+
+	ch1 = spdk_bdev_get_io_channel(desc1);
+	ch2 = spdk_bdev_get_io_channel(desc2);
+	SPDK_CU_ASSERT_FATAL(ch1 != NULL && ch2 != NULL);
+
+	/* Nothing is collected until the statistics are enabled */
+	rc = spdk_bdev_write_blocks(desc1, ch1, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	stub_complete_io(1);
+	poll_threads();
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EINVAL);
+
+	g_status = -1;
+	spdk_bdev_desc_stats_enable(bdev, true, histogram_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev->internal.desc_stats_enabled == true);
+
+	/* Outstanding I/O are counted per descriptor */
+	rc = spdk_bdev_write_blocks(desc1, ch1, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc1, ch1, buf, 1, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc2, ch2, buf, 0, 8, io_done, NULL);
+	CU_ASSERT(rc == 0);
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_num_desc_stats == 2);
+	CU_ASSERT(g_desc_stats[0].io_outstanding == 2);
+	CU_ASSERT(g_desc_stats[1].io_outstanding == 1);
+	CU_ASSERT(g_desc_stats[0].stat.num_write_ops == 0);
+	CU_ASSERT(g_desc_stats[0].interval_ops == 0);
+	CU_ASSERT(strcmp(g_desc_stat_labels[0], "host1") == 0);
+	CU_ASSERT(strcmp(g_desc_stat_labels[1], "") == 0);
+	CU_ASSERT(g_desc_stats[0].id != g_desc_stats[1].id);
+
+	spdk_delay_us(10);
+	stub_complete_io(3);
+	poll_threads();
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_num_desc_stats == 2);
+	CU_ASSERT(g_desc_stats[0].io_outstanding == 0);
+	CU_ASSERT(g_desc_stats[0].stat.num_write_ops == 2);
+	CU_ASSERT(g_desc_stats[0].stat.bytes_written == 1024);
+	CU_ASSERT(g_desc_stats[0].stat.write_latency_ticks != 0);
+	CU_ASSERT(g_desc_stats[0].stat.num_read_ops == 0);
+	CU_ASSERT(g_desc_stats[0].interval_ops == 2);
+	CU_ASSERT(g_desc_stats[0].interval_bytes == 1024);
+	CU_ASSERT(g_desc_stats[0].interval_ticks != 0);
+	CU_ASSERT(g_desc_stats[1].io_outstanding == 0);
+	CU_ASSERT(g_desc_stats[1].stat.num_read_ops == 1);
+	CU_ASSERT(g_desc_stats[1].stat.bytes_read == 4096);
+	CU_ASSERT(g_desc_stats[1].interval_bytes == 4096);
+
+	/* The next interval starts where the previous query ended */
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_desc_stats[0].stat.num_write_ops == 2);
+	CU_ASSERT(g_desc_stats[0].interval_ops == 0);
+	CU_ASSERT(g_desc_stats[1].interval_bytes == 0);
+
+	/* A split I/O is accounted once, to its parent */
+	bdev->optimal_io_boundary = 16;
+	bdev->split_on_optimal_io_boundary = true;
+	rc = spdk_bdev_write_blocks(desc2, ch2, buf, 12, 8, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	poll_threads();
+	bdev->split_on_optimal_io_boundary = false;
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_desc_stats[1].io_outstanding == 0);
+	CU_ASSERT(g_desc_stats[1].stat.num_write_ops == 1);
+	CU_ASSERT(g_desc_stats[1].stat.bytes_written == 4096);
+
+	/* A new descriptor reusing the slot of a closed one starts from zero */
+	desc2_id = g_desc_stats[1].id;
+	spdk_put_io_channel(ch2);
+	spdk_bdev_close(desc2);
+	poll_threads();
+
+	rc = spdk_bdev_open_ext("bdev", false, bdev_ut_event_cb, NULL, &desc3);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc3 != NULL);
+	ch3 = spdk_bdev_get_io_channel(desc3);
+	SPDK_CU_ASSERT_FATAL(ch3 != NULL);
+
+	rc = spdk_bdev_read_blocks(desc3, ch3, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	stub_complete_io(1);
+	poll_threads();
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_num_desc_stats == 2);
+	CU_ASSERT(g_desc_stats[1].id != desc2_id);
+	CU_ASSERT(g_desc_stats[1].stat.num_read_ops == 1);
+	CU_ASSERT(g_desc_stats[1].stat.bytes_read == 512);
+	CU_ASSERT(g_desc_stats[1].stat.num_write_ops == 0);
+
+	/* Disable the statistics */
+	spdk_bdev_desc_stats_enable(bdev, false, histogram_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev->internal.desc_stats_enabled == false);
+
+	spdk_bdev_get_desc_stats(bdev, desc_stats_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EINVAL);
+
+	spdk_put_io_channel(ch1);
+	spdk_put_io_channel(ch3);
+	spdk_bdev_close(desc1);
+	spdk_bdev_close(desc3);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+}
+
 static void
 _bdev_compare(bool emulated)
 {
@@ -3499,6 +3722,126 @@ bdev_write_zeroes(void)
 	poll_threads();
 }
 
+static void
+bdev_copy(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *ioch;
+	struct ut_expected_io *expected_io;
+	uint64_t num_io_blocks;
+	uint32_t num_completed;
+	int rc;
+
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	bdev = allocate_bdev("bdev");
+
+	rc = spdk_bdev_open_ext("bdev", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT_EQUAL(rc, 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	ioch = spdk_bdev_get_io_channel(desc);
+	SPDK_CU_ASSERT_FATAL(ioch != NULL);
+
+	fn_table.submit_request = stub_submit_request;
+	g_io_exp_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	/* Native copy is passed to the module as a single request */
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_COPY, 100, 16, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	g_io_done = false;
+	rc = spdk_bdev_copy_blocks(desc, ioch, 100, 0, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, 0);
+	num_completed = stub_complete_io(1);
+	CU_ASSERT_EQUAL(num_completed, 1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Overlapping, empty and out of range copies are rejected */
+	rc = spdk_bdev_copy_blocks(desc, ioch, 8, 0, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_bdev_copy_blocks(desc, ioch, 0, 8, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_bdev_copy_blocks(desc, ioch, 100, 0, 0, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+	rc = spdk_bdev_copy_blocks(desc, ioch, 1020, 0, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, -EINVAL);
+
+	/* Copy larger than max_copy is split */
+	bdev->max_copy = 8;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_COPY, 100, 8, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_COPY, 108, 8, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_COPY, 116, 4, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	g_io_done = false;
+	rc = spdk_bdev_copy_blocks(desc, ioch, 100, 0, 20, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 3);
+	num_completed = stub_complete_io(3);
+	CU_ASSERT_EQUAL(num_completed, 3);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	bdev->max_copy = 0;
+
+	/* Without native support the copy is emulated by bounce-buffered reads and writes,
+	 *  while the bdev keeps reporting copy as unsupported.
+	 */
+	ut_enable_io_type(SPDK_BDEV_IO_TYPE_COPY, false);
+	CU_ASSERT(spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_COPY) == false);
+	fn_table.submit_request = stub_submit_request_get_buf;
+	num_io_blocks = SPDK_BDEV_LARGE_BUF_MAX_SIZE / bdev->blocklen;
+
+	g_io_done = false;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_READ, 0, num_io_blocks, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	rc = spdk_bdev_copy_blocks(desc, ioch, 300, 0, num_io_blocks + 72, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 300, num_io_blocks, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	CU_ASSERT_EQUAL(stub_complete_io(1), 1);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_READ, num_io_blocks, 72, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	CU_ASSERT_EQUAL(stub_complete_io(1), 1);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 300 + num_io_blocks, 72, 0);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	CU_ASSERT_EQUAL(stub_complete_io(1), 1);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT_EQUAL(stub_complete_io(1), 1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_ut_channel->expected_io));
+
+	/* A failed read fails the whole copy */
+	g_io_done = false;
+	g_io_exp_status = SPDK_BDEV_IO_STATUS_FAILED;
+	rc = spdk_bdev_copy_blocks(desc, ioch, 300, 0, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(stub_complete_io(1), 1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	g_io_exp_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	/* No copy at all if reads or writes aren't supported either */
+	ut_enable_io_type(SPDK_BDEV_IO_TYPE_WRITE, false);
+	rc = spdk_bdev_copy_blocks(desc, ioch, 300, 0, 16, io_done, NULL);
+	CU_ASSERT_EQUAL(rc, -ENOTSUP);
+
+	ut_enable_io_type(SPDK_BDEV_IO_TYPE_WRITE, true);
+	ut_enable_io_type(SPDK_BDEV_IO_TYPE_COPY, true);
+	fn_table.submit_request = stub_submit_request;
+	spdk_put_io_channel(ioch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+}
+
 static void
 bdev_zcopy_write(void)
 {
@@ -4725,6 +5068,104 @@ bdev_set_options_test(void)
 	CU_ASSERT(rc == 0);
 }
 
+static void
+bdev_pool_stats_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	struct spdk_bdev_pool_stats stats[2] = {};
+	uint32_t num_stats;
+	int rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 4;
+	bdev_opts.bdev_io_cache_size = 2;
+	bdev_opts.small_buf_pool_size = BUF_SMALL_POOL_SIZE;
+	bdev_opts.large_buf_pool_size = BUF_LARGE_POOL_SIZE;
+
+	/* The per-node sizes have the same minimum as the totals */
+	bdev_opts.small_buf_pool_size_per_socket = BUF_SMALL_POOL_SIZE - 1;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == -1);
+
+	bdev_opts.small_buf_pool_size_per_socket = 0;
+	bdev_opts.bdev_io_pool_size_per_socket = 16;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+
+	MOCK_SET(spdk_env_get_socket_id, 1);
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	poll_threads();
+
+	num_stats = spdk_bdev_get_pool_stats(stats, SPDK_COUNTOF(stats));
+	CU_ASSERT(num_stats == 1);
+	CU_ASSERT(stats[0].socket_id == 1);
+	CU_ASSERT(stats[0].bdev_io_pool_size == 16);
+	CU_ASSERT(stats[0].small_buf_pool_size == BUF_SMALL_POOL_SIZE);
+	CU_ASSERT(stats[0].large_buf_pool_size == BUF_LARGE_POOL_SIZE);
+	CU_ASSERT(stats[0].large_buf_pool_free == BUF_LARGE_POOL_SIZE);
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	/* The management channel fills its cache from the pool */
+	spdk_bdev_get_pool_stats(stats, SPDK_COUNTOF(stats));
+	CU_ASSERT(stats[0].bdev_io_pool_free == 14);
+
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+
+	spdk_bdev_get_pool_stats(stats, SPDK_COUNTOF(stats));
+	CU_ASSERT(stats[0].bdev_io_pool_free == 13);
+
+	stub_complete_io(3);
+
+	/* With a single node nothing is ever taken from a remote pool */
+	spdk_bdev_get_pool_stats(stats, SPDK_COUNTOF(stats));
+	CU_ASSERT(stats[0].bdev_io_pool_free == 14);
+	CU_ASSERT(stats[0].remote_bdev_io_allocs == 0);
+	CU_ASSERT(stats[0].remote_buf_allocs == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+
+	/* Without NUMA pools, a single set of pools sized by the totals serves every node */
+	bdev_opts.numa_pools = false;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	poll_threads();
+
+	num_stats = spdk_bdev_get_pool_stats(stats, SPDK_COUNTOF(stats));
+	CU_ASSERT(num_stats == 1);
+	CU_ASSERT(stats[0].socket_id == (uint32_t)SPDK_ENV_SOCKET_ID_ANY);
+	CU_ASSERT(stats[0].bdev_io_pool_size == 4);
+
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+	MOCK_CLEAR(spdk_env_get_socket_id);
+
+	bdev_opts.bdev_io_pool_size_per_socket = 0;
+	bdev_opts.numa_pools = true;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+}
+
 static uint64_t
 get_ns_time(void)
 {
@@ -4927,7 +5368,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bdev_io_alignment_with_boundary);
 	CU_ADD_TEST(suite, bdev_io_alignment);
 	CU_ADD_TEST(suite, bdev_histograms);
+	CU_ADD_TEST(suite, bdev_desc_stats);
 	CU_ADD_TEST(suite, bdev_write_zeroes);
+	CU_ADD_TEST(suite, bdev_copy);
 	CU_ADD_TEST(suite, bdev_compare_and_write);
 	CU_ADD_TEST(suite, bdev_compare);
 	CU_ADD_TEST(suite, bdev_zcopy_write);
@@ -4944,6 +5387,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bdev_unmap);
 	CU_ADD_TEST(suite, bdev_write_zeroes_split_test);
 	CU_ADD_TEST(suite, bdev_set_options_test);
+	CU_ADD_TEST(suite, bdev_pool_stats_test);
 	CU_ADD_TEST(suite, bdev_multi_allocation);
 	CU_ADD_TEST(suite, bdev_get_memory_domains);
 	CU_ADD_TEST(suite, bdev_writev_readv_ext);
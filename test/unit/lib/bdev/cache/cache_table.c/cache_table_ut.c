@@ -0,0 +1,324 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+
+#include "common/lib/test_env.c"
+#include "bdev/cache/cache_table.c"
+
+#define LINE_SIZE 64
+
+static void
+fill_line(uint8_t *buf, uint64_t tag)
+{
+	memset(buf, (int)(tag & 0xff) + 1, LINE_SIZE);
+}
+
+static void
+insert_line(struct cache_table *table, uint64_t tag)
+{
+	uint8_t buf[LINE_SIZE];
+	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+
+	fill_line(buf, tag);
+	cache_table_insert(table, tag, &iov, 1, 0);
+}
+
+/* Returns true if the line is cached and holds the data written by insert_line() */
+static bool
+line_cached(struct cache_table *table, uint64_t tag)
+{
+	uint8_t buf[LINE_SIZE], expected[LINE_SIZE];
+	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+
+	if (!cache_table_read(table, tag, 0, LINE_SIZE, &iov, 1, 0)) {
+		return false;
+	}
+
+	fill_line(expected, tag);
+	CU_ASSERT(memcmp(buf, expected, LINE_SIZE) == 0);
+
+	return true;
+}
+
+static void
+test_create(void)
+{
+	struct cache_table *table;
+	struct cache_table_stats stats;
+
+	/* Number of shards must be a power of two */
+	CU_ASSERT(cache_table_create(16, LINE_SIZE, 3, 0) == NULL);
+	CU_ASSERT(cache_table_create(16, LINE_SIZE, 0, 0) == NULL);
+	/* Every shard needs at least one line */
+	CU_ASSERT(cache_table_create(2, LINE_SIZE, 4, 0) == NULL);
+
+	/* The remainder of lines not divisible between shards is dropped */
+	table = cache_table_create(18, LINE_SIZE, 4, 0);
+	SPDK_CU_ASSERT_FATAL(table != NULL);
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.num_lines == 16);
+	CU_ASSERT(stats.lines_used == 0);
+	CU_ASSERT(stats.memory_bytes >= 16 * LINE_SIZE);
+	cache_table_free(table);
+}
+
+static void
+test_read_write(void)
+{
+	struct cache_table *table;
+	struct cache_table_stats stats;
+	uint8_t buf[LINE_SIZE * 2], data[LINE_SIZE];
+	struct iovec iovs[2];
+	uint64_t seq;
+
+	table = cache_table_create(8, LINE_SIZE, 1, 0);
+	SPDK_CU_ASSERT_FATAL(table != NULL);
+
+	CU_ASSERT(!line_cached(table, 5));
+	insert_line(table, 5);
+	CU_ASSERT(line_cached(table, 5));
+
+	/* Partial read of a line, scattered over two iovs at an offset */
+	memset(buf, 0, sizeof(buf));
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = 8;
+	iovs[1].iov_base = buf + 8;
+	iovs[1].iov_len = sizeof(buf) - 8;
+	CU_ASSERT(cache_table_read(table, 5, 16, 32, iovs, 2, 4));
+	CU_ASSERT(buf[3] == 0);
+	CU_ASSERT(buf[4] == 6);
+	CU_ASSERT(buf[35] == 6);
+	CU_ASSERT(buf[36] == 0);
+
+	/* Updates only apply to cached lines */
+	memset(data, 0xaa, sizeof(data));
+	iovs[0].iov_base = data;
+	iovs[0].iov_len = sizeof(data);
+	CU_ASSERT(!cache_table_update(table, 6, 0, 16, iovs, 1, 0));
+	CU_ASSERT(!line_cached(table, 6));
+	CU_ASSERT(cache_table_update(table, 5, 8, 16, iovs, 1, 0));
+	memset(buf, 0, sizeof(buf));
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = LINE_SIZE;
+	CU_ASSERT(cache_table_read(table, 5, 0, LINE_SIZE, iovs, 1, 0));
+	CU_ASSERT(buf[7] == 6);
+	CU_ASSERT(buf[8] == 0xaa);
+	CU_ASSERT(buf[23] == 0xaa);
+	CU_ASSERT(buf[24] == 6);
+
+	seq = cache_table_get_seq(table, 5);
+	cache_table_bump_seq(table, 5);
+	CU_ASSERT(cache_table_get_seq(table, 5) == seq + 1);
+
+	cache_table_invalidate(table, 5);
+	CU_ASSERT(!line_cached(table, 5));
+	/* Invalidating a line that isn't cached is a no-op */
+	cache_table_invalidate(table, 5);
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.insertions == 1);
+	CU_ASSERT(stats.invalidations == 1);
+	CU_ASSERT(stats.evictions == 0);
+	CU_ASSERT(stats.lines_used == 0);
+
+	cache_table_free(table);
+}
+
+static void
+test_eviction(void)
+{
+	struct cache_table *table;
+	struct cache_table_stats stats;
+	uint64_t tag;
+
+	/* 8 lines: A1in may hold 2 lines before Am gets evicted, A1out holds 4 tags */
+	table = cache_table_create(8, LINE_SIZE, 1, 0);
+	SPDK_CU_ASSERT_FATAL(table != NULL);
+
+	for (tag = 0; tag < 8; tag++) {
+		insert_line(table, tag);
+	}
+	/* Lines seen once are evicted in FIFO order, 2-5 are kept as ghosts */
+	for (tag = 10; tag < 16; tag++) {
+		insert_line(table, tag);
+	}
+	for (tag = 0; tag < 6; tag++) {
+		CU_ASSERT(!line_cached(table, tag));
+	}
+	CU_ASSERT(line_cached(table, 6));
+	CU_ASSERT(line_cached(table, 15));
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.evictions == 6);
+	CU_ASSERT(stats.ghosts == 4);
+	CU_ASSERT(stats.lines_recent == 8);
+
+	/* A miss on a ghost promotes the line to Am.  Evicts 6, 7, 10 and 11. */
+	for (tag = 2; tag < 6; tag++) {
+		insert_line(table, tag);
+	}
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.ghost_hits == 4);
+	CU_ASSERT(stats.lines_frequent == 4);
+	CU_ASSERT(stats.lines_recent == 4);
+
+	/* Promote 6 and 7 as well, leaving A1in at its target size.  Evicts 12 and 13. */
+	insert_line(table, 6);
+	insert_line(table, 7);
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.lines_frequent == 6);
+	CU_ASSERT(stats.lines_recent == 2);
+
+	/* With A1in small enough, the least recently used Am line goes next.
+	 * Reading 2 makes 3 the LRU one.
+	 */
+	CU_ASSERT(line_cached(table, 2));
+	insert_line(table, 20);
+	CU_ASSERT(!line_cached(table, 3));
+	CU_ASSERT(line_cached(table, 2));
+	CU_ASSERT(line_cached(table, 20));
+	CU_ASSERT(line_cached(table, 14));
+	CU_ASSERT(line_cached(table, 15));
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.lines_used == 8);
+	CU_ASSERT(stats.insertions == 21);
+	CU_ASSERT(stats.evictions == 13);
+
+	cache_table_free(table);
+}
+
+static void
+test_scan_resistance(void)
+{
+	struct cache_table *table;
+	struct cache_table_stats stats;
+	uint64_t tag;
+
+	table = cache_table_create(16, LINE_SIZE, 1, 0);
+	SPDK_CU_ASSERT_FATAL(table != NULL);
+
+	/* Working set of 4 lines, read twice with some other traffic in between */
+	for (tag = 0; tag < 4; tag++) {
+		insert_line(table, tag);
+	}
+	for (tag = 100; tag < 116; tag++) {
+		insert_line(table, tag);
+	}
+	for (tag = 0; tag < 4; tag++) {
+		CU_ASSERT(!line_cached(table, tag));
+		insert_line(table, tag);
+	}
+
+	/* A scan many times the size of the cache */
+	for (tag = 1000; tag < 2000; tag++) {
+		insert_line(table, tag);
+	}
+
+	for (tag = 0; tag < 4; tag++) {
+		CU_ASSERT(line_cached(table, tag));
+	}
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.lines_frequent == 4);
+	CU_ASSERT(stats.lines_recent == 12);
+
+	cache_table_free(table);
+}
+
+static void
+test_shards(void)
+{
+	struct cache_table *table;
+	struct cache_table_stats stats;
+	struct cache_shard *shard;
+	uint64_t tag, seq;
+	uint32_t i;
+
+	table = cache_table_create(64, LINE_SIZE, 4, 0);
+	SPDK_CU_ASSERT_FATAL(table != NULL);
+
+	for (tag = 0; tag < 64; tag++) {
+		insert_line(table, tag);
+	}
+
+	/* Consecutive lines get spread over the shards */
+	for (i = 0; i < 4; i++) {
+		shard = &table->shards[i];
+		CU_ASSERT(shard->queue_len[CACHE_QUEUE_RECENT] > 0);
+	}
+
+	cache_table_get_stats(table, &stats);
+	CU_ASSERT(stats.insertions == 64);
+	CU_ASSERT(stats.lines_used + stats.evictions == 64);
+
+	/* Write sequences are per shard */
+	for (tag = 1; tag < 64; tag++) {
+		if (cache_get_shard(table, tag) != cache_get_shard(table, 0)) {
+			break;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(tag < 64);
+	seq = cache_table_get_seq(table, tag);
+	cache_table_bump_seq(table, 0);
+	CU_ASSERT(cache_table_get_seq(table, tag) == seq);
+
+	cache_table_free(table);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("cache_table", NULL, NULL);
+	CU_ADD_TEST(suite, test_create);
+	CU_ADD_TEST(suite, test_read_write);
+	CU_ADD_TEST(suite, test_eviction);
+	CU_ADD_TEST(suite, test_scan_resistance);
+	CU_ADD_TEST(suite, test_shards);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
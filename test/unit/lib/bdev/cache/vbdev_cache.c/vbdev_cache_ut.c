@@ -0,0 +1,357 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "common/lib/ut_multithread.c"
+#include "bdev/cache/cache_table.c"
+#include "bdev/cache/vbdev_cache.c"
+
+#define BLOCK_SIZE	4096
+#define BLOCK_CNT	(1024 * 1024)
+/* Two blocks per line, so single block I/O only cover half a line */
+#define LINE_SIZE	(2 * BLOCK_SIZE)
+
+#define UT_VBDEV_IO_CTX_SIZE		sizeof(struct cache_bdev_io)
+#define UT_VBDEV_SUBMIT_REQUEST		vbdev_cache_submit_request
+#include "common/lib/ut_base_bdev.c"
+
+static struct vbdev_cache_stats g_stats;
+
+static bool
+ut_check(uint8_t *buf, uint64_t num_blocks, uint8_t pattern)
+{
+	uint64_t i;
+
+	for (i = 0; i < num_blocks * BLOCK_SIZE; i++) {
+		if (buf[i] != pattern) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Submit and complete an I/O, checking whether it was sent to the base bdev. Writes
+ *  write the pattern, reads expect the data of the base bdev.
+ */
+static void
+ut_io(struct spdk_bdev *bdev, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+      uint64_t num_blocks, uint8_t pattern, bool base_io)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint32_t num_base_ios = g_num_base_ios;
+
+	bdev_io = ut_submit(bdev, type, offset_blocks, num_blocks, pattern);
+	CU_ASSERT(g_num_base_ios - num_base_ios == (base_io ? 1 : 0));
+	ut_complete_all_base_io();
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	if (type == SPDK_BDEV_IO_TYPE_READ) {
+		CU_ASSERT(ut_check_lba(bdev_io->u.bdev.iovs[0].iov_base, offset_blocks, num_blocks));
+	}
+	ut_free_io(bdev_io);
+}
+
+/* Read a single block, returns true if it was served from the cache */
+static bool
+ut_read(struct spdk_bdev *bdev, uint64_t offset_blocks, uint8_t pattern)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint32_t num_base_ios = g_num_base_ios;
+
+	/* Fill the buffer with something else, so a hit really has to copy the data */
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1, ~pattern);
+	ut_complete_all_base_io();
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_check(bdev_io->u.bdev.iovs[0].iov_base, 1, pattern));
+	ut_free_io(bdev_io);
+
+	return g_num_base_ios == num_base_ios;
+}
+
+static void
+ut_default_opts(struct vbdev_cache_opts *opts, enum vbdev_cache_mode mode)
+{
+	opts->cache_size_mb = 1;
+	opts->line_size = LINE_SIZE;
+	opts->num_shards = 4;
+	opts->mode = mode;
+}
+
+static struct spdk_bdev *
+ut_create(enum vbdev_cache_mode mode)
+{
+	struct vbdev_cache_opts opts;
+	struct vbdev_cache *cache;
+
+	ut_default_opts(&opts, mode);
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == 0);
+	cache = TAILQ_FIRST(&g_cache_nodes);
+	SPDK_CU_ASSERT_FATAL(cache != NULL);
+
+	ut_vbdev_open_channel(cache);
+
+	return &cache->cache_bdev;
+}
+
+static void
+ut_destroy(struct spdk_bdev *bdev)
+{
+	ut_vbdev_destroy(bdev, bdev_cache_delete_disk);
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_cache_names));
+}
+
+static void
+ut_get_stats_cb(void *cb_arg, int rc, const struct vbdev_cache_stats *stats)
+{
+	CU_ASSERT(rc == 0);
+	g_stats = *stats;
+}
+
+static void
+ut_get_stats(struct spdk_bdev *bdev)
+{
+	memset(&g_stats, 0, sizeof(g_stats));
+	bdev_cache_get_stats(bdev, ut_get_stats_cb, NULL);
+	poll_threads();
+}
+
+static void
+test_create_delete(void)
+{
+	struct vbdev_cache_opts opts;
+	struct spdk_bdev bdev = {};
+
+	/* Invalid options */
+	ut_default_opts(&opts, VBDEV_CACHE_MODE_WRITE_THROUGH);
+	opts.line_size = 3 * BLOCK_SIZE;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.line_size = 256;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.line_size = LINE_SIZE;
+	opts.num_shards = 3;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.num_shards = 1024;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.num_shards = 4;
+	opts.mode = 2;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.mode = VBDEV_CACHE_MODE_WRITE_THROUGH;
+
+	/* Lines smaller than a block and bases with metadata are refused once the base is opened */
+	opts.line_size = BLOCK_SIZE / 2;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EINVAL);
+	opts.line_size = LINE_SIZE;
+	g_base_bdev.md_len = 8;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -ENOTSUP);
+	g_base_bdev.md_len = 0;
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_cache_names));
+
+	/* Creation is deferred until the base bdev shows up */
+	g_base_bdev_present = false;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(!TAILQ_EMPTY(&g_bdev_cache_names));
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == -EEXIST);
+	g_base_bdev_present = true;
+	vbdev_cache_examine(&g_base_bdev);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(TAILQ_FIRST(&g_cache_nodes)->base_bdev == &g_base_bdev);
+	CU_ASSERT(strcmp(TAILQ_FIRST(&g_cache_nodes)->cache_bdev.name, "cache0") == 0);
+	CU_ASSERT(TAILQ_FIRST(&g_cache_nodes)->cache_bdev.blockcnt == BLOCK_CNT);
+
+	/* Hot removal of the base bdev unregisters the cache bdev but remembers its name,
+	 * so it comes back along with the base bdev.
+	 */
+	vbdev_cache_base_bdev_event_cb(SPDK_BDEV_EVENT_REMOVE, &g_base_bdev, NULL);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(!TAILQ_EMPTY(&g_bdev_cache_names));
+	vbdev_cache_examine(&g_base_bdev);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_cache_nodes));
+
+	/* Deleting forgets the name too */
+	g_delete_rc = -1;
+	bdev_cache_delete_disk(&TAILQ_FIRST(&g_cache_nodes)->cache_bdev, ut_delete_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_delete_rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_cache_names));
+
+	/* Only cache bdevs can be deleted */
+	g_delete_rc = -1;
+	bdev_cache_delete_disk(&bdev, ut_delete_cb, NULL);
+	CU_ASSERT(g_delete_rc == -ENODEV);
+	g_delete_rc = -1;
+	bdev_cache_delete_disk(NULL, ut_delete_cb, NULL);
+	CU_ASSERT(g_delete_rc == -ENODEV);
+
+	/* Module teardown frees the names of bdevs still waiting for their base */
+	g_base_bdev_present = false;
+	CU_ASSERT(bdev_cache_create_disk("base0", "cache0", &opts) == 0);
+	g_base_bdev_present = true;
+	vbdev_cache_finish();
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_cache_names));
+}
+
+static void
+test_read_hit_miss(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_CACHE_MODE_WRITE_THROUGH);
+	struct spdk_bdev_io *bdev_io;
+
+	/* The first read of a line goes to the base bdev, the next ones are served from memory */
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 0, 2, 0, true);
+	CU_ASSERT(ut_read(bdev, 0, 0));
+	CU_ASSERT(ut_read(bdev, 1, 1));
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 0, 2, 0, false);
+
+	/* A read is only a hit if all of its lines are cached */
+	CU_ASSERT(!ut_read(bdev, 2, 2));
+	ut_get_stats(bdev);
+	CU_ASSERT(g_stats.read_hits == 3);
+	CU_ASSERT(g_stats.read_misses == 2);
+	CU_ASSERT(g_stats.table.insertions == 1);
+
+	/* Reading half a line doesn't cache it */
+	CU_ASSERT(!ut_read(bdev, 2, 2));
+	CU_ASSERT(!ut_read(bdev, 3, 3));
+
+	/* A failed read isn't cached either */
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, 4, 2, 0);
+	ut_complete_base_io(false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	ut_free_io(bdev_io);
+	ut_get_stats(bdev);
+	CU_ASSERT(g_stats.table.insertions == 1);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_write_through(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_CACHE_MODE_WRITE_THROUGH);
+	struct spdk_bdev_io *read_io, *write_io;
+
+	/* Writes update cached lines, even partially */
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 0, 2, 0, true);
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 1, 1, 0xaa, true);
+	CU_ASSERT(ut_read(bdev, 0, 0));
+	CU_ASSERT(ut_read(bdev, 1, 0xaa));
+
+	/* but don't insert lines that weren't cached */
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 2, 2, 0xbb, true);
+	CU_ASSERT(!ut_read(bdev, 2, 2));
+
+	/* A failed write drops the line, its content on the base bdev is unknown */
+	write_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, 0xcc);
+	ut_complete_base_io(false);
+	CU_ASSERT(write_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	ut_free_io(write_io);
+	CU_ASSERT(!ut_read(bdev, 0, 0));
+
+	/* Unmap and write zeroes invalidate */
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 4, 4, 0, true);
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_UNMAP, 4, 1, 0, true);
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE_ZEROES, 7, 1, 0, true);
+	CU_ASSERT(!ut_read(bdev, 5, 5));
+	CU_ASSERT(!ut_read(bdev, 6, 6));
+
+	/* A write that lands while a read miss is outstanding keeps the read's data out */
+	read_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, 8, 2, 0);
+	write_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_WRITE, 8, 1, 0xdd);
+	ut_complete_all_base_io();
+	CU_ASSERT(read_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(write_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_free_io(read_io);
+	ut_free_io(write_io);
+	CU_ASSERT(!ut_read(bdev, 9, 9));
+
+	ut_destroy(bdev);
+}
+
+static void
+test_write_invalidate(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_CACHE_MODE_WRITE_INVALIDATE);
+
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 0, 4, 0, true);
+	CU_ASSERT(ut_read(bdev, 0, 0));
+	CU_ASSERT(ut_read(bdev, 3, 3));
+
+	/* Writes drop the lines they touch, the others stay cached */
+	ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 1, 1, 0xaa, true);
+	CU_ASSERT(!ut_read(bdev, 0, 0));
+	CU_ASSERT(ut_read(bdev, 3, 3));
+
+	ut_get_stats(bdev);
+	CU_ASSERT(g_stats.table.invalidations == 1);
+
+	ut_destroy(bdev);
+}
+
+static int
+ut_init(void)
+{
+	g_base_io_data_fn = ut_base_io_fill_lba;
+	return ut_base_init();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_cache", ut_init, ut_base_fini);
+	CU_ADD_TEST(suite, test_create_delete);
+	CU_ADD_TEST(suite, test_read_hit_miss);
+	CU_ADD_TEST(suite, test_write_through);
+	CU_ADD_TEST(suite, test_write_invalidate);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,283 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+
+#include "common/lib/test_env.c"
+#include "bdev/dedup/dedup_index.c"
+
+static void
+make_fp(uint8_t *fp, uint32_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < DEDUP_FP_LEN; i++) {
+		fp[i] = (uint8_t)(seed * 31 + i);
+	}
+}
+
+/* Write new data to a logical block, the way the vbdev does on a fingerprint miss */
+static uint32_t
+write_new(struct dedup_index *index, uint64_t lba, uint32_t seed)
+{
+	uint8_t fp[DEDUP_FP_LEN];
+	uint32_t chunk, old_chunk;
+
+	make_fp(fp, seed);
+	chunk = dedup_index_alloc(index);
+	if (chunk == DEDUP_INVALID_CHUNK) {
+		return chunk;
+	}
+
+	dedup_index_insert(index, chunk, fp);
+	dedup_index_map_set(index, lba, 1, &chunk, &old_chunk);
+	dedup_index_put(index, &old_chunk, 1);
+
+	return chunk;
+}
+
+static void
+test_create(void)
+{
+	struct dedup_index *index;
+	struct dedup_index_stats stats;
+
+	CU_ASSERT(dedup_index_create(0, 16) == NULL);
+	CU_ASSERT(dedup_index_create(16, 0) == NULL);
+	CU_ASSERT(dedup_index_create(16, (uint64_t)DEDUP_MAX_CHUNKS + 1) == NULL);
+
+	index = dedup_index_create(32, 16);
+	SPDK_CU_ASSERT_FATAL(index != NULL);
+
+	dedup_index_get_stats(index, &stats);
+	CU_ASSERT(stats.num_logical_chunks == 32);
+	CU_ASSERT(stats.num_physical_chunks == 16);
+	CU_ASSERT(stats.mapped_chunks == 0);
+	CU_ASSERT(stats.used_chunks == 0);
+	CU_ASSERT(stats.indexed_chunks == 0);
+	CU_ASSERT(stats.memory_bytes >= 32 * sizeof(uint32_t) + 16 * sizeof(struct dedup_chunk));
+
+	dedup_index_free(index);
+}
+
+static void
+test_dedup(void)
+{
+	struct dedup_index *index;
+	struct dedup_index_stats stats;
+	uint8_t fp[DEDUP_FP_LEN];
+	uint32_t chunk, chunks[4], old_chunks[4];
+
+	index = dedup_index_create(8, 8);
+	SPDK_CU_ASSERT_FATAL(index != NULL);
+
+	/* Chunks are handed out in ascending order */
+	CU_ASSERT(write_new(index, 0, 1) == 0);
+	CU_ASSERT(write_new(index, 1, 2) == 1);
+
+	/* Same data written to two more blocks is only mapped to the existing chunk */
+	make_fp(fp, 1);
+	chunks[0] = dedup_index_lookup(index, fp);
+	chunks[1] = dedup_index_lookup(index, fp);
+	CU_ASSERT(chunks[0] == 0);
+	CU_ASSERT(chunks[1] == 0);
+	dedup_index_map_set(index, 2, 2, chunks, old_chunks);
+	CU_ASSERT(old_chunks[0] == DEDUP_INVALID_CHUNK);
+	CU_ASSERT(old_chunks[1] == DEDUP_INVALID_CHUNK);
+
+	make_fp(fp, 3);
+	CU_ASSERT(dedup_index_lookup(index, fp) == DEDUP_INVALID_CHUNK);
+
+	dedup_index_get_stats(index, &stats);
+	CU_ASSERT(stats.mapped_chunks == 4);
+	CU_ASSERT(stats.used_chunks == 2);
+	CU_ASSERT(stats.indexed_chunks == 2);
+
+	dedup_index_map_get(index, 0, 4, chunks);
+	CU_ASSERT(chunks[0] == 0);
+	CU_ASSERT(chunks[1] == 1);
+	CU_ASSERT(chunks[2] == 0);
+	CU_ASSERT(chunks[3] == 0);
+	dedup_index_put(index, chunks, 4);
+
+	/* Unmapping some of the blocks sharing chunk 0 keeps it */
+	chunks[0] = DEDUP_INVALID_CHUNK;
+	chunks[1] = DEDUP_INVALID_CHUNK;
+	dedup_index_map_set(index, 2, 2, chunks, old_chunks);
+	CU_ASSERT(old_chunks[0] == 0);
+	CU_ASSERT(old_chunks[1] == 0);
+	dedup_index_put(index, old_chunks, 2);
+
+	make_fp(fp, 1);
+	chunk = dedup_index_lookup(index, fp);
+	CU_ASSERT(chunk == 0);
+	dedup_index_put(index, &chunk, 1);
+
+	/* Overwriting the last block using it frees it and drops it from the index */
+	CU_ASSERT(write_new(index, 0, 4) == 2);
+	CU_ASSERT(dedup_index_lookup(index, fp) == DEDUP_INVALID_CHUNK);
+
+	dedup_index_get_stats(index, &stats);
+	CU_ASSERT(stats.mapped_chunks == 2);
+	CU_ASSERT(stats.used_chunks == 2);
+	CU_ASSERT(stats.indexed_chunks == 2);
+
+	/* The freed chunk is the next one allocated */
+	CU_ASSERT(write_new(index, 5, 5) == 0);
+
+	dedup_index_free(index);
+}
+
+static void
+test_inflight(void)
+{
+	struct dedup_index *index;
+	uint8_t fp[DEDUP_FP_LEN];
+	uint32_t chunk, read_chunk, old_chunk;
+
+	index = dedup_index_create(4, 4);
+	SPDK_CU_ASSERT_FATAL(index != NULL);
+
+	/* A chunk whose data is still being written can't be found */
+	make_fp(fp, 1);
+	chunk = dedup_index_alloc(index);
+	CU_ASSERT(chunk == 0);
+	CU_ASSERT(dedup_index_lookup(index, fp) == DEDUP_INVALID_CHUNK);
+	dedup_index_insert(index, chunk, fp);
+	dedup_index_map_set(index, 0, 1, &chunk, &old_chunk);
+
+	/* A read in progress keeps the chunk from being reused by an overwrite */
+	dedup_index_map_get(index, 0, 1, &read_chunk);
+	CU_ASSERT(read_chunk == 0);
+	CU_ASSERT(write_new(index, 0, 2) == 1);
+	CU_ASSERT(dedup_index_alloc(index) == 2);
+	CU_ASSERT(dedup_index_alloc(index) == 3);
+	CU_ASSERT(dedup_index_alloc(index) == DEDUP_INVALID_CHUNK);
+
+	dedup_index_put(index, &read_chunk, 1);
+	CU_ASSERT(dedup_index_alloc(index) == 0);
+
+	/* Two chunks with the same data: only the first one is indexed */
+	make_fp(fp, 2);
+	chunk = 2;
+	dedup_index_insert(index, chunk, fp);
+	chunk = dedup_index_lookup(index, fp);
+	CU_ASSERT(chunk == 1);
+
+	dedup_index_free(index);
+}
+
+static void
+test_restore(void)
+{
+	struct dedup_index *index;
+	struct dedup_index_stats stats;
+	uint32_t entries[8], copy[8], chunks[8];
+	uint8_t fp[DEDUP_FP_LEN];
+	uint32_t chunk;
+
+	index = dedup_index_create(8, 4);
+	SPDK_CU_ASSERT_FATAL(index != NULL);
+
+	/* Blocks 0 and 5 share chunk 2, block 1 uses chunk 0 */
+	memset(entries, 0, sizeof(entries));
+	to_le32(&entries[0], 3);
+	to_le32(&entries[1], 1);
+	to_le32(&entries[5], 3);
+	CU_ASSERT(dedup_index_map_restore(index, 0, 8, entries) == 0);
+
+	to_le32(&entries[2], 5);
+	CU_ASSERT(dedup_index_map_restore(index, 0, 8, entries) == -EINVAL);
+	to_le32(&entries[2], 0);
+	CU_ASSERT(dedup_index_map_restore(index, 0, 8, entries) == 0);
+	dedup_index_restore_done(index);
+
+	dedup_index_map_copy(index, 0, 8, copy);
+	CU_ASSERT(memcmp(copy, entries, sizeof(entries)) == 0);
+
+	dedup_index_get_stats(index, &stats);
+	CU_ASSERT(stats.mapped_chunks == 3);
+	CU_ASSERT(stats.used_chunks == 2);
+	CU_ASSERT(stats.indexed_chunks == 0);
+
+	/* Free chunks are allocated first */
+	chunks[0] = dedup_index_alloc(index);
+	chunks[1] = dedup_index_alloc(index);
+	CU_ASSERT(chunks[0] == 1);
+	CU_ASSERT(chunks[1] == 3);
+	CU_ASSERT(dedup_index_alloc(index) == DEDUP_INVALID_CHUNK);
+	dedup_index_put(index, chunks, 2);
+
+	/* Restored chunks get indexed in the background */
+	CU_ASSERT(dedup_index_get_unindexed(index, 1) == false);
+	CU_ASSERT(dedup_index_get_unindexed(index, 2) == true);
+	make_fp(fp, 7);
+	dedup_index_insert(index, 2, fp);
+	chunk = 2;
+	dedup_index_put(index, &chunk, 1);
+	CU_ASSERT(dedup_index_get_unindexed(index, 2) == false);
+
+	chunk = dedup_index_lookup(index, fp);
+	CU_ASSERT(chunk == 2);
+	dedup_index_put(index, &chunk, 1);
+
+	dedup_index_get_stats(index, &stats);
+	CU_ASSERT(stats.used_chunks == 2);
+	CU_ASSERT(stats.indexed_chunks == 1);
+
+	dedup_index_free(index);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("dedup_index", NULL, NULL);
+	CU_ADD_TEST(suite, test_create);
+	CU_ADD_TEST(suite, test_dedup);
+	CU_ADD_TEST(suite, test_inflight);
+	CU_ADD_TEST(suite, test_restore);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
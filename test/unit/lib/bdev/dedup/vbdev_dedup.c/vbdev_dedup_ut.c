@@ -0,0 +1,586 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "common/lib/ut_multithread.c"
+#include "bdev/dedup/dedup_index.c"
+#include "bdev/dedup/vbdev_dedup.c"
+
+#define BLOCK_SIZE	512
+#define BLOCK_CNT	(16 * 1024)
+#define CHUNK_SIZE	4096
+/* Chunks of the base bdev, minus the superblock and two map chunks */
+#define NUM_CHUNKS	(BLOCK_CNT * BLOCK_SIZE / CHUNK_SIZE - 3)
+
+#define UT_VBDEV_IO_CTX_SIZE		sizeof(struct dedup_bdev_io)
+#define UT_VBDEV_SUBMIT_REQUEST		vbdev_dedup_submit_request
+#include "common/lib/ut_base_bdev.c"
+
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 64);
+
+static int g_accel_io_device;
+static uint8_t *g_base_data;
+static uint32_t g_num_map_writes;
+static int g_create_rc;
+/* Makes every CRC-32C collide when set */
+static bool g_crc_collide;
+
+static int
+ut_accel_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_accel_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_accel_engine_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_io_device);
+}
+
+/* Completes the operation from within the submit call */
+int
+spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct iovec *iov,
+			  uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	*crc_dst = g_crc_collide ? 0 : spdk_crc32c_iov_update(iov, iovcnt, ~seed);
+	cb_fn(cb_arg, 0);
+	return 0;
+}
+
+/* Data hook moving the data of base I/O to or from the base bdev */
+static void
+ut_base_io_store(struct ut_base_io *io)
+{
+	uint8_t *data = g_base_data + io->offset_blocks * BLOCK_SIZE;
+	int i;
+
+	switch (io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		for (i = 0; i < io->iovcnt; i++) {
+			memcpy(io->iovs[i].iov_base, data, io->iovs[i].iov_len);
+			data += io->iovs[i].iov_len;
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (io->offset_blocks < 3 * CHUNK_SIZE / BLOCK_SIZE && io->offset_blocks > 0) {
+			g_num_map_writes++;
+		}
+		for (i = 0; i < io->iovcnt; i++) {
+			memcpy(data, io->iovs[i].iov_base, io->iovs[i].iov_len);
+			data += io->iovs[i].iov_len;
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		memset(data, 0, io->num_blocks * BLOCK_SIZE);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Run until neither the threads nor the base bdev have anything left to do */
+static void
+ut_run(void)
+{
+	do {
+		poll_threads();
+		while (!TAILQ_EMPTY(&g_base_ios)) {
+			ut_complete_base_io(true);
+		}
+		poll_threads();
+	} while (!TAILQ_EMPTY(&g_base_ios));
+}
+
+/* Submit an I/O, run it to completion and return its status */
+static enum spdk_bdev_io_status
+ut_io(struct spdk_bdev *bdev, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+      uint64_t num_blocks, void *buf)
+{
+	struct spdk_bdev_io *bdev_io;
+	enum spdk_bdev_io_status status;
+
+	bdev_io = ut_submit_buf(bdev, type, offset_blocks, num_blocks, buf);
+	ut_run();
+	status = bdev_io->internal.status;
+	free(bdev_io);
+
+	return status;
+}
+
+static void
+ut_fill(void *buf, uint32_t num_blocks, uint8_t pattern)
+{
+	memset(buf, pattern, (size_t)num_blocks * CHUNK_SIZE);
+}
+
+/* Check that a block reads back filled with a pattern */
+static bool
+ut_check(struct spdk_bdev *bdev, uint64_t offset_blocks, uint8_t pattern)
+{
+	uint8_t buf[CHUNK_SIZE], expected[CHUNK_SIZE];
+
+	memset(buf, ~pattern, sizeof(buf));
+	memset(expected, pattern, sizeof(expected));
+	if (ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1, buf) != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		return false;
+	}
+
+	return memcmp(buf, expected, sizeof(buf)) == 0;
+}
+
+static void
+ut_create_cb(void *cb_arg, int rc)
+{
+	g_create_rc = rc;
+}
+
+static struct spdk_bdev *
+ut_create(enum vbdev_dedup_fingerprint fingerprint, uint64_t logical_size_mb)
+{
+	struct vbdev_dedup_opts opts = {
+		.chunk_size = CHUNK_SIZE,
+		.logical_size_mb = logical_size_mb,
+		.fingerprint = fingerprint,
+	};
+	struct vbdev_dedup *dedup;
+
+	g_create_rc = 1;
+	bdev_dedup_create_disk("base0", "dedup0", &opts, ut_create_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_create_rc == 0);
+	dedup = TAILQ_FIRST(&g_dedup_nodes);
+	SPDK_CU_ASSERT_FATAL(dedup != NULL);
+
+	ut_vbdev_open_channel(dedup);
+	g_num_map_writes = 0;
+
+	return &dedup->dedup_bdev;
+}
+
+static void
+ut_delete(struct spdk_bdev *bdev)
+{
+	spdk_put_io_channel(g_ch);
+	g_ch = NULL;
+	g_delete_rc = -1;
+	bdev_dedup_delete_disk(bdev, ut_delete_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_delete_rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_dedup_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_dedup_names));
+}
+
+static void
+ut_stats_cb(void *cb_arg, int rc, const struct vbdev_dedup_stats *stats)
+{
+	CU_ASSERT(rc == 0);
+	*(struct vbdev_dedup_stats *)cb_arg = *stats;
+}
+
+static struct vbdev_dedup_stats
+ut_stats(struct spdk_bdev *bdev)
+{
+	struct vbdev_dedup_stats stats = {};
+
+	bdev_dedup_get_stats(bdev, ut_stats_cb, &stats);
+	poll_threads();
+
+	return stats;
+}
+
+static void
+test_create_invalid(void)
+{
+	struct vbdev_dedup_opts opts = {
+		.chunk_size = 3000,
+		.fingerprint = VBDEV_DEDUP_FP_SHA256,
+	};
+
+	/* Chunks must be a power of two and a multiple of the base block size */
+	g_create_rc = 0;
+	bdev_dedup_create_disk("base0", "dedup0", &opts, ut_create_cb, NULL);
+	CU_ASSERT(g_create_rc == -EINVAL);
+
+	opts.chunk_size = 256;
+	bdev_dedup_create_disk("base0", "dedup0", &opts, ut_create_cb, NULL);
+	CU_ASSERT(g_create_rc == -EINVAL);
+
+	/* Bdevs with metadata are not supported */
+	opts.chunk_size = CHUNK_SIZE;
+	g_base_bdev.md_len = 8;
+	bdev_dedup_create_disk("base0", "dedup0", &opts, ut_create_cb, NULL);
+	CU_ASSERT(g_create_rc == -ENOTSUP);
+	g_base_bdev.md_len = 0;
+
+	/* More blocks than the base bdev can map */
+	opts.logical_size_mb = 64 * 1024;
+	bdev_dedup_create_disk("base0", "dedup0", &opts, ut_create_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_create_rc == -ENOSPC);
+
+	CU_ASSERT(TAILQ_EMPTY(&g_dedup_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_dedup_names));
+
+	/* Nothing was written to the base bdev */
+	CU_ASSERT(spdk_mem_all_zero(g_base_data, CHUNK_SIZE));
+}
+
+static void
+test_format(void)
+{
+	struct spdk_bdev *bdev;
+	struct vbdev_dedup_stats stats;
+	struct dedup_sb *sb = (struct dedup_sb *)g_base_data;
+
+	bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 0);
+	CU_ASSERT(bdev->blocklen == CHUNK_SIZE);
+	CU_ASSERT(memcmp(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature)) == 0);
+	CU_ASSERT(sb->map_offset == 1);
+	CU_ASSERT(sb->data_offset == 3);
+	CU_ASSERT(sb->num_physical_chunks == NUM_CHUNKS);
+	/* The map of all blocks fits next to that many chunks */
+	CU_ASSERT(bdev->blockcnt == sb->num_logical_chunks);
+	CU_ASSERT(bdev->blockcnt <= NUM_CHUNKS);
+	CU_ASSERT(dedup_map_chunks(bdev->blockcnt, CHUNK_SIZE) == 2);
+
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.num_logical_chunks == bdev->blockcnt);
+	CU_ASSERT(stats.num_physical_chunks == NUM_CHUNKS);
+	CU_ASSERT(stats.mapped_chunks == 0);
+	CU_ASSERT(stats.used_chunks == 0);
+	CU_ASSERT(stats.index_memory_bytes > 0);
+
+	/* Unwritten blocks read as zeroes */
+	CU_ASSERT(ut_check(bdev, 0, 0));
+	CU_ASSERT(ut_check(bdev, bdev->blockcnt - 1, 0));
+
+	ut_delete(bdev);
+
+	/* The requested size is kept on a new format */
+	memset(g_base_data, 0, CHUNK_SIZE);
+	bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 1);
+	CU_ASSERT(bdev->blockcnt == 1024 * 1024 / CHUNK_SIZE);
+	CU_ASSERT(sb->data_offset == 2);
+	ut_delete(bdev);
+
+	memset(g_base_data, 0, CHUNK_SIZE);
+}
+
+static void
+test_dedup(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 0);
+	struct vbdev_dedup_stats stats;
+	uint8_t buf[4 * CHUNK_SIZE];
+
+	/* New data takes a chunk */
+	ut_fill(buf, 1, 0xa5);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	/* The same data elsewhere is only mapped */
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 10, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.write_chunks == 2);
+	CU_ASSERT(stats.duplicate_chunks == 1);
+	CU_ASSERT(stats.mapped_chunks == 2);
+	CU_ASSERT(stats.used_chunks == 1);
+	CU_ASSERT(ut_check(bdev, 0, 0xa5));
+	CU_ASSERT(ut_check(bdev, 10, 0xa5));
+
+	/* Multi-block writes mix new and duplicate chunks */
+	ut_fill(buf, 4, 0xa5);
+	memset(buf + CHUNK_SIZE, 0x5a, CHUNK_SIZE);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 20, 4, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.duplicate_chunks == 4);
+	CU_ASSERT(stats.mapped_chunks == 6);
+	CU_ASSERT(stats.used_chunks == 2);
+
+	memset(buf, 0, sizeof(buf));
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_READ, 20, 4, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(buf[0] == 0xa5 && buf[CHUNK_SIZE] == 0x5a && buf[2 * CHUNK_SIZE] == 0xa5);
+	CU_ASSERT(buf[4 * CHUNK_SIZE - 1] == 0xa5);
+
+	/* Overwriting the last reference frees the chunk once the map is on disk */
+	ut_fill(buf, 1, 0x5a);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 10, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 20, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 22, 2, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.mapped_chunks == 6);
+	CU_ASSERT(stats.used_chunks == 1);
+	CU_ASSERT(ut_check(bdev, 0, 0x5a));
+	CU_ASSERT(ut_check(bdev, 23, 0x5a));
+
+	/* Unmapped blocks read as zeroes and release their chunks */
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_UNMAP, 0, 1, NULL) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE_ZEROES, 10, 14, NULL) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.mapped_chunks == 0);
+	CU_ASSERT(stats.used_chunks == 0);
+	CU_ASSERT(ut_check(bdev, 0, 0));
+	CU_ASSERT(ut_check(bdev, 23, 0));
+
+	ut_delete(bdev);
+	memset(g_base_data, 0, CHUNK_SIZE);
+}
+
+static void
+test_crc32c_verify(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_DEDUP_FP_CRC32C, 0);
+	struct vbdev_dedup_stats stats;
+	uint8_t buf[CHUNK_SIZE];
+
+	/* CRC-32C matches are read back and compared before being mapped */
+	ut_fill(buf, 1, 0x11);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 1, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.verify_reads == 1);
+	CU_ASSERT(stats.verify_mismatches == 0);
+	CU_ASSERT(stats.duplicate_chunks == 1);
+	CU_ASSERT(stats.used_chunks == 1);
+
+	/* A collision with different data gets its own chunk */
+	g_crc_collide = true;
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 2, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_fill(buf, 1, 0x22);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 3, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	g_crc_collide = false;
+
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.verify_reads == 2);
+	CU_ASSERT(stats.verify_mismatches == 1);
+	CU_ASSERT(stats.used_chunks == 3);
+	CU_ASSERT(ut_check(bdev, 2, 0x11));
+	CU_ASSERT(ut_check(bdev, 3, 0x22));
+
+	ut_delete(bdev);
+	memset(g_base_data, 0, CHUNK_SIZE);
+}
+
+static void
+test_crc32c_inline_completion(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_DEDUP_FP_CRC32C, 0);
+	struct spdk_bdev_io *bdev_io;
+	struct vbdev_dedup_stats stats;
+	uint8_t buf[4 * CHUNK_SIZE];
+	int i;
+
+	/* The CRC-32C of each chunk completes from within its submit call. The lookup
+	 * only starts once all of them are computed, so every chunk is indexed by the
+	 * fingerprint of its own data.
+	 */
+	for (i = 0; i < 4; i++) {
+		memset(buf + i * CHUNK_SIZE, 0x31 + i, CHUNK_SIZE);
+	}
+	bdev_io = ut_submit_buf(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 4, buf);
+	ut_run();
+	CU_ASSERT(g_num_completions == 1);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	free(bdev_io);
+
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.write_chunks == 4);
+	CU_ASSERT(stats.duplicate_chunks == 0);
+	CU_ASSERT(stats.verify_reads == 0);
+	CU_ASSERT(stats.used_chunks == 4);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(ut_check(bdev, i, 0x31 + i));
+	}
+
+	/* Writing the same data again finds all of its chunks */
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 8, 4, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.write_chunks == 8);
+	CU_ASSERT(stats.verify_reads == 4);
+	CU_ASSERT(stats.duplicate_chunks == 4);
+	CU_ASSERT(stats.used_chunks == 4);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(ut_check(bdev, 8 + i, 0x31 + i));
+	}
+
+	ut_delete(bdev);
+	memset(g_base_data, 0, CHUNK_SIZE);
+}
+
+static void
+test_map_write_coalesce(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 0);
+	struct spdk_bdev_io *ios[3];
+	uint8_t buf[3][CHUNK_SIZE];
+	int i;
+
+	/* Writes to the same map page wait for a single write of it when one is
+	 * already in progress.
+	 */
+	for (i = 0; i < 3; i++) {
+		ut_fill(buf[i], 1, i + 1);
+		ios[i] = ut_submit_buf(bdev, SPDK_BDEV_IO_TYPE_WRITE, i, 1, buf[i]);
+	}
+	ut_run();
+	CU_ASSERT(g_num_completions == 3);
+	CU_ASSERT(g_num_map_writes == 2);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(ios[i]);
+	}
+
+	/* A failed data write leaves the block as it was */
+	ut_fill(buf[0], 1, 0xee);
+	ios[0] = ut_submit_buf(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, buf[0]);
+	ut_complete_base_io(false);
+	ut_run();
+	CU_ASSERT(ios[0]->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	free(ios[0]);
+	CU_ASSERT(ut_check(bdev, 0, 1));
+	CU_ASSERT(ut_stats(bdev).used_chunks == 3);
+
+	ut_delete(bdev);
+	memset(g_base_data, 0, CHUNK_SIZE);
+}
+
+static void
+test_load(void)
+{
+	struct spdk_bdev *bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 0);
+	struct vbdev_dedup_stats stats;
+	struct spdk_uuid uuid;
+	uint64_t blockcnt;
+	uint8_t buf[CHUNK_SIZE];
+
+	ut_fill(buf, 1, 0x33);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 1000, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_fill(buf, 1, 0x44);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 2, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	blockcnt = bdev->blockcnt;
+	uuid = bdev->uuid;
+	ut_delete(bdev);
+
+	/* The existing bdev is loaded, whatever size is asked for */
+	bdev = ut_create(VBDEV_DEDUP_FP_SHA256, 1);
+	CU_ASSERT(bdev->blockcnt == blockcnt);
+	CU_ASSERT(spdk_uuid_compare(&bdev->uuid, &uuid) == 0);
+	CU_ASSERT(ut_check(bdev, 0, 0x33));
+	CU_ASSERT(ut_check(bdev, 1000, 0x33));
+	CU_ASSERT(ut_check(bdev, 2, 0x44));
+	CU_ASSERT(ut_check(bdev, 1, 0));
+
+	/* The index was rebuilt in the background, so duplicates are found again */
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.mapped_chunks == 3);
+	CU_ASSERT(stats.used_chunks == 2);
+	CU_ASSERT(stats.indexed_chunks == 2);
+	CU_ASSERT(((struct vbdev_dedup *)bdev->ctxt)->scan.poller == NULL);
+
+	ut_fill(buf, 1, 0x44);
+	CU_ASSERT(ut_io(bdev, SPDK_BDEV_IO_TYPE_WRITE, 3, 1, buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stats = ut_stats(bdev);
+	CU_ASSERT(stats.duplicate_chunks == 1);
+	CU_ASSERT(stats.used_chunks == 2);
+	ut_delete(bdev);
+
+	/* A corrupted map is refused rather than formatted over */
+	((uint32_t *)(g_base_data + CHUNK_SIZE))[5] = NUM_CHUNKS + 1;
+	g_create_rc = 0;
+	bdev_dedup_create_disk("base0", "dedup0", &(struct vbdev_dedup_opts) {
+		.chunk_size = CHUNK_SIZE
+	}, ut_create_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_create_rc == -EINVAL);
+	CU_ASSERT(TAILQ_EMPTY(&g_dedup_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_dedup_names));
+
+	memset(g_base_data, 0, (size_t)BLOCK_CNT * BLOCK_SIZE);
+}
+
+static int
+ut_init(void)
+{
+	ut_base_init();
+	g_base_data = calloc(BLOCK_CNT, BLOCK_SIZE);
+	g_base_io_data_fn = ut_base_io_store;
+	spdk_io_device_register(&g_accel_io_device, ut_accel_ch_create_cb, ut_accel_ch_destroy_cb, 0,
+				"accel");
+	return g_base_data == NULL;
+}
+
+static int
+ut_fini(void)
+{
+	spdk_io_device_unregister(&g_accel_io_device, NULL);
+	ut_base_fini();
+	free(g_base_data);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_dedup", ut_init, ut_fini);
+	CU_ADD_TEST(suite, test_create_invalid);
+	CU_ADD_TEST(suite, test_format);
+	CU_ADD_TEST(suite, test_dedup);
+	CU_ADD_TEST(suite, test_crc32c_verify);
+	CU_ADD_TEST(suite, test_crc32c_inline_completion);
+	CU_ADD_TEST(suite, test_map_write_coalesce);
+	CU_ADD_TEST(suite, test_load);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -660,6 +660,7 @@ basic_qos(void)
 	struct spdk_io_channel *io_ch[2];
 	struct spdk_bdev_channel *bdev_ch[2];
 	struct spdk_bdev *bdev;
+	struct spdk_bdev_qos *old_qos;
 	enum spdk_bdev_io_status status, abort_status;
 	int rc;
 
@@ -667,9 +668,8 @@ basic_qos(void)
 
 	/* Enable QoS */
 	bdev = &g_bdev.bdev;
-	bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+	bdev->internal.qos = bdev_qos_alloc();
 	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
-	TAILQ_INIT(&bdev->internal.qos->queued);
 	/*
 	 * Enable read/write IOPS, read only byte per second and
 	 * read/write byte per second rate limits.
@@ -707,20 +707,23 @@ basic_qos(void)
 	poll_threads();
 	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
 
-	/* Send an I/O on thread 1. The QoS thread is not running here. */
+	/*
+	 * Send an I/O on thread 1. The QoS thread is not running here, but QoS is
+	 * enforced on each channel so the I/O is not forwarded to thread 0.
+	 */
 	status = SPDK_BDEV_IO_STATUS_PENDING;
 	set_thread(1);
 	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_PENDING);
 	poll_threads();
-	/* Complete I/O on thread 1. This should not complete the I/O we submitted */
+	/* Complete I/O on thread 0. This should not complete the I/O we submitted */
+	set_thread(0);
 	stub_complete_io(g_bdev.io_target, 0);
 	poll_threads();
 	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_PENDING);
-	/* Now complete I/O on thread 0 */
-	set_thread(0);
-	poll_threads();
+	/* Now complete I/O on thread 1 */
+	set_thread(1);
 	stub_complete_io(g_bdev.io_target, 0);
 	poll_threads();
 	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
@@ -771,9 +774,15 @@ basic_qos(void)
 	 * Close the descriptor only, which should stop the qos channel as
 	 * the last descriptor removed.
 	 */
+	old_qos = bdev->internal.qos;
 	spdk_bdev_close(g_desc);
 	poll_threads();
 	CU_ASSERT(bdev->internal.qos->ch == NULL);
+	/* The channels still reference the old QoS object, it is not freed under them. */
+	CU_ASSERT(bdev->internal.qos != old_qos);
+	CU_ASSERT(bdev_ch[0]->qos == old_qos);
+	CU_ASSERT(bdev_ch[1]->qos == old_qos);
+	CU_ASSERT(old_qos->ref == 2);
 
 	/*
 	 * Open the bdev again which shall setup the qos channel as the
@@ -782,6 +791,9 @@ basic_qos(void)
 	spdk_bdev_open_ext("ut_bdev", true, _bdev_event_cb, NULL, &g_desc);
 	poll_threads();
 	CU_ASSERT(bdev->internal.qos->ch != NULL);
+	CU_ASSERT(bdev_ch[0]->qos == bdev->internal.qos);
+	CU_ASSERT(bdev_ch[1]->qos == bdev->internal.qos);
+	CU_ASSERT(bdev->internal.qos->ref == 3);
 
 	/* Tear down the channels */
 	set_thread(0);
@@ -841,9 +853,8 @@ io_during_qos_queue(void)
 
 	/* Enable QoS */
 	bdev = &g_bdev.bdev;
-	bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+	bdev->internal.qos = bdev_qos_alloc();
 	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
-	TAILQ_INIT(&bdev->internal.qos->queued);
 	/*
 	 * Enable read/write IOPS, read only byte per sec, write only
 	 * byte per sec and read/write byte per sec rate limits.
@@ -882,9 +893,13 @@ io_during_qos_queue(void)
 	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status0);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(status0 == SPDK_BDEV_IO_STATUS_PENDING);
-	/* Send one write I/O */
+	/*
+	 * Send one write I/O. Use thread 1, so it is not queued on thread 0 behind
+	 * the read I/O that is waiting for the read only byte per sec budget.
+	 */
+	set_thread(1);
 	status2 = SPDK_BDEV_IO_STATUS_PENDING;
-	rc = spdk_bdev_write_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status2);
+	rc = spdk_bdev_write_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status2);
 	CU_ASSERT(rc == 0);
 	CU_ASSERT(status2 == SPDK_BDEV_IO_STATUS_PENDING);
 
@@ -944,9 +959,8 @@ io_during_qos_reset(void)
 
 	/* Enable QoS */
 	bdev = &g_bdev.bdev;
-	bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+	bdev->internal.qos = bdev_qos_alloc();
 	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
-	TAILQ_INIT(&bdev->internal.qos->queued);
 	/*
 	 * Enable read/write IOPS, write only byte per sec and
 	 * read/write byte per second rate limits.
@@ -986,9 +1000,13 @@ io_during_qos_reset(void)
 	CU_ASSERT(status1 == SPDK_BDEV_IO_STATUS_PENDING);
 	CU_ASSERT(status0 == SPDK_BDEV_IO_STATUS_PENDING);
 
-	/* Reset the bdev. */
+	/*
+	 * Reset the bdev on thread 1, whose channel holds the I/O sitting at the disk.
+	 * The queued I/O on thread 0 is aborted when its channel is frozen.
+	 */
+	set_thread(1);
 	reset_status = SPDK_BDEV_IO_STATUS_PENDING;
-	rc = spdk_bdev_reset(g_desc, io_ch[0], io_during_io_done, &reset_status);
+	rc = spdk_bdev_reset(g_desc, io_ch[1], io_during_io_done, &reset_status);
 	CU_ASSERT(rc == 0);
 
 	/* Complete any I/O that arrived at the disk */
@@ -1013,6 +1031,99 @@ io_during_qos_reset(void)
 	teardown_test();
 }
 
+static void
+qos_shared_budget(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev_channel *bdev_ch[2];
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status status0, status1, status2;
+	int rc;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+
+	/* Enable QoS with 1000 read/write I/O per second, or 1 per millisecond */
+	bdev = &g_bdev.bdev;
+	bdev->internal.qos = bdev_qos_alloc();
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+	bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].limit = 1000;
+
+	g_get_io_channel = true;
+
+	/* Create channels */
+	set_thread(0);
+	io_ch[0] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[0] = spdk_io_channel_get_ctx(io_ch[0]);
+	CU_ASSERT(bdev_ch[0]->flags == BDEV_CH_QOS_ENABLED);
+
+	set_thread(1);
+	io_ch[1] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[1] = spdk_io_channel_get_ctx(io_ch[1]);
+	CU_ASSERT(bdev_ch[1]->flags == BDEV_CH_QOS_ENABLED);
+
+	/* The first I/O on thread 0 uses up the budget of the timeslice */
+	set_thread(0);
+	status0 = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status0);
+	CU_ASSERT(rc == 0);
+
+	/* The budget is shared, so the I/O on thread 1 is queued on its own channel */
+	set_thread(1);
+	status1 = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status1);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(!TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+
+	set_thread(0);
+	stub_complete_io(g_bdev.io_target, 0);
+	set_thread(1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status0 == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status1 == SPDK_BDEV_IO_STATUS_PENDING);
+
+	/* In the next timeslice the queued I/O is submitted from thread 1 */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+	set_thread(1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status1 == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Budget left unused while idle does not accumulate */
+	spdk_delay_us(10 * SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	status1 = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status1);
+	CU_ASSERT(rc == 0);
+	status2 = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status2);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status1 == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status2 == SPDK_BDEV_IO_STATUS_PENDING);
+
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status2 == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Tear down the channels */
+	set_thread(1);
+	spdk_put_io_channel(io_ch[1]);
+	set_thread(0);
+	spdk_put_io_channel(io_ch[0]);
+	poll_threads();
+
+	teardown_test();
+}
+
 static void
 enomem_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -1461,6 +1572,168 @@ qos_dynamic_enable(void)
 	teardown_test();
 }
 
+static void
+qos_class_stat_cb(void *cb_arg, const struct spdk_bdev_qos_class_stat *stat)
+{
+	struct spdk_bdev_qos_class_stat *stats = cb_arg;
+
+	if (strcmp(stat->name, "gold") == 0) {
+		stats[0] = *stat;
+	} else if (strcmp(stat->name, "bronze") == 0) {
+		stats[1] = *stat;
+	}
+}
+
+static void
+qos_classes(void)
+{
+	struct spdk_io_channel *io_ch, *io_ch2;
+	struct spdk_bdev_desc *desc2 = NULL;
+	struct spdk_bdev_qos_class_stat stats[2];
+	enum spdk_bdev_io_status status[3];
+	struct spdk_bdev *bdev;
+	int i, rc, cb_status;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+	bdev = &g_bdev.bdev;
+
+	/* gold is protected by a 1ms latency target, bronze is not */
+	cb_status = -1;
+	spdk_bdev_set_qos_class(bdev, "gold", 2, 1000, qos_dynamic_enable_done, &cb_status);
+	poll_threads();
+	CU_ASSERT(cb_status == 0);
+	cb_status = -1;
+	spdk_bdev_set_qos_class(bdev, "bronze", 1, 0, qos_dynamic_enable_done, &cb_status);
+	poll_threads();
+	CU_ASSERT(cb_status == 0);
+	cb_status = -1;
+	spdk_bdev_set_qos_class(bdev, "bronze", 0, 0, qos_dynamic_enable_done, &cb_status);
+	CU_ASSERT(cb_status == -EINVAL);
+
+	rc = spdk_bdev_open_ext("ut_bdev", true, _bdev_event_cb, NULL, &desc2);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_desc->qos_class_id >= 0);
+	CU_ASSERT(strcmp(bdev->internal.qos->classes[g_desc->qos_class_id].name, "default") == 0);
+	CU_ASSERT(desc2->qos_class_id >= 0);
+	CU_ASSERT(spdk_bdev_desc_set_qos_class(g_desc, "gold") == 0);
+	CU_ASSERT(spdk_bdev_desc_set_qos_class(desc2, "bronze") == 0);
+	CU_ASSERT(desc2->qos_class_id >= 0);
+	CU_ASSERT(strcmp(bdev->internal.qos->classes[desc2->qos_class_id].name, "bronze") == 0);
+
+	set_thread(0);
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	io_ch2 = spdk_bdev_get_io_channel(desc2);
+	CU_ASSERT(((struct spdk_bdev_channel *)spdk_io_channel_get_ctx(io_ch))->flags ==
+		  BDEV_CH_QOS_ENABLED);
+
+	/* A gold I/O that takes 2ms misses the latency target */
+	status[0] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(2000);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Nothing is throttled until the end of the window */
+	for (i = 0; i < 3; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* At the end of the window bronze gets throttled to its share */
+	spdk_delay_us(SPDK_BDEV_QOS_CLASS_WINDOW_TIMESLICES * SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	memset(stats, 0, sizeof(stats));
+	spdk_bdev_get_qos_class_stats(bdev, qos_class_stat_cb, stats);
+	CU_ASSERT(stats[0].latency_target_missed == true);
+	CU_ASSERT(stats[0].latency_target_us == 1000);
+	CU_ASSERT(stats[0].weight == 2);
+	CU_ASSERT(stats[0].ios_per_sec_limit == 0);
+	CU_ASSERT(stats[0].num_ios == 1);
+	CU_ASSERT(stats[0].num_over_latency_target == 1);
+	CU_ASSERT(stats[1].latency_target_missed == false);
+	CU_ASSERT(stats[1].ios_per_sec_limit == 1000);
+	CU_ASSERT(stats[1].num_ios == 3);
+	CU_ASSERT(stats[1].bytes == 3 * 4096);
+
+	/* Only one bronze I/O per timeslice now, but gold I/O are not held up behind it */
+	for (i = 0; i < 2; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	status[2] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &status[2]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(status[2] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Once gold meets its target and bronze does not use its budget, bronze is released */
+	spdk_delay_us(SPDK_BDEV_QOS_CLASS_WINDOW_TIMESLICES * SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	memset(stats, 0, sizeof(stats));
+	spdk_bdev_get_qos_class_stats(bdev, qos_class_stat_cb, stats);
+	CU_ASSERT(stats[0].latency_target_missed == false);
+	CU_ASSERT(stats[1].ios_per_sec_limit == 0);
+
+	/* The default class cannot go before the others, and deleting bronze unbinds desc2 */
+	CU_ASSERT(spdk_bdev_delete_qos_class(bdev, "silver") == -ENOENT);
+	CU_ASSERT(spdk_bdev_delete_qos_class(bdev, "default") == -EBUSY);
+	CU_ASSERT(spdk_bdev_delete_qos_class(bdev, "bronze") == 0);
+	CU_ASSERT(spdk_bdev_delete_qos_class(bdev, "bronze") == -ENOENT);
+	CU_ASSERT(desc2->qos_class_id == -1);
+	memset(stats, 0, sizeof(stats));
+	spdk_bdev_get_qos_class_stats(bdev, qos_class_stat_cb, stats);
+	CU_ASSERT(stats[0].num_ios == 2);
+	CU_ASSERT(stats[1].name == NULL);
+
+	/* Its I/O are no longer accounted to any class */
+	status[0] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A new class can take the slot of the deleted one */
+	cb_status = -1;
+	spdk_bdev_set_qos_class(bdev, "silver", 1, 0, qos_dynamic_enable_done, &cb_status);
+	poll_threads();
+	CU_ASSERT(cb_status == 0);
+	CU_ASSERT(spdk_bdev_desc_set_qos_class(desc2, "silver") == 0);
+	CU_ASSERT(desc2->qos_class_id >= 0);
+	CU_ASSERT(bdev->internal.qos->classes[desc2->qos_class_id].num_ios == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_put_io_channel(io_ch2);
+	poll_threads();
+	spdk_bdev_close(desc2);
+	poll_threads();
+
+	teardown_test();
+}
+
 static void
 histogram_status_cb(void *cb_arg, int status)
 {
@@ -1974,10 +2247,12 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, io_during_reset);
 	CU_ADD_TEST(suite, io_during_qos_queue);
 	CU_ADD_TEST(suite, io_during_qos_reset);
+	CU_ADD_TEST(suite, qos_shared_budget);
 	CU_ADD_TEST(suite, enomem);
 	CU_ADD_TEST(suite, enomem_multi_bdev);
 	CU_ADD_TEST(suite, enomem_multi_io_target);
 	CU_ADD_TEST(suite, qos_dynamic_enable);
+	CU_ADD_TEST(suite, qos_classes);
 	CU_ADD_TEST(suite, bdev_histograms_mt);
 	CU_ADD_TEST(suite, bdev_set_io_timeout_mt);
 	CU_ADD_TEST(suite, lock_lba_range_then_submit_io);
@@ -1009,6 +1009,15 @@ spdk_nvme_ns_cmd_write_zeroes(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *q
 	return ut_submit_nvme_request(ns, qpair, SPDK_NVME_OPC_WRITE_ZEROES, cb_fn, cb_arg);
 }
 
+int
+spdk_nvme_ns_cmd_copy(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+		      const struct spdk_nvme_scc_source_range *ranges,
+		      uint16_t num_ranges, uint64_t dest_lba,
+		      spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return ut_submit_nvme_request(ns, qpair, SPDK_NVME_OPC_COPY, cb_fn, cb_arg);
+}
+
 struct spdk_nvme_poll_group *
 spdk_nvme_poll_group_create(void *ctx, struct spdk_nvme_accel_fn_table *table)
 {
@@ -1136,6 +1145,45 @@ spdk_bdev_unregister(struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn, void
 	}
 }
 
+static void
+ut_find_bdev_by_name(struct nvme_bdev_ctrlr *nbdev_ctrlr, void *ctx)
+{
+	struct spdk_bdev **bdev = ctx;
+	struct nvme_bdev *nbdev;
+
+	TAILQ_FOREACH(nbdev, &nbdev_ctrlr->bdevs, tailq) {
+		if (strcmp(nbdev->disk.name, (*bdev)->name) == 0) {
+			*bdev = &nbdev->disk;
+			return;
+		}
+	}
+}
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **desc)
+{
+	struct spdk_bdev tmp = { .name = (char *)bdev_name };
+	struct spdk_bdev *bdev = &tmp;
+
+	nvme_bdev_ctrlr_for_each(ut_find_bdev_by_name, &bdev);
+	if (bdev == &tmp) {
+		return -ENODEV;
+	}
+
+	*desc = (struct spdk_bdev_desc *)bdev;
+
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (struct spdk_bdev *)desc;
+}
+
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+
 int
 spdk_bdev_notify_blockcnt_change(struct spdk_bdev *bdev, uint64_t size)
 {
@@ -2061,6 +2109,9 @@ test_submit_nvme_cmd(void)
 	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_COMPARE);
 	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_UNMAP);
 
+	bdev_io->u.bdev.copy.src_offset_blocks = bdev_io->u.bdev.offset_blocks + 1;
+	ut_test_submit_nvme_cmd(ch, bdev_io, SPDK_BDEV_IO_TYPE_COPY);
+
 	ut_test_submit_nop(ch, bdev_io, SPDK_BDEV_IO_TYPE_FLUSH);
 
 	ut_test_submit_fused_nvme_cmd(ch, bdev_io);
@@ -3488,6 +3539,14 @@ test_admin_path(void)
 	CU_ASSERT(nvme_bdev_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static int g_ut_mp_policy_rc;
+
+static void
+ut_set_multipath_policy_done(void *cb_arg, int rc)
+{
+	g_ut_mp_policy_rc = rc;
+}
+
 static struct nvme_io_path *
 ut_get_io_path_by_ctrlr(struct nvme_bdev_channel *nbdev_ch,
 			struct nvme_ctrlr *nvme_ctrlr)
@@ -3807,6 +3866,398 @@ test_find_io_path(void)
 	nbdev_ch.current_io_path = NULL;
 }
 
+static void
+test_find_io_path_multipath(void)
+{
+	struct nvme_bdev_channel nbdev_ch = {
+		.io_path_list = STAILQ_HEAD_INITIALIZER(nbdev_ch.io_path_list),
+	};
+	struct nvme_ctrlr_channel ctrlr_ch1 = {}, ctrlr_ch2 = {};
+	struct nvme_ns nvme_ns1 = {}, nvme_ns2 = {};
+	struct nvme_io_path io_path1 = { .ctrlr_ch = &ctrlr_ch1, .nvme_ns = &nvme_ns1, };
+	struct nvme_io_path io_path2 = { .ctrlr_ch = &ctrlr_ch2, .nvme_ns = &nvme_ns2, };
+	int count1, count2, i;
+
+	STAILQ_INSERT_TAIL(&nbdev_ch.io_path_list, &io_path1, stailq);
+	STAILQ_INSERT_TAIL(&nbdev_ch.io_path_list, &io_path2, stailq);
+
+	ctrlr_ch1.qpair = (struct spdk_nvme_qpair *)0x1;
+	nvme_ns1.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	ctrlr_ch2.qpair = (struct spdk_nvme_qpair *)0x1;
+	nvme_ns2.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+
+	/* Round robin should alternate between the two optimized paths. */
+	nbdev_ch.mp_policy = BDEV_NVME_MP_POLICY_ROUND_ROBIN;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+
+	/* Optimized paths are preferred to non-optimized paths. */
+	nvme_ns2.ana_state = SPDK_NVME_ANA_NON_OPTIMIZED_STATE;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* Non-optimized paths are used in turn if no optimized path is available. */
+	nvme_ns1.ana_state = SPDK_NVME_ANA_NON_OPTIMIZED_STATE;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* Unavailable paths are excluded. */
+	ctrlr_ch1.qpair = NULL;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+
+	ctrlr_ch2.qpair = NULL;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == NULL);
+
+	ctrlr_ch1.qpair = (struct spdk_nvme_qpair *)0x1;
+	nvme_ns1.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	ctrlr_ch2.qpair = (struct spdk_nvme_qpair *)0x1;
+	nvme_ns2.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+
+	/* Queue depth should choose the path which has the fewest outstanding I/Os. */
+	nbdev_ch.mp_policy = BDEV_NVME_MP_POLICY_QUEUE_DEPTH;
+
+	io_path1.io_outstanding = 2;
+	io_path2.io_outstanding = 1;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+
+	io_path2.io_outstanding = 3;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* Ties are broken in turn. */
+	io_path1.io_outstanding = 0;
+	io_path2.io_outstanding = 0;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* Latency should prefer a path without any sample, and then spread I/Os
+	 * in proportion to the inverse of the average latency.
+	 */
+	nbdev_ch.mp_policy = BDEV_NVME_MP_POLICY_LATENCY;
+
+	io_path1.avg_latency_ticks = 100;
+	io_path2.avg_latency_ticks = 0;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+
+	io_path1.lat_credit = 0;
+	io_path2.lat_credit = 0;
+	io_path2.avg_latency_ticks = 300;
+
+	count1 = 0;
+	count2 = 0;
+	for (i = 0; i < 400; i++) {
+		if (bdev_nvme_find_io_path(&nbdev_ch) == &io_path1) {
+			count1++;
+		} else {
+			count2++;
+		}
+	}
+	CU_ASSERT(count1 == 300);
+	CU_ASSERT(count2 == 100);
+
+	/* Active-passive should keep using the cached path. */
+	nbdev_ch.mp_policy = BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE;
+	nbdev_ch.current_io_path = NULL;
+
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	nbdev_ch.current_io_path = NULL;
+}
+
+static void
+test_set_multipath_policy(void)
+{
+	struct nvme_path_id path1 = {}, path2 = {};
+	struct spdk_nvme_ctrlr *ctrlr1, *ctrlr2;
+	struct nvme_bdev_ctrlr *nbdev_ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr1, *nvme_ctrlr2;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct nvme_bdev *bdev;
+	struct spdk_bdev_io *bdev_io1, *bdev_io2;
+	struct spdk_io_channel *ch;
+	struct nvme_bdev_channel *nbdev_ch;
+	struct nvme_io_path *io_path1, *io_path2;
+	int rc;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&path1.trid);
+	ut_init_trid2(&path2.trid);
+
+	set_thread(0);
+
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	ctrlr1 = ut_attach_ctrlr(&path1.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr1 != NULL);
+
+	memset(&ctrlr1->ns[0].uuid, 1, sizeof(struct spdk_uuid));
+
+	rc = bdev_nvme_create(&path1.trid, "nvme0", attached_names, STRING_SIZE, 0,
+			      attach_ctrlr_done, NULL, NULL, true);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	ctrlr2 = ut_attach_ctrlr(&path2.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr2 != NULL);
+
+	memset(&ctrlr2->ns[0].uuid, 1, sizeof(struct spdk_uuid));
+
+	rc = bdev_nvme_create(&path2.trid, "nvme0", attached_names, STRING_SIZE, 0,
+			      attach_ctrlr_done, NULL, NULL, true);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	nbdev_ctrlr = nvme_bdev_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nbdev_ctrlr != NULL);
+
+	nvme_ctrlr1 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path1.trid);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr1 != NULL);
+
+	nvme_ctrlr2 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path2.trid);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr2 != NULL);
+
+	bdev = nvme_bdev_ctrlr_get_bdev(nbdev_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(bdev != NULL);
+
+	ch = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	nbdev_ch = spdk_io_channel_get_ctx(ch);
+	CU_ASSERT(nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE);
+
+	io_path1 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr1);
+	SPDK_CU_ASSERT_FATAL(io_path1 != NULL);
+
+	io_path2 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr2);
+	SPDK_CU_ASSERT_FATAL(io_path2 != NULL);
+
+	/* Unknown bdev should be rejected. */
+	g_ut_mp_policy_rc = 0;
+	bdev_nvme_set_multipath_policy("nvme1n1", BDEV_NVME_MP_POLICY_ROUND_ROBIN,
+				       ut_set_multipath_policy_done, NULL);
+	CU_ASSERT(g_ut_mp_policy_rc == -ENODEV);
+
+	/* The policy should be applied to the existing channel. */
+	g_ut_mp_policy_rc = -1;
+	bdev_nvme_set_multipath_policy(bdev->disk.name, BDEV_NVME_MP_POLICY_ROUND_ROBIN,
+				       ut_set_multipath_policy_done, NULL);
+	poll_threads();
+	CU_ASSERT(g_ut_mp_policy_rc == 0);
+	CU_ASSERT(bdev->mp_policy == BDEV_NVME_MP_POLICY_ROUND_ROBIN);
+	CU_ASSERT(nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ROUND_ROBIN);
+
+	/* Two I/Os should be submitted to different paths, and be accounted
+	 * to the path which processed each of them.
+	 */
+	bdev_io1 = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_WRITE, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io1);
+
+	bdev_io2 = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_WRITE, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io2);
+
+	bdev_io1->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io1);
+
+	bdev_io2->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io2);
+
+	CU_ASSERT(io_path1->ctrlr_ch->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(io_path2->ctrlr_ch->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(io_path1->io_outstanding == 1);
+	CU_ASSERT(io_path2->io_outstanding == 1);
+
+	poll_threads();
+
+	CU_ASSERT(bdev_io1->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io1->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_io2->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io2->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(io_path1->io_outstanding == 0);
+	CU_ASSERT(io_path2->io_outstanding == 0);
+	CU_ASSERT(io_path1->num_ios == 1);
+	CU_ASSERT(io_path2->num_ios == 1);
+	CU_ASSERT(io_path1->bytes == bdev_io1->u.bdev.num_blocks * bdev->disk.blocklen);
+	CU_ASSERT(io_path2->bytes == bdev_io2->u.bdev.num_blocks * bdev->disk.blocklen);
+
+	/* Restoring active-passive should use a single path again. */
+	g_ut_mp_policy_rc = -1;
+	bdev_nvme_set_multipath_policy(bdev->disk.name, BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE,
+				       ut_set_multipath_policy_done, NULL);
+	poll_threads();
+	CU_ASSERT(g_ut_mp_policy_rc == 0);
+	CU_ASSERT(nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE);
+	CU_ASSERT(nbdev_ch->current_io_path == NULL);
+
+	free(bdev_io1);
+	free(bdev_io2);
+
+	spdk_put_io_channel(ch);
+
+	poll_threads();
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_bdev_ctrlr_get_by_name("nvme0") == NULL);
+}
+
+static void
+test_shared_qpair(void)
+{
+	struct nvme_path_id path = {};
+	struct spdk_nvme_ctrlr *ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct nvme_bdev *bdev;
+	struct spdk_bdev_io *bdev_io;
+	struct spdk_io_channel *ch1, *ch2;
+	struct nvme_bdev_channel *nbdev_ch1, *nbdev_ch2;
+	struct nvme_ctrlr_channel *ctrlr_ch1, *ctrlr_ch2;
+	struct nvme_shared_qpair *sq;
+	int rc;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&path.trid);
+
+	g_opts.io_qpair_share_threads = 2;
+
+	set_thread(0);
+
+	ctrlr = ut_attach_ctrlr(&path.trid, 1, false, false);
+	SPDK_CU_ASSERT_FATAL(ctrlr != NULL);
+
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	rc = bdev_nvme_create(&path.trid, "nvme0", attached_names, STRING_SIZE, 0,
+			      attach_ctrlr_done, NULL, NULL, false);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+
+	nvme_ctrlr = nvme_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr != NULL);
+
+	bdev = nvme_ctrlr_get_ns(nvme_ctrlr, 1)->bdev;
+	SPDK_CU_ASSERT_FATAL(bdev != NULL);
+
+	/* The first thread creates a qpair and offers it to other threads. */
+	ch1 = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch1 != NULL);
+
+	nbdev_ch1 = spdk_io_channel_get_ctx(ch1);
+	ctrlr_ch1 = ut_get_io_path_by_ctrlr(nbdev_ch1, nvme_ctrlr)->ctrlr_ch;
+	SPDK_CU_ASSERT_FATAL(ctrlr_ch1->qpair != NULL);
+	CU_ASSERT(ctrlr_ch1->shared_qpair == NULL);
+
+	sq = TAILQ_FIRST(&nvme_ctrlr->shared_qpairs);
+	SPDK_CU_ASSERT_FATAL(sq != NULL);
+	CU_ASSERT(sq->owner_ch == ctrlr_ch1);
+	CU_ASSERT(sq->num_members == 0);
+
+	/* The second thread joins the shared qpair instead of creating a qpair. */
+	set_thread(1);
+
+	ch2 = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch2 != NULL);
+
+	nbdev_ch2 = spdk_io_channel_get_ctx(ch2);
+	ctrlr_ch2 = ut_get_io_path_by_ctrlr(nbdev_ch2, nvme_ctrlr)->ctrlr_ch;
+	CU_ASSERT(ctrlr_ch2->qpair == NULL);
+	CU_ASSERT(ctrlr_ch2->shared_qpair == sq);
+	CU_ASSERT(sq->num_members == 1);
+
+	/* I/O of the second thread is submitted by the first thread and completed
+	 * on the second thread.
+	 */
+	bdev_io = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_WRITE, bdev, ch2);
+	ut_bdev_io_set_buf(bdev_io);
+	bdev_io->internal.in_submit_request = true;
+
+	bdev_nvme_submit_request(ch2, bdev_io);
+	CU_ASSERT(ctrlr_ch1->qpair->num_outstanding_reqs == 0);
+
+	poll_thread_times(1, 1);
+	CU_ASSERT(ctrlr_ch1->qpair->num_outstanding_reqs == 0);
+
+	poll_thread_times(0, 1);
+	CU_ASSERT(ctrlr_ch1->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(bdev_io->internal.in_submit_request == true);
+
+	poll_thread_times(1, 1);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* The second thread gets its own qpair once its IOPS exceeds the threshold. */
+	g_opts.io_qpair_promote_iops = 1;
+	ctrlr_ch2->shared_num_ios = 9;
+	ctrlr_ch2->shared_window_tsc = spdk_get_ticks();
+	spdk_delay_us(spdk_get_ticks_hz());
+
+	bdev_io->internal.in_submit_request = true;
+
+	bdev_nvme_submit_request(ch2, bdev_io);
+	SPDK_CU_ASSERT_FATAL(ctrlr_ch2->qpair != NULL);
+	CU_ASSERT(ctrlr_ch2->shared_qpair == NULL);
+	CU_ASSERT(ctrlr_ch2->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(sq->num_members == 0);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	free(bdev_io);
+
+	spdk_put_io_channel(ch2);
+
+	set_thread(0);
+
+	/* The shared qpair is freed after the first thread stops using it. */
+	spdk_put_io_channel(ch1);
+
+	poll_threads();
+
+	CU_ASSERT(TAILQ_EMPTY(&nvme_ctrlr->shared_qpairs));
+
+	g_opts.io_qpair_share_threads = 0;
+	g_opts.io_qpair_promote_iops = 0;
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_bdev_ctrlr_get_by_name("nvme0") == NULL);
+}
+
 static void
 test_retry_io_if_ctrlr_is_resetting(void)
 {
@@ -5088,6 +5539,9 @@ main(int argc, const char **argv)
 	CU_ADD_TEST(suite, test_retry_admin_passthru_if_ctrlr_is_resetting);
 	CU_ADD_TEST(suite, test_retry_admin_passthru_for_path_error);
 	CU_ADD_TEST(suite, test_retry_admin_passthru_by_count);
+	CU_ADD_TEST(suite, test_find_io_path_multipath);
+	CU_ADD_TEST(suite, test_set_multipath_policy);
+	CU_ADD_TEST(suite, test_shared_qpair);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
@@ -59,14 +59,22 @@ spdk_scsi_nvme_translate(const struct spdk_bdev_io *bdev_io,
 {
 }
 
+static int
+ut_module_init(void)
+{
+	return 0;
+}
+
 struct spdk_bdev_module bdev_ut_if = {
 	.name = "bdev_ut",
+	.module_init = ut_module_init,
 };
 
 static void vbdev_ut_examine(struct spdk_bdev *bdev);
 
 struct spdk_bdev_module vbdev_ut_if = {
 	.name = "vbdev_ut",
+	.module_init = ut_module_init,
 	.examine_config = vbdev_ut_examine,
 };
 
@@ -129,6 +137,279 @@ part_test(void)
 	poll_threads();
 }
 
+static int g_base_io_device;
+static struct spdk_bdev_io *g_base_io;
+static struct spdk_bdev *g_base_io_bdev;
+static uint64_t g_base_io_offset;
+static uint64_t g_base_io_src_offset;
+static struct spdk_io_channel *g_base_io_ch;
+static bool g_io_done;
+static struct spdk_bdev *g_io_done_bdev;
+static uint64_t g_io_done_offset;
+
+static int
+base_channel_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+base_channel_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+static struct spdk_io_channel *
+base_get_io_channel(void *ctx)
+{
+	return spdk_get_io_channel(&g_base_io_device);
+}
+
+static bool
+base_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	return io_type == SPDK_BDEV_IO_TYPE_READ || io_type == SPDK_BDEV_IO_TYPE_WRITE ||
+	       io_type == SPDK_BDEV_IO_TYPE_COPY;
+}
+
+static void
+base_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	g_base_io = bdev_io;
+	g_base_io_bdev = bdev_io->bdev;
+	g_base_io_offset = bdev_io->u.bdev.offset_blocks;
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_COPY) {
+		g_base_io_src_offset = bdev_io->u.bdev.copy.src_offset_blocks;
+	}
+	g_base_io_ch = spdk_bdev_io_get_io_channel(bdev_io);
+}
+
+static void
+part_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_part_channel *ch = spdk_io_channel_get_ctx(_ch);
+	int rc;
+
+	rc = spdk_bdev_part_submit_request(ch, bdev_io);
+	CU_ASSERT(rc == 0);
+}
+
+static void
+part_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	g_io_done = success;
+	g_io_done_bdev = bdev_io->bdev;
+	g_io_done_offset = bdev_io->u.bdev.offset_blocks;
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+bdev_init_cb(void *arg, int rc)
+{
+	CU_ASSERT(rc == 0);
+}
+
+static void
+bdev_fini_cb(void *arg)
+{
+}
+
+static void
+histogram_status_cb(void *cb_arg, int status)
+{
+	CU_ASSERT(status == 0);
+}
+
+static void
+part_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+}
+
+static void
+part_timeout_cb(void *cb_arg, struct spdk_bdev_io *bdev_io)
+{
+}
+
+static int
+part_destruct(void *ctx)
+{
+	return spdk_bdev_part_free(ctx);
+}
+
+static void
+part_forward_test(void)
+{
+	struct spdk_bdev_fn_table	base_io_fn_table = {
+		.destruct		= __destruct,
+		.submit_request		= base_submit_request,
+		.get_io_channel		= base_get_io_channel,
+		.io_type_supported	= base_io_type_supported,
+	};
+	struct spdk_bdev_fn_table	part_io_fn_table = {
+		.destruct		= part_destruct,
+		.submit_request		= part_submit_request,
+	};
+	struct spdk_bdev_part_base	*base;
+	struct spdk_bdev_part		*part;
+	struct spdk_bdev		bdev_base = {};
+	SPDK_BDEV_PART_TAILQ		tailq = TAILQ_HEAD_INITIALIZER(tailq);
+	struct spdk_bdev_desc		*desc = NULL, *base_desc = NULL;
+	struct spdk_io_channel		*ch, *base_ch;
+	struct spdk_bdev_channel	*part_bdev_ch, *base_bdev_ch;
+	struct spdk_bdev_io		*part_io;
+	char				buf[512];
+	int rc;
+
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	poll_threads();
+
+	spdk_io_device_register(&g_base_io_device, base_channel_create, base_channel_destroy, 0,
+				"base_io_device");
+	base_ch = spdk_get_io_channel(&g_base_io_device);
+	SPDK_CU_ASSERT_FATAL(base_ch != NULL);
+
+	bdev_base.name = "base";
+	bdev_base.blocklen = 512;
+	bdev_base.blockcnt = 200;
+	bdev_base.fn_table = &base_io_fn_table;
+	bdev_base.module = &bdev_ut_if;
+	rc = spdk_bdev_register(&bdev_base);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_part_base_construct_ext("base", NULL, &vbdev_ut_if,
+					       &part_io_fn_table, &tailq, NULL,
+					       NULL, sizeof(struct spdk_bdev_part_channel),
+					       NULL, NULL, &base);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(base != NULL);
+
+	part = calloc(1, sizeof(*part));
+	SPDK_CU_ASSERT_FATAL(part != NULL);
+	rc = spdk_bdev_part_construct(part, base, "test1", 100, 100, "test");
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	rc = spdk_bdev_open_ext("test1", true, part_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	ch = spdk_bdev_get_io_channel(desc);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	part_bdev_ch = spdk_io_channel_get_ctx(ch);
+
+	/* The part I/O itself is passed to the base bdev, at the remapped offset. */
+	g_base_io = NULL;
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 10, 1, part_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_base_io != NULL);
+	CU_ASSERT(g_base_io_bdev == &bdev_base);
+	CU_ASSERT(g_base_io_offset == 110);
+	CU_ASSERT(g_base_io_ch == base_ch);
+	CU_ASSERT(g_base_io->bdev == &bdev_base);
+	part_io = TAILQ_FIRST(&part_bdev_ch->io_submitted);
+	CU_ASSERT(part_io == g_base_io);
+
+	/* It is outstanding on the channel of the base bdev too. */
+	CU_ASSERT(g_base_io->internal.fwd_depth == 1);
+	base_bdev_ch = g_base_io->internal.fwd_ch[0];
+	CU_ASSERT(base_bdev_ch->bdev == &bdev_base);
+	CU_ASSERT(base_bdev_ch->io_outstanding == 1);
+	CU_ASSERT(base_bdev_ch->shared_resource->io_outstanding == 1);
+
+	/* Its bdev and offset are restored on completion, and the base bdev accounts it. */
+	g_io_done = false;
+	spdk_bdev_io_complete(g_base_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_done_bdev == &part->internal.bdev);
+	CU_ASSERT(g_io_done_offset == 10);
+	CU_ASSERT(base_bdev_ch->io_outstanding == 0);
+	CU_ASSERT(base_bdev_ch->shared_resource->io_outstanding == 0);
+	CU_ASSERT(base_bdev_ch->stat.num_read_ops == 1);
+	CU_ASSERT(base_bdev_ch->stat.bytes_read == 512);
+
+	/* While a descriptor of the base bdev has a timeout, a child I/O is submitted instead. */
+	rc = spdk_bdev_open_ext("base", false, part_event_cb, NULL, &base_desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(base_desc != NULL);
+	rc = spdk_bdev_set_timeout(base_desc, 1, part_timeout_cb, NULL);
+	CU_ASSERT(rc == 0);
+
+	g_base_io = NULL;
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 10, 1, part_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_base_io != NULL);
+	part_io = TAILQ_FIRST(&part_bdev_ch->io_submitted);
+	CU_ASSERT(part_io != g_base_io);
+	spdk_bdev_io_complete(g_base_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+
+	/* Forwarding resumes once the timeout is cleared. */
+	rc = spdk_bdev_set_timeout(base_desc, 0, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	g_base_io = NULL;
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 10, 1, part_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_base_io != NULL);
+	part_io = TAILQ_FIRST(&part_bdev_ch->io_submitted);
+	CU_ASSERT(part_io == g_base_io);
+	spdk_bdev_io_complete(g_base_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+	spdk_bdev_close(base_desc);
+	poll_threads();
+
+	/* With histograms enabled on the base bdev, a child I/O is submitted instead. */
+	spdk_bdev_histogram_enable(&bdev_base, histogram_status_cb, NULL, true);
+	poll_threads();
+
+	g_base_io = NULL;
+	rc = spdk_bdev_write_blocks(desc, ch, buf, 20, 1, part_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_base_io != NULL);
+	CU_ASSERT(g_base_io_offset == 120);
+	part_io = TAILQ_FIRST(&part_bdev_ch->io_submitted);
+	CU_ASSERT(part_io != g_base_io);
+
+	g_io_done = false;
+	spdk_bdev_io_complete(g_base_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_done_bdev == &part->internal.bdev);
+	CU_ASSERT(g_io_done_offset == 20);
+
+	/* Copy is reported as supported like the base bdev and both offsets are remapped. */
+	CU_ASSERT(spdk_bdev_io_type_supported(&part->internal.bdev, SPDK_BDEV_IO_TYPE_COPY));
+	g_base_io = NULL;
+	rc = spdk_bdev_copy_blocks(desc, ch, 30, 5, 4, part_io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_base_io != NULL);
+	CU_ASSERT(g_base_io->type == SPDK_BDEV_IO_TYPE_COPY);
+	CU_ASSERT(g_base_io_bdev == &bdev_base);
+	CU_ASSERT(g_base_io_offset == 130);
+	CU_ASSERT(g_base_io_src_offset == 105);
+	CU_ASSERT(g_base_io->u.bdev.num_blocks == 4);
+
+	g_io_done = false;
+	spdk_bdev_io_complete(g_base_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	poll_threads();
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_done_bdev == &part->internal.bdev);
+	CU_ASSERT(g_io_done_offset == 30);
+
+	spdk_put_io_channel(ch);
+	spdk_bdev_close(desc);
+	poll_threads();
+
+	/* Unregistering the part frees it, and the part base along with it. */
+	spdk_bdev_part_base_hotremove(base, &tailq);
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&tailq));
+
+	spdk_bdev_unregister(&bdev_base, NULL, NULL);
+	spdk_put_io_channel(base_ch);
+	poll_threads();
+	spdk_io_device_unregister(&g_base_io_device, NULL);
+
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -141,7 +422,9 @@ main(int argc, char **argv)
 	suite = CU_add_suite("bdev_part", NULL, NULL);
 
 	CU_ADD_TEST(suite, part_test);
+	CU_ADD_TEST(suite, part_forward_test);
 
+	allocate_cores(1);
 	allocate_threads(1);
 	set_thread(0);
 
@@ -151,6 +434,7 @@ main(int argc, char **argv)
 	CU_cleanup_registry();
 
 	free_threads();
+	free_cores();
 
 	return num_failures;
 }
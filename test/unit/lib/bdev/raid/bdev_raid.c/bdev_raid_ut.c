@@ -38,6 +38,7 @@
 #include "thread/thread_internal.h"
 #include "bdev/raid/bdev_raid.c"
 #include "bdev/raid/bdev_raid_rpc.c"
+#include "bdev/raid/bdev_raid_rebuild.c"
 #include "bdev/raid/raid0.c"
 #include "common/lib/ut_multithread.c"
 
@@ -121,6 +122,7 @@ DEFINE_STUB_V(spdk_jsonrpc_send_bool_response, (struct spdk_jsonrpc_request *req
 		bool value));
 DEFINE_STUB(spdk_json_decode_string, int, (const struct spdk_json_val *val, void *out), 0);
 DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_bool, int, (const struct spdk_json_val *val, void *out), 0);
 DEFINE_STUB(spdk_json_decode_array, int, (const struct spdk_json_val *values,
 		spdk_json_decode_fn decode_func,
 		void *out, size_t max_size, size_t *out_size, size_t stride), 0);
@@ -135,9 +137,25 @@ DEFINE_STUB(spdk_json_write_named_array_begin, int, (struct spdk_json_write_ctx
 		const char *name), 0);
 DEFINE_STUB(spdk_json_write_bool, int, (struct spdk_json_write_ctx *w, bool val), 0);
 DEFINE_STUB(spdk_json_write_null, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
 DEFINE_STUB(spdk_strerror, const char *, (int errnum), NULL);
 DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB_V(spdk_bdev_destruct_done, (struct spdk_bdev *bdev, int bdeverrno));
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_lock_lba_range, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t offset, uint64_t length,
+		spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unlock_lba_range, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t offset, uint64_t length,
+		spdk_bdev_lba_range_lock_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_read_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
 
 struct spdk_io_channel *
 spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
@@ -1066,6 +1084,7 @@ create_get_raids_req(struct rpc_bdev_raid_get_bdevs *r, const char *category,
 {
 	r->category = strdup(category);
 	SPDK_CU_ASSERT_FATAL(r->category != NULL);
+	r->verbose = false;
 
 	g_rpc_req = r;
 	g_rpc_req_size = sizeof(*r);
@@ -2039,6 +2058,8 @@ test_raid_level_conversions(void)
 	CU_ASSERT(raid_bdev_parse_raid_level("0") == RAID0);
 	CU_ASSERT(raid_bdev_parse_raid_level("raid0") == RAID0);
 	CU_ASSERT(raid_bdev_parse_raid_level("RAID0") == RAID0);
+	CU_ASSERT(raid_bdev_parse_raid_level("1") == RAID1);
+	CU_ASSERT(raid_bdev_parse_raid_level("raid1") == RAID1);
 
 	raid_str = raid_bdev_level_to_str(INVALID_RAID_LEVEL);
 	CU_ASSERT(raid_str != NULL && strlen(raid_str) == 0);
@@ -2046,6 +2067,61 @@ test_raid_level_conversions(void)
 	CU_ASSERT(raid_str != NULL && strlen(raid_str) == 0);
 	raid_str = raid_bdev_level_to_str(RAID0);
 	CU_ASSERT(raid_str != NULL && strcmp(raid_str, "raid0") == 0);
+	raid_str = raid_bdev_level_to_str(RAID1);
+	CU_ASSERT(raid_str != NULL && strcmp(raid_str, "raid1") == 0);
+}
+
+static void
+test_base_bdev_add_remove_invalid(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete delete_req;
+	struct raid_bdev_opts opts, default_opts;
+	struct raid_bdev *raid_bdev;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+
+	TAILQ_FOREACH(raid_bdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(raid_bdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(raid_bdev != NULL);
+
+	/* raid0 can't run degraded, so its base bdevs can't be removed */
+	CU_ASSERT(raid_bdev_remove_base_bdev_by_name(req.base_bdevs.base_bdevs[0]) == -EBUSY);
+	CU_ASSERT(raid_bdev->base_bdev_info[0].desc != NULL);
+	CU_ASSERT(raid_bdev_remove_base_bdev_by_name("nonexistent") == -ENODEV);
+
+	/* No slot is missing a base bdev */
+	CU_ASSERT(raid_bdev_add_base_bdev(raid_bdev, req.base_bdevs.base_bdevs[0]) == -EEXIST);
+	CU_ASSERT(raid_bdev_add_base_bdev(raid_bdev, "nonexistent") == -ENODEV);
+	free_test_req(&req);
+
+	raid_bdev_get_opts(&default_opts);
+	opts = default_opts;
+	opts.rebuild_window_size_kb = 0;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == -EINVAL);
+	opts.rebuild_window_size_kb = 4;
+	opts.rebuild_max_bandwidth_mb_sec = 100;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+	raid_bdev_get_opts(&opts);
+	CU_ASSERT(opts.rebuild_window_size_kb == 4);
+	CU_ASSERT(opts.rebuild_max_bandwidth_mb_sec == 100);
+	CU_ASSERT(raid_bdev_set_opts(&default_opts) == 0);
+
+	create_raid_bdev_delete_req(&delete_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
 }
 
 int main(int argc, char **argv)
@@ -2074,6 +2150,7 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid_json_dump_info);
 	CU_ADD_TEST(suite, test_context_size);
 	CU_ADD_TEST(suite, test_raid_level_conversions);
+	CU_ADD_TEST(suite, test_base_bdev_add_remove_invalid);
 
 	allocate_threads(1);
 	set_thread(0);
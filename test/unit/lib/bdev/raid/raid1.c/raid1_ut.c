@@ -0,0 +1,1009 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "bdev/raid/raid1.c"
+#include "common/lib/ut_multithread.c"
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB_V(raid_bdev_queue_io_wait, (struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+					struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn));
+DEFINE_STUB(raid_bdev_rebuild_start, int, (struct raid_bdev *raid_bdev, uint8_t base_idx), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+
+struct spdk_bdev_desc {
+	/* Data of the base bdev */
+	uint8_t *buf;
+
+	/* Fail all IOs submitted to this base bdev */
+	bool fail_io;
+
+	/* Number of reads of the data submitted to this base bdev */
+	uint64_t reads;
+};
+
+struct test_base_io {
+	struct spdk_bdev_io *bdev_io;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+	bool success;
+};
+
+struct test_raid_io {
+	struct iovec iov;
+	bool completed;
+	enum spdk_bdev_io_status status;
+	/* Must be last, followed by struct raid_bdev_io */
+	struct spdk_bdev_io bdev_io;
+};
+
+/* The raid bdev under test, the base bdev stubs check the bitmap against it */
+static struct raid1_info *g_r1info;
+
+void
+raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct test_raid_io *io = SPDK_CONTAINEROF(bdev_io, struct test_raid_io, bdev_io);
+
+	CU_ASSERT(io->completed == false);
+	io->completed = true;
+	io->status = status;
+}
+
+void *
+raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch)
+{
+	return spdk_io_channel_get_ctx(raid_ch->module_channel);
+}
+
+struct spdk_thread *
+spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io)
+{
+	return spdk_get_thread();
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static void
+test_base_io_complete(void *ctx)
+{
+	struct test_base_io *base_io = ctx;
+
+	base_io->cb(base_io->bdev_io, base_io->success, base_io->cb_arg);
+	free(base_io);
+}
+
+/*
+ * The regions written must be marked in the bitmap on the base bdev beforehand,
+ * unless its bitmap is outdated, which makes it rebuilt entirely after a crash.
+ */
+static void
+check_bitmap_marked(struct spdk_bdev_desc *desc, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint32_t blocklen = g_r1info->raid_bdev->bdev.blocklen;
+	struct raid1_bitmap_header *header = (void *)(desc->buf + g_r1info->data_blocks * blocklen);
+	uint8_t *bits = (uint8_t *)header + blocklen;
+	uint64_t i;
+
+	if (!raid1_bitmap_header_valid(g_r1info, header) || header->seq != g_r1info->header->seq) {
+		return;
+	}
+
+	for (i = raid1_first_region(g_r1info, offset_blocks);
+	     i <= raid1_last_region(g_r1info, offset_blocks, num_blocks); i++) {
+		CU_ASSERT(raid1_bit_test(bits, i));
+	}
+}
+
+static int
+test_base_io_submit(struct spdk_bdev_desc *desc, struct iovec *iov, int iovcnt,
+		    uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		    void *cb_arg, bool write)
+{
+	struct test_base_io *base_io;
+	uint32_t blocklen = g_r1info->raid_bdev->bdev.blocklen;
+	uint8_t *buf = desc->buf + offset_blocks * blocklen;
+	size_t len = 0;
+	int i;
+
+	base_io = calloc(1, sizeof(*base_io));
+	SPDK_CU_ASSERT_FATAL(base_io != NULL);
+	base_io->bdev_io = calloc(1, sizeof(struct spdk_bdev_io));
+	SPDK_CU_ASSERT_FATAL(base_io->bdev_io != NULL);
+	base_io->cb = cb;
+	base_io->cb_arg = cb_arg;
+	base_io->success = !desc->fail_io;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iov[i].iov_len;
+	}
+	CU_ASSERT(len == num_blocks * blocklen);
+
+	if (offset_blocks < g_r1info->data_blocks) {
+		CU_ASSERT(offset_blocks + num_blocks <= g_r1info->data_blocks);
+		if (write) {
+			check_bitmap_marked(desc, offset_blocks, num_blocks);
+		} else {
+			desc->reads++;
+		}
+	} else {
+		CU_ASSERT(offset_blocks == g_r1info->data_blocks);
+		CU_ASSERT(num_blocks == g_r1info->bitmap_blocks);
+	}
+
+	if (base_io->success) {
+		for (i = 0; i < iovcnt; i++) {
+			if (write) {
+				memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+			} else {
+				memcpy(iov[i].iov_base, buf, iov[i].iov_len);
+			}
+			buf += iov[i].iov_len;
+		}
+	}
+
+	/* Complete asynchronously, like the bdev layer does */
+	spdk_thread_send_msg(spdk_get_thread(), test_base_io_complete, base_io);
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, false);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, true);
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		      void *cb_arg)
+{
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = num_blocks * g_r1info->raid_bdev->bdev.blocklen,
+	};
+
+	return test_base_io_submit(desc, &iov, 1, offset_blocks, num_blocks, cb, cb_arg, false);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = num_blocks * g_r1info->raid_bdev->bdev.blocklen,
+	};
+
+	return test_base_io_submit(desc, &iov, 1, offset_blocks, num_blocks, cb, cb_arg, true);
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	uint32_t blocklen = g_r1info->raid_bdev->bdev.blocklen;
+	struct iovec iov;
+	int ret;
+
+	/* Unmapped blocks read back as zeroes */
+	iov.iov_len = num_blocks * blocklen;
+	iov.iov_base = calloc(1, iov.iov_len);
+	SPDK_CU_ASSERT_FATAL(iov.iov_base != NULL);
+	ret = test_base_io_submit(desc, &iov, 1, offset_blocks, num_blocks, cb, cb_arg, true);
+	free(iov.iov_base);
+
+	return ret;
+}
+
+int
+spdk_bdev_flush_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	struct test_base_io *base_io;
+
+	base_io = calloc(1, sizeof(*base_io));
+	SPDK_CU_ASSERT_FATAL(base_io != NULL);
+	base_io->bdev_io = calloc(1, sizeof(struct spdk_bdev_io));
+	SPDK_CU_ASSERT_FATAL(base_io->bdev_io != NULL);
+	base_io->cb = cb;
+	base_io->cb_arg = cb_arg;
+	base_io->success = !desc->fail_io;
+
+	spdk_thread_send_msg(spdk_get_thread(), test_base_io_complete, base_io);
+
+	return 0;
+}
+
+static int
+test_desc_ioch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+test_desc_ioch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+struct raid1_params {
+	uint8_t num_base_bdevs;
+	uint32_t base_bdev_blocklen;
+};
+
+static struct raid1_params g_params[] = {
+	{ .num_base_bdevs = 2, .base_bdev_blocklen = 512 },
+	{ .num_base_bdevs = 2, .base_bdev_blocklen = 4096 },
+	{ .num_base_bdevs = 3, .base_bdev_blocklen = 4096 },
+};
+
+#define RAID1_PARAMS_FOR_EACH(p) \
+	for (p = g_params; p < g_params + SPDK_COUNTOF(g_params); p++)
+
+#define RAID1_TEST_STRIP_SIZE_KB 64
+
+/* The base bdevs hold 3.5 regions of data, followed by the bitmap */
+#define RAID1_TEST_REGION_BLOCKS(blocklen) \
+	((uint64_t)RAID1_BITMAP_REGION_SIZE_MIN_MB * 1024 * 1024 / (blocklen))
+#define RAID1_TEST_DATA_BLOCKS(blocklen) (RAID1_TEST_REGION_BLOCKS(blocklen) * 7 / 2)
+
+struct raid1_test {
+	struct raid_bdev *raid_bdev;
+	struct raid1_info *r1info;
+	struct spdk_bdev_desc *descs;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_io_channel *base_channels[UINT8_MAX];
+	uint64_t base_bdev_blockcnt;
+};
+
+static void
+start_raid1(struct raid1_test *test)
+{
+	struct raid_bdev *raid_bdev = test->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	i = 0;
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->rebuilding = false;
+		base_info->resync = false;
+		base_info->rebuild_checkpoint = 0;
+		base_info->desc = &test->descs[i++];
+	}
+
+	SPDK_CU_ASSERT_FATAL(raid1_start(raid_bdev) == 0);
+	test->r1info = g_r1info = raid_bdev->module_private;
+
+	test->raid_ch = calloc(1, sizeof(*test->raid_ch));
+	SPDK_CU_ASSERT_FATAL(test->raid_ch != NULL);
+	test->raid_ch->base_channel = test->base_channels;
+	test->raid_ch->num_channels = raid_bdev->num_base_bdevs;
+	test->raid_ch->module_channel = raid1_get_io_channel(raid_bdev);
+	SPDK_CU_ASSERT_FATAL(test->raid_ch->module_channel != NULL);
+}
+
+/* Stop the raid bdev without cleaning the bitmap, like an unclean shutdown */
+static void
+stop_raid1(struct raid1_test *test)
+{
+	spdk_put_io_channel(test->raid_ch->module_channel);
+	free(test->raid_ch);
+	test->raid_ch = NULL;
+
+	raid1_stop(test->raid_bdev);
+	poll_threads();
+	test->r1info = g_r1info = NULL;
+}
+
+static struct raid1_test *
+create_raid1_test(struct raid1_params *params, uint64_t base_bdev_blockcnt)
+{
+	struct raid1_test *test;
+	struct raid_bdev *raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	test = calloc(1, sizeof(*test));
+	SPDK_CU_ASSERT_FATAL(test != NULL);
+	test->base_bdev_blockcnt = base_bdev_blockcnt;
+
+	raid_bdev = test->raid_bdev = calloc(1, sizeof(*raid_bdev));
+	SPDK_CU_ASSERT_FATAL(raid_bdev != NULL);
+	raid_bdev->module = &g_raid1_module;
+	raid_bdev->num_base_bdevs = params->num_base_bdevs;
+	raid_bdev->base_bdev_info = calloc(raid_bdev->num_base_bdevs,
+					   sizeof(struct raid_base_bdev_info));
+	SPDK_CU_ASSERT_FATAL(raid_bdev->base_bdev_info != NULL);
+	raid_bdev->strip_size = RAID1_TEST_STRIP_SIZE_KB * 1024 / params->base_bdev_blocklen;
+	raid_bdev->strip_size_shift = spdk_u32log2(raid_bdev->strip_size);
+	raid_bdev->blocklen_shift = spdk_u32log2(params->base_bdev_blocklen);
+	raid_bdev->bdev.blocklen = params->base_bdev_blocklen;
+
+	test->descs = calloc(params->num_base_bdevs, sizeof(*test->descs));
+	SPDK_CU_ASSERT_FATAL(test->descs != NULL);
+
+	i = 0;
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->bdev = calloc(1, sizeof(*base_info->bdev));
+		SPDK_CU_ASSERT_FATAL(base_info->bdev != NULL);
+		base_info->bdev->blockcnt = base_bdev_blockcnt;
+		base_info->bdev->blocklen = params->base_bdev_blocklen;
+
+		/* Large, but only the pages written are ever touched */
+		test->descs[i].buf = calloc(base_bdev_blockcnt, params->base_bdev_blocklen);
+		SPDK_CU_ASSERT_FATAL(test->descs[i].buf != NULL);
+		spdk_io_device_register(&test->descs[i], test_desc_ioch_create, test_desc_ioch_destroy,
+					0, NULL);
+		test->base_channels[i] = spdk_get_io_channel(&test->descs[i]);
+		SPDK_CU_ASSERT_FATAL(test->base_channels[i] != NULL);
+		i++;
+	}
+
+	start_raid1(test);
+
+	return test;
+}
+
+static void
+delete_raid1_test(struct raid1_test *test)
+{
+	struct raid_bdev *raid_bdev = test->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	if (test->r1info) {
+		stop_raid1(test);
+	}
+
+	i = 0;
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		spdk_put_io_channel(test->base_channels[i]);
+		poll_threads();
+		spdk_io_device_unregister(&test->descs[i], NULL);
+		free(test->descs[i].buf);
+		free(base_info->bdev);
+		i++;
+	}
+	poll_threads();
+
+	free(test->descs);
+	free(raid_bdev->base_bdev_info);
+	free(raid_bdev);
+	free(test);
+}
+
+static struct raid1_test *
+create_raid1_test_default(struct raid1_params *params)
+{
+	uint32_t blocklen = params->base_bdev_blocklen;
+
+	return create_raid1_test(params, RAID1_TEST_DATA_BLOCKS(blocklen) + 1 + 4096 / blocklen);
+}
+
+static struct test_raid_io *
+start_raid_io(struct raid1_test *test, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	      uint64_t num_blocks, uint8_t *buf)
+{
+	struct raid_bdev *raid_bdev = test->raid_bdev;
+	struct test_raid_io *io;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+
+	io = calloc(1, sizeof(*io) + sizeof(*raid_io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	bdev_io = &io->bdev_io;
+
+	io->iov.iov_base = buf;
+	io->iov.iov_len = num_blocks * raid_bdev->bdev.blocklen;
+
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = &io->iov;
+	bdev_io->u.bdev.iovcnt = 1;
+
+	raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	raid_io->raid_bdev = raid_bdev;
+	raid_io->raid_ch = test->raid_ch;
+	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	io->status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	raid1_submit_rw_request(raid_io);
+
+	return io;
+}
+
+static enum spdk_bdev_io_status
+finish_raid_io(struct test_raid_io *io)
+{
+	enum spdk_bdev_io_status status;
+
+	poll_threads();
+
+	CU_ASSERT(io->completed == true);
+	status = io->status;
+	free(io);
+
+	return status;
+}
+
+static enum spdk_bdev_io_status
+submit_raid_io(struct raid1_test *test, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	       uint64_t num_blocks, uint8_t *buf)
+{
+	return finish_raid_io(start_raid_io(test, type, offset_blocks, num_blocks, buf));
+}
+
+static uint8_t *
+alloc_pattern(struct raid1_test *test, uint64_t num_blocks, uint8_t pattern)
+{
+	size_t len = num_blocks * test->raid_bdev->bdev.blocklen;
+	uint8_t *buf;
+
+	buf = malloc(len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, pattern, len);
+
+	return buf;
+}
+
+/* Check that a base bdev holds the given pattern in a range */
+static bool
+base_bdev_holds(struct raid1_test *test, uint8_t base_idx, uint64_t offset_blocks,
+		uint64_t num_blocks, uint8_t pattern)
+{
+	uint32_t blocklen = test->raid_bdev->bdev.blocklen;
+	uint8_t *buf = test->descs[base_idx].buf + offset_blocks * blocklen;
+	size_t i;
+
+	for (i = 0; i < num_blocks * blocklen; i++) {
+		if (buf[i] != pattern) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static struct raid1_bitmap_header *
+base_bdev_bitmap_header(struct raid1_test *test, uint8_t base_idx)
+{
+	return (struct raid1_bitmap_header *)(test->descs[base_idx].buf +
+					      test->raid_bdev->bdev.blockcnt * test->raid_bdev->bdev.blocklen);
+}
+
+static bool
+base_bdev_region_marked(struct raid1_test *test, uint8_t base_idx, uint64_t region)
+{
+	uint8_t *bits = (uint8_t *)base_bdev_bitmap_header(test, base_idx) +
+			test->raid_bdev->bdev.blocklen;
+
+	return raid1_bit_test(bits, region);
+}
+
+/*
+ * Do what the rebuild does: copy the windows the base bdev needs, read through
+ * the raid bdev, and move the checkpoint. Returns the number of blocks copied.
+ */
+static uint64_t
+rebuild_base_bdev(struct raid1_test *test, uint8_t base_idx)
+{
+	struct raid_bdev *raid_bdev = test->raid_bdev;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[base_idx];
+	uint64_t window_blocks = test->r1info->region_blocks / 4;
+	uint64_t offset, num_blocks, copied = 0;
+	uint8_t *stripe_buf, *base_buf;
+
+	stripe_buf = malloc(window_blocks * raid_bdev->bdev.blocklen);
+	base_buf = malloc(window_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(stripe_buf != NULL && base_buf != NULL);
+
+	CU_ASSERT(base_info->rebuilding);
+	for (offset = 0; offset < raid_bdev->bdev.blockcnt; offset += num_blocks) {
+		num_blocks = spdk_min(window_blocks, raid_bdev->bdev.blockcnt - offset);
+
+		if (!base_info->resync ||
+		    raid1_rebuild_range_needed(raid_bdev, base_idx, offset, num_blocks)) {
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, offset, num_blocks,
+						 stripe_buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+			CU_ASSERT(raid1_rebuild_base_bdev_data(raid_bdev, base_idx, offset, num_blocks,
+							       stripe_buf, base_buf) == 0);
+			memcpy(test->descs[base_idx].buf + offset * raid_bdev->bdev.blocklen, base_buf,
+			       num_blocks * raid_bdev->bdev.blocklen);
+			copied += num_blocks;
+		}
+		base_info->rebuild_checkpoint = offset + num_blocks;
+	}
+	base_info->rebuilding = false;
+	base_info->resync = false;
+
+	free(stripe_buf);
+	free(base_buf);
+
+	return copied;
+}
+
+static void
+test_raid1_start(void)
+{
+	struct raid1_params params = { .num_base_bdevs = 2, .base_bdev_blocklen = 4096 };
+	uint64_t region_blocks = RAID1_TEST_REGION_BLOCKS(params.base_bdev_blocklen);
+	struct raid_base_bdev_info *base_info;
+	struct raid1_test *test;
+	struct raid1_info *r1info;
+
+	test = create_raid1_test_default(&params);
+	r1info = test->r1info;
+	CU_ASSERT(r1info->region_blocks == region_blocks);
+	CU_ASSERT(r1info->bitmap_blocks == 2);
+	CU_ASSERT(r1info->data_blocks == RAID1_TEST_DATA_BLOCKS(params.base_bdev_blocklen));
+	CU_ASSERT(r1info->num_regions == 4);
+	CU_ASSERT(test->raid_bdev->bdev.blockcnt == r1info->data_blocks);
+	CU_ASSERT(raid_bdev_stripe_data_strips_num(test->raid_bdev) == 1);
+	CU_ASSERT(raid_bdev_max_degraded(test->raid_bdev) == 1);
+	delete_raid1_test(test);
+
+	test = create_raid1_test(&params, 1024);
+	CU_ASSERT(test->r1info->num_regions == 1);
+	CU_ASSERT(test->r1info->data_blocks == 1024 - 16);
+	stop_raid1(test);
+
+	/* Regions grow to keep the bitmap within RAID1_BITMAP_MAX_BYTES */
+	RAID_FOR_EACH_BASE_BDEV(test->raid_bdev, base_info) {
+		base_info->bdev->blockcnt = region_blocks * RAID1_BITMAP_MAX_BYTES * 8 * 3;
+	}
+	SPDK_CU_ASSERT_FATAL(raid1_start(test->raid_bdev) == 0);
+	r1info = test->raid_bdev->module_private;
+	CU_ASSERT(r1info->region_blocks == region_blocks * 4);
+	CU_ASSERT(r1info->num_regions <= RAID1_BITMAP_MAX_BYTES * 8);
+	CU_ASSERT(r1info->bitmap_blocks == 2);
+	CU_ASSERT(r1info->data_blocks + r1info->bitmap_blocks <= region_blocks * RAID1_BITMAP_MAX_BYTES * 8 * 3);
+	CU_ASSERT(r1info->data_blocks % test->raid_bdev->strip_size == 0);
+	/* Stopped before the bitmaps are read, the base bdevs are not that large */
+	raid1_stop(test->raid_bdev);
+	poll_threads();
+
+	/* The bitmap has to fit next to the data */
+	RAID_FOR_EACH_BASE_BDEV(test->raid_bdev, base_info) {
+		base_info->bdev->blockcnt = 2;
+	}
+	CU_ASSERT(raid1_start(test->raid_bdev) == -EINVAL);
+	delete_raid1_test(test);
+}
+
+static void
+test_raid1_write(void)
+{
+	struct raid1_params *params;
+
+	RAID1_PARAMS_FOR_EACH(params) {
+		struct raid1_test *test = create_raid1_test_default(params);
+		uint64_t region_blocks = test->r1info->region_blocks;
+		uint64_t offset = region_blocks - 8;
+		struct test_raid_io *io;
+		uint8_t *buf = alloc_pattern(test, 16, 0xa5);
+		uint64_t seq, flushes;
+		uint8_t i;
+
+		/* IOs submitted before the bitmaps are loaded wait for it */
+		CU_ASSERT(!test->r1info->loaded);
+		io = start_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, offset, 16, buf);
+		CU_ASSERT(io->completed == false);
+		CU_ASSERT(finish_raid_io(io) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(test->r1info->loaded);
+
+		/* Written to all the base bdevs, with both regions marked beforehand */
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			CU_ASSERT(base_bdev_holds(test, i, offset, 16, 0xa5));
+		}
+		CU_ASSERT(raid1_bitmap_header_valid(test->r1info, base_bdev_bitmap_header(test, 0)));
+		CU_ASSERT(base_bdev_region_marked(test, 0, 0));
+		CU_ASSERT(base_bdev_region_marked(test, 0, 1));
+		CU_ASSERT(!base_bdev_region_marked(test, 0, 2));
+
+		/*
+		 * A new raid bdev synchronizes the other base bdevs with the first one,
+		 * they don't get the bitmap until then.
+		 */
+		for (i = 1; i < params->num_base_bdevs; i++) {
+			CU_ASSERT(test->raid_bdev->base_bdev_info[i].rebuilding);
+			CU_ASSERT(!test->raid_bdev->base_bdev_info[i].resync);
+			CU_ASSERT(!raid1_bitmap_header_valid(test->r1info, base_bdev_bitmap_header(test, i)));
+			test->raid_bdev->base_bdev_info[i].rebuilding = false;
+		}
+
+		/* The bitmap is not written again for the regions already marked */
+		seq = base_bdev_bitmap_header(test, 0)->seq;
+		flushes = test->r1info->flushes;
+		memset(buf, 0x5a, 16 * params->base_bdev_blocklen);
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, offset + 4, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(test->r1info->flushes == flushes);
+		CU_ASSERT(base_bdev_bitmap_header(test, 0)->seq == seq);
+
+		/* A new region is marked first, on all the base bdevs now in sync */
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_UNMAP, region_blocks * 3, 8,
+					 NULL) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(test->r1info->flushes == flushes + 1);
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			CU_ASSERT(base_bdev_holds(test, i, offset + 4, 8, 0x5a));
+			CU_ASSERT(base_bdev_region_marked(test, i, 3));
+			CU_ASSERT(base_bdev_bitmap_header(test, i)->seq == seq + 1);
+		}
+
+		/* Flush doesn't touch the bitmap */
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_FLUSH, 0, test->raid_bdev->bdev.blockcnt,
+					 NULL) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(test->r1info->flushes == flushes + 1);
+
+		/* Degraded, the missing base bdev is skipped */
+		test->raid_bdev->base_bdev_info[0].desc = NULL;
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 2, 16,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(!base_bdev_region_marked(test, 0, 2));
+		CU_ASSERT(base_bdev_region_marked(test, 1, 2));
+		CU_ASSERT(base_bdev_bitmap_header(test, 1)->seq > base_bdev_bitmap_header(test, 0)->seq);
+		test->raid_bdev->base_bdev_info[0].desc = &test->descs[0];
+
+		/* A failed base bdev write fails the raid IO */
+		test->descs[1].fail_io = true;
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, 0, 16,
+					 buf) == SPDK_BDEV_IO_STATUS_FAILED);
+		test->descs[1].fail_io = false;
+
+		free(buf);
+		delete_raid1_test(test);
+	}
+}
+
+static void
+test_raid1_read_balancing(void)
+{
+	struct raid1_params *params;
+
+	RAID1_PARAMS_FOR_EACH(params) {
+		struct raid1_test *test = create_raid1_test_default(params);
+		struct raid_bdev *raid_bdev = test->raid_bdev;
+		struct raid1_io_channel *r1ch;
+		struct test_raid_io *ios[16];
+		uint8_t *buf = alloc_pattern(test, 8, 0x3c);
+		uint8_t *expected = alloc_pattern(test, 8, 0x3c);
+		uint8_t i, num = params->num_base_bdevs;
+
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, 0, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		for (i = 1; i < num; i++) {
+			raid_bdev->base_bdev_info[i].rebuilding = false;
+		}
+		r1ch = spdk_io_channel_get_ctx(test->raid_ch->module_channel);
+
+		/* Equally loaded base bdevs get the same share of the reads */
+		for (i = 0; i < num * 4; i++) {
+			ios[i] = start_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8, buf);
+		}
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(r1ch->reads_outstanding[i] == 4);
+			CU_ASSERT(test->descs[i].reads == 4);
+		}
+		for (i = 0; i < num * 4; i++) {
+			CU_ASSERT(finish_raid_io(ios[i]) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(r1ch->reads_outstanding[i] == 0);
+			test->descs[i].reads = 0;
+		}
+
+		/* A slow base bdev gets the reads only when the others are as busy as it is */
+		r1ch->reads_outstanding[0] = 4;
+		for (i = 0; i < (num - 1) * 4; i++) {
+			ios[i] = start_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8, buf);
+		}
+		CU_ASSERT(test->descs[0].reads == 0);
+		for (; i < (num - 1) * 4 + num; i++) {
+			ios[i] = start_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8, buf);
+		}
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(r1ch->reads_outstanding[i] == 5);
+		}
+		CU_ASSERT(test->descs[0].reads == 1);
+		r1ch->reads_outstanding[0] -= 4;
+		for (i = 0; i < (num - 1) * 4 + num; i++) {
+			CU_ASSERT(finish_raid_io(ios[i]) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+
+		/* A failed read is retried on the other base bdevs */
+		test->descs[0].fail_io = true;
+		for (i = 0; i < num; i++) {
+			memset(buf, 0, 8 * params->base_bdev_blocklen);
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8,
+						 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+			CU_ASSERT(memcmp(buf, expected, 8 * params->base_bdev_blocklen) == 0);
+		}
+		for (i = 1; i < num; i++) {
+			test->descs[i].fail_io = true;
+		}
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_FAILED);
+		for (i = 0; i < num; i++) {
+			test->descs[i].fail_io = false;
+			test->descs[i].reads = 0;
+		}
+
+		/* Base bdevs being rebuilt are read only below the checkpoint */
+		raid_bdev->base_bdev_info[0].rebuilding = true;
+		raid_bdev->base_bdev_info[0].rebuild_checkpoint = 8;
+		for (i = 0; i < num * 2; i++) {
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 8, 8,
+						 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		CU_ASSERT(test->descs[0].reads == 0);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, 0, 8,
+						 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		CU_ASSERT(test->descs[0].reads == 1);
+		raid_bdev->base_bdev_info[0].rebuilding = false;
+
+		free(buf);
+		free(expected);
+		delete_raid1_test(test);
+	}
+}
+
+static void
+test_raid1_resync(void)
+{
+	struct raid1_params *params;
+
+	RAID1_PARAMS_FOR_EACH(params) {
+		struct raid1_test *test = create_raid1_test_default(params);
+		struct raid_bdev *raid_bdev = test->raid_bdev;
+		uint64_t region_blocks = test->r1info->region_blocks;
+		uint8_t *buf = alloc_pattern(test, 16, 0x11);
+		uint8_t i, num = params->num_base_bdevs;
+
+		/* Start with base bdevs in sync, the first start marks the others to be rebuilt */
+		poll_threads();
+		for (i = 1; i < num; i++) {
+			CU_ASSERT(raid_bdev->base_bdev_info[i].rebuilding);
+			raid_bdev->base_bdev_info[i].rebuilding = false;
+		}
+
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks, 16,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		stop_raid1(test);
+
+		/*
+		 * The last base bdev misses the write to region 1 because of the unclean
+		 * shutdown. Its region 0 differs too, but that region is not dirty and
+		 * must not be resynchronized.
+		 */
+		memset(test->descs[num - 1].buf + region_blocks * params->base_bdev_blocklen, 0x22,
+		       16 * params->base_bdev_blocklen);
+		memset(test->descs[num - 1].buf, 0x33, 16 * params->base_bdev_blocklen);
+
+		start_raid1(test);
+		poll_threads();
+
+		CU_ASSERT(!raid_bdev->base_bdev_info[0].rebuilding);
+		for (i = 1; i < num; i++) {
+			CU_ASSERT(raid_bdev->base_bdev_info[i].rebuilding);
+			CU_ASSERT(raid_bdev->base_bdev_info[i].resync);
+		}
+		CU_ASSERT(raid1_rebuild_range_needed(raid_bdev, 1, region_blocks, 1));
+		CU_ASSERT(!raid1_rebuild_range_needed(raid_bdev, 1, 0, region_blocks));
+		CU_ASSERT(!raid1_rebuild_range_needed(raid_bdev, 1, region_blocks * 2, region_blocks));
+
+		/* Only the regions not dirty can be read from the base bdevs being resynchronized */
+		for (i = 0; i < num; i++) {
+			test->descs[i].reads = 0;
+		}
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, region_blocks, 16,
+						 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		CU_ASSERT(test->descs[0].reads == num);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_READ, region_blocks * 2, 16,
+						 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(test->descs[i].reads == (i == 0 ? num + 1U : 1U));
+		}
+
+		/* Only the dirty region is copied */
+		for (i = 1; i < num; i++) {
+			CU_ASSERT(rebuild_base_bdev(test, i) == region_blocks);
+			CU_ASSERT(base_bdev_holds(test, i, region_blocks, 16, 0x11));
+		}
+		CU_ASSERT(base_bdev_holds(test, num - 1, 0, 16, 0x33));
+
+		/* A base bdev with an older bitmap missed some writes and is rebuilt entirely */
+		stop_raid1(test);
+		base_bdev_bitmap_header(test, num - 1)->seq--;
+		start_raid1(test);
+		poll_threads();
+		CU_ASSERT(raid_bdev->base_bdev_info[num - 1].rebuilding);
+		CU_ASSERT(!raid_bdev->base_bdev_info[num - 1].resync);
+		for (i = 1; i < num - 1; i++) {
+			CU_ASSERT(raid_bdev->base_bdev_info[i].resync);
+		}
+
+		/* So is a base bdev without a valid bitmap, the next one becomes the source */
+		stop_raid1(test);
+		memset(base_bdev_bitmap_header(test, 0), 0, params->base_bdev_blocklen);
+		start_raid1(test);
+		poll_threads();
+		CU_ASSERT(raid_bdev->base_bdev_info[0].rebuilding);
+		CU_ASSERT(!raid_bdev->base_bdev_info[0].resync);
+		CU_ASSERT(!raid_bdev->base_bdev_info[1].rebuilding);
+
+		free(buf);
+		delete_raid1_test(test);
+	}
+}
+
+static void
+test_raid1_bitmap_clean(void)
+{
+	struct raid1_params *params;
+
+	RAID1_PARAMS_FOR_EACH(params) {
+		struct raid1_test *test = create_raid1_test_default(params);
+		struct raid_bdev *raid_bdev = test->raid_bdev;
+		uint64_t region_blocks = test->r1info->region_blocks;
+		uint8_t *buf = alloc_pattern(test, 8, 0x44);
+		uint8_t i, num = params->num_base_bdevs;
+
+		poll_threads();
+		for (i = 1; i < num; i++) {
+			raid_bdev->base_bdev_info[i].rebuilding = false;
+		}
+
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, 0, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+		/* Region 0 was written since the last cleanup, it stays dirty */
+		spdk_delay_us(RAID1_BITMAP_CLEAN_DELAY_SEC * SPDK_SEC_TO_USEC);
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 2, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(base_bdev_region_marked(test, i, 0));
+			CU_ASSERT(base_bdev_region_marked(test, i, 2));
+		}
+
+		/* Not long enough since the last cleanup */
+		spdk_delay_us(RAID1_BITMAP_CLEAN_DELAY_SEC * SPDK_SEC_TO_USEC / 2);
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 2, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(base_bdev_region_marked(test, 0, 0));
+
+		/* Region 0 has been idle long enough now, region 2 is still written */
+		spdk_delay_us(RAID1_BITMAP_CLEAN_DELAY_SEC * SPDK_SEC_TO_USEC / 2);
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 2, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(!base_bdev_region_marked(test, i, 0));
+			CU_ASSERT(base_bdev_region_marked(test, i, 2));
+		}
+
+		/* The next write to region 0 marks it again */
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, 0, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT(base_bdev_region_marked(test, i, 0));
+		}
+
+		/* Regions being resynchronized stay dirty until the resync is done */
+		spdk_delay_us(RAID1_BITMAP_CLEAN_DELAY_SEC * SPDK_SEC_TO_USEC);
+		raid1_bit_set(test->r1info->resync_bits, 0);
+		raid_bdev->base_bdev_info[num - 1].resync = true;
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 3, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		spdk_delay_us(RAID1_BITMAP_CLEAN_DELAY_SEC * SPDK_SEC_TO_USEC);
+		CU_ASSERT(submit_raid_io(test, SPDK_BDEV_IO_TYPE_WRITE, region_blocks * 3, 8,
+					 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(base_bdev_region_marked(test, 0, 0));
+		CU_ASSERT(!base_bdev_region_marked(test, 0, 2));
+		raid_bdev->base_bdev_info[num - 1].resync = false;
+
+		free(buf);
+		delete_raid1_test(test);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("raid1", NULL, NULL);
+	CU_ADD_TEST(suite, test_raid1_start);
+	CU_ADD_TEST(suite, test_raid1_write);
+	CU_ADD_TEST(suite, test_raid1_read_balancing);
+	CU_ADD_TEST(suite, test_raid1_resync);
+	CU_ADD_TEST(suite, test_raid1_bitmap_clean);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
@@ -37,10 +37,135 @@
 #include "spdk_internal/mock.h"
 
 #include "bdev/raid/raid5.c"
+#include "common/lib/ut_multithread.c"
 
 DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
-DEFINE_STUB_V(raid_bdev_io_complete, (struct raid_bdev_io *raid_io,
-				      enum spdk_bdev_io_status status));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+
+struct spdk_bdev_desc {
+	/* Data of the base bdev */
+	uint8_t *buf;
+
+	/* Fail all IOs submitted to this base bdev */
+	bool fail_io;
+};
+
+/* Number of reads submitted to the base bdevs */
+static uint64_t g_base_reads;
+
+struct test_base_io {
+	struct spdk_bdev_io *bdev_io;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+	bool success;
+};
+
+struct test_raid_io {
+	struct iovec iovs[3];
+	bool completed;
+	enum spdk_bdev_io_status status;
+	/* Must be last, followed by struct raid_bdev_io */
+	struct spdk_bdev_io bdev_io;
+};
+
+void
+raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct test_raid_io *io = SPDK_CONTAINEROF(bdev_io, struct test_raid_io, bdev_io);
+
+	CU_ASSERT(io->completed == false);
+	io->completed = true;
+	io->status = status;
+}
+
+void *
+raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch)
+{
+	return spdk_io_channel_get_ctx(raid_ch->module_channel);
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static void
+test_base_io_complete(void *ctx)
+{
+	struct test_base_io *base_io = ctx;
+
+	base_io->cb(base_io->bdev_io, base_io->success, base_io->cb_arg);
+	free(base_io);
+}
+
+static int
+test_base_io_submit(struct spdk_bdev_desc *desc, struct iovec *iov, int iovcnt,
+		    uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		    void *cb_arg, bool write)
+{
+	struct test_base_io *base_io;
+	struct raid5_chunk *chunk = cb_arg;
+	uint32_t blocklen = 1 << chunk->r5req->r5info->raid_bdev->blocklen_shift;
+	uint8_t *buf = desc->buf + offset_blocks * blocklen;
+	size_t len = 0;
+	int i;
+
+	base_io = calloc(1, sizeof(*base_io));
+	SPDK_CU_ASSERT_FATAL(base_io != NULL);
+	base_io->bdev_io = calloc(1, sizeof(struct spdk_bdev_io));
+	SPDK_CU_ASSERT_FATAL(base_io->bdev_io != NULL);
+	base_io->cb = cb;
+	base_io->cb_arg = cb_arg;
+	base_io->success = !desc->fail_io;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iov[i].iov_len;
+	}
+	CU_ASSERT(len == num_blocks * blocklen);
+
+	if (base_io->success) {
+		for (i = 0; i < iovcnt; i++) {
+			if (write) {
+				memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+			} else {
+				memcpy(iov[i].iov_base, buf, iov[i].iov_len);
+			}
+			buf += iov[i].iov_len;
+		}
+	}
+
+	/* Complete asynchronously, like the bdev layer does */
+	spdk_thread_send_msg(spdk_get_thread(), test_base_io_complete, base_io);
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	g_base_reads++;
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, false);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, true);
+}
 
 struct raid5_params {
 	uint8_t num_base_bdevs;
@@ -136,6 +261,7 @@ create_raid_bdev(struct raid5_params *params)
 
 	raid_bdev->strip_size = params->strip_size;
 	raid_bdev->strip_size_shift = spdk_u32log2(raid_bdev->strip_size);
+	raid_bdev->blocklen_shift = spdk_u32log2(params->base_bdev_blocklen);
 	raid_bdev->bdev.blocklen = params->base_bdev_blocklen;
 
 	return raid_bdev;
@@ -169,10 +295,878 @@ delete_raid5(struct raid5_info *r5info)
 	struct raid_bdev *raid_bdev = r5info->raid_bdev;
 
 	raid5_stop(raid_bdev);
+	poll_threads();
 
 	delete_raid_bdev(raid_bdev);
 }
 
+struct raid_io_info {
+	struct raid5_info *r5info;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_io_channel *base_channels[UINT8_MAX];
+	struct spdk_bdev_desc *descs;
+	size_t base_bdev_size;
+	/* Expected content of the raid bdev */
+	uint8_t *data;
+};
+
+static struct raid_io_info *
+create_raid_io_info(struct raid5_params *params)
+{
+	struct raid_io_info *io_info;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	io_info = calloc(1, sizeof(*io_info));
+	SPDK_CU_ASSERT_FATAL(io_info != NULL);
+
+	io_info->r5info = create_raid5(params);
+	io_info->base_bdev_size = params->base_bdev_blockcnt * params->base_bdev_blocklen;
+
+	io_info->descs = calloc(params->num_base_bdevs, sizeof(*io_info->descs));
+	SPDK_CU_ASSERT_FATAL(io_info->descs != NULL);
+
+	i = 0;
+	RAID_FOR_EACH_BASE_BDEV(io_info->r5info->raid_bdev, base_info) {
+		io_info->descs[i].buf = calloc(1, io_info->base_bdev_size);
+		SPDK_CU_ASSERT_FATAL(io_info->descs[i].buf != NULL);
+		base_info->desc = &io_info->descs[i];
+		/* Only the pointer value matters, base channels are not used by the stubs */
+		io_info->base_channels[i] = (struct spdk_io_channel *)0x1;
+		i++;
+	}
+
+	io_info->data = calloc(io_info->r5info->raid_bdev->bdev.blockcnt,
+			       params->base_bdev_blocklen);
+	SPDK_CU_ASSERT_FATAL(io_info->data != NULL);
+
+	io_info->raid_ch = calloc(1, sizeof(*io_info->raid_ch));
+	SPDK_CU_ASSERT_FATAL(io_info->raid_ch != NULL);
+	io_info->raid_ch->base_channel = io_info->base_channels;
+	io_info->raid_ch->num_channels = params->num_base_bdevs;
+	io_info->raid_ch->module_channel = raid5_get_io_channel(io_info->r5info->raid_bdev);
+	SPDK_CU_ASSERT_FATAL(io_info->raid_ch->module_channel != NULL);
+
+	return io_info;
+}
+
+static void
+delete_raid_io_info(struct raid_io_info *io_info)
+{
+	uint8_t i;
+
+	spdk_put_io_channel(io_info->raid_ch->module_channel);
+	poll_threads();
+
+	for (i = 0; i < io_info->r5info->raid_bdev->num_base_bdevs; i++) {
+		free(io_info->descs[i].buf);
+	}
+	free(io_info->descs);
+	free(io_info->raid_ch);
+	free(io_info->data);
+	delete_raid5(io_info->r5info);
+	free(io_info);
+}
+
+static struct test_raid_io *
+start_raid_io(struct raid_io_info *io_info, enum spdk_bdev_io_type type,
+	      uint64_t offset_blocks, uint64_t num_blocks, uint8_t *buf)
+{
+	struct raid_bdev *raid_bdev = io_info->r5info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t len = num_blocks * blocklen;
+	struct test_raid_io *io;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+	struct iovec *iovs;
+	size_t split;
+
+	io = calloc(1, sizeof(*io) + sizeof(*raid_io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	bdev_io = &io->bdev_io;
+	iovs = io->iovs;
+
+	/* Split the payload into unevenly sized iovecs to exercise the iovec mapping */
+	split = len / 3 + 1;
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = spdk_min(split, len);
+	iovs[1].iov_base = buf + iovs[0].iov_len;
+	iovs[1].iov_len = spdk_min(split / 2, len - iovs[0].iov_len);
+	iovs[2].iov_base = buf + iovs[0].iov_len + iovs[1].iov_len;
+	iovs[2].iov_len = len - iovs[0].iov_len - iovs[1].iov_len;
+
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = iovs;
+	bdev_io->u.bdev.iovcnt = iovs[2].iov_len > 0 ? 3 : (iovs[1].iov_len > 0 ? 2 : 1);
+
+	raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	raid_io->raid_bdev = raid_bdev;
+	raid_io->raid_ch = io_info->raid_ch;
+
+	io->status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	raid5_submit_rw_request(raid_io);
+
+	return io;
+}
+
+static enum spdk_bdev_io_status
+submit_raid_io(struct raid_io_info *io_info, enum spdk_bdev_io_type type,
+	       uint64_t offset_blocks, uint64_t num_blocks, uint8_t *buf)
+{
+	struct test_raid_io *io;
+	enum spdk_bdev_io_status status;
+
+	io = start_raid_io(io_info, type, offset_blocks, num_blocks, buf);
+	poll_threads();
+
+	CU_ASSERT(io->completed == true);
+	status = io->status;
+	free(io);
+
+	return status;
+}
+
+static void
+write_and_verify(struct raid_io_info *io_info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint32_t blocklen = io_info->r5info->raid_bdev->bdev.blocklen;
+	uint8_t *buf;
+	size_t i;
+
+	buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	for (i = 0; i < num_blocks * blocklen; i++) {
+		buf[i] = rand();
+	}
+
+	CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, offset_blocks, num_blocks,
+				 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	memcpy(io_info->data + offset_blocks * blocklen, buf, num_blocks * blocklen);
+
+	free(buf);
+}
+
+static void
+read_and_verify(struct raid_io_info *io_info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint32_t blocklen = io_info->r5info->raid_bdev->bdev.blocklen;
+	uint8_t *buf;
+
+	buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_READ, offset_blocks, num_blocks,
+				 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info->data + offset_blocks * blocklen, buf,
+			 num_blocks * blocklen) == 0);
+
+	free(buf);
+}
+
+/* Check that the base bdevs hold the expected data and parity for each stripe */
+static void
+verify_layout(struct raid_io_info *io_info, uint8_t skip_base_idx)
+{
+	struct raid5_info *r5info = io_info->r5info;
+	struct raid_bdev *raid_bdev = r5info->raid_bdev;
+	size_t strip_bytes = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	uint8_t *parity;
+	uint64_t stripe;
+	uint8_t chunk, parity_idx, base_idx;
+	size_t i;
+
+	parity = malloc(strip_bytes);
+	SPDK_CU_ASSERT_FATAL(parity != NULL);
+
+	for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+		parity_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, stripe, 0);
+		memset(parity, 0, strip_bytes);
+
+		for (chunk = 0; chunk < raid_bdev->num_base_bdevs - 1; chunk++) {
+			uint8_t *expected = io_info->data + (stripe * r5info->stripe_blocks +
+							     chunk * raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+
+			base_idx = raid_bdev_stripe_data_base_idx(raid_bdev, stripe, chunk);
+			if (base_idx != skip_base_idx) {
+				CU_ASSERT(memcmp(io_info->descs[base_idx].buf + stripe * strip_bytes,
+						 expected, strip_bytes) == 0);
+			}
+
+			for (i = 0; i < strip_bytes; i++) {
+				parity[i] ^= expected[i];
+			}
+		}
+
+		if (parity_idx != skip_base_idx) {
+			CU_ASSERT(memcmp(io_info->descs[parity_idx].buf + stripe * strip_bytes,
+					 parity, strip_bytes) == 0);
+		}
+	}
+
+	free(parity);
+}
+
+#define RAID5_IO_TEST_MAX_BLOCKCNT 1024
+
+static void
+test_raid5_full_stripe_write(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		uint64_t stripe;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+
+		for (stripe = 0; stripe < io_info->r5info->total_stripes; stripe++) {
+			write_and_verify(io_info, stripe * io_info->r5info->stripe_blocks,
+					 io_info->r5info->stripe_blocks);
+		}
+		verify_layout(io_info, UINT8_MAX);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid5_partial_stripe_write(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		uint64_t stripe, offsets[4], lengths[4];
+		uint32_t strip_size;
+		int i;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+		strip_size = r5info->raid_bdev->strip_size;
+
+		/* single block, inside a strip, across a strip boundary and all but the first block */
+		offsets[0] = 0;
+		lengths[0] = 1;
+		offsets[1] = strip_size / 2;
+		lengths[1] = spdk_max(strip_size / 4, 1u);
+		offsets[2] = strip_size - 1;
+		lengths[2] = 2;
+		offsets[3] = 1;
+		lengths[3] = r5info->stripe_blocks - 1;
+
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			for (i = 0; i < 4; i++) {
+				write_and_verify(io_info, stripe * r5info->stripe_blocks + offsets[i],
+						 lengths[i]);
+			}
+		}
+		verify_layout(io_info, UINT8_MAX);
+
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			for (i = 0; i < 4; i++) {
+				read_and_verify(io_info, stripe * r5info->stripe_blocks + offsets[i],
+						lengths[i]);
+			}
+		}
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid5_degraded_read(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		uint64_t stripe;
+		uint8_t failed_idx, i;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			write_and_verify(io_info, stripe * r5info->stripe_blocks,
+					 r5info->stripe_blocks);
+		}
+
+		for (failed_idx = 0; failed_idx < params->num_base_bdevs; failed_idx++) {
+			/* IO errors from one base bdev are recovered from parity */
+			io_info->descs[failed_idx].fail_io = true;
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				read_and_verify(io_info, stripe * r5info->stripe_blocks,
+					r5info->stripe_blocks);
+				read_and_verify(io_info, stripe * r5info->stripe_blocks + 1, 1);
+			}
+
+			/* Errors from two base bdevs can't be recovered */
+			i = (failed_idx + 1) % params->num_base_bdevs;
+			io_info->descs[i].fail_io = true;
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				uint8_t *buf = malloc(r5info->stripe_blocks * params->base_bdev_blocklen);
+
+				SPDK_CU_ASSERT_FATAL(buf != NULL);
+				CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_READ,
+							 stripe * r5info->stripe_blocks, r5info->stripe_blocks,
+							 buf) == SPDK_BDEV_IO_STATUS_FAILED);
+				free(buf);
+			}
+			io_info->descs[i].fail_io = false;
+			io_info->descs[failed_idx].fail_io = false;
+		}
+
+		/* A missing base bdev is not accessed at all, its data is reconstructed */
+		failed_idx = params->num_base_bdevs - 1;
+		r5info->raid_bdev->base_bdev_info[failed_idx].desc = NULL;
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			write_and_verify(io_info, stripe * r5info->stripe_blocks,
+					 r5info->stripe_blocks);
+		}
+		verify_layout(io_info, failed_idx);
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			read_and_verify(io_info, stripe * r5info->stripe_blocks,
+					r5info->stripe_blocks);
+		}
+		r5info->raid_bdev->base_bdev_info[failed_idx].desc = &io_info->descs[failed_idx];
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid5_concurrent_writes(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		struct test_raid_io *ios[4];
+		uint32_t blocklen = params->base_bdev_blocklen;
+		uint64_t offsets[4], stripe_offset;
+		uint8_t *bufs[4];
+		int i;
+		size_t j;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+
+		/*
+		 * Partial writes to different blocks of the same stripe submitted at
+		 * once, followed by a full stripe write of the next stripe.
+		 */
+		stripe_offset = r5info->total_stripes > 1 ? r5info->stripe_blocks : 0;
+		offsets[0] = 0;
+		offsets[1] = r5info->raid_bdev->strip_size;
+		offsets[2] = r5info->stripe_blocks - 1;
+		offsets[3] = stripe_offset;
+
+		for (i = 0; i < 4; i++) {
+			uint64_t num_blocks = i == 3 ? r5info->stripe_blocks : 1;
+
+			bufs[i] = malloc(num_blocks * blocklen);
+			SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+			for (j = 0; j < num_blocks * blocklen; j++) {
+				bufs[i][j] = rand();
+			}
+			ios[i] = start_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, offsets[i], num_blocks,
+					       bufs[i]);
+		}
+
+		poll_threads();
+
+		for (i = 0; i < 4; i++) {
+			uint64_t num_blocks = i == 3 ? r5info->stripe_blocks : 1;
+
+			CU_ASSERT(ios[i]->completed == true);
+			CU_ASSERT(ios[i]->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			memcpy(io_info->data + offsets[i] * blocklen, bufs[i], num_blocks * blocklen);
+			free(ios[i]);
+			free(bufs[i]);
+		}
+
+		verify_layout(io_info, UINT8_MAX);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+get_stripe_cache_stats(struct raid5_info *r5info, struct raid5_stripe_cache_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		struct raid5_stripe_cache_stats *shard_stats = &r5info->stripe_locks[i].cache_stats;
+
+		stats->hits += shard_stats->hits;
+		stats->misses += shard_stats->misses;
+		stats->full_stripe_conversions += shard_stats->full_stripe_conversions;
+		stats->coalesced_writes += shard_stats->coalesced_writes;
+	}
+}
+
+static void
+test_raid5_stripe_cache(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		struct raid5_stripe_cache_stats stats;
+		uint64_t misses;
+		uint32_t strip_size;
+		uint8_t data_chunks, chunk;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+		strip_size = r5info->raid_bdev->strip_size;
+		data_chunks = params->num_base_bdevs - 1;
+		SPDK_CU_ASSERT_FATAL(r5info->cache_entries_num > 0);
+
+		/* The first write of a stripe reads the old data and parity */
+		write_and_verify(io_info, 0, 1);
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.misses == 1);
+		CU_ASSERT(stats.hits == 0);
+
+		/* Writing the same block again doesn't read anything */
+		write_and_verify(io_info, 0, 1);
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.misses == 1);
+		CU_ASSERT(stats.hits == 1);
+		verify_layout(io_info, UINT8_MAX);
+
+		/*
+		 * Writing the strips one by one, the parity is generated from the
+		 * cached data once the last strip of the stripe is written.
+		 */
+		for (chunk = 0; chunk < data_chunks; chunk++) {
+			write_and_verify(io_info, chunk * strip_size, strip_size);
+		}
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.full_stripe_conversions == 1);
+		CU_ASSERT(stats.misses + stats.hits == (uint64_t)data_chunks + 1u);
+		verify_layout(io_info, UINT8_MAX);
+
+		/* The following partial writes of the stripe are converted too */
+		write_and_verify(io_info, strip_size, 1);
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.full_stripe_conversions == 2);
+		misses = stats.misses;
+
+		/* A full stripe write drops the cached stripe */
+		write_and_verify(io_info, 0, r5info->stripe_blocks);
+		write_and_verify(io_info, strip_size, 1);
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.misses == misses + 1);
+		verify_layout(io_info, UINT8_MAX);
+		read_and_verify(io_info, 0, r5info->stripe_blocks);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid5_write_coalescing(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		struct raid5_stripe_cache_stats stats;
+		struct test_raid_io *ios[UINT8_MAX + 1];
+		uint64_t offsets[UINT8_MAX + 1], lengths[UINT8_MAX + 1];
+		uint8_t *bufs[UINT8_MAX + 1];
+		uint32_t blocklen = params->base_bdev_blocklen;
+		uint32_t strip_size;
+		uint8_t data_chunks, i, num_ios;
+		size_t j;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+		strip_size = r5info->raid_bdev->strip_size;
+		data_chunks = params->num_base_bdevs - 1;
+
+		/*
+		 * The first write holds the stripe lock while the following ones,
+		 * together covering the whole stripe, wait for it. They are then
+		 * merged into a single full stripe write.
+		 */
+		offsets[0] = 0;
+		lengths[0] = 1;
+		num_ios = 1;
+		for (i = 0; i < data_chunks; i++) {
+			if (strip_size > 1) {
+				offsets[num_ios] = i * strip_size;
+				lengths[num_ios] = strip_size / 2;
+				num_ios++;
+				offsets[num_ios] = i * strip_size + strip_size / 2;
+				lengths[num_ios] = strip_size - strip_size / 2;
+				num_ios++;
+			} else {
+				offsets[num_ios] = i;
+				lengths[num_ios] = 1;
+				num_ios++;
+			}
+		}
+
+		for (i = 0; i < num_ios; i++) {
+			bufs[i] = malloc(lengths[i] * blocklen);
+			SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+			for (j = 0; j < lengths[i] * blocklen; j++) {
+				bufs[i][j] = rand();
+			}
+			ios[i] = start_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, offsets[i], lengths[i],
+					       bufs[i]);
+		}
+
+		poll_threads();
+
+		for (i = 0; i < num_ios; i++) {
+			CU_ASSERT(ios[i]->completed == true);
+			CU_ASSERT(ios[i]->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			memcpy(io_info->data + offsets[i] * blocklen, bufs[i], lengths[i] * blocklen);
+			free(ios[i]);
+			free(bufs[i]);
+		}
+
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.misses == 1);
+		CU_ASSERT(stats.full_stripe_conversions == 1);
+		CU_ASSERT(stats.coalesced_writes == (uint64_t)num_ios - 2);
+
+		verify_layout(io_info, UINT8_MAX);
+		read_and_verify(io_info, 0, r5info->stripe_blocks);
+
+		/* Overlapping writes are applied in submission order */
+		for (i = 0; i < 3; i++) {
+			bufs[i] = malloc(blocklen);
+			SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+			memset(bufs[i], i + 1, blocklen);
+			ios[i] = start_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, 0, 1, bufs[i]);
+		}
+
+		poll_threads();
+
+		for (i = 0; i < 3; i++) {
+			CU_ASSERT(ios[i]->completed == true);
+			CU_ASSERT(ios[i]->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			free(ios[i]);
+			free(bufs[i]);
+		}
+		memset(io_info->data, 3, blocklen);
+
+		get_stripe_cache_stats(r5info, &stats);
+		CU_ASSERT(stats.coalesced_writes == (uint64_t)num_ios - 1);
+
+		verify_layout(io_info, UINT8_MAX);
+		read_and_verify(io_info, 0, 1);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+/* Regenerate the content of a base bdev from the data of the raid bdev, starting at a stripe */
+static void
+rebuild_base_bdev(struct raid_io_info *io_info, uint8_t base_idx, uint64_t start_stripe)
+{
+	struct raid5_info *r5info = io_info->r5info;
+	struct raid_bdev *raid_bdev = r5info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t num_blocks = (r5info->total_stripes - start_stripe) * raid_bdev->strip_size;
+	uint8_t *base_buf;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	base_buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(base_buf != NULL);
+
+	CU_ASSERT(raid5_rebuild_base_bdev_data(raid_bdev, base_idx,
+					       start_stripe * raid_bdev->strip_size, num_blocks,
+					       io_info->data + start_stripe * r5info->stripe_blocks * blocklen,
+					       base_buf) == 0);
+	memcpy(io_info->descs[base_idx].buf + start_stripe * raid_bdev->strip_size * blocklen,
+	       base_buf, num_blocks * blocklen);
+
+	free(base_buf);
+}
+
+static void
+test_raid5_degraded_write(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		struct raid_base_bdev_info *base_info;
+		struct test_raid_io *ios[UINT8_MAX];
+		uint8_t *bufs[UINT8_MAX];
+		uint32_t blocklen = params->base_bdev_blocklen;
+		uint64_t stripe, offsets[4], lengths[4];
+		uint32_t strip_size;
+		uint8_t failed_idx, data_chunks, i;
+		size_t j;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		for (failed_idx = 0; failed_idx < params->num_base_bdevs; failed_idx++) {
+			io_info = create_raid_io_info(params);
+			r5info = io_info->r5info;
+			strip_size = r5info->raid_bdev->strip_size;
+			data_chunks = params->num_base_bdevs - 1;
+			base_info = &r5info->raid_bdev->base_bdev_info[failed_idx];
+
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				write_and_verify(io_info, stripe * r5info->stripe_blocks,
+						 r5info->stripe_blocks);
+			}
+			/* Leave some of the first stripe in the stripe cache */
+			write_and_verify(io_info, 0, 1);
+
+			offsets[0] = 0;
+			lengths[0] = 1;
+			offsets[1] = strip_size / 2;
+			lengths[1] = spdk_max(strip_size / 4, 1u);
+			offsets[2] = strip_size - 1;
+			lengths[2] = 2;
+			offsets[3] = 1;
+			lengths[3] = r5info->stripe_blocks - 1;
+
+			/* Partial writes to the missing base bdev update the parity only */
+			base_info->desc = NULL;
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				for (i = 0; i < 4; i++) {
+					write_and_verify(io_info, stripe * r5info->stripe_blocks + offsets[i],
+							 lengths[i]);
+				}
+			}
+			verify_layout(io_info, failed_idx);
+
+			/* Concurrent writes of a stripe, some of them to the missing base bdev */
+			for (i = 0; i < data_chunks; i++) {
+				bufs[i] = malloc(blocklen);
+				SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+				for (j = 0; j < blocklen; j++) {
+					bufs[i][j] = rand();
+				}
+				ios[i] = start_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, i * strip_size, 1,
+						       bufs[i]);
+			}
+
+			poll_threads();
+
+			for (i = 0; i < data_chunks; i++) {
+				CU_ASSERT(ios[i]->completed == true);
+				CU_ASSERT(ios[i]->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				memcpy(io_info->data + i * strip_size * blocklen, bufs[i], blocklen);
+				free(ios[i]);
+				free(bufs[i]);
+			}
+			verify_layout(io_info, failed_idx);
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				read_and_verify(io_info, stripe * r5info->stripe_blocks,
+						r5info->stripe_blocks);
+			}
+
+			/*
+			 * While the base bdev is rebuilt, it is written only below the
+			 * rebuild checkpoint. The rest is regenerated by the rebuild.
+			 */
+			base_info->desc = &io_info->descs[failed_idx];
+			base_info->rebuilding = true;
+			base_info->rebuild_checkpoint = 0;
+			rebuild_base_bdev(io_info, failed_idx, 0);
+			base_info->rebuild_checkpoint = strip_size;
+			for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+				for (i = 0; i < 4; i++) {
+					write_and_verify(io_info, stripe * r5info->stripe_blocks + offsets[i],
+							 lengths[i]);
+				}
+			}
+			rebuild_base_bdev(io_info, failed_idx, 1);
+			base_info->rebuilding = false;
+			verify_layout(io_info, UINT8_MAX);
+
+			delete_raid_io_info(io_info);
+		}
+	}
+}
+
+/* Mark all the stripe cache entries as used, or not, so that writes bypass the cache */
+static void
+set_stripe_cache_busy(struct raid5_info *r5info, bool busy)
+{
+	struct raid5_stripe_cache_entry *entry;
+	int i;
+
+	for (i = 0; i < RAID5_STRIPE_LOCK_SHARDS; i++) {
+		TAILQ_FOREACH(entry, &r5info->stripe_locks[i].cache_lru, link) {
+			entry->busy = busy;
+		}
+	}
+}
+
+static void
+missing_parity_write(struct raid5_params *params, bool cached)
+{
+	struct raid_io_info *io_info = create_raid_io_info(params);
+	struct raid5_info *r5info = io_info->r5info;
+	struct raid_bdev *raid_bdev = r5info->raid_bdev;
+	uint8_t parity_idx;
+
+	write_and_verify(io_info, 0, r5info->stripe_blocks);
+	parity_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, 0, 0);
+	raid_bdev->base_bdev_info[parity_idx].desc = NULL;
+	set_stripe_cache_busy(r5info, !cached);
+
+	/* Partial writes only write the data, the old data isn't read */
+	g_base_reads = 0;
+	write_and_verify(io_info, 0, 1);
+	write_and_verify(io_info, 1, r5info->stripe_blocks - 1);
+	CU_ASSERT(g_base_reads == 0);
+
+	set_stripe_cache_busy(r5info, false);
+	verify_layout(io_info, parity_idx);
+	read_and_verify(io_info, 0, r5info->stripe_blocks);
+
+	delete_raid_io_info(io_info);
+}
+
+static void
+test_raid5_missing_parity_write(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		missing_parity_write(params, false);
+		missing_parity_write(params, true);
+	}
+}
+
+static void
+test_raid5_rebuild_base_bdev_data(void)
+{
+	struct raid5_params *params;
+
+	RAID5_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid5_info *r5info;
+		uint64_t stripe;
+		uint8_t base_idx;
+
+		if (params->base_bdev_blockcnt > RAID5_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r5info = io_info->r5info;
+
+		for (stripe = 0; stripe < r5info->total_stripes; stripe++) {
+			write_and_verify(io_info, stripe * r5info->stripe_blocks, r5info->stripe_blocks);
+		}
+
+		/* Rebuilding over a wiped base bdev restores both the data and the parity strips */
+		for (base_idx = 0; base_idx < params->num_base_bdevs; base_idx++) {
+			memset(io_info->descs[base_idx].buf, 0, io_info->base_bdev_size);
+			rebuild_base_bdev(io_info, base_idx, 0);
+			verify_layout(io_info, UINT8_MAX);
+		}
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid5_xor_iovs(void)
+{
+	uint8_t src1[64], src2[64], dest[64], expected[64];
+	struct iovec dest_iovs[3] = {
+		{ .iov_base = dest, .iov_len = 7 },
+		{ .iov_base = dest + 7, .iov_len = 40 },
+		{ .iov_base = dest + 47, .iov_len = 17 },
+	};
+	struct iovec src1_iov = { .iov_base = src1, .iov_len = sizeof(src1) };
+	struct iovec src2_iovs[2] = {
+		{ .iov_base = src2, .iov_len = 33 },
+		{ .iov_base = src2 + 33, .iov_len = 31 },
+	};
+	struct raid_bdev raid_bdev = { .num_base_bdevs = 3 };
+	struct raid5_info r5info = { .raid_bdev = &raid_bdev };
+	struct raid5_xor_vec xor_vecs[4];
+	void *xor_srcs[3];
+	struct raid5_stripe_request r5req = {
+		.r5info = &r5info,
+		.xor_vecs = xor_vecs,
+		.xor_srcs = xor_srcs,
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(dest); i++) {
+		src1[i] = rand();
+		src2[i] = rand();
+		expected[i] = src1[i] ^ src2[i];
+	}
+
+	raid5_xor_init(&r5req, dest_iovs, 3);
+	raid5_xor_add_src(&r5req, &src1_iov, 1);
+	raid5_xor_add_src(&r5req, src2_iovs, 2);
+	CU_ASSERT(raid5_xor_iovs(&r5req, sizeof(dest)) == 0);
+	CU_ASSERT(memcmp(dest, expected, sizeof(dest)) == 0);
+
+	/* dest is also a source */
+	raid5_xor_init(&r5req, dest_iovs, 3);
+	raid5_xor_add_src(&r5req, dest_iovs, 3);
+	raid5_xor_add_src(&r5req, src2_iovs, 2);
+	CU_ASSERT(raid5_xor_iovs(&r5req, sizeof(dest)) == 0);
+	CU_ASSERT(memcmp(dest, src1, sizeof(dest)) == 0);
+}
+
 static void
 test_raid5_start(void)
 {
@@ -205,10 +1199,26 @@ main(int argc, char **argv)
 
 	suite = CU_add_suite("raid5", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_raid5_start);
+	CU_ADD_TEST(suite, test_raid5_xor_iovs);
+	CU_ADD_TEST(suite, test_raid5_full_stripe_write);
+	CU_ADD_TEST(suite, test_raid5_partial_stripe_write);
+	CU_ADD_TEST(suite, test_raid5_degraded_read);
+	CU_ADD_TEST(suite, test_raid5_concurrent_writes);
+	CU_ADD_TEST(suite, test_raid5_stripe_cache);
+	CU_ADD_TEST(suite, test_raid5_write_coalescing);
+	CU_ADD_TEST(suite, test_raid5_degraded_write);
+	CU_ADD_TEST(suite, test_raid5_missing_parity_write);
+	CU_ADD_TEST(suite, test_raid5_rebuild_base_bdev_data);
+
+	allocate_threads(1);
+	set_thread(0);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
 	num_failures = CU_get_number_of_failures();
 	CU_cleanup_registry();
+
+	free_threads();
+
 	return num_failures;
 }
@@ -0,0 +1,970 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE AiRE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+
+#include "bdev/raid/raid6.c"
+#include "common/lib/ut_multithread.c"
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+
+struct spdk_bdev_desc {
+	/* Data of the base bdev */
+	uint8_t *buf;
+
+	/* Fail all IOs submitted to this base bdev */
+	bool fail_io;
+};
+
+struct test_base_io {
+	struct spdk_bdev_io *bdev_io;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+	bool success;
+};
+
+struct test_raid_io {
+	struct iovec iovs[3];
+	bool completed;
+	enum spdk_bdev_io_status status;
+	/* Must be last, followed by struct raid_bdev_io */
+	struct spdk_bdev_io bdev_io;
+};
+
+void
+raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct test_raid_io *io = SPDK_CONTAINEROF(bdev_io, struct test_raid_io, bdev_io);
+
+	CU_ASSERT(io->completed == false);
+	io->completed = true;
+	io->status = status;
+}
+
+void *
+raid_bdev_channel_get_module_ctx(struct raid_bdev_io_channel *raid_ch)
+{
+	return spdk_io_channel_get_ctx(raid_ch->module_channel);
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static void
+test_base_io_complete(void *ctx)
+{
+	struct test_base_io *base_io = ctx;
+
+	base_io->cb(base_io->bdev_io, base_io->success, base_io->cb_arg);
+	free(base_io);
+}
+
+static int
+test_base_io_submit(struct spdk_bdev_desc *desc, struct iovec *iov, int iovcnt,
+		    uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		    void *cb_arg, bool write)
+{
+	struct test_base_io *base_io;
+	struct raid6_chunk *chunk = cb_arg;
+	uint32_t blocklen = 1 << chunk->r6req->r6info->raid_bdev->blocklen_shift;
+	uint8_t *buf = desc->buf + offset_blocks * blocklen;
+	size_t len = 0;
+	int i;
+
+	base_io = calloc(1, sizeof(*base_io));
+	SPDK_CU_ASSERT_FATAL(base_io != NULL);
+	base_io->bdev_io = calloc(1, sizeof(struct spdk_bdev_io));
+	SPDK_CU_ASSERT_FATAL(base_io->bdev_io != NULL);
+	base_io->cb = cb;
+	base_io->cb_arg = cb_arg;
+	base_io->success = !desc->fail_io;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iov[i].iov_len;
+	}
+	CU_ASSERT(len == num_blocks * blocklen);
+
+	if (base_io->success) {
+		for (i = 0; i < iovcnt; i++) {
+			if (write) {
+				memcpy(buf, iov[i].iov_base, iov[i].iov_len);
+			} else {
+				memcpy(iov[i].iov_base, buf, iov[i].iov_len);
+			}
+			buf += iov[i].iov_len;
+		}
+	}
+
+	/* Complete asynchronously, like the bdev layer does */
+	spdk_thread_send_msg(spdk_get_thread(), test_base_io_complete, base_io);
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, false);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return test_base_io_submit(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, true);
+}
+
+struct raid6_params {
+	uint8_t num_base_bdevs;
+	uint64_t base_bdev_blockcnt;
+	uint32_t base_bdev_blocklen;
+	uint32_t strip_size;
+};
+
+/*
+ * A few representative geometries: every array width, both block sizes, single
+ * block and large strips, and a base bdev holding a single stripe.
+ */
+static struct raid6_params g_params[] = {
+	/* num_base_bdevs, base_bdev_blockcnt, base_bdev_blocklen, strip_size (blocks) */
+	{ 4, 64, 512, 8 },
+	{ 5, 16, 4096, 1 },
+	{ 6, 512, 512, 256 },
+	{ 4, 1, 4096, 1 },
+};
+
+#define RAID6_PARAMS_FOR_EACH(p) \
+	for (p = g_params; p < g_params + SPDK_COUNTOF(g_params); p++)
+
+static struct raid_bdev *
+create_raid_bdev(struct raid6_params *params)
+{
+	struct raid_bdev *raid_bdev;
+	struct raid_base_bdev_info *base_info;
+
+	raid_bdev = calloc(1, sizeof(*raid_bdev));
+	SPDK_CU_ASSERT_FATAL(raid_bdev != NULL);
+
+	raid_bdev->module = &g_raid6_module;
+	raid_bdev->num_base_bdevs = params->num_base_bdevs;
+	raid_bdev->base_bdev_info = calloc(raid_bdev->num_base_bdevs,
+					   sizeof(struct raid_base_bdev_info));
+	SPDK_CU_ASSERT_FATAL(raid_bdev->base_bdev_info != NULL);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->bdev = calloc(1, sizeof(*base_info->bdev));
+		SPDK_CU_ASSERT_FATAL(base_info->bdev != NULL);
+
+		base_info->bdev->blockcnt = params->base_bdev_blockcnt;
+		base_info->bdev->blocklen = params->base_bdev_blocklen;
+	}
+
+	raid_bdev->strip_size = params->strip_size;
+	raid_bdev->strip_size_shift = spdk_u32log2(raid_bdev->strip_size);
+	raid_bdev->blocklen_shift = spdk_u32log2(params->base_bdev_blocklen);
+	raid_bdev->bdev.blocklen = params->base_bdev_blocklen;
+
+	return raid_bdev;
+}
+
+static void
+delete_raid_bdev(struct raid_bdev *raid_bdev)
+{
+	struct raid_base_bdev_info *base_info;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		free(base_info->bdev);
+	}
+	free(raid_bdev->base_bdev_info);
+	free(raid_bdev);
+}
+
+static struct raid6_info *
+create_raid6(struct raid6_params *params)
+{
+	struct raid_bdev *raid_bdev = create_raid_bdev(params);
+
+	SPDK_CU_ASSERT_FATAL(raid6_start(raid_bdev) == 0);
+
+	return raid_bdev->module_private;
+}
+
+static void
+delete_raid6(struct raid6_info *r6info)
+{
+	struct raid_bdev *raid_bdev = r6info->raid_bdev;
+
+	raid6_stop(raid_bdev);
+	poll_threads();
+
+	delete_raid_bdev(raid_bdev);
+}
+
+struct raid_io_info {
+	struct raid6_info *r6info;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_io_channel *base_channels[UINT8_MAX];
+	struct spdk_bdev_desc *descs;
+	size_t base_bdev_size;
+	/* Expected content of the raid bdev */
+	uint8_t *data;
+};
+
+static struct raid_io_info *
+create_raid_io_info(struct raid6_params *params)
+{
+	struct raid_io_info *io_info;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	io_info = calloc(1, sizeof(*io_info));
+	SPDK_CU_ASSERT_FATAL(io_info != NULL);
+
+	io_info->r6info = create_raid6(params);
+	io_info->base_bdev_size = params->base_bdev_blockcnt * params->base_bdev_blocklen;
+
+	io_info->descs = calloc(params->num_base_bdevs, sizeof(*io_info->descs));
+	SPDK_CU_ASSERT_FATAL(io_info->descs != NULL);
+
+	i = 0;
+	RAID_FOR_EACH_BASE_BDEV(io_info->r6info->raid_bdev, base_info) {
+		io_info->descs[i].buf = calloc(1, io_info->base_bdev_size);
+		SPDK_CU_ASSERT_FATAL(io_info->descs[i].buf != NULL);
+		base_info->desc = &io_info->descs[i];
+		/* Only the pointer value matters, base channels are not used by the stubs */
+		io_info->base_channels[i] = (struct spdk_io_channel *)0x1;
+		i++;
+	}
+
+	io_info->data = calloc(io_info->r6info->raid_bdev->bdev.blockcnt,
+			       params->base_bdev_blocklen);
+	SPDK_CU_ASSERT_FATAL(io_info->data != NULL);
+
+	io_info->raid_ch = calloc(1, sizeof(*io_info->raid_ch));
+	SPDK_CU_ASSERT_FATAL(io_info->raid_ch != NULL);
+	io_info->raid_ch->base_channel = io_info->base_channels;
+	io_info->raid_ch->num_channels = params->num_base_bdevs;
+	io_info->raid_ch->module_channel = raid6_get_io_channel(io_info->r6info->raid_bdev);
+	SPDK_CU_ASSERT_FATAL(io_info->raid_ch->module_channel != NULL);
+
+	return io_info;
+}
+
+static void
+delete_raid_io_info(struct raid_io_info *io_info)
+{
+	uint8_t i;
+
+	spdk_put_io_channel(io_info->raid_ch->module_channel);
+	poll_threads();
+
+	for (i = 0; i < io_info->r6info->raid_bdev->num_base_bdevs; i++) {
+		free(io_info->descs[i].buf);
+	}
+	free(io_info->descs);
+	free(io_info->raid_ch);
+	free(io_info->data);
+	delete_raid6(io_info->r6info);
+	free(io_info);
+}
+
+static struct test_raid_io *
+start_raid_io(struct raid_io_info *io_info, enum spdk_bdev_io_type type,
+	      uint64_t offset_blocks, uint64_t num_blocks, uint8_t *buf)
+{
+	struct raid_bdev *raid_bdev = io_info->r6info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t len = num_blocks * blocklen;
+	struct test_raid_io *io;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+	struct iovec *iovs;
+	size_t split;
+
+	io = calloc(1, sizeof(*io) + sizeof(*raid_io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	bdev_io = &io->bdev_io;
+	iovs = io->iovs;
+
+	/* Split the payload into unevenly sized iovecs to exercise the iovec mapping */
+	split = len / 3 + 1;
+	iovs[0].iov_base = buf;
+	iovs[0].iov_len = spdk_min(split, len);
+	iovs[1].iov_base = buf + iovs[0].iov_len;
+	iovs[1].iov_len = spdk_min(split / 2, len - iovs[0].iov_len);
+	iovs[2].iov_base = buf + iovs[0].iov_len + iovs[1].iov_len;
+	iovs[2].iov_len = len - iovs[0].iov_len - iovs[1].iov_len;
+
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = iovs;
+	bdev_io->u.bdev.iovcnt = iovs[2].iov_len > 0 ? 3 : (iovs[1].iov_len > 0 ? 2 : 1);
+
+	raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	raid_io->raid_bdev = raid_bdev;
+	raid_io->raid_ch = io_info->raid_ch;
+
+	io->status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	raid6_submit_rw_request(raid_io);
+
+	return io;
+}
+
+static enum spdk_bdev_io_status
+submit_raid_io(struct raid_io_info *io_info, enum spdk_bdev_io_type type,
+	       uint64_t offset_blocks, uint64_t num_blocks, uint8_t *buf)
+{
+	struct test_raid_io *io;
+	enum spdk_bdev_io_status status;
+
+	io = start_raid_io(io_info, type, offset_blocks, num_blocks, buf);
+	poll_threads();
+
+	CU_ASSERT(io->completed == true);
+	status = io->status;
+	free(io);
+
+	return status;
+}
+
+static void
+write_and_verify(struct raid_io_info *io_info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint32_t blocklen = io_info->r6info->raid_bdev->bdev.blocklen;
+	uint8_t *buf;
+	size_t i;
+
+	buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	for (i = 0; i < num_blocks * blocklen; i++) {
+		buf[i] = rand();
+	}
+
+	CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, offset_blocks, num_blocks,
+				 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	memcpy(io_info->data + offset_blocks * blocklen, buf, num_blocks * blocklen);
+
+	free(buf);
+}
+
+static void
+read_and_verify(struct raid_io_info *io_info, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint32_t blocklen = io_info->r6info->raid_bdev->bdev.blocklen;
+	uint8_t *buf;
+
+	buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_READ, offset_blocks, num_blocks,
+				 buf) == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info->data + offset_blocks * blocklen, buf,
+			 num_blocks * blocklen) == 0);
+
+	free(buf);
+}
+
+
+static uint8_t
+test_gf_mul2(uint8_t v)
+{
+	return (v & 0x80) ? (uint8_t)((v << 1) ^ 0x1d) : (uint8_t)(v << 1);
+}
+
+/*
+ * Check that the base bdevs hold the expected data, P and Q parity for each
+ * stripe. Base bdevs set in skip_mask are not checked.
+ */
+static void
+verify_layout(struct raid_io_info *io_info, uint64_t skip_mask)
+{
+	struct raid6_info *r6info = io_info->r6info;
+	struct raid_bdev *raid_bdev = r6info->raid_bdev;
+	size_t strip_bytes = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	uint8_t data_chunks = raid_bdev->num_base_bdevs - 2;
+	uint8_t *p, *q;
+	uint64_t stripe;
+	uint8_t chunk, base_idx;
+	size_t i;
+
+	p = malloc(strip_bytes);
+	q = malloc(strip_bytes);
+	SPDK_CU_ASSERT_FATAL(p != NULL && q != NULL);
+
+	for (stripe = 0; stripe < r6info->total_stripes; stripe++) {
+		memset(p, 0, strip_bytes);
+		memset(q, 0, strip_bytes);
+
+		/* Q = D_0 ^ 2 * (D_1 ^ 2 * (D_2 ^ ...)) */
+		for (chunk = data_chunks; chunk > 0; chunk--) {
+			uint8_t *expected = io_info->data + (stripe * r6info->stripe_blocks +
+							     (chunk - 1) * raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+
+			base_idx = raid_bdev_stripe_data_base_idx(raid_bdev, stripe, chunk - 1);
+			if (!(skip_mask & (1ULL << base_idx))) {
+				CU_ASSERT(memcmp(io_info->descs[base_idx].buf + stripe * strip_bytes,
+						 expected, strip_bytes) == 0);
+			}
+
+			for (i = 0; i < strip_bytes; i++) {
+				p[i] ^= expected[i];
+				q[i] = test_gf_mul2(q[i]) ^ expected[i];
+			}
+		}
+
+		base_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, stripe, 0);
+		if (!(skip_mask & (1ULL << base_idx))) {
+			CU_ASSERT(memcmp(io_info->descs[base_idx].buf + stripe * strip_bytes,
+					 p, strip_bytes) == 0);
+		}
+
+		base_idx = raid_bdev_stripe_parity_base_idx(raid_bdev, stripe, 1);
+		if (!(skip_mask & (1ULL << base_idx))) {
+			CU_ASSERT(memcmp(io_info->descs[base_idx].buf + stripe * strip_bytes,
+					 q, strip_bytes) == 0);
+		}
+	}
+
+	free(p);
+	free(q);
+}
+
+#define RAID6_IO_TEST_MAX_BLOCKCNT 1024
+
+static void
+write_stripes(struct raid_io_info *io_info)
+{
+	struct raid6_info *r6info = io_info->r6info;
+	uint64_t stripe;
+
+	for (stripe = 0; stripe < r6info->total_stripes; stripe++) {
+		write_and_verify(io_info, stripe * r6info->stripe_blocks, r6info->stripe_blocks);
+	}
+}
+
+static void
+read_stripes(struct raid_io_info *io_info)
+{
+	struct raid6_info *r6info = io_info->r6info;
+	uint64_t stripe;
+
+	for (stripe = 0; stripe < r6info->total_stripes; stripe++) {
+		read_and_verify(io_info, stripe * r6info->stripe_blocks, r6info->stripe_blocks);
+		read_and_verify(io_info, stripe * r6info->stripe_blocks + 1, 1);
+		read_and_verify(io_info, stripe * r6info->stripe_blocks + r6info->raid_bdev->strip_size - 1,
+				2);
+	}
+}
+
+/* Partial writes: single block, inside a strip, across a strip boundary and all but one block */
+static void
+partial_write_stripes(struct raid_io_info *io_info)
+{
+	struct raid6_info *r6info = io_info->r6info;
+	uint32_t strip_size = r6info->raid_bdev->strip_size;
+	uint64_t stripe, offsets[4], lengths[4];
+	int i;
+
+	offsets[0] = 0;
+	lengths[0] = 1;
+	offsets[1] = strip_size / 2;
+	lengths[1] = spdk_max(strip_size / 4, 1u);
+	offsets[2] = strip_size - 1;
+	lengths[2] = 2;
+	offsets[3] = 1;
+	lengths[3] = r6info->stripe_blocks - 1;
+
+	for (stripe = 0; stripe < r6info->total_stripes; stripe++) {
+		for (i = 0; i < 4; i++) {
+			write_and_verify(io_info, stripe * r6info->stripe_blocks + offsets[i], lengths[i]);
+		}
+	}
+}
+
+static void
+test_raid6_full_stripe_write(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+
+		write_stripes(io_info);
+		verify_layout(io_info, 0);
+		read_stripes(io_info);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_partial_stripe_write(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+
+		partial_write_stripes(io_info);
+		verify_layout(io_info, 0);
+		read_stripes(io_info);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_degraded_read(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid6_info *r6info;
+		uint8_t i, j, k;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r6info = io_info->r6info;
+
+		write_stripes(io_info);
+
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			/* IO errors from one base bdev are recovered from P or Q */
+			io_info->descs[i].fail_io = true;
+			read_stripes(io_info);
+
+			for (j = i + 1; j < params->num_base_bdevs; j++) {
+				/* Errors from any two base bdevs are recovered too */
+				io_info->descs[j].fail_io = true;
+				read_stripes(io_info);
+
+				/* Errors from three base bdevs can't be recovered */
+				k = (j + 1) % params->num_base_bdevs;
+				if (k == i) {
+					k = (k + 1) % params->num_base_bdevs;
+				}
+				io_info->descs[k].fail_io = true;
+				{
+					uint8_t *buf = malloc(r6info->stripe_blocks * params->base_bdev_blocklen);
+
+					SPDK_CU_ASSERT_FATAL(buf != NULL);
+					CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_READ, 0,
+								 r6info->stripe_blocks, buf) == SPDK_BDEV_IO_STATUS_FAILED);
+					free(buf);
+				}
+				io_info->descs[k].fail_io = false;
+				io_info->descs[j].fail_io = false;
+			}
+			io_info->descs[i].fail_io = false;
+		}
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_degraded_write(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid_bdev *raid_bdev;
+		uint8_t i, j;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		raid_bdev = io_info->r6info->raid_bdev;
+
+		write_stripes(io_info);
+
+		/*
+		 * Missing base bdevs are not accessed at all. The writes keep the
+		 * parity consistent, so that their data can be reconstructed.
+		 */
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			for (j = i; j < params->num_base_bdevs; j++) {
+				uint64_t skip_mask = (1ULL << i) | (1ULL << j);
+
+				raid_bdev->base_bdev_info[i].desc = NULL;
+				raid_bdev->base_bdev_info[j].desc = NULL;
+
+				write_stripes(io_info);
+				verify_layout(io_info, skip_mask);
+				partial_write_stripes(io_info);
+				verify_layout(io_info, skip_mask);
+				read_stripes(io_info);
+
+				raid_bdev->base_bdev_info[i].desc = &io_info->descs[i];
+				raid_bdev->base_bdev_info[j].desc = &io_info->descs[j];
+
+				/* Bring the base bdevs back in sync */
+				write_stripes(io_info);
+				verify_layout(io_info, 0);
+			}
+		}
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_partial_write_read_error(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid6_info *r6info;
+		uint8_t i;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r6info = io_info->r6info;
+
+		write_stripes(io_info);
+
+		/*
+		 * The old data that can't be read is reconstructed. The write fails
+		 * only if it has to update the failed base bdev, but the other base
+		 * bdevs are updated anyway.
+		 */
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			struct raid_bdev *raid_bdev = r6info->raid_bdev;
+			uint32_t blocklen = params->base_bdev_blocklen;
+			enum spdk_bdev_io_status expected_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+			uint8_t *buf = malloc(blocklen);
+			uint8_t data_idx;
+
+			SPDK_CU_ASSERT_FATAL(buf != NULL);
+			memset(buf, i + 1, blocklen);
+
+			/* Write the first block of the first data chunk not on the failed base bdev */
+			for (data_idx = 0; data_idx < params->num_base_bdevs - 2; data_idx++) {
+				if (raid_bdev_stripe_data_base_idx(raid_bdev, 0, data_idx) != i) {
+					break;
+				}
+			}
+
+			if (raid_bdev_stripe_parity_base_idx(raid_bdev, 0, 0) == i ||
+			    raid_bdev_stripe_parity_base_idx(raid_bdev, 0, 1) == i) {
+				expected_status = SPDK_BDEV_IO_STATUS_FAILED;
+			}
+
+			io_info->descs[i].fail_io = true;
+			CU_ASSERT(submit_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE,
+						 data_idx * raid_bdev->strip_size, 1, buf) == expected_status);
+			memcpy(io_info->data + data_idx * raid_bdev->strip_size * blocklen, buf, blocklen);
+			verify_layout(io_info, 1ULL << i);
+			io_info->descs[i].fail_io = false;
+
+			write_stripes(io_info);
+			free(buf);
+		}
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_concurrent_writes(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid6_info *r6info;
+		struct test_raid_io *ios[4];
+		uint32_t blocklen = params->base_bdev_blocklen;
+		uint64_t offsets[4], stripe_offset;
+		uint8_t *bufs[4];
+		int i;
+		size_t j;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		r6info = io_info->r6info;
+
+		/*
+		 * Partial writes to different blocks of the same stripe submitted at
+		 * once, followed by a full stripe write of the next stripe.
+		 */
+		stripe_offset = r6info->total_stripes > 1 ? r6info->stripe_blocks : 0;
+		offsets[0] = 0;
+		offsets[1] = r6info->raid_bdev->strip_size;
+		offsets[2] = r6info->stripe_blocks - 1;
+		offsets[3] = stripe_offset;
+
+		for (i = 0; i < 4; i++) {
+			uint64_t num_blocks = i == 3 ? r6info->stripe_blocks : 1;
+
+			bufs[i] = malloc(num_blocks * blocklen);
+			SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+			for (j = 0; j < num_blocks * blocklen; j++) {
+				bufs[i][j] = rand();
+			}
+			ios[i] = start_raid_io(io_info, SPDK_BDEV_IO_TYPE_WRITE, offsets[i], num_blocks,
+					       bufs[i]);
+		}
+
+		poll_threads();
+
+		for (i = 0; i < 4; i++) {
+			uint64_t num_blocks = i == 3 ? r6info->stripe_blocks : 1;
+
+			CU_ASSERT(ios[i]->completed == true);
+			CU_ASSERT(ios[i]->status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			memcpy(io_info->data + offsets[i] * blocklen, bufs[i], num_blocks * blocklen);
+			free(ios[i]);
+			free(bufs[i]);
+		}
+
+		verify_layout(io_info, 0);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+/* Regenerate the content of a base bdev from the data of the raid bdev, starting at a stripe */
+static void
+rebuild_base_bdev(struct raid_io_info *io_info, uint8_t base_idx, uint64_t start_stripe)
+{
+	struct raid6_info *r6info = io_info->r6info;
+	struct raid_bdev *raid_bdev = r6info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t num_blocks = (r6info->total_stripes - start_stripe) * raid_bdev->strip_size;
+	uint8_t *base_buf;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	base_buf = malloc(num_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(base_buf != NULL);
+
+	CU_ASSERT(raid6_rebuild_base_bdev_data(raid_bdev, base_idx,
+					       start_stripe * raid_bdev->strip_size, num_blocks,
+					       io_info->data + start_stripe * r6info->stripe_blocks * blocklen,
+					       base_buf) == 0);
+	memcpy(io_info->descs[base_idx].buf + start_stripe * raid_bdev->strip_size * blocklen,
+	       base_buf, num_blocks * blocklen);
+
+	free(base_buf);
+}
+
+static void
+test_raid6_rebuild(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid_io_info *io_info;
+		struct raid_base_bdev_info *base_info;
+		uint8_t base_idx;
+
+		if (params->base_bdev_blockcnt > RAID6_IO_TEST_MAX_BLOCKCNT) {
+			continue;
+		}
+
+		io_info = create_raid_io_info(params);
+		write_stripes(io_info);
+
+		/* Rebuilding over a wiped base bdev restores the data, P and Q strips */
+		for (base_idx = 0; base_idx < params->num_base_bdevs; base_idx++) {
+			memset(io_info->descs[base_idx].buf, 0, io_info->base_bdev_size);
+			rebuild_base_bdev(io_info, base_idx, 0);
+			verify_layout(io_info, 0);
+		}
+
+		/* Base bdevs being rebuilt are written only below the rebuild checkpoint */
+		base_info = &io_info->r6info->raid_bdev->base_bdev_info[0];
+		base_info->rebuilding = true;
+		base_info->rebuild_checkpoint = io_info->r6info->raid_bdev->strip_size;
+		partial_write_stripes(io_info);
+		verify_layout(io_info, 1);
+		read_stripes(io_info);
+		rebuild_base_bdev(io_info, 0, 1);
+		base_info->rebuilding = false;
+		verify_layout(io_info, 0);
+
+		delete_raid_io_info(io_info);
+	}
+}
+
+static void
+test_raid6_pq_gen_iovs(void)
+{
+	uint8_t src1[64], src2[64], src3[64], p[64], q[64], expected_p[64], expected_q[64];
+	struct iovec src1_iov = { .iov_base = src1, .iov_len = sizeof(src1) };
+	struct iovec src2_iovs[2] = {
+		{ .iov_base = src2, .iov_len = 33 },
+		{ .iov_base = src2 + 33, .iov_len = 31 },
+	};
+	struct iovec src3_iovs[3] = {
+		{ .iov_base = src3, .iov_len = 7 },
+		{ .iov_base = src3 + 7, .iov_len = 40 },
+		{ .iov_base = src3 + 47, .iov_len = 17 },
+	};
+	struct iovec *src_iovs[] = { &src1_iov, src2_iovs, src3_iovs };
+	int src_iovcnts[] = { 1, 2, 3 };
+	size_t i;
+
+	for (i = 0; i < sizeof(p); i++) {
+		src1[i] = rand();
+		src2[i] = rand();
+		src3[i] = rand();
+		expected_p[i] = src1[i] ^ src2[i] ^ src3[i];
+		expected_q[i] = src1[i] ^ test_gf_mul2(src2[i] ^ test_gf_mul2(src3[i]));
+	}
+
+	CU_ASSERT(raid6_pq_gen_iovs(p, q, src_iovs, src_iovcnts, 3, sizeof(p)) == 0);
+	CU_ASSERT(memcmp(p, expected_p, sizeof(p)) == 0);
+	CU_ASSERT(memcmp(q, expected_q, sizeof(q)) == 0);
+}
+
+static void
+test_raid6_gf(void)
+{
+	unsigned int a, b;
+
+	raid6_gf_init();
+
+	for (a = 1; a < 256; a++) {
+		CU_ASSERT(raid6_gf_mul(a, raid6_gf_inv(a)) == 1);
+		CU_ASSERT(raid6_gf_mul(a, 2) == test_gf_mul2(a));
+		CU_ASSERT(raid6_gf_mul(a, 0) == 0);
+		for (b = 1; b < 256; b++) {
+			CU_ASSERT(raid6_gf_mul(a, b) == raid6_gf_mul(b, a));
+		}
+	}
+
+	CU_ASSERT(raid6_gf_pow2(0) == 1);
+	CU_ASSERT(raid6_gf_pow2(8) == 0x1d);
+	CU_ASSERT(raid6_gf_pow2(255) == 1);
+}
+
+static void
+test_raid6_start(void)
+{
+	struct raid6_params *params;
+
+	RAID6_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6info;
+
+		r6info = create_raid6(params);
+
+		CU_ASSERT_EQUAL(r6info->stripe_blocks, params->strip_size * (params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6info->total_stripes, params->base_bdev_blockcnt / params->strip_size);
+		CU_ASSERT_EQUAL(r6info->raid_bdev->bdev.blockcnt,
+				(params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size) *
+				(params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6info->raid_bdev->bdev.optimal_io_boundary, r6info->stripe_blocks);
+
+		delete_raid6(r6info);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("raid6", NULL, NULL);
+	CU_ADD_TEST(suite, test_raid6_start);
+	CU_ADD_TEST(suite, test_raid6_gf);
+	CU_ADD_TEST(suite, test_raid6_pq_gen_iovs);
+	CU_ADD_TEST(suite, test_raid6_full_stripe_write);
+	CU_ADD_TEST(suite, test_raid6_partial_stripe_write);
+	CU_ADD_TEST(suite, test_raid6_degraded_read);
+	CU_ADD_TEST(suite, test_raid6_degraded_write);
+	CU_ADD_TEST(suite, test_raid6_partial_write_read_error);
+	CU_ADD_TEST(suite, test_raid6_concurrent_writes);
+	CU_ADD_TEST(suite, test_raid6_rebuild);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
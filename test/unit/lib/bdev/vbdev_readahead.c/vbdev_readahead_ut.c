@@ -0,0 +1,371 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "common/lib/ut_multithread.c"
+#include "bdev/readahead/vbdev_readahead.c"
+
+#define BLOCK_SIZE	4096
+#define BLOCK_CNT	(1024 * 1024)
+/* 16 blocks */
+#define MIN_WINDOW_KB	64
+/* 64 blocks */
+#define MAX_WINDOW_KB	256
+
+#define UT_VBDEV_IO_CTX_SIZE		sizeof(struct ra_bdev_io)
+#define UT_VBDEV_SUBMIT_REQUEST		vbdev_readahead_submit_request
+#include "common/lib/ut_base_bdev.c"
+
+/* Read and complete a block range.  Returns true if it was served without the base bdev. */
+static bool
+ut_read(struct spdk_bdev *bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct ut_base_io *io;
+	bool hit = true;
+
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, offset_blocks, num_blocks, 0);
+
+	/* Complete the base read of this I/O, leaving prefetches outstanding */
+	TAILQ_FOREACH(io, &g_base_ios, link) {
+		if (io->cb_arg == bdev_io) {
+			TAILQ_REMOVE(&g_base_ios, io, link);
+			TAILQ_INSERT_HEAD(&g_base_ios, io, link);
+			ut_complete_base_io(true);
+			hit = false;
+			break;
+		}
+	}
+
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_check_lba(bdev_io->u.bdev.iovs[0].iov_base, offset_blocks, num_blocks));
+	ut_free_io(bdev_io);
+
+	return hit;
+}
+
+static struct spdk_bdev *
+ut_create(uint32_t max_streams, uint32_t buffer_pool_mb)
+{
+	struct vbdev_readahead_opts opts = {
+		.min_window_kb = MIN_WINDOW_KB,
+		.max_window_kb = MAX_WINDOW_KB,
+		.buffer_pool_mb = buffer_pool_mb,
+		.max_streams = max_streams,
+	};
+	struct vbdev_readahead *ra_node;
+
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == 0);
+	ra_node = TAILQ_FIRST(&g_ra_nodes);
+	SPDK_CU_ASSERT_FATAL(ra_node != NULL);
+
+	ut_vbdev_open_channel(ra_node);
+
+	return &ra_node->ra_bdev;
+}
+
+static void
+ut_destroy(struct spdk_bdev *bdev)
+{
+	ut_vbdev_destroy(bdev, bdev_readahead_delete_disk);
+	CU_ASSERT(TAILQ_EMPTY(&g_ra_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_readahead_names));
+}
+
+static struct ra_io_channel *
+ut_ra_ch(void)
+{
+	return spdk_io_channel_get_ctx(g_ch);
+}
+
+static void
+test_create_invalid(void)
+{
+	struct vbdev_readahead_opts opts = {
+		.min_window_kb = MIN_WINDOW_KB,
+		.max_window_kb = MAX_WINDOW_KB,
+		.buffer_pool_mb = 1,
+		.max_streams = 1,
+	};
+
+	opts.min_window_kb = 0;
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == -EINVAL);
+	opts.min_window_kb = MAX_WINDOW_KB * 2;
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == -EINVAL);
+	opts.min_window_kb = MIN_WINDOW_KB;
+	opts.max_streams = 0;
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == -EINVAL);
+	opts.max_streams = 1;
+	opts.max_window_kb = 2048;
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == -EINVAL);
+
+	/* Bdevs with metadata are not supported */
+	opts.max_window_kb = MAX_WINDOW_KB;
+	g_base_bdev.md_len = 8;
+	CU_ASSERT(bdev_readahead_create_disk("base0", "ra0", &opts) == -ENOTSUP);
+	g_base_bdev.md_len = 0;
+	CU_ASSERT(TAILQ_EMPTY(&g_ra_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_readahead_names));
+}
+
+static void
+test_sequential(void)
+{
+	struct spdk_bdev *bdev = ut_create(4, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	struct ut_base_io *io;
+	uint64_t offset;
+
+	/* A single read doesn't make a stream */
+	CU_ASSERT(!ut_read(bdev, 0, 4));
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 0);
+
+	/* The second one starts prefetching the minimum window after it */
+	CU_ASSERT(!ut_read(bdev, 4, 4));
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 1);
+	io = ut_last_base_io();
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	CU_ASSERT(io->offset_blocks == 8);
+	CU_ASSERT(io->num_blocks == 16);
+	ut_complete_base_io(true);
+
+	/* Blocks 8-23 are served from memory.  Once half of them were read, the next
+	 * window gets prefetched.
+	 */
+	CU_ASSERT(ut_read(bdev, 8, 4));
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 1);
+	CU_ASSERT(ut_read(bdev, 12, 4));
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 2);
+	io = ut_last_base_io();
+	CU_ASSERT(io->offset_blocks == 24);
+	CU_ASSERT(io->num_blocks == 16);
+	ut_complete_base_io(true);
+
+	/* A read spanning both buffers is a hit too */
+	CU_ASSERT(ut_read(bdev, 16, 4));
+	CU_ASSERT(ut_read(bdev, 20, 8));
+
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 2);
+
+	/* The first window was fully read, so the next one is twice as large */
+	CU_ASSERT(ut_read(bdev, 28, 4));
+	CU_ASSERT(ra_ch->streams[0].window_blocks == 32);
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 3);
+	io = ut_last_base_io();
+	CU_ASSERT(io->offset_blocks == 40);
+	CU_ASSERT(io->num_blocks == 32);
+
+	/* Keep reading, the window is capped at the maximum */
+	for (offset = 32; offset < 1024; offset += 4) {
+		ut_complete_all_base_io();
+		CU_ASSERT(ut_read(bdev, offset, 4));
+	}
+	CU_ASSERT(ra_ch->streams[0].window_blocks == 64);
+	TAILQ_FOREACH(io, &g_base_ios, link) {
+		CU_ASSERT(io->num_blocks == 64);
+	}
+
+	CU_ASSERT(ra_ch->stats.read_ios == 2 + 4 + (1024 - 28) / 4);
+	CU_ASSERT(ra_ch->stats.read_hits == 4 + (1024 - 28) / 4);
+	CU_ASSERT(ra_ch->stats.wasted_blocks == 0);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_wait_for_prefetch(void)
+{
+	struct spdk_bdev *bdev = ut_create(1, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	struct spdk_bdev_io *bdev_io;
+
+	CU_ASSERT(!ut_read(bdev, 100, 4));
+	CU_ASSERT(!ut_read(bdev, 104, 4));
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 1);
+
+	/* The prefetch is still outstanding, the read waits for it */
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, 108, 4, 0);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(g_num_base_ios == 3);
+
+	ut_complete_base_io(true);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_check_lba(bdev_io->u.bdev.iovs[0].iov_base, 108, 4));
+	CU_ASSERT(ra_ch->stats.read_hits == 1);
+	ut_free_io(bdev_io);
+
+	/* If the prefetch fails, waiting reads are sent to the base bdev */
+	CU_ASSERT(ut_read(bdev, 112, 4));
+	CU_ASSERT(ut_read(bdev, 116, 4));
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_READ, 124, 4, 0);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	ut_complete_base_io(false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	ut_complete_base_io(true);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(ut_check_lba(bdev_io->u.bdev.iovs[0].iov_base, 124, 4));
+	ut_free_io(bdev_io);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_write_invalidates(void)
+{
+	struct spdk_bdev *bdev = ut_create(1, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	struct spdk_bdev_io *bdev_io;
+
+	CU_ASSERT(!ut_read(bdev, 0, 4));
+	CU_ASSERT(!ut_read(bdev, 4, 4));
+	ut_complete_base_io(true);
+	CU_ASSERT(ut_read(bdev, 8, 4));
+
+	/* A write to the prefetched range drops the buffer */
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_WRITE, 20, 1, 0);
+	ut_complete_base_io(true);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	ut_free_io(bdev_io);
+
+	CU_ASSERT(!ut_read(bdev, 12, 4));
+	CU_ASSERT(ra_ch->stats.wasted_blocks == 12);
+
+	/* A prefetch outstanding while a write is submitted is not used either */
+	ut_complete_all_base_io();
+	CU_ASSERT(!ut_read(bdev, 1000, 4));
+	CU_ASSERT(!ut_read(bdev, 1004, 4));
+	bdev_io = ut_submit(bdev, SPDK_BDEV_IO_TYPE_WRITE, 1010, 1, 0);
+	ut_complete_all_base_io();
+	ut_free_io(bdev_io);
+	CU_ASSERT(!ut_read(bdev, 1008, 4));
+
+	ut_destroy(bdev);
+}
+
+static void
+test_interleaved_streams(void)
+{
+	struct spdk_bdev *bdev = ut_create(2, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	uint64_t i;
+
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT(!ut_read(bdev, i * 4, 4));
+		CU_ASSERT(!ut_read(bdev, 50000 + i * 4, 4));
+	}
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 2);
+
+	for (i = 2; i < 64; i++) {
+		ut_complete_all_base_io();
+		CU_ASSERT(ut_read(bdev, i * 4, 4));
+		CU_ASSERT(ut_read(bdev, 50000 + i * 4, 4));
+	}
+
+	/* A third stream replaces the least recently used one */
+	CU_ASSERT(!ut_read(bdev, 90000, 4));
+	CU_ASSERT(ut_read(bdev, 50000 + 64 * 4, 4));
+	CU_ASSERT(!ut_read(bdev, 64 * 4, 4));
+	CU_ASSERT(ra_ch->stats.wasted_blocks > 0);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_random(void)
+{
+	struct spdk_bdev *bdev = ut_create(4, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	uint64_t i;
+
+	for (i = 0; i < 100; i++) {
+		CU_ASSERT(!ut_read(bdev, (i * 7919) % 100000 * 8, 8));
+	}
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 0);
+	CU_ASSERT(g_num_base_ios == 100);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_pool_exhausted(void)
+{
+	/* A 1 MiB pool holds 4 maximum size windows */
+	struct spdk_bdev *bdev = ut_create(8, 1);
+	struct ra_io_channel *ra_ch = ut_ra_ch();
+	uint64_t i;
+
+	for (i = 0; i < 8; i++) {
+		CU_ASSERT(!ut_read(bdev, i * 10000, 4));
+		CU_ASSERT(!ut_read(bdev, i * 10000 + 4, 4));
+	}
+	CU_ASSERT(ra_ch->stats.prefetch_ios == 4);
+	CU_ASSERT(spdk_mempool_count(((struct vbdev_readahead *)bdev->ctxt)->pool) == 0);
+
+	ut_destroy(bdev);
+}
+
+static int
+ut_init(void)
+{
+	g_base_io_data_fn = ut_base_io_fill_lba;
+	return ut_base_init();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_readahead", ut_init, ut_base_fini);
+	CU_ADD_TEST(suite, test_create_invalid);
+	CU_ADD_TEST(suite, test_sequential);
+	CU_ADD_TEST(suite, test_wait_for_prefetch);
+	CU_ADD_TEST(suite, test_write_invalidates);
+	CU_ADD_TEST(suite, test_interleaved_streams);
+	CU_ADD_TEST(suite, test_random);
+	CU_ADD_TEST(suite, test_pool_exhausted);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
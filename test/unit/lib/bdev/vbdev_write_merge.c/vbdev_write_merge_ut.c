@@ -0,0 +1,396 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "common/lib/ut_multithread.c"
+#include "bdev/write_merge/vbdev_write_merge.c"
+
+#define BLOCK_SIZE	4096
+#define BLOCK_CNT	(1024 * 1024)
+#define WINDOW_US	100
+/* 16 blocks */
+#define MAX_MERGE_KB	64
+
+#define UT_VBDEV_IO_CTX_SIZE		sizeof(struct wm_bdev_io)
+#define UT_VBDEV_SUBMIT_REQUEST		vbdev_write_merge_submit_request
+#include "common/lib/ut_base_bdev.c"
+
+/* The data is never touched, only the iovecs are checked */
+static struct spdk_bdev_io *
+ut_submit_wm(struct spdk_bdev *bdev, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	     uint64_t num_blocks)
+{
+	return ut_submit_buf(bdev, type, offset_blocks, num_blocks,
+			     (void *)(uintptr_t)(offset_blocks * BLOCK_SIZE));
+}
+
+static struct spdk_bdev *
+ut_create(uint32_t merge_window_us, uint32_t max_merge_kb)
+{
+	struct vbdev_write_merge_opts opts = {
+		.merge_window_us = merge_window_us,
+		.max_merge_kb = max_merge_kb,
+	};
+	struct vbdev_write_merge *wm_node;
+
+	CU_ASSERT(bdev_write_merge_create_disk("base0", "wm0", &opts) == 0);
+	wm_node = TAILQ_FIRST(&g_wm_nodes);
+	SPDK_CU_ASSERT_FATAL(wm_node != NULL);
+
+	ut_vbdev_open_channel(wm_node);
+
+	return &wm_node->wm_bdev;
+}
+
+static void
+ut_destroy(struct spdk_bdev *bdev)
+{
+	ut_vbdev_destroy(bdev, bdev_write_merge_delete_disk);
+	CU_ASSERT(TAILQ_EMPTY(&g_wm_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_write_merge_names));
+}
+
+static struct wm_io_channel *
+ut_wm_ch(void)
+{
+	return spdk_io_channel_get_ctx(g_ch);
+}
+
+static void
+ut_wait_window(void)
+{
+	spdk_delay_us(WINDOW_US);
+	poll_threads();
+}
+
+static void
+test_create_invalid(void)
+{
+	struct vbdev_write_merge_opts opts = {
+		.merge_window_us = WINDOW_US,
+		.max_merge_kb = 0,
+	};
+
+	CU_ASSERT(bdev_write_merge_create_disk("base0", "wm0", &opts) == -EINVAL);
+
+	/* Bdevs with metadata are not supported */
+	opts.max_merge_kb = MAX_MERGE_KB;
+	g_base_bdev.md_len = 8;
+	CU_ASSERT(bdev_write_merge_create_disk("base0", "wm0", &opts) == -ENOTSUP);
+	g_base_bdev.md_len = 0;
+	CU_ASSERT(TAILQ_EMPTY(&g_wm_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_write_merge_names));
+}
+
+static void
+test_merge_adjacent(void)
+{
+	struct spdk_bdev *bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+	struct wm_io_channel *wm_ch = ut_wm_ch();
+	struct spdk_bdev_io *ios[4];
+	struct ut_base_io *io;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		ios[i] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 8 + i * 2, 2);
+	}
+
+	/* Held until the window expires */
+	poll_threads();
+	CU_ASSERT(g_num_base_ios == 0);
+	ut_wait_window();
+	CU_ASSERT(g_num_base_ios == 1);
+
+	io = TAILQ_FIRST(&g_base_ios);
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	CU_ASSERT(io->type == SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(io->offset_blocks == 8);
+	CU_ASSERT(io->num_blocks == 8);
+	SPDK_CU_ASSERT_FATAL(io->iovcnt == 4);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(io->iovs[i].iov_base == ios[i]->u.bdev.iovs[0].iov_base);
+		CU_ASSERT(io->iovs[i].iov_len == 2 * BLOCK_SIZE);
+	}
+
+	CU_ASSERT(g_num_completions == 0);
+	ut_complete_base_io(true);
+	CU_ASSERT(g_num_completions == 4);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(ios[i]);
+	}
+
+	CU_ASSERT(wm_ch->stats.write_ios == 4);
+	CU_ASSERT(wm_ch->stats.base_write_ios == 1);
+	CU_ASSERT(wm_ch->stats.merged_ios == 1);
+	CU_ASSERT(wm_ch->stats.window_flushes == 1);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_non_adjacent(void)
+{
+	struct spdk_bdev *bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+	struct wm_io_channel *wm_ch = ut_wm_ch();
+	struct spdk_bdev_io *ios[3];
+	struct ut_base_io *io;
+	int i;
+
+	/* A write that doesn't follow the pending run sends it */
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 2);
+	ios[1] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 100, 2);
+	CU_ASSERT(g_num_base_ios == 1);
+	io = TAILQ_FIRST(&g_base_ios);
+	CU_ASSERT(io->offset_blocks == 0);
+	CU_ASSERT(io->num_blocks == 2);
+
+	/* Neither does a write preceding it */
+	ios[2] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 98, 2);
+	CU_ASSERT(g_num_base_ios == 2);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	CU_ASSERT(io->offset_blocks == 100);
+
+	ut_wait_window();
+	CU_ASSERT(g_num_base_ios == 3);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	CU_ASSERT(io->offset_blocks == 98);
+
+	ut_complete_all_base_io();
+	CU_ASSERT(g_num_completions == 3);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(ios[i]);
+	}
+
+	CU_ASSERT(wm_ch->stats.write_ios == 3);
+	CU_ASSERT(wm_ch->stats.base_write_ios == 3);
+	CU_ASSERT(wm_ch->stats.merged_ios == 0);
+	CU_ASSERT(wm_ch->stats.window_flushes == 1);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_max_merge(void)
+{
+	struct spdk_bdev *bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+	struct wm_io_channel *wm_ch = ut_wm_ch();
+	struct spdk_bdev_io *ios[4];
+	struct ut_base_io *io;
+	int i;
+
+	/* A run reaching the maximum size is sent right away */
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 8);
+	ios[1] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 8, 8);
+	CU_ASSERT(g_num_base_ios == 1);
+	io = TAILQ_FIRST(&g_base_ios);
+	CU_ASSERT(io->offset_blocks == 0);
+	CU_ASSERT(io->num_blocks == 16);
+	CU_ASSERT(io->iovcnt == 2);
+
+	/* One that would exceed it starts a new run */
+	ios[2] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 16, 12);
+	ios[3] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 28, 8);
+	CU_ASSERT(g_num_base_ios == 2);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	CU_ASSERT(io->offset_blocks == 16);
+	CU_ASSERT(io->num_blocks == 12);
+	CU_ASSERT(wm_ch->pending != NULL);
+	ut_wait_window();
+	CU_ASSERT(g_num_base_ios == 3);
+
+	ut_complete_all_base_io();
+	CU_ASSERT(g_num_completions == 4);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(ios[i]);
+	}
+
+	/* Writes of the maximum size aren't held at all */
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 64, 32);
+	CU_ASSERT(g_num_base_ios == 4);
+	CU_ASSERT(wm_ch->pending == NULL);
+	ut_complete_base_io(true);
+	CU_ASSERT(ios[0]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	free(ios[0]);
+
+	CU_ASSERT(wm_ch->stats.write_ios == 5);
+	CU_ASSERT(wm_ch->stats.base_write_ios == 4);
+	CU_ASSERT(wm_ch->stats.merged_ios == 1);
+
+	ut_destroy(bdev);
+}
+
+static void
+test_boundary(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_io *ios[3];
+	struct ut_base_io *io;
+	int i;
+
+	g_base_bdev.optimal_io_boundary = 8;
+	g_base_bdev.split_on_optimal_io_boundary = true;
+	bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+
+	/* The run ends on the boundary of the base bdev and the next one starts there */
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 4, 2);
+	ios[1] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 6, 2);
+	CU_ASSERT(g_num_base_ios == 1);
+	io = TAILQ_FIRST(&g_base_ios);
+	CU_ASSERT(io->offset_blocks == 4);
+	CU_ASSERT(io->num_blocks == 4);
+
+	ios[2] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 8, 2);
+	CU_ASSERT(g_num_base_ios == 1);
+	ut_wait_window();
+	CU_ASSERT(g_num_base_ios == 2);
+
+	ut_complete_all_base_io();
+	CU_ASSERT(g_num_completions == 3);
+	for (i = 0; i < 3; i++) {
+		free(ios[i]);
+	}
+
+	ut_destroy(bdev);
+	g_base_bdev.optimal_io_boundary = 0;
+	g_base_bdev.split_on_optimal_io_boundary = false;
+}
+
+static void
+test_ordering(void)
+{
+	struct spdk_bdev *bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+	struct wm_io_channel *wm_ch = ut_wm_ch();
+	struct spdk_bdev_io *ios[5];
+	struct ut_base_io *io;
+	int i;
+
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 4);
+
+	/* A read of other blocks passes the held write */
+	ios[1] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_READ, 100, 4);
+	CU_ASSERT(g_num_base_ios == 1);
+	CU_ASSERT(wm_ch->pending != NULL);
+
+	/* One of the same blocks doesn't */
+	ios[2] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_READ, 2, 4);
+	CU_ASSERT(g_num_base_ios == 3);
+	CU_ASSERT(wm_ch->pending == NULL);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	CU_ASSERT(io->type == SPDK_BDEV_IO_TYPE_READ);
+	io = TAILQ_PREV(io, ut_base_io_list, link);
+	CU_ASSERT(io->type == SPDK_BDEV_IO_TYPE_WRITE);
+
+	/* Nor does a flush */
+	ios[3] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 4, 4);
+	ios[4] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_FLUSH, 0, BLOCK_CNT);
+	CU_ASSERT(g_num_base_ios == 5);
+	io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	CU_ASSERT(io->type == SPDK_BDEV_IO_TYPE_FLUSH);
+	io = TAILQ_PREV(io, ut_base_io_list, link);
+	CU_ASSERT(io->type == SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(io->offset_blocks == 4);
+
+	ut_complete_all_base_io();
+	CU_ASSERT(g_num_completions == 5);
+	for (i = 0; i < 5; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(ios[i]);
+	}
+
+	ut_destroy(bdev);
+}
+
+static void
+test_failure(void)
+{
+	struct spdk_bdev *bdev = ut_create(WINDOW_US, MAX_MERGE_KB);
+	struct wm_io_channel *wm_ch = ut_wm_ch();
+	struct spdk_bdev_io *ios[3];
+	int i;
+
+	/* A failed merged write fails every write it carried */
+	for (i = 0; i < 3; i++) {
+		ios[i] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, i, 1);
+	}
+	ut_wait_window();
+	CU_ASSERT(g_num_base_ios == 1);
+	ut_complete_base_io(false);
+	CU_ASSERT(g_num_completions == 3);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(ios[i]->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+		free(ios[i]);
+	}
+
+	/* The run is reused afterwards */
+	CU_ASSERT(!TAILQ_EMPTY(&wm_ch->free_runs));
+	ios[0] = ut_submit_wm(bdev, SPDK_BDEV_IO_TYPE_WRITE, 0, 1);
+	CU_ASSERT(TAILQ_EMPTY(&wm_ch->free_runs));
+	ut_wait_window();
+	ut_complete_base_io(true);
+	CU_ASSERT(ios[0]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	free(ios[0]);
+
+	ut_destroy(bdev);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_write_merge", ut_base_init, ut_base_fini);
+	CU_ADD_TEST(suite, test_create_invalid);
+	CU_ADD_TEST(suite, test_merge_adjacent);
+	CU_ADD_TEST(suite, test_non_adjacent);
+	CU_ADD_TEST(suite, test_max_merge);
+	CU_ADD_TEST(suite, test_boundary);
+	CU_ADD_TEST(suite, test_ordering);
+	CU_ADD_TEST(suite, test_failure);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
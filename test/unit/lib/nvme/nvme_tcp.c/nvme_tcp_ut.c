@@ -578,7 +578,25 @@ test_nvme_tcp_req_init(void)
 	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.subtype == SPDK_NVME_SGL_SUBTYPE_OFFSET);
 	CU_ASSERT(req.cmd.dptr.sgl1.unkeyed.length == req.payload_size);
 	CU_ASSERT(req.cmd.dptr.sgl1.address == 0);
+	CU_ASSERT(tcp_req.c2h_direct == false);
+	CU_ASSERT(tqpair.num_c2h_direct_reqs == 0);
 
+	/* Test case3: C2H data large enough to be received directly. Expect: PASS */
+	memset(&req.cmd, 0, sizeof(req.cmd));
+	memset(&tcp_req, 0, sizeof(tcp_req));
+	tcp_req.cid = 1;
+	tcp_req.state = NVME_TCP_REQ_ACTIVE;
+	req.cmd.opc = SPDK_NVME_OPC_READ;
+	TAILQ_INIT(&tqpair.free_reqs);
+
+	rc = nvme_tcp_req_init(&tqpair, &req, &tcp_req);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(tcp_req.in_capsule_data == false);
+	CU_ASSERT(tcp_req.c2h_direct == true);
+	CU_ASSERT(tqpair.num_c2h_direct_reqs == 1);
+
+	nvme_tcp_req_put(&tqpair, &tcp_req);
+	CU_ASSERT(tqpair.num_c2h_direct_reqs == 0);
 }
 
 static void
@@ -720,6 +738,7 @@ test_nvme_tcp_qpair_write_pdu(void)
 {
 	struct nvme_tcp_qpair tqpair = {};
 	struct spdk_nvme_tcp_stat stats = {};
+	struct nvme_tcp_poll_group poll_group = {};
 	struct nvme_tcp_pdu pdu = {};
 	void *cb_arg = (void *)0xDEADBEEF;
 	char iov_base0[4096];
@@ -799,6 +818,39 @@ test_nvme_tcp_qpair_write_pdu(void)
 	CU_ASSERT(pdu.cb_arg == cb_arg);
 	CU_ASSERT(pdu.qpair == &tqpair);
 	CU_ASSERT(pdu.sock_req.cb_arg == (void *)&pdu);
+
+	/* Test case3: connected qpair in a poll group, header digest is batched Expect: PASS */
+	memset(pdu.hdr.raw, 0, SPDK_NVME_TCP_TERM_REQ_PDU_MAX_SIZE);
+	STAILQ_INIT(&poll_group.group.connected_qpairs);
+	STAILQ_INIT(&poll_group.group.disconnected_qpairs);
+	TAILQ_INIT(&poll_group.hdgst_pdus);
+	STAILQ_INSERT_TAIL(&poll_group.group.connected_qpairs, &tqpair.qpair, poll_group_stailq);
+	tqpair.qpair.poll_group = &poll_group.group;
+	tqpair.qpair.poll_group_tailq_head = &poll_group.group.connected_qpairs;
+	nvme_qpair_set_state(&tqpair.qpair, NVME_QPAIR_CONNECTED);
+
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD;
+	pdu.hdr.common.hlen = sizeof(struct spdk_nvme_tcp_cmd);
+	pdu.hdr.common.plen = pdu.hdr.common.hlen + SPDK_NVME_TCP_DIGEST_LEN + pdu.data_len;
+	tqpair.flags.host_hdgst_enable = 1;
+
+	nvme_tcp_qpair_write_pdu(&tqpair,
+				 &pdu,
+				 ut_nvme_tcp_qpair_xfer_complete_cb,
+				 cb_arg);
+	CU_ASSERT(TAILQ_EMPTY(&tqpair.send_queue));
+	CU_ASSERT(TAILQ_FIRST(&poll_group.hdgst_pdus) == &pdu);
+	CU_ASSERT(pdu.hdr.raw[pdu.hdr.common.hlen] == 0);
+
+	nvme_tcp_poll_group_flush_hdgst(&poll_group);
+	CU_ASSERT(TAILQ_EMPTY(&poll_group.hdgst_pdus));
+	CU_ASSERT(TAILQ_FIRST(&tqpair.send_queue) == &pdu);
+	TAILQ_REMOVE(&tqpair.send_queue, &pdu, tailq);
+	CU_ASSERT(MATCH_DIGEST_WORD(&pdu.hdr.raw[pdu.hdr.common.hlen],
+				    nvme_tcp_pdu_calc_header_digest(&pdu)));
+	CU_ASSERT(pdu.sock_req.iovcnt == 3);
+	CU_ASSERT(pdu.iov[0].iov_len == (sizeof(struct spdk_nvme_tcp_cmd) +
+					 SPDK_NVME_TCP_DIGEST_LEN));
 }
 
 static void
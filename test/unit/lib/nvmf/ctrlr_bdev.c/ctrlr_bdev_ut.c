@@ -205,6 +205,14 @@ DEFINE_STUB(spdk_bdev_write_zeroes_blocks, int,
 	     spdk_bdev_io_completion_cb cb, void *cb_arg),
 	    0);
 
+DEFINE_STUB(spdk_bdev_copy_blocks, int,
+	    (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+	     uint64_t dst_offset_blocks, uint64_t src_offset_blocks, uint64_t num_blocks,
+	     spdk_bdev_io_completion_cb cb, void *cb_arg),
+	    0);
+
+DEFINE_STUB(spdk_bdev_get_max_copy, uint32_t, (const struct spdk_bdev *bdev), 0);
+
 DEFINE_STUB(spdk_bdev_nvme_io_passthru, int,
 	    (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 	     const struct spdk_nvme_cmd *cmd, void *buf, size_t nbytes,
@@ -730,6 +738,94 @@ test_nvmf_bdev_ctrlr_cmd(void)
 	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_INTERNAL_DEVICE_ERROR);
 }
 
+static void
+test_nvmf_bdev_ctrlr_copy_cmd(void)
+{
+	int rc;
+	struct spdk_bdev bdev = {};
+	struct spdk_io_channel ch = {};
+	struct spdk_nvmf_request req = {};
+	struct spdk_nvmf_qpair qpair = {};
+	union nvmf_h2c_msg cmd = {};
+	union nvmf_c2h_msg rsp = {};
+	struct spdk_nvme_scc_source_range range = {};
+
+	req.cmd = &cmd;
+	req.rsp = &rsp;
+	req.qpair = &qpair;
+	req.data = &range;
+	req.length = sizeof(range);
+	bdev.blocklen = 512;
+	bdev.blockcnt = 16;
+
+	/* Copy 4 blocks from LBA 0 to LBA 8, single range, format 0 */
+	cmd.nvme_cmd.opc = SPDK_NVME_OPC_COPY;
+	cmd.nvme_cmd.cdw10 = 8;
+	cmd.nvme_cmd.cdw12 = 0;
+	range.slba = 0;
+	range.nlb = 3;
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS);
+
+	/* Destination out of range */
+	cmd.nvme_cmd.cdw10 = 14;
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sct == SPDK_NVME_SCT_GENERIC);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_LBA_OUT_OF_RANGE);
+
+	/* Source out of range */
+	cmd.nvme_cmd.cdw10 = 8;
+	range.slba = 13;
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_LBA_OUT_OF_RANGE);
+
+	/* More than one source range is not supported */
+	range.slba = 0;
+	cmd.nvme_cmd.cdw12 = 1;
+	req.length = 2 * sizeof(range);
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sct == SPDK_NVME_SCT_COMMAND_SPECIFIC);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_CMD_SIZE_LIMIT_SIZE_EXCEEDED);
+
+	/* Descriptor format 1 is not supported */
+	cmd.nvme_cmd.cdw12 = 1 << 8;
+	req.length = sizeof(range);
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_INVALID_FIELD);
+
+	/* SGL too short for the range descriptor */
+	cmd.nvme_cmd.cdw12 = 0;
+	req.length = sizeof(range) - 1;
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_DATA_SGL_LENGTH_INVALID);
+
+	/* Device error */
+	req.length = sizeof(range);
+	MOCK_SET(spdk_bdev_copy_blocks, -EIO);
+	memset(&rsp, 0, sizeof(rsp));
+
+	rc = nvmf_bdev_ctrlr_copy_cmd(&bdev, NULL, &ch, &req);
+	CU_ASSERT(rc == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_INTERNAL_DEVICE_ERROR);
+	MOCK_CLEAR(spdk_bdev_copy_blocks);
+}
+
 static void
 test_nvmf_bdev_ctrlr_read_write_cmd(void)
 {
@@ -911,6 +1007,7 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_nvmf_bdev_ctrlr_compare_and_write_cmd);
 	CU_ADD_TEST(suite, test_nvmf_bdev_ctrlr_start_zcopy);
 	CU_ADD_TEST(suite, test_nvmf_bdev_ctrlr_cmd);
+	CU_ADD_TEST(suite, test_nvmf_bdev_ctrlr_copy_cmd);
 	CU_ADD_TEST(suite, test_nvmf_bdev_ctrlr_read_write_cmd);
 	CU_ADD_TEST(suite, test_nvmf_bdev_ctrlr_nvme_passthru);
 
@@ -86,6 +86,11 @@ DEFINE_STUB(spdk_bdev_get_md_size, uint32_t,
 DEFINE_STUB(spdk_bdev_is_md_interleaved, bool,
 	    (const struct spdk_bdev *bdev), false);
 
+DEFINE_STUB(spdk_bdev_desc_set_qos_class, int,
+	    (struct spdk_bdev_desc *desc, const char *class_name), 0);
+DEFINE_STUB(spdk_bdev_desc_set_label, int,
+	    (struct spdk_bdev_desc *desc, const char *label), 0);
+
 DEFINE_STUB(spdk_bdev_module_claim_bdev, int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 	     struct spdk_bdev_module *module), 0);
@@ -107,6 +107,10 @@ DEFINE_STUB(spdk_bdev_module_claim_bdev, int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 	     struct spdk_bdev_module *module), 0);
 DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_desc_set_qos_class, int,
+	    (struct spdk_bdev_desc *desc, const char *class_name), 0);
+DEFINE_STUB(spdk_bdev_desc_set_label, int,
+	    (struct spdk_bdev_desc *desc, const char *label), 0);
 DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
 DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 1024);
 
@@ -60,6 +60,11 @@ DEFINE_STUB(spdk_bdev_get_md_size, uint32_t,
 DEFINE_STUB(spdk_bdev_is_md_interleaved, bool,
 	    (const struct spdk_bdev *bdev), false);
 
+DEFINE_STUB(spdk_bdev_desc_set_qos_class, int,
+	    (struct spdk_bdev_desc *desc, const char *class_name), 0);
+DEFINE_STUB(spdk_bdev_desc_set_label, int,
+	    (struct spdk_bdev_desc *desc, const char *label), 0);
+
 DEFINE_STUB(spdk_bdev_io_type_supported, bool,
 	    (struct spdk_bdev *bdev,
 	     enum spdk_bdev_io_type io_type), false);
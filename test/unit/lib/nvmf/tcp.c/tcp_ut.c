@@ -123,6 +123,11 @@ DEFINE_STUB(nvmf_ctrlr_write_zeroes_supported,
 	    (struct spdk_nvmf_ctrlr *ctrlr),
 	    false);
 
+DEFINE_STUB(nvmf_ctrlr_copy_supported,
+	    bool,
+	    (struct spdk_nvmf_ctrlr *ctrlr),
+	    false);
+
 DEFINE_STUB(nvmf_bdev_ctrlr_read_cmd,
 	    int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
@@ -153,6 +158,12 @@ DEFINE_STUB(nvmf_bdev_ctrlr_write_zeroes_cmd,
 	     struct spdk_nvmf_request *req),
 	    0);
 
+DEFINE_STUB(nvmf_bdev_ctrlr_copy_cmd,
+	    int,
+	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+	     struct spdk_nvmf_request *req),
+	    0);
+
 DEFINE_STUB(nvmf_bdev_ctrlr_flush_cmd,
 	    int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
@@ -250,11 +261,21 @@ spdk_accel_engine_get_io_channel(void)
 	return spdk_get_io_channel(g_accel_p);
 }
 
-DEFINE_STUB(spdk_accel_submit_crc32cv,
-	    int,
-	    (struct spdk_io_channel *ch, uint32_t *dst, struct iovec *iovs,
-	     uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg),
-	    0);
+static spdk_accel_completion_cb g_accel_cb_fn;
+static void *g_accel_cb_arg;
+
+int
+spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *dst, struct iovec *iovs,
+			  uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn,
+			  void *cb_arg)
+{
+	/* Compute the result right away, but leave the completion to the test */
+	*dst = spdk_crc32c_iov_update(iovs, iovcnt, ~seed);
+	g_accel_cb_fn = cb_fn;
+	g_accel_cb_arg = cb_arg;
+
+	return 0;
+}
 
 DEFINE_STUB(spdk_nvmf_bdev_ctrlr_nvme_passthru_admin,
 	    int,
@@ -899,6 +920,129 @@ test_nvmf_tcp_send_capsule_resp_pdu(void)
 	CU_ASSERT(pdu.iov[0].iov_len == sizeof(struct spdk_nvme_tcp_rsp));
 }
 
+static void
+test_nvmf_tcp_hdgst_batch(void)
+{
+	struct spdk_nvmf_tcp_poll_group tcp_group = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req[4] = {};
+	struct nvme_tcp_pdu pdu[4] = {};
+	uint32_t crc32c;
+	int i;
+
+	TAILQ_INIT(&tcp_group.hdgst_pdus);
+	tqpair.group = &tcp_group;
+	tqpair.host_hdgst_enable = true;
+
+	for (i = 0; i < 4; i++) {
+		tcp_req[i].req.qpair = &tqpair.qpair;
+		tcp_req[i].pdu = &pdu[i];
+		tcp_req[i].req.rsp = (union nvmf_c2h_msg *)&tcp_req[i].rsp;
+		tcp_req[i].req.cmd = (union nvmf_h2c_msg *)&tcp_req[i].cmd;
+		tcp_req[i].req.rsp->nvme_cpl.cid = i;
+
+		/* The header digest is deferred while the qpair belongs to a poll group */
+		nvmf_tcp_send_capsule_resp_pdu(&tcp_req[i], &tqpair);
+		CU_ASSERT(pdu[i].iov[0].iov_len == sizeof(struct spdk_nvme_tcp_rsp));
+	}
+	CU_ASSERT(TAILQ_FIRST(&tcp_group.hdgst_pdus) == &pdu[0]);
+
+	nvmf_tcp_poll_group_flush_hdgst(&tcp_group);
+	CU_ASSERT(TAILQ_EMPTY(&tcp_group.hdgst_pdus));
+
+	for (i = 0; i < 4; i++) {
+		crc32c = nvme_tcp_pdu_calc_header_digest(&pdu[i]);
+		CU_ASSERT(MATCH_DIGEST_WORD(&pdu[i].hdr.raw[pdu[i].hdr.common.hlen], crc32c));
+		CU_ASSERT(pdu[i].iov[0].iov_len == sizeof(struct spdk_nvme_tcp_rsp) +
+			  SPDK_NVME_TCP_DIGEST_LEN);
+	}
+}
+
+static void
+test_nvmf_tcp_h2c_data_ddgst_offload(void)
+{
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_poll_group tcp_group = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req = {};
+	struct nvme_tcp_pdu pdu = {};
+	uint8_t buf[256];
+	uint32_t crc32c;
+
+	memset(buf, 0x5a, sizeof(buf));
+	TAILQ_INIT(&tcp_group.hdgst_pdus);
+	tqpair.group = &tcp_group;
+	tqpair.qpair.transport = &ttransport.transport;
+	tqpair.state = NVME_TCP_QPAIR_STATE_RUNNING;
+	tqpair.pdu_in_progress = &pdu;
+
+	tcp_req.req.qpair = &tqpair.qpair;
+	tcp_req.req.rsp = (union nvmf_c2h_msg *)&tcp_req.rsp;
+	tcp_req.req.iov[0].iov_base = buf;
+	tcp_req.req.iov[0].iov_len = sizeof(buf);
+	tcp_req.req.iovcnt = 1;
+	tcp_req.req.length = sizeof(buf);
+	/* Keep the request from being executed once all of its data has arrived */
+	tcp_req.state = TCP_REQUEST_STATE_AWAITING_R2T_ACK;
+
+	crc32c = spdk_crc32c_update(buf, sizeof(buf), SPDK_CRC32C_XOR) ^ SPDK_CRC32C_XOR;
+
+	/* Case 1: a PDU with the whole request is verified asynchronously */
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD;
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_H2C_DATA;
+	pdu.req = &tcp_req;
+	pdu.ddgst_enable = true;
+	nvme_tcp_pdu_set_data_buf(&pdu, tcp_req.req.iov, tcp_req.req.iovcnt, 0, sizeof(buf));
+	MAKE_DIGEST_WORD(pdu.data_digest, crc32c);
+	g_accel_cb_fn = NULL;
+
+	nvmf_tcp_pdu_payload_handle(&tqpair, &ttransport);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY);
+	CU_ASSERT(tqpair.num_pending_digests == 1);
+	CU_ASSERT(tcp_req.h2c_offset == 0);
+	SPDK_CU_ASSERT_FATAL(g_accel_cb_fn != NULL);
+
+	g_accel_cb_fn(g_accel_cb_arg, 0);
+	CU_ASSERT(tqpair.num_pending_digests == 0);
+	CU_ASSERT(tcp_req.h2c_offset == sizeof(buf));
+	CU_ASSERT(tcp_req.req.rsp->nvme_cpl.status.sc == SPDK_NVME_SC_SUCCESS);
+
+	/* Case 2: a digest mismatch fails the request with a transient transport error */
+	tcp_req.h2c_offset = 0;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD;
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_H2C_DATA;
+	pdu.req = &tcp_req;
+	pdu.ddgst_enable = true;
+	nvme_tcp_pdu_set_data_buf(&pdu, tcp_req.req.iov, tcp_req.req.iovcnt, 0, sizeof(buf));
+	MAKE_DIGEST_WORD(pdu.data_digest, ~crc32c);
+	g_accel_cb_fn = NULL;
+
+	nvmf_tcp_pdu_payload_handle(&tqpair, &ttransport);
+	SPDK_CU_ASSERT_FATAL(g_accel_cb_fn != NULL);
+	g_accel_cb_fn(g_accel_cb_arg, 0);
+	CU_ASSERT(tqpair.num_pending_digests == 0);
+	CU_ASSERT(tcp_req.h2c_offset == sizeof(buf));
+	CU_ASSERT(tcp_req.rsp.status.sc == SPDK_NVME_SC_COMMAND_TRANSIENT_TRANSPORT_ERROR);
+
+	/* Case 3: a PDU with only part of the request is verified synchronously */
+	tcp_req.h2c_offset = 0;
+	tcp_req.req.rsp->nvme_cpl.status.sc = SPDK_NVME_SC_SUCCESS;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD;
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_H2C_DATA;
+	pdu.req = &tcp_req;
+	pdu.ddgst_enable = true;
+	nvme_tcp_pdu_set_data_buf(&pdu, tcp_req.req.iov, tcp_req.req.iovcnt, 0, 128);
+	crc32c = spdk_crc32c_update(buf, 128, SPDK_CRC32C_XOR) ^ SPDK_CRC32C_XOR;
+	MAKE_DIGEST_WORD(pdu.data_digest, crc32c);
+	g_accel_cb_fn = NULL;
+
+	nvmf_tcp_pdu_payload_handle(&tqpair, &ttransport);
+	CU_ASSERT(g_accel_cb_fn == NULL);
+	CU_ASSERT(tqpair.num_pending_digests == 0);
+	CU_ASSERT(tcp_req.h2c_offset == 128);
+	CU_ASSERT(tcp_req.req.rsp->nvme_cpl.status.sc == SPDK_NVME_SC_SUCCESS);
+}
+
 static void
 test_nvmf_tcp_icreq_handle(void)
 {
@@ -1111,6 +1255,8 @@ int main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_qpair_init_mem_resource);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_term_req);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_capsule_resp_pdu);
+	CU_ADD_TEST(suite, test_nvmf_tcp_hdgst_batch);
+	CU_ADD_TEST(suite, test_nvmf_tcp_h2c_data_ddgst_offload);
 	CU_ADD_TEST(suite, test_nvmf_tcp_icreq_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_check_xfer_type);
 	CU_ADD_TEST(suite, test_nvmf_tcp_invalid_sgl);
@@ -159,6 +159,105 @@ flush(void)
 	free(req2);
 }
 
+static void
+readv_direct(void)
+{
+	struct spdk_posix_sock_group_impl group = {};
+	struct spdk_posix_sock psock = {};
+	struct spdk_sock *sock = &psock.base;
+	uint8_t wbuf[64 + 4096], hdr[64], payload[4096];
+	struct iovec iov;
+	int fds[2];
+	ssize_t rc;
+
+	memset(wbuf, 0xA5, sizeof(wbuf));
+
+	rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	psock.fd = fds[0];
+	rc = posix_sock_alloc_pipe(&psock, 8192);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	/* A small read through the pipe reads ahead the payload following it. */
+	rc = write(fds[1], wbuf, sizeof(wbuf));
+	CU_ASSERT(rc == sizeof(wbuf));
+
+	iov.iov_base = hdr;
+	iov.iov_len = sizeof(hdr);
+	rc = posix_sock_readv(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(hdr));
+	CU_ASSERT(psock.pipe_has_data == true);
+
+	/* Buffered data is returned first by a direct read. */
+	iov.iov_base = payload;
+	iov.iov_len = sizeof(payload);
+	rc = posix_sock_readv_direct(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(payload));
+	CU_ASSERT(psock.pipe_has_data == false);
+
+	/* A direct read of the header leaves the payload in the socket, and the payload is
+	 * then read directly into its buffer.
+	 */
+	rc = write(fds[1], wbuf, sizeof(wbuf));
+	CU_ASSERT(rc == sizeof(wbuf));
+
+	iov.iov_base = hdr;
+	iov.iov_len = sizeof(hdr);
+	rc = posix_sock_readv_direct(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(hdr));
+	CU_ASSERT(psock.pipe_has_data == false);
+
+	iov.iov_base = payload;
+	iov.iov_len = sizeof(payload);
+	rc = posix_sock_readv(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(payload));
+	CU_ASSERT(psock.pipe_has_data == false);
+	CU_ASSERT(memcmp(payload, wbuf + sizeof(hdr), sizeof(payload)) == 0);
+
+	/* In a group, a direct read that drains the socket takes it off the list of
+	 * sockets with data.
+	 */
+	rc = fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	CU_ASSERT(rc == 0);
+	TAILQ_INIT(&group.socks_with_data);
+	sock->group_impl = &group.base;
+
+	rc = write(fds[1], wbuf, sizeof(hdr));
+	CU_ASSERT(rc == sizeof(hdr));
+	psock.socket_has_data = true;
+	TAILQ_INSERT_TAIL(&group.socks_with_data, &psock, link);
+
+	iov.iov_base = hdr;
+	iov.iov_len = sizeof(hdr);
+	rc = posix_sock_readv_direct(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(hdr));
+	CU_ASSERT(psock.socket_has_data == true);
+	CU_ASSERT(TAILQ_FIRST(&group.socks_with_data) == &psock);
+
+	rc = posix_sock_readv_direct(sock, &iov, 1);
+	CU_ASSERT(rc == -1);
+	CU_ASSERT(errno == EAGAIN);
+	CU_ASSERT(psock.socket_has_data == false);
+	CU_ASSERT(TAILQ_EMPTY(&group.socks_with_data));
+
+	/* So does a short read. */
+	rc = write(fds[1], wbuf, sizeof(hdr) / 2);
+	CU_ASSERT(rc == sizeof(hdr) / 2);
+	psock.socket_has_data = true;
+	TAILQ_INSERT_TAIL(&group.socks_with_data, &psock, link);
+
+	rc = posix_sock_readv_direct(sock, &iov, 1);
+	CU_ASSERT(rc == sizeof(hdr) / 2);
+	CU_ASSERT(psock.socket_has_data == false);
+	CU_ASSERT(TAILQ_EMPTY(&group.socks_with_data));
+
+	spdk_pipe_destroy(psock.recv_pipe);
+	free(psock.recv_buf);
+	close(fds[0]);
+	close(fds[1]);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -171,6 +270,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("posix", NULL, NULL);
 
 	CU_ADD_TEST(suite, flush);
+	CU_ADD_TEST(suite, readv_direct);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
@@ -142,6 +142,49 @@ test_crc32c(void)
 	CU_ASSERT(crc == 0x6087809A);
 }
 
+static void
+test_crc32c_multi(void)
+{
+	uint8_t buf[7][1024];
+	struct iovec iovs[7];
+	uint32_t crcs[7], expected[7];
+	size_t lens[7] = { 0, 1, 24, 29, 72, 1024, 8 };
+	int i, j, count;
+
+	for (i = 0; i < 7; i++) {
+		for (j = 0; j < (int)sizeof(buf[i]); j++) {
+			buf[i][j] = (uint8_t)(i * 31 + j * 7);
+		}
+		iovs[i].iov_base = buf[i];
+		iovs[i].iov_len = lens[i];
+	}
+
+	/* Cover a count smaller than, equal to and not a multiple of the number of lanes */
+	for (count = 0; count <= 7; count++) {
+		for (i = 0; i < count; i++) {
+			crcs[i] = 0xFFFFFFFFu - i;
+			expected[i] = spdk_crc32c_update(buf[i], lens[i], crcs[i]);
+		}
+
+		spdk_crc32c_update_multi(iovs, crcs, count);
+
+		for (i = 0; i < count; i++) {
+			CU_ASSERT(crcs[i] == expected[i]);
+		}
+	}
+
+	/* Known value, with the other lanes longer and shorter than it */
+	snprintf((char *)buf[1], sizeof(buf[1]), "%s", "Hello world!");
+	iovs[0].iov_len = 40;
+	iovs[1].iov_len = strlen((char *)buf[1]);
+	iovs[2].iov_len = 3;
+	crcs[0] = crcs[1] = crcs[2] = 0xFFFFFFFFu;
+	spdk_crc32c_update_multi(iovs, crcs, 3);
+	CU_ASSERT((crcs[1] ^ 0xFFFFFFFFu) == 0x7b98e751);
+	CU_ASSERT(crcs[0] == spdk_crc32c_update(buf[0], 40, 0xFFFFFFFFu));
+	CU_ASSERT(crcs[2] == spdk_crc32c_update(buf[2], 3, 0xFFFFFFFFu));
+}
+
 int
 main(int argc, char **argv)
 {
@@ -154,6 +197,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("crc32c", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_crc32c);
+	CU_ADD_TEST(suite, test_crc32c_multi);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
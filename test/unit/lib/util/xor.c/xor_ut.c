@@ -0,0 +1,250 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+
+#include "util/xor.c"
+
+#define BUF_COUNT 8
+#define SRC_BUF_COUNT (BUF_COUNT - 1)
+#define BUF_SIZE 4096
+
+static void
+test_xor_gen(void)
+{
+	void *bufs[BUF_COUNT];
+	void *bufs2[SRC_BUF_COUNT];
+	uint8_t *ref, *dest;
+	int ret;
+	size_t i, j;
+	uint32_t *tmp;
+	size_t alignment = spdk_xor_get_optimal_alignment();
+
+	/* alloc and fill the buffers with a pattern */
+	for (i = 0; i < BUF_COUNT; i++) {
+		ret = posix_memalign(&bufs[i], alignment, BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+
+		tmp = bufs[i];
+		for (j = 0; j < BUF_SIZE / sizeof(*tmp); j++) {
+			tmp[j] = (i << 16) + j;
+		}
+	}
+	dest = bufs[SRC_BUF_COUNT];
+
+	/* prepare the reference buffer */
+	ref = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref != NULL);
+
+	memset(ref, 0, BUF_SIZE);
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		for (j = 0; j < BUF_SIZE; j++) {
+			ref[j] ^= ((uint8_t *)bufs[i])[j];
+		}
+	}
+
+	/* generate xor, compare the dest and reference buffers */
+	ret = spdk_xor_gen(dest, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	ret = memcmp(ref, dest, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+
+	/* length not multiple of alignment */
+	memset(dest, 0xba, BUF_SIZE);
+	ret = spdk_xor_gen(dest, bufs, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	ret = memcmp(ref, dest, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(dest[BUF_SIZE - 1] == 0xba);
+
+	/* unaligned buffers */
+	memset(dest, 0xba, BUF_SIZE);
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		bufs2[i] = (uint8_t *)bufs[i] + 1;
+	}
+	ret = spdk_xor_gen(dest + 1, bufs2, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	ret = memcmp(ref + 1, dest + 1, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+
+	/* in-place, the destination is also the first source */
+	memcpy(dest, bufs[0], BUF_SIZE);
+	bufs2[0] = dest;
+	for (i = 1; i < SRC_BUF_COUNT; i++) {
+		bufs2[i] = bufs[i];
+	}
+	ret = spdk_xor_gen(dest, bufs2, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	ret = memcmp(ref, dest, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+
+	/* xoring the result with all sources but one gives back the missing source */
+	bufs2[0] = dest;
+	for (i = 1; i < SRC_BUF_COUNT; i++) {
+		bufs2[i] = bufs[i];
+	}
+	ret = spdk_xor_gen(ref, bufs2, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	ret = memcmp(ref, bufs[0], BUF_SIZE);
+	CU_ASSERT(ret == 0);
+
+	/* invalid number of sources */
+	ret = spdk_xor_gen(dest, bufs, 1, BUF_SIZE);
+	CU_ASSERT(ret == -EINVAL);
+
+	for (i = 0; i < BUF_COUNT; i++) {
+		free(bufs[i]);
+	}
+	free(ref);
+}
+
+static uint8_t
+ref_gf_mul2(uint8_t v)
+{
+	return (v & 0x80) ? (uint8_t)((v << 1) ^ 0x1d) : (uint8_t)(v << 1);
+}
+
+static void
+test_pq_gen(void)
+{
+	void *bufs[BUF_COUNT];
+	void *bufs2[SRC_BUF_COUNT];
+	uint8_t *ref_p, *ref_q, *p, *q, coef;
+	int ret;
+	size_t i, j, k;
+	uint32_t *tmp;
+	size_t alignment = spdk_xor_get_optimal_alignment();
+
+	for (i = 0; i < BUF_COUNT; i++) {
+		ret = posix_memalign(&bufs[i], alignment, BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+
+		tmp = bufs[i];
+		for (j = 0; j < BUF_SIZE / sizeof(*tmp); j++) {
+			tmp[j] = (i << 16) + j * 0x9e3779b1;
+		}
+	}
+	p = bufs[SRC_BUF_COUNT];
+	ret = posix_memalign((void **)&q, alignment, BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ret == 0);
+
+	/* prepare the reference buffers, Q = sum(2^i * D_i) in GF(2^8) */
+	ref_p = calloc(1, BUF_SIZE);
+	ref_q = calloc(1, BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref_p != NULL && ref_q != NULL);
+
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		for (j = 0; j < BUF_SIZE; j++) {
+			coef = ((uint8_t *)bufs[i])[j];
+			for (k = 0; k < i; k++) {
+				coef = ref_gf_mul2(coef);
+			}
+			ref_p[j] ^= ((uint8_t *)bufs[i])[j];
+			ref_q[j] ^= coef;
+		}
+	}
+
+	ret = spdk_pq_gen(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE) == 0);
+
+	/* length not multiple of alignment */
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	ret = spdk_pq_gen(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE - 1) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE - 1) == 0);
+	CU_ASSERT(p[BUF_SIZE - 1] == 0xba);
+	CU_ASSERT(q[BUF_SIZE - 1] == 0xba);
+
+	/* unaligned buffers */
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		bufs2[i] = (uint8_t *)bufs[i] + 1;
+	}
+	ret = spdk_pq_gen(p + 1, q + 1, bufs2, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p + 1, p + 1, BUF_SIZE - 1) == 0);
+	CU_ASSERT(memcmp(ref_q + 1, q + 1, BUF_SIZE - 1) == 0);
+
+	/* two sources, Q = D_0 ^ 2 * D_1 */
+	ret = spdk_pq_gen(p, q, bufs, 2, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	for (j = 0; j < BUF_SIZE; j++) {
+		uint8_t d0 = ((uint8_t *)bufs[0])[j];
+		uint8_t d1 = ((uint8_t *)bufs[1])[j];
+
+		CU_ASSERT(p[j] == (d0 ^ d1));
+		CU_ASSERT(q[j] == (d0 ^ ref_gf_mul2(d1)));
+	}
+
+	/* invalid number of sources */
+	ret = spdk_pq_gen(p, q, bufs, 1, BUF_SIZE);
+	CU_ASSERT(ret == -EINVAL);
+
+	for (i = 0; i < BUF_COUNT; i++) {
+		free(bufs[i]);
+	}
+	free(q);
+	free(ref_p);
+	free(ref_q);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("xor", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_xor_gen);
+	CU_ADD_TEST(suite, test_pq_gen);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+
+	CU_basic_run_tests();
+
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -16,12 +16,19 @@ function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/bdev.c/bdev_ut
 	$valgrind $testdir/lib/bdev/nvme/bdev_nvme.c/bdev_nvme_ut
 	$valgrind $testdir/lib/bdev/raid/bdev_raid.c/bdev_raid_ut
+	$valgrind $testdir/lib/bdev/raid/raid1.c/raid1_ut
+	$valgrind $testdir/lib/bdev/cache/cache_table.c/cache_table_ut
+	$valgrind $testdir/lib/bdev/cache/vbdev_cache.c/vbdev_cache_ut
+	$valgrind $testdir/lib/bdev/dedup/dedup_index.c/dedup_index_ut
+	$valgrind $testdir/lib/bdev/dedup/vbdev_dedup.c/vbdev_dedup_ut
 	$valgrind $testdir/lib/bdev/bdev_zone.c/bdev_zone_ut
 	$valgrind $testdir/lib/bdev/gpt/gpt.c/gpt_ut
 	$valgrind $testdir/lib/bdev/part.c/part_ut
 	$valgrind $testdir/lib/bdev/scsi_nvme.c/scsi_nvme_ut
 	$valgrind $testdir/lib/bdev/vbdev_lvol.c/vbdev_lvol_ut
 	$valgrind $testdir/lib/bdev/vbdev_zone_block.c/vbdev_zone_block_ut
+	$valgrind $testdir/lib/bdev/vbdev_readahead.c/vbdev_readahead_ut
+	$valgrind $testdir/lib/bdev/vbdev_write_merge.c/vbdev_write_merge_ut
 	$valgrind $testdir/lib/bdev/mt/bdev.c/bdev_ut
 }
 
@@ -130,6 +137,7 @@ function unittest_util() {
 	$valgrind $testdir/lib/util/iov.c/iov_ut
 	$valgrind $testdir/lib/util/math.c/math_ut
 	$valgrind $testdir/lib/util/pipe.c/pipe_ut
+	$valgrind $testdir/lib/util/xor.c/xor_ut
 }
 
 function unittest_init() {
@@ -199,6 +207,10 @@ if grep -q '#define SPDK_CONFIG_RAID5 1' $rootdir/include/spdk/config.h; then
 	run_test "unittest_bdev_raid5" $valgrind $testdir/lib/bdev/raid/raid5.c/raid5_ut
 fi
 
+if grep -q '#define SPDK_CONFIG_RAID6 1' $rootdir/include/spdk/config.h; then
+	run_test "unittest_bdev_raid6" $valgrind $testdir/lib/bdev/raid/raid6.c/raid6_ut
+fi
+
 run_test "unittest_blob_blobfs" unittest_blob
 run_test "unittest_event" unittest_event
 if [ $(uname -s) = Linux ]; then